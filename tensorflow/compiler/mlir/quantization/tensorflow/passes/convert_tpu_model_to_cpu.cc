@@ -16,6 +16,7 @@ limitations under the License.
 #include <utility>
 
 #include "mlir/IR/MLIRContext.h"  // from @llvm-project
+#include "mlir/IR/Visitors.h"  // from @llvm-project
 #include "mlir/Pass/Pass.h"  // from @llvm-project
 #include "mlir/Support/LLVM.h"  // from @llvm-project
 #include "mlir/Support/LogicalResult.h"  // from @llvm-project
@@ -121,6 +122,23 @@ void ConvertTpuModelToCpuPass::runOnOperation() {
   RewritePatternSet patterns(ctx);
   ModuleOp module_op = getOperation();
 
+  // A `TF::PartitionedCallOp` passes each operand as one argument, while `f`
+  // takes two arguments per batched tensor with the RAGGED policy.
+  const WalkResult walk_result =
+      module_op.walk([](TF::BatchFunctionOp batch_func_op) {
+        if (batch_func_op.getNumFuncArgsPerInTensor() != 1) {
+          batch_func_op.emitError()
+              << "quant-convert-tpu-model-to-cpu does not support the RAGGED "
+                 "batch padding policy";
+          return WalkResult::interrupt();
+        }
+        return WalkResult::advance();
+      });
+  if (walk_result.wasInterrupted()) {
+    signalPassFailure();
+    return;
+  }
+
   patterns.add<ReplaceTpuPartitionedCallOpWithPartitionedCallOp,
                ReplaceBatchFunctionOpToPartitionedCallOp>(ctx);
   patterns.add<RemoveTpuOp>(ctx);
@@ -1,4 +1,4 @@
-// RUN: tf-quant-opt %s -quant-convert-tpu-model-to-cpu -inline -quant-cast-bf16-ops-to-f32 -split-input-file | \
+// RUN: tf-quant-opt %s -quant-convert-tpu-model-to-cpu -inline -quant-cast-bf16-ops-to-f32 -split-input-file -verify-diagnostics | \
 // RUN: FileCheck %s
 
 // Remove TPU related ops.
@@ -54,3 +54,20 @@ func.func private @batched_func(%arg0: tensor<1xf32>, %arg1: tensor<1xf32>) -> t
 }
 // The called function should be removed.
 // CHECK-NOT: batched_func
+
+// -----
+
+// Tests that `tf.BatchFunction` with the RAGGED batch padding policy is
+// rejected, since `@ragged_batched_func` takes two arguments per batched
+// tensor.
+
+func.func @serving_ragged(%arg0: tensor<1x2xf32>, %arg1: tensor<1xf32>) -> tensor<?xf32> {
+  // expected-error @below {{quant-convert-tpu-model-to-cpu does not support the RAGGED batch padding policy}}
+  %0 = "tf.BatchFunction"(%arg0, %arg1) {f = @ragged_batched_func, batch_padding_policy = "RAGGED", num_batch_threads = 1 : i64, max_batch_size = 2 : i64, batch_timeout_micros = 10000 : i64, operandSegmentSizes = array<i32: 1, 1>} : (tensor<1x2xf32>, tensor<1xf32>) -> (tensor<?xf32>)
+  return %0 : tensor<?xf32>
+}
+
+func.func private @ragged_batched_func(%arg0: tensor<?xf32>, %arg1: tensor<?xi64>, %arg2: tensor<1xf32>) -> tensor<?xf32> {
+  %0 = "tf.Identity"(%arg0) : (tensor<?xf32>) -> tensor<?xf32>
+  return %0 : tensor<?xf32>
+}
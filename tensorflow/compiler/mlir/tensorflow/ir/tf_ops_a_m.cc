@@ -273,6 +273,21 @@ LogicalResult BatchFunctionOp::verifySymbolUses(
            << func_attr.getValue();
   }
 
+  // With the RAGGED policy, `f` takes two arguments per batched tensor, which
+  // passes that rewrite the operands must account for.
+  if (getBatchPaddingPolicy() == "RAGGED") {
+    const size_t expected_num_args =
+        getInTensors().size() * getNumFuncArgsPerInTensor() +
+        getCapturedTensors().size();
+    if (func.getNumArguments() != expected_num_args) {
+      return emitError("'f' must take two arguments per batched tensor and "
+                       "one per captured tensor with the RAGGED batch "
+                       "padding policy, expected ")
+             << expected_num_args << " arguments but got "
+             << func.getNumArguments();
+    }
+  }
+
   return success();
 }
 
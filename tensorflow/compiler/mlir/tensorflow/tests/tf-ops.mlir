@@ -5192,6 +5192,31 @@ func.func @test_batch_function_with_invalid_symbol(%arg0: tensor<1x3xf32>, %arg1
 
 // -----
 
+func.func @test_ragged_batch_function(%arg0: tensor<1x3xf32>, %arg1: tensor<!tf_type.resource<tensor<1x3xf32>>>) -> () {
+  "tf.BatchFunction"(%arg0, %arg1) {batch_padding_policy = "RAGGED", batch_timeout_micros = 100000 : i64, f = @ragged_batched_function, max_batch_size = 6 : i64, max_enqueued_batches = 10 : i64, num_batch_threads = 1 : i64, operandSegmentSizes = array<i32: 1, 1>} : (tensor<1x3xf32>, tensor<!tf_type.resource<tensor<1x3xf32>>>) -> tensor<*xf32>
+  func.return
+}
+
+func.func private @ragged_batched_function(%arg0: tensor<?xf32>, %arg1: tensor<?xi64>, %arg2: tensor<*x!tf_type.resource>) -> tensor<?xf32> {
+  %0 = "tf.Identity"(%arg0) : (tensor<?xf32>) -> tensor<?xf32>
+  func.return %0 : tensor<?xf32>
+}
+
+// -----
+
+func.func @test_ragged_batch_function_with_wrong_arity(%arg0: tensor<1x3xf32>, %arg1: tensor<!tf_type.resource<tensor<1x3xf32>>>) -> () {
+  // expected-error @below {{'f' must take two arguments per batched tensor and one per captured tensor with the RAGGED batch padding policy, expected 3 arguments but got 2}}
+  "tf.BatchFunction"(%arg0, %arg1) {batch_padding_policy = "RAGGED", batch_timeout_micros = 100000 : i64, f = @batched_function, max_batch_size = 6 : i64, max_enqueued_batches = 10 : i64, num_batch_threads = 1 : i64, operandSegmentSizes = array<i32: 1, 1>} : (tensor<1x3xf32>, tensor<!tf_type.resource<tensor<1x3xf32>>>) -> tensor<*xf32>
+  func.return
+}
+
+func.func private @batched_function(%arg0: tensor<1x3xf32>, %arg1: tensor<*x!tf_type.resource>) -> tensor<1x3xf32> {
+  %0 = "tf.Identity"(%arg0) : (tensor<1x3xf32>) -> tensor<1x3xf32>
+  func.return %0 : tensor<1x3xf32>
+}
+
+// -----
+
 func.func @test_xla_call_module_with_invalid_symbol() {
   // expected-error @below {{refers to an undefined function: @undefined_function}}
   "tf.XlaCallModule"() {Sout = [], device = "", dim_args_spec = [], function_list = [@undefined_function], module = "", platforms = [], version = 4 : i64} : () -> ()
@@ -267,6 +267,33 @@ module attributes {tf_saved_model.semantics} {
 
 // -----
 
+// Test variable is frozen when it is captured by a `TF::BatchFunctionOp` with
+// the RAGGED batch padding policy, which passes each batched tensor as two
+// arguments of the called function.
+
+module attributes {tf_saved_model.semantics} {
+  // CHECK-NOT: tf_saved_model.global_tensor
+ "tf_saved_model.global_tensor"() {sym_name = "var1", type = tensor<f32>, value = dense<1.0> : tensor<f32> } : () -> ()
+
+  func.func private @f_batch_callee(%arg0: tensor<?xf32>, %arg1: tensor<?xi64>, %arg2: tensor<!tf_type.resource<tensor<f32>>>) -> (tensor<?xf32>, tensor<f32>) {
+    %0 = "tf.ReadVariableOp"(%arg2) : (tensor<!tf_type.resource<tensor<f32>>>) -> tensor<f32>
+    func.return %arg0, %0 : tensor<?xf32>, tensor<f32>
+  }
+  // CHECK: func.func private @f_batch_callee(%[[ARG_0:.*]]: tensor<?xf32>, %[[ARG_1:.*]]: tensor<?xi64>) -> (tensor<?xf32>, tensor<f32>)
+  // CHECK-DAG: %[[CST_0:.*]] = "tf.Const"() <{value = dense<1.000000e+00> : tensor<f32>}> : () -> tensor<f32>
+  // CHECK: return %[[ARG_0]], %[[CST_0]] : tensor<?xf32>, tensor<f32>
+
+  func.func @f(%handle: tensor<!tf_type.resource<tensor<f32>>> {tf_saved_model.bound_input = @var1}) -> (tensor<*xf32> {tf_saved_model.index_path = []}, tensor<*xf32> {tf_saved_model.index_path = []})
+  attributes {tf_saved_model.exported_names = ["f"]} {
+    %arg = "tf.Const"() {value = dense<1.000000e+00> : tensor<1x1xf32>} : () -> tensor<1x1xf32>
+    %0, %1 = "tf.BatchFunction"(%arg, %handle) {f = @f_batch_callee, operandSegmentSizes = array<i32: 1, 1>, batch_padding_policy = "RAGGED", batch_timeout_micros = 1000, max_batch_size = 8, num_batch_threads = 2} : (tensor<1x1xf32>, tensor<!tf_type.resource<tensor<f32>>>) -> (tensor<*xf32>, tensor<*xf32>)
+    func.return %0, %1 : tensor<*xf32>, tensor<*xf32>
+  }
+  // CHECK: "tf.BatchFunction"(%cst) <{batch_padding_policy = "RAGGED", {{.*}}operandSegmentSizes = array<i32: 1, 0>}>
+}
+
+// -----
+
 // Tests that "tf._input_shapes" attribute is updated correctly
 
 module attributes {tf_saved_model.semantics} {
@@ -184,11 +184,25 @@ LogicalResult PropagateUsage(
       work_list->push_back(std::make_pair(callee, argument_index));
     }
   } else if (auto batch_func_op = dyn_cast<TF::BatchFunctionOp>(user_op)) {
+    // A batched tensor is not a single argument of the called function with
+    // the RAGGED policy, so only captured tensors can be frozen.
+    const int num_in_tensors = batch_func_op.getInTensors().size();
+    if (argument_index < num_in_tensors &&
+        batch_func_op.getNumFuncArgsPerInTensor() != 1) {
+      user_op->emitError() << "could not freeze a batched input of a "
+                              "BatchFunction with the RAGGED batch padding "
+                              "policy";
+      return failure();
+    }
     (*arguments_to_erase)[batch_func_op].push_back(argument_index);
     // Add the called function to the work list.
     func::FuncOp func_op = batch_func_op.func();
-    (*arguments_to_erase)[func_op].push_back(argument_index);
-    work_list->push_back({&func_op.getRegion(), argument_index});
+    const int func_arg_index =
+        argument_index < num_in_tensors
+            ? argument_index
+            : batch_func_op.getCapturedTensorFuncArgIndex(argument_index);
+    (*arguments_to_erase)[func_op].push_back(func_arg_index);
+    work_list->push_back({&func_op.getRegion(), func_arg_index});
   } else {
     // Return and yield ops are the only ops that use the resource outside of
     // the above ops.
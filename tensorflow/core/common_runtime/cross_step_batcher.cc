@@ -0,0 +1,282 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/cross_step_batcher.h"
+
+#include <chrono>  // NOLINT(build/c++11)
+#include <memory>
+#include <vector>
+
+#include "absl/container/flat_hash_set.h"
+#include "absl/strings/string_view.h"
+#include "tensorflow/core/framework/cancellation.h"
+#include "tensorflow/core/framework/node_def_util.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_util.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/logging.h"
+
+namespace tensorflow {
+namespace {
+
+// Returns true if the op of `kernel` computes each row of its first input
+// independently, so that its invocations can be batched along dimension 0 of
+// its first input and of all of its outputs.
+bool HasBatchDimension(const OpKernel& kernel) {
+  static const auto* const kRowWiseOps = new absl::flat_hash_set<
+      absl::string_view>({"Elu", "LogSoftmax", "Relu", "Relu6", "Selu",
+                          "Sigmoid", "Softmax", "Softplus", "Softsign",
+                          "Tanh"});
+  const absl::string_view op = kernel.type_string_view();
+  if (op == "MatMul") {
+    bool transpose_a = true;
+    return GetNodeAttr(kernel.def(), "transpose_a", &transpose_a).ok() &&
+           !transpose_a;
+  }
+  if (op == "BiasAdd") {
+    string data_format;
+    return GetNodeAttr(kernel.def(), "data_format", &data_format).ok() &&
+           data_format == "NHWC";
+  }
+  return kRowWiseOps->contains(op);
+}
+
+}  // namespace
+
+struct CrossStepBatcher::Invocation {
+  Invocation(OpKernelContext::Params* params, OpKernelContext* ctx,
+             std::function<void()> done)
+      : params(params),
+        ctx(ctx),
+        input(params->inputs[0].tensor),
+        done(std::move(done)) {}
+
+  OpKernelContext::Params* const params;
+  OpKernelContext* const ctx;
+  // The input which is batched.
+  const Tensor* const input;
+  // Called when the outputs or the status of `ctx` have been set.
+  std::function<void()> done;
+};
+
+struct CrossStepBatcher::Batch {
+  // The first invocation runs the kernel for all of them.
+  std::vector<std::unique_ptr<Invocation>> invocations;
+};
+
+CrossStepBatcher::CrossStepBatcher(const GraphView& gview, Device* device,
+                                   int64_t window_us, int max_batch_size)
+    : device_(device),
+      window_us_(window_us),
+      max_batch_size_(max_batch_size),
+      batchable_(gview.num_nodes(), false) {
+  int num_batchable = 0;
+  for (int32_t i = 0; i < gview.num_nodes(); ++i) {
+    const NodeItem* item = gview.node(i);
+    if (item == nullptr || item->kernel == nullptr || item->kernel_is_async ||
+        item->is_any_input_ref_typed || item->num_inputs == 0) {
+      continue;
+    }
+    batchable_[i] = HasBatchDimension(*item->kernel);
+    num_batchable += batchable_[i];
+  }
+  VLOG(1) << "Batching " << num_batchable << " of " << gview.num_nodes()
+          << " nodes across steps within " << window_us_ << " us.";
+}
+
+void CrossStepBatcher::StepStarted() {
+  num_running_steps_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void CrossStepBatcher::StepFinished() {
+  num_running_steps_.fetch_sub(1, std::memory_order_relaxed);
+  // An open batch may now hold all running steps.
+  mutex_lock l(mu_);
+  if (!open_batches_.empty()) {
+    batch_full_.notify_all();
+  }
+}
+
+bool CrossStepBatcher::IsFull(const Batch& batch) const {
+  const size_t size = batch.invocations.size();
+  return size >= static_cast<size_t>(max_batch_size_) ||
+         size >= static_cast<size_t>(
+                     num_running_steps_.load(std::memory_order_relaxed));
+}
+
+bool CrossStepBatcher::Accepts(const Batch& batch,
+                               const Invocation& invocation) {
+  const Invocation& first = *batch.invocations.front();
+  const Tensor& input = *invocation.input;
+  if (input.dtype() != first.input->dtype() ||
+      input.dims() != first.input->dims()) {
+    return false;
+  }
+  for (int d = 1; d < input.dims(); ++d) {
+    if (input.dim_size(d) != first.input->dim_size(d)) return false;
+  }
+  // The other inputs must be the same tensors.
+  for (size_t i = 1; i < invocation.params->inputs.size(); ++i) {
+    const Tensor* a = invocation.params->inputs[i].tensor;
+    const Tensor* b = first.params->inputs[i].tensor;
+    if (a == nullptr || b == nullptr || a->dtype() != b->dtype() ||
+        a->data() != b->data() || a->shape() != b->shape()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void CrossStepBatcher::ComputeAsync(const NodeItem& item,
+                                    OpKernelContext::Params* params,
+                                    OpKernelContext* ctx,
+                                    std::function<void()> done) {
+  DCHECK(IsBatchable(item));
+  const Tensor* input = params->inputs[0].tensor;
+  // Without other running steps, there is nothing to wait for.
+  if (input == nullptr || input->dims() < 2 ||
+      num_running_steps_.load(std::memory_order_relaxed) <= 1) {
+    device_->Compute(item.kernel, ctx);
+    done();
+    return;
+  }
+
+  auto invocation = std::make_unique<Invocation>(params, ctx, std::move(done));
+  Batch* batch = nullptr;
+  {
+    mutex_lock l(mu_);
+    auto it = open_batches_.find(item.node_id);
+    if (it == open_batches_.end()) {
+      batch = new Batch;
+      batch->invocations.push_back(std::move(invocation));
+      open_batches_.emplace(item.node_id, batch);
+    } else if (Accepts(*it->second, *invocation)) {
+      // The first invocation of the batch runs the kernel and calls `done`.
+      it->second->invocations.push_back(std::move(invocation));
+      if (IsFull(*it->second)) {
+        open_batches_.erase(it);
+        batch_full_.notify_all();
+      }
+      return;
+    }
+  }
+  if (batch == nullptr) {
+    // The open batch does not accept this invocation.
+    device_->Compute(item.kernel, ctx);
+    invocation->done();
+    return;
+  }
+
+  // Wait for the invocations of other steps.
+  std::unique_ptr<Batch> owned_batch(batch);
+  {
+    mutex_lock l(mu_);
+    Env* env = Env::Default();
+    const uint64 deadline_us = env->NowMicros() + window_us_;
+    while (!IsFull(*batch)) {
+      const uint64 now_us = env->NowMicros();
+      if (now_us >= deadline_us) break;
+      batch_full_.wait_for(l, std::chrono::microseconds(deadline_us - now_us));
+    }
+    auto it = open_batches_.find(item.node_id);
+    if (it != open_batches_.end() && it->second == batch) {
+      open_batches_.erase(it);
+    }
+  }
+
+  // No invocation joins the batch any more.
+  if (batch->invocations.size() == 1) {
+    device_->Compute(item.kernel, ctx);
+  } else {
+    ComputeBatch(item, batch);
+    num_batches_.fetch_add(1, std::memory_order_relaxed);
+  }
+  for (const std::unique_ptr<Invocation>& invocation : batch->invocations) {
+    invocation->done();
+  }
+}
+
+void CrossStepBatcher::ComputeBatch(const NodeItem& item, Batch* batch) {
+  const std::vector<std::unique_ptr<Invocation>>& invocations =
+      batch->invocations;
+  std::vector<Tensor> inputs;
+  inputs.reserve(invocations.size());
+  for (const std::unique_ptr<Invocation>& invocation : invocations) {
+    inputs.push_back(*invocation->input);
+  }
+  Tensor batched_input;
+  absl::Status s = tensor::Concat(inputs, &batched_input);
+
+  if (s.ok()) {
+    // The kernel runs for all steps of the batch, so it gets none of the
+    // state of a step, e.g. its cancellation manager, rendezvous, step
+    // container or step arena. In particular, its outputs are not allocated
+    // from memory which is released with a step.
+    const OpKernelContext::Params& first = *invocations.front()->params;
+    absl::InlinedVector<TensorValue, 4> input_values(first.inputs.begin(),
+                                                     first.inputs.end());
+    input_values[0] = TensorValue(&batched_input);
+    OpKernelContext::Params params;
+    params.device = first.device;
+    params.op_kernel = first.op_kernel;
+    params.resource_manager = first.resource_manager;
+    params.log_memory = first.log_memory;
+    params.output_attr_array = first.output_attr_array;
+    params.inputs = input_values;
+    params.input_alloc_attrs = first.input_alloc_attrs;
+
+    OpKernelContext ctx(&params, item.num_outputs);
+    device_->Compute(item.kernel, &ctx);
+    s = ctx.status();
+
+    // Hand each invocation its rows of the outputs.
+    for (int i = 0; s.ok() && i < item.num_outputs; ++i) {
+      const Tensor* output = ctx.mutable_output(i);
+      if (output == nullptr) continue;
+      if (output->dims() == 0 ||
+          output->dim_size(0) != batched_input.dim_size(0)) {
+        s = errors::Internal("Batched output ", i, " of ", item.kernel->name(),
+                             " has shape ", output->shape().DebugString(),
+                             ", expected ", batched_input.dim_size(0),
+                             " rows");
+        break;
+      }
+      int64_t start = 0;
+      for (const std::unique_ptr<Invocation>& invocation : invocations) {
+        const int64_t end = start + invocation->input->dim_size(0);
+        Tensor rows = output->Slice(start, end);
+        invocation->ctx->set_output(
+            i, rows.IsAligned() ? rows : tensor::DeepCopy(rows));
+        start = end;
+      }
+    }
+  }
+
+  for (const std::unique_ptr<Invocation>& invocation : invocations) {
+    CancellationManager* cancellation_manager =
+        invocation->params->cancellation_manager;
+    if (!s.ok()) {
+      invocation->ctx->SetStatus(s);
+    } else if (cancellation_manager != nullptr &&
+               cancellation_manager->IsCancelled()) {
+      invocation->ctx->SetStatus(errors::Cancelled(
+          "Step ", invocation->params->step_id, " was cancelled while ",
+          item.kernel->name(), " ran for a batch of steps"));
+    }
+  }
+}
+
+}  // namespace tensorflow
@@ -0,0 +1,125 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_COMMON_RUNTIME_CROSS_STEP_BATCHER_H_
+#define TENSORFLOW_CORE_COMMON_RUNTIME_CROSS_STEP_BATCHER_H_
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "tensorflow/core/common_runtime/device.h"
+#include "tensorflow/core/common_runtime/graph_view.h"
+#include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+
+namespace tensorflow {
+
+// Coalesces the invocations of the same node by concurrently running steps of
+// an executor into one invocation of its kernel on the inputs of all steps,
+// concatenated along the batch dimension.
+//
+// Only nodes whose op computes each row of its first input independently,
+// e.g. MatMul with an untransposed first input, BiasAdd and unary activation
+// functions, are batched. Invocations are coalesced only if their first
+// inputs have the same type and the same shape after the batch dimension,
+// and their other inputs are the same tensors, e.g. the weights of a layer.
+//
+// The first invocation of a node waits up to `window_us` microseconds for the
+// invocations of other steps, then runs the kernel and hands each step its
+// rows of the outputs. The other invocations return at once, and their
+// callbacks are called by the thread of the first invocation. The wait ends
+// early once every running step has joined the batch, and is skipped when no
+// other step is running.
+//
+// The batched kernel runs without the state of any one step, e.g. its
+// cancellation manager, rendezvous or step container. A step which is
+// cancelled while its invocation is in a batch fails only that invocation.
+//
+// This class is thread-safe.
+class CrossStepBatcher {
+ public:
+  // The maximum number of invocations in a batch.
+  static constexpr int kMaxBatchSize = 64;
+
+  // `gview` must outlive the batcher.
+  CrossStepBatcher(const GraphView& gview, Device* device, int64_t window_us,
+                   int max_batch_size = kMaxBatchSize);
+
+  CrossStepBatcher(const CrossStepBatcher&) = delete;
+  CrossStepBatcher& operator=(const CrossStepBatcher&) = delete;
+
+  // Must be called when a step of the executor starts and when it finishes,
+  // so that invocations do not wait for steps which cannot join them.
+  void StepStarted();
+  void StepFinished();
+
+  // Returns true if the invocations of `item` may be batched.
+  bool IsBatchable(const NodeItem& item) const {
+    return batchable_[item.node_id];
+  }
+
+  // Runs the kernel of `item` for `ctx`, whose parameters are `params`,
+  // possibly in one invocation with other steps, and calls `done` once the
+  // outputs or the status of `ctx` are set. If `ctx` joins a batch which the
+  // invocation of another step runs, returns without waiting for it, and
+  // `done` is called by the thread of that invocation. `params` and `ctx`
+  // must stay alive until `done` is called.
+  //
+  // REQUIRES: IsBatchable(item).
+  void ComputeAsync(const NodeItem& item, OpKernelContext::Params* params,
+                    OpKernelContext* ctx, std::function<void()> done);
+
+  // Returns the number of kernel invocations which ran for more than one
+  // step.
+  int64_t num_batches() const {
+    return num_batches_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  struct Invocation;
+  struct Batch;
+
+  // Returns true if `invocation` can be added to `batch`.
+  static bool Accepts(const Batch& batch, const Invocation& invocation);
+
+  // Returns true if no other invocation can join `batch`.
+  bool IsFull(const Batch& batch) const;
+
+  // Runs the kernel on the concatenated inputs of `batch`, and sets the
+  // outputs or the status of all invocations, without calling their
+  // callbacks.
+  void ComputeBatch(const NodeItem& item, Batch* batch);
+
+  Device* const device_;
+  const int64_t window_us_;
+  const int max_batch_size_;
+  std::vector<bool> batchable_;
+  std::atomic<int64_t> num_batches_{0};
+  std::atomic<int> num_running_steps_{0};
+
+  mutex mu_;
+  // Notified when an open batch may be full.
+  condition_variable batch_full_;
+  // The batch of each node which new invocations can join.
+  absl::flat_hash_map<int32_t, Batch*> open_batches_ TF_GUARDED_BY(mu_);
+};
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_COMMON_RUNTIME_CROSS_STEP_BATCHER_H_
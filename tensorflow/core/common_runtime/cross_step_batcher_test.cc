@@ -0,0 +1,242 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/cross_step_batcher.h"
+
+#include <memory>
+#include <vector>
+
+#include "tensorflow/core/common_runtime/device.h"
+#include "tensorflow/core/common_runtime/device_factory.h"
+#include "tensorflow/core/common_runtime/graph_view.h"
+#include "tensorflow/core/framework/cancellation.h"
+#include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/framework/types.pb.h"
+#include "tensorflow/core/graph/graph.h"
+#include "tensorflow/core/graph/testlib.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/notification.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/threadpool.h"
+#include "tensorflow/core/public/session_options.h"
+#include "tensorflow/core/public/version.h"
+
+namespace tensorflow {
+namespace {
+
+class CrossStepBatcherTest : public ::testing::Test {
+ protected:
+  CrossStepBatcherTest()
+      : device_(DeviceFactory::NewDevice("CPU", {},
+                                         "/job:localhost/replica:0/task:0")),
+        graph_(OpRegistry::Global()) {}
+
+  // Builds a graph with a MatMul node of 2x2 float matrices, and returns its
+  // item.
+  const NodeItem& BuildMatMul(bool transpose_a) {
+    Tensor value(DT_FLOAT, TensorShape({2, 2}));
+    value.flat<float>().setZero();
+    Node* a = test::graph::Constant(&graph_, value);
+    Node* b = test::graph::Constant(&graph_, value);
+    Node* matmul = test::graph::Matmul(&graph_, a, b, transpose_a, false);
+    TF_CHECK_OK(gview_.Initialize(&graph_));
+    absl::Status status;
+    kernel_ = CreateOpKernel(DEVICE_CPU, device_.get(),
+                             device_->GetAllocator(AllocatorAttributes()),
+                             matmul->def(), TF_GRAPH_DEF_VERSION, &status);
+    TF_CHECK_OK(status);
+    NodeItem* item = gview_.node(matmul->id());
+    item->kernel = kernel_.get();
+    item->num_outputs = 1;
+    return *item;
+  }
+
+  // Runs the MatMul of `a` and `b` with `batcher` in a step whose
+  // cancellation manager is `cancellation_manager`, and sets `output`.
+  absl::Status Run(CrossStepBatcher* batcher, const NodeItem& item,
+                   const Tensor& a, const Tensor& b,
+                   CancellationManager* cancellation_manager, Tensor* output) {
+    Tensor a_copy = a;
+    Tensor b_copy = b;
+    absl::InlinedVector<TensorValue, 4> inputs = {TensorValue(&a_copy),
+                                                  TensorValue(&b_copy)};
+    OpKernelContext::Params params;
+    params.device = device_.get();
+    params.op_kernel = item.kernel;
+    params.inputs = inputs;
+    params.cancellation_manager = cancellation_manager;
+    OpKernelContext ctx(&params, item.num_outputs);
+    Notification done;
+    batcher->ComputeAsync(item, &params, &ctx, [&done]() { done.Notify(); });
+    done.WaitForNotification();
+    TF_RETURN_IF_ERROR(ctx.status());
+    *output = *ctx.mutable_output(0);
+    return absl::OkStatus();
+  }
+
+  Tensor Run(CrossStepBatcher* batcher, const NodeItem& item, const Tensor& a,
+             const Tensor& b) {
+    Tensor output;
+    TF_CHECK_OK(Run(batcher, item, a, b, /*cancellation_manager=*/nullptr,
+                    &output));
+    return output;
+  }
+
+  std::unique_ptr<Device> device_;
+  Graph graph_;
+  GraphView gview_;
+  std::unique_ptr<OpKernel> kernel_;
+};
+
+TEST_F(CrossStepBatcherTest, IsBatchable) {
+  const NodeItem& item = BuildMatMul(/*transpose_a=*/false);
+  CrossStepBatcher batcher(gview_, device_.get(), /*window_us=*/0);
+  EXPECT_TRUE(batcher.IsBatchable(item));
+  // The source node has no kernel.
+  EXPECT_FALSE(batcher.IsBatchable(gview_.node_ref(0)));
+}
+
+TEST_F(CrossStepBatcherTest, NotBatchableWithTransposedInput) {
+  const NodeItem& item = BuildMatMul(/*transpose_a=*/true);
+  CrossStepBatcher batcher(gview_, device_.get(), /*window_us=*/0);
+  EXPECT_FALSE(batcher.IsBatchable(item));
+}
+
+TEST_F(CrossStepBatcherTest, RunsAloneWithinWindow) {
+  const NodeItem& item = BuildMatMul(/*transpose_a=*/false);
+  CrossStepBatcher batcher(gview_, device_.get(), /*window_us=*/100);
+  // The other step never runs the node.
+  batcher.StepStarted();
+  batcher.StepStarted();
+  Tensor a = test::AsTensor<float>({1, 2, 3, 4}, TensorShape({2, 2}));
+  Tensor b = test::AsTensor<float>({1, 0, 0, 1}, TensorShape({2, 2}));
+  test::ExpectTensorEqual<float>(Run(&batcher, item, a, b), a);
+  EXPECT_EQ(batcher.num_batches(), 0);
+}
+
+TEST_F(CrossStepBatcherTest, SkipsWindowWithoutOtherSteps) {
+  const NodeItem& item = BuildMatMul(/*transpose_a=*/false);
+  // The test times out if the invocation waits for the window.
+  CrossStepBatcher batcher(gview_, device_.get(), /*window_us=*/3600000000);
+  batcher.StepStarted();
+  Tensor a = test::AsTensor<float>({1, 2, 3, 4}, TensorShape({2, 2}));
+  Tensor b = test::AsTensor<float>({1, 0, 0, 1}, TensorShape({2, 2}));
+  test::ExpectTensorEqual<float>(Run(&batcher, item, a, b), a);
+  EXPECT_EQ(batcher.num_batches(), 0);
+  batcher.StepFinished();
+}
+
+TEST_F(CrossStepBatcherTest, BatchesConcurrentSteps) {
+  constexpr int kNumSteps = 4;
+  const NodeItem& item = BuildMatMul(/*transpose_a=*/false);
+  // The window only ends early when the batch is full.
+  CrossStepBatcher batcher(gview_, device_.get(), /*window_us=*/60000000,
+                           /*max_batch_size=*/kNumSteps);
+  // More steps are running than fit in a batch.
+  for (int i = 0; i < 2 * kNumSteps; ++i) {
+    batcher.StepStarted();
+  }
+  // All steps multiply with the same weights.
+  Tensor b = test::AsTensor<float>({1, 2, 3, 4}, TensorShape({2, 2}));
+  std::vector<Tensor> outputs(kNumSteps);
+  {
+    thread::ThreadPool pool(Env::Default(), "test", kNumSteps);
+    for (int i = 0; i < kNumSteps; ++i) {
+      pool.Schedule([&, i] {
+        // Step i has i + 1 rows.
+        Tensor a(DT_FLOAT, TensorShape({i + 1, 2}));
+        a.flat<float>().setConstant(i);
+        outputs[i] = Run(&batcher, item, a, b);
+      });
+    }
+  }
+  EXPECT_EQ(batcher.num_batches(), 1);
+  for (int i = 0; i < kNumSteps; ++i) {
+    Tensor expected(DT_FLOAT, TensorShape({i + 1, 2}));
+    for (int row = 0; row <= i; ++row) {
+      expected.matrix<float>()(row, 0) = 4 * i;
+      expected.matrix<float>()(row, 1) = 6 * i;
+    }
+    test::ExpectTensorEqual<float>(outputs[i], expected);
+  }
+}
+
+TEST_F(CrossStepBatcherTest, EndsWindowWhenAllStepsJoined) {
+  constexpr int kNumSteps = 3;
+  const NodeItem& item = BuildMatMul(/*transpose_a=*/false);
+  // The batch could hold more steps than are running.
+  CrossStepBatcher batcher(gview_, device_.get(), /*window_us=*/3600000000);
+  for (int i = 0; i < kNumSteps; ++i) {
+    batcher.StepStarted();
+  }
+  Tensor b = test::AsTensor<float>({1, 0, 0, 1}, TensorShape({2, 2}));
+  std::vector<Tensor> outputs(kNumSteps);
+  {
+    thread::ThreadPool pool(Env::Default(), "test", kNumSteps);
+    for (int i = 0; i < kNumSteps; ++i) {
+      pool.Schedule([&, i] {
+        Tensor a(DT_FLOAT, TensorShape({1, 2}));
+        a.flat<float>().setConstant(i);
+        outputs[i] = Run(&batcher, item, a, b);
+      });
+    }
+  }
+  EXPECT_EQ(batcher.num_batches(), 1);
+  for (int i = 0; i < kNumSteps; ++i) {
+    test::ExpectTensorEqual<float>(
+        outputs[i], test::AsTensor<float>({1.0f * i, 1.0f * i}, {1, 2}));
+  }
+}
+
+TEST_F(CrossStepBatcherTest, CancelledStepFailsAlone) {
+  constexpr int kNumSteps = 2;
+  const NodeItem& item = BuildMatMul(/*transpose_a=*/false);
+  CrossStepBatcher batcher(gview_, device_.get(), /*window_us=*/3600000000);
+  for (int i = 0; i < kNumSteps; ++i) {
+    batcher.StepStarted();
+  }
+  // Only step 0 is cancelled.
+  CancellationManager cancelled;
+  cancelled.StartCancel();
+  CancellationManager running;
+  CancellationManager* cancellation_managers[kNumSteps] = {&cancelled,
+                                                           &running};
+  Tensor b = test::AsTensor<float>({1, 0, 0, 1}, TensorShape({2, 2}));
+  std::vector<absl::Status> statuses(kNumSteps);
+  std::vector<Tensor> outputs(kNumSteps);
+  {
+    thread::ThreadPool pool(Env::Default(), "test", kNumSteps);
+    for (int i = 0; i < kNumSteps; ++i) {
+      pool.Schedule([&, i] {
+        Tensor a(DT_FLOAT, TensorShape({1, 2}));
+        a.flat<float>().setConstant(i);
+        statuses[i] = Run(&batcher, item, a, b, cancellation_managers[i],
+                          &outputs[i]);
+      });
+    }
+  }
+  EXPECT_EQ(batcher.num_batches(), 1);
+  EXPECT_TRUE(absl::IsCancelled(statuses[0])) << statuses[0];
+  TF_EXPECT_OK(statuses[1]);
+  test::ExpectTensorEqual<float>(outputs[1],
+                                 test::AsTensor<float>({1.0f, 1.0f}, {1, 2}));
+}
+
+}  // namespace
+}  // namespace tensorflow
@@ -63,9 +63,11 @@ limitations under the License.
 #include "tensorflow/core/lib/core/threadpool.h"
 #include "tensorflow/core/lib/core/threadpool_options.h"
 #include "tensorflow/core/lib/gtl/array_slice.h"
+#include "tensorflow/core/lib/hash/hash.h"
 #include "tensorflow/core/lib/monitoring/counter.h"
 #include "tensorflow/core/lib/random/random.h"
 #include "tensorflow/core/lib/strings/numbers.h"
+#include "tensorflow/core/lib/strings/proto_serialization.h"
 #include "tensorflow/core/lib/strings/str_util.h"
 #include "tensorflow/core/lib/strings/strcat.h"
 #include "tensorflow/core/nccl/collective_communicator.h"
@@ -385,6 +387,11 @@ DirectSession::DirectSession(const SessionOptions& options,
     device_set_.AddDevice(d);
     d->op_segment()->AddHold(session_handle_);
   }
+  const string& graph_cache_dir =
+      options_.config.experimental().executor_graph_cache_dir();
+  if (!graph_cache_dir.empty()) {
+    graph_cache_ = std::make_unique<ExecutorGraphCache>(graph_cache_dir);
+  }
 }
 
 DirectSession::~DirectSession() {
@@ -440,21 +447,21 @@ absl::Status DirectSession::ExtendLocked(GraphDef&& graph) {
   if (finalized_) {
     return errors::FailedPrecondition("Session has been finalized.");
   }
+  if (graph_cache_) {
+    graph_fingerprint_ =
+        Hash64Combine(graph_fingerprint_, DeterministicProtoHash64(graph));
+  }
+  if (graph_cache_ && !graph_created_) {
+    // The execution state is only built when a callable misses the cache.
+    deferred_graph_def_ = std::make_unique<GraphDef>(std::move(graph));
+    graph_created_ = true;
+    return absl::OkStatus();
+  }
+  TF_RETURN_IF_ERROR(MaybeCreateDeferredExecutionState());
   if (!(flib_def_ && execution_state_)) {
     // If this is the first call, we can initialize the execution state
     // with `graph` and do not need to call `Extend()`.
-    GraphExecutionStateOptions options;
-    options.device_set = &device_set_;
-    options.session_options = &options_;
-    options.session_handle = session_handle_;
-    TF_RETURN_IF_ERROR(GraphExecutionState::MakeForBaseGraph(
-        std::move(graph), options, &execution_state_));
-    // NOTE(mrry): The function library created here will be used for
-    // all subsequent extensions of the graph. Also, note how using the copy
-    // constructor of FunctionLibraryDefinition avoids duplicating the memory
-    // that is occupied by its shared_ptr members.
-    flib_def_.reset(
-        new FunctionLibraryDefinition(execution_state_->flib_def()));
+    TF_RETURN_IF_ERROR(CreateExecutionState(std::move(graph)));
     graph_created_ = true;
   } else {
     std::unique_ptr<GraphExecutionState> state;
@@ -467,6 +474,31 @@ absl::Status DirectSession::ExtendLocked(GraphDef&& graph) {
   return absl::OkStatus();
 }
 
+absl::Status DirectSession::MaybeCreateDeferredExecutionState() {
+  if (!deferred_graph_def_) {
+    return deferred_graph_status_;
+  }
+  GraphDef graph = std::move(*deferred_graph_def_);
+  deferred_graph_def_.reset();
+  deferred_graph_status_ = CreateExecutionState(std::move(graph));
+  return deferred_graph_status_;
+}
+
+absl::Status DirectSession::CreateExecutionState(GraphDef&& graph) {
+  GraphExecutionStateOptions options;
+  options.device_set = &device_set_;
+  options.session_options = &options_;
+  options.session_handle = session_handle_;
+  TF_RETURN_IF_ERROR(GraphExecutionState::MakeForBaseGraph(
+      std::move(graph), options, &execution_state_));
+  // NOTE(mrry): The function library created here will be used for
+  // all subsequent extensions of the graph. Also, note how using the copy
+  // constructor of FunctionLibraryDefinition avoids duplicating the memory
+  // that is occupied by its shared_ptr members.
+  flib_def_.reset(new FunctionLibraryDefinition(execution_state_->flib_def()));
+  return absl::OkStatus();
+}
+
 absl::Status DirectSession::Run(const NamedTensorList& inputs,
                                 const std::vector<string>& output_names,
                                 const std::vector<string>& target_nodes,
@@ -736,7 +768,8 @@ absl::Status DirectSession::RunInternal(
       };
 
   if (can_execute_synchronously) {
-    PrivateIntraProcessRendezvous rendezvous(device_mgr_.get());
+    PrivateIntraProcessRendezvous rendezvous(
+        device_mgr_.get(), executors_and_keys->num_rendezvous_slots);
     args.rendezvous = &rendezvous;
 
     const auto& item = executors_and_keys->items[0];
@@ -744,7 +777,8 @@ absl::Status DirectSession::RunInternal(
     run_status = item.executor->Run(args);
   } else {
     core::RefCountPtr<RefCountedIntraProcessRendezvous> rendezvous(
-        new RefCountedIntraProcessRendezvous(device_mgr_.get()));
+        new RefCountedIntraProcessRendezvous(
+            device_mgr_.get(), executors_and_keys->num_rendezvous_slots));
     args.rendezvous = rendezvous.get();
 
     // `barrier` will delete itself after the final executor finishes.
@@ -985,7 +1019,8 @@ absl::Status DirectSession::PRunSetup(const std::vector<string>& input_names,
   args.step_id = step_id_counter_.fetch_add(1);
   PartialRunState* run_state =
       new PartialRunState(input_names, output_names, args.step_id, &devices_);
-  run_state->rendez.reset(new IntraProcessRendezvous(device_mgr_.get()));
+  run_state->rendez.reset(new IntraProcessRendezvous(
+      device_mgr_.get(), executors_and_keys->num_rendezvous_slots));
   {
     mutex_lock l(executor_lock_);
     if (!partial_runs_
@@ -1399,6 +1434,12 @@ absl::Status DirectSession::CreateExecutors(
     params.device = device;
     params.session_metadata = session_metadata;
     params.function_library = lib;
+    params.use_static_memory_plan =
+        options_.config.experimental().use_static_memory_planning();
+    params.plan_input_forwarding =
+        options_.config.experimental().plan_input_forwarding();
+    params.cross_step_batching_window_us =
+        options_.config.experimental().cross_step_batching_window_us();
     auto opseg = device->op_segment();
     params.create_kernel =
         [this, lib, opseg](const std::shared_ptr<const NodeProperties>& props,
@@ -1439,6 +1480,19 @@ absl::Status DirectSession::CreateExecutors(
                                          device->name(),
                                          partition_graph.get()));
 
+    // The slots are read from the partition graph rather than counted in
+    // CreateGraphs(), which may load the partition graphs from the cache.
+    if (options_.config.experimental().use_rendezvous_slots()) {
+      for (const Node* n : partition_graph->op_nodes()) {
+        int64_t slot;
+        if ((n->IsSend() || n->IsRecv()) &&
+            TryGetNodeAttr(n->attrs(), "_rendezvous_slot", &slot)) {
+          ek->num_rendezvous_slots =
+              std::max(ek->num_rendezvous_slots, slot + 1);
+        }
+      }
+    }
+
     item->executor = nullptr;
     item->device = device;
     auto executor_type = options_.config.experimental().executor_type();
@@ -1613,6 +1667,31 @@ absl::Status DirectSession::CreateGraphs(
     return errors::FailedPrecondition("Session has been finalized.");
   }
 
+  // Partial runs need the full graph, so they do not use the cache.
+  const bool use_graph_cache =
+      graph_cache_ != nullptr && !run_state_args->is_partial_run;
+  uint64 graph_cache_key = 0;
+  ExecutorGraphCacheEntry cache_entry;
+  if (use_graph_cache) {
+    graph_cache_key = ExecutorGraphCache::Key(
+        graph_fingerprint_, options_.config, subgraph_options, devices_);
+    absl::Status s = graph_cache_->Lookup(graph_cache_key, &cache_entry);
+    if (s.ok()) {
+      metrics::RecordExecutorGraphCacheLookup("hit");
+      return CreateGraphsFromCache(std::move(cache_entry), outputs, flib_def,
+                                   input_types, output_types,
+                                   collective_graph_key);
+    }
+    if (absl::IsNotFound(s)) {
+      metrics::RecordExecutorGraphCacheLookup("miss");
+      VLOG(1) << s;
+    } else {
+      metrics::RecordExecutorGraphCacheLookup("invalid");
+      LOG(WARNING) << "Ignoring executor graph cache entry: " << s;
+    }
+  }
+  TF_RETURN_IF_ERROR(MaybeCreateDeferredExecutionState());
+
   std::unique_ptr<ClientGraph> client_graph;
 
   std::unique_ptr<GraphExecutionState> temp_exec_state_holder;
@@ -1695,10 +1774,95 @@ absl::Status DirectSession::CreateGraphs(
   };
   popts.flib_def = flib_def->get();
   popts.control_flow_added = false;
+  popts.use_rendezvous_slots =
+      options_.config.experimental().use_rendezvous_slots();
 
   std::unordered_map<string, GraphDef> partitions;
   TF_RETURN_IF_ERROR(Partition(popts, &client_graph->graph, &partitions));
 
+  if (use_graph_cache) {
+    for (const auto& partition : partitions) {
+      (*cache_entry.mutable_partition_graphs())[partition.first] =
+          partition.second;
+    }
+    *cache_entry.mutable_library() = client_graph->flib_def->ToProto();
+    for (DataType dtype : client_graph->feed_types) {
+      cache_entry.add_feed_types(dtype);
+    }
+    for (DataType dtype : client_graph->fetch_types) {
+      cache_entry.add_fetch_types(dtype);
+    }
+    cache_entry.set_collective_graph_key(client_graph->collective_graph_key);
+    cache_entry.mutable_stateful_placements()->insert(
+        stateful_placements_.begin(), stateful_placements_.end());
+    cache_entry.set_edge_name_counter(edge_name_counter_.load());
+    absl::Status s = graph_cache_->Insert(graph_cache_key, &cache_entry);
+    if (!s.ok()) {
+      LOG(WARNING) << "Failed to store executor graph cache entry: " << s;
+    }
+  }
+
+  std::swap(*input_types, client_graph->feed_types);
+  std::swap(*output_types, client_graph->fetch_types);
+  return CreateGraphsFromPartitions(std::move(partitions),
+                                    std::move(client_graph->flib_def), outputs,
+                                    flib_def);
+}
+
+absl::Status DirectSession::CreateGraphsFromCache(
+    ExecutorGraphCacheEntry cache_entry,
+    std::unordered_map<string, std::unique_ptr<Graph>>* outputs,
+    std::unique_ptr<FunctionLibraryDefinition>* flib_def,
+    DataTypeVector* input_types, DataTypeVector* output_types,
+    int64_t* collective_graph_key) {
+  VLOG(1) << "Using executor graph cache entry "
+          << graph_cache_->Filename(cache_entry.key());
+  for (const auto& placement_pair : cache_entry.stateful_placements()) {
+    auto iter = stateful_placements_.find(placement_pair.first);
+    if (iter == stateful_placements_.end()) {
+      stateful_placements_.insert(placement_pair);
+    } else if (iter->second != placement_pair.second) {
+      return errors::Internal(
+          "Stateful placement mismatch. "
+          "Current assignment of ",
+          placement_pair.first, " to ", iter->second, " does not match ",
+          placement_pair.second, " in the executor graph cache");
+    }
+  }
+
+  // The Send/Recv edges of the cached partitions are named by the counter of
+  // the session which stored them, so continue after its last value.
+  int64_t edge_name_counter = edge_name_counter_.load();
+  while (edge_name_counter < cache_entry.edge_name_counter() &&
+         !edge_name_counter_.compare_exchange_weak(
+             edge_name_counter, cache_entry.edge_name_counter())) {
+  }
+
+  std::unordered_map<string, GraphDef> partitions;
+  for (auto& partition : *cache_entry.mutable_partition_graphs()) {
+    partitions[partition.first].Swap(&partition.second);
+  }
+  auto client_flib_def = std::make_unique<FunctionLibraryDefinition>(
+      OpRegistry::Global(), cache_entry.library());
+  input_types->clear();
+  for (int dtype : cache_entry.feed_types()) {
+    input_types->push_back(static_cast<DataType>(dtype));
+  }
+  output_types->clear();
+  for (int dtype : cache_entry.fetch_types()) {
+    output_types->push_back(static_cast<DataType>(dtype));
+  }
+  *collective_graph_key = cache_entry.collective_graph_key();
+  return CreateGraphsFromPartitions(std::move(partitions),
+                                    std::move(client_flib_def), outputs,
+                                    flib_def);
+}
+
+absl::Status DirectSession::CreateGraphsFromPartitions(
+    std::unordered_map<string, GraphDef> partitions,
+    std::unique_ptr<FunctionLibraryDefinition> client_flib_def,
+    std::unordered_map<string, std::unique_ptr<Graph>>* outputs,
+    std::unique_ptr<FunctionLibraryDefinition>* flib_def) {
   std::vector<string> device_names;
   device_names.reserve(devices_.size());
   for (auto device : devices_) {
@@ -1721,8 +1885,7 @@ absl::Status DirectSession::CreateGraphs(
   }
 
   for (auto& partition : partitions) {
-    std::unique_ptr<Graph> device_graph(
-        new Graph(client_graph->flib_def.get()));
+    std::unique_ptr<Graph> device_graph(new Graph(client_flib_def.get()));
     device_graph->SetConstructionContext(ConstructionContext::kDirectSession);
     GraphConstructorOptions device_opts;
     // There are internal operations (e.g., send/recv) that we now allow.
@@ -1735,7 +1898,7 @@ absl::Status DirectSession::CreateGraphs(
 
   GraphOptimizationPassOptions optimization_options;
   optimization_options.session_options = &options_;
-  optimization_options.flib_def = client_graph->flib_def.get();
+  optimization_options.flib_def = client_flib_def.get();
   optimization_options.partition_graphs = outputs;
   TF_RETURN_IF_ERROR(OptimizationPassRegistry::Global()->RunGrouping(
       OptimizationPassRegistry::POST_PARTITIONING, optimization_options));
@@ -1757,9 +1920,7 @@ absl::Status DirectSession::CreateGraphs(
       break;
     }
   }
-  *flib_def = std::move(client_graph->flib_def);
-  std::swap(*input_types, client_graph->feed_types);
-  std::swap(*output_types, client_graph->fetch_types);
+  *flib_def = std::move(client_flib_def);
   return s;
 }
 
@@ -2049,6 +2210,7 @@ absl::Status DirectSession::Finalize() {
     return errors::FailedPrecondition("Session not yet created.");
   }
   execution_state_.reset();
+  deferred_graph_def_.reset();
   flib_def_.reset();
   finalized_ = true;
   return absl::OkStatus();
@@ -28,6 +28,7 @@ limitations under the License.
 #include "tensorflow/core/common_runtime/device_mgr.h"
 #include "tensorflow/core/common_runtime/device_set.h"
 #include "tensorflow/core/common_runtime/executor.h"
+#include "tensorflow/core/common_runtime/executor_graph_cache.h"
 #include "tensorflow/core/common_runtime/graph_execution_state.h"
 #include "tensorflow/core/common_runtime/process_function_library_runtime.h"
 #include "tensorflow/core/common_runtime/rendezvous_mgr.h"
@@ -175,6 +176,10 @@ class DirectSession : public Session {
     CallableOptions callable_options;
 
     int64_t collective_graph_key = BuildGraphOptions::kNoCollectiveGraphKey;
+
+    // The size of the slot table of the per-step rendezvous, i.e. one more
+    // than the largest "_rendezvous_slot" of the Send/Recv nodes.
+    int64_t num_rendezvous_slots = 0;
   };
 
   // A FunctionInfo object is created for every unique set of feeds/fetches.
@@ -263,6 +268,25 @@ class DirectSession : public Session {
       RunStateArgs* run_state_args, DataTypeVector* input_types,
       DataTypeVector* output_types, int64_t* collective_graph_key);
 
+  // Same as CreateGraphs(), but with the partition graphs stored in the
+  // executor graph cache.
+  absl::Status CreateGraphsFromCache(
+      ExecutorGraphCacheEntry cache_entry,
+      std::unordered_map<string, std::unique_ptr<Graph>>* outputs,
+      std::unique_ptr<FunctionLibraryDefinition>* flib_def,
+      DataTypeVector* input_types, DataTypeVector* output_types,
+      int64_t* collective_graph_key)
+      TF_EXCLUSIVE_LOCKS_REQUIRED(graph_state_lock_);
+
+  // Converts the partition graphs to `*outputs` and runs the post-partitioning
+  // passes on them. `client_flib_def` is the function library of the
+  // partitions, and is moved to `*flib_def`.
+  absl::Status CreateGraphsFromPartitions(
+      std::unordered_map<string, GraphDef> partitions,
+      std::unique_ptr<FunctionLibraryDefinition> client_flib_def,
+      std::unordered_map<string, std::unique_ptr<Graph>>* outputs,
+      std::unique_ptr<FunctionLibraryDefinition>* flib_def);
+
   absl::Status RunInternal(int64_t step_id, const RunOptions& run_options,
                            CallFrameInterface* call_frame,
                            ExecutorsAndKeys* executors_and_keys,
@@ -277,6 +301,16 @@ class DirectSession : public Session {
   absl::Status ExtendLocked(GraphDef&& graph)
       TF_EXCLUSIVE_LOCKS_REQUIRED(graph_state_lock_);
 
+  // Builds `execution_state_` and `flib_def_` from the graph which creates
+  // the session.
+  absl::Status CreateExecutionState(GraphDef&& graph)
+      TF_EXCLUSIVE_LOCKS_REQUIRED(graph_state_lock_);
+
+  // Calls `CreateExecutionState()` for `deferred_graph_def_`, if it is set.
+  // Returns the error of that call on later calls if it failed.
+  absl::Status MaybeCreateDeferredExecutionState()
+      TF_EXCLUSIVE_LOCKS_REQUIRED(graph_state_lock_);
+
   absl::Status ResourceHandleToInputTensor(const Tensor& resource_tensor,
                                            Tensor* retrieved_tensor);
 
@@ -398,6 +432,22 @@ class DirectSession : public Session {
   std::unique_ptr<GraphExecutionState> execution_state_
       TF_GUARDED_BY(graph_state_lock_);
 
+  // If `graph_cache_` is set, the graph which created the session until a
+  // callable misses the cache. Building `execution_state_` places the full
+  // graph unless `place_pruned_graph` is set, which sessions whose callables
+  // all hit the cache do not need.
+  std::unique_ptr<GraphDef> deferred_graph_def_
+      TF_GUARDED_BY(graph_state_lock_);
+  absl::Status deferred_graph_status_ TF_GUARDED_BY(graph_state_lock_);
+
+  // The cache of partition graphs, or null if
+  // `ConfigProto.Experimental.executor_graph_cache_dir` is not set.
+  std::unique_ptr<ExecutorGraphCache> graph_cache_;
+
+  // The fingerprint of the GraphDefs which created and extended the graph,
+  // if `graph_cache_` is set.
+  uint64 graph_fingerprint_ TF_GUARDED_BY(graph_state_lock_) = 0;
+
   // The function library, before any rewrites or optimizations have been
   // performed. In particular, CreateGraphs() may need to modify the function
   // library; it copies and modifies the function library.
@@ -46,7 +46,10 @@ limitations under the License.
 #include "tensorflow/core/lib/core/status.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
 #include "tensorflow/core/lib/core/threadpool.h"
+#include "tensorflow/core/lib/io/path.h"
+#include "tensorflow/core/lib/monitoring/cell_reader.h"
 #include "tensorflow/core/lib/strings/str_util.h"
+#include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/protobuf.h"
 #include "tensorflow/core/platform/stacktrace.h"
 #include "tensorflow/core/platform/test.h"
@@ -549,6 +552,187 @@ TEST_F(DirectSessionMinusAXTest, TestFeed_Callable) {
   EXPECT_FLOAT_EQ(39.0, mat(1, 0));
 }
 
+TEST_F(DirectSessionMinusAXTest, TestFeed_CallableWithStaticMemoryPlanning) {
+  Initialize({1, 2, 3, 4});
+  SessionOptions options = DefaultSessionOptions();
+  options.config.mutable_experimental()->set_use_static_memory_planning(true);
+  std::unique_ptr<Session> session(NewSession(options));
+  ASSERT_TRUE(session != nullptr);
+  TF_ASSERT_OK(session->Create(def_));
+
+  Session::CallableHandle handle;
+  TF_ASSERT_OK(session->MakeCallable(
+      MakeCallableOptions({x_}, {y_ + ":0", z_ + ":0"}, {}), &handle));
+
+  // The first steps calibrate the plan, and later steps use planned memory.
+  for (int i = 0; i < 10; ++i) {
+    Tensor t(DT_FLOAT, TensorShape({2, 1}));
+    test::FillValues<float>(&t, {static_cast<float>(i), 1});
+    std::vector<Tensor> outputs;
+    TF_ASSERT_OK(session->RunCallable(handle, {t}, &outputs, nullptr));
+    ASSERT_EQ(2, outputs.size());
+    test::ExpectTensorEqual<float>(
+        outputs[0], test::AsTensor<float>({1.0f * i + 2, 3.0f * i + 4},
+                                          TensorShape({2, 1})));
+    test::ExpectTensorEqual<float>(
+        outputs[1], test::AsTensor<float>({-1.0f * i - 2, -3.0f * i - 4},
+                                          TensorShape({2, 1})));
+  }
+  TF_ASSERT_OK(session->ReleaseCallable(handle));
+}
+
+TEST_F(DirectSessionMinusAXTest, TestFeed_CallableWithRendezvousSlots) {
+  Initialize({1, 2, 3, 4});
+  SessionOptions options = DefaultSessionOptions();
+  options.config.mutable_experimental()->set_use_rendezvous_slots(true);
+  std::unique_ptr<Session> session(NewSession(options));
+  ASSERT_TRUE(session != nullptr);
+  TF_ASSERT_OK(session->Create(def_));
+
+  Session::CallableHandle handle;
+  TF_ASSERT_OK(session->MakeCallable(
+      MakeCallableOptions({x_}, {y_ + ":0", z_ + ":0"}, {}), &handle));
+
+  // x and y cross between cpu:0 and cpu:1 through rendezvous slots.
+  for (int i = 0; i < 3; ++i) {
+    Tensor t(DT_FLOAT, TensorShape({2, 1}));
+    test::FillValues<float>(&t, {static_cast<float>(i), 1});
+    std::vector<Tensor> outputs;
+    TF_ASSERT_OK(session->RunCallable(handle, {t}, &outputs, nullptr));
+    ASSERT_EQ(2, outputs.size());
+    test::ExpectTensorEqual<float>(
+        outputs[0], test::AsTensor<float>({1.0f * i + 2, 3.0f * i + 4},
+                                          TensorShape({2, 1})));
+    test::ExpectTensorEqual<float>(
+        outputs[1], test::AsTensor<float>({-1.0f * i - 2, -3.0f * i - 4},
+                                          TensorShape({2, 1})));
+  }
+  TF_ASSERT_OK(session->ReleaseCallable(handle));
+}
+
+TEST_F(DirectSessionMinusAXTest, TestFeed_CallableWithExecutorGraphCache) {
+  monitoring::testing::CellReader<int64_t> lookups(
+      "/tensorflow/core/executor_graph_cache_lookups");
+  Initialize({1, 2, 3, 4});
+  const string cache_dir =
+      io::JoinPath(testing::TmpDir(), "executor_graph_cache_test");
+  int64_t undeleted_files, undeleted_dirs;
+  Env::Default()
+      ->DeleteRecursively(cache_dir, &undeleted_files, &undeleted_dirs)
+      .IgnoreError();
+  SessionOptions options = DefaultSessionOptions();
+  options.config.mutable_experimental()->set_executor_graph_cache_dir(
+      cache_dir);
+  const CallableOptions callable_options =
+      MakeCallableOptions({x_}, {y_ + ":0"}, {});
+
+  auto run_session = [&](float value) {
+    std::unique_ptr<Session> session(NewSession(options));
+    ASSERT_TRUE(session != nullptr);
+    TF_ASSERT_OK(session->Create(def_));
+    Session::CallableHandle handle;
+    TF_ASSERT_OK(session->MakeCallable(callable_options, &handle));
+
+    Tensor t(DT_FLOAT, TensorShape({2, 1}));
+    test::FillValues<float>(&t, {value, 1});
+    std::vector<Tensor> outputs;
+    TF_ASSERT_OK(session->RunCallable(handle, {t}, &outputs, nullptr));
+    ASSERT_EQ(1, outputs.size());
+    test::ExpectTensorEqual<float>(
+        outputs[0], test::AsTensor<float>({1.0f * value + 2, 3.0f * value + 4},
+                                          TensorShape({2, 1})));
+    TF_ASSERT_OK(session->ReleaseCallable(handle));
+  };
+
+  // The first session builds its partition graphs and stores them in the
+  // cache.
+  run_session(0);
+  EXPECT_EQ(lookups.Delta("miss"), 1);
+  EXPECT_EQ(lookups.Delta("hit"), 0);
+  std::vector<string> cache_files;
+  TF_ASSERT_OK(Env::Default()->GetChildren(cache_dir, &cache_files));
+  ASSERT_EQ(cache_files.size(), 1);
+  const string cache_file = io::JoinPath(cache_dir, cache_files[0]);
+
+  // The second session loads them instead of building them.
+  run_session(1);
+  EXPECT_EQ(lookups.Delta("hit"), 1);
+  EXPECT_EQ(lookups.Delta("miss"), 0);
+
+  // A corrupted entry is ignored, and the session builds the graphs again and
+  // replaces the entry.
+  TF_ASSERT_OK(WriteStringToFile(Env::Default(), cache_file, "corrupted"));
+  run_session(2);
+  EXPECT_EQ(lookups.Delta("invalid"), 1);
+  EXPECT_EQ(lookups.Delta("hit"), 0);
+
+  run_session(3);
+  EXPECT_EQ(lookups.Delta("hit"), 1);
+  EXPECT_EQ(lookups.Delta("invalid"), 0);
+  std::vector<string> files;
+  TF_ASSERT_OK(Env::Default()->GetChildren(cache_dir, &files));
+  EXPECT_EQ(files, cache_files);
+}
+
+TEST_F(DirectSessionMinusAXTest, ExecutorGraphCacheDefersPlacement) {
+  Initialize({1, 2, 3, 4});
+  const string cache_dir =
+      io::JoinPath(testing::TmpDir(), "executor_graph_cache_defer_test");
+  int64_t undeleted_files, undeleted_dirs;
+  Env::Default()
+      ->DeleteRecursively(cache_dir, &undeleted_files, &undeleted_dirs)
+      .IgnoreError();
+  SessionOptions options = DefaultSessionOptions();
+  options.config.mutable_experimental()->set_executor_graph_cache_dir(
+      cache_dir);
+  const CallableOptions callable_options =
+      MakeCallableOptions({x_}, {y_ + ":0"}, {});
+
+  // A node on a device which does not exist fails the placement of the full
+  // graph, which a session with the cache only does for a callable that
+  // misses the cache.
+  GraphDef bad_def = def_;
+  NodeDef* bad_node = bad_def.add_node();
+  *bad_node = def_.node(0);
+  bad_node->set_name("on_missing_device");
+  bad_node->set_device("/job:localhost/replica:0/task:0/cpu:7");
+  {
+    std::unique_ptr<Session> session(NewSession(DefaultSessionOptions()));
+    EXPECT_FALSE(session->Create(bad_def).ok());
+  }
+  {
+    std::unique_ptr<Session> session(NewSession(options));
+    TF_ASSERT_OK(session->Create(bad_def));
+    Session::CallableHandle handle;
+    EXPECT_FALSE(session->MakeCallable(callable_options, &handle).ok());
+    // The error is reported again instead of building the graph without
+    // the first GraphDef.
+    EXPECT_FALSE(session->MakeCallable(callable_options, &handle).ok());
+  }
+
+  // Extending the graph builds the execution state of the created graph
+  // first.
+  GraphDef extension;
+  *extension.add_node() = def_.node(0);
+  extension.mutable_node(0)->set_name("extension");
+  std::unique_ptr<Session> session(NewSession(options));
+  TF_ASSERT_OK(session->Create(def_));
+  TF_ASSERT_OK(session->Extend(extension));
+  Session::CallableHandle handle;
+  TF_ASSERT_OK(session->MakeCallable(
+      MakeCallableOptions({x_}, {y_ + ":0", "extension:0"}, {}), &handle));
+  Tensor t(DT_FLOAT, TensorShape({2, 1}));
+  test::FillValues<float>(&t, {1, 1});
+  std::vector<Tensor> outputs;
+  TF_ASSERT_OK(session->RunCallable(handle, {t}, &outputs, nullptr));
+  ASSERT_EQ(2, outputs.size());
+  test::ExpectTensorEqual<float>(
+      outputs[0], test::AsTensor<float>({3, 7}, TensorShape({2, 1})));
+  test::ExpectTensorEqual<float>(
+      outputs[1], test::AsTensor<float>({1, 2, 3, 4}, TensorShape({2, 2})));
+  TF_ASSERT_OK(session->ReleaseCallable(handle));
+}
+
 TEST_F(DirectSessionMinusAXTest, TestConcurrency) {
   Initialize({1, 2, 3, 4});
   auto session = CreateSession();
@@ -2806,6 +2990,73 @@ BENCHMARK(BM_FeedFetchCallableSingleThreadExecutor)
     ->Arg(5)
     ->Arg(10);
 
+// Measures the time to create a session and run the first step of a callable
+// over a chain of `num_nodes` nodes, without the executor graph cache
+// (cold) or with a cache entry stored by an earlier session (warm). The third
+// argument is `GraphOptions.place_pruned_graph`; by default, a cold session
+// places its full graph before pruning it.
+void BM_SessionCreation(::testing::benchmark::State& state) {
+  const int num_nodes = state.range(0);
+  const bool use_cache = state.range(1);
+  const bool place_pruned_graph = state.range(2);
+
+  Graph g(OpRegistry::Global());
+  Tensor value(DT_FLOAT, TensorShape({16}));
+  value.flat<float>().setConstant(1.0f);
+  Node* placeholder;
+  TF_CHECK_OK(NodeBuilder(g.NewName("Placeholder"), "Placeholder")
+                  .Attr("shape", TensorShape({16}))
+                  .Attr("dtype", DT_FLOAT)
+                  .Device("/cpu:0")
+                  .Finalize(&g, &placeholder));
+  Node* node = placeholder;
+  for (int i = 0; i < num_nodes; ++i) {
+    node = test::graph::Unary(&g, "Neg", node);
+    node->set_requested_device("/cpu:0");
+  }
+  GraphDef gd;
+  g.ToGraphDef(&gd);
+
+  SessionOptions opts;
+  opts.config.mutable_graph_options()->set_place_pruned_graph(
+      place_pruned_graph);
+  if (use_cache) {
+    opts.config.mutable_experimental()->set_executor_graph_cache_dir(
+        io::JoinPath(testing::TmpDir(),
+                     strings::StrCat("executor_graph_cache_bm_", num_nodes)));
+  }
+  CallableOptions callable_options;
+  callable_options.add_feed(placeholder->name() + ":0");
+  callable_options.add_fetch(node->name() + ":0");
+  auto create_session_and_run = [&]() {
+    std::unique_ptr<Session> session(NewSession(opts));
+    TF_CHECK_OK(session->Create(gd));
+    Session::CallableHandle handle;
+    TF_CHECK_OK(session->MakeCallable(callable_options, &handle));
+    std::vector<Tensor> outputs;
+    TF_CHECK_OK(session->RunCallable(handle, {value}, &outputs, nullptr));
+    TF_CHECK_OK(session->Close());
+  };
+
+  if (use_cache) {
+    // Store the cache entry.
+    create_session_and_run();
+  }
+  for (auto s : state) {
+    create_session_and_run();
+  }
+}
+
+BENCHMARK(BM_SessionCreation)
+    ->Args({1000, false, false})
+    ->Args({1000, true, false})
+    ->Args({1000, false, true})
+    ->Args({1000, true, true})
+    ->Args({10000, false, false})
+    ->Args({10000, true, false})
+    ->Args({10000, false, true})
+    ->Args({10000, true, true});
+
 }  // namespace
 
 class DirectSessionCollectiveTest : public ::testing::Test {
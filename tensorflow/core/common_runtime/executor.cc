@@ -17,7 +17,9 @@ limitations under the License.
 
 #include <algorithm>
 #include <atomic>
+#include <cstdint>
 #include <memory>
+#include <type_traits>
 #include <utility>
 #include <vector>
 
@@ -27,14 +29,17 @@ limitations under the License.
 #include "absl/types/optional.h"
 #include "tensorflow/core/activity_watcher/activity.h"
 #include "tensorflow/core/common_runtime/costmodel_manager.h"
+#include "tensorflow/core/common_runtime/cross_step_batcher.h"
 #include "tensorflow/core/common_runtime/entry.h"
 #include "tensorflow/core/common_runtime/executor_factory.h"
 #include "tensorflow/core/common_runtime/graph_view.h"
 #include "tensorflow/core/common_runtime/immutable_executor_state.h"
+#include "tensorflow/core/common_runtime/op_latency_histograms.h"
 #include "tensorflow/core/common_runtime/pending_counts.h"
 #include "tensorflow/core/common_runtime/propagator_state.h"
 #include "tensorflow/core/common_runtime/renamed_device.h"
 #include "tensorflow/core/common_runtime/simple_propagator_state.h"
+#include "tensorflow/core/common_runtime/static_memory_planner.h"
 #include "tensorflow/core/common_runtime/step_stats_collector.h"
 #include "tensorflow/core/framework/allocator.h"
 #include "tensorflow/core/framework/cancellation.h"
@@ -46,6 +51,7 @@ limitations under the License.
 #include "tensorflow/core/framework/node_def_util.h"
 #include "tensorflow/core/framework/op_kernel.h"
 #include "tensorflow/core/framework/op_segment.h"
+#include "tensorflow/core/framework/step_arena_allocator.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/framework/tensor_reference.h"
 #include "tensorflow/core/framework/types.h"
@@ -79,6 +85,7 @@ limitations under the License.
 #include "tensorflow/core/profiler/lib/traceme_encode.h"
 #include "tensorflow/core/protobuf/error_codes.pb.h"
 #include "tensorflow/core/util/determinism.h"
+#include "tensorflow/core/util/env_var.h"
 #include "tensorflow/core/util/managed_stack_trace.h"
 #include "tensorflow/core/util/tensor_slice_reader_cache.h"
 #include "tsl/platform/tracing.h"
@@ -132,7 +139,8 @@ void SetMemory(NodeExecStatsInterface* stats, OpKernelContext* ctx) {
 }  // namespace nodestats
 
 // Time the execution of kernels (in CPU cycles).  Used to dynamically identify
-// inexpensive kernels which can be dispatched inline.
+// inexpensive kernels which can be dispatched inline, and to record the
+// latencies of kernels.
 struct KernelTimer {
   uint64 start_cycles = profile_utils::CpuUtils::GetCurrentClockCycle();
 
@@ -145,13 +153,81 @@ struct KernelTimer {
 typedef absl::InlinedVector<TensorValue, 4UL> TensorValueVec;
 typedef absl::InlinedVector<AllocatorAttributes, 4UL> AllocatorAttributeVec;
 
+// Returns true if nodes should be scheduled in the order of their
+// critical-path priority, either because `params` asks for it or because the
+// environment variable TF_EXECUTOR_CRITICAL_PATH_SCHEDULING is set.
+bool CriticalPathSchedulingEnabled(const LocalExecutorParams& params) {
+  static const bool kEnabledByEnv = [] {
+    bool enabled = false;
+    absl::Status status =
+        ReadBoolFromEnvVar("TF_EXECUTOR_CRITICAL_PATH_SCHEDULING",
+                           /*default_val=*/false, &enabled);
+    if (!status.ok()) {
+      LOG(WARNING) << "Ignoring TF_EXECUTOR_CRITICAL_PATH_SCHEDULING: "
+                   << status.message();
+      return false;
+    }
+    return enabled;
+  }();
+  return params.critical_path_scheduling || kEnabledByEnv;
+}
+
+// Returns true if the latencies of kernels should be recorded in
+// `OpLatencyHistograms`, either because `params` asks for it or because the
+// environment variable TF_EXECUTOR_OP_LATENCY_HISTOGRAMS is set.
+bool OpLatencyRecordingEnabled(const LocalExecutorParams& params) {
+  static const bool kEnabledByEnv = [] {
+    bool enabled = false;
+    absl::Status status =
+        ReadBoolFromEnvVar("TF_EXECUTOR_OP_LATENCY_HISTOGRAMS",
+                           /*default_val=*/false, &enabled);
+    if (!status.ok()) {
+      LOG(WARNING) << "Ignoring TF_EXECUTOR_OP_LATENCY_HISTOGRAMS: "
+                   << status.message();
+      return false;
+    }
+    return enabled;
+  }();
+  return params.record_op_latency || kEnabledByEnv;
+}
+
+// Calls `fn(dst_id)` for the destination of every output edge of `item`,
+// ignoring the back edges of NextIteration nodes.
+template <typename Fn>
+void ForEachSuccessor(const NodeItem& item, Fn fn) {
+  if (item.is_next_iteration) return;
+  for (const EdgeInfo& e : item.output_edges()) {
+    fn(e.dst_id);
+  }
+  for (const ControlEdgeInfo& e : item.output_control_edges()) {
+    fn(e.dst_id);
+  }
+}
+
 class ExecutorImpl : public Executor {
  public:
   explicit ExecutorImpl(const LocalExecutorParams& p) : immutable_state_(p) {}
 
   absl::Status Initialize(const Graph& graph) {
     TF_RETURN_IF_ERROR(immutable_state_.Initialize(graph));
-    kernel_stats_.Initialize(immutable_state_.graph_view());
+    kernel_stats_.Initialize(
+        immutable_state_.graph_view(),
+        CriticalPathSchedulingEnabled(immutable_state_.params()),
+        OpLatencyRecordingEnabled(immutable_state_.params()));
+    Device* device = immutable_state_.params().device;
+    if (immutable_state_.params().use_static_memory_plan &&
+        device->device_type() == DEVICE_CPU &&
+        !immutable_state_.requires_control_flow_support()) {
+      memory_planner_ = std::make_unique<StaticMemoryPlanner>(
+          immutable_state_.graph_view(),
+          device->GetAllocator(AllocatorAttributes()));
+    }
+    if (immutable_state_.params().cross_step_batching_window_us > 0 &&
+        device->device_type() == DEVICE_CPU) {
+      cross_step_batcher_ = std::make_unique<CrossStepBatcher>(
+          immutable_state_.graph_view(), device,
+          immutable_state_.params().cross_step_batching_window_us);
+    }
     return absl::OkStatus();
   }
 
@@ -166,7 +242,8 @@ class ExecutorImpl : public Executor {
    public:
     KernelStats() = default;
 
-    void Initialize(const GraphView& gview) {
+    void Initialize(const GraphView& gview, bool critical_path_scheduling,
+                    bool record_op_latency) {
       is_expensive_.resize(gview.num_nodes());
       cost_estimates_ =
           std::make_unique<std::atomic_uint_fast64_t[]>(gview.num_nodes());
@@ -177,6 +254,18 @@ class ExecutorImpl : public Executor {
           cost_estimates_[i] = kInitialCostEstimateCycles;
         }
       }
+      if (critical_path_scheduling) {
+        InitializeCriticalPath(gview);
+      }
+      if (record_op_latency) {
+        op_type_ids_.resize(gview.num_nodes(), -1);
+        for (int32_t i = 0; i < gview.num_nodes(); ++i) {
+          if (gview.node(i) && gview.node(i)->kernel) {
+            op_type_ids_[i] = OpLatencyHistograms::Global()->OpTypeId(
+                gview.node(i)->kernel->type_string_view());
+          }
+        }
+      }
     }
 
     // Returns true iff the given node is considered "expensive". The
@@ -210,26 +299,180 @@ class ExecutorImpl : public Executor {
       cost_estimate.store(new_estimate, std::memory_order_relaxed);
     }
 
+    // Returns true if the latencies of kernels are recorded in
+    // `OpLatencyHistograms`.
+    bool records_op_latency() const { return !op_type_ids_.empty(); }
+
+    // Records the latency of the given node by its op type.
+    void RecordOpLatency(const NodeItem& node, uint64 elapsed_cycles) {
+      OpLatencyHistograms::Global()->Record(op_type_ids_[node.node_id],
+                                            elapsed_cycles);
+    }
+
+    // Returns the critical-path priorities of the nodes, indexed by node id, or
+    // nullptr if critical-path scheduling is disabled. The priority of a node
+    // is the estimated number of cycles on the longest path from the node to
+    // the end of the graph, including the node itself.
+    const std::atomic_int_fast64_t* critical_path_priorities() const {
+      return priorities_.get();
+    }
+
+    // Recomputes the critical-path priorities from the latest cost estimates
+    // once every `kCriticalPathUpdateIntervalSteps` calls. Called once per
+    // step. Like the cost estimates, the priorities are updated without a
+    // lock, and a step may observe a mix of old and new priorities.
+    void MaybeUpdateCriticalPathPriorities() {
+      if (!priorities_) return;
+      if (num_steps_.fetch_add(1, std::memory_order_relaxed) %
+              kCriticalPathUpdateIntervalSteps ==
+          kCriticalPathUpdateIntervalSteps - 1) {
+        UpdateCriticalPathPriorities();
+      }
+    }
+
    private:
+    // Computes a topological order of the nodes in `gview` for updating the
+    // critical-path priorities, and the initial priorities.
+    void InitializeCriticalPath(const GraphView& gview) {
+      const int32_t num_nodes = gview.num_nodes();
+      std::vector<int32_t> num_pending_inputs(num_nodes, 0);
+      for (int32_t i = 0; i < num_nodes; ++i) {
+        if (gview.node(i)) {
+          ForEachSuccessor(*gview.node(i), [&](int32_t dst_id) {
+            ++num_pending_inputs[dst_id];
+          });
+        }
+      }
+      critical_path_order_.reserve(num_nodes);
+      for (int32_t i = 0; i < num_nodes; ++i) {
+        if (gview.node(i) && num_pending_inputs[i] == 0) {
+          critical_path_order_.push_back(gview.node(i));
+        }
+      }
+      for (size_t i = 0; i < critical_path_order_.size(); ++i) {
+        ForEachSuccessor(*critical_path_order_[i], [&](int32_t dst_id) {
+          if (--num_pending_inputs[dst_id] == 0) {
+            critical_path_order_.push_back(gview.node(dst_id));
+          }
+        });
+      }
+      // Successors come before their predecessors.
+      std::reverse(critical_path_order_.begin(), critical_path_order_.end());
+      priorities_ = std::make_unique<std::atomic_int_fast64_t[]>(num_nodes);
+      UpdateCriticalPathPriorities();
+    }
+
+    void UpdateCriticalPathPriorities() {
+      for (const NodeItem* item : critical_path_order_) {
+        int64_t successor_priority = 0;
+        ForEachSuccessor(*item, [&](int32_t dst_id) {
+          successor_priority = std::max<int64_t>(
+              successor_priority,
+              priorities_[dst_id].load(std::memory_order_relaxed));
+        });
+        const int64_t priority = CostEstimate(*item) + successor_priority;
+        priorities_[item->node_id].store(priority, std::memory_order_relaxed);
+      }
+    }
+
+    // Only nodes with an expensive marker have their cost measured. The other
+    // nodes are assumed to be cheap.
+    int64_t CostEstimate(const NodeItem& node) const {
+      if (!is_expensive_[node.node_id]) {
+        return kInexpensiveCostEstimateCycles;
+      }
+      return cost_estimates_[node.node_id].load(std::memory_order_relaxed);
+    }
+
     // Initial time (in CPU cycles) we expect an operation to take.  Used to
     // determine whether an operation should be place in a threadpool.
     // Operations start out "expensive".
     static constexpr uint64 kInitialCostEstimateCycles = 100 * 1000 * 1000;
     static constexpr uint64 kOpIsExpensiveThresholdCycles = 8000;
     static constexpr uint64 kCostDecay = 10;
+    static constexpr int64_t kInexpensiveCostEstimateCycles = 1000;
+    static constexpr int64_t kCriticalPathUpdateIntervalSteps = 100;
 
     std::vector<bool> is_expensive_;
     // std::unique_ptr<std::atomic<bool>[]> is_expensive_;
     std::unique_ptr<std::atomic_uint_fast64_t[]> cost_estimates_;
+    // The ids of the op types of the nodes in `OpLatencyHistograms`, indexed
+    // by node id. Only set if op latencies are recorded.
+    std::vector<int32_t> op_type_ids_;
+
+    // Only set if critical-path scheduling is enabled.
+    std::unique_ptr<std::atomic_int_fast64_t[]> priorities_;
+    // The nodes in reverse topological order, ignoring NextIteration back
+    // edges.
+    std::vector<const NodeItem*> critical_path_order_;
+    std::atomic<int64_t> num_steps_{0};
   };
 
   ImmutableExecutorState immutable_state_;
   KernelStats kernel_stats_;
+  // Only set if static memory planning is enabled and supported.
+  std::unique_ptr<StaticMemoryPlanner> memory_planner_;
+  // Only set if cross-step batching is enabled and supported.
+  std::unique_ptr<CrossStepBatcher> cross_step_batcher_;
 
   ExecutorImpl(const ExecutorImpl&) = delete;
   void operator=(const ExecutorImpl&) = delete;
 };
 
+// A queue of nodes to be processed inline. If `priorities` is null, nodes are
+// processed in the order of `FallbackQueue`. Otherwise, the node with the
+// highest critical-path priority is processed first.
+template <class TaggedNode, class FallbackQueue>
+class CriticalPathReadyQueue {
+ public:
+  explicit CriticalPathReadyQueue(const std::atomic_int_fast64_t* priorities)
+      : priorities_(priorities) {}
+
+  void push_back(const TaggedNode& node) {
+    if (priorities_ == nullptr) {
+      fallback_.push_back(node);
+      return;
+    }
+    // The priority is read once, so that concurrent priority updates do not
+    // break the heap.
+    heap_.push_back(
+        {priorities_[node.node_item->node_id].load(std::memory_order_relaxed),
+         node});
+    std::push_heap(heap_.begin(), heap_.end(), &Compare);
+  }
+  TaggedNode front() const {
+    return priorities_ == nullptr ? fallback_.front() : heap_.front().node;
+  }
+  void pop_front() {
+    if (priorities_ == nullptr) {
+      fallback_.pop_front();
+      return;
+    }
+    std::pop_heap(heap_.begin(), heap_.end(), &Compare);
+    heap_.pop_back();
+  }
+  bool empty() const {
+    return priorities_ == nullptr ? fallback_.empty() : heap_.empty();
+  }
+  int size() const {
+    return priorities_ == nullptr ? fallback_.size() : heap_.size();
+  }
+
+ private:
+  struct Entry {
+    int64_t priority;
+    TaggedNode node;
+  };
+
+  static bool Compare(const Entry& lhs, const Entry& rhs) {
+    return lhs.priority < rhs.priority;
+  }
+
+  const std::atomic_int_fast64_t* const priorities_;
+  FallbackQueue fallback_;
+  absl::InlinedVector<Entry, 16UL> heap_;
+};
+
 // The state associated with one invocation of ExecutorImpl::Run.
 //
 // ExecutorState dispatches nodes when they become ready, and delegates to an
@@ -284,7 +527,9 @@ class ExecutorState {
  public:
   ExecutorState(const Executor::Args& args,
                 const ImmutableExecutorState& immutable_state_,
-                ExecutorImpl::KernelStats* kernel_stats_);
+                ExecutorImpl::KernelStats* kernel_stats_,
+                StaticMemoryPlanner* memory_planner,
+                CrossStepBatcher* cross_step_batcher);
   ~ExecutorState();
 
   void RunAsync(Executor::DoneCallback done);
@@ -292,8 +537,9 @@ class ExecutorState {
  private:
   // Use `TaggedNode` types defined by `PropagatorStateType`.
   typedef typename PropagatorStateType::TaggedNode TaggedNode;
-  typedef
-      typename PropagatorStateType::TaggedNodeReadyQueue TaggedNodeReadyQueue;
+  typedef CriticalPathReadyQueue<
+      TaggedNode, typename PropagatorStateType::TaggedNodeReadyQueue>
+      TaggedNodeReadyQueue;
   typedef typename PropagatorStateType::TaggedNodeSeq TaggedNodeSeq;
 
   struct AsyncState;
@@ -311,6 +557,17 @@ class ExecutorState {
                     const TaggedNode& tagged_node, Entry* first_input,
                     NodeExecStatsInterface* stats,
                     activity_watcher::ActivityId activity_id);
+  // Runs the kernel of `item` through `cross_step_batcher_`, like an
+  // asynchronous kernel.
+  void ProcessBatched(const NodeItem& item,
+                      const OpKernelContext::Params& params,
+                      const TaggedNode& tagged_node, Entry* first_input,
+                      NodeExecStatsInterface* stats,
+                      activity_watcher::ActivityId activity_id);
+  // Processes the outputs of the kernel of `state`, which was launched
+  // asynchronously, and deletes `state`.
+  void AsyncKernelDone(AsyncState* state,
+                       activity_watcher::ActivityId activity_id);
   void ProcessNoop(NodeExecStatsInterface* stats);
   void ProcessConstTensor(const NodeItem& item, EntryVector* outputs,
                           NodeExecStatsInterface* stats);
@@ -333,8 +590,18 @@ class ExecutorState {
                 NodeExecStatsInterface* stats,
                 TaggedNodeReadyQueue* inline_ready);
 
+  // Returns the critical-path priority of `tagged_node`.
+  //
+  // REQUIRES: `priorities_ != nullptr`.
+  int64_t Priority(const TaggedNode& tagged_node) const {
+    return priorities_[tagged_node.node_item->node_id].load(
+        std::memory_order_relaxed);
+  }
+
   // Schedule all the expensive nodes in '*ready', and put all the inexpensive
-  // nodes in 'ready' into 'inline_ready'.
+  // nodes in 'ready' into 'inline_ready'. With critical-path scheduling, the
+  // expensive nodes are dispatched in the order of their priority, and the
+  // expensive node with the highest priority is run inline.
   //
   // This method will clear `*ready` before returning.
   //
@@ -391,6 +658,9 @@ class ExecutorState {
   CallFrameInterface* call_frame_;
   const ImmutableExecutorState& immutable_state_;
   ExecutorImpl::KernelStats* const kernel_stats_;
+  // The critical-path priorities of the nodes, or nullptr if nodes are
+  // scheduled in the order they become ready.
+  const std::atomic_int_fast64_t* const priorities_;
   CancellationManager* cancellation_manager_;
   tsl::CoordinationServiceAgent* coordination_service_agent_;
   absl::optional<ManagedStackTrace> stack_trace_ = absl::nullopt;
@@ -400,6 +670,21 @@ class ExecutorState {
   bool sync_on_finish_;
   const bool run_all_kernels_inline_;
 
+  // Declared before `propagator_`, so that the tensors of the step are
+  // released before the arena.
+  std::unique_ptr<StepArenaAllocator> step_arena_;
+  const bool track_step_arena_;
+
+  // The planned memory of the step, if any. Declared before `propagator_`,
+  // so that it is released after the tensors of the step.
+  StaticMemoryPlanner* const memory_planner_;
+  StaticMemoryPlanner::BuffersPtr planned_buffers_;
+  // True if this step records its output sizes for `memory_planner_`.
+  bool calibrating_memory_plan_ = false;
+
+  // Coalesces batchable kernels with concurrent steps, if not null.
+  CrossStepBatcher* const cross_step_batcher_;
+
   PropagatorStateType propagator_;
 
   // Invoked when the execution finishes.
@@ -420,7 +705,8 @@ class ExecutorState {
 template <class PropagatorStateType>
 ExecutorState<PropagatorStateType>::ExecutorState(
     const Executor::Args& args, const ImmutableExecutorState& immutable_state,
-    ExecutorImpl::KernelStats* kernel_stats)
+    ExecutorImpl::KernelStats* kernel_stats,
+    StaticMemoryPlanner* memory_planner, CrossStepBatcher* cross_step_batcher)
     : vlog_(VLOG_IS_ON(1)),
       log_memory_(LogMemory::IsEnabled()),
       step_id_(args.step_id),
@@ -443,19 +729,43 @@ ExecutorState<PropagatorStateType>::ExecutorState(
       call_frame_(args.call_frame),
       immutable_state_(immutable_state),
       kernel_stats_(kernel_stats),
+      // The deterministic op order takes precedence over the critical path.
+      priorities_(std::is_same<PropagatorStateType, OrderedPropagatorState>()
+                      ? nullptr
+                      : kernel_stats->critical_path_priorities()),
       cancellation_manager_(args.cancellation_manager),
       coordination_service_agent_(args.coordination_service_agent),
       stack_trace_(args.stack_trace),
       runner_(args.runner),
       sync_on_finish_(args.sync_on_finish),
       run_all_kernels_inline_(args.run_all_kernels_inline),
+      track_step_arena_(immutable_state.params().track_step_arena),
+      memory_planner_(memory_planner),
+      planned_buffers_(nullptr,
+                       StaticMemoryPlanner::BuffersReleaser{memory_planner}),
+      cross_step_batcher_(cross_step_batcher),
       propagator_(immutable_state, step_id_, vlog_),
       num_outstanding_ops_(0) {
+  Device* device = immutable_state_.params().device;
   if (args.user_intra_op_threadpool != nullptr) {
-    Device* device = immutable_state_.params().device;
     user_device_ = RenamedDevice::NewRenamedDevice(
         device->name(), device, false, false, args.user_intra_op_threadpool);
   }
+  if (immutable_state_.params().use_step_arena &&
+      device->device_type() == DEVICE_CPU) {
+    step_arena_ = std::make_unique<StepArenaAllocator>(
+        device->GetAllocator(AllocatorAttributes()));
+  }
+  if (memory_planner_ != nullptr) {
+    if (memory_planner_->calibrating()) {
+      calibrating_memory_plan_ = true;
+    } else {
+      planned_buffers_ = memory_planner_->AcquireBuffers();
+    }
+  }
+  if (cross_step_batcher_ != nullptr) {
+    cross_step_batcher_->StepStarted();
+  }
 }
 
 template <class PropagatorStateType>
@@ -464,6 +774,20 @@ ExecutorState<PropagatorStateType>::~ExecutorState() {
     device_context_->Unref();
   }
   delete slice_reader_cache_;
+  if (cross_step_batcher_ != nullptr) {
+    cross_step_batcher_->StepFinished();
+  }
+  if (step_arena_ && track_step_arena_) {
+    VLOG(1) << "Step " << step_id_ << " allocated "
+            << step_arena_->arena_bytes() << " bytes from the step arena and "
+            << step_arena_->fallback_bytes()
+            << " bytes from the device allocator.";
+    metrics::RecordStepArenaAllocatedBytes(step_arena_->arena_bytes(),
+                                           step_arena_->fallback_bytes());
+  }
+  if (calibrating_memory_plan_) {
+    memory_planner_->CalibrationStepDone();
+  }
 }
 
 template <class PropagatorStateType>
@@ -551,6 +875,8 @@ struct ExecutorState<PropagatorStateType>::AsyncState {
   Entry* first_input;
   OpKernelContext ctx;
   NodeExecStatsInterface* stats;
+  // Started when the kernel is launched.
+  KernelTimer timer;
 
  private:
   OpKernelContext::Params* ParamsButClearingEigenGPUDevice(
@@ -595,7 +921,10 @@ absl::Status ExecutorState<PropagatorStateType>::ProcessSync(
   Device* device = immutable_state_.params().device;
   const bool is_expensive = kernel_stats_->IsExpensive(item);
 
-  if (TF_PREDICT_FALSE(MightTrace(event_collector_, is_expensive))) {
+  const bool might_trace = MightTrace(event_collector_, is_expensive);
+  const bool has_expensive_marker = kernel_stats_->HasExpensiveMarker(item);
+  KernelTimer timer;
+  if (TF_PREDICT_FALSE(might_trace)) {
     tsl::tracing::ScopedRegion region(tsl::tracing::EventCategory::kCompute,
                                       op_kernel->name_view());
     profiler::AnnotatedTraceMe activity(
@@ -605,19 +934,26 @@ absl::Status ExecutorState<PropagatorStateType>::ProcessSync(
         },
         tsl::profiler::GetTFTraceMeLevel(is_expensive));
     device->Compute(op_kernel, &ctx);
-  } else if (kernel_stats_->HasExpensiveMarker(item)) {
-    KernelTimer timer;
+  } else {
     device->Compute(op_kernel, &ctx);
+  }
+  if (kernel_stats_->records_op_latency() || has_expensive_marker) {
+    const uint64 elapsed_cycles = timer.ElapsedCycles();
+    if (kernel_stats_->records_op_latency()) {
+      kernel_stats_->RecordOpLatency(item, elapsed_cycles);
+    }
     // For expensive kernels, always update the cost estimate. For inexpensive
     // kernels, update the cost estimate with ~1/16 probability. This assumes
     // that the last 4 bits of the CPU cycle count is uniformly distributed.
+    // The cycles of traced kernels include the tracing, so they do not update
+    // the cost estimate.
     constexpr int kKernelExecutionTrackingInvocationSkipCount = 16;
-    if (is_expensive ||
-        timer.start_cycles % kKernelExecutionTrackingInvocationSkipCount == 0) {
-      kernel_stats_->UpdateCostEstimate(item, timer.ElapsedCycles());
+    const bool update_cost_estimate =
+        is_expensive ||
+        timer.start_cycles % kKernelExecutionTrackingInvocationSkipCount == 0;
+    if (has_expensive_marker && !might_trace && update_cost_estimate) {
+      kernel_stats_->UpdateCostEstimate(item, elapsed_cycles);
     }
-  } else {
-    device->Compute(op_kernel, &ctx);
   }
   nodestats::SetOpEnd(stats);
   if (outputs->size() < item.num_outputs) outputs->resize(item.num_outputs);
@@ -669,39 +1005,7 @@ void ExecutorState<PropagatorStateType>::ProcessAsync(
                  {"step_id", step_id_}});
           },
           tsl::profiler::ContextType::kTfExecutor, ctx_id);
-
-      Device* device = immutable_state_.params().device;
-      NodeExecStatsInterface* stats = state->stats;  // Shorthand
-      Entry* first_input = state->first_input;       // Shorthand
-
-      nodestats::SetOpEnd(stats);
-      EntryVector outputs(state->item->num_outputs);
-      absl::Status s =
-          ProcessOutputs(*state->item, &state->ctx, outputs.data(), stats);
-      nodestats::SetMemory(stats, &state->ctx);
-      if (vlog_) {
-        VLOG(2) << "Async kernel done: " << state->item->node_id << " step "
-                << step_id_ << " "
-                << SummarizeNodeDef(state->item->kernel->def())
-                << (state->tagged_node.get_is_dead() ? " is dead" : "")
-                << " device: " << device->name();
-      }
-
-      // Clears inputs.
-      const int num_inputs = state->item->num_inputs;
-      for (int i = 0; i < num_inputs; ++i) {
-        (first_input + i)->ClearVal();
-      }
-      propagator_.MaybeMarkCompleted(state->tagged_node);
-      activity_watcher::ActivityEnd(activity_id);
-      TaggedNodeSeq ready;
-      if (s.ok()) {
-        propagator_.PropagateOutputs(state->tagged_node, &outputs, &ready);
-      }
-      outputs.clear();
-      const bool completed = NodeDone(s, &ready, stats, nullptr);
-      delete state;
-      if (completed) ScheduleFinish();
+      AsyncKernelDone(state, activity_id);
     };
 
     immutable_state_.params().device->ComputeAsync(async_kernel, &state->ctx,
@@ -709,6 +1013,62 @@ void ExecutorState<PropagatorStateType>::ProcessAsync(
   }
 }
 
+template <class PropagatorStateType>
+void ExecutorState<PropagatorStateType>::ProcessBatched(
+    const NodeItem& item, const OpKernelContext::Params& params,
+    const TaggedNode& tagged_node, Entry* first_input,
+    NodeExecStatsInterface* stats, activity_watcher::ActivityId activity_id) {
+  AsyncState* state =
+      new AsyncState(params, tagged_node, &item, first_input, stats);
+
+  nodestats::SetOpStart(stats);
+
+  // If the kernel joins the batch of another step, this returns at once, and
+  // the thread of that step calls `done` once the batch has run.
+  cross_step_batcher_->ComputeAsync(
+      item, &state->params, &state->ctx,
+      [this, state, activity_id]() { AsyncKernelDone(state, activity_id); });
+}
+
+template <class PropagatorStateType>
+void ExecutorState<PropagatorStateType>::AsyncKernelDone(
+    AsyncState* state, activity_watcher::ActivityId activity_id) {
+  Device* device = immutable_state_.params().device;
+  NodeExecStatsInterface* stats = state->stats;  // Shorthand
+  Entry* first_input = state->first_input;       // Shorthand
+
+  if (kernel_stats_->records_op_latency()) {
+    kernel_stats_->RecordOpLatency(*state->item, state->timer.ElapsedCycles());
+  }
+  nodestats::SetOpEnd(stats);
+  EntryVector outputs(state->item->num_outputs);
+  absl::Status s =
+      ProcessOutputs(*state->item, &state->ctx, outputs.data(), stats);
+  nodestats::SetMemory(stats, &state->ctx);
+  if (vlog_) {
+    VLOG(2) << "Async kernel done: " << state->item->node_id << " step "
+            << step_id_ << " " << SummarizeNodeDef(state->item->kernel->def())
+            << (state->tagged_node.get_is_dead() ? " is dead" : "")
+            << " device: " << device->name();
+  }
+
+  // Clears inputs.
+  const int num_inputs = state->item->num_inputs;
+  for (int i = 0; i < num_inputs; ++i) {
+    (first_input + i)->ClearVal();
+  }
+  propagator_.MaybeMarkCompleted(state->tagged_node);
+  activity_watcher::ActivityEnd(activity_id);
+  TaggedNodeSeq ready;
+  if (s.ok()) {
+    propagator_.PropagateOutputs(state->tagged_node, &outputs, &ready);
+  }
+  outputs.clear();
+  const bool completed = NodeDone(s, &ready, stats, nullptr);
+  delete state;
+  if (completed) ScheduleFinish();
+}
+
 template <class PropagatorStateType>
 void ExecutorState<PropagatorStateType>::ProcessNoop(
     NodeExecStatsInterface* stats) {
@@ -732,7 +1092,7 @@ void ExecutorState<PropagatorStateType>::Process(const TaggedNode& tagged_node,
                                                  int64_t scheduled_nsec) {
   tsl::profiler::TraceMe traceme("ExecutorState::Process Scheduled",
                                  tsl::profiler::TraceMeLevel::kVerbose);
-  TaggedNodeReadyQueue inline_ready;
+  TaggedNodeReadyQueue inline_ready(priorities_);
   inline_ready.push_back(tagged_node);
   return ProcessInline(&inline_ready, scheduled_nsec);
 }
@@ -779,6 +1139,10 @@ void ExecutorState<PropagatorStateType>::ProcessInline(
   params->runner = &runner_;
   params->run_all_kernels_inline = run_all_kernels_inline_;
   params->stats_collector = stats_collector_;
+  if (planned_buffers_) {
+    params->planned_output_backing_allocator =
+        planned_buffers_->backing_allocator();
+  }
   params->inc_num_deferred_ops_function = [this]() {
     mutex_lock lock(num_deferred_ops_mu_);
     num_deferred_ops_++;
@@ -918,7 +1282,16 @@ void ExecutorState<PropagatorStateType>::ProcessInline(
       params->is_input_dead = is_input_dead;
       params->output_attr_array = item.output_attrs();
       params->forward_from_array = item.forward_from();
+      params->forwardable_inputs = item.forwardable_inputs.get();
       params->outputs_required_array = item.outputs_required.get();
+      params->use_step_arena = item.is_step_local;
+      params->step_arena = (item.is_step_local || track_step_arena_)
+                               ? step_arena_.get()
+                               : nullptr;
+      params->planned_output_allocators =
+          planned_buffers_ ? planned_buffers_->node_allocators(item.node_id)
+                           : nullptr;
+      params->output_retval_indices = item.output_retval_indices.get();
       params->inputs = *inputs;
       params->input_alloc_attrs = input_alloc_attrs;
 
@@ -926,6 +1299,11 @@ void ExecutorState<PropagatorStateType>::ProcessInline(
         ProcessAsync(item, *params, tagged_node, first_input, stats,
                      activity_id);
         launched_asynchronously = true;
+      } else if (cross_step_batcher_ != nullptr &&
+                 cross_step_batcher_->IsBatchable(item)) {
+        ProcessBatched(item, *params, tagged_node, first_input, stats,
+                       activity_id);
+        launched_asynchronously = true;
       } else {
         s = ProcessSync(item, params.get(), &outputs, stats);
       }
@@ -1136,6 +1514,9 @@ absl::Status ExecutorState<PropagatorStateType>::ProcessOutputs(
     } else {
       // Set the allocator attributes of the output entry.
       out->alloc_attr = ctx->output_alloc_attr(i);
+      if (TF_PREDICT_FALSE(calibrating_memory_plan_) && item.is_step_local) {
+        memory_planner_->RecordOutput(item, i, *val.tensor);
+      }
 
       // Sanity check of output tensor types. We need to inspect this safely as
       // we are in the tensor buffer.
@@ -1302,6 +1683,12 @@ void ExecutorState<PropagatorStateType>::ScheduleReady(
   } else {
     const TaggedNode* curr_expensive_node = nullptr;
     TaggedNodeSeq expensive_nodes;
+    if (priorities_ != nullptr) {
+      std::stable_sort(ready->begin(), ready->end(),
+                       [this](const TaggedNode& lhs, const TaggedNode& rhs) {
+                         return Priority(lhs) > Priority(rhs);
+                       });
+    }
     if (inline_ready == nullptr) {
       // Schedule to run all the ready ops in thread pool.
       for (auto& tagged_node : *ready) {
@@ -1314,6 +1701,13 @@ void ExecutorState<PropagatorStateType>::ScheduleReady(
         if (tagged_node.get_is_dead() || !kernel_stats_->IsExpensive(item)) {
           // Inline this inexpensive node.
           inline_ready->push_back(tagged_node);
+        } else if (priorities_ != nullptr) {
+          // Keep the first, i.e. the most critical, expensive node.
+          if (curr_expensive_node) {
+            expensive_nodes.push_back(tagged_node);
+          } else {
+            curr_expensive_node = &tagged_node;
+          }
         } else {
           if (curr_expensive_node) {
             expensive_nodes.push_back(*curr_expensive_node);
@@ -1323,8 +1717,15 @@ void ExecutorState<PropagatorStateType>::ScheduleReady(
       }
     }
     if (curr_expensive_node) {
-      if (inline_ready->empty()) {
+      if (inline_ready->empty() ||
+          (priorities_ != nullptr &&
+           Priority(*curr_expensive_node) >= Priority(inline_ready->front()))) {
+        // Nothing on the inline queue is more critical than this node, so it
+        // runs in this thread without a thread hop.
         inline_ready->push_back(*curr_expensive_node);
+      } else if (priorities_ != nullptr) {
+        // Dispatch the most critical expensive node first.
+        expensive_nodes.insert(expensive_nodes.begin(), *curr_expensive_node);
       } else {
         // There are inline nodes to run already. We dispatch this expensive
         // node to other thread.
@@ -1514,16 +1915,21 @@ void ExecutorState<PropagatorStateType>::Finish() {
 }
 
 void ExecutorImpl::RunAsyncInternal(const Args& args, DoneCallback done) {
+  kernel_stats_.MaybeUpdateCriticalPathPriorities();
   if (OpOrderDeterminismRequired()) {
-    (new ExecutorState<OrderedPropagatorState>(args, immutable_state_,
-                                               &kernel_stats_))
+    (new ExecutorState<OrderedPropagatorState>(
+         args, immutable_state_, &kernel_stats_, memory_planner_.get(),
+         cross_step_batcher_.get()))
         ->RunAsync(std::move(done));
   } else if (immutable_state_.requires_control_flow_support()) {
-    (new ExecutorState<PropagatorState>(args, immutable_state_, &kernel_stats_))
+    (new ExecutorState<PropagatorState>(args, immutable_state_, &kernel_stats_,
+                                        memory_planner_.get(),
+                                        cross_step_batcher_.get()))
         ->RunAsync(std::move(done));
   } else {
-    (new ExecutorState<SimplePropagatorState>(args, immutable_state_,
-                                              &kernel_stats_))
+    (new ExecutorState<SimplePropagatorState>(
+         args, immutable_state_, &kernel_stats_, memory_planner_.get(),
+         cross_step_batcher_.get()))
         ->RunAsync(std::move(done));
   }
 }
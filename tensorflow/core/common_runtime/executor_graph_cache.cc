@@ -0,0 +1,98 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/executor_graph_cache.h"
+
+#include <string>
+
+#include "absl/strings/str_cat.h"
+#include "tensorflow/core/lib/hash/hash.h"
+#include "tensorflow/core/lib/io/path.h"
+#include "tensorflow/core/lib/random/random.h"
+#include "tensorflow/core/lib/strings/proto_serialization.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/fingerprint.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/public/version.h"
+
+namespace tensorflow {
+
+uint64 ExecutorGraphCache::Key(uint64 graph_fingerprint,
+                               const ConfigProto& config,
+                               const BuildGraphOptions& options,
+                               absl::Span<Device* const> devices) {
+  uint64 key = Fingerprint64(
+      absl::StrCat(TF_VERSION_STRING, "/", TF_GRAPH_DEF_VERSION, "/",
+                   kFormatVersion));
+  key = Hash64Combine(key, graph_fingerprint);
+  key = Hash64Combine(key, DeterministicProtoHash64(config));
+  key = Hash64Combine(key, DeterministicProtoHash64(options.callable_options));
+  key = Hash64Combine(key, options.use_function_convention);
+  key = Hash64Combine(key, options.collective_graph_key);
+  key = Hash64Combine(key, static_cast<uint64>(options.collective_order));
+  for (const Device* device : devices) {
+    // The incarnation of a device differs between processes, so it is left
+    // out. Grappler and placement depend on the rest of the attributes.
+    const DeviceAttributes& attributes = device->attributes();
+    key = Hash64Combine(key, Fingerprint64(attributes.name()));
+    key = Hash64Combine(key, Fingerprint64(attributes.device_type()));
+    key = Hash64Combine(key, Fingerprint64(attributes.physical_device_desc()));
+    key = Hash64Combine(key, static_cast<uint64>(attributes.memory_limit()));
+    key = Hash64Combine(key, DeterministicProtoHash64(attributes.locality()));
+  }
+  return key;
+}
+
+std::string ExecutorGraphCache::Filename(uint64 key) const {
+  return io::JoinPath(directory_,
+                      absl::StrCat(absl::Hex(key, absl::kZeroPad16),
+                                   ".executor_graphs.pb"));
+}
+
+absl::Status ExecutorGraphCache::Lookup(uint64 key,
+                                        ExecutorGraphCacheEntry* entry) const {
+  const std::string filename = Filename(key);
+  if (!env_->FileExists(filename).ok()) {
+    return errors::NotFound("No executor graph cache entry in ", filename);
+  }
+  TF_RETURN_IF_ERROR(ReadBinaryProto(env_, filename, entry));
+  if (entry->format_version() != kFormatVersion || entry->key() != key) {
+    return errors::NotFound("Executor graph cache entry ", filename,
+                            " has format version ", entry->format_version(),
+                            " and key ", entry->key(), ", expected ",
+                            kFormatVersion, " and ", key);
+  }
+  return absl::OkStatus();
+}
+
+absl::Status ExecutorGraphCache::Insert(uint64 key,
+                                        ExecutorGraphCacheEntry* entry) {
+  entry->set_format_version(kFormatVersion);
+  entry->set_key(key);
+  TF_RETURN_IF_ERROR(env_->RecursivelyCreateDir(directory_));
+  const std::string filename = Filename(key);
+  const std::string temp_filename =
+      absl::StrCat(filename, ".tmp", absl::Hex(random::New64()));
+  TF_RETURN_IF_ERROR(WriteBinaryProto(env_, temp_filename, *entry));
+  absl::Status s = env_->RenameFile(temp_filename, filename);
+  if (!s.ok()) {
+    env_->DeleteFile(temp_filename).IgnoreError();
+    return s;
+  }
+  VLOG(1) << "Stored executor graph cache entry " << filename;
+  return absl::OkStatus();
+}
+
+}  // namespace tensorflow
@@ -0,0 +1,80 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_COMMON_RUNTIME_EXECUTOR_GRAPH_CACHE_H_
+#define TENSORFLOW_CORE_COMMON_RUNTIME_EXECUTOR_GRAPH_CACHE_H_
+
+#include <string>
+#include <utility>
+
+#include "absl/status/status.h"
+#include "absl/types/span.h"
+#include "tensorflow/core/common_runtime/build_graph_options.h"
+#include "tensorflow/core/common_runtime/device.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/types.h"
+#include "tensorflow/core/protobuf/config.pb.h"
+#include "tensorflow/core/protobuf/executor_graph_cache.pb.h"
+
+namespace tensorflow {
+
+// A cache of the partitioned graphs which DirectSession builds for its
+// callables, stored in a local directory with one file per entry.
+//
+// Building the partition graphs places, optimizes and partitions the graph,
+// which can take minutes for large graphs. An entry is keyed by the
+// fingerprint of everything the partition graphs depend on, so that a new
+// session can reuse the graphs of an earlier one, e.g. after a restart of the
+// process. Entries of other TensorFlow versions or cache formats are ignored.
+//
+// Entries are written to a temporary file and renamed, so that concurrent
+// sessions never read a partially written entry.
+//
+// This class is thread-safe.
+class ExecutorGraphCache {
+ public:
+  // The version of the format of ExecutorGraphCacheEntry. Increment it when
+  // the meaning of an entry changes.
+  static constexpr int kFormatVersion = 1;
+
+  explicit ExecutorGraphCache(std::string directory, Env* env = Env::Default())
+      : directory_(std::move(directory)), env_(env) {}
+
+  // Returns the key of the graphs built for `options` by a session with
+  // `config` and `devices`, from a graph whose fingerprint is
+  // `graph_fingerprint`.
+  static uint64 Key(uint64 graph_fingerprint, const ConfigProto& config,
+                    const BuildGraphOptions& options,
+                    absl::Span<Device* const> devices);
+
+  // Reads the entry with `key` into `*entry`. Returns NotFound if there is no
+  // entry with `key` for this version of TensorFlow.
+  absl::Status Lookup(uint64 key, ExecutorGraphCacheEntry* entry) const;
+
+  // Stores `*entry` under `key`, replacing any existing entry. Sets the key
+  // and format version of `*entry`.
+  absl::Status Insert(uint64 key, ExecutorGraphCacheEntry* entry);
+
+  // Returns the file which holds the entry with `key`.
+  std::string Filename(uint64 key) const;
+
+ private:
+  const std::string directory_;
+  Env* const env_;
+};
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_COMMON_RUNTIME_EXECUTOR_GRAPH_CACHE_H_
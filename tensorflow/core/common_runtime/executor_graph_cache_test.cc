@@ -0,0 +1,114 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/executor_graph_cache.h"
+
+#include <memory>
+#include <string>
+
+#include "tensorflow/core/common_runtime/build_graph_options.h"
+#include "tensorflow/core/common_runtime/device.h"
+#include "tensorflow/core/common_runtime/device_factory.h"
+#include "tensorflow/core/framework/graph.pb.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/io/path.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/protobuf/config.pb.h"
+#include "tensorflow/core/protobuf/executor_graph_cache.pb.h"
+#include "tensorflow/core/public/session_options.h"
+
+namespace tensorflow {
+namespace {
+
+class ExecutorGraphCacheTest : public ::testing::Test {
+ protected:
+  ExecutorGraphCacheTest()
+      : device_(DeviceFactory::NewDevice("CPU", {},
+                                         "/job:localhost/replica:0/task:0")),
+        directory_(io::JoinPath(testing::TmpDir(), "executor_graph_cache",
+                                ::testing::UnitTest::GetInstance()
+                                    ->current_test_info()
+                                    ->name())),
+        cache_(directory_) {}
+
+  uint64 Key(uint64 graph_fingerprint, const ConfigProto& config,
+             const BuildGraphOptions& options) {
+    Device* devices[] = {device_.get()};
+    return ExecutorGraphCache::Key(graph_fingerprint, config, options,
+                                   devices);
+  }
+
+  std::unique_ptr<Device> device_;
+  const std::string directory_;
+  ExecutorGraphCache cache_;
+};
+
+TEST_F(ExecutorGraphCacheTest, InsertAndLookup) {
+  ExecutorGraphCacheEntry entry;
+  NodeDef* node =
+      (*entry.mutable_partition_graphs())[device_->name()].add_node();
+  node->set_name("a");
+  node->set_op("NoOp");
+  entry.add_feed_types(DT_FLOAT);
+  entry.add_fetch_types(DT_INT32);
+  entry.set_edge_name_counter(7);
+  const uint64 key = Key(1, ConfigProto(), BuildGraphOptions());
+  TF_ASSERT_OK(cache_.Insert(key, &entry));
+  EXPECT_EQ(entry.format_version(), ExecutorGraphCache::kFormatVersion);
+  EXPECT_EQ(entry.key(), key);
+
+  ExecutorGraphCacheEntry cached;
+  TF_ASSERT_OK(cache_.Lookup(key, &cached));
+  EXPECT_EQ(cached.SerializeAsString(), entry.SerializeAsString());
+}
+
+TEST_F(ExecutorGraphCacheTest, LookupMissingEntry) {
+  ExecutorGraphCacheEntry entry;
+  EXPECT_TRUE(absl::IsNotFound(cache_.Lookup(1, &entry)));
+}
+
+TEST_F(ExecutorGraphCacheTest, LookupIgnoresOtherFormatVersions) {
+  const uint64 key = Key(1, ConfigProto(), BuildGraphOptions());
+  ExecutorGraphCacheEntry entry;
+  entry.set_format_version(ExecutorGraphCache::kFormatVersion + 1);
+  entry.set_key(key);
+  TF_ASSERT_OK(Env::Default()->RecursivelyCreateDir(directory_));
+  TF_ASSERT_OK(
+      WriteBinaryProto(Env::Default(), cache_.Filename(key), entry));
+  EXPECT_TRUE(absl::IsNotFound(cache_.Lookup(key, &entry)));
+}
+
+TEST_F(ExecutorGraphCacheTest, KeyDependsOnGraphConfigAndCallable) {
+  ConfigProto config;
+  BuildGraphOptions options;
+  options.callable_options.add_fetch("a:0");
+  const uint64 key = Key(1, config, options);
+  EXPECT_EQ(Key(1, config, options), key);
+  EXPECT_NE(Key(2, config, options), key);
+
+  ConfigProto other_config;
+  other_config.mutable_graph_options()->set_place_pruned_graph(true);
+  EXPECT_NE(Key(1, other_config, options), key);
+
+  BuildGraphOptions other_options;
+  other_options.callable_options.add_fetch("b:0");
+  EXPECT_NE(Key(1, config, other_options), key);
+
+  EXPECT_NE(ExecutorGraphCache::Key(1, config, options, {}), key);
+}
+
+}  // namespace
+}  // namespace tensorflow
@@ -16,6 +16,10 @@ limitations under the License.
 #include "tensorflow/core/common_runtime/executor.h"
 
 #include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
 
 #include "tensorflow/cc/framework/ops.h"
 #include "tensorflow/cc/ops/array_ops.h"
@@ -28,20 +32,25 @@ limitations under the License.
 #include "tensorflow/core/common_runtime/graph_constructor.h"
 #include "tensorflow/core/common_runtime/kernel_benchmark_testlib.h"
 #include "tensorflow/core/common_runtime/lower_functional_ops.h"
+#include "tensorflow/core/common_runtime/op_latency_histograms.h"
 #include "tensorflow/core/common_runtime/process_util.h"
 #include "tensorflow/core/common_runtime/step_stats_collector.h"
 #include "tensorflow/core/framework/attr_value.pb.h"
 #include "tensorflow/core/framework/local_rendezvous.h"
 #include "tensorflow/core/framework/op.h"
+#include "tensorflow/core/framework/op_kernel.h"
 #include "tensorflow/core/framework/rendezvous.h"
 #include "tensorflow/core/framework/step_stats.pb.h"
 #include "tensorflow/core/framework/tensor_testutil.h"
 #include "tensorflow/core/framework/versions.pb.h"
 #include "tensorflow/core/graph/algorithm.h"
+#include "tensorflow/core/graph/node_builder.h"
 #include "tensorflow/core/graph/testlib.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/core/threadpool.h"
 #include "tensorflow/core/lib/random/simple_philox.h"
 #include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/strcat.h"
 #include "tensorflow/core/platform/test.h"
@@ -90,6 +99,11 @@ class ExecutorTest : public ::testing::Test {
     params.delete_kernel = [](OpKernel* kernel) {
       DeleteNonCachedKernel(kernel);
     };
+    params.critical_path_scheduling = critical_path_scheduling_;
+    params.use_step_arena = use_step_arena_;
+    params.track_step_arena = use_step_arena_;
+    params.plan_input_forwarding = plan_input_forwarding_;
+    params.record_op_latency = record_op_latency_;
     rendez_ = NewLocalRendezvous();
     delete exec_;
     TF_CHECK_OK(NewLocalExecutor(params, *graph, &exec_));
@@ -111,6 +125,10 @@ class ExecutorTest : public ::testing::Test {
   StepStats step_stats_;
   Executor::Args::Runner runner_;
   Rendezvous* rendez_ = nullptr;
+  bool critical_path_scheduling_ = false;
+  bool use_step_arena_ = false;
+  bool plan_input_forwarding_ = false;
+  bool record_op_latency_ = false;
 };
 
 // A float val -> Tensor<float>
@@ -185,6 +203,40 @@ TEST_F(ExecutorTest, SimpleAdd) {
   EXPECT_EQ(2.0, V(out));  // out = 1.0 + 1.0 = 2.0
 }
 
+TEST_F(ExecutorTest, RecordsOpLatency) {
+  record_op_latency_ = true;
+  // b <- Identity(a). _Recv is an asynchronous kernel, and Identity and _Send
+  // are inexpensive kernels.
+  auto g = std::make_unique<Graph>(OpRegistry::Global());
+  auto in = test::graph::Recv(g.get(), "a", "float", ALICE, 1, BOB);
+  auto out = test::graph::Identity(g.get(), in);
+  test::graph::Send(g.get(), out, "b", BOB, 1, ALICE);
+  Create(std::move(g));
+  const std::vector<string> op_types = {"_Recv", "Identity", "_Send"};
+  std::vector<double> num_recorded;
+  for (const string& op_type : op_types) {
+    num_recorded.push_back(
+        OpLatencyHistograms::Global()->Collect(op_type).num());
+  }
+  constexpr int kNumSteps = 4;
+  for (int i = 0; i < kNumSteps; ++i) {
+    Rendezvous::Args args;
+    TF_ASSERT_OK(rendez_->Send(Key(ALICE, kIncarnation, BOB, "a"), args,
+                               V(1.0), false));
+    TF_ASSERT_OK(Run(rendez_));
+    Tensor out = V(-1);
+    bool is_dead = false;
+    TF_ASSERT_OK(rendez_->Recv(Key(BOB, kIncarnation, ALICE, "b"), args, &out,
+                               &is_dead));
+    EXPECT_EQ(1.0, V(out));
+  }
+  for (size_t i = 0; i < op_types.size(); ++i) {
+    EXPECT_EQ(OpLatencyHistograms::Global()->Collect(op_types[i]).num(),
+              num_recorded[i] + kNumSteps)
+        << op_types[i];
+  }
+}
+
 TEST_F(ExecutorTest, SelfAdd) {
   // v0 <- a
   // v1 = v0 + v0
@@ -265,6 +317,87 @@ TEST_F(ExecutorTest, RandomTree) {
   EXPECT_EQ(4096.0, V(out));
 }
 
+TEST_F(ExecutorTest, RandomTreeCriticalPathScheduling) {
+  critical_path_scheduling_ = true;
+  auto g = std::make_unique<Graph>(OpRegistry::Global());
+  BuildTree(4096, g.get());
+  Create(std::move(g));
+  // Runs enough steps for the priorities to be updated from the measured
+  // costs.
+  for (int i = 0; i < 128; ++i) {
+    Rendezvous::Args args;
+    TF_ASSERT_OK(rendez_->Send(Key(ALICE, kIncarnation, BOB, "a"), args,
+                               V(1.0), false));
+    TF_ASSERT_OK(Run(rendez_));
+    Tensor out = V(-1);
+    bool is_dead = false;
+    TF_ASSERT_OK(rendez_->Recv(Key(BOB, kIncarnation, ALICE, "b"), args, &out,
+                               &is_dead));
+    EXPECT_EQ(4096.0, V(out));
+  }
+}
+
+TEST_F(ExecutorTest, RandomTreeStepArena) {
+  use_step_arena_ = true;
+  auto g = std::make_unique<Graph>(OpRegistry::Global());
+  BuildTree(4096, g.get());
+  Create(std::move(g));
+  for (int i = 0; i < 4; ++i) {
+    Rendezvous::Args args;
+    TF_ASSERT_OK(rendez_->Send(Key(ALICE, kIncarnation, BOB, "a"), args,
+                               V(1.0), false));
+    TF_ASSERT_OK(Run(rendez_));
+    Tensor out = V(-1);
+    bool is_dead = false;
+    TF_ASSERT_OK(rendez_->Recv(Key(BOB, kIncarnation, ALICE, "b"), args, &out,
+                               &is_dead));
+    // The sent tensor is allocated outside of the arena, so it is still valid
+    // after the step.
+    EXPECT_EQ(4096.0, V(out));
+  }
+}
+
+TEST_F(ExecutorTest, PlannedInputForwarding) {
+  // y = -a
+  // z = y * y
+  // b <- -z
+  auto build = [] {
+    auto g = std::make_unique<Graph>(OpRegistry::Global());
+    auto in = test::graph::Recv(g.get(), "a", "float", ALICE, 1, BOB);
+    auto y = test::graph::Unary(g.get(), "Neg", in);
+    auto z = test::graph::Multi(g.get(), "Mul", {y, y});
+    auto out = test::graph::Unary(g.get(), "Neg", z);
+    test::graph::Send(g.get(), out, "b", BOB, 1, ALICE);
+    return g;
+  };
+  auto run = [this] {
+    Rendezvous::Args args;
+    TF_ASSERT_OK(rendez_->Send(Key(ALICE, kIncarnation, BOB, "a"), args,
+                               V(3.0), false));
+    TF_ASSERT_OK(Run(rendez_));
+    Tensor out = V(-1);
+    bool is_dead = false;
+    TF_ASSERT_OK(rendez_->Recv(Key(BOB, kIncarnation, ALICE, "b"), args, &out,
+                               &is_dead));
+    EXPECT_EQ(-9.0, V(out));
+  };
+
+  Create(build());
+  run();
+  const int64_t unplanned_forwarded_bytes =
+      step_stats_collector_.forwarded_output_bytes();
+
+  // Mul is the last use of y, and holds both references to its buffer, so it
+  // computes in place only if forwarding is planned. The collector sums the
+  // bytes of both steps.
+  plan_input_forwarding_ = true;
+  Create(build());
+  run();
+  EXPECT_EQ(step_stats_collector_.forwarded_output_bytes() -
+                2 * unplanned_forwarded_bytes,
+            4);
+}
+
 void BuildConcurrentAddAssign(Graph* g) {
   auto one = test::graph::Constant(g, V(1.0));
   // A variable holds one float.
@@ -339,6 +472,64 @@ TEST_F(ExecutorTest, SimpleSwitchDead) {
   EXPECT_TRUE(is_dead);
 }
 
+TEST_F(ExecutorTest, SimpleSwitchDeadCriticalPathScheduling) {
+  critical_path_scheduling_ = true;
+  auto g = std::make_unique<Graph>(OpRegistry::Global());
+  auto in0 = test::graph::Recv(g.get(), "a", "float", ALICE, 1, BOB);
+  auto in1 = test::graph::Constant(g.get(), VB(true));
+  auto tmp = test::graph::Switch(g.get(), in0, in1);
+  test::graph::Send(g.get(), tmp, "c", BOB, 1, ALICE);
+  Create(std::move(g));
+  Rendezvous::Args args;
+  TF_ASSERT_OK(rendez_->Send(Key(ALICE, kIncarnation, BOB, "a"), args, V(1.0),
+                             false));  // in0 = 1.0
+  TF_ASSERT_OK(Run(rendez_));
+  Tensor out = V(-1);
+  bool is_dead = false;
+  TF_ASSERT_OK(
+      rendez_->Recv(Key(BOB, kIncarnation, ALICE, "c"), args, &out, &is_dead));
+  EXPECT_TRUE(is_dead);
+}
+
+// Each of `kNumFrames` loop frames has a dead exit into a Merge in the root
+// frame, whose other input is a chain of nodes that runs in the root frame
+// while the loop frames finish. Deleting a loop frame propagates its dead exit
+// to the Merge concurrently with the chain activating the same Merge.
+TEST_F(ExecutorTest, DeadExitRacesWithParentFrame) {
+  constexpr int kNumFrames = 32;
+  constexpr int kChainLength = 8;
+  auto g = std::make_unique<Graph>(OpRegistry::Global());
+  auto x = test::graph::Constant(g.get(), V(1.0));
+  auto pred = test::graph::Constant(g.get(), VB(true));
+  Node* sum = nullptr;
+  for (int i = 0; i < kNumFrames; ++i) {
+    const string frame_name = strings::StrCat("loop", i);
+    auto x_enter = test::graph::Enter(g.get(), x, frame_name);
+    auto pred_enter = test::graph::Enter(g.get(), pred, frame_name);
+    // The false output of the Switch is dead, and so is its Exit.
+    auto dead_exit = test::graph::Exit(
+        g.get(), test::graph::Switch(g.get(), x_enter, pred_enter));
+    Node* chain = x;
+    for (int j = 0; j < kChainLength; ++j) {
+      chain = test::graph::Identity(g.get(), chain);
+    }
+    auto merge = test::graph::Merge(g.get(), dead_exit, chain);
+    sum = sum == nullptr ? merge : test::graph::Add(g.get(), sum, merge);
+  }
+  test::graph::Send(g.get(), sum, "c", BOB, 1, ALICE);
+  Create(std::move(g));
+  for (int i = 0; i < 20; ++i) {
+    TF_ASSERT_OK(Run(rendez_));
+    Rendezvous::Args args;
+    Tensor out = V(-1);
+    bool is_dead = false;
+    TF_ASSERT_OK(rendez_->Recv(Key(BOB, kIncarnation, ALICE, "c"), args, &out,
+                               &is_dead));
+    EXPECT_FALSE(is_dead);
+    EXPECT_EQ(kNumFrames, V(out));
+  }
+}
+
 TEST_F(ExecutorTest, Abort) {
   // e = a + b + c + d
   auto g = std::make_unique<Graph>(OpRegistry::Global());
@@ -493,6 +684,164 @@ BENCHMARK(BM_executor)->UseRealTime()->ArgPair(8192, 32);
 // Tall fat graph
 BENCHMARK(BM_executor)->UseRealTime()->ArgPair(1024, 1024);
 
+// Creates a graph with a chain of 'depth' matrix multiplications, the critical
+// path. Each multiplication in the chain also feeds 'width' independent
+// multiplications, which compete with the chain for the threads. Reports the
+// p50 and p99 step latency with and without critical-path scheduling.
+static void BM_CriticalPathScheduling(::testing::benchmark::State& state) {
+  const int width = state.range(0);
+  const int depth = state.range(1);
+  const bool critical_path_scheduling = state.range(2);
+
+  auto g = std::make_unique<Graph>(OpRegistry::Global());
+  Tensor matrix(DT_FLOAT, TensorShape({64, 64}));
+  matrix.flat<float>().setConstant(1.0f / 64);
+  Node* weights = test::graph::Constant(g.get(), matrix);
+  Node* chain = test::graph::Constant(g.get(), matrix);
+  for (int i = 0; i < depth; ++i) {
+    for (int j = 0; j < width; ++j) {
+      test::graph::Matmul(g.get(), chain, weights, false, false);
+    }
+    chain = test::graph::Matmul(g.get(), chain, weights, false, false);
+  }
+  FixupSourceAndSinkEdges(g.get());
+
+  std::unique_ptr<Device> device = DeviceFactory::NewDevice(
+      "CPU", {}, "/job:localhost/replica:0/task:0");
+  const int version = g->versions().producer();
+  LocalExecutorParams params;
+  params.device = device.get();
+  params.create_kernel =
+      [&device, version](const std::shared_ptr<const NodeProperties>& props,
+                         OpKernel** kernel) {
+        return CreateNonCachedKernel(device.get(), nullptr, props, version,
+                                     kernel);
+      };
+  params.delete_kernel = [](OpKernel* kernel) {
+    DeleteNonCachedKernel(kernel);
+  };
+  params.critical_path_scheduling = critical_path_scheduling;
+  Executor* executor = nullptr;
+  TF_CHECK_OK(NewLocalExecutor(params, *g, &executor));
+  std::unique_ptr<Executor> executor_owner(executor);
+
+  thread::ThreadPool thread_pool(Env::Default(), "executor_benchmark",
+                                 /*num_threads=*/4);
+  Executor::Args args;
+  args.runner = [&thread_pool](std::function<void()> fn) {
+    thread_pool.Schedule(std::move(fn));
+  };
+  // Warms up the cost estimates.
+  for (int i = 0; i < 200; ++i) {
+    TF_CHECK_OK(executor->Run(args));
+  }
+
+  std::vector<int64_t> step_latencies_us;
+  for (auto s : state) {
+    const int64_t start_us = Env::Default()->NowMicros();
+    TF_CHECK_OK(executor->Run(args));
+    step_latencies_us.push_back(Env::Default()->NowMicros() - start_us);
+  }
+  std::sort(step_latencies_us.begin(), step_latencies_us.end());
+  const auto percentile = [&step_latencies_us](double p) {
+    return step_latencies_us[static_cast<size_t>(
+        p * (step_latencies_us.size() - 1))];
+  };
+  state.counters["p50_us"] = percentile(0.5);
+  state.counters["p99_us"] = percentile(0.99);
+  state.SetLabel(strings::StrCat("Nodes = ", (width + 1) * depth));
+  state.SetItemsProcessed((width + 1) * depth *
+                          static_cast<int64_t>(state.iterations()));
+}
+
+BENCHMARK(BM_CriticalPathScheduling)
+    ->UseRealTime()
+    ->Args({8, 64, false})
+    ->Args({8, 64, true})
+    ->Args({32, 64, false})
+    ->Args({32, 64, true})
+    ->Args({128, 16, false})
+    ->Args({128, 16, true});
+
+// A kernel that busy-waits for about one microsecond.
+class ExecutorTestSpinOp : public OpKernel {
+ public:
+  explicit ExecutorTestSpinOp(OpKernelConstruction* ctx) : OpKernel(ctx) {}
+
+  void Compute(OpKernelContext* ctx) override {
+    const uint64 end_nanos = Env::Default()->NowNanos() + 1000;
+    while (Env::Default()->NowNanos() < end_nanos) {
+    }
+  }
+};
+
+REGISTER_OP("ExecutorTestSpin");
+REGISTER_KERNEL_BUILDER(Name("ExecutorTestSpin").Device(DEVICE_CPU),
+                        ExecutorTestSpinOp);
+
+// Creates a graph of 'width' independent chains of 'depth' one-microsecond
+// kernels, and measures the overhead of recording their latencies in
+// `OpLatencyHistograms`.
+static void BM_OpLatencyRecording(::testing::benchmark::State& state) {
+  const int width = state.range(0);
+  const int depth = state.range(1);
+  const bool record_op_latency = state.range(2);
+
+  auto g = std::make_unique<Graph>(OpRegistry::Global());
+  for (int i = 0; i < width; ++i) {
+    Node* prev = nullptr;
+    for (int j = 0; j < depth; ++j) {
+      NodeBuilder builder(g->NewName("spin"), "ExecutorTestSpin");
+      if (prev != nullptr) {
+        builder.ControlInput(prev);
+      }
+      Node* node;
+      TF_CHECK_OK(builder.Finalize(g.get(), &node));
+      prev = node;
+    }
+  }
+  FixupSourceAndSinkEdges(g.get());
+
+  std::unique_ptr<Device> device = DeviceFactory::NewDevice(
+      "CPU", {}, "/job:localhost/replica:0/task:0");
+  const int version = g->versions().producer();
+  LocalExecutorParams params;
+  params.device = device.get();
+  params.create_kernel =
+      [&device, version](const std::shared_ptr<const NodeProperties>& props,
+                         OpKernel** kernel) {
+        return CreateNonCachedKernel(device.get(), nullptr, props, version,
+                                     kernel);
+      };
+  params.delete_kernel = [](OpKernel* kernel) {
+    DeleteNonCachedKernel(kernel);
+  };
+  params.record_op_latency = record_op_latency;
+  Executor* executor = nullptr;
+  TF_CHECK_OK(NewLocalExecutor(params, *g, &executor));
+  std::unique_ptr<Executor> executor_owner(executor);
+
+  thread::ThreadPool thread_pool(Env::Default(), "executor_benchmark",
+                                 /*num_threads=*/4);
+  Executor::Args args;
+  args.runner = [&thread_pool](std::function<void()> fn) {
+    thread_pool.Schedule(std::move(fn));
+  };
+  for (auto s : state) {
+    TF_CHECK_OK(executor->Run(args));
+  }
+  state.SetLabel(strings::StrCat("Nodes = ", width * depth));
+  state.SetItemsProcessed(width * depth *
+                          static_cast<int64_t>(state.iterations()));
+}
+
+BENCHMARK(BM_OpLatencyRecording)
+    ->UseRealTime()
+    ->Args({1, 1024, false})
+    ->Args({1, 1024, true})
+    ->Args({4, 256, false})
+    ->Args({4, 256, true});
+
 static void BM_const_identity(::testing::benchmark::State& state) {
   const int width = state.range(0);
   const int outputs_per_const = state.range(1);
@@ -593,10 +942,13 @@ absl::Status ReplaceEdgeWithSendRecv(Graph* g, const Edge* edge,
 //       i += 1;
 //
 // ...using the functional `WhileOp` (if `lower` is false) or the
-// `Switch`/`Merge`-style of control flow (if `lower` is true).
+// `Switch`/`Merge`-style of control flow (if `lower` is true). If `fanout` is
+// positive, `x` also feeds `fanout` nodes which are control inputs of the
+// update of `x`.
 static void BM_WhileLoopHelper(::testing::benchmark::State& state,
                                int loop_iters, int loop_vars, bool lower,
-                               bool transfer) {
+                               bool transfer, int fanout = 0,
+                               int inter_op_threads = 4) {
   std::unique_ptr<Graph> graph(new Graph(OpRegistry::Global()));
 
   // Add test functions for cond and body.
@@ -620,10 +972,18 @@ static void BM_WhileLoopHelper(::testing::benchmark::State& state,
   }
 
   std::vector<FunctionDefHelper::Node> body_nodes;
-  body_nodes.reserve(1 + loop_vars);
+  body_nodes.reserve(1 + loop_vars + fanout);
   body_nodes.push_back(
       {{"one"}, "Const", {}, {{"value", one_t}, {"dtype", DT_INT32}}});
-  body_nodes.push_back({{"y"}, "Add", {"x", "one"}, {{"T", DT_INT32}}});
+  std::vector<string> fanout_nodes;
+  fanout_nodes.reserve(fanout);
+  for (int i = 0; i < fanout; ++i) {
+    fanout_nodes.push_back(strings::StrCat("f", i));
+    body_nodes.push_back(
+        {{fanout_nodes.back()}, "Relu", {"x"}, {{"T", DT_INT32}}});
+  }
+  body_nodes.push_back(
+      {{"y"}, "Add", {"x", "one"}, {{"T", DT_INT32}}, fanout_nodes});
   for (int i = 1; i < loop_vars; ++i) {
     body_nodes.push_back({{strings::StrCat("y", i)},
                           "Relu",
@@ -725,7 +1085,7 @@ static void BM_WhileLoopHelper(::testing::benchmark::State& state,
   }
 
   SessionOptions options;
-  options.config.set_inter_op_parallelism_threads(4);
+  options.config.set_inter_op_parallelism_threads(inter_op_threads);
   FixupSourceAndSinkEdges(graph.get());
   test::Benchmark("cpu", graph.release(), &options, nullptr, nullptr, "",
                   /*old_benchmark_api=*/false)
@@ -770,6 +1130,27 @@ BENCHMARK(BM_LoweredWhileLoopWithTransfer)
     ->ArgPair(100, 5000)
     ->ArgPair(1000, 5000);
 
+// Measures the contention in the propagation of outputs within the frame of a
+// while loop, whose body has `fanout` nodes running concurrently in each
+// iteration on `inter_op_threads` threads.
+static void BM_LoweredWhileLoopFanout(::testing::benchmark::State& state) {
+  const int loop_iters = state.range(0);
+  const int fanout = state.range(1);
+  const int inter_op_threads = state.range(2);
+
+  BM_WhileLoopHelper(state, loop_iters, /* loop_vars= */ 1, /* lower= */ true,
+                     /* transfer= */ false, fanout, inter_op_threads);
+}
+BENCHMARK(BM_LoweredWhileLoopFanout)
+    ->UseRealTime()
+    ->Args({100, 1, 32})
+    ->Args({100, 16, 32})
+    ->Args({100, 256, 32})
+    ->Args({100, 16, 4})
+    ->Args({100, 256, 4})
+    ->Args({1000, 16, 32})
+    ->Args({1000, 256, 32});
+
 static void BM_FunctionalWhileLoop(::testing::benchmark::State& state) {
   const int loop_iters = state.range(0);
   const int loop_vars = state.range(1);
@@ -492,6 +492,71 @@ TEST_F(FunctionLibraryRuntimeTest, XTimesTwo_ConsumeArgument_DefaultExecutor) {
   EXPECT_EQ(single_threaded.Get(), 0);
 }
 
+class RetvalSlotCallFrame : public ConsumeArgumentCallFrame {
+ public:
+  RetvalSlotCallFrame(Tensor* arg, Tensor* retval, Tensor slot)
+      : ConsumeArgumentCallFrame(arg, retval), slot_(std::move(slot)) {}
+
+  bool GetRetvalSlot(int index, DataType dtype, const TensorShape& shape,
+                     Tensor* val) override {
+    if (index != 0 || !slot_.IsInitialized() || slot_.dtype() != dtype ||
+        slot_.shape() != shape) {
+      return false;
+    }
+    *val = std::move(slot_);
+    slot_ = Tensor();
+    return true;
+  }
+
+ private:
+  Tensor slot_;
+};
+
+TEST_F(FunctionLibraryRuntimeTest, XTimesTwo_RetvalSlot) {
+  Init({test::function::XTimesTwo()});
+  FunctionLibraryRuntime::Handle handle;
+  TF_CHECK_OK(flr0_->Instantiate(
+      "XTimesTwo", test::function::Attrs({{"T", DT_FLOAT}}), &handle));
+
+  // The return value is written into its slot of a batch, even though the
+  // argument could be forwarded to it.
+  Tensor batch(DT_FLOAT, TensorShape({2, 4}));
+  batch.flat<float>().setZero();
+  auto x = test::AsTensor<float>({1, 2, 3, 4});
+  Tensor y;
+  RetvalSlotCallFrame frame(&x, &y, batch.SubSlice(1));
+
+  FunctionLibraryRuntime::Options opts;
+  TF_CHECK_OK(Run(flr0_, handle, opts, &frame));
+
+  test::ExpectTensorEqual<float>(y, test::AsTensor<float>({2, 4, 6, 8}));
+  test::ExpectTensorEqual<float>(
+      batch, test::AsTensor<float>({0, 0, 0, 0, 2, 4, 6, 8}, {2, 4}));
+  EXPECT_TRUE(y.SharesBufferWith(batch));
+
+  TF_CHECK_OK(flr0_->ReleaseHandle(handle));
+}
+
+TEST_F(FunctionLibraryRuntimeTest, XTimesTwo_RetvalSlotOfOtherShape) {
+  Init({test::function::XTimesTwo()});
+  FunctionLibraryRuntime::Handle handle;
+  TF_CHECK_OK(flr0_->Instantiate(
+      "XTimesTwo", test::function::Attrs({{"T", DT_FLOAT}}), &handle));
+
+  Tensor batch(DT_FLOAT, TensorShape({2, 3}));
+  auto x = test::AsTensor<float>({1, 2, 3, 4});
+  Tensor y;
+  RetvalSlotCallFrame frame(&x, &y, batch.SubSlice(1));
+
+  FunctionLibraryRuntime::Options opts;
+  TF_CHECK_OK(Run(flr0_, handle, opts, &frame));
+
+  test::ExpectTensorEqual<float>(y, test::AsTensor<float>({2, 4, 6, 8}));
+  EXPECT_FALSE(y.SharesBufferWith(batch));
+
+  TF_CHECK_OK(flr0_->ReleaseHandle(handle));
+}
+
 TEST_F(FunctionLibraryRuntimeTest,
        XTimesTwo_ConsumeArgument_SingleThreadedExecutor) {
   Init({test::function::XTimesTwo()});
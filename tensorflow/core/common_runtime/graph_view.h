@@ -85,6 +85,9 @@ struct NodeItem {
                                     // node's input types.
   bool is_distributed_communication : 1;  // True iff the op is registered to
                                           // use distributed communication.
+  bool is_step_local : 1;  // True iff the outputs and temporaries of this
+                           // node cannot outlive the step, and the node is
+                           // in the root frame.
 
   // The kernel for this node.
   OpKernel* kernel = nullptr;
@@ -111,6 +114,17 @@ struct NodeItem {
   // is true if and only if the ith output is consumed by another node.
   std::unique_ptr<bool[]> outputs_required;
 
+  // If non-null, contains an array of num_inputs bools, where the ith bool is
+  // true if and only if this node is the last use of the tensor on the ith
+  // input, and no tensor outside the inputs of this node can share its
+  // buffer, so that the input may be forwarded to an output.
+  std::unique_ptr<bool[]> forwardable_inputs;
+
+  // If non-null, contains an array of num_outputs ints, where the ith int is
+  // the index of the function return value which the ith output becomes,
+  // directly or through a chain of Identity nodes, or -1.
+  std::unique_ptr<int[]> output_retval_indices;
+
   absl::Span<EdgeInfo> mutable_output_edges() {
     return absl::Span<EdgeInfo>(output_edge_base(), num_output_edges);
   }
@@ -15,10 +15,16 @@ limitations under the License.
 
 #include "tensorflow/core/common_runtime/immutable_executor_state.h"
 
+#include "absl/algorithm/container.h"
+#include "absl/container/flat_hash_set.h"
 #include "absl/memory/memory.h"
+#include "absl/strings/string_view.h"
+#include "tensorflow/core/common_runtime/device.h"
 #include "tensorflow/core/framework/function.h"
 #include "tensorflow/core/framework/metrics.h"
 #include "tensorflow/core/framework/node_def_util.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/graph/algorithm.h"
 #include "tensorflow/core/graph/edgeset.h"
 #include "tensorflow/core/graph/graph.h"
 #include "tensorflow/core/graph/graph_node_util.h"
@@ -31,6 +37,18 @@ namespace {
 bool IsInitializationOp(const Node* node) {
   return node->op_def().allows_uninitialized_input();
 }
+
+// Returns true if the op of `n` computes its outputs element-wise, and its
+// outputs share their buffer with no tensor other than an input which was
+// forwarded to them.
+bool IsElementwiseNonAliasingOp(const Node* n) {
+  static const auto* const kOps = new absl::flat_hash_set<absl::string_view>(
+      {"Abs", "Add", "AddV2", "BiasAdd", "Ceil", "Cos", "Div", "Elu", "Exp",
+       "Floor", "Log", "Maximum", "Minimum", "Mul", "Neg", "RealDiv", "Relu",
+       "Relu6", "Rsqrt", "Selu", "Sigmoid", "Sign", "Sin", "Softplus",
+       "Softsign", "Sqrt", "Square", "SquaredDifference", "Sub", "Tanh"});
+  return kOps->contains(n->type_string());
+}
 }  // namespace
 
 ImmutableExecutorState::~ImmutableExecutorState() {
@@ -259,9 +277,199 @@ absl::Status ImmutableExecutorState::Initialize(const Graph& graph) {
   // Initialize PendingCounts only after pending_ids_[node.id] is initialized
   // for all nodes.
   InitializePending(&graph, cf_info);
+  if (params_.use_step_arena || params_.use_static_memory_plan) {
+    InitializeStepLocalNodes(graph, cf_info);
+  }
+  if (params_.plan_input_forwarding && !requires_control_flow_) {
+    InitializeForwardableInputs(graph);
+  }
+  if (params_.device->device_type() == DEVICE_CPU) {
+    InitializeRetvalOutputs(graph);
+  }
   return gview_.SetAllocAttrs(&graph, params_.device);
 }
 
+namespace {
+// Returns true if `n` may keep a reference to its input or output tensors
+// after it completes, or pass them out of the graph.
+bool MayRetainTensors(const Node* n) {
+  if (n->op_def().is_stateful() || n->IsRetval() || IsTransferNode(n)) {
+    return true;
+  }
+  for (int i = 0; i < n->num_inputs(); ++i) {
+    if (IsRefType(n->input_type(i))) return true;
+  }
+  for (int i = 0; i < n->num_outputs(); ++i) {
+    if (IsRefType(n->output_type(i))) return true;
+  }
+  return false;
+}
+}  // namespace
+
+void ImmutableExecutorState::InitializeStepLocalNodes(
+    const Graph& graph, const ControlFlowInfo& cf_info) {
+  // The tensors allocated by a node escape the step if the node may retain
+  // them, or if a consumer may retain them or forward them to its own
+  // escaping outputs. Iterates to a fixed point because of loops.
+  std::vector<bool> escapes(graph.num_node_ids(), false);
+  for (const Node* n : graph.nodes()) {
+    escapes[n->id()] = MayRetainTensors(n);
+  }
+  std::vector<Node*> post_order;
+  GetPostOrder(graph, &post_order);
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (const Node* n : post_order) {
+      if (escapes[n->id()]) continue;
+      for (const Edge* e : n->out_edges()) {
+        if (!e->IsControlEdge() && escapes[e->dst()->id()]) {
+          escapes[n->id()] = true;
+          changed = true;
+          break;
+        }
+      }
+    }
+  }
+  // Nodes in loop frames run once per iteration, and the memory of their
+  // tensors would only be released when the step ends, so they are never
+  // step-local.
+  for (const Node* n : graph.nodes()) {
+    if (IsSink(n)) continue;
+    gview_.node(n->id())->is_step_local =
+        !escapes[n->id()] && cf_info.frame_names[n->id()].empty();
+  }
+}
+
+void ImmutableExecutorState::InitializeForwardableInputs(const Graph& graph) {
+  // The position of each node in a topological order. A node can only be an
+  // ancestor of nodes at later positions.
+  std::vector<Node*> order;
+  GetReversePostOrder(graph, &order);
+  std::vector<int> position(graph.num_node_ids(), -1);
+  for (int i = 0; i < order.size(); ++i) {
+    position[order[i]->id()] = i;
+  }
+
+  // Returns true if all `nodes` are ancestors of `n`.
+  std::vector<int> visited_by(graph.num_node_ids(), -1);
+  int num_searches = 0;
+  std::vector<const Node*> stack;
+  auto all_ancestors = [&](const Node* n,
+                           const std::vector<const Node*>& nodes) {
+    const int search = num_searches++;
+    int min_position = position[n->id()];
+    for (const Node* a : nodes) {
+      if (position[a->id()] >= position[n->id()]) return false;
+      min_position = std::min(min_position, position[a->id()]);
+    }
+    int num_found = 0;
+    stack.assign({n});
+    visited_by[n->id()] = search;
+    while (!stack.empty() && num_found < nodes.size()) {
+      const Node* cur = stack.back();
+      stack.pop_back();
+      for (const Edge* e : cur->in_edges()) {
+        const Node* src = e->src();
+        if (visited_by[src->id()] == search ||
+            position[src->id()] < min_position) {
+          continue;
+        }
+        visited_by[src->id()] = search;
+        num_found += absl::c_linear_search(nodes, src);
+        stack.push_back(src);
+      }
+    }
+    return num_found == nodes.size();
+  };
+
+  std::vector<const Node*> other_consumers;
+  for (const Node* n : graph.nodes()) {
+    if (IsSink(n) || n->num_inputs() == 0) continue;
+    std::unique_ptr<bool[]> forwardable(new bool[n->num_inputs()]);
+    std::fill(&forwardable[0], &forwardable[n->num_inputs()], false);
+    bool any_forwardable = false;
+    for (const Edge* e : n->in_edges()) {
+      if (e->IsControlEdge() || IsRefType(n->input_type(e->dst_input()))) {
+        continue;
+      }
+      const DataType dtype = n->input_type(e->dst_input());
+      if (!absl::c_linear_search(n->output_types(), dtype)) continue;
+      // Only the producer and the consumers of the tensor can hold its
+      // buffer, and only element-wise ops are known not to keep it alive in
+      // another tensor, e.g. a constant or a reshaped output.
+      if (!IsElementwiseNonAliasingOp(e->src())) continue;
+      // The node must be the only consumer of the tensor which may still run.
+      // It may consume the tensor more than once only if it is element-wise
+      // itself, since its forwarded output then aliases its other inputs.
+      other_consumers.clear();
+      bool other_consumers_alias = false;
+      bool consumed_twice = false;
+      for (const Edge* other : e->src()->out_edges()) {
+        if (other == e || other->src_output() != e->src_output()) continue;
+        if (other->dst() == n) {
+          consumed_twice = true;
+          continue;
+        }
+        other_consumers_alias |= !IsElementwiseNonAliasingOp(other->dst());
+        other_consumers.push_back(other->dst());
+      }
+      if (other_consumers_alias ||
+          (consumed_twice && !IsElementwiseNonAliasingOp(n))) {
+        continue;
+      }
+      forwardable[e->dst_input()] =
+          other_consumers.empty() || all_ancestors(n, other_consumers);
+      any_forwardable |= forwardable[e->dst_input()];
+    }
+    if (any_forwardable) {
+      gview_.node(n->id())->forwardable_inputs = std::move(forwardable);
+    }
+  }
+}
+
+void ImmutableExecutorState::InitializeRetvalOutputs(const Graph& graph) {
+  // Returns true if no data edge other than `e` carries the output of
+  // `e->src()` which `e` carries.
+  auto only_consumer = [](const Edge* e) {
+    for (const Edge* other : e->src()->out_edges()) {
+      if (other != e && !other->IsControlEdge() &&
+          other->src_output() == e->src_output()) {
+        return false;
+      }
+    }
+    return true;
+  };
+  for (const Node* n : graph.op_nodes()) {
+    if (!n->IsRetval() || n->num_inputs() != 1) continue;
+    int index;
+    if (!GetNodeAttr(n->attrs(), "index", &index).ok()) continue;
+    const Edge* e;
+    if (!n->input_edge(0, &e).ok()) continue;
+    // An Identity node forwards its input, so the producer of the chain
+    // allocates the tensor which the `_Retval` node returns.
+    while (only_consumer(e) && IsIdentity(e->src()) &&
+           e->src()->num_inputs() == 1 &&
+           !IsRefType(e->src()->input_type(0))) {
+      const Edge* input;
+      if (!e->src()->input_edge(0, &input).ok()) break;
+      e = input;
+    }
+    const Node* src = e->src();
+    if (!only_consumer(e) || IsIdentity(src) ||
+        IsRefType(src->output_type(e->src_output()))) {
+      continue;
+    }
+    NodeItem* item = gview_.node(src->id());
+    if (item->output_retval_indices == nullptr) {
+      item->output_retval_indices.reset(new int[src->num_outputs()]);
+      std::fill(&item->output_retval_indices[0],
+                &item->output_retval_indices[src->num_outputs()], -1);
+    }
+    item->output_retval_indices[e->src_output()] = index;
+  }
+}
+
 namespace {
 // If a Node has been marked to use a ScopedAllocator x for output i, then
 // sc_attr will contain the subsequence (i, x) at an even offset.  This function
@@ -126,6 +126,22 @@ class ImmutableExecutorState {
                                            ControlFlowInfo* cf_info);
   void InitializePending(const Graph* graph, const ControlFlowInfo& cf_info);
 
+  // Sets `NodeItem::is_step_local` for the nodes in the root frame whose
+  // outputs and temporaries cannot outlive the step.
+  void InitializeStepLocalNodes(const Graph& graph,
+                                const ControlFlowInfo& cf_info);
+
+  // Sets `NodeItem::forwardable_inputs` for the nodes which are the last use
+  // of an input whose buffer no other tensor can share.
+  //
+  // REQUIRES: `!requires_control_flow_`.
+  void InitializeForwardableInputs(const Graph& graph);
+
+  // Sets `NodeItem::output_retval_indices` for the nodes whose outputs are
+  // consumed only by a `_Retval` node, directly or through a chain of
+  // Identity nodes.
+  void InitializeRetvalOutputs(const Graph& graph);
+
   FrameInfo* EnsureFrameInfo(const string& fname);
 
   // Owned.
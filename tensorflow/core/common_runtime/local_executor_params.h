@@ -16,6 +16,7 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_COMMON_RUNTIME_LOCAL_EXECUTOR_PARAMS_H_
 #define TENSORFLOW_CORE_COMMON_RUNTIME_LOCAL_EXECUTOR_PARAMS_H_
 
+#include <cstdint>
 #include <functional>
 #include <memory>
 
@@ -50,6 +51,50 @@ struct LocalExecutorParams {
 
   // Whether control flow nodes are allowed to be executed synchronously.
   bool allow_control_flow_sync_execution = false;
+
+  // Whether ready nodes are scheduled in the order of their critical-path
+  // priority, i.e. the estimated cost of the longest path from a node to the
+  // end of the graph, instead of the order in which they become ready. Can
+  // also be enabled with the environment variable
+  // TF_EXECUTOR_CRITICAL_PATH_SCHEDULING.
+  bool critical_path_scheduling = false;
+
+  // Whether the latencies of kernels are recorded in per-op-type histograms,
+  // which are exported as the metric /tensorflow/core/op_latency_usecs. Can
+  // also be enabled with the environment variable
+  // TF_EXECUTOR_OP_LATENCY_HISTOGRAMS.
+  bool record_op_latency = false;
+
+  // Whether small intermediate host tensors which cannot outlive a step are
+  // allocated from a per-step arena on CPU devices, which is released as a
+  // whole when the step ends. Nodes in loop frames do not use the arena, and
+  // it stops serving allocations once it holds
+  // `StepArenaAllocator::kDefaultMaxArenaBytes`. If `track_step_arena` is
+  // true, the number of bytes allocated from the arena and from the device
+  // allocator is recorded for every step.
+  bool use_step_arena = false;
+  bool track_step_arena = false;
+
+  // Whether the outputs of nodes which cannot outlive a step are assigned
+  // fixed offsets in a buffer which is reused across steps, on CPU devices
+  // and in graphs without control flow. The plan is calibrated with the
+  // output sizes of the first steps, and outputs whose size changes are
+  // allocated dynamically.
+  bool use_static_memory_plan = false;
+
+  // Whether the inputs which may be forwarded to outputs are determined ahead
+  // of time, in graphs without control flow. An input is planned for
+  // forwarding if its node is the last consumer of the tensor, its type
+  // matches an output, and its producer and other consumers are element-wise
+  // ops which do not alias it. Planned inputs are forwarded even if their
+  // node consumes them more than once. Other inputs are still forwarded if
+  // nothing else references them at runtime.
+  bool plan_input_forwarding = false;
+
+  // If positive, the invocations of batchable nodes by concurrent steps on a
+  // CPU device are coalesced into one kernel invocation. The first invocation
+  // of a node waits up to this many microseconds for the others.
+  int64_t cross_step_batching_window_us = 0;
 };
 
 }  // end namespace tensorflow
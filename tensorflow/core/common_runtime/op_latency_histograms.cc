@@ -0,0 +1,251 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/op_latency_histograms.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "tensorflow/core/lib/core/bits.h"
+#include "tensorflow/core/platform/profile_utils/cpu_utils.h"
+
+namespace tensorflow {
+
+struct OpLatencyHistograms::Histogram {
+  // Only written by the owning thread.
+  std::atomic<uint64_t> counts[kNumBuckets] = {};
+  std::atomic<uint64_t> cycles{0};
+};
+
+// The histograms of one thread, indexed by op type id, which are allocated
+// when the thread first records a latency of the op type.
+class OpLatencyHistograms::ThreadHistograms {
+ public:
+  explicit ThreadHistograms(OpLatencyHistograms* owner)
+      : owner_(owner),
+        histograms_(new std::atomic<Histogram*>[kMaxOpTypes]) {
+    for (int i = 0; i < kMaxOpTypes; ++i) {
+      histograms_[i].store(nullptr, std::memory_order_relaxed);
+    }
+  }
+
+  ~ThreadHistograms() {
+    owner_->Retire(this);
+    for (int i = 0; i < kMaxOpTypes; ++i) {
+      delete histograms_[i].load(std::memory_order_relaxed);
+    }
+  }
+
+  // Must only be called by the owning thread.
+  Histogram* GetOrCreate(int32_t op_type_id) {
+    Histogram* histogram =
+        histograms_[op_type_id].load(std::memory_order_relaxed);
+    if (histogram == nullptr) {
+      histogram = new Histogram;
+      histograms_[op_type_id].store(histogram, std::memory_order_release);
+    }
+    return histogram;
+  }
+
+  const Histogram* Get(int32_t op_type_id) const {
+    return histograms_[op_type_id].load(std::memory_order_acquire);
+  }
+
+ private:
+  OpLatencyHistograms* const owner_;
+  std::unique_ptr<std::atomic<Histogram*>[]> histograms_;
+};
+
+OpLatencyHistograms* OpLatencyHistograms::Global() {
+  static OpLatencyHistograms* const histograms = new OpLatencyHistograms;
+  return histograms;
+}
+
+OpLatencyHistograms::OpLatencyHistograms()
+    : metric_def_("/tensorflow/core/op_latency_usecs",
+                  "Latency of op kernels in microseconds, by op type.", "op"),
+      registration_handle_(monitoring::CollectionRegistry::Default()->Register(
+          &metric_def_, [this](monitoring::MetricCollectorGetter getter) {
+            auto collector = getter.Get(&metric_def_);
+            std::vector<std::string> op_types;
+            {
+              mutex_lock l(mu_);
+              op_types = op_types_;
+            }
+            for (const std::string& op_type : op_types) {
+              HistogramProto histogram = Collect(op_type);
+              if (histogram.num() > 0) {
+                collector.CollectValue({op_type}, std::move(histogram));
+              }
+            }
+          })) {}
+
+int32_t OpLatencyHistograms::OpTypeId(absl::string_view op_type) {
+  mutex_lock l(mu_);
+  auto it = op_type_ids_.find(op_type);
+  if (it != op_type_ids_.end()) return it->second;
+  if (op_types_.size() >= static_cast<size_t>(kMaxOpTypes)) return -1;
+  const int32_t id = op_types_.size();
+  op_types_.emplace_back(op_type);
+  op_type_ids_.emplace(op_type, id);
+  return id;
+}
+
+void OpLatencyHistograms::Record(int32_t op_type_id, uint64_t cycles) {
+  if (op_type_id < 0) return;
+  Histogram* histogram = GetThreadHistograms()->GetOrCreate(op_type_id);
+  // No other thread writes the histogram, so the increments need not be
+  // atomic read-modify-writes.
+  std::atomic<uint64_t>& count = histogram->counts[BucketIndex(cycles)];
+  count.store(count.load(std::memory_order_relaxed) + 1,
+              std::memory_order_relaxed);
+  histogram->cycles.store(
+      histogram->cycles.load(std::memory_order_relaxed) + cycles,
+      std::memory_order_relaxed);
+}
+
+OpLatencyHistograms::ThreadHistograms*
+OpLatencyHistograms::GetThreadHistograms() {
+  thread_local std::unique_ptr<ThreadHistograms> thread_histograms;
+  if (thread_histograms == nullptr) {
+    thread_histograms = std::make_unique<ThreadHistograms>(this);
+    mutex_lock l(mu_);
+    threads_.push_back(thread_histograms.get());
+  }
+  return thread_histograms.get();
+}
+
+void OpLatencyHistograms::Retire(ThreadHistograms* thread_histograms) {
+  mutex_lock l(mu_);
+  for (size_t id = 0; id < op_types_.size(); ++id) {
+    const Histogram* histogram = thread_histograms->Get(id);
+    if (histogram == nullptr) continue;
+    if (retired_counts_.size() <= id) {
+      retired_counts_.resize(id + 1);
+      retired_cycles_.resize(id + 1, 0);
+    }
+    std::vector<uint64_t>& counts = retired_counts_[id];
+    counts.resize(kNumBuckets, 0);
+    for (int i = 0; i < kNumBuckets; ++i) {
+      counts[i] += histogram->counts[i].load(std::memory_order_relaxed);
+    }
+    retired_cycles_[id] += histogram->cycles.load(std::memory_order_relaxed);
+  }
+  threads_.erase(
+      std::find(threads_.begin(), threads_.end(), thread_histograms));
+}
+
+uint64_t OpLatencyHistograms::MergeCounts(
+    int32_t op_type_id, std::vector<uint64_t>* counts) const {
+  uint64_t cycles = 0;
+  if (static_cast<size_t>(op_type_id) < retired_counts_.size() &&
+      !retired_counts_[op_type_id].empty()) {
+    for (int i = 0; i < kNumBuckets; ++i) {
+      (*counts)[i] += retired_counts_[op_type_id][i];
+    }
+    cycles += retired_cycles_[op_type_id];
+  }
+  for (const ThreadHistograms* thread_histograms : threads_) {
+    const Histogram* histogram = thread_histograms->Get(op_type_id);
+    if (histogram == nullptr) continue;
+    for (int i = 0; i < kNumBuckets; ++i) {
+      (*counts)[i] += histogram->counts[i].load(std::memory_order_relaxed);
+    }
+    cycles += histogram->cycles.load(std::memory_order_relaxed);
+  }
+  return cycles;
+}
+
+HistogramProto OpLatencyHistograms::Collect(absl::string_view op_type) const {
+  HistogramProto proto;
+  std::vector<uint64_t> counts(kNumBuckets, 0);
+  uint64_t cycles;
+  {
+    mutex_lock l(mu_);
+    auto it = op_type_ids_.find(op_type);
+    if (it == op_type_ids_.end()) return proto;
+    cycles = MergeCounts(it->second, &counts);
+  }
+
+  const double usecs_per_cycle =
+      profile_utils::CpuUtils::GetMicroSecPerClock();
+  // Returns the smallest latency in microseconds above bucket `i`.
+  auto upper_bound = [&](int i) {
+    return i + 1 < kNumBuckets ? BucketLowerBound(i + 1) * usecs_per_cycle
+                               : DBL_MAX;
+  };
+  constexpr int kOverflowBucket = kNumBuckets - 1;
+  int first = kNumBuckets;
+  int last = -1;
+  double num = 0;
+  double sum_squares = 0;
+  for (int i = 0; i < kNumBuckets; ++i) {
+    if (counts[i] == 0) continue;
+    first = std::min(first, i);
+    last = i;
+    num += counts[i];
+    // Approximates the latencies in the bucket with its midpoint. The
+    // overflow bucket has no finite upper bound, so its lower bound is used.
+    const double lower = BucketLowerBound(i) * usecs_per_cycle;
+    const double mid =
+        i == kOverflowBucket ? lower : (lower + upper_bound(i)) / 2;
+    sum_squares += counts[i] * mid * mid;
+  }
+  if (last < 0) return proto;
+  proto.set_min(BucketLowerBound(first) * usecs_per_cycle);
+  proto.set_max(last == kOverflowBucket
+                    ? static_cast<double>(~uint64_t{0}) * usecs_per_cycle
+                    : upper_bound(last));
+  proto.set_num(num);
+  proto.set_sum(cycles * usecs_per_cycle);
+  proto.set_sum_squares(sum_squares);
+  for (int i = 0; i <= last; ++i) {
+    if (counts[i] == 0 && i > 0 && counts[i - 1] == 0) {
+      // Merges consecutive empty buckets.
+      proto.set_bucket_limit(proto.bucket_limit_size() - 1, upper_bound(i));
+      continue;
+    }
+    proto.add_bucket_limit(upper_bound(i));
+    proto.add_bucket(counts[i]);
+  }
+  // The limit of the overflow bucket is already DBL_MAX.
+  if (last != kOverflowBucket) {
+    proto.add_bucket_limit(DBL_MAX);
+    proto.add_bucket(0);
+  }
+  return proto;
+}
+
+int OpLatencyHistograms::BucketIndex(uint64_t cycles) {
+  if (cycles < kSubBuckets) return cycles;
+  if (cycles >> kMaxCycleBits != 0) return kNumBuckets - 1;
+  const int exponent = Log2Floor64(cycles);
+  return (exponent - kSubBucketBits + 1) * kSubBuckets +
+         (cycles >> (exponent - kSubBucketBits)) - kSubBuckets;
+}
+
+uint64_t OpLatencyHistograms::BucketLowerBound(int index) {
+  if (index < kSubBuckets) return index;
+  const int exponent = index / kSubBuckets + kSubBucketBits - 1;
+  return static_cast<uint64_t>(kSubBuckets + index % kSubBuckets)
+         << (exponent - kSubBucketBits);
+}
+
+}  // namespace tensorflow
@@ -0,0 +1,110 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_COMMON_RUNTIME_OP_LATENCY_HISTOGRAMS_H_
+#define TENSORFLOW_CORE_COMMON_RUNTIME_OP_LATENCY_HISTOGRAMS_H_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/string_view.h"
+#include "tensorflow/core/framework/summary.pb.h"
+#include "tensorflow/core/lib/monitoring/collection_registry.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+
+namespace tensorflow {
+
+// Records the latency of op kernels in histograms per op type, which are
+// exported as the metric /tensorflow/core/op_latency_usecs.
+//
+// Latencies are recorded in CPU cycles into histograms owned by the
+// recording thread, so recording takes no lock and writes no shared cache
+// line. Each power of two of cycles is divided into `kSubBuckets` buckets,
+// so the relative error of a recorded latency is at most 1 / kSubBuckets.
+// Latencies of at least 2^kMaxCycleBits cycles, which is minutes, share the
+// last bucket, which keeps the histograms of a thread small.
+// The histograms of all threads are merged when the metric is collected, and
+// the histograms of exiting threads are merged into a shared histogram.
+//
+// This class is thread-safe.
+class OpLatencyHistograms {
+ public:
+  static constexpr int kSubBucketBits = 5;
+  static constexpr int kSubBuckets = 1 << kSubBucketBits;
+  static constexpr int kMaxCycleBits = 40;
+  static constexpr int kNumBuckets =
+      (kMaxCycleBits - kSubBucketBits + 1) * kSubBuckets + 1;
+  // Op types registered after this many are not recorded.
+  static constexpr int kMaxOpTypes = 4096;
+
+  // Returns the process-wide instance.
+  static OpLatencyHistograms* Global();
+
+  // Returns the id with which the latencies of `op_type` are recorded, or -1
+  // if too many op types are registered.
+  int32_t OpTypeId(absl::string_view op_type);
+
+  // Records that a kernel of the op type with `op_type_id` ran for `cycles`
+  // CPU cycles. Does nothing if `op_type_id` is negative.
+  void Record(int32_t op_type_id, uint64_t cycles);
+
+  // Returns the merged histogram of `op_type` in microseconds. Consecutive
+  // empty buckets are merged.
+  HistogramProto Collect(absl::string_view op_type) const;
+
+  // Returns the index of the bucket of `cycles`, and the smallest number of
+  // cycles in the bucket with `index`.
+  static int BucketIndex(uint64_t cycles);
+  static uint64_t BucketLowerBound(int index);
+
+ private:
+  struct Histogram;
+  class ThreadHistograms;
+
+  OpLatencyHistograms();
+
+  // Returns the histograms of the calling thread.
+  ThreadHistograms* GetThreadHistograms();
+  // Merges the histograms of an exiting thread into `retired_`.
+  void Retire(ThreadHistograms* thread_histograms);
+
+  // Adds the counts of op type `op_type_id` in all threads to `counts`, and
+  // returns their sum of cycles.
+  uint64_t MergeCounts(int32_t op_type_id, std::vector<uint64_t>* counts) const
+      TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  mutable mutex mu_;
+  absl::flat_hash_map<std::string, int32_t> op_type_ids_ TF_GUARDED_BY(mu_);
+  std::vector<std::string> op_types_ TF_GUARDED_BY(mu_);
+  std::vector<ThreadHistograms*> threads_ TF_GUARDED_BY(mu_);
+  // The counts and sums of cycles of exited threads, indexed by op type id.
+  std::vector<std::vector<uint64_t>> retired_counts_ TF_GUARDED_BY(mu_);
+  std::vector<uint64_t> retired_cycles_ TF_GUARDED_BY(mu_);
+
+  const monitoring::MetricDef<monitoring::MetricKind::kCumulative,
+                              HistogramProto, 1>
+      metric_def_;
+  std::unique_ptr<monitoring::CollectionRegistry::RegistrationHandle>
+      registration_handle_;
+};
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_COMMON_RUNTIME_OP_LATENCY_HISTOGRAMS_H_
@@ -0,0 +1,142 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/op_latency_histograms.h"
+
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "tensorflow/core/framework/summary.pb.h"
+#include "tensorflow/core/lib/monitoring/collected_metrics.h"
+#include "tensorflow/core/lib/monitoring/collection_registry.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/profile_utils/cpu_utils.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+
+namespace tensorflow {
+namespace {
+
+TEST(OpLatencyHistogramsTest, Buckets) {
+  for (int i = 0; i < OpLatencyHistograms::kNumBuckets; ++i) {
+    const uint64_t lower = OpLatencyHistograms::BucketLowerBound(i);
+    EXPECT_EQ(OpLatencyHistograms::BucketIndex(lower), i) << lower;
+    if (i > 0) {
+      EXPECT_EQ(OpLatencyHistograms::BucketIndex(lower - 1), i - 1) << lower;
+    }
+  }
+  EXPECT_EQ(OpLatencyHistograms::BucketIndex(~uint64_t{0}),
+            OpLatencyHistograms::kNumBuckets - 1);
+  EXPECT_EQ(OpLatencyHistograms::BucketLowerBound(
+                OpLatencyHistograms::kNumBuckets - 1),
+            uint64_t{1} << OpLatencyHistograms::kMaxCycleBits);
+  // Each power of two is divided into 32 buckets.
+  EXPECT_EQ(OpLatencyHistograms::BucketLowerBound(
+                OpLatencyHistograms::BucketIndex(1000)),
+            992);
+}
+
+TEST(OpLatencyHistogramsTest, OpTypeIds) {
+  OpLatencyHistograms* histograms = OpLatencyHistograms::Global();
+  const int32_t id = histograms->OpTypeId("OpLatencyHistogramsTest.A");
+  EXPECT_GE(id, 0);
+  EXPECT_EQ(histograms->OpTypeId("OpLatencyHistogramsTest.A"), id);
+  EXPECT_NE(histograms->OpTypeId("OpLatencyHistogramsTest.B"), id);
+  EXPECT_EQ(histograms->Collect("OpLatencyHistogramsTest.A").num(), 0);
+}
+
+TEST(OpLatencyHistogramsTest, MergesThreads) {
+  OpLatencyHistograms* histograms = OpLatencyHistograms::Global();
+  const std::string op_type = "OpLatencyHistogramsTest.MergesThreads";
+  const int32_t id = histograms->OpTypeId(op_type);
+  histograms->Record(id, 1000);
+  // The histograms of the other thread are retired when it exits.
+  std::unique_ptr<Thread> thread(
+      Env::Default()->StartThread({}, "record", [histograms, id] {
+        histograms->Record(id, 1000);
+        histograms->Record(id, 100000);
+      }));
+  thread.reset();
+
+  const double usecs_per_cycle =
+      profile_utils::CpuUtils::GetMicroSecPerClock();
+  HistogramProto histogram = histograms->Collect(op_type);
+  EXPECT_EQ(histogram.num(), 3);
+  EXPECT_DOUBLE_EQ(histogram.sum(), 102000 * usecs_per_cycle);
+  EXPECT_DOUBLE_EQ(histogram.min(), 992 * usecs_per_cycle);
+  EXPECT_GT(histogram.max(), 100000 * usecs_per_cycle);
+  ASSERT_EQ(histogram.bucket_size(), histogram.bucket_limit_size());
+  double num = 0;
+  for (double count : histogram.bucket()) num += count;
+  EXPECT_EQ(num, 3);
+}
+
+TEST(OpLatencyHistogramsTest, OverflowBucket) {
+  OpLatencyHistograms* histograms = OpLatencyHistograms::Global();
+  const std::string op_type = "OpLatencyHistogramsTest.OverflowBucket";
+  const int32_t id = histograms->OpTypeId(op_type);
+  histograms->Record(id, 1000);
+  histograms->Record(id, ~uint64_t{0});
+
+  HistogramProto histogram = histograms->Collect(op_type);
+  EXPECT_EQ(histogram.num(), 2);
+  EXPECT_TRUE(std::isfinite(histogram.max()));
+  EXPECT_TRUE(std::isfinite(histogram.sum_squares()));
+  ASSERT_EQ(histogram.bucket_size(), histogram.bucket_limit_size());
+  // The overflow bucket is the last bucket, and its limit is not repeated.
+  EXPECT_EQ(histogram.bucket_limit(histogram.bucket_limit_size() - 1),
+            DBL_MAX);
+  EXPECT_EQ(histogram.bucket(histogram.bucket_size() - 1), 1);
+  for (int i = 1; i < histogram.bucket_limit_size(); ++i) {
+    EXPECT_LT(histogram.bucket_limit(i - 1), histogram.bucket_limit(i));
+  }
+}
+
+TEST(OpLatencyHistogramsTest, ExportsMetric) {
+  OpLatencyHistograms* histograms = OpLatencyHistograms::Global();
+  const std::string op_type = "OpLatencyHistogramsTest.ExportsMetric";
+  histograms->Record(histograms->OpTypeId(op_type), 5000);
+
+  std::unique_ptr<monitoring::CollectedMetrics> metrics =
+      monitoring::CollectionRegistry::Default()->CollectMetrics({});
+  auto it = metrics->point_set_map.find("/tensorflow/core/op_latency_usecs");
+  ASSERT_NE(it, metrics->point_set_map.end());
+  int num_points = 0;
+  for (const auto& point : it->second->points) {
+    ASSERT_EQ(point->labels.size(), 1);
+    if (point->labels[0].value != op_type) continue;
+    ++num_points;
+    EXPECT_EQ(point->labels[0].name, "op");
+    EXPECT_EQ(point->histogram_value.num(), 1);
+  }
+  EXPECT_EQ(num_points, 1);
+}
+
+void BM_Record(::testing::benchmark::State& state) {
+  OpLatencyHistograms* histograms = OpLatencyHistograms::Global();
+  const int32_t id = histograms->OpTypeId("OpLatencyHistogramsTest.BM_Record");
+  uint64_t cycles = 1;
+  for (auto s : state) {
+    histograms->Record(id, cycles);
+    cycles = cycles * 33 % 100003;
+  }
+}
+BENCHMARK(BM_Record);
+
+}  // namespace
+}  // namespace tensorflow
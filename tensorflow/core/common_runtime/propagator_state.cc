@@ -331,9 +331,14 @@ void PropagatorState::DeleteFrame(FrameState* frame, TaggedNodeSeq* ready) {
         }
       };
 
+      // Nodes running in `parent_iter_state` activate their successors
+      // without holding `parent_frame->mu`, so the pending counts must be
+      // updated atomically here as well.
       auto propagate_to_non_merge = [&](PendingCounts::Handle dst_pending_id) {
-        parent_iter_state->increment_dead_count(dst_pending_id);
-        return parent_iter_state->decrement_pending(dst_pending_id, 1) == 0;
+        return parent_iter_state
+                   ->adjust_for_activation_atomic(dst_pending_id,
+                                                  /*increment_dead=*/true)
+                   .pending_count == 0;
       };
 
       for (const EdgeInfo& e : item->output_edges()) {
@@ -345,11 +350,11 @@ void PropagatorState::DeleteFrame(FrameState* frame, TaggedNodeSeq* ready) {
         bool dst_ready;
         // We know this is a dead input to dst.
         if (dst_item.is_merge) {
-          parent_iter_state->increment_dead_count(dst_pending_id);
-          const int dead_cnt = parent_iter_state->dead_count(dst_pending_id);
-          dst_dead = (dead_cnt == dst_item.num_inputs);
-          dst_ready =
-              (parent_iter_state->pending(dst_pending_id) == 1) && dst_dead;
+          const PendingCounts::AdjustResult adjust_result =
+              parent_iter_state->adjust_for_increment_dead_atomic(
+                  dst_pending_id);
+          dst_dead = (adjust_result.dead_count == dst_item.num_inputs);
+          dst_ready = (adjust_result.pending_count == 1) && dst_dead;
         } else {
           dst_ready = propagate_to_non_merge(dst_pending_id);
         }
@@ -365,11 +370,12 @@ void PropagatorState::DeleteFrame(FrameState* frame, TaggedNodeSeq* ready) {
         bool dst_ready;
         // We know this is a dead input to dst.
         if (dst_item.is_merge) {
-          parent_iter_state->decrement_pending(dst_pending_id, 2);
-          int count = parent_iter_state->pending(dst_pending_id);
-          int dead_cnt = parent_iter_state->dead_count(dst_pending_id);
-          dst_dead = (dead_cnt == dst_item.num_inputs);
-          dst_ready = (count == 0) || ((count == 1) && dst_dead);
+          const PendingCounts::AdjustResult adjust_result =
+              parent_iter_state->adjust_for_decrement_pending_atomic(
+                  dst_pending_id, /*decrement_pending=*/2);
+          dst_dead = (adjust_result.dead_count == dst_item.num_inputs);
+          dst_ready = (adjust_result.pending_count == 0) ||
+                      ((adjust_result.pending_count == 1) && dst_dead);
         } else {
           dst_dead = true;
           dst_ready = propagate_to_non_merge(dst_pending_id);
@@ -645,26 +651,40 @@ int PropagatorState::FrameState::ActivateNodesSlowPathShared(
 bool PropagatorState::FrameState::ActivateNodesAndAdjustOutstanding(
     const NodeItem* item, const bool is_dead, IterationState* iter_state,
     EntryVector* outputs, TaggedNodeSeq* ready, int decrement_activation) {
+  if (TF_PREDICT_TRUE(decrement_activation > 0)) {
+    // The activating node is itself outstanding in `iter_state`, so the
+    // iteration cannot be deleted before AdjustOutstandingOps() below, and
+    // the successors can be activated without holding `mu`.
+    int activated =
+        ActivateNodesLockFree(item, is_dead, iter_state, outputs, ready);
+    return AdjustOutstandingOps(iter_state, activated - decrement_activation,
+                                ready);
+  }
   if (TF_PREDICT_FALSE(item->is_any_consumer_merge_or_control_trigger)) {
     tf_shared_lock l(mu);
     int activated =
         ActivateNodesSlowPathShared(item, is_dead, iter_state, outputs, ready);
-    bool iter_done = AdjustOutstandingOpsFastPath(
-        iter_state, activated - decrement_activation);
+    bool iter_done = AdjustOutstandingOpsFastPath(iter_state, activated);
     if (!iter_done) return false;
   } else {
     tf_shared_lock l(mu);
     int activated =
         ActivateNodesFastPathShared(item, is_dead, iter_state, outputs, ready);
-    bool iter_done = AdjustOutstandingOpsFastPath(
-        iter_state, activated - decrement_activation);
+    bool iter_done = AdjustOutstandingOpsFastPath(iter_state, activated);
     if (!iter_done) return false;
   }
-  if (decrement_activation > 0) {
-    mutex_lock l(mu);
-    return CleanupIterations(iter_state, ready);
+  return true;
+}
+
+int PropagatorState::FrameState::ActivateNodesLockFree(
+    const NodeItem* item, const bool is_dead, IterationState* iter_state,
+    EntryVector* outputs, TaggedNodeSeq* ready) {
+  if (TF_PREDICT_FALSE(item->is_any_consumer_merge_or_control_trigger)) {
+    return ActivateNodesSlowPathInternal<true>(item, is_dead, iter_state,
+                                               outputs, ready);
   } else {
-    return true;
+    return ActivateNodesFastPathInternal<true>(item, is_dead, iter_state,
+                                               outputs, ready);
   }
 }
 
@@ -673,6 +693,14 @@ int PropagatorState::FrameState::ActivateNodesLocked(const NodeItem* item,
                                                      IterationState* iter_state,
                                                      EntryVector* outputs,
                                                      TaggedNodeSeq* ready) {
+  // Other threads may be activating nodes in `iter_state` without holding
+  // `mu`, so the pending counts must still be updated atomically.
+  return ActivateNodesLockFree(item, is_dead, iter_state, outputs, ready);
+}
+
+int PropagatorState::FrameState::ActivateNodesInNewIterationLocked(
+    const NodeItem* item, const bool is_dead, IterationState* iter_state,
+    EntryVector* outputs, TaggedNodeSeq* ready) {
   if (TF_PREDICT_FALSE(item->is_any_consumer_merge_or_control_trigger)) {
     return ActivateNodesSlowPathLocked(item, is_dead, iter_state, outputs,
                                        ready);
@@ -691,8 +719,8 @@ void PropagatorState::FrameState::ActivateNexts(IterationState* iter_state,
     const Entry& entry = node_entry.second;
     const bool is_dead = entry.state == Entry::State::NO_VALUE;
     EntryVector outputs{entry};
-    activated +=
-        ActivateNodesLocked(item, is_dead, iter_state, &outputs, ready);
+    activated += ActivateNodesInNewIterationLocked(item, is_dead, iter_state,
+                                                   &outputs, ready);
   }
   next_iter_roots.clear();
   AdjustOutstandingOpsLocked(iter_state, activated, ready);
@@ -708,8 +736,8 @@ void PropagatorState::FrameState::ActivateLoopInvs(IterationState* iter_state,
     const Entry& entry = node_entry.second;
     const bool is_dead = entry.state == Entry::State::NO_VALUE;
     EntryVector outputs{entry};
-    activated +=
-        ActivateNodesLocked(item, is_dead, iter_state, &outputs, ready);
+    activated += ActivateNodesInNewIterationLocked(item, is_dead, iter_state,
+                                                   &outputs, ready);
   }
   AdjustOutstandingOpsLocked(iter_state, activated, ready);
 }
@@ -850,6 +878,16 @@ bool PropagatorState::FrameState::AdjustOutstandingOps(
   if (delta == 0) {
     return false;
   }
+  // The caller is itself outstanding in `iter_state`, so the iteration is
+  // alive, and it cannot be done unless this adjustment drops the count to
+  // zero. Only that adjustment needs `mu` to check for completion.
+  size_t old_val = iter_state->outstanding_ops.load(std::memory_order_relaxed);
+  while (old_val + delta != 0) {
+    if (iter_state->outstanding_ops.compare_exchange_weak(old_val,
+                                                          old_val + delta)) {
+      return false;
+    }
+  }
   {
     tf_shared_lock sl(mu);
     if (TF_PREDICT_TRUE(!AdjustOutstandingOpsFastPath(iter_state, delta))) {
@@ -877,14 +915,13 @@ bool PropagatorState::FrameState::DecrementOutstandingOpsLocked(
 
 bool PropagatorState::FrameState::AdjustOutstandingOpsLocked(
     IterationState* iter_state, int delta, TaggedNodeSeq* ready) {
-  // We hold the lock, so we don't need to use an atomic modification.
-  auto cur_val = iter_state->outstanding_ops.load(std::memory_order_relaxed);
+  // Holding `mu` does not exclude AdjustOutstandingOps(), which updates the
+  // count of a live iteration without the lock, so the update must be atomic.
+  auto cur_val = iter_state->outstanding_ops.fetch_add(delta);
   DCHECK(delta >= 0 || cur_val >= -delta)
       << "cannot adjust outstanding_ops by " << delta
       << " when current value is " << cur_val;
-  auto new_val = cur_val + delta;
-  iter_state->outstanding_ops.store(new_val, std::memory_order_relaxed);
-  if (new_val != 0) {
+  if (cur_val + delta != 0) {
     return false;
   }
   return CleanupIterations(iter_state, ready);
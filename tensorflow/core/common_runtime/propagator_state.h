@@ -337,7 +337,9 @@ class PropagatorState {
     // the frame if no more ops are oustanding. Return true iff the execution of
     // the frame is done.
     //
-    // Avoids acquiring the lock in the common case that the frame is not done.
+    // REQUIRES: The caller is one of the outstanding ops of `iter_state`.
+    //
+    // Avoids acquiring the lock unless the adjustment drops the count to zero.
     bool AdjustOutstandingOps(IterationState* iter_state, int delta,
                               TaggedNodeSeq* ready);
 
@@ -385,9 +387,10 @@ class PropagatorState {
     // Activate the successors of a node. Contents of *outputs are left in an
     // indeterminate state after returning from this method.
     //
-    // In the case that 'item' is a simple node (no merge/control outputs) this
-    // will acquire a shared lock and can run concurrently with other
-    // invocations.
+    // If `decrement_activation` is positive, `item` must be outstanding in
+    // `iter_state`, and the successors are activated with atomic operations
+    // without acquiring the lock. Otherwise this acquires a shared lock. In
+    // both cases it can run concurrently with other invocations.
     //
     // Return true if the frame is done after activation.
     bool ActivateNodesAndAdjustOutstanding(
@@ -400,6 +403,16 @@ class PropagatorState {
                             TaggedNodeSeq* ready)
         TF_EXCLUSIVE_LOCKS_REQUIRED(mu);
 
+    // Same as the above, but `iter_state` must not have been published to
+    // other threads yet, so that the pending counts can be updated without
+    // atomic operations.
+    int ActivateNodesInNewIterationLocked(const NodeItem* item,
+                                          const bool is_dead,
+                                          IterationState* iter_state,
+                                          EntryVector* outputs,
+                                          TaggedNodeSeq* ready)
+        TF_EXCLUSIVE_LOCKS_REQUIRED(mu);
+
     // Cleanup iterations of this frame starting from the given iteration.
     bool CleanupIterations(IterationState* iter_state, TaggedNodeSeq* ready)
         TF_EXCLUSIVE_LOCKS_REQUIRED(mu);
@@ -424,7 +437,7 @@ class PropagatorState {
    private:
     // REQUIRES: `!item->is_any_consumer_merge_or_control_trigger`.
     // This variant does not use atomic operations to modify the pending counts
-    // and thus must hold the exclusive lock.
+    // and thus must hold the exclusive lock on an unpublished iteration.
     int ActivateNodesFastPathLocked(const NodeItem* item, bool is_dead,
                                     IterationState* iter_state,
                                     EntryVector* outputs, TaggedNodeSeq* ready)
@@ -447,6 +460,13 @@ class PropagatorState {
                                     EntryVector* outputs, TaggedNodeSeq* ready)
         TF_SHARED_LOCKS_REQUIRED(mu);
 
+    // Uses atomic operations to modify the pending counts, and does not
+    // require `mu`. The caller must ensure that `iter_state` stays alive,
+    // e.g. by being one of its outstanding ops.
+    int ActivateNodesLockFree(const NodeItem* item, bool is_dead,
+                              IterationState* iter_state, EntryVector* outputs,
+                              TaggedNodeSeq* ready);
+
     // Implementation templates. Not for public use.
     template <bool atomic>
     int ActivateNodesFastPathInternal(const NodeItem* item, bool is_dead,
@@ -35,6 +35,15 @@ limitations under the License.
 namespace tensorflow {
 
 namespace {
+// Returns true if the tensor can be passed from sender to receiver without a
+// copy.
+bool IsHostToHost(const Rendezvous::ParsedKey& parsed,
+                  const Rendezvous::Args& send_args,
+                  const Rendezvous::Args& recv_args) {
+  return (send_args.alloc_attrs.on_host() || parsed.src.type == "CPU") &&
+         (recv_args.alloc_attrs.on_host() || parsed.dst.type == "CPU");
+}
+
 void SameWorkerRecvDone(const DeviceMgr* device_mgr,
                         const Rendezvous::ParsedKey& parsed,
                         const Rendezvous::Args& send_args,
@@ -42,11 +51,7 @@ void SameWorkerRecvDone(const DeviceMgr* device_mgr,
                         Tensor* out, StatusCallback done) {
   // Do a quick copy (sharing the underlying buffer) if both tensors
   // are on host memory.
-  const bool src_host =
-      (send_args.alloc_attrs.on_host() || parsed.src.type == "CPU");
-  const bool dst_host =
-      (recv_args.alloc_attrs.on_host() || parsed.dst.type == "CPU");
-  if (src_host && dst_host) {
+  if (IsHostToHost(parsed, send_args, recv_args)) {
     if (VLOG_IS_ON(3)) {
       bool src_override =
           send_args.alloc_attrs.on_host() && !(parsed.src.type == "CPU");
@@ -164,12 +169,41 @@ void IntraProcessRecvAsyncImpl(const DeviceMgr* device_mgr,
       });
 }
 
+// Like IntraProcessRecvAsyncImpl(), but receives from a slot of `local`.
+// Host tensors are passed to `done` directly, and `parsed` is referenced
+// rather than copied, since it outlives the call of `done`.
+void IntraProcessRecvFromSlotAsyncImpl(
+    const DeviceMgr* device_mgr, LocalRendezvous* local, int64_t slot,
+    const RendezvousInterface::ParsedKey& parsed,
+    const Rendezvous::Args& recv_args, RendezvousInterface::DoneCallback done) {
+  local->RecvFromSlotAsync(
+      slot, parsed, recv_args,
+      [device_mgr, &parsed, done = std::move(done)](
+          const absl::Status& status, const Rendezvous::Args& send_args,
+          const Rendezvous::Args& recv_args, const Tensor& in,
+          bool is_dead) mutable {
+        if (!status.ok() || !in.IsInitialized() ||
+            IsHostToHost(parsed, send_args, recv_args)) {
+          done(status, send_args, recv_args, in, is_dead);
+          return;
+        }
+        Tensor* out = new Tensor;
+        SameWorkerRecvDone(
+            device_mgr, parsed, send_args, recv_args, in, out,
+            [send_args, recv_args, out, is_dead,
+             done = std::move(done)](const absl::Status& s) {
+              done(s, send_args, recv_args, *out, is_dead);
+              delete out;
+            });
+      });
+}
+
 }  // namespace
 
 RefCountedIntraProcessRendezvous::RefCountedIntraProcessRendezvous(
-    const DeviceMgr* device_mgr)
+    const DeviceMgr* device_mgr, int64_t num_slots)
     : device_mgr_(device_mgr),
-      local_(this, /* num_shards= */ device_mgr->NumDevices()) {}
+      local_(this, /* num_shards= */ device_mgr->NumDevices(), num_slots) {}
 
 RefCountedIntraProcessRendezvous::~RefCountedIntraProcessRendezvous() {
   VLOG(5) << "Destructor of IntraProcessRendezvous: " << this;
@@ -189,6 +223,21 @@ void RefCountedIntraProcessRendezvous::RecvAsync(const ParsedKey& key,
   IntraProcessRecvAsyncImpl(device_mgr_, &local_, key, args, std::move(done));
 }
 
+absl::Status RefCountedIntraProcessRendezvous::SendToSlot(
+    int64_t slot, const ParsedKey& key, const Rendezvous::Args& args,
+    const Tensor& val, const bool is_dead) {
+  DVLOG(1) << "IntraProcessRendezvous Send " << this << " slot " << slot;
+  return local_.SendToSlot(slot, key, args, val, is_dead);
+}
+
+void RefCountedIntraProcessRendezvous::RecvFromSlotAsync(
+    int64_t slot, const ParsedKey& key, const Rendezvous::Args& args,
+    DoneCallback done) {
+  DVLOG(1) << "IntraProcessRendezvous Recv " << this << " slot " << slot;
+  IntraProcessRecvFromSlotAsyncImpl(device_mgr_, &local_, slot, key, args,
+                                    std::move(done));
+}
+
 void RefCountedIntraProcessRendezvous::StartAbort(const absl::Status& s) {
   VLOG(1) << "IntraProcessRendezvous start Abort " << this;
   local_.StartAbort(s);
@@ -199,9 +248,10 @@ absl::Status RefCountedIntraProcessRendezvous::GetLocalRendezvousStatus() {
 }
 
 PrivateIntraProcessRendezvous::PrivateIntraProcessRendezvous(
-    const DeviceMgr* device_mgr)
+    const DeviceMgr* device_mgr, int64_t num_slots)
     : device_mgr_(device_mgr),
-      local_(nullptr, /* num_shards= */ device_mgr->NumDevices()) {}
+      local_(nullptr, /* num_shards= */ device_mgr->NumDevices(), num_slots) {
+}
 
 PrivateIntraProcessRendezvous::~PrivateIntraProcessRendezvous() {}
 
@@ -221,6 +271,21 @@ void PrivateIntraProcessRendezvous::RecvAsync(const ParsedKey& key,
   IntraProcessRecvAsyncImpl(device_mgr_, &local_, key, args, std::move(done));
 }
 
+absl::Status PrivateIntraProcessRendezvous::SendToSlot(
+    int64_t slot, const ParsedKey& key, const Rendezvous::Args& args,
+    const Tensor& val, const bool is_dead) {
+  DVLOG(1) << "IntraProcessRendezvous Send " << this << " slot " << slot;
+  return local_.SendToSlot(slot, key, args, val, is_dead);
+}
+
+void PrivateIntraProcessRendezvous::RecvFromSlotAsync(
+    int64_t slot, const ParsedKey& key, const Rendezvous::Args& args,
+    DoneCallback done) {
+  DVLOG(1) << "IntraProcessRendezvous Recv " << this << " slot " << slot;
+  IntraProcessRecvFromSlotAsyncImpl(device_mgr_, &local_, slot, key, args,
+                                    std::move(done));
+}
+
 void PrivateIntraProcessRendezvous::StartAbort(const absl::Status& s) {
   local_.StartAbort(s);
 }
@@ -16,6 +16,7 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_COMMON_RUNTIME_RENDEZVOUS_MGR_H_
 #define TENSORFLOW_CORE_COMMON_RUNTIME_RENDEZVOUS_MGR_H_
 
+#include <cstdint>
 #include <string>
 #include <unordered_map>
 
@@ -42,7 +43,10 @@ namespace tensorflow {
 // Reference-counted implementation that may be shared between multiple threads.
 class RefCountedIntraProcessRendezvous : public Rendezvous {
  public:
-  explicit RefCountedIntraProcessRendezvous(const DeviceMgr* device_mgr);
+  // `num_slots` is the size of the table used by SendToSlot() and
+  // RecvFromSlotAsync().
+  explicit RefCountedIntraProcessRendezvous(const DeviceMgr* device_mgr,
+                                            int64_t num_slots = 0);
 
   // Implementation of RendezvousInterface methods.
   // NOTE: The methods may clear the Item list and destroy 'this' if there are
@@ -53,6 +57,12 @@ class RefCountedIntraProcessRendezvous : public Rendezvous {
                     const Tensor& val, const bool is_dead) override;
   void RecvAsync(const ParsedKey& key, const Rendezvous::Args& args,
                  DoneCallback done) override;
+  absl::Status SendToSlot(int64_t slot, const ParsedKey& key,
+                          const Rendezvous::Args& args, const Tensor& val,
+                          const bool is_dead) override;
+  void RecvFromSlotAsync(int64_t slot, const ParsedKey& key,
+                         const Rendezvous::Args& args,
+                         DoneCallback done) override;
   void StartAbort(const absl::Status& status) override;
 
   // Returns the member LocalRendezvous' status.
@@ -83,7 +93,8 @@ using IntraProcessRendezvous = RefCountedIntraProcessRendezvous;
 // Prefer to use PrivateIntraProcessRendezvous in new code.
 class PrivateIntraProcessRendezvous : public RendezvousInterface {
  public:
-  explicit PrivateIntraProcessRendezvous(const DeviceMgr* device_mgr);
+  explicit PrivateIntraProcessRendezvous(const DeviceMgr* device_mgr,
+                                         int64_t num_slots = 0);
   ~PrivateIntraProcessRendezvous() override;
 
   // Implementation of RendezvousInterface methods.
@@ -91,6 +102,12 @@ class PrivateIntraProcessRendezvous : public RendezvousInterface {
                     const Tensor& val, const bool is_dead) override;
   void RecvAsync(const ParsedKey& key, const Rendezvous::Args& args,
                  DoneCallback done) override;
+  absl::Status SendToSlot(int64_t slot, const ParsedKey& key,
+                          const Rendezvous::Args& args, const Tensor& val,
+                          const bool is_dead) override;
+  void RecvFromSlotAsync(int64_t slot, const ParsedKey& key,
+                         const Rendezvous::Args& args,
+                         DoneCallback done) override;
   void StartAbort(const absl::Status& status) override;
 
  private:
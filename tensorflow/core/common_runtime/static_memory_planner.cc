@@ -0,0 +1,349 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/static_memory_planner.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "tensorflow/core/common_runtime/graph_view.h"
+#include "tensorflow/core/framework/allocator.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/mutex.h"
+
+namespace tensorflow {
+namespace {
+
+constexpr int64_t kRegionAlignment = Allocator::kAllocatorAlignment;
+
+int64_t RoundUp(int64_t num_bytes) {
+  return (num_bytes + kRegionAlignment - 1) / kRegionAlignment *
+         kRegionAlignment;
+}
+
+// Returns the nodes of `gview` in a topological order.
+std::vector<int32_t> TopologicalOrder(const GraphView& gview) {
+  const int32_t num_nodes = gview.num_nodes();
+  std::vector<int32_t> pending(num_nodes, 0);
+  for (int32_t id = 0; id < num_nodes; ++id) {
+    const NodeItem* item = gview.node(id);
+    if (item == nullptr) continue;
+    for (const EdgeInfo& e : item->output_edges()) ++pending[e.dst_id];
+    for (const ControlEdgeInfo& e : item->output_control_edges()) {
+      ++pending[e.dst_id];
+    }
+  }
+  std::vector<int32_t> order;
+  order.reserve(num_nodes);
+  for (int32_t id = 0; id < num_nodes; ++id) {
+    if (gview.node(id) != nullptr && pending[id] == 0) order.push_back(id);
+  }
+  for (size_t i = 0; i < order.size(); ++i) {
+    const NodeItem& item = gview.node_ref(order[i]);
+    for (const EdgeInfo& e : item.output_edges()) {
+      if (--pending[e.dst_id] == 0) order.push_back(e.dst_id);
+    }
+    for (const ControlEdgeInfo& e : item.output_control_edges()) {
+      if (--pending[e.dst_id] == 0) order.push_back(e.dst_id);
+    }
+  }
+  return order;
+}
+
+}  // namespace
+
+// Allocates one planned output from its region of the buffer. Fails if the
+// region is in use or if the size differs from the plan, so that the caller
+// falls back to the device allocator.
+class StaticMemoryPlanner::Buffers::RegionAllocator : public Allocator {
+ public:
+  RegionAllocator(Buffers* buffers, char* ptr, size_t num_bytes,
+                  std::atomic<bool>* in_use)
+      : buffers_(buffers), ptr_(ptr), num_bytes_(num_bytes), in_use_(in_use) {}
+
+  std::string Name() override { return "static_memory_plan"; }
+
+  void* AllocateRaw(size_t alignment, size_t num_bytes) override {
+    if (num_bytes != num_bytes_ || alignment > kRegionAlignment) {
+      return nullptr;
+    }
+    bool in_use = false;
+    if (!in_use_->compare_exchange_strong(in_use, true,
+                                          std::memory_order_acquire)) {
+      return nullptr;
+    }
+    buffers_->Ref();
+    return ptr_;
+  }
+
+  void DeallocateRaw(void* ptr) override {
+    DCHECK_EQ(ptr, ptr_);
+    in_use_->store(false, std::memory_order_release);
+    buffers_->Unref();
+  }
+
+  AllocatorMemoryType GetMemoryType() const override {
+    return buffers_->backing_allocator()->GetMemoryType();
+  }
+
+ private:
+  Buffers* const buffers_;
+  char* const ptr_;
+  const size_t num_bytes_;
+  std::atomic<bool>* const in_use_;
+};
+
+StaticMemoryPlanner::Buffers::~Buffers() {
+  if (base_ != nullptr) {
+    backing_allocator_->DeallocateRaw(base_);
+  }
+}
+
+StaticMemoryPlanner::StaticMemoryPlanner(const GraphView& gview,
+                                         Allocator* allocator)
+    : gview_(gview), allocator_(allocator) {
+  const int32_t num_nodes = gview.num_nodes();
+  output_starts_.resize(num_nodes, 0);
+  for (int32_t id = 0; id < num_nodes; ++id) {
+    output_starts_[id] = num_outputs_;
+    const NodeItem* item = gview.node(id);
+    if (item != nullptr) num_outputs_ += item->num_outputs;
+  }
+  output_sizes_ = std::make_unique<std::atomic<int64_t>[]>(num_outputs_);
+  for (int32_t i = 0; i < num_outputs_; ++i) {
+    output_sizes_[i].store(kNotRecorded, std::memory_order_relaxed);
+  }
+}
+
+StaticMemoryPlanner::~StaticMemoryPlanner() {
+  mutex_lock l(mu_);
+  for (Buffers* buffers : free_buffers_) {
+    buffers->Unref();
+  }
+}
+
+void StaticMemoryPlanner::RecordOutput(const NodeItem& item, int output_index,
+                                       const Tensor& tensor) {
+  const int64_t num_bytes =
+      DataTypeCanUseMemcpy(tensor.dtype())
+          ? tensor.NumElements() * DataTypeSize(tensor.dtype())
+          : kVariableSize;
+  std::atomic<int64_t>& size =
+      output_sizes_[output_starts_[item.node_id] + output_index];
+  int64_t recorded = size.load(std::memory_order_relaxed);
+  while (recorded != num_bytes && recorded != kVariableSize) {
+    const int64_t new_size =
+        recorded == kNotRecorded ? num_bytes : kVariableSize;
+    if (size.compare_exchange_weak(recorded, new_size,
+                                   std::memory_order_relaxed)) {
+      break;
+    }
+  }
+}
+
+void StaticMemoryPlanner::BuildPlan() {
+  plan_built_ = true;
+  const int32_t num_nodes = gview_.num_nodes();
+  output_offsets_.assign(num_outputs_, -1);
+  output_regions_.assign(num_outputs_, -1);
+  if (num_nodes > kMaxNodes) {
+    VLOG(1) << "Not planning the memory of a graph with " << num_nodes
+            << " nodes.";
+    return;
+  }
+
+  // ancestors[id * words + j] holds bit k if node 64 * j + k is an ancestor
+  // of node `id`.
+  const std::vector<int32_t> order = TopologicalOrder(gview_);
+  const int32_t words = (num_nodes + 63) / 64;
+  std::vector<uint64_t> ancestors(static_cast<size_t>(num_nodes) * words, 0);
+  auto is_ancestor = [&](int32_t a, int32_t id) {
+    return (ancestors[static_cast<size_t>(id) * words + a / 64] >>
+            (a % 64)) &
+           1;
+  };
+  for (int32_t id : order) {
+    const uint64_t* src = &ancestors[static_cast<size_t>(id) * words];
+    auto add_to = [&](int32_t dst_id) {
+      uint64_t* dst = &ancestors[static_cast<size_t>(dst_id) * words];
+      for (int32_t j = 0; j < words; ++j) dst[j] |= src[j];
+      dst[id / 64] |= uint64_t{1} << (id % 64);
+    };
+    const NodeItem& item = gview_.node_ref(id);
+    for (const EdgeInfo& e : item.output_edges()) add_to(e.dst_id);
+    for (const ControlEdgeInfo& e : item.output_control_edges()) {
+      add_to(e.dst_id);
+    }
+  }
+
+  // Assigns the planned outputs to regions in topological order. A region
+  // can be reused once its last output can no longer be used, i.e. once its
+  // producer and consumers are all ancestors of the new producer. Each output
+  // goes to the smallest free region which is large enough, or else grows the
+  // largest free region.
+  struct Region {
+    int64_t size = 0;
+    std::vector<int32_t> users;
+  };
+  std::vector<Region> regions;
+  int64_t total_bytes = 0;
+  int num_planned = 0;
+  for (int32_t id : order) {
+    const NodeItem& item = gview_.node_ref(id);
+    if (!item.is_step_local) continue;
+    for (int i = 0; i < item.num_outputs; ++i) {
+      const int32_t output = output_starts_[id] + i;
+      const int64_t size =
+          output_sizes_[output].load(std::memory_order_relaxed);
+      if (size <= 0) continue;
+      int best = -1;
+      for (size_t r = 0; r < regions.size(); ++r) {
+        bool free = true;
+        for (int32_t user : regions[r].users) {
+          if (!is_ancestor(user, id)) {
+            free = false;
+            break;
+          }
+        }
+        if (!free) continue;
+        if (best < 0) {
+          best = r;
+          continue;
+        }
+        const int64_t best_size = regions[best].size;
+        const int64_t region_size = regions[r].size;
+        if (best_size < size ? region_size > best_size
+                             : region_size >= size && region_size < best_size) {
+          best = r;
+        }
+      }
+      if (best < 0) {
+        best = regions.size();
+        regions.emplace_back();
+      }
+      Region& region = regions[best];
+      region.size = std::max(region.size, RoundUp(size));
+      region.users.assign(1, id);
+      for (const EdgeInfo& e : item.output_edges()) {
+        if (e.output_slot == i) region.users.push_back(e.dst_id);
+      }
+      output_regions_[output] = best;
+      total_bytes += RoundUp(size);
+      ++num_planned;
+    }
+  }
+
+  std::vector<int64_t> region_offsets(regions.size());
+  for (size_t r = 0; r < regions.size(); ++r) {
+    region_offsets[r] = buffer_size_;
+    buffer_size_ += regions[r].size;
+  }
+  for (int32_t output = 0; output < num_outputs_; ++output) {
+    if (output_regions_[output] >= 0) {
+      output_offsets_[output] = region_offsets[output_regions_[output]];
+    }
+  }
+  num_regions_ = regions.size();
+  VLOG(1) << "Static memory plan places " << num_planned << " outputs of "
+          << total_bytes << " bytes in " << num_regions_ << " regions of "
+          << buffer_size_ << " bytes.";
+}
+
+StaticMemoryPlanner::Buffers* StaticMemoryPlanner::NewBuffers() {
+  auto* buffers = new Buffers(allocator_);
+  buffers->base_ = allocator_->AllocateRaw(kRegionAlignment, buffer_size_);
+  if (buffers->base_ == nullptr) {
+    buffers->Unref();
+    return nullptr;
+  }
+  char* base = static_cast<char*>(buffers->base_);
+  buffers->region_in_use_ = std::make_unique<std::atomic<bool>[]>(num_regions_);
+  for (int r = 0; r < num_regions_; ++r) {
+    buffers->region_in_use_[r].store(false, std::memory_order_relaxed);
+  }
+  const int32_t num_nodes = gview_.num_nodes();
+  buffers->node_starts_.assign(num_nodes, -1);
+  buffers->output_allocators_.assign(output_offsets_.size(), nullptr);
+  for (int32_t id = 0; id < num_nodes; ++id) {
+    const NodeItem* item = gview_.node(id);
+    if (item == nullptr) continue;
+    for (int i = 0; i < item->num_outputs; ++i) {
+      const int32_t output = output_starts_[id] + i;
+      if (output_regions_[output] < 0) continue;
+      buffers->node_starts_[id] = output_starts_[id];
+      buffers->region_allocators_.push_back(
+          std::make_unique<Buffers::RegionAllocator>(
+              buffers, base + output_offsets_[output],
+              output_sizes_[output].load(std::memory_order_relaxed),
+              &buffers->region_in_use_[output_regions_[output]]));
+      buffers->output_allocators_[output] =
+          buffers->region_allocators_.back().get();
+    }
+  }
+  return buffers;
+}
+
+StaticMemoryPlanner::BuffersPtr StaticMemoryPlanner::AcquireBuffers() {
+  BuffersPtr result(nullptr, BuffersReleaser{this});
+  if (calibrating()) {
+    return result;
+  }
+  mutex_lock l(mu_);
+  if (!plan_built_) {
+    BuildPlan();
+  }
+  if (buffer_size_ == 0) {
+    return result;
+  }
+  if (!free_buffers_.empty()) {
+    result.reset(free_buffers_.back());
+    free_buffers_.pop_back();
+  } else {
+    result.reset(NewBuffers());
+  }
+  return result;
+}
+
+void StaticMemoryPlanner::ReleaseBuffers(Buffers* buffers) {
+  // Buffers which still hold a tensor are not reused, and are freed with
+  // their last tensor.
+  if (buffers->RefCountIsOne()) {
+    mutex_lock l(mu_);
+    free_buffers_.push_back(buffers);
+  } else {
+    buffers->Unref();
+  }
+}
+
+int64_t StaticMemoryPlanner::buffer_size() const {
+  mutex_lock l(mu_);
+  return buffer_size_;
+}
+
+int64_t StaticMemoryPlanner::output_offset(int node_id,
+                                           int output_index) const {
+  mutex_lock l(mu_);
+  if (!plan_built_) return -1;
+  return output_offsets_[output_starts_[node_id] + output_index];
+}
+
+}  // namespace tensorflow
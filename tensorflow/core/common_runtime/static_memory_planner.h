@@ -0,0 +1,165 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_COMMON_RUNTIME_STATIC_MEMORY_PLANNER_H_
+#define TENSORFLOW_CORE_COMMON_RUNTIME_STATIC_MEMORY_PLANNER_H_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "tensorflow/core/common_runtime/graph_view.h"
+#include "tensorflow/core/framework/allocator.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/refcount.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+
+namespace tensorflow {
+
+// Assigns the outputs of the nodes of an executor's graph fixed offsets in
+// one buffer, which is allocated once and reused by later steps.
+//
+// Only the outputs of nodes marked `NodeItem::is_step_local` are planned, and
+// only if they have the same size in all calibration steps, e.g. because all
+// shapes in the graph are fully defined. The first `kCalibrationSteps` steps
+// allocate their outputs dynamically and record their sizes, and the plan is
+// built when the next step starts.
+//
+// Outputs share memory only if the producer and all consumers of the earlier
+// output are ancestors of the producer of the later one. Since kernels may
+// still alias their inputs in their outputs, each region of the buffer is
+// also marked as in use while a tensor holds it, and an allocation whose
+// region is in use, or whose size differs from the plan, falls back to the
+// device allocator.
+//
+// This class is thread-safe.
+class StaticMemoryPlanner {
+ public:
+  static constexpr int kCalibrationSteps = 2;
+  // The planner gives up on larger graphs, because it keeps the ancestors of
+  // every node in a bit set while planning.
+  static constexpr int kMaxNodes = 10000;
+
+  // The planned memory of one step. Each planned output is allocated from its
+  // own allocator, which returns the preassigned region of the buffer.
+  // Tensors allocated from the buffer hold a reference to it.
+  class Buffers : public core::RefCounted {
+   public:
+    ~Buffers() override;
+
+    // Returns the allocators of the outputs of the node with `node_id`,
+    // indexed by output, or nullptr if none of its outputs are planned. The
+    // allocators of unplanned outputs are null.
+    Allocator* const* node_allocators(int node_id) const {
+      const int32_t start = node_starts_[node_id];
+      return start < 0 ? nullptr : &output_allocators_[start];
+    }
+
+    // Returns the allocator from which the buffer was allocated.
+    Allocator* backing_allocator() const { return backing_allocator_; }
+
+   private:
+    friend class StaticMemoryPlanner;
+    class RegionAllocator;
+
+    explicit Buffers(Allocator* backing_allocator)
+        : backing_allocator_(backing_allocator) {}
+
+    Allocator* const backing_allocator_;
+    void* base_ = nullptr;
+    std::vector<int32_t> node_starts_;
+    std::vector<Allocator*> output_allocators_;
+    std::vector<std::unique_ptr<Allocator>> region_allocators_;
+    std::unique_ptr<std::atomic<bool>[]> region_in_use_;
+  };
+
+  // Returns `Buffers` to the planner when a step ends.
+  struct BuffersReleaser {
+    void operator()(Buffers* buffers) const {
+      planner->ReleaseBuffers(buffers);
+    }
+    StaticMemoryPlanner* planner;
+  };
+  using BuffersPtr = std::unique_ptr<Buffers, BuffersReleaser>;
+
+  // `gview` must outlive the planner, and `allocator` must outlive all
+  // tensors allocated from planned memory.
+  StaticMemoryPlanner(const GraphView& gview, Allocator* allocator);
+  ~StaticMemoryPlanner();
+
+  StaticMemoryPlanner(const StaticMemoryPlanner&) = delete;
+  StaticMemoryPlanner& operator=(const StaticMemoryPlanner&) = delete;
+
+  // Returns true while steps should record the sizes of their outputs.
+  bool calibrating() const {
+    return num_calibration_steps_.load(std::memory_order_acquire) <
+           kCalibrationSteps;
+  }
+
+  // Records output `output_index` of `item` in a calibration step.
+  void RecordOutput(const NodeItem& item, int output_index,
+                    const Tensor& tensor);
+
+  // Records that a calibration step has finished.
+  void CalibrationStepDone() {
+    num_calibration_steps_.fetch_add(1, std::memory_order_acq_rel);
+  }
+
+  // Returns the planned memory for a new step, building the plan if the
+  // calibration has finished. Returns null while calibrating, if no output
+  // can be planned, or if the buffer cannot be allocated.
+  BuffersPtr AcquireBuffers();
+
+  // Returns the size of the buffer of each step, or 0 if there is no plan.
+  int64_t buffer_size() const;
+  // Returns the offset of output `output_index` of the node with `node_id` in
+  // the buffer, or -1 if the output is not planned.
+  int64_t output_offset(int node_id, int output_index) const;
+
+ private:
+  // Values of `output_sizes_` which are not sizes.
+  static constexpr int64_t kNotRecorded = -1;
+  static constexpr int64_t kVariableSize = -2;
+
+  void BuildPlan() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+  Buffers* NewBuffers() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+  void ReleaseBuffers(Buffers* buffers);
+
+  const GraphView& gview_;
+  Allocator* const allocator_;
+
+  // Index of the first output of each node in `output_sizes_` and
+  // `output_offsets_`.
+  std::vector<int32_t> output_starts_;
+  int32_t num_outputs_ = 0;
+  std::unique_ptr<std::atomic<int64_t>[]> output_sizes_;
+  std::atomic<int> num_calibration_steps_{0};
+
+  mutable mutex mu_;
+  bool plan_built_ TF_GUARDED_BY(mu_) = false;
+  // For each output, its offset in the buffer and the index of its region,
+  // or -1 if it is not planned.
+  std::vector<int64_t> output_offsets_ TF_GUARDED_BY(mu_);
+  std::vector<int32_t> output_regions_ TF_GUARDED_BY(mu_);
+  int num_regions_ TF_GUARDED_BY(mu_) = 0;
+  int64_t buffer_size_ TF_GUARDED_BY(mu_) = 0;
+  std::vector<Buffers*> free_buffers_ TF_GUARDED_BY(mu_);
+};
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_COMMON_RUNTIME_STATIC_MEMORY_PLANNER_H_
@@ -0,0 +1,159 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/static_memory_planner.h"
+
+#include <memory>
+#include <vector>
+
+#include "tensorflow/core/common_runtime/graph_view.h"
+#include "tensorflow/core/framework/allocator.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/framework/types.pb.h"
+#include "tensorflow/core/graph/graph.h"
+#include "tensorflow/core/graph/testlib.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace {
+
+class StaticMemoryPlannerTest : public ::testing::Test {
+ protected:
+  // Builds the chain Const -> Neg -> Neg -> Neg of float tensors with
+  // `num_elements` elements.
+  void BuildChain(int num_elements) {
+    graph_ = std::make_unique<Graph>(OpRegistry::Global());
+    Tensor value(DT_FLOAT, TensorShape({num_elements}));
+    value.flat<float>().setZero();
+    nodes_.push_back(test::graph::Constant(graph_.get(), value));
+    for (int i = 0; i < 3; ++i) {
+      nodes_.push_back(test::graph::Unary(graph_.get(), "Neg", nodes_.back()));
+    }
+    TF_ASSERT_OK(gview_.Initialize(graph_.get()));
+    for (const Node* n : nodes_) {
+      gview_.node(n->id())->is_step_local = true;
+    }
+    planner_ = std::make_unique<StaticMemoryPlanner>(gview_, cpu_allocator());
+  }
+
+  // Records the outputs of all nodes in one calibration step, with
+  // `num_elements` elements.
+  void Calibrate(int num_elements) {
+    ASSERT_TRUE(planner_->calibrating());
+    EXPECT_EQ(planner_->AcquireBuffers(), nullptr);
+    Tensor output(DT_FLOAT, TensorShape({num_elements}));
+    for (const Node* n : nodes_) {
+      planner_->RecordOutput(gview_.node_ref(n->id()), 0, output);
+    }
+    planner_->CalibrationStepDone();
+  }
+
+  int64_t Offset(int i) { return planner_->output_offset(nodes_[i]->id(), 0); }
+
+  std::unique_ptr<Graph> graph_;
+  std::vector<Node*> nodes_;
+  GraphView gview_;
+  std::unique_ptr<StaticMemoryPlanner> planner_;
+};
+
+TEST_F(StaticMemoryPlannerTest, ReusesMemoryOfDeadOutputs) {
+  BuildChain(4);
+  Calibrate(4);
+  Calibrate(4);
+  EXPECT_FALSE(planner_->calibrating());
+  StaticMemoryPlanner::BuffersPtr buffers = planner_->AcquireBuffers();
+  ASSERT_NE(buffers, nullptr);
+
+  // Each output is live until its consumer has run, so alternate outputs
+  // share a region of 64 bytes.
+  EXPECT_EQ(planner_->buffer_size(), 2 * Allocator::kAllocatorAlignment);
+  EXPECT_EQ(Offset(0), Offset(2));
+  EXPECT_EQ(Offset(1), Offset(3));
+  EXPECT_NE(Offset(0), Offset(1));
+}
+
+TEST_F(StaticMemoryPlannerTest, DoesNotPlanVariableSizes) {
+  BuildChain(4);
+  Calibrate(4);
+  Calibrate(8);
+  EXPECT_EQ(planner_->AcquireBuffers(), nullptr);
+  EXPECT_EQ(planner_->buffer_size(), 0);
+  EXPECT_EQ(Offset(0), -1);
+}
+
+TEST_F(StaticMemoryPlannerTest, AllocatesFromPlannedMemory) {
+  BuildChain(4);
+  Calibrate(4);
+  Calibrate(4);
+  StaticMemoryPlanner::BuffersPtr buffers = planner_->AcquireBuffers();
+  ASSERT_NE(buffers, nullptr);
+  Allocator* first = buffers->node_allocators(nodes_[0]->id())[0];
+  Allocator* third = buffers->node_allocators(nodes_[2]->id())[0];
+  ASSERT_NE(first, nullptr);
+  ASSERT_NE(third, nullptr);
+  EXPECT_EQ(buffers->node_allocators(graph_->source_node()->id()), nullptr);
+
+  {
+    Tensor t(first, DT_FLOAT, TensorShape({4}));
+    ASSERT_TRUE(t.IsInitialized());
+    t.flat<float>().setConstant(1.0f);
+    // The region of the first output is in use.
+    Tensor in_use(third, DT_FLOAT, TensorShape({4}));
+    EXPECT_FALSE(in_use.IsInitialized());
+  }
+  Tensor t(third, DT_FLOAT, TensorShape({4}));
+  EXPECT_TRUE(t.IsInitialized());
+  // Sizes which differ from the plan are not allocated.
+  Tensor larger(first, DT_FLOAT, TensorShape({8}));
+  EXPECT_FALSE(larger.IsInitialized());
+}
+
+TEST_F(StaticMemoryPlannerTest, ReusesBuffersAcrossSteps) {
+  BuildChain(4);
+  Calibrate(4);
+  Calibrate(4);
+  StaticMemoryPlanner::Buffers* first_step;
+  {
+    StaticMemoryPlanner::BuffersPtr buffers = planner_->AcquireBuffers();
+    first_step = buffers.get();
+  }
+  StaticMemoryPlanner::BuffersPtr buffers = planner_->AcquireBuffers();
+  EXPECT_EQ(buffers.get(), first_step);
+  // A concurrent step gets its own buffers.
+  StaticMemoryPlanner::BuffersPtr concurrent = planner_->AcquireBuffers();
+  ASSERT_NE(concurrent, nullptr);
+  EXPECT_NE(concurrent.get(), first_step);
+}
+
+TEST_F(StaticMemoryPlannerTest, TensorsOutliveBuffers) {
+  BuildChain(4);
+  Calibrate(4);
+  Calibrate(4);
+  Tensor t;
+  {
+    StaticMemoryPlanner::BuffersPtr buffers = planner_->AcquireBuffers();
+    t = Tensor(buffers->node_allocators(nodes_[1]->id())[0], DT_FLOAT,
+               TensorShape({4}));
+    ASSERT_TRUE(t.IsInitialized());
+  }
+  planner_.reset();
+  t.flat<float>().setConstant(2.0f);
+  EXPECT_EQ(t.flat<float>()(3), 2.0f);
+}
+
+}  // namespace
+}  // namespace tensorflow
@@ -157,6 +157,23 @@ void NodeExecStatsWrapper::SetMemory(OpKernelContext* ctx) {
     ms->mutable_persistent_tensor_alloc_ids()->Add(alloc_id);
   }
   ms->set_persistent_memory_size(ctx->persistent_memory_allocated());
+
+  int64_t forwarded_bytes = 0;
+  int64_t allocated_bytes = 0;
+  for (int i = 0; i < ctx->num_outputs(); ++i) {
+    const Tensor* output = ctx->mutable_output(i);
+    if (output == nullptr || IsRefType(ctx->expected_output_dtype(i))) {
+      continue;
+    }
+    bool forwarded = false;
+    for (int j = 0; j < ctx->num_inputs() && !forwarded; ++j) {
+      forwarded = ctx->has_input(j) && !ctx->input_is_ref(j) &&
+                  output->SharesBufferWith(ctx->input(j));
+    }
+    (forwarded ? forwarded_bytes : allocated_bytes) += output->TotalBytes();
+  }
+  ms->set_forwarded_output_bytes(forwarded_bytes);
+  ms->set_allocated_output_bytes(allocated_bytes);
 }
 
 void NodeExecStatsWrapper::SetOutput(int slot, const Tensor* tensor) {
@@ -403,6 +420,9 @@ void StepStatsCollector::Save(const string& device,
       delete node_stats;
       return;
     }
+    const MemoryStats& memory_stats = node_stats->stats()->memory_stats();
+    forwarded_output_bytes_ += memory_stats.forwarded_output_bytes();
+    allocated_output_bytes_ += memory_stats.allocated_output_bytes();
     auto& device_stats = dev_stats_[device];
     device_stats.push_back(std::unique_ptr<NodeExecStatsWrapper>(node_stats));
     collected_nodes_++;
@@ -524,6 +544,8 @@ void StepStatsCollector::FinalizeAndSwap(StepStats* step_stats) {
   FinalizeInternal();
   step_stats->Swap(step_stats_);
   collected_nodes_ = 0;
+  forwarded_output_bytes_ = 0;
+  allocated_output_bytes_ = 0;
 }
 
 void StepStatsCollector::FinalizeInternal() {
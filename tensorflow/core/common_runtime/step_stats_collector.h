@@ -185,6 +185,18 @@ class StepStatsCollector : public StepStatsCollectorInterface {
   // swaps the content of StepStats* from constructor with 'ss'.
   void FinalizeAndSwap(StepStats* step_stats);
 
+  // Returns the total bytes of the outputs of the saved nodes which share
+  // their buffer with an input, e.g. because the input was forwarded, and of
+  // the other outputs. Reset by FinalizeAndSwap.
+  int64_t forwarded_output_bytes() {
+    mutex_lock l(mu_);
+    return forwarded_output_bytes_;
+  }
+  int64_t allocated_output_bytes() {
+    mutex_lock l(mu_);
+    return allocated_output_bytes_;
+  }
+
  private:
   // TODO(suharshs): Make this configurable if its not possible to find a value
   // that works for all cases.
@@ -201,6 +213,8 @@ class StepStatsCollector : public StepStatsCollectorInterface {
   std::unordered_map<string, ThreadNamesMap> thread_names_ TF_GUARDED_BY(mu_);
   StepStats* step_stats_ TF_GUARDED_BY(mu_);
   uint64 collected_nodes_ TF_GUARDED_BY(mu_) = 0;
+  int64_t forwarded_output_bytes_ TF_GUARDED_BY(mu_) = 0;
+  int64_t allocated_output_bytes_ TF_GUARDED_BY(mu_) = 0;
 };
 
 }  // namespace tensorflow
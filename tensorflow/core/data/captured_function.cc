@@ -324,10 +324,12 @@ class OwnedArgsCallFrame : public CallFrameBase {
  public:
   OwnedArgsCallFrame(std::vector<Tensor>&& args,
                      const std::vector<Tensor>* captured_inputs,
-                     DataTypeSlice ret_types)
+                     DataTypeSlice ret_types,
+                     std::vector<Tensor>&& retval_slots = {})
       : CallFrameBase(ret_types),
         args_(std::move(args)),
-        captured_inputs_(captured_inputs) {}
+        captured_inputs_(captured_inputs),
+        retval_slots_(std::move(retval_slots)) {}
 
   size_t num_args() const override {
     return args_.size() + captured_inputs_->size();
@@ -359,9 +361,26 @@ class OwnedArgsCallFrame : public CallFrameBase {
     return index >= 0 && index < static_cast<int>(args_.size());
   }
 
+  bool GetRetvalSlot(int index, DataType dtype, const TensorShape& shape,
+                     Tensor* val) override {
+    if (index < 0 || index >= static_cast<int>(retval_slots_.size())) {
+      return false;
+    }
+    Tensor& slot = retval_slots_[index];
+    if (!slot.IsInitialized() || slot.dtype() != dtype ||
+        slot.shape() != shape) {
+      return false;
+    }
+    *val = std::move(slot);
+    slot = Tensor();
+    return true;
+  }
+
  private:
   std::vector<Tensor> args_;
   const std::vector<Tensor>* const captured_inputs_;  // Not owned.
+  // Uninitialized for the return values without reserved memory.
+  std::vector<Tensor> retval_slots_;
 };
 
 class BorrowedArgsCallFrame : public CallFrameBase {
@@ -961,7 +980,8 @@ void InstantiatedCapturedFunction::RunAsync(
     CancellationManager* parent_cancellation_manager,
     CollectiveExecutor* collective_executor, std::vector<Tensor>&& args,
     std::vector<Tensor>* rets, FunctionLibraryRuntime::DoneCallback done,
-    const std::shared_ptr<model::Node>& node) const {
+    const std::shared_ptr<model::Node>& node,
+    std::vector<Tensor>&& retval_slots) const {
   auto& info = captured_func_->short_circuit_info();
   if (!info.indices.empty()) {
     // Run the `done` callback on a threadpool thread, because it will
@@ -979,7 +999,8 @@ void InstantiatedCapturedFunction::RunAsync(
   // be deleted before `done` is called. Take care not to capture `ctx` in any
   // code that may execute asynchronously in this function.
   OwnedArgsCallFrame* frame = new OwnedArgsCallFrame(
-      std::move(args), &captured_func_->captured_inputs(), ret_types_);
+      std::move(args), &captured_func_->captured_inputs(), ret_types_,
+      std::move(retval_slots));
 
   FunctionLibraryRuntime::Options f_opts;
   ResourceMgr* resource_mgr = lib_->device()->resource_manager();
@@ -297,6 +297,21 @@ class InstantiatedCapturedFunction {
              ctx->collective_executor(), std::move(args), rets, done, node);
   }
 
+  // A version of `RunAsync` that reserves the memory of `retval_slots[i]`
+  // for the `i`-th return value. If the kernel which produces the return
+  // value allocates an output of the same type and shape as the slot, it
+  // allocates it in the slot, and `(*rets)[i]` shares its buffer with
+  // `retval_slots[i]`. Otherwise, the return value is allocated as usual.
+  // Uninitialized slots reserve no memory.
+  void RunAsync(IteratorContext* ctx, std::vector<Tensor>&& args,
+                std::vector<Tensor>&& retval_slots, std::vector<Tensor>* rets,
+                FunctionLibraryRuntime::DoneCallback done,
+                const std::shared_ptr<model::Node>& node) const {
+    RunAsync(*(ctx->runner()), ctx->cancellation_manager(),
+             ctx->collective_executor(), std::move(args), rets, done, node,
+             std::move(retval_slots));
+  }
+
   // A version of `RunAsync` that does not take an `IteratorContext` but a
   // runner, a cancellation manager, and a collective executor.
   void RunAsync(std::function<void(std::function<void()>)> runner,
@@ -304,7 +319,8 @@ class InstantiatedCapturedFunction {
                 CollectiveExecutor* collective_executor,
                 std::vector<Tensor>&& args, std::vector<Tensor>* rets,
                 FunctionLibraryRuntime::DoneCallback done,
-                const std::shared_ptr<model::Node>& node) const;
+                const std::shared_ptr<model::Node>& node,
+                std::vector<Tensor>&& retval_slots = {}) const;
 
   std::string func_name() const { return captured_func_->func().name(); }
 
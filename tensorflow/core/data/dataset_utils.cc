@@ -33,6 +33,7 @@ limitations under the License.
 #include "absl/strings/match.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_join.h"
+#include "tensorflow/core/common_runtime/dma_helper.h"
 #include "tensorflow/core/common_runtime/function.h"
 #include "tensorflow/core/framework/attr_value.pb.h"
 #include "tensorflow/core/framework/dataset.h"
@@ -97,6 +98,7 @@ constexpr char kShuffleAndRepeatFusionOpt[] = "shuffle_and_repeat_fusion";
 constexpr char kFilterFusionOpt[] = "filter_fusion";
 constexpr char kMapAndFilterFusionOpt[] = "map_and_filter_fusion";
 constexpr char kMapFusionOpt[] = "map_fusion";
+constexpr char kMapVectorizationOpt[] = "map_vectorization";
 constexpr char kParallelBatchOpt[] = "parallel_batch";
 constexpr char kAutotuneBufferSizesOpt[] = "autotune_buffer_sizes";
 constexpr char kDisablePrefetchLegacyAutotuneOpt[] =
@@ -239,6 +241,14 @@ void DefaultOptimizationGraphRewrites(
       optimization_disabled->insert(kSeqInterleavePrefetchOpt);
     }
   }
+  if (optimization_options.optional_map_vectorization_case() ==
+      OptimizationOptions::kMapVectorization) {
+    if (optimization_options.map_vectorization()) {
+      optimization_enabled->insert(kMapVectorizationOpt);
+    } else {
+      optimization_disabled->insert(kMapVectorizationOpt);
+    }
+  }
 }
 
 // Returns whether an op has been allowlisted as stateless. Uses a heuristic to
@@ -253,6 +263,73 @@ bool IsOpAllowlisted(const OpDef* op_def) {
          AllowlistedStatefulOpRegistry::Global()->Contains(op_def->name());
 }
 
+// A buffer that aliases `[data, data + size)` of `root` without owning it.
+class BatchAliasBuffer : public TensorBuffer {
+ public:
+  BatchAliasBuffer(TensorBuffer* root, void* data, size_t size)
+      : TensorBuffer(data), root_(root), size_(size) {
+    root_->Ref();
+  }
+
+  size_t size() const override { return size_; }
+  TensorBuffer* root_buffer() override { return root_; }
+  bool GetAllocatedBytes(size_t* out_bytes) const override {
+    return root_->GetAllocatedBytes(out_bytes);
+  }
+  void FillAllocationDescription(AllocationDescription* proto) const override {
+    root_->FillAllocationDescription(proto);
+  }
+  bool OwnsMemory() const override { return false; }
+
+ private:
+  ~BatchAliasBuffer() override { root_->Unref(); }
+
+  TensorBuffer* const root_;
+  const size_t size_;
+};
+
+// If the `component_index`-th components of `batch_elements` are adjacent,
+// equally shaped slices of a single buffer (e.g. the elements were produced by
+// slicing a larger tensor along its first dimension, as `from_tensor_slices`
+// does), stores a tensor aliasing that range in `batch_component` and returns
+// true. Returns false if the batch has to be assembled by copying.
+bool MaybeAliasContiguousBatch(
+    std::vector<std::vector<Tensor>>& batch_elements, size_t component_index,
+    const TensorShape& batch_component_shape, Tensor* batch_component) {
+  Tensor& first_element = batch_elements[0][component_index];
+  if (!DataTypeCanUseMemcpy(first_element.dtype()) ||
+      first_element.TotalBytes() == 0 || !first_element.IsAligned()) {
+    return false;
+  }
+  TensorBuffer* first_buffer = DMAHelper::buffer(&first_element);
+  if (first_buffer == nullptr) {
+    return false;
+  }
+  TensorBuffer* root = first_buffer->root_buffer();
+  char* base = static_cast<char*>(DMAHelper::base(&first_element));
+  const size_t slice_bytes = first_element.TotalBytes();
+  for (size_t i = 1; i < batch_elements.size(); ++i) {
+    Tensor& element = batch_elements[i][component_index];
+    TensorBuffer* buffer = DMAHelper::buffer(&element);
+    if (buffer == nullptr || buffer->root_buffer() != root ||
+        element.dtype() != first_element.dtype() ||
+        element.shape() != first_element.shape() ||
+        DMAHelper::base(&element) != base + i * slice_bytes) {
+      return false;
+    }
+  }
+  const size_t batch_bytes = slice_bytes * batch_elements.size();
+  char* root_base = static_cast<char*>(root->data());
+  if (base < root_base || base + batch_bytes > root_base + root->size()) {
+    return false;
+  }
+  *batch_component =
+      Tensor(first_element.dtype(), batch_component_shape,
+             core::RefCountPtr<TensorBuffer>(
+                 new BatchAliasBuffer(root, base, batch_bytes)));
+  return true;
+}
+
 }  // namespace
 
 std::pair<int64_t, int64_t> MaybeOverrideSeeds(
@@ -804,14 +881,24 @@ absl::Status CopyBatch(AnyContext ctx,
   const size_t num_tuple_components = batch_elements.at(0).size();
   out_tensors->reserve(num_tuple_components);
   const int64_t num_batch_elements = batch_elements.size();
+  // Components whose elements already lie back to back in one buffer are
+  // handed off without copying.
+  std::vector<bool> aliased(num_tuple_components, false);
   for (size_t component_index = 0; component_index < num_tuple_components;
        ++component_index) {
     const Tensor& first_element = batch_elements.at(0)[component_index];
     TensorShape first_element_shape(first_element.shape());
     TensorShape batch_component_shape({num_batch_elements});
     batch_component_shape.AppendShape(first_element_shape);
-    out_tensors->emplace_back(ctx.allocator, first_element.dtype(),
-                              batch_component_shape);
+    out_tensors->emplace_back();
+    if (MaybeAliasContiguousBatch(batch_elements, component_index,
+                                  batch_component_shape,
+                                  &out_tensors->back())) {
+      aliased[component_index] = true;
+      continue;
+    }
+    out_tensors->back() =
+        Tensor(ctx.allocator, first_element.dtype(), batch_component_shape);
     if (!out_tensors->back().IsInitialized()) {
       return errors::ResourceExhausted(
           "Failed to allocate memory for the batch of component ",
@@ -820,6 +907,9 @@ absl::Status CopyBatch(AnyContext ctx,
   }
   for (size_t component_index = 0; component_index < num_tuple_components;
        ++component_index) {
+    if (aliased[component_index]) {
+      continue;
+    }
     Tensor& batch_component = out_tensors->at(component_index);
     const Tensor& first_element = batch_elements.at(0)[component_index];
     TensorShape first_element_shape(first_element.shape());
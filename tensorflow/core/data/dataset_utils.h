@@ -298,6 +298,11 @@ absl::Status ProcessBatch(int64_t batch_size, int64_t num_elements,
 // copy.
 // The `out_tensors` argument will be used to store the resulting batch (one for
 // each component of the input).
+//
+// Components whose elements are adjacent, equally shaped, aligned slices of
+// one buffer, as produced by slicing a tensor along its first dimension (e.g.
+// `from_tensor_slices`), are not copied: the batch component aliases that
+// range of the buffer. All other components are copied.
 absl::Status CopyBatch(AnyContext ctx,
                        std::vector<std::vector<Tensor>>&& batch_elements,
                        bool parallel_copy, std::vector<Tensor>* out_tensors);
@@ -678,6 +678,7 @@ GetOptimizationsTestCase GetOptimizationTestCase4() {
   options.mutable_optimization_options()->set_shuffle_and_repeat_fusion(true);
   options.mutable_optimization_options()->set_inject_prefetch(true);
   options.mutable_optimization_options()->set_seq_interleave_prefetch(true);
+  options.mutable_optimization_options()->set_map_vectorization(true);
   options.set_slack(true);
   return {options,
           /*expected_enabled=*/
@@ -685,7 +686,7 @@ GetOptimizationsTestCase GetOptimizationTestCase4() {
            "map_and_batch_fusion", "map_and_filter_fusion", "map_fusion",
            "map_parallelization", "noop_elimination", "parallel_batch",
            "shuffle_and_repeat_fusion", "slack", "inject_prefetch",
-           "seq_interleave_prefetch"},
+           "seq_interleave_prefetch", "map_vectorization"},
           /*expected_disabled=*/{},
           /*expected_default=*/{}};
 }
@@ -754,6 +755,39 @@ TEST(DatasetUtilsTest, CountBytes) {
   EXPECT_EQ(GetTotalBytes(compressed), compressed_element.ByteSizeLong());
 }
 
+TEST(DatasetUtilsTest, CopyBatchAliasesContiguousSlices) {
+  TF_ASSERT_OK_AND_ASSIGN(std::unique_ptr<TestContext> ctx,
+                          TestContext::Create());
+  Tensor parent = CreateTensor<int64_t>(TensorShape{8, 16});
+  std::vector<std::vector<Tensor>> batch_elements;
+  for (int64_t i = 0; i < 4; ++i) {
+    batch_elements.push_back({MaybeCopySubSlice(parent, i)});
+  }
+  std::vector<Tensor> batch;
+  TF_ASSERT_OK(CopyBatch(AnyContext(ctx->iter_ctx()), std::move(batch_elements),
+                         /*parallel_copy=*/false, &batch));
+  ASSERT_EQ(batch.size(), 1);
+  EXPECT_TRUE(batch[0].SharesBufferWith(parent));
+  test::ExpectEqual(batch[0], parent.Slice(0, 4));
+}
+
+TEST(DatasetUtilsTest, CopyBatchCopiesNonContiguousSlices) {
+  TF_ASSERT_OK_AND_ASSIGN(std::unique_ptr<TestContext> ctx,
+                          TestContext::Create());
+  Tensor parent = CreateTensor<int64_t>(TensorShape{8, 16});
+  std::vector<std::vector<Tensor>> batch_elements;
+  // Every other row, so the slices are not adjacent.
+  for (int64_t i = 0; i < 8; i += 2) {
+    batch_elements.push_back({MaybeCopySubSlice(parent, i)});
+  }
+  std::vector<Tensor> batch;
+  TF_ASSERT_OK(CopyBatch(AnyContext(ctx->iter_ctx()), std::move(batch_elements),
+                         /*parallel_copy=*/false, &batch));
+  ASSERT_EQ(batch.size(), 1);
+  EXPECT_FALSE(batch[0].SharesBufferWith(parent));
+  EXPECT_EQ(batch[0].matrix<int64_t>()(1, 0), parent.matrix<int64_t>()(2, 0));
+}
+
 TEST_F(DatasetOpsTestBase, TestVariantEqualityChecking) {
   Tensor scalar_0{DT_VARIANT, TensorShape({})};
   scalar_0.scalar<Variant>()() = TestVariant({CreateTensor<int64_t>({}, {0})});
@@ -34,6 +34,7 @@ limitations under the License.
 #include "tensorflow/core/platform/errors.h"
 #include "tensorflow/core/platform/host_info.h"
 #include "tensorflow/core/platform/mem.h"
+#include "tensorflow/core/platform/numa.h"
 #include "tensorflow/core/platform/refcount.h"
 #include "tensorflow/core/platform/status.h"
 #include "tensorflow/core/platform/stringprintf.h"
@@ -72,6 +73,10 @@ void SetRootDatasetParams(const Options& options, RootDataset::Params* params) {
     params->private_threadpool_size =
         options.threading_options().private_threadpool_size();
   }
+  if (options.threading_options().optional_numa_node_case() ==
+      ThreadingOptions::kNumaNode) {
+    params->numa_node = options.threading_options().numa_node();
+  }
   params->autotune = ShouldUseAutotuning(options);
   params->autotune_algorithm = model::AutotuneAlgorithm::DEFAULT;
   auto experiments = GetExperiments();
@@ -94,6 +99,8 @@ void SetRootDatasetParams(const Options& options, RootDataset::Params* params) {
   }
   params->autotune_ram_budget_from_options =
       options.autotune_options().ram_budget();
+  params->autotune_learned_state_directory =
+      options.autotune_options().learned_state_directory();
   double ram_budget_share;
   if (experiments.contains("autotune_buffer_optimization")) {
     // When running this experiment, increase the ram_budget since it already
@@ -183,8 +190,15 @@ class RootDataset::Iterator : public DatasetIterator<RootDataset> {
       threadpool_size_ =
           value_or_default(dataset()->params_.private_threadpool_size, 0,
                            port::MaxParallelism());
+      ThreadOptions thread_options;
+      if (dataset()->params_.numa_node.has_value()) {
+        thread_options.numa_node =
+            *dataset()->params_.numa_node == kNumaNodeOfCaller
+                ? port::NUMAGetThreadNodeAffinity()
+                : *dataset()->params_.numa_node;
+      }
       thread_pool_ = std::make_unique<thread::ThreadPool>(
-          Env::Default(), ThreadOptions{}, "data_private_threadpool",
+          Env::Default(), thread_options, "data_private_threadpool",
           threadpool_size_);
     }
     cancellation_manager_ = std::make_unique<CancellationManager>();
@@ -216,6 +230,10 @@ class RootDataset::Iterator : public DatasetIterator<RootDataset> {
       if (experiments.contains("autotune_buffer_optimization")) {
         model_->AddExperiment("autotune_buffer_optimization");
       }
+      if (!dataset()->params_.autotune_learned_state_directory.empty()) {
+        model_->SetLearnedAutotuneStateDirectory(
+            dataset()->params_.autotune_learned_state_directory);
+      }
     }
     IteratorContext iter_ctx(CreateParams(ctx));
     if (model_) {
@@ -18,6 +18,8 @@ limitations under the License.
 #include <cstdint>
 #include <functional>
 #include <memory>
+#include <optional>
+#include <string>
 #include <vector>
 
 #include "absl/status/status.h"
@@ -40,8 +42,13 @@ class RootDataset : public DatasetBase {
     std::function<int64_t()> autotune_cpu_budget_func;
     double ram_budget_share;
     int64_t autotune_ram_budget_from_options;
+    // Directory in which the `LEARNED` algorithm persists tuned values.
+    std::string autotune_learned_state_directory;
     int64_t max_intra_op_parallelism = 1;
     int64_t private_threadpool_size = 0;
+    // If set, the NUMA node to pin the private threadpool to, or -1 for the
+    // node of the thread that creates the iterator.
+    std::optional<int> numa_node;
 
     int64_t ComputeInitialAutotuneRamBudget() const {
       if (autotune_ram_budget_from_options > 0) {
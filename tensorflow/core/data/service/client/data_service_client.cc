@@ -768,6 +768,21 @@ void DataServiceClient::AdvanceTaskIndex() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
   }
 }
 
+std::optional<int64_t> DataServiceClient::GetCredits() {
+  mutex_lock l(mu_);
+  if (max_outstanding_requests_ == model::kAutotune || tasks_.empty()) {
+    return std::nullopt;
+  }
+  const int64_t free_slots = max_outstanding_requests_ -
+                             static_cast<int64_t>(results_.size()) -
+                             outstanding_requests_;
+  if (free_slots <= 0) {
+    return 0;
+  }
+  const int64_t num_tasks = tasks_.size();
+  return (free_slots + num_tasks - 1) / num_tasks;
+}
+
 absl::Status DataServiceClient::TryGetElement(const Task& task, bool allow_skip,
                                               GetElementResult& result) {
   GetElementRequest req;
@@ -779,6 +794,9 @@ absl::Status DataServiceClient::TryGetElement(const Task& task, bool allow_skip,
     req.set_allow_skip(true);
   } else {
     req.set_allow_skip(allow_skip);
+    if (std::optional<int64_t> credits = GetCredits(); credits.has_value()) {
+      req.set_credits(*credits);
+    }
   }
   if (params_.cross_trainer_cache_options) {
     req.set_trainer_id(params_.cross_trainer_cache_options->trainer_id());
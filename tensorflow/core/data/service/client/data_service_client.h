@@ -179,6 +179,10 @@ class DataServiceClient {
   // task a chance to proceed.
   std::shared_ptr<Task> GetTaskToProcess();
   void AdvanceTaskIndex();
+  // Returns the number of elements each task may send beyond the outstanding
+  // requests before the buffer is full, or nullopt if the buffer size is not
+  // yet known. Workers use it as flow control credits.
+  std::optional<int64_t> GetCredits() TF_LOCKS_EXCLUDED(mu_);
   absl::Status TryGetElement(const Task& task, bool allow_skip,
                              GetElementResult& result);
   void ProcessGetElementResponse(bool enqueue_result,
@@ -16,14 +16,20 @@ limitations under the License.
 #define TENSORFLOW_CORE_DATA_SERVICE_CROSS_TRAINER_CACHE_H_
 
 #include <cstddef>
-#include <deque>
+#include <cstdint>
 #include <functional>
 #include <limits>
 #include <memory>
+#include <optional>
 #include <string>
 #include <utility>
+#include <vector>
 
+#include "absl/container/btree_map.h"
+#include "absl/container/btree_set.h"
 #include "absl/container/flat_hash_map.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
 #include "tensorflow/core/data/service/byte_size.h"
 #include "tensorflow/core/framework/metrics.h"
 #include "tensorflow/core/platform/errors.h"
@@ -46,6 +52,10 @@ namespace data {
 // collected when the cache becomes full. Consequently, trainers read from a
 // sliding window through the dataset and may not read the full dataset.
 //
+// Which elements are garbage collected is decided by a `CacheEvictionPolicy`.
+// Evicted elements may optionally be kept in a compressed tier, from which
+// trainers that fall behind the main cache can still read them.
+//
 // The `CrossTrainerCache` class is thread-safe.
 //
 // Example usage:
@@ -78,7 +88,8 @@ namespace data {
 // To use the cache, the user needs to define a `CachableSequence` to generate
 // an infinite sequence of data. It should implement a `GetNext` method to
 // produce elements, and a `GetElementSizeBytes` method to estimate the element
-// size in bytes.
+// size in bytes. To use the compressed tier, it should also implement
+// `Compress` and `Uncompress`.
 template <class ElementType>
 class CachableSequence {
  public:
@@ -89,18 +100,84 @@ class CachableSequence {
 
   // Returns the estimated size of the element in bytes.
   virtual size_t GetElementSizeBytes(const ElementType&) const = 0;
+
+  // Returns a compressed copy of the element. `GetElementSizeBytes` should
+  // account for the size of compressed elements. Must be thread-safe.
+  virtual StatusOr<ElementType> Compress(const ElementType&) const {
+    return errors::Unimplemented(
+        "This cachable sequence does not support compression.");
+  }
+
+  // Returns the element compressed by `Compress`. Must be thread-safe.
+  virtual StatusOr<ElementType> Uncompress(const ElementType&) const {
+    return errors::Unimplemented(
+        "This cachable sequence does not support compression.");
+  }
+
+  // Returns true if the element is already compressed. Such elements are kept
+  // in the compressed tier as they are, without calling `Compress` or
+  // `Uncompress`. Must be thread-safe.
+  virtual bool IsCompressed(const ElementType&) const { return false; }
+};
+
+// Decides which elements are evicted when the cache becomes full.
+enum class CacheEvictionPolicy {
+  // Evicts the element that was cached first.
+  kFifo,
+  // Evicts the element that was cached first, but waits up to
+  // `retention_timeout` for active trainers to read it before evicting it.
+  kRetainForSlowestTrainer,
+  // Evicts elements every active trainer has already read, oldest first. If
+  // none are left, evicts the element that has gone the longest without being
+  // read, even though an active trainer may then skip it.
+  kLeastRecentlyRead,
+};
+
+struct CrossTrainerCacheConfig {
+  // Memory budget of the cache in bytes.
+  size_t max_cache_size_bytes = 0;
+  CacheEvictionPolicy eviction_policy = CacheEvictionPolicy::kFifo;
+  // For `kRetainForSlowestTrainer` and `kLeastRecentlyRead`, trainers which
+  // have not read from the cache within this duration are not considered
+  // active. This is also the longest time the cache waits before evicting an
+  // element for `kRetainForSlowestTrainer`.
+  absl::Duration retention_timeout = absl::Seconds(30);
+  // Memory budget in bytes for compressed copies of evicted elements. If 0,
+  // evicted elements are discarded.
+  size_t max_compressed_cache_size_bytes = 0;
+};
+
+// Cache queries made by one trainer.
+struct TrainerCacheStats {
+  // Elements read from the main cache which another trainer had cached.
+  int64_t hits = 0;
+  // Elements read from the compressed tier.
+  int64_t compressed_hits = 0;
+  // Elements this trainer had to produce and insert into the cache.
+  int64_t misses = 0;
+
+  double HitRate() const {
+    const int64_t queries = hits + compressed_hits + misses;
+    return queries == 0 ? 0.0
+                        : static_cast<double>(hits + compressed_hits) / queries;
+  }
 };
 
 // Sliding-window cache shared across concurrent trainers.
 template <class ElementType>
 class CrossTrainerCache {
  public:
-  // Creates a `CrossTrainerCache` with `max_cache_size_bytes` of memory budget.
-  // The cache should be able to hold at least one element, i.e.:
+  // Creates a FIFO `CrossTrainerCache` with `max_cache_size_bytes` of memory
+  // budget. The cache should be able to hold at least one element, i.e.:
   // REQUIRES: `max_cache_size_bytes >= max(GetElementSizeBytes(*))`
   explicit CrossTrainerCache(
       size_t max_cache_size_bytes,
       std::unique_ptr<CachableSequence<ElementType>> cachable_sequence);
+  // Creates a `CrossTrainerCache` configured by `config`.
+  // REQUIRES: `config.max_cache_size_bytes >= max(GetElementSizeBytes(*))`
+  explicit CrossTrainerCache(
+      const CrossTrainerCacheConfig& config,
+      std::unique_ptr<CachableSequence<ElementType>> cachable_sequence);
   virtual ~CrossTrainerCache() = default;
   CrossTrainerCache(const CrossTrainerCache&) = delete;
   CrossTrainerCache& operator=(const CrossTrainerCache&) = delete;
@@ -120,40 +197,78 @@ class CrossTrainerCache {
   // Returns true if the cache has been cancelled.
   bool IsCancelled() const;
 
+  // Returns the cache queries made by each trainer.
+  absl::flat_hash_map<std::string, TrainerCacheStats> GetTrainerStats() const;
+
  private:
+  enum class QueryResultType { kHit, kCompressedHit, kMiss };
+
   struct CacheQueryResult {
     std::shared_ptr<const ElementType> element;
-    bool cache_hit;
+    QueryResultType type;
   };
 
-  // Returns the next element and metrics about this query.
-  StatusOr<CacheQueryResult> GetCacheQueryResult(const std::string& trainer_id);
+  struct CacheEntry {
+    std::shared_ptr<const ElementType> element;
+    size_t size_bytes = 0;
+    // Value of `read_counter_` when the element was last read.
+    uint64_t last_read = 0;
+    // In the compressed tier, true if `element` was already compressed and is
+    // returned without uncompressing it.
+    bool stored_as_is = false;
+  };
 
-  // Returns true if element is ready for `trainer_id`. An element is ready if
-  // other trainers have read the data and the data remains in the cache. If the
-  // data is not ready, one of the trainers need to extend the cache.
-  bool IsElementReady(const std::string& trainer_id);
+  struct TrainerState {
+    // Absolute index of the next element the trainer has not read.
+    size_t next_index = 0;
+    absl::Time last_read_time = absl::InfinitePast();
+    TrainerCacheStats stats;
+  };
 
-  // Returns the absolute element index relative to the dataset (not relative to
-  // the cached elements).
-  size_t GetElementIndex(const std::string& trainer_id);
+  // An element evicted from the main cache.
+  struct EvictedElement {
+    size_t index;
+    std::shared_ptr<const ElementType> element;
+    size_t size_bytes;
+  };
 
-  // Returns the next element for `trainer_id`.
-  StatusOr<std::shared_ptr<const ElementType>> GetElement(
-      const std::string& trainer_id);
+  // Returns the next element and metrics about this query.
+  StatusOr<CacheQueryResult> GetCacheQueryResult(const std::string& trainer_id);
+
+  // If an element is ready for `trainer_id`, reads it and returns true. An
+  // element is ready if other trainers have read the data and the data remains
+  // in either tier of the cache. If the element is in the compressed tier,
+  // `compressed` is set, and `uncompress` is set unless the element was stored
+  // as is; the caller should then uncompress it. If the data is not ready, one
+  // of the trainers need to extend the cache.
+  bool TryRead(const std::string& trainer_id,
+               std::shared_ptr<const ElementType>& element, bool& compressed,
+               bool& uncompress);
 
   // Reads a new element and writes it into the cache.
   absl::Status ExtendCache();
 
+  // Returns the smallest `next_index` of the trainers which have read from the
+  // cache within `retention_timeout`, or nullopt if there are none.
+  std::optional<size_t> SlowestActiveTrainerIndex(absl::Time now) const;
+
+  // Returns true if making room for `new_element_size_bytes` would evict an
+  // element that an active trainer has not read yet.
+  bool EvictsUnreadElements(size_t new_element_size_bytes, absl::Time now);
+
   // Frees old elements to keep the cache size below `max_cache_size_bytes_`.
   // `new_element_size_bytes` is the size of the new element being inserted.
-  void FreeSpace(size_t new_element_size_bytes);
+  // Returns the evicted elements if the compressed tier is enabled.
+  std::vector<EvictedElement> FreeSpace(size_t new_element_size_bytes);
+
+  // Compresses `evicted` elements and inserts them into the compressed tier.
+  void InsertCompressed(std::vector<EvictedElement> evicted);
 
   // Records the cache hit rate and cache size.
-  void RecordMetrics(const CacheQueryResult& result);
+  void RecordMetrics(const std::string& trainer_id,
+                     const CacheQueryResult& result);
 
-  // Maximum cache size in bytes.
-  const size_t max_cache_size_bytes_;
+  const CrossTrainerCacheConfig config_;
 
   // The element sequence over which the sliding window cache operates.
   std::unique_ptr<CachableSequence<ElementType>> cachable_sequence_;
@@ -165,31 +280,45 @@ class CrossTrainerCache {
   // return this status.
   absl::Status status_ TF_GUARDED_BY(mu_) = absl::OkStatus();
 
-  // `cache_` stores the cached elements.
-  std::deque<std::shared_ptr<const ElementType>> cache_ TF_GUARDED_BY(mu_);
+  // `cache_` stores the cached elements by their absolute index within the
+  // dataset.
+  absl::btree_map<size_t, CacheEntry> cache_ TF_GUARDED_BY(mu_);
   size_t cache_size_bytes_ TF_GUARDED_BY(mu_) = 0;
-  size_t cache_start_index_ TF_GUARDED_BY(mu_) = 0;
+  // Index of the next element to be inserted into the cache.
+  size_t end_index_ TF_GUARDED_BY(mu_) = 0;
+
+  // Orders `cache_` by `CacheEntry::last_read` for `kLeastRecentlyRead`.
+  absl::btree_set<std::pair<uint64_t, size_t>> read_order_ TF_GUARDED_BY(mu_);
+  uint64_t read_counter_ TF_GUARDED_BY(mu_) = 0;
+
+  // Compressed copies of evicted elements, by their absolute index.
+  absl::btree_map<size_t, CacheEntry> compressed_cache_ TF_GUARDED_BY(mu_);
+  size_t compressed_cache_size_bytes_ TF_GUARDED_BY(mu_) = 0;
 
   // True if one thread is extending the cache.
   bool extending_cache_ TF_GUARDED_BY(mu_) = false;
 
-  // Maps trainer IDs to element indices. The indices are absolute indices
-  // within the dataset. The actual index to use with `cache_` would be
-  // `trainer_to_element_index_map_[trainer_id] - cache_start_index_`.
-  absl::flat_hash_map<std::string, size_t> trainer_to_element_index_map_
-      TF_GUARDED_BY(mu_);
+  absl::flat_hash_map<std::string, TrainerState> trainers_ TF_GUARDED_BY(mu_);
 };
 
 template <class ElementType>
 CrossTrainerCache<ElementType>::CrossTrainerCache(
     size_t max_cache_size_bytes,
     std::unique_ptr<CachableSequence<ElementType>> cachable_sequence)
-    : max_cache_size_bytes_(max_cache_size_bytes),
-      cachable_sequence_(std::move(cachable_sequence)) {
-  DCHECK_GT(max_cache_size_bytes, 0)
+    : CrossTrainerCache(CrossTrainerCacheConfig{max_cache_size_bytes},
+                        std::move(cachable_sequence)) {}
+
+template <class ElementType>
+CrossTrainerCache<ElementType>::CrossTrainerCache(
+    const CrossTrainerCacheConfig& config,
+    std::unique_ptr<CachableSequence<ElementType>> cachable_sequence)
+    : config_(config), cachable_sequence_(std::move(cachable_sequence)) {
+  DCHECK_GT(config.max_cache_size_bytes, 0)
       << "CrossTrainerCache size must be greater than 0.";
   VLOG(2) << "Initialized tf.data service cross-trainer cache with "
-          << ByteSize::Bytes(max_cache_size_bytes) << " of memory.";
+          << ByteSize::Bytes(config.max_cache_size_bytes) << " of memory and "
+          << ByteSize::Bytes(config.max_compressed_cache_size_bytes)
+          << " of compressed memory.";
 }
 
 template <class ElementType>
@@ -202,7 +331,7 @@ CrossTrainerCache<ElementType>::Get(const std::string& trainer_id)
   }
 
   TF_ASSIGN_OR_RETURN(CacheQueryResult result, GetCacheQueryResult(trainer_id));
-  RecordMetrics(result);
+  RecordMetrics(trainer_id, result);
   return result.element;
 }
 
@@ -212,20 +341,22 @@ CrossTrainerCache<ElementType>::GetCacheQueryResult(
     const std::string& trainer_id) {
   bool should_extend_cache = false;
   while (true) {
+    std::shared_ptr<const ElementType> element;
+    bool compressed = false;
+    bool uncompress = false;
     {
       mutex_lock l(mu_);
       TF_RETURN_IF_ERROR(status_);
-      if (IsElementReady(trainer_id)) {
-        TF_ASSIGN_OR_RETURN(std::shared_ptr<const ElementType> element,
-                            GetElement(trainer_id));
-        return CacheQueryResult{element,
-                                /*is_cache_hit=*/!should_extend_cache};
-      }
-
-      // Extends the cache or waits for another thread to extend the cache. When
-      // concurrent trainers wait for the next element, only one of them should
-      // extend the cache.
-      if (extending_cache_) {
+      if (TryRead(trainer_id, element, compressed, uncompress)) {
+        if (!compressed) {
+          return CacheQueryResult{element, should_extend_cache
+                                               ? QueryResultType::kMiss
+                                               : QueryResultType::kHit};
+        }
+      } else if (extending_cache_) {
+        // Extends the cache or waits for another thread to extend the cache.
+        // When concurrent trainers wait for the next element, only one of them
+        // should extend the cache.
         should_extend_cache = false;
         cv_.wait(l);
       } else {
@@ -234,6 +365,17 @@ CrossTrainerCache<ElementType>::GetCacheQueryResult(
       }
     }
 
+    if (compressed && !uncompress) {
+      return CacheQueryResult{element, QueryResultType::kCompressedHit};
+    }
+    if (compressed) {
+      TF_ASSIGN_OR_RETURN(ElementType uncompressed,
+                          cachable_sequence_->Uncompress(*element));
+      return CacheQueryResult{
+          std::make_shared<ElementType>(std::move(uncompressed)),
+          QueryResultType::kCompressedHit};
+    }
+
     if (should_extend_cache) {
       absl::Status s = ExtendCache();
       mutex_lock l(mu_);
@@ -245,36 +387,41 @@ CrossTrainerCache<ElementType>::GetCacheQueryResult(
 }
 
 template <class ElementType>
-bool CrossTrainerCache<ElementType>::IsElementReady(
-    const std::string& trainer_id) TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
-  return GetElementIndex(trainer_id) < cache_start_index_ + cache_.size();
-}
-
-template <class ElementType>
-StatusOr<std::shared_ptr<const ElementType>>
-CrossTrainerCache<ElementType>::GetElement(const std::string& trainer_id)
-    TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
-  size_t element_index = GetElementIndex(trainer_id);
-  if (element_index >= std::numeric_limits<size_t>::max()) {
-    return errors::Internal(
-        "tf.data service caching element index exceeds integer limit. Got ",
-        element_index);
+bool CrossTrainerCache<ElementType>::TryRead(
+    const std::string& trainer_id, std::shared_ptr<const ElementType>& element,
+    bool& compressed, bool& uncompress) TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+  TrainerState& trainer = trainers_[trainer_id];
+  auto it = cache_.lower_bound(trainer.next_index);
+  auto compressed_it = compressed_cache_.lower_bound(trainer.next_index);
+  compressed = compressed_it != compressed_cache_.end() &&
+               (it == cache_.end() || compressed_it->first < it->first);
+  if (!compressed && it == cache_.end()) {
+    return false;
   }
 
-  std::shared_ptr<const ElementType> result =
-      cache_[element_index - cache_start_index_];
-  trainer_to_element_index_map_[trainer_id] = element_index + 1;
-  return result;
-}
-
-template <class ElementType>
-size_t CrossTrainerCache<ElementType>::GetElementIndex(
-    const std::string& trainer_id) TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
-  size_t element_index = trainer_to_element_index_map_[trainer_id];
-  if (element_index < cache_start_index_) {
-    element_index = cache_start_index_;
+  size_t element_index;
+  if (compressed) {
+    element_index = compressed_it->first;
+    element = compressed_it->second.element;
+    uncompress = !compressed_it->second.stored_as_is;
+  } else {
+    element_index = it->first;
+    CacheEntry& entry = it->second;
+    element = entry.element;
+    read_order_.erase({entry.last_read, element_index});
+    entry.last_read = ++read_counter_;
+    read_order_.insert({entry.last_read, element_index});
+  }
+  trainer.next_index = element_index + 1;
+  if (config_.eviction_policy != CacheEvictionPolicy::kFifo) {
+    trainer.last_read_time = absl::Now();
+  }
+  if (config_.eviction_policy ==
+      CacheEvictionPolicy::kRetainForSlowestTrainer) {
+    // The thread extending the cache may be waiting for this read.
+    cv_.notify_all();
   }
-  return element_index;
+  return true;
 }
 
 template <class ElementType>
@@ -283,38 +430,162 @@ absl::Status CrossTrainerCache<ElementType>::ExtendCache()
   TF_ASSIGN_OR_RETURN(ElementType element, cachable_sequence_->GetNext());
   size_t new_element_size_bytes =
       cachable_sequence_->GetElementSizeBytes(element);
-  if (new_element_size_bytes > max_cache_size_bytes_) {
+  if (new_element_size_bytes > config_.max_cache_size_bytes) {
     return errors::InvalidArgument(
         "tf.data service element size is larger than cache size in bytes. Got ",
         "element size: ", new_element_size_bytes,
-        " and cache size: ", max_cache_size_bytes_);
+        " and cache size: ", config_.max_cache_size_bytes);
   }
 
-  mutex_lock l(mu_);
-  TF_RETURN_IF_ERROR(status_);
-  FreeSpace(new_element_size_bytes);
-  cache_.push_back(std::make_shared<ElementType>(std::move(element)));
-  cache_size_bytes_ += new_element_size_bytes;
+  std::vector<EvictedElement> evicted;
+  {
+    mutex_lock l(mu_);
+    TF_RETURN_IF_ERROR(status_);
+    const absl::Time deadline = absl::Now() + config_.retention_timeout;
+    for (absl::Time now = absl::Now();
+         now < deadline && EvictsUnreadElements(new_element_size_bytes, now);
+         now = absl::Now()) {
+      cv_.wait_for(l, absl::ToChronoMicroseconds(deadline - now));
+      TF_RETURN_IF_ERROR(status_);
+    }
+
+    evicted = FreeSpace(new_element_size_bytes);
+    if (end_index_ == std::numeric_limits<size_t>::max()) {
+      return errors::Internal(
+          "tf.data service caching element index exceeds integer limit. Got ",
+          end_index_);
+    }
+    const size_t element_index = end_index_++;
+    CacheEntry& entry = cache_[element_index];
+    entry.element = std::make_shared<ElementType>(std::move(element));
+    entry.size_bytes = new_element_size_bytes;
+    entry.last_read = ++read_counter_;
+    read_order_.insert({entry.last_read, element_index});
+    cache_size_bytes_ += new_element_size_bytes;
+  }
+  InsertCompressed(std::move(evicted));
   return absl::OkStatus();
 }
 
 template <class ElementType>
-void CrossTrainerCache<ElementType>::FreeSpace(size_t new_element_size_bytes)
+std::optional<size_t> CrossTrainerCache<ElementType>::SlowestActiveTrainerIndex(
+    absl::Time now) const TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+  std::optional<size_t> slowest_index;
+  for (const auto& [trainer_id, trainer] : trainers_) {
+    if (now - trainer.last_read_time > config_.retention_timeout) {
+      continue;
+    }
+    if (!slowest_index.has_value() || trainer.next_index < *slowest_index) {
+      slowest_index = trainer.next_index;
+    }
+  }
+  return slowest_index;
+}
+
+template <class ElementType>
+bool CrossTrainerCache<ElementType>::EvictsUnreadElements(
+    size_t new_element_size_bytes, absl::Time now)
     TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+  if (config_.eviction_policy !=
+      CacheEvictionPolicy::kRetainForSlowestTrainer) {
+    return false;
+  }
+
+  const std::optional<size_t> slowest_index = SlowestActiveTrainerIndex(now);
+  if (!slowest_index.has_value()) {
+    return false;
+  }
+
+  size_t cache_size_bytes = cache_size_bytes_;
+  for (auto it = cache_.begin();
+       it != cache_.end() &&
+       cache_size_bytes + new_element_size_bytes > config_.max_cache_size_bytes;
+       ++it) {
+    if (it->first >= *slowest_index) {
+      return true;
+    }
+    cache_size_bytes -= it->second.size_bytes;
+  }
+  return false;
+}
+
+template <class ElementType>
+std::vector<typename CrossTrainerCache<ElementType>::EvictedElement>
+CrossTrainerCache<ElementType>::FreeSpace(size_t new_element_size_bytes)
+    TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+  std::vector<EvictedElement> evicted;
   size_t num_elements_discarded = 0;
-  while (!cache_.empty() &&
-         cache_size_bytes_ + new_element_size_bytes > max_cache_size_bytes_) {
-    size_t free_bytes =
-        cachable_sequence_->GetElementSizeBytes(*cache_.front());
-    cache_.pop_front();
-    cache_size_bytes_ -= free_bytes;
-    ++cache_start_index_;
+  // For `kLeastRecentlyRead`, elements below `slowest_index` have been read by
+  // every active trainer and are evicted before any element still needed.
+  size_t slowest_index = 0;
+  if (config_.eviction_policy == CacheEvictionPolicy::kLeastRecentlyRead) {
+    slowest_index = SlowestActiveTrainerIndex(absl::Now()).value_or(end_index_);
+  }
+  while (!cache_.empty() && cache_size_bytes_ + new_element_size_bytes >
+                                config_.max_cache_size_bytes) {
+    auto it = cache_.begin();
+    if (config_.eviction_policy == CacheEvictionPolicy::kLeastRecentlyRead &&
+        it->first >= slowest_index) {
+      it = cache_.find(read_order_.begin()->second);
+    }
+    CacheEntry& entry = it->second;
+    read_order_.erase({entry.last_read, it->first});
+    cache_size_bytes_ -= entry.size_bytes;
+    if (config_.max_compressed_cache_size_bytes > 0) {
+      evicted.push_back(
+          {it->first, std::move(entry.element), entry.size_bytes});
+    }
+    cache_.erase(it);
     ++num_elements_discarded;
   }
 
   VLOG(3) << "Freed " << num_elements_discarded << " element(s) from "
           << "tf.data service cross-trainer cache. Memory usage: "
           << ByteSize::Bytes(cache_size_bytes_) << ".";
+  return evicted;
+}
+
+template <class ElementType>
+void CrossTrainerCache<ElementType>::InsertCompressed(
+    std::vector<EvictedElement> evicted) TF_LOCKS_EXCLUDED(mu_) {
+  for (EvictedElement& element : evicted) {
+    const bool stored_as_is =
+        cachable_sequence_->IsCompressed(*element.element);
+    std::shared_ptr<const ElementType> compressed = element.element;
+    size_t size_bytes = element.size_bytes;
+    if (!stored_as_is) {
+      StatusOr<ElementType> compressed_element =
+          cachable_sequence_->Compress(*element.element);
+      if (!compressed_element.ok()) {
+        VLOG(3) << "Not caching compressed tf.data service element: "
+                << compressed_element.status();
+        continue;
+      }
+      size_bytes = cachable_sequence_->GetElementSizeBytes(*compressed_element);
+      if (size_bytes >= element.size_bytes) {
+        continue;
+      }
+      compressed =
+          std::make_shared<ElementType>(std::move(*compressed_element));
+    }
+    if (size_bytes > config_.max_compressed_cache_size_bytes) {
+      continue;
+    }
+
+    mutex_lock l(mu_);
+    while (!compressed_cache_.empty() &&
+           compressed_cache_size_bytes_ + size_bytes >
+               config_.max_compressed_cache_size_bytes) {
+      compressed_cache_size_bytes_ -=
+          compressed_cache_.begin()->second.size_bytes;
+      compressed_cache_.erase(compressed_cache_.begin());
+    }
+    CacheEntry& entry = compressed_cache_[element.index];
+    entry.element = std::move(compressed);
+    entry.size_bytes = size_bytes;
+    entry.stored_as_is = stored_as_is;
+    compressed_cache_size_bytes_ += size_bytes;
+  }
 }
 
 template <class ElementType>
@@ -337,16 +608,56 @@ bool CrossTrainerCache<ElementType>::IsCancelled() const
   return !status_.ok();
 }
 
+template <class ElementType>
+absl::flat_hash_map<std::string, TrainerCacheStats>
+CrossTrainerCache<ElementType>::GetTrainerStats() const TF_LOCKS_EXCLUDED(mu_) {
+  mutex_lock l(mu_);
+  absl::flat_hash_map<std::string, TrainerCacheStats> stats;
+  for (const auto& [trainer_id, trainer] : trainers_) {
+    stats[trainer_id] = trainer.stats;
+  }
+  return stats;
+}
+
 template <class ElementType>
 void CrossTrainerCache<ElementType>::RecordMetrics(
-    const CacheQueryResult& result) {
-  metrics::RecordTFDataServiceCrossTrainerCacheQuery(result.cache_hit);
+    const std::string& trainer_id, const CacheQueryResult& result) {
+  metrics::RecordTFDataServiceCrossTrainerCacheQuery(
+      /*cache_hit=*/result.type != QueryResultType::kMiss);
   size_t cache_size_bytes = 0;
+  size_t compressed_cache_size_bytes = 0;
   {
     mutex_lock l(mu_);
+    TrainerCacheStats& stats = trainers_[trainer_id].stats;
+    switch (result.type) {
+      case QueryResultType::kHit:
+        ++stats.hits;
+        break;
+      case QueryResultType::kCompressedHit:
+        ++stats.compressed_hits;
+        break;
+      case QueryResultType::kMiss:
+        ++stats.misses;
+        break;
+    }
     cache_size_bytes = cache_size_bytes_;
+    compressed_cache_size_bytes = compressed_cache_size_bytes_;
+  }
+  switch (result.type) {
+    case QueryResultType::kHit:
+      metrics::RecordTFDataServiceCrossTrainerCacheQueryResult("hit");
+      break;
+    case QueryResultType::kCompressedHit:
+      metrics::RecordTFDataServiceCrossTrainerCacheQueryResult(
+          "compressed_hit");
+      break;
+    case QueryResultType::kMiss:
+      metrics::RecordTFDataServiceCrossTrainerCacheQueryResult("miss");
+      break;
   }
   metrics::RecordTFDataServiceCrossTrainerCacheSizeBytes(cache_size_bytes);
+  metrics::RecordTFDataServiceCrossTrainerCacheCompressedSizeBytes(
+      compressed_cache_size_bytes);
 }
 
 }  // namespace data
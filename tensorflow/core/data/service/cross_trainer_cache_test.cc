@@ -61,6 +61,41 @@ class InfiniteRange : public CachableSequence<int64_t> {
   int64_t next_ = 0;
 };
 
+// Returns 0, 1, 2, ... Each element uses 100 bytes, and 10 bytes when
+// compressed. Compressed elements are stored as `-element - 1`.
+class CompressibleRange : public CachableSequence<int64_t> {
+ public:
+  absl::StatusOr<int64_t> GetNext() override { return next_++; }
+  size_t GetElementSizeBytes(const int64_t& element) const override {
+    return element >= 0 ? 100 : 10;
+  }
+  absl::StatusOr<int64_t> Compress(const int64_t& element) const override {
+    return -element - 1;
+  }
+  absl::StatusOr<int64_t> Uncompress(const int64_t& element) const override {
+    return -element - 1;
+  }
+
+ private:
+  int64_t next_ = 0;
+};
+
+// Produces elements in the compressed form of `CompressibleRange`, as a
+// dataset that compresses its own elements would.
+class PrecompressedRange : public CachableSequence<int64_t> {
+ public:
+  absl::StatusOr<int64_t> GetNext() override { return -(next_++) - 1; }
+  size_t GetElementSizeBytes(const int64_t& element) const override {
+    return 10;
+  }
+  bool IsCompressed(const int64_t& element) const override {
+    return element < 0;
+  }
+
+ private:
+  int64_t next_ = 0;
+};
+
 class TensorDataset : public CachableSequence<Tensor> {
  public:
   absl::StatusOr<Tensor> GetNext() override { return Tensor("Test Tensor"); }
@@ -285,6 +320,176 @@ TEST(CrossTrainerCacheTest, CacheSizeMetrics) {
   }
 }
 
+TEST(CrossTrainerCacheTest, RetainForSlowestTrainer) {
+  CrossTrainerCacheConfig config;
+  config.max_cache_size_bytes = 2 * sizeof(int64_t);
+  config.eviction_policy = CacheEvictionPolicy::kRetainForSlowestTrainer;
+  config.retention_timeout = absl::Minutes(10);
+  CrossTrainerCache<int64_t> cache(config, std::make_unique<InfiniteRange>());
+  EXPECT_THAT(cache.Get("Slow trainer"), IsOkAndHolds(Pointee(0)));
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_THAT(cache.Get("Fast trainer"), IsOkAndHolds(Pointee(i)));
+  }
+
+  // Caching 3 would evict 1, which the slow trainer has not read, so the fast
+  // trainer waits for the slow trainer.
+  std::unique_ptr<Thread> fast_trainer(Env::Default()->StartThread(
+      /*thread_options=*/{}, /*name=*/"Fast_trainer", [&cache]() {
+        EXPECT_THAT(cache.Get("Fast trainer"), IsOkAndHolds(Pointee(3)));
+      }));
+  Env::Default()->SleepForMicroseconds(100000);
+  EXPECT_THAT(cache.Get("Slow trainer"), IsOkAndHolds(Pointee(1)));
+  EXPECT_THAT(cache.Get("Slow trainer"), IsOkAndHolds(Pointee(2)));
+  EXPECT_THAT(cache.Get("Slow trainer"), IsOkAndHolds(Pointee(3)));
+}
+
+TEST(CrossTrainerCacheTest, RetentionTimesOut) {
+  CrossTrainerCacheConfig config;
+  config.max_cache_size_bytes = 2 * sizeof(int64_t);
+  config.eviction_policy = CacheEvictionPolicy::kRetainForSlowestTrainer;
+  config.retention_timeout = absl::Milliseconds(100);
+  CrossTrainerCache<int64_t> cache(config, std::make_unique<InfiniteRange>());
+  EXPECT_THAT(cache.Get("Slow trainer"), IsOkAndHolds(Pointee(0)));
+
+  // The slow trainer stops reading, so the fast trainer stops waiting for it.
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_THAT(cache.Get("Fast trainer"), IsOkAndHolds(Pointee(i)));
+  }
+  EXPECT_THAT(cache.Get("Slow trainer"), IsOkAndHolds(Pointee(Gt(7))));
+}
+
+TEST(CrossTrainerCacheTest, EvictLeastRecentlyRead) {
+  CrossTrainerCacheConfig config;
+  config.max_cache_size_bytes = 3 * sizeof(int64_t);
+  config.eviction_policy = CacheEvictionPolicy::kLeastRecentlyRead;
+  CrossTrainerCache<int64_t> cache(config, std::make_unique<InfiniteRange>());
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_THAT(cache.Get("Trainer 1"), IsOkAndHolds(Pointee(i)));
+  }
+  EXPECT_THAT(cache.Get("Trainer 2"), IsOkAndHolds(Pointee(0)));
+
+  // 1 has gone the longest without being read, but Trainer 2 still needs it.
+  // Caching 3 evicts 0, which both trainers have read.
+  EXPECT_THAT(cache.Get("Trainer 1"), IsOkAndHolds(Pointee(3)));
+
+  // Neither active trainer skips an element.
+  for (int i = 1; i < 4; ++i) {
+    EXPECT_THAT(cache.Get("Trainer 2"), IsOkAndHolds(Pointee(i)));
+  }
+  for (int i = 4; i < 10; ++i) {
+    EXPECT_THAT(cache.Get("Trainer 1"), IsOkAndHolds(Pointee(i)));
+    EXPECT_THAT(cache.Get("Trainer 2"), IsOkAndHolds(Pointee(i)));
+  }
+}
+
+TEST(CrossTrainerCacheTest, EvictLeastRecentlyReadWhenAllElementsAreNeeded) {
+  CrossTrainerCacheConfig config;
+  config.max_cache_size_bytes = 3 * sizeof(int64_t);
+  config.eviction_policy = CacheEvictionPolicy::kLeastRecentlyRead;
+  CrossTrainerCache<int64_t> cache(config, std::make_unique<InfiniteRange>());
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_THAT(cache.Get("Trainer 1"), IsOkAndHolds(Pointee(i)));
+  }
+  EXPECT_THAT(cache.Get("Trainer 2"), IsOkAndHolds(Pointee(0)));
+  EXPECT_THAT(cache.Get("Trainer 2"), IsOkAndHolds(Pointee(1)));
+  EXPECT_THAT(cache.Get("Trainer 3"), IsOkAndHolds(Pointee(0)));
+
+  // Caching 3 evicts 0, which every trainer has read. Caching 4 has to evict
+  // an element Trainer 3 has not read, so it evicts 2, the least recently read.
+  EXPECT_THAT(cache.Get("Trainer 1"), IsOkAndHolds(Pointee(3)));
+  EXPECT_THAT(cache.Get("Trainer 1"), IsOkAndHolds(Pointee(4)));
+  EXPECT_THAT(cache.Get("Trainer 3"), IsOkAndHolds(Pointee(1)));
+  EXPECT_THAT(cache.Get("Trainer 3"), IsOkAndHolds(Pointee(3)));
+}
+
+TEST(CrossTrainerCacheTest, ReadFromCompressedTier) {
+  CellReader<int64_t> compressed_size_reader(
+      "/tensorflow/data/service/cross_trainer_cache_compressed_size_bytes");
+  CrossTrainerCacheConfig config;
+  config.max_cache_size_bytes = 200;
+  config.max_compressed_cache_size_bytes = 1000;
+  CrossTrainerCache<int64_t> cache(config,
+                                   std::make_unique<CompressibleRange>());
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_THAT(cache.Get("Fast trainer"), IsOkAndHolds(Pointee(i)));
+  }
+  EXPECT_EQ(compressed_size_reader.Read(), 80);
+
+  // Elements evicted from the main cache are read from the compressed tier.
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_THAT(cache.Get("Slow trainer"), IsOkAndHolds(Pointee(i)));
+  }
+}
+
+TEST(CrossTrainerCacheTest, CompressedTierEvictsOldestElements) {
+  CrossTrainerCacheConfig config;
+  config.max_cache_size_bytes = 200;
+  config.max_compressed_cache_size_bytes = 30;
+  CrossTrainerCache<int64_t> cache(config,
+                                   std::make_unique<CompressibleRange>());
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_THAT(cache.Get("Fast trainer"), IsOkAndHolds(Pointee(i)));
+  }
+
+  // The compressed tier holds 5, 6, and 7.
+  for (int i = 5; i < 10; ++i) {
+    EXPECT_THAT(cache.Get("Slow trainer"), IsOkAndHolds(Pointee(i)));
+  }
+}
+
+TEST(CrossTrainerCacheTest, TrainerStats) {
+  CellReader<int64_t> cell_reader(
+      "/tensorflow/data/service/cross_trainer_cache_query_results");
+  CrossTrainerCacheConfig config;
+  config.max_cache_size_bytes = 200;
+  config.max_compressed_cache_size_bytes = 1000;
+  CrossTrainerCache<int64_t> cache(config,
+                                   std::make_unique<CompressibleRange>());
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_THAT(cache.Get("Fast trainer"), IsOkAndHolds(Pointee(i)));
+  }
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_THAT(cache.Get("Slow trainer"), IsOkAndHolds(Pointee(i)));
+  }
+
+  absl::flat_hash_map<std::string, TrainerCacheStats> stats =
+      cache.GetTrainerStats();
+  ASSERT_EQ(stats.size(), 2);
+  EXPECT_EQ(stats["Fast trainer"].hits, 0);
+  EXPECT_EQ(stats["Fast trainer"].compressed_hits, 0);
+  EXPECT_EQ(stats["Fast trainer"].misses, 10);
+  EXPECT_DOUBLE_EQ(stats["Fast trainer"].HitRate(), 0.0);
+  EXPECT_EQ(stats["Slow trainer"].hits, 2);
+  EXPECT_EQ(stats["Slow trainer"].compressed_hits, 8);
+  EXPECT_EQ(stats["Slow trainer"].misses, 0);
+  EXPECT_DOUBLE_EQ(stats["Slow trainer"].HitRate(), 1.0);
+
+  EXPECT_EQ(cell_reader.Delta("miss"), 10);
+  EXPECT_EQ(cell_reader.Delta("hit"), 2);
+  EXPECT_EQ(cell_reader.Delta("compressed_hit"), 8);
+}
+
+TEST(CrossTrainerCacheTest, CompressedTierStoresCompressedElementsAsIs) {
+  CrossTrainerCacheConfig config;
+  config.max_cache_size_bytes = 20;
+  config.max_compressed_cache_size_bytes = 1000;
+  CrossTrainerCache<int64_t> cache(config,
+                                   std::make_unique<PrecompressedRange>());
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_THAT(cache.Get("Fast trainer"), IsOkAndHolds(Pointee(-i - 1)));
+  }
+  // `PrecompressedRange` does not implement `Compress` or `Uncompress`, so
+  // the slow trainer can only read evicted elements if they were kept as is.
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_THAT(cache.Get("Slow trainer"), IsOkAndHolds(Pointee(-i - 1)));
+  }
+  absl::flat_hash_map<std::string, TrainerCacheStats> stats =
+      cache.GetTrainerStats();
+  EXPECT_EQ(stats["Slow trainer"].hits, 2);
+  EXPECT_EQ(stats["Slow trainer"].compressed_hits, 8);
+  EXPECT_EQ(stats["Slow trainer"].misses, 0);
+}
+
 TEST(CrossTrainerCacheTest, ConcurrentReaders) {
   size_t num_trainers = 10;
   size_t num_elements_to_read = 200;
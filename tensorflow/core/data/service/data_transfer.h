@@ -18,6 +18,7 @@ limitations under the License.
 
 #include <functional>
 #include <memory>
+#include <optional>
 #include <string>
 #include <vector>
 
@@ -124,6 +125,11 @@ class DataTransferServer {
   // Return the port that this server is listening on.
   virtual int Port() const = 0;
 
+  // Returns the address clients should connect to, or nullopt if clients
+  // connect to the worker's `data_transfer_address` with `Port()` substituted
+  // for its port placeholder.
+  virtual std::optional<std::string> Address() const { return std::nullopt; }
+
   // Register a DataTransferServer factory under `name`.
   static void Register(std::string name, ServerFactoryT factory);
 
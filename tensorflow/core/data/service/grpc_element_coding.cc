@@ -0,0 +1,466 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/data/service/grpc_element_coding.h"
+
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "grpcpp/support/byte_buffer.h"
+#include "grpcpp/support/slice.h"
+#include "tensorflow/core/common_runtime/dma_helper.h"
+#include "tensorflow/core/data/service/data_transfer.h"
+#include "tensorflow/core/data/service/worker.pb.h"
+#include "tensorflow/core/distributed_runtime/rpc/grpc_util.h"
+#include "tensorflow/core/framework/allocator.h"
+#include "tensorflow/core/framework/dataset.pb.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor.pb.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/framework/variant.h"
+#include "tensorflow/core/platform/coding.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/protobuf.h"
+
+namespace tensorflow {
+namespace data {
+namespace {
+
+// Tensor data up to this size is copied into the encoded response instead of
+// being shared, since a separate slice costs more than the copy.
+constexpr size_t kLargeTensorBytes = 1024;
+constexpr size_t kProtoBufLimitBytes = 1ULL << 31;
+
+constexpr uint32 kWireTypeVarint = 0;
+constexpr uint32 kWireTypeLengthDelimited = 2;
+
+constexpr uint32 MakeTag(uint32 field_number, uint32 wire_type) {
+  return (field_number << 3) | wire_type;
+}
+
+size_t VarLengthEncodingSize(uint32 field_number, size_t bytes) {
+  return core::VarintLength(MakeTag(field_number, kWireTypeLengthDelimited)) +
+         core::VarintLength(bytes) + bytes;
+}
+
+// Accumulates a protocol buffer encoding as a sequence of gRPC slices. Small
+// pieces are copied into a shared slice, while large tensor data is added as
+// a slice that references the tensor buffer it lives in.
+class SliceWriter {
+ public:
+  void WriteRawBytes(absl::string_view data) {
+    pending_.append(data.data(), data.size());
+  }
+
+  void WriteVarlengthBeginning(uint32 field_number, size_t length) {
+    core::PutVarint32(&pending_,
+                      MakeTag(field_number, kWireTypeLengthDelimited));
+    core::PutVarint64(&pending_, length);
+  }
+
+  // Writes `data`, which must point into `buffer`.
+  void WriteSharedBytes(absl::string_view data, const TensorBuffer* buffer) {
+    if (data.size() <= kLargeTensorBytes) {
+      WriteRawBytes(data);
+      return;
+    }
+    Flush();
+    buffer->Ref();
+    slices_.emplace_back(
+        const_cast<char*>(data.data()), data.size(),
+        [](void* backing) { static_cast<TensorBuffer*>(backing)->Unref(); },
+        const_cast<TensorBuffer*>(buffer));
+    size_ += data.size();
+  }
+
+  size_t size() const { return size_ + pending_.size(); }
+
+  void Finish(::grpc::ByteBuffer* result) {
+    Flush();
+    ::grpc::ByteBuffer tmp(slices_.data(), slices_.size());
+    result->Swap(&tmp);
+  }
+
+ private:
+  void Flush() {
+    if (pending_.empty()) {
+      return;
+    }
+    slices_.emplace_back(pending_.data(), pending_.size());
+    size_ += pending_.size();
+    pending_.clear();
+  }
+
+  std::string pending_;
+  std::vector<::grpc::Slice> slices_;
+  size_t size_ = 0;
+};
+
+// The encoding of a `TensorProto`: `prefix` holds all fields except for the
+// data of `tensor_content`, which is written from `content` (and is shared
+// with `buffer`).
+struct EncodedTensor {
+  std::string prefix;
+  absl::string_view content;
+  const TensorBuffer* buffer = nullptr;
+
+  size_t size() const { return prefix.size() + content.size(); }
+};
+
+EncodedTensor EncodeTensor(const Tensor& tensor) {
+  EncodedTensor encoded;
+  TensorProto proto;
+  if (!DataTypeCanUseMemcpy(tensor.dtype())) {
+    tensor.AsProtoTensorContent(&proto);
+    proto.AppendToString(&encoded.prefix);
+    return encoded;
+  }
+  proto.set_dtype(tensor.dtype());
+  tensor.shape().AsProto(proto.mutable_tensor_shape());
+  proto.AppendToString(&encoded.prefix);
+  encoded.content = tensor.tensor_data();
+  if (!encoded.content.empty()) {
+    core::PutVarint32(&encoded.prefix,
+                      MakeTag(TensorProto::kTensorContentFieldNumber,
+                              kWireTypeLengthDelimited));
+    core::PutVarint64(&encoded.prefix, encoded.content.size());
+    encoded.buffer = DMAHelper::buffer(&tensor);
+  }
+  return encoded;
+}
+
+absl::Status EncodeCompressedElement(const Tensor& tensor,
+                                     SliceWriter& writer) {
+  const Variant& variant = tensor.scalar<Variant>()();
+  const CompressedElement* compressed = variant.get<CompressedElement>();
+  if (compressed == nullptr) {
+    return errors::FailedPrecondition(
+        "Expected dataset to produce a CompressedElement variant tensor, but "
+        "it produced ",
+        variant.TypeName());
+  }
+  CompressedElement skeleton;
+  *skeleton.mutable_component_metadata() = compressed->component_metadata();
+  skeleton.set_version(compressed->version());
+  std::string encoded_skeleton;
+  skeleton.AppendToString(&encoded_skeleton);
+
+  const std::string& data = compressed->data();
+  size_t compressed_size = encoded_skeleton.size();
+  if (!data.empty()) {
+    compressed_size +=
+        VarLengthEncodingSize(CompressedElement::kDataFieldNumber, data.size());
+  }
+  writer.WriteVarlengthBeginning(GetElementResponse::kCompressedFieldNumber,
+                                 compressed_size);
+  writer.WriteRawBytes(encoded_skeleton);
+  if (!data.empty()) {
+    writer.WriteVarlengthBeginning(CompressedElement::kDataFieldNumber,
+                                   data.size());
+    // The variant tensor's buffer owns the `CompressedElement`.
+    writer.WriteSharedBytes(data, DMAHelper::buffer(&tensor));
+  }
+  return absl::OkStatus();
+}
+
+void EncodeUncompressedElement(const std::vector<Tensor>& components,
+                               SliceWriter& writer) {
+  std::vector<EncodedTensor> encoded_components;
+  encoded_components.reserve(components.size());
+  size_t uncompressed_size = 0;
+  for (const Tensor& component : components) {
+    encoded_components.push_back(EncodeTensor(component));
+    uncompressed_size +=
+        VarLengthEncodingSize(UncompressedElement::kComponentsFieldNumber,
+                              encoded_components.back().size());
+  }
+  writer.WriteVarlengthBeginning(GetElementResponse::kUncompressedFieldNumber,
+                                 uncompressed_size);
+  for (const EncodedTensor& encoded : encoded_components) {
+    writer.WriteVarlengthBeginning(UncompressedElement::kComponentsFieldNumber,
+                                   encoded.size());
+    writer.WriteRawBytes(encoded.prefix);
+    if (!encoded.content.empty()) {
+      writer.WriteSharedBytes(encoded.content, encoded.buffer);
+    }
+  }
+}
+
+bool ReadVarintSizeAsInt(protobuf::io::CodedInputStream* input, int* result) {
+  protobuf_uint64 v;
+  if (input->ReadVarint64(&v) && v <= static_cast<uint64>(INT_MAX)) {
+    *result = static_cast<int>(v);
+    return true;
+  }
+  return false;
+}
+
+// Decodes a `GetElementResponse`, reading the `tensor_content` of memcpy-able
+// tensors directly into their buffers. Returns false if the input is not a
+// valid response, or uses fields this fast path does not handle.
+class ElementDecoder {
+ public:
+  ElementDecoder(protobuf::io::ZeroCopyInputStream* stream,
+                 Allocator* allocator)
+      : input_(stream), allocator_(allocator) {}
+
+  bool Decode(GetElementResult* result) {
+    while (true) {
+      const uint32 tag = input_.ReadTag();
+      switch (tag) {
+        case 0:
+          return input_.ConsumedEntireMessage();
+        case MakeTag(GetElementResponse::kEndOfSequenceFieldNumber,
+                     kWireTypeVarint): {
+          protobuf_uint64 v;
+          if (!input_.ReadVarint64(&v)) return false;
+          result->end_of_sequence = v != 0;
+          break;
+        }
+        case MakeTag(GetElementResponse::kSkipTaskFieldNumber,
+                     kWireTypeVarint): {
+          protobuf_uint64 v;
+          if (!input_.ReadVarint64(&v)) return false;
+          result->skip = v != 0;
+          break;
+        }
+        case MakeTag(GetElementResponse::kElementIndexFieldNumber,
+                     kWireTypeVarint): {
+          protobuf_uint64 v;
+          if (!input_.ReadVarint64(&v)) return false;
+          result->element_index = static_cast<int64_t>(v);
+          break;
+        }
+        case MakeTag(GetElementResponse::kCompressedFieldNumber,
+                     kWireTypeLengthDelimited): {
+          CompressedElement compressed;
+          if (!ReadLengthDelimited([&] {
+                return compressed.MergePartialFromCodedStream(&input_);
+              })) {
+            return false;
+          }
+          Tensor tensor(DT_VARIANT, TensorShape{});
+          tensor.scalar<Variant>()() = std::move(compressed);
+          result->components.clear();
+          result->components.push_back(std::move(tensor));
+          break;
+        }
+        case MakeTag(GetElementResponse::kUncompressedFieldNumber,
+                     kWireTypeLengthDelimited): {
+          result->components.clear();
+          if (!ReadLengthDelimited(
+                  [&] { return DecodeUncompressed(&result->components); })) {
+            return false;
+          }
+          break;
+        }
+        default:
+          return false;
+      }
+    }
+  }
+
+ private:
+  // Pushes a limit of the next varint length, runs `read_contents` and checks
+  // that it consumed exactly that many bytes.
+  template <typename F>
+  bool ReadLengthDelimited(F read_contents) {
+    int length;
+    if (!ReadVarintSizeAsInt(&input_, &length)) return false;
+    std::pair<protobuf::io::CodedInputStream::Limit, int> limit =
+        input_.IncrementRecursionDepthAndPushLimit(length);
+    if (limit.second < 0 || !read_contents()) return false;
+    return input_.DecrementRecursionDepthAndPopLimit(limit.first);
+  }
+
+  bool DecodeUncompressed(std::vector<Tensor>* components) {
+    while (true) {
+      const uint32 tag = input_.ReadTag();
+      if (tag == 0) return true;
+      if (tag != MakeTag(UncompressedElement::kComponentsFieldNumber,
+                         kWireTypeLengthDelimited)) {
+        return false;
+      }
+      Tensor tensor;
+      if (!ReadLengthDelimited([&] { return DecodeTensor(&tensor); })) {
+        return false;
+      }
+      components->push_back(std::move(tensor));
+    }
+  }
+
+  bool DecodeTensor(Tensor* tensor) {
+    TensorProto meta;
+    bool seen_tensor_content = false;
+    while (true) {
+      const uint32 tag = input_.ReadTag();
+      switch (tag) {
+        case 0:
+          return seen_tensor_content || tensor->FromProto(allocator_, meta);
+        case MakeTag(TensorProto::kDtypeFieldNumber, kWireTypeVarint): {
+          uint32 v;
+          if (!input_.ReadVarint32(&v) || seen_tensor_content) return false;
+          meta.set_dtype(static_cast<DataType>(static_cast<int>(v)));
+          if (!DataTypeCanUseMemcpy(meta.dtype())) {
+            // Only memcpy-able tensors are decoded in place. Parse the rest
+            // of the proto as usual.
+            return meta.MergePartialFromCodedStream(&input_) &&
+                   tensor->FromProto(allocator_, meta);
+          }
+          break;
+        }
+        case MakeTag(TensorProto::kTensorShapeFieldNumber,
+                     kWireTypeLengthDelimited): {
+          if (seen_tensor_content ||
+              !ReadLengthDelimited([&] {
+                return meta.mutable_tensor_shape()->MergePartialFromCodedStream(
+                    &input_);
+              })) {
+            return false;
+          }
+          break;
+        }
+        case MakeTag(TensorProto::kTensorContentFieldNumber,
+                     kWireTypeLengthDelimited): {
+          if (seen_tensor_content || !DataTypeCanUseMemcpy(meta.dtype())) {
+            return false;
+          }
+          int num_bytes;
+          if (!ReadVarintSizeAsInt(&input_, &num_bytes)) return false;
+          TensorShape shape;
+          if (!TensorShape::BuildTensorShape(meta.tensor_shape(), &shape)
+                   .ok()) {
+            return false;
+          }
+          // Check the size before allocating, so that a corrupt shape cannot
+          // make the decoder allocate more than the message holds.
+          const int64_t element_size = DataTypeSize(meta.dtype());
+          if (element_size == 0 || num_bytes % element_size != 0 ||
+              shape.num_elements() != num_bytes / element_size) {
+            return false;
+          }
+          Tensor t(allocator_, meta.dtype(), shape);
+          absl::string_view buf = t.tensor_data();
+          if (!input_.ReadRaw(const_cast<char*>(buf.data()), num_bytes)) {
+            return false;
+          }
+          *tensor = std::move(t);
+          seen_tensor_content = true;
+          break;
+        }
+        default:
+          return false;
+      }
+    }
+  }
+
+  protobuf::io::CodedInputStream input_;
+  Allocator* const allocator_;
+};
+
+}  // namespace
+
+absl::Status EncodeElementToByteBuffer(const GetElementResult& element,
+                                       ::grpc::ByteBuffer* result) {
+  GetElementResponse header;
+  header.set_end_of_sequence(element.end_of_sequence);
+  header.set_skip_task(element.skip);
+  header.set_element_index(element.element_index);
+  std::string encoded_header;
+  header.AppendToString(&encoded_header);
+
+  SliceWriter writer;
+  writer.WriteRawBytes(encoded_header);
+  if (!element.end_of_sequence && !element.skip) {
+    const std::vector<Tensor>& components = element.components;
+    if (components.size() == 1 && components[0].dtype() == DT_VARIANT &&
+        TensorShapeUtils::IsScalar(components[0].shape())) {
+      TF_RETURN_IF_ERROR(EncodeCompressedElement(components[0], writer));
+    } else {
+      EncodeUncompressedElement(components, writer);
+    }
+  }
+  if (writer.size() > kProtoBufLimitBytes) {
+    return absl::InternalError(absl::StrCat(
+        "Cannot encode an element that exceeds the 2GB protobuf limit. ",
+        "Exceeded bytes: ", writer.size() - kProtoBufLimitBytes));
+  }
+  writer.Finish(result);
+  return absl::OkStatus();
+}
+
+absl::Status DecodeElementFromByteBuffer(::grpc::ByteBuffer* buffer,
+                                         Allocator* allocator,
+                                         GetElementResult* result) {
+  if (allocator == nullptr) {
+    allocator = cpu_allocator();
+  }
+  {
+    GrpcByteSource source(buffer);
+    ElementDecoder decoder(source.contents(), allocator);
+    GetElementResult decoded;
+    if (decoder.Decode(&decoded)) {
+      *result = std::move(decoded);
+      return absl::OkStatus();
+    }
+  }
+  // Fall back to parsing the full proto, e.g. if the response was encoded by
+  // a different implementation.
+  GetElementResponse response;
+  if (!tsl::GrpcMaybeParseProto(buffer, &response)) {
+    return errors::Internal("Failed to parse GetElementResponse.");
+  }
+  return ElementFromResponse(std::move(response), allocator, result);
+}
+
+absl::Status ElementFromResponse(GetElementResponse&& response,
+                                 Allocator* allocator,
+                                 GetElementResult* result) {
+  if (allocator == nullptr) {
+    allocator = cpu_allocator();
+  }
+  result->end_of_sequence = response.end_of_sequence();
+  result->skip = response.skip_task();
+  result->element_index = response.element_index();
+  switch (response.element_case()) {
+    case GetElementResponse::kCompressed: {
+      Tensor tensor(DT_VARIANT, TensorShape{});
+      tensor.scalar<Variant>()() = std::move(*response.mutable_compressed());
+      result->components.push_back(tensor);
+      break;
+    }
+    case GetElementResponse::kUncompressed:
+      for (const auto& component : response.uncompressed().components()) {
+        result->components.emplace_back();
+        if (!result->components.back().FromProto(allocator, component)) {
+          return errors::Internal("Failed to parse tensor.");
+        }
+      }
+      break;
+    case GetElementResponse::ELEMENT_NOT_SET:
+      break;
+  }
+  return absl::OkStatus();
+}
+
+}  // namespace data
+}  // namespace tensorflow
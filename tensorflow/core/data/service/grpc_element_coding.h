@@ -0,0 +1,58 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_DATA_SERVICE_GRPC_ELEMENT_CODING_H_
+#define TENSORFLOW_CORE_DATA_SERVICE_GRPC_ELEMENT_CODING_H_
+
+#include "absl/status/status.h"
+#include "grpcpp/support/byte_buffer.h"
+#include "tensorflow/core/data/service/data_transfer.h"
+#include "tensorflow/core/data/service/worker.pb.h"
+#include "tensorflow/core/framework/allocator.h"
+
+namespace tensorflow {
+namespace data {
+
+// Full name of the gRPC method that serves `GetElementRequest`s with responses
+// encoded by `EncodeElementToByteBuffer`.
+inline constexpr char kGrpcGetElementMethod[] =
+    "/tensorflow.data.ElementTransferService/GetElement";
+
+// Encodes `element` into `*result` as a serialized `GetElementResponse`.
+//
+// Large tensor buffers, and the data of `CompressedElement`s, are not copied:
+// `*result` holds slices that reference the memory of `element`'s tensors and
+// keep it alive until gRPC is done with them. `element`'s tensors must not be
+// mutated while `*result` is alive.
+absl::Status EncodeElementToByteBuffer(const GetElementResult& element,
+                                       ::grpc::ByteBuffer* result);
+
+// Decodes a serialized `GetElementResponse` from `buffer` into `*result`.
+// The contents of uncompressed tensors are read directly from the gRPC slices
+// into tensors allocated with `allocator`, or with the CPU allocator if
+// `allocator` is null.
+absl::Status DecodeElementFromByteBuffer(::grpc::ByteBuffer* buffer,
+                                         Allocator* allocator,
+                                         GetElementResult* result);
+
+// Moves the element in `response` into `*result`, allocating uncompressed
+// tensors with `allocator`, or with the CPU allocator if `allocator` is null.
+absl::Status ElementFromResponse(GetElementResponse&& response,
+                                 Allocator* allocator,
+                                 GetElementResult* result);
+
+}  // namespace data
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_DATA_SERVICE_GRPC_ELEMENT_CODING_H_
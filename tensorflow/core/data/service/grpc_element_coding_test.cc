@@ -0,0 +1,277 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/data/service/grpc_element_coding.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "grpcpp/security/server_credentials.h"
+#include "grpcpp/server.h"
+#include "grpcpp/server_builder.h"
+#include "grpcpp/server_context.h"
+#include "grpcpp/support/byte_buffer.h"
+#include "grpcpp/support/slice.h"
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "tensorflow/core/data/compression_utils.h"
+#include "tensorflow/core/data/service/credentials_factory.h"
+#include "tensorflow/core/data/service/data_transfer.h"
+#include "tensorflow/core/data/service/grpc_worker_impl.h"
+#include "tensorflow/core/data/service/worker.grpc.pb.h"
+#include "tensorflow/core/data/service/worker.pb.h"
+#include "tensorflow/core/data/service/worker_client.h"
+#include "tensorflow/core/distributed_runtime/rpc/grpc_util.h"
+#include "tensorflow/core/framework/dataset.pb.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/framework/types.pb.h"
+#include "tensorflow/core/framework/variant.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+#include "tensorflow/core/protobuf/data_service.pb.h"
+
+namespace tensorflow {
+namespace data {
+namespace {
+
+constexpr const char kProtocol[] = "grpc";
+
+std::vector<Tensor> TestComponents() {
+  return {test::AsTensor<int64_t>({1, 2, 3}),
+          test::AsTensor<float>(std::vector<float>(4096, 0.5f), {64, 64}),
+          test::AsTensor<tstring>({"a", "b"}, {2}),
+          Tensor(DT_FLOAT, TensorShape({0, 3}))};
+}
+
+void ExpectComponentsEqual(const std::vector<Tensor>& actual,
+                           const std::vector<Tensor>& expected) {
+  ASSERT_EQ(actual.size(), expected.size());
+  for (size_t i = 0; i < actual.size(); ++i) {
+    test::ExpectEqual(actual[i], expected[i]);
+  }
+}
+
+// Encodes `element` and decodes it both with `DecodeElementFromByteBuffer` and
+// as a regular `GetElementResponse`.
+void RoundTrip(const GetElementResult& element, GetElementResult& decoded,
+               GetElementResult& decoded_from_proto) {
+  ::grpc::ByteBuffer buffer;
+  TF_ASSERT_OK(EncodeElementToByteBuffer(element, &buffer));
+  GetElementResponse response;
+  ASSERT_TRUE(tsl::GrpcMaybeParseProto(&buffer, &response));
+  TF_ASSERT_OK(ElementFromResponse(std::move(response), /*allocator=*/nullptr,
+                                   &decoded_from_proto));
+  TF_ASSERT_OK(DecodeElementFromByteBuffer(&buffer, /*allocator=*/nullptr,
+                                           &decoded));
+}
+
+TEST(GrpcElementCodingTest, Uncompressed) {
+  GetElementResult element;
+  element.components = TestComponents();
+  element.element_index = 7;
+  GetElementResult decoded, decoded_from_proto;
+  RoundTrip(element, decoded, decoded_from_proto);
+  for (const GetElementResult* result : {&decoded, &decoded_from_proto}) {
+    ExpectComponentsEqual(result->components, element.components);
+    EXPECT_EQ(result->element_index, 7);
+    EXPECT_FALSE(result->end_of_sequence);
+    EXPECT_FALSE(result->skip);
+  }
+}
+
+TEST(GrpcElementCodingTest, Compressed) {
+  CompressedElement compressed;
+  TF_ASSERT_OK(CompressElement(TestComponents(), &compressed));
+  GetElementResult element;
+  element.components.push_back(Tensor(DT_VARIANT, TensorShape{}));
+  element.components[0].scalar<Variant>()() = compressed;
+  GetElementResult decoded, decoded_from_proto;
+  RoundTrip(element, decoded, decoded_from_proto);
+  for (const GetElementResult* result : {&decoded, &decoded_from_proto}) {
+    ASSERT_EQ(result->components.size(), 1);
+    const CompressedElement* decoded_compressed =
+        result->components[0].scalar<Variant>()().get<CompressedElement>();
+    ASSERT_NE(decoded_compressed, nullptr);
+    EXPECT_EQ(decoded_compressed->SerializeAsString(),
+              compressed.SerializeAsString());
+    std::vector<Tensor> uncompressed;
+    TF_ASSERT_OK(UncompressElement(*decoded_compressed, &uncompressed));
+    ExpectComponentsEqual(uncompressed, TestComponents());
+  }
+}
+
+TEST(GrpcElementCodingTest, EndOfSequence) {
+  GetElementResult element;
+  element.end_of_sequence = true;
+  GetElementResult decoded, decoded_from_proto;
+  RoundTrip(element, decoded, decoded_from_proto);
+  for (const GetElementResult* result : {&decoded, &decoded_from_proto}) {
+    EXPECT_TRUE(result->end_of_sequence);
+    EXPECT_TRUE(result->components.empty());
+  }
+}
+
+TEST(GrpcElementCodingTest, DecodeSerializedResponse) {
+  GetElementResponse response;
+  response.set_skip_task(true);
+  for (const Tensor& component : TestComponents()) {
+    // Unlike `EncodeElementToByteBuffer`, writes the data of memcpy-able
+    // tensors as repeated fields rather than `tensor_content`.
+    component.AsProtoField(response.mutable_uncompressed()->add_components());
+  }
+  std::string serialized = response.SerializeAsString();
+  ::grpc::Slice slice(serialized.data(), serialized.size());
+  ::grpc::ByteBuffer buffer(&slice, 1);
+  GetElementResult decoded;
+  TF_ASSERT_OK(DecodeElementFromByteBuffer(&buffer, /*allocator=*/nullptr,
+                                           &decoded));
+  EXPECT_TRUE(decoded.skip);
+  ExpectComponentsEqual(decoded.components, TestComponents());
+}
+
+TEST(GrpcElementCodingTest, RejectsContentOfWrongSize) {
+  GetElementResponse response;
+  TensorProto* component = response.mutable_uncompressed()->add_components();
+  component->set_dtype(DT_FLOAT);
+  // The shape claims far more data than the message holds.
+  component->mutable_tensor_shape()->add_dim()->set_size(int64_t{1} << 40);
+  component->set_tensor_content(std::string(8, '\0'));
+  std::string serialized = response.SerializeAsString();
+  ::grpc::Slice slice(serialized.data(), serialized.size());
+  ::grpc::ByteBuffer buffer(&slice, 1);
+  GetElementResult decoded;
+  EXPECT_FALSE(DecodeElementFromByteBuffer(&buffer, /*allocator=*/nullptr,
+                                           &decoded)
+                   .ok());
+}
+
+// Serves copies of an element the way `GrpcWorkerImpl` does, but without a
+// dispatcher. If `zero_copy` is false, only `WorkerService.GetElement` is
+// served.
+class TestElementServer {
+ public:
+  TestElementServer(const GetElementResult& element, bool zero_copy)
+      : proto_service_(element),
+        transfer_service_(
+            [&element](const GetElementRequest*, GetElementResult* result) {
+              *result = element.Copy();
+              return absl::OkStatus();
+            }) {
+    std::shared_ptr<::grpc::ServerCredentials> credentials;
+    TF_CHECK_OK(
+        CredentialsFactory::CreateServerCredentials(kProtocol, &credentials));
+    ::grpc::ServerBuilder builder;
+    builder.AddListeningPort("localhost:0", credentials, &port_);
+    builder.RegisterService(&proto_service_);
+    if (zero_copy) {
+      builder.RegisterService(&transfer_service_);
+    }
+    server_ = builder.BuildAndStart();
+  }
+
+  ~TestElementServer() { server_->Shutdown(); }
+
+  std::string Address() const { return absl::StrCat("localhost:", port_); }
+
+ private:
+  class ProtoWorkerService : public WorkerService::Service {
+   public:
+    explicit ProtoWorkerService(const GetElementResult& element)
+        : element_(element) {}
+
+    ::grpc::Status GetElement(::grpc::ServerContext* context,
+                              const GetElementRequest* request,
+                              GetElementResponse* response) override {
+      for (const Tensor& component : element_.components) {
+        component.AsProtoTensorContent(
+            response->mutable_uncompressed()->add_components());
+      }
+      return ::grpc::Status::OK;
+    }
+
+   private:
+    const GetElementResult& element_;
+  };
+
+  ProtoWorkerService proto_service_;
+  GrpcElementTransferService transfer_service_;
+  int port_ = 0;
+  std::unique_ptr<::grpc::Server> server_;
+};
+
+std::unique_ptr<DataServiceWorkerClient> CreateClient(
+    const std::string& address) {
+  DataTransferServerInfo info;
+  info.set_address(address);
+  info.set_protocol(kProtocol);
+  absl::StatusOr<std::unique_ptr<DataServiceWorkerClient>> client =
+      CreateDataServiceWorkerClient(kProtocol, info,
+                                    /*accelerator_device_info=*/nullptr,
+                                    /*allocator=*/nullptr);
+  TF_CHECK_OK(client.status());
+  return std::move(*client);
+}
+
+class GrpcElementTransferTest : public ::testing::TestWithParam<bool> {};
+
+TEST_P(GrpcElementTransferTest, GetElement) {
+  GetElementResult element;
+  element.components = TestComponents();
+  TestElementServer server(element, /*zero_copy=*/GetParam());
+  std::unique_ptr<DataServiceWorkerClient> client =
+      CreateClient(server.Address());
+  for (int i = 0; i < 3; ++i) {
+    GetElementResult result;
+    TF_ASSERT_OK(client->GetElement(GetElementRequest(), result));
+    ExpectComponentsEqual(result.components, element.components);
+  }
+}
+
+INSTANTIATE_TEST_SUITE_P(ZeroCopy, GrpcElementTransferTest,
+                         ::testing::Bool());
+
+void BM_GetElement(::testing::benchmark::State& state) {
+  const int64_t element_bytes = state.range(0);
+  const bool zero_copy = state.range(1);
+  GetElementResult element;
+  element.components.push_back(Tensor(DT_UINT8, TensorShape({element_bytes})));
+  element.components[0].flat<uint8>().setConstant(1);
+  TestElementServer server(element, zero_copy);
+  std::unique_ptr<DataServiceWorkerClient> client =
+      CreateClient(server.Address());
+
+  for (auto s : state) {
+    GetElementResult result;
+    TF_CHECK_OK(client->GetElement(GetElementRequest(), result));
+  }
+  state.SetBytesProcessed(state.iterations() * element_bytes);
+}
+
+BENCHMARK(BM_GetElement)
+    ->ArgPair(1 << 10, false)
+    ->ArgPair(1 << 10, true)
+    ->ArgPair(1 << 20, false)
+    ->ArgPair(1 << 20, true)
+    ->ArgPair(64 << 20, false)
+    ->ArgPair(64 << 20, true);
+
+}  // namespace
+}  // namespace data
+}  // namespace tensorflow
@@ -17,11 +17,19 @@ limitations under the License.
 
 #include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
+#include "grpcpp/impl/codegen/method_handler.h"
+#include "grpcpp/impl/codegen/proto_utils.h"
+#include "grpcpp/impl/codegen/rpc_method.h"
+#include "grpcpp/impl/codegen/rpc_service_method.h"
 #include "grpcpp/server_builder.h"
 #include "grpcpp/server_context.h"
+#include "grpcpp/support/byte_buffer.h"
+#include "tensorflow/core/data/service/data_transfer.h"
 #include "tensorflow/core/data/service/export.pb.h"
+#include "tensorflow/core/data/service/grpc_element_coding.h"
 #include "tensorflow/core/data/service/worker_impl.h"
 #include "tensorflow/core/distributed_runtime/rpc/grpc_util.h"
 #include "tensorflow/core/platform/errors.h"
@@ -34,10 +42,39 @@ namespace data {
 using ::grpc::ServerBuilder;
 using ::grpc::ServerContext;
 
+GrpcElementTransferService::GrpcElementTransferService(
+    GetElementFn get_element)
+    : get_element_(std::move(get_element)) {
+  AddMethod(new ::grpc::internal::RpcServiceMethod(
+      kGrpcGetElementMethod, ::grpc::internal::RpcMethod::NORMAL_RPC,
+      new ::grpc::internal::RpcMethodHandler<GrpcElementTransferService,
+                                             GetElementRequest,
+                                             ::grpc::ByteBuffer>(
+          [](GrpcElementTransferService* service, ServerContext* context,
+             const GetElementRequest* request, ::grpc::ByteBuffer* response) {
+            return service->GetElement(context, request, response);
+          },
+          this)));
+}
+
+::grpc::Status GrpcElementTransferService::GetElement(
+    ServerContext* context, const GetElementRequest* request,
+    ::grpc::ByteBuffer* response) {
+  VLOG(3) << "Received GetElement request for task " << request->task_id();
+  GetElementResult result;
+  absl::Status s = get_element_(request, &result);
+  if (s.ok()) {
+    s = EncodeElementToByteBuffer(result, response);
+  }
+  return ToGrpcStatus(s);
+}
+
 GrpcWorkerImpl::GrpcWorkerImpl(const experimental::WorkerConfig& config,
                                ServerBuilder& server_builder)
-    : impl_(std::make_shared<DataServiceWorkerImpl>(config)) {
+    : impl_(std::make_shared<DataServiceWorkerImpl>(config)),
+      element_transfer_service_(get_element_getter()) {
   server_builder.RegisterService(this);
+  server_builder.RegisterService(&element_transfer_service_);
   VLOG(1) << "Registered data service worker";
 }
 
@@ -21,7 +21,11 @@ limitations under the License.
 #include <string>
 #include <vector>
 
+#include "grpcpp/impl/codegen/service_type.h"
 #include "grpcpp/server_builder.h"
+#include "grpcpp/server_context.h"
+#include "grpcpp/support/byte_buffer.h"
+#include "tensorflow/core/data/service/data_transfer.h"
 #include "tensorflow/core/data/service/export.pb.h"
 #include "tensorflow/core/data/service/worker.grpc.pb.h"
 #include "tensorflow/core/data/service/worker.pb.h"
@@ -32,6 +36,28 @@ limitations under the License.
 namespace tensorflow {
 namespace data {
 
+// Serves `kGrpcGetElementMethod`, which returns the elements produced by
+// `get_element` encoded with `EncodeElementToByteBuffer`. Unlike
+// `WorkerService.GetElement`, tensor memory is handed to gRPC as is instead of
+// being copied into a `GetElementResponse` and then serialized.
+class GrpcElementTransferService : public ::grpc::Service {
+ public:
+  using GetElementFn = std::function<absl::Status(const GetElementRequest*,
+                                                  GetElementResult*)>;
+
+  explicit GrpcElementTransferService(GetElementFn get_element);
+
+ private:
+  ::grpc::Status GetElement(::grpc::ServerContext* context,
+                            const GetElementRequest* request,
+                            ::grpc::ByteBuffer* response);
+
+  const GetElementFn get_element_;
+
+  GrpcElementTransferService(const GrpcElementTransferService&) = delete;
+  void operator=(const GrpcElementTransferService&) = delete;
+};
+
 // This class is a wrapper that handles communication for gRPC.
 class GrpcWorkerImpl : public WorkerService::Service {
  public:
@@ -70,6 +96,7 @@ class GrpcWorkerImpl : public WorkerService::Service {
   // A std::shared_ptr allows clients to access local servers and directly call
   // the servers' methods to avoid RPC calls and data copy.
   std::shared_ptr<DataServiceWorkerImpl> impl_;
+  GrpcElementTransferService element_transfer_service_;
 
   GrpcWorkerImpl(const GrpcWorkerImpl&) = delete;
   void operator=(const GrpcWorkerImpl&) = delete;
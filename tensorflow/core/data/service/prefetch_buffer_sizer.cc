@@ -0,0 +1,97 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/data/service/prefetch_buffer_sizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+#include "absl/log/check.h"
+#include "absl/time/time.h"
+#include "tsl/platform/mutex.h"
+
+namespace tensorflow {
+namespace data {
+namespace {
+
+// Weight of the latest observation in the moving averages.
+constexpr double kSmoothingFactor = 0.2;
+// The buffer covers requests for this many times the production time.
+constexpr double kProductionTimeMultiplier = 2.0;
+// Credits are remembered for between one and two windows.
+constexpr absl::Duration kCreditWindow = absl::Seconds(1);
+
+void UpdateMovingAverage(double value, double& average) {
+  average = average == 0
+                ? value
+                : kSmoothingFactor * value + (1 - kSmoothingFactor) * average;
+}
+
+}  // namespace
+
+PrefetchBufferSizer::PrefetchBufferSizer(size_t min_buffer_size,
+                                         size_t max_buffer_size)
+    : min_buffer_size_(min_buffer_size), max_buffer_size_(max_buffer_size) {
+  DCHECK_GT(min_buffer_size_, 0);
+  DCHECK_LE(min_buffer_size_, max_buffer_size_);
+}
+
+void PrefetchBufferSizer::RecordRequest(absl::Time time,
+                                        std::optional<int64_t> credits) {
+  tsl::mutex_lock l(mu_);
+  if (last_request_time_.has_value() && time > *last_request_time_) {
+    UpdateMovingAverage(absl::ToDoubleMicroseconds(time - *last_request_time_),
+                        request_interval_us_);
+  }
+  last_request_time_ = time;
+
+  if (time - credit_window_start_ >= kCreditWindow) {
+    previous_window_credits_ = window_credits_;
+    window_credits_ = std::nullopt;
+    credit_window_start_ = time;
+  }
+  if (credits.has_value()) {
+    window_credits_ = std::max(window_credits_.value_or(0), *credits);
+  }
+}
+
+void PrefetchBufferSizer::RecordElementProduced(absl::Duration duration) {
+  tsl::mutex_lock l(mu_);
+  UpdateMovingAverage(
+      std::max(absl::ToDoubleMicroseconds(duration), 1.0),
+      production_time_us_);
+}
+
+size_t PrefetchBufferSizer::BufferSize() const {
+  tsl::tf_shared_lock l(mu_);
+  if (request_interval_us_ == 0 || production_time_us_ == 0) {
+    return min_buffer_size_;
+  }
+  double buffer_size = std::ceil(kProductionTimeMultiplier *
+                                 production_time_us_ / request_interval_us_);
+  if (window_credits_.has_value() || previous_window_credits_.has_value()) {
+    const int64_t credits = std::max(window_credits_.value_or(0),
+                                     previous_window_credits_.value_or(0));
+    buffer_size = std::min(buffer_size, static_cast<double>(credits));
+  }
+  return static_cast<size_t>(
+      std::clamp(buffer_size, static_cast<double>(min_buffer_size_),
+                 static_cast<double>(max_buffer_size_)));
+}
+
+}  // namespace data
+}  // namespace tensorflow
@@ -0,0 +1,78 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_DATA_SERVICE_PREFETCH_BUFFER_SIZER_H_
+#define TENSORFLOW_CORE_DATA_SERVICE_PREFETCH_BUFFER_SIZER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+#include "absl/time/time.h"
+#include "tsl/platform/mutex.h"
+#include "tsl/platform/thread_annotations.h"
+
+namespace tensorflow {
+namespace data {
+
+// Sizes the prefetch buffer of a tf.data service worker task.
+//
+// Consumers use credit-based flow control: a request may advertise how many
+// more elements the consumer can absorb. The buffer never holds more elements
+// than consumers advertised room for in the last second, so slow consumers,
+// whose buffers are full, shrink it to `min_buffer_size`. Within that limit,
+// the buffer holds enough elements to serve requests at the observed rate for
+// twice the time it takes to produce an element, so that fast consumers are
+// not starved by variance in production time.
+//
+// Until both rates have been observed, the buffer size is `min_buffer_size`.
+//
+// PrefetchBufferSizer is thread-safe.
+class PrefetchBufferSizer {
+ public:
+  // REQUIRES: 0 < min_buffer_size <= max_buffer_size
+  PrefetchBufferSizer(size_t min_buffer_size, size_t max_buffer_size);
+
+  // Records a consumer request received at `time`. `credits` is the number of
+  // additional elements the consumer can absorb, or nullopt if the consumer
+  // did not advertise it.
+  void RecordRequest(absl::Time time, std::optional<int64_t> credits)
+      TF_LOCKS_EXCLUDED(mu_);
+
+  // Records that producing an element took `duration`.
+  void RecordElementProduced(absl::Duration duration) TF_LOCKS_EXCLUDED(mu_);
+
+  // Returns the number of elements the buffer should hold.
+  size_t BufferSize() const TF_LOCKS_EXCLUDED(mu_);
+
+ private:
+  const size_t min_buffer_size_;
+  const size_t max_buffer_size_;
+
+  mutable tsl::mutex mu_;
+  std::optional<absl::Time> last_request_time_ TF_GUARDED_BY(mu_);
+  // Exponential moving averages of the time between requests and the time to
+  // produce an element, in microseconds. Zero until first observed.
+  double request_interval_us_ TF_GUARDED_BY(mu_) = 0;
+  double production_time_us_ TF_GUARDED_BY(mu_) = 0;
+  // The most credits advertised in the current and previous windows.
+  absl::Time credit_window_start_ TF_GUARDED_BY(mu_) = absl::InfinitePast();
+  std::optional<int64_t> window_credits_ TF_GUARDED_BY(mu_);
+  std::optional<int64_t> previous_window_credits_ TF_GUARDED_BY(mu_);
+};
+
+}  // namespace data
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_DATA_SERVICE_PREFETCH_BUFFER_SIZER_H_
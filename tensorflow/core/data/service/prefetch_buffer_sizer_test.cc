@@ -0,0 +1,116 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/data/service/prefetch_buffer_sizer.h"
+
+#include <cstdint>
+#include <optional>
+
+#include "absl/time/time.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace data {
+namespace {
+
+constexpr absl::Time kStartTime = absl::FromUnixSeconds(1000);
+
+// Records `num_requests` requests `interval` apart, starting at `start`, each
+// followed by an element that took `production_time` to produce. Returns the
+// time of the last request.
+absl::Time RecordRequests(PrefetchBufferSizer& sizer, absl::Time start,
+                          int64_t num_requests, absl::Duration interval,
+                          absl::Duration production_time,
+                          std::optional<int64_t> credits = std::nullopt) {
+  absl::Time time = start;
+  for (int64_t i = 0; i < num_requests; ++i) {
+    time = start + i * interval;
+    sizer.RecordRequest(time, credits);
+    sizer.RecordElementProduced(production_time);
+  }
+  return time;
+}
+
+TEST(PrefetchBufferSizerTest, StartsAtMinBufferSize) {
+  PrefetchBufferSizer sizer(/*min_buffer_size=*/2, /*max_buffer_size=*/16);
+  EXPECT_EQ(sizer.BufferSize(), 2);
+  sizer.RecordRequest(kStartTime, /*credits=*/std::nullopt);
+  EXPECT_EQ(sizer.BufferSize(), 2);
+}
+
+TEST(PrefetchBufferSizerTest, FastConsumerGrowsBuffer) {
+  PrefetchBufferSizer sizer(/*min_buffer_size=*/1, /*max_buffer_size=*/64);
+  RecordRequests(sizer, kStartTime, /*num_requests=*/10,
+                 /*interval=*/absl::Milliseconds(1),
+                 /*production_time=*/absl::Milliseconds(5));
+  EXPECT_EQ(sizer.BufferSize(), 10);
+}
+
+TEST(PrefetchBufferSizerTest, SlowConsumerKeepsMinBufferSize) {
+  PrefetchBufferSizer sizer(/*min_buffer_size=*/1, /*max_buffer_size=*/64);
+  RecordRequests(sizer, kStartTime, /*num_requests=*/10,
+                 /*interval=*/absl::Milliseconds(100),
+                 /*production_time=*/absl::Milliseconds(5));
+  EXPECT_EQ(sizer.BufferSize(), 1);
+}
+
+TEST(PrefetchBufferSizerTest, ClampsToMaxBufferSize) {
+  PrefetchBufferSizer sizer(/*min_buffer_size=*/1, /*max_buffer_size=*/4);
+  RecordRequests(sizer, kStartTime, /*num_requests=*/10,
+                 /*interval=*/absl::Milliseconds(1),
+                 /*production_time=*/absl::Milliseconds(5));
+  EXPECT_EQ(sizer.BufferSize(), 4);
+}
+
+TEST(PrefetchBufferSizerTest, CreditsCapBufferSize) {
+  PrefetchBufferSizer sizer(/*min_buffer_size=*/1, /*max_buffer_size=*/64);
+  RecordRequests(sizer, kStartTime, /*num_requests=*/10,
+                 /*interval=*/absl::Milliseconds(1),
+                 /*production_time=*/absl::Milliseconds(5), /*credits=*/3);
+  EXPECT_EQ(sizer.BufferSize(), 3);
+}
+
+TEST(PrefetchBufferSizerTest, ZeroCreditsShrinkToMinBufferSize) {
+  PrefetchBufferSizer sizer(/*min_buffer_size=*/2, /*max_buffer_size=*/64);
+  RecordRequests(sizer, kStartTime, /*num_requests=*/10,
+                 /*interval=*/absl::Milliseconds(1),
+                 /*production_time=*/absl::Milliseconds(5), /*credits=*/0);
+  EXPECT_EQ(sizer.BufferSize(), 2);
+}
+
+TEST(PrefetchBufferSizerTest, CreditsExpire) {
+  PrefetchBufferSizer sizer(/*min_buffer_size=*/1, /*max_buffer_size=*/64);
+  absl::Time time = RecordRequests(
+      sizer, kStartTime, /*num_requests=*/10,
+      /*interval=*/absl::Milliseconds(1),
+      /*production_time=*/absl::Milliseconds(5), /*credits=*/3);
+  EXPECT_EQ(sizer.BufferSize(), 3);
+
+  // Credits from the previous window still apply.
+  time = RecordRequests(sizer, time + absl::Milliseconds(1500),
+                        /*num_requests=*/100,
+                        /*interval=*/absl::Milliseconds(1),
+                        /*production_time=*/absl::Milliseconds(5));
+  EXPECT_EQ(sizer.BufferSize(), 3);
+
+  RecordRequests(sizer, time + absl::Milliseconds(1500),
+                 /*num_requests=*/100,
+                 /*interval=*/absl::Milliseconds(1),
+                 /*production_time=*/absl::Milliseconds(5));
+  EXPECT_GT(sizer.BufferSize(), 3);
+}
+
+}  // namespace
+}  // namespace data
+}  // namespace tensorflow
@@ -17,6 +17,7 @@ limitations under the License.
 
 #include <iterator>
 #include <memory>
+#include <optional>
 #include <string>
 #include <utility>
 #include <vector>
@@ -208,16 +209,24 @@ void WorkerGrpcDataServer::MaybeStartAlternativeDataTransferServer(
                << s;
     return;
   }
-  LOG(INFO) << "Data transfer server started at 0.0.0.0:"
-            << transfer_server_->Port() << " for protocol "
-            << config_.data_transfer_protocol() << " for worker "
-            << config_.worker_address();
   DataTransferServerInfo alternative_transfer_server;
   alternative_transfer_server.set_protocol(config_.data_transfer_protocol());
-  alternative_transfer_server.set_address(str_util::StringReplace(
-      config_.data_transfer_address(), kDataTransferPortPlaceholder,
-      absl::StrCat(transfer_server_->Port()),
-      /*replace_all=*/false));
+  if (std::optional<std::string> address = transfer_server_->Address();
+      address.has_value()) {
+    LOG(INFO) << "Data transfer server started at " << *address
+              << " for protocol " << config_.data_transfer_protocol()
+              << " for worker " << config_.worker_address();
+    alternative_transfer_server.set_address(*address);
+  } else {
+    LOG(INFO) << "Data transfer server started at 0.0.0.0:"
+              << transfer_server_->Port() << " for protocol "
+              << config_.data_transfer_protocol() << " for worker "
+              << config_.worker_address();
+    alternative_transfer_server.set_address(str_util::StringReplace(
+        config_.data_transfer_address(), kDataTransferPortPlaceholder,
+        absl::StrCat(transfer_server_->Port()),
+        /*replace_all=*/false));
+  }
   absl::StatusOr<std::string> compatibility_info =
       transfer_server_->GetCompatibilityInfo();
   if (!compatibility_info.ok()) {
@@ -0,0 +1,1081 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/data/service/shm_data_transfer.h"
+
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+#include "absl/status/status.h"
+#include "tensorflow/core/data/service/data_transfer.h"
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <new>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/ascii.h"
+#include "absl/strings/str_cat.h"
+#include "tensorflow/core/data/service/worker.pb.h"
+#include "tensorflow/core/framework/allocation_description.pb.h"
+#include "tensorflow/core/framework/allocator.h"
+#include "tensorflow/core/framework/metrics.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor.pb.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/framework/types.pb.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/mem.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/random.h"
+#include "tensorflow/core/platform/refcount.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+#include "tsl/platform/host_info.h"
+#endif  // defined(__linux__)
+
+namespace tensorflow {
+namespace data {
+
+#if defined(__linux__)
+namespace {
+
+// Alignment of records in the ring buffer and of tensor data within records.
+constexpr size_t kAlignment = Allocator::kAllocatorAlignment;
+// Bytes at the start of the shared memory reserved for `RingControl`.
+constexpr size_t kControlBytes = kAlignment;
+// Largest `GetElementRequest` the server accepts.
+constexpr uint64_t kMaxRequestBytes = 1 << 20;
+
+// Flags of `ResponseHeader`.
+constexpr uint32_t kEndOfSequence = 1;
+constexpr uint32_t kSkip = 1 << 1;
+// The element follows the header on the socket instead of being in the ring.
+constexpr uint32_t kInline = 1 << 2;
+
+// Encodings of a component.
+// The tensor data of a memcpy-able dtype, which decoded tensors alias.
+constexpr int32_t kRawEncoding = 0;
+// A serialized `TensorProto`.
+constexpr int32_t kProtoEncoding = 1;
+
+// The part of the shared memory written by the client.
+struct RingControl {
+  // Logical offset up to which the client has released the ring buffer.
+  std::atomic<uint64_t> released;
+};
+static_assert(sizeof(RingControl) <= kControlBytes);
+static_assert(std::atomic<uint64_t>::is_always_lock_free);
+
+// Sent by the server in response to each request.
+struct ResponseHeader {
+  // An `absl::StatusCode`. If not OK, the status message follows the header.
+  int32_t code = 0;
+  uint32_t flags = 0;
+  int64_t element_index = 0;
+  // Logical offset of the encoded element in the ring buffer. The physical
+  // offset is `offset` modulo the size of the ring buffer.
+  uint64_t offset = 0;
+  // Bytes of the encoded element or the status message.
+  uint64_t size = 0;
+};
+
+// Precedes each component of an encoded element. The dimension sizes follow
+// as `int64_t`s, and the data starts at the next multiple of `kAlignment`.
+struct ComponentHeader {
+  int32_t dtype = 0;
+  int32_t encoding = 0;
+  int32_t dims = 0;
+  int32_t unused = 0;
+  uint64_t bytes = 0;
+};
+
+size_t AlignUp(size_t size, size_t alignment) {
+  return (size + alignment - 1) / alignment * alignment;
+}
+
+// Identifies the host, so that clients on other hosts fall back to gRPC.
+std::string HostId() {
+  // Distinguishes hosts which share a hostname, e.g. across reboots.
+  std::string boot_id;
+  ReadFileToString(Env::Default(), "/proc/sys/kernel/random/boot_id", &boot_id)
+      .IgnoreError();
+  return absl::StrCat(tsl::port::Hostname(), "/",
+                      absl::StripAsciiWhitespace(boot_id));
+}
+
+absl::Status WriteAll(int fd, const void* data, size_t size) {
+  const char* buffer = static_cast<const char*>(data);
+  while (size > 0) {
+    ssize_t written = send(fd, buffer, size, MSG_NOSIGNAL);
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return errors::IOError("Failed to write to shared-memory data transfer "
+                             "connection",
+                             errno);
+    }
+    buffer += written;
+    size -= written;
+  }
+  return absl::OkStatus();
+}
+
+absl::Status ReadAll(int fd, void* data, size_t size) {
+  char* buffer = static_cast<char*>(data);
+  while (size > 0) {
+    ssize_t read = recv(fd, buffer, size, /*flags=*/0);
+    if (read < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return errors::IOError("Failed to read from shared-memory data transfer "
+                             "connection",
+                             errno);
+    }
+    if (read == 0) {
+      return absl::UnavailableError(
+          "Shared-memory data transfer connection was closed.");
+    }
+    buffer += read;
+    size -= read;
+  }
+  return absl::OkStatus();
+}
+
+// Returns an error unless the peer of the connected socket `fd` runs as the
+// same user as this process.
+absl::Status CheckPeerIsSameUser(int fd) {
+  struct ucred credentials;
+  socklen_t size = sizeof(credentials);
+  if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &credentials, &size) != 0) {
+    return errors::IOError("Failed to get the credentials of the "
+                           "shared-memory data transfer peer",
+                           errno);
+  }
+  if (credentials.uid != geteuid()) {
+    return errors::PermissionDenied(
+        "Shared-memory data transfer peer runs as user ", credentials.uid,
+        ", but this process runs as user ", geteuid(), ".");
+  }
+  return absl::OkStatus();
+}
+
+// Sends `shm_fd` and the size of its ring buffer over `fd`.
+absl::Status SendSharedMemory(int fd, int shm_fd, uint64_t ring_bytes) {
+  struct iovec iov = {&ring_bytes, sizeof(ring_bytes)};
+  alignas(struct cmsghdr) char control[CMSG_SPACE(sizeof(int))] = {};
+  struct msghdr msg = {};
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control;
+  msg.msg_controllen = sizeof(control);
+  struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+  std::memcpy(CMSG_DATA(cmsg), &shm_fd, sizeof(int));
+  ssize_t sent;
+  do {
+    sent = sendmsg(fd, &msg, MSG_NOSIGNAL);
+  } while (sent < 0 && errno == EINTR);
+  if (sent != static_cast<ssize_t>(sizeof(ring_bytes))) {
+    return errors::IOError("Failed to send shared memory", errno);
+  }
+  return absl::OkStatus();
+}
+
+// Receives a file descriptor and the size of its ring buffer sent with
+// `SendSharedMemory`.
+absl::Status ReceiveSharedMemory(int fd, int* shm_fd, uint64_t* ring_bytes) {
+  struct iovec iov = {ring_bytes, sizeof(*ring_bytes)};
+  alignas(struct cmsghdr) char control[CMSG_SPACE(sizeof(int))] = {};
+  struct msghdr msg = {};
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control;
+  msg.msg_controllen = sizeof(control);
+  ssize_t received;
+  do {
+    received = recvmsg(fd, &msg, MSG_CMSG_CLOEXEC);
+  } while (received < 0 && errno == EINTR);
+  if (received < 0) {
+    return errors::IOError("Failed to receive shared memory", errno);
+  }
+  struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+  if (received != static_cast<ssize_t>(sizeof(*ring_bytes)) ||
+      cmsg == nullptr ||
+      cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS) {
+    return absl::UnavailableError(
+        "Shared-memory data transfer server did not send shared memory.");
+  }
+  std::memcpy(shm_fd, CMSG_DATA(cmsg), sizeof(int));
+  return absl::OkStatus();
+}
+
+// A mapping of the shared memory of a connection: a `RingControl` followed by
+// the ring buffer.
+class SharedMemory {
+ public:
+  // Creates shared memory with a ring buffer of `ring_bytes`. Stores a file
+  // descriptor for it in `fd`, which the caller must close.
+  static absl::StatusOr<std::unique_ptr<SharedMemory>> Create(size_t ring_bytes,
+                                                              int* fd) {
+    *fd = memfd_create("tf_data_shm", MFD_CLOEXEC);
+    if (*fd < 0) {
+      return errors::IOError("Failed to create shared memory", errno);
+    }
+    if (ftruncate(*fd, kControlBytes + ring_bytes) != 0) {
+      absl::Status status =
+          errors::IOError("Failed to allocate shared memory", errno);
+      close(*fd);
+      return status;
+    }
+    absl::StatusOr<std::unique_ptr<SharedMemory>> memory =
+        Map(*fd, ring_bytes);
+    if (!memory.ok()) {
+      close(*fd);
+      return memory.status();
+    }
+    new ((*memory)->control()) RingControl{0};
+    return memory;
+  }
+
+  // Maps the shared memory of `fd`, which has a ring buffer of `ring_bytes`.
+  static absl::StatusOr<std::unique_ptr<SharedMemory>> Map(int fd,
+                                                           size_t ring_bytes) {
+    void* base = mmap(/*addr=*/nullptr, kControlBytes + ring_bytes,
+                      PROT_READ | PROT_WRITE, MAP_SHARED, fd, /*offset=*/0);
+    if (base == MAP_FAILED) {
+      return errors::IOError("Failed to map shared memory", errno);
+    }
+    return absl::WrapUnique(
+        new SharedMemory(static_cast<char*>(base), ring_bytes));
+  }
+
+  ~SharedMemory() { munmap(base_, kControlBytes + ring_bytes_); }
+
+  RingControl* control() const {
+    return reinterpret_cast<RingControl*>(base_);
+  }
+  char* ring() const { return base_ + kControlBytes; }
+  size_t ring_bytes() const { return ring_bytes_; }
+
+ private:
+  SharedMemory(char* base, size_t ring_bytes)
+      : base_(base), ring_bytes_(ring_bytes) {}
+
+  char* const base_;
+  const size_t ring_bytes_;
+};
+
+// Lays out the components of an element as described by `ComponentHeader`,
+// preceded by the number of components as a `uint64_t`.
+class EncodedElement {
+ public:
+  static absl::StatusOr<EncodedElement> Create(
+      const std::vector<Tensor>& components) {
+    EncodedElement element;
+    size_t offset = sizeof(uint64_t);
+    for (const Tensor& tensor : components) {
+      Component& component = element.components_.emplace_back();
+      component.tensor = &tensor;
+      component.header.dtype = tensor.dtype();
+      component.header.dims = tensor.dims();
+      if (DataTypeCanUseMemcpy(tensor.dtype())) {
+        component.header.encoding = kRawEncoding;
+        component.header.bytes = tensor.TotalBytes();
+      } else {
+        TensorProto proto;
+        tensor.AsProtoField(&proto);
+        if (!proto.SerializeToString(&component.proto)) {
+          return errors::Internal("Failed to serialize tensor of type ",
+                                  DataTypeString(tensor.dtype()));
+        }
+        component.header.encoding = kProtoEncoding;
+        component.header.bytes = component.proto.size();
+      }
+      component.header_offset = offset;
+      component.data_offset =
+          AlignUp(offset + sizeof(ComponentHeader) +
+                      component.header.dims * sizeof(int64_t),
+                  kAlignment);
+      offset = AlignUp(component.data_offset + component.header.bytes,
+                       alignof(uint64_t));
+    }
+    element.size_ = offset;
+    return element;
+  }
+
+  size_t size() const { return size_; }
+
+  // Writes the `size()` bytes of the element to `dest`.
+  void WriteTo(char* dest) const {
+    const uint64_t num_components = components_.size();
+    std::memcpy(dest, &num_components, sizeof(num_components));
+    for (const Component& component : components_) {
+      char* header = dest + component.header_offset;
+      std::memcpy(header, &component.header, sizeof(component.header));
+      for (int i = 0; i < component.header.dims; ++i) {
+        const int64_t dim_size = component.tensor->dim_size(i);
+        std::memcpy(header + sizeof(ComponentHeader) + i * sizeof(int64_t),
+                    &dim_size, sizeof(dim_size));
+      }
+      if (component.header.encoding == kRawEncoding) {
+        absl::string_view data = component.tensor->tensor_data();
+        std::memcpy(dest + component.data_offset, data.data(), data.size());
+      } else {
+        std::memcpy(dest + component.data_offset, component.proto.data(),
+                    component.proto.size());
+      }
+    }
+  }
+
+ private:
+  struct Component {
+    const Tensor* tensor = nullptr;
+    ComponentHeader header;
+    // The serialized `TensorProto` for `kProtoEncoding`.
+    std::string proto;
+    size_t header_offset = 0;
+    size_t data_offset = 0;
+  };
+
+  std::vector<Component> components_;
+  size_t size_ = 0;
+};
+
+// A buffer that aliases `[data, data + size)` of `root` without owning it.
+class AliasBuffer : public TensorBuffer {
+ public:
+  AliasBuffer(TensorBuffer* root, void* data, size_t size)
+      : TensorBuffer(data), root_(root), size_(size) {
+    root_->Ref();
+  }
+
+  size_t size() const override { return size_; }
+  TensorBuffer* root_buffer() override { return root_; }
+  void FillAllocationDescription(AllocationDescription* proto) const override {
+    root_->FillAllocationDescription(proto);
+  }
+  bool OwnsMemory() const override { return false; }
+
+ private:
+  ~AliasBuffer() override { root_->Unref(); }
+
+  TensorBuffer* const root_;
+  const size_t size_;
+};
+
+// A heap-allocated buffer for elements sent over the socket.
+class HeapBuffer : public TensorBuffer {
+ public:
+  explicit HeapBuffer(size_t size)
+      : TensorBuffer(port::AlignedMalloc(std::max<size_t>(size, 1),
+                                         static_cast<int>(kAlignment))),
+        size_(size) {}
+
+  size_t size() const override { return size_; }
+  TensorBuffer* root_buffer() override { return this; }
+  void FillAllocationDescription(AllocationDescription* proto) const override {
+    proto->set_requested_bytes(size_);
+    proto->set_allocator_name("shm_data_transfer");
+  }
+
+ private:
+  ~HeapBuffer() override { port::AlignedFree(data()); }
+
+  const size_t size_;
+};
+
+// Decodes the `root->size()` bytes of `root` written by
+// `EncodedElement::WriteTo`. Components of memcpy-able dtypes alias `root`,
+// unless `allocator` is set, in which case they are copied into tensors it
+// allocates.
+absl::Status DecodeElement(TensorBuffer* root, Allocator* allocator,
+                           std::vector<Tensor>& components) {
+  const char* data = static_cast<const char*>(root->data());
+  const size_t size = root->size();
+  auto corrupted = [] {
+    return absl::DataLossError(
+        "Received a corrupted element over shared-memory data transfer.");
+  };
+  uint64_t num_components;
+  if (size < sizeof(num_components)) {
+    return corrupted();
+  }
+  std::memcpy(&num_components, data, sizeof(num_components));
+  components.clear();
+  components.reserve(num_components);
+  size_t offset = sizeof(uint64_t);
+  for (uint64_t i = 0; i < num_components; ++i) {
+    ComponentHeader header;
+    if (offset + sizeof(header) > size) {
+      return corrupted();
+    }
+    std::memcpy(&header, data + offset, sizeof(header));
+    if (header.dims < 0 || header.dims > TensorShape::MaxDimensions() ||
+        offset + sizeof(header) + header.dims * sizeof(int64_t) > size) {
+      return corrupted();
+    }
+    TensorShape shape;
+    for (int d = 0; d < header.dims; ++d) {
+      int64_t dim_size;
+      std::memcpy(&dim_size,
+                  data + offset + sizeof(header) + d * sizeof(int64_t),
+                  sizeof(dim_size));
+      TF_RETURN_IF_ERROR(shape.AddDimWithStatus(dim_size));
+    }
+    const size_t data_offset = AlignUp(
+        offset + sizeof(header) + header.dims * sizeof(int64_t), kAlignment);
+    if (data_offset > size || header.bytes > size - data_offset) {
+      return corrupted();
+    }
+    const DataType dtype = static_cast<DataType>(header.dtype);
+    char* component_data = const_cast<char*>(data) + data_offset;
+    if (header.encoding == kRawEncoding) {
+      if (!DataTypeCanUseMemcpy(dtype) ||
+          header.bytes != shape.num_elements() * DataTypeSize(dtype)) {
+        return corrupted();
+      }
+      if (allocator != nullptr) {
+        Tensor& tensor = components.emplace_back(allocator, dtype, shape);
+        std::memcpy(const_cast<char*>(tensor.tensor_data().data()),
+                    component_data, header.bytes);
+      } else {
+        components.emplace_back(
+            dtype, shape,
+            core::RefCountPtr<TensorBuffer>(
+                new AliasBuffer(root, component_data, header.bytes)));
+      }
+    } else if (header.encoding == kProtoEncoding) {
+      TensorProto proto;
+      if (!proto.ParseFromArray(component_data, header.bytes)) {
+        return corrupted();
+      }
+      Tensor& tensor = components.emplace_back();
+      if (!tensor.FromProto(allocator != nullptr ? allocator : cpu_allocator(),
+                            proto)) {
+        return corrupted();
+      }
+    } else {
+      return corrupted();
+    }
+    offset = AlignUp(data_offset + header.bytes, alignof(uint64_t));
+  }
+  return absl::OkStatus();
+}
+
+// The client's view of a connection's ring buffer. Records are released when
+// the tensors aliasing them are destroyed, possibly out of order; the server
+// may reuse the ring buffer up to the first record not yet released.
+class ClientRing : public std::enable_shared_from_this<ClientRing> {
+ public:
+  explicit ClientRing(std::unique_ptr<SharedMemory> memory)
+      : memory_(std::move(memory)) {}
+
+  // Returns a buffer for the `size` bytes of the record at logical `offset`,
+  // which is released when the buffer is destroyed.
+  absl::StatusOr<core::RefCountPtr<TensorBuffer>> Acquire(uint64_t offset,
+                                                          uint64_t size) {
+    const uint64_t physical_offset = offset % memory_->ring_bytes();
+    if (size > memory_->ring_bytes() - physical_offset) {
+      return absl::DataLossError(
+          "Shared-memory data transfer server sent an out of bounds record.");
+    }
+    {
+      mutex_lock l(mu_);
+      records_.push_back({offset, offset + AlignUp(size, kAlignment)});
+    }
+    return core::RefCountPtr<TensorBuffer>(new RecordBuffer(
+        shared_from_this(), memory_->ring() + physical_offset, size, offset));
+  }
+
+ private:
+  struct Record {
+    uint64_t begin;
+    uint64_t end;
+    bool released = false;
+  };
+
+  // A buffer for a record of the ring buffer.
+  class RecordBuffer : public TensorBuffer {
+   public:
+    RecordBuffer(std::shared_ptr<ClientRing> ring, char* data, size_t size,
+                 uint64_t offset)
+        : TensorBuffer(data),
+          ring_(std::move(ring)),
+          size_(size),
+          offset_(offset) {}
+
+    size_t size() const override { return size_; }
+    TensorBuffer* root_buffer() override { return this; }
+    void FillAllocationDescription(
+        AllocationDescription* proto) const override {
+      proto->set_requested_bytes(size_);
+      proto->set_allocator_name("shm_data_transfer");
+    }
+    bool OwnsMemory() const override { return false; }
+
+   private:
+    ~RecordBuffer() override { ring_->Release(offset_); }
+
+    const std::shared_ptr<ClientRing> ring_;
+    const size_t size_;
+    const uint64_t offset_;
+  };
+
+  void Release(uint64_t offset) {
+    mutex_lock l(mu_);
+    for (Record& record : records_) {
+      if (record.begin == offset) {
+        record.released = true;
+        break;
+      }
+    }
+    std::optional<uint64_t> released;
+    while (!records_.empty() && records_.front().released) {
+      released = records_.front().end;
+      records_.pop_front();
+    }
+    if (released.has_value()) {
+      memory_->control()->released.store(*released, std::memory_order_release);
+    }
+  }
+
+  const std::unique_ptr<SharedMemory> memory_;
+  mutex mu_;
+  // Records not yet released up to which the server may not reuse the ring,
+  // in the order they were written.
+  std::deque<Record> records_ TF_GUARDED_BY(mu_);
+};
+
+class ShmDataTransferServer : public DataTransferServer {
+ public:
+  ShmDataTransferServer(GetElementT get_element, size_t ring_buffer_bytes,
+                        size_t max_connections)
+      : get_element_(std::move(get_element)),
+        ring_buffer_bytes_(AlignUp(ring_buffer_bytes, kAlignment)),
+        max_connections_(max_connections),
+        address_(absl::StrCat("tf_data_shm.", getpid(), ".", random::New64())) {
+  }
+
+  ~ShmDataTransferServer() override {
+    {
+      mutex_lock l(mu_);
+      cancelled_ = true;
+      for (const std::unique_ptr<Connection>& connection : connections_) {
+        connection->Cancel();
+      }
+    }
+    if (listen_fd_ >= 0) {
+      // Wakes up `AcceptLoop`.
+      shutdown(listen_fd_, SHUT_RDWR);
+    }
+    accept_thread_.reset();
+    {
+      mutex_lock l(mu_);
+      connections_.clear();
+    }
+    if (listen_fd_ >= 0) {
+      close(listen_fd_);
+    }
+  }
+
+  absl::Status Start(const experimental::WorkerConfig& config) override {
+    listen_fd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, /*protocol=*/0);
+    if (listen_fd_ < 0) {
+      return errors::IOError("Failed to create socket", errno);
+    }
+    struct sockaddr_un addr;
+    socklen_t addr_len;
+    TF_RETURN_IF_ERROR(SocketAddress(address_, addr, addr_len));
+    if (bind(listen_fd_, reinterpret_cast<struct sockaddr*>(&addr),
+             addr_len) != 0) {
+      return errors::IOError(absl::StrCat("Failed to bind to ", address_),
+                             errno);
+    }
+    if (listen(listen_fd_, SOMAXCONN) != 0) {
+      return errors::IOError(absl::StrCat("Failed to listen on ", address_),
+                             errno);
+    }
+    accept_thread_ = absl::WrapUnique(Env::Default()->StartThread(
+        ThreadOptions(), "tf_data_shm_accept", [this] { AcceptLoop(); }));
+    return absl::OkStatus();
+  }
+
+  int Port() const override { return -1; }
+
+  std::optional<std::string> Address() const override { return address_; }
+
+  absl::StatusOr<std::string> GetCompatibilityInfo() const override {
+    return HostId();
+  }
+
+  // Stores the address of the abstract Unix domain socket named `name`.
+  static absl::Status SocketAddress(const std::string& name,
+                                    struct sockaddr_un& addr,
+                                    socklen_t& addr_len) {
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    // The leading '\0' places the socket in the abstract namespace.
+    if (name.empty() || name.size() + 1 > sizeof(addr.sun_path)) {
+      return errors::InvalidArgument(
+          "Invalid shared-memory data transfer address: ", name);
+    }
+    std::memcpy(addr.sun_path + 1, name.data(), name.size());
+    addr_len = offsetof(struct sockaddr_un, sun_path) + 1 + name.size();
+    return absl::OkStatus();
+  }
+
+ private:
+  // Serves the requests of one client.
+  class Connection {
+   public:
+    Connection(int fd, const GetElementT& get_element, size_t ring_bytes)
+        : fd_(fd), get_element_(get_element), ring_bytes_(ring_bytes) {}
+
+    ~Connection() {
+      Cancel();
+      thread_.reset();
+      close(fd_);
+    }
+
+    void Start() {
+      thread_ = absl::WrapUnique(Env::Default()->StartThread(
+          ThreadOptions(), "tf_data_shm_connection", [this] { Serve(); }));
+    }
+
+    // Makes blocked reads and writes fail, causing `Serve` to return.
+    void Cancel() { shutdown(fd_, SHUT_RDWR); }
+
+    bool done() const {
+      mutex_lock l(mu_);
+      return done_;
+    }
+
+   private:
+    void Serve() {
+      absl::Status status = SetUp();
+      while (status.ok()) {
+        status = ServeRequest();
+      }
+      VLOG(2) << "Closed shared-memory data transfer connection: " << status;
+      mutex_lock l(mu_);
+      done_ = true;
+    }
+
+    absl::Status SetUp() {
+      int shm_fd;
+      TF_ASSIGN_OR_RETURN(memory_, SharedMemory::Create(ring_bytes_, &shm_fd));
+      absl::Status status = SendSharedMemory(fd_, shm_fd, ring_bytes_);
+      close(shm_fd);
+      return status;
+    }
+
+    absl::Status ServeRequest() {
+      uint64_t request_size;
+      TF_RETURN_IF_ERROR(ReadAll(fd_, &request_size, sizeof(request_size)));
+      if (request_size > kMaxRequestBytes) {
+        return errors::InvalidArgument("GetElementRequest of ", request_size,
+                                       " bytes is too large.");
+      }
+      std::string serialized_request(request_size, '\0');
+      TF_RETURN_IF_ERROR(
+          ReadAll(fd_, serialized_request.data(), serialized_request.size()));
+      GetElementRequest request;
+      if (!request.ParseFromString(serialized_request)) {
+        return SendError(
+            absl::InvalidArgumentError("Failed to parse GetElementRequest."));
+      }
+      GetElementResult result;
+      absl::Status status = get_element_(&request, &result);
+      if (!status.ok()) {
+        return SendError(status);
+      }
+      absl::StatusOr<EncodedElement> element =
+          EncodedElement::Create(result.components);
+      if (!element.ok()) {
+        return SendError(element.status());
+      }
+      ResponseHeader header;
+      header.element_index = result.element_index;
+      header.flags = (result.end_of_sequence ? kEndOfSequence : 0) |
+                     (result.skip ? kSkip : 0);
+      if (result.components.empty()) {
+        return WriteAll(fd_, &header, sizeof(header));
+      }
+      header.size = element->size();
+      if (std::optional<uint64_t> offset = Reserve(header.size)) {
+        header.offset = *offset;
+        element->WriteTo(memory_->ring() + *offset % ring_bytes_);
+        // Publishes the element before the client learns where it is.
+        std::atomic_thread_fence(std::memory_order_release);
+        return WriteAll(fd_, &header, sizeof(header));
+      }
+      header.flags |= kInline;
+      std::string buffer(header.size, '\0');
+      element->WriteTo(buffer.data());
+      TF_RETURN_IF_ERROR(WriteAll(fd_, &header, sizeof(header)));
+      return WriteAll(fd_, buffer.data(), buffer.size());
+    }
+
+    absl::Status SendError(const absl::Status& status) {
+      ResponseHeader header;
+      header.code = static_cast<int32_t>(status.code());
+      header.size = status.message().size();
+      TF_RETURN_IF_ERROR(WriteAll(fd_, &header, sizeof(header)));
+      return WriteAll(fd_, status.message().data(), status.message().size());
+    }
+
+    // Reserves `size` contiguous bytes of the ring buffer. Returns their
+    // logical offset, or nullopt if the client has not released enough of the
+    // ring buffer.
+    std::optional<uint64_t> Reserve(uint64_t size) {
+      size = AlignUp(size, kAlignment);
+      if (size > ring_bytes_) {
+        return std::nullopt;
+      }
+      uint64_t begin = head_;
+      const uint64_t physical_offset = begin % ring_bytes_;
+      if (physical_offset + size > ring_bytes_) {
+        // Skips to the start of the ring buffer.
+        begin += ring_bytes_ - physical_offset;
+      }
+      const uint64_t released =
+          memory_->control()->released.load(std::memory_order_acquire);
+      if (begin + size - released > ring_bytes_) {
+        return std::nullopt;
+      }
+      head_ = begin + size;
+      return begin;
+    }
+
+    const int fd_;
+    const GetElementT& get_element_;
+    const size_t ring_bytes_;
+    std::unique_ptr<SharedMemory> memory_;
+    // Logical offset up to which the ring buffer has been written.
+    uint64_t head_ = 0;
+    std::unique_ptr<Thread> thread_;
+    mutable mutex mu_;
+    bool done_ TF_GUARDED_BY(mu_) = false;
+  };
+
+  void AcceptLoop() {
+    while (true) {
+      int fd = accept4(listen_fd_, /*addr=*/nullptr, /*addrlen=*/nullptr,
+                       SOCK_CLOEXEC);
+      if (fd < 0 && (errno == EINTR || errno == ECONNABORTED)) {
+        continue;
+      }
+      mutex_lock l(mu_);
+      if (cancelled_) {
+        if (fd >= 0) {
+          close(fd);
+        }
+        return;
+      }
+      if (fd < 0) {
+        LOG(ERROR) << "Failed to accept shared-memory data transfer "
+                   << "connection: " << std::strerror(errno);
+        return;
+      }
+      // Abstract sockets have no file permissions, so the peer is checked
+      // before it gets any shared memory.
+      if (absl::Status status = CheckPeerIsSameUser(fd); !status.ok()) {
+        LOG(WARNING) << "Rejected shared-memory data transfer connection: "
+                     << status;
+        close(fd);
+        continue;
+      }
+      // Drops the connections of clients which went away.
+      connections_.erase(
+          std::remove_if(connections_.begin(), connections_.end(),
+                         [](const std::unique_ptr<Connection>& connection) {
+                           return connection->done();
+                         }),
+          connections_.end());
+      // Each connection maps a ring buffer, so their number is bounded.
+      if (connections_.size() >= max_connections_) {
+        LOG(WARNING) << "Rejected shared-memory data transfer connection: "
+                     << "the server already has " << connections_.size()
+                     << " connections.";
+        close(fd);
+        continue;
+      }
+      connections_.push_back(
+          std::make_unique<Connection>(fd, get_element_, ring_buffer_bytes_));
+      connections_.back()->Start();
+    }
+  }
+
+  const GetElementT get_element_;
+  const size_t ring_buffer_bytes_;
+  const size_t max_connections_;
+  const std::string address_;
+  int listen_fd_ = -1;
+  std::unique_ptr<Thread> accept_thread_;
+
+  mutex mu_;
+  bool cancelled_ TF_GUARDED_BY(mu_) = false;
+  std::vector<std::unique_ptr<Connection>> connections_ TF_GUARDED_BY(mu_);
+};
+
+class ShmDataTransferClient : public DataTransferClient {
+ public:
+  ShmDataTransferClient(std::string address, Allocator* allocator)
+      : address_(std::move(address)), allocator_(allocator) {
+    VLOG(2) << "Create ShmDataTransferClient for worker " << address_ << ".";
+  }
+
+  ~ShmDataTransferClient() override {
+    mutex_lock l(mu_);
+    if (fd_ >= 0) {
+      close(fd_);
+    }
+  }
+
+  absl::Status GetElement(const GetElementRequest& req,
+                          GetElementResult& result) override {
+    VLOG(3) << "GetElement for task " << req.task_id() << " from shared-memory "
+            << "worker server.";
+    mutex_lock l(call_mu_);
+    TF_ASSIGN_OR_RETURN(int fd, Connect());
+    absl::Status server_status;
+    int64_t start_time_us = env_->NowMicros();
+    absl::Status status = Exchange(fd, req, result, server_status);
+    int64_t end_time_us = env_->NowMicros();
+    if (!status.ok()) {
+      Disconnect();
+      mutex_lock cancel_lock(mu_);
+      if (cancelled_) {
+        return errors::Cancelled("Client was cancelled.");
+      }
+      return status;
+    }
+    TF_RETURN_IF_ERROR(server_status);
+    metrics::RecordTFDataServiceGetElementDuration(kShmTransferProtocol,
+                                                   end_time_us - start_time_us);
+    return absl::OkStatus();
+  }
+
+  void TryCancel() override {
+    VLOG(2) << "Cancel ShmDataTransferClient.";
+    mutex_lock l(mu_);
+    cancelled_ = true;
+    if (fd_ >= 0) {
+      shutdown(fd_, SHUT_RDWR);
+    }
+  }
+
+  absl::StatusOr<std::string> GetCompatibilityInfo() const override {
+    return HostId();
+  }
+
+  absl::Status CheckCompatibility(
+      const std::string& server_compatibility_info) const override {
+    const std::string host_id = HostId();
+    if (server_compatibility_info != host_id) {
+      return errors::FailedPrecondition(
+          "Shared-memory data transfer requires the tf.data service worker to "
+          "run on the same host as the client. The worker runs on ",
+          server_compatibility_info, " and the client runs on ", host_id, ".");
+    }
+    return absl::OkStatus();
+  }
+
+ private:
+  // Connects to the server unless already connected. Returns the socket.
+  absl::StatusOr<int> Connect() TF_EXCLUSIVE_LOCKS_REQUIRED(call_mu_) {
+    {
+      mutex_lock l(mu_);
+      if (cancelled_) {
+        return errors::Cancelled("Client was cancelled.");
+      }
+      if (fd_ >= 0) {
+        return fd_;
+      }
+    }
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, /*protocol=*/0);
+    if (fd < 0) {
+      return errors::IOError("Failed to create socket", errno);
+    }
+    absl::Status status = SetUp(fd);
+    mutex_lock l(mu_);
+    if (status.ok() && cancelled_) {
+      status = errors::Cancelled("Client was cancelled.");
+    }
+    if (!status.ok()) {
+      close(fd);
+      return status;
+    }
+    fd_ = fd;
+    return fd;
+  }
+
+  absl::Status SetUp(int fd) TF_EXCLUSIVE_LOCKS_REQUIRED(call_mu_) {
+    struct sockaddr_un addr;
+    socklen_t addr_len;
+    TF_RETURN_IF_ERROR(
+        ShmDataTransferServer::SocketAddress(address_, addr, addr_len));
+    int connected;
+    do {
+      connected =
+          connect(fd, reinterpret_cast<struct sockaddr*>(&addr), addr_len);
+    } while (connected != 0 && errno == EINTR);
+    if (connected != 0) {
+      return errors::IOError(absl::StrCat("Failed to connect to ", address_),
+                             errno);
+    }
+    // Another user could have bound the abstract address first.
+    TF_RETURN_IF_ERROR(CheckPeerIsSameUser(fd));
+    int shm_fd;
+    uint64_t ring_bytes;
+    TF_RETURN_IF_ERROR(ReceiveSharedMemory(fd, &shm_fd, &ring_bytes));
+    absl::StatusOr<std::unique_ptr<SharedMemory>> memory =
+        SharedMemory::Map(shm_fd, ring_bytes);
+    close(shm_fd);
+    TF_RETURN_IF_ERROR(memory.status());
+    ring_ = std::make_shared<ClientRing>(std::move(*memory));
+    return absl::OkStatus();
+  }
+
+  // Closes the connection, e.g. after a failed exchange left the stream in an
+  // unknown state. Tensors aliasing the ring buffer remain valid.
+  void Disconnect() TF_EXCLUSIVE_LOCKS_REQUIRED(call_mu_) {
+    ring_.reset();
+    mutex_lock l(mu_);
+    if (fd_ >= 0) {
+      close(fd_);
+      fd_ = -1;
+    }
+  }
+
+  // Sends `req` over `fd` and receives the element into `result`. Returns an
+  // error if the connection failed, and stores the status returned by the
+  // server in `server_status`.
+  absl::Status Exchange(int fd, const GetElementRequest& req,
+                        GetElementResult& result, absl::Status& server_status)
+      TF_EXCLUSIVE_LOCKS_REQUIRED(call_mu_) {
+    const std::string serialized_request = req.SerializeAsString();
+    const uint64_t request_size = serialized_request.size();
+    TF_RETURN_IF_ERROR(WriteAll(fd, &request_size, sizeof(request_size)));
+    TF_RETURN_IF_ERROR(
+        WriteAll(fd, serialized_request.data(), serialized_request.size()));
+    ResponseHeader header;
+    TF_RETURN_IF_ERROR(ReadAll(fd, &header, sizeof(header)));
+    if (header.code != static_cast<int32_t>(absl::StatusCode::kOk)) {
+      std::string message(header.size, '\0');
+      TF_RETURN_IF_ERROR(ReadAll(fd, message.data(), message.size()));
+      server_status =
+          absl::Status(static_cast<absl::StatusCode>(header.code), message);
+      return absl::OkStatus();
+    }
+    result.element_index = header.element_index;
+    result.end_of_sequence = header.flags & kEndOfSequence;
+    result.skip = header.flags & kSkip;
+    result.components.clear();
+    if (header.size == 0) {
+      return absl::OkStatus();
+    }
+    core::RefCountPtr<TensorBuffer> buffer;
+    if (header.flags & kInline) {
+      buffer.reset(new HeapBuffer(header.size));
+      TF_RETURN_IF_ERROR(ReadAll(fd, buffer->data(), header.size));
+    } else {
+      // Pairs with the release fence of the server.
+      std::atomic_thread_fence(std::memory_order_acquire);
+      TF_ASSIGN_OR_RETURN(buffer, ring_->Acquire(header.offset, header.size));
+    }
+    return DecodeElement(buffer.get(), allocator_, result.components);
+  }
+
+  const std::string address_;
+  Allocator* const allocator_;
+
+  // Serializes calls, which share the connection.
+  mutex call_mu_;
+  std::shared_ptr<ClientRing> ring_ TF_GUARDED_BY(call_mu_);
+
+  mutex mu_;
+  // The connection to the server, or -1 if not connected. Reads and writes do
+  // not require holding `mu_`, so that `TryCancel` can interrupt them.
+  int fd_ TF_GUARDED_BY(mu_) = -1;
+  bool cancelled_ TF_GUARDED_BY(mu_) = false;
+};
+
+class ShmTransferRegistrar {
+ public:
+  ShmTransferRegistrar() {
+    DataTransferServer::Register(
+        kShmTransferProtocol,
+        [](DataTransferServer::GetElementT get_element,
+           std::shared_ptr<DataTransferServer>* out) {
+          return CreateShmDataTransferServer(
+              std::move(get_element), kDefaultShmRingBufferBytes,
+              kDefaultShmMaxConnections, out);
+        });
+    DataTransferClient::Register(
+        kShmTransferProtocol, [](DataTransferClient::Config config,
+                                 std::unique_ptr<DataTransferClient>* out) {
+          *out = std::make_unique<ShmDataTransferClient>(config.address,
+                                                         config.allocator);
+          return absl::OkStatus();
+        });
+  }
+};
+static ShmTransferRegistrar shm_transfer_registrar;
+
+}  // namespace
+
+absl::Status CreateShmDataTransferServer(
+    DataTransferServer::GetElementT get_element, size_t ring_buffer_bytes,
+    size_t max_connections, std::shared_ptr<DataTransferServer>* out) {
+  *out = std::make_shared<ShmDataTransferServer>(
+      std::move(get_element), ring_buffer_bytes, max_connections);
+  return absl::OkStatus();
+}
+
+#else  // defined(__linux__)
+
+absl::Status CreateShmDataTransferServer(
+    DataTransferServer::GetElementT get_element, size_t ring_buffer_bytes,
+    size_t max_connections, std::shared_ptr<DataTransferServer>* out) {
+  return absl::UnimplementedError(
+      "Shared-memory data transfer is only supported on Linux.");
+}
+
+#endif  // defined(__linux__)
+
+}  // namespace data
+}  // namespace tensorflow
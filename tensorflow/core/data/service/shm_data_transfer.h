@@ -0,0 +1,60 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_DATA_SERVICE_SHM_DATA_TRANSFER_H_
+#define TENSORFLOW_CORE_DATA_SERVICE_SHM_DATA_TRANSFER_H_
+
+#include <cstddef>
+#include <memory>
+
+#include "absl/status/status.h"
+#include "tensorflow/core/data/service/data_transfer.h"
+
+namespace tensorflow {
+namespace data {
+
+// Data transfer protocol for clients on the same host as the tf.data service
+// worker, available on Linux.
+//
+// The server listens on an abstract Unix domain socket and gives each client
+// connection a ring buffer in shared memory. Both ends check the credentials
+// of their peer and only talk to processes of the same user, so other users on
+// the host can neither read elements nor impersonate the worker. The worker writes each element
+// into the ring and replies with its location, and the tensors returned to the
+// client alias the ring until they are destroyed. Elements which do not fit
+// in the free space of the ring are sent over the socket instead.
+//
+// Clients on other hosts fail the compatibility check and fall back to gRPC.
+constexpr const char kShmTransferProtocol[] = "shm";
+
+// Size of the ring buffer of each client connection to servers created for
+// `kShmTransferProtocol`.
+constexpr size_t kDefaultShmRingBufferBytes = size_t{128} << 20;
+
+// Maximum number of concurrent client connections, and thus ring buffers, of
+// servers created for `kShmTransferProtocol`.
+constexpr size_t kDefaultShmMaxConnections = 16;
+
+// Creates a shared-memory data transfer server which serves elements from
+// `get_element` and gives each client connection a ring buffer of
+// `ring_buffer_bytes`. Connections beyond `max_connections` concurrent ones
+// are closed, and their clients get an unavailable error.
+absl::Status CreateShmDataTransferServer(
+    DataTransferServer::GetElementT get_element, size_t ring_buffer_bytes,
+    size_t max_connections, std::shared_ptr<DataTransferServer>* out);
+
+}  // namespace data
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_DATA_SERVICE_SHM_DATA_TRANSFER_H_
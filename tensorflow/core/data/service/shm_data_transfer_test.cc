@@ -0,0 +1,372 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/data/service/shm_data_transfer.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "grpcpp/security/server_credentials.h"
+#include "grpcpp/server.h"
+#include "grpcpp/server_builder.h"
+#include "absl/memory/memory.h"
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "tensorflow/core/data/compression_utils.h"
+#include "tensorflow/core/data/service/credentials_factory.h"
+#include "tensorflow/core/data/service/data_transfer.h"
+#include "tensorflow/core/data/service/grpc_worker_impl.h"
+#include "tensorflow/core/data/service/worker.pb.h"
+#include "tensorflow/core/data/service/worker_client.h"
+#include "tensorflow/core/framework/dataset.pb.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/framework/types.pb.h"
+#include "tensorflow/core/framework/variant.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/status_matchers.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+#include "tensorflow/core/protobuf/service_config.pb.h"
+
+namespace tensorflow {
+namespace data {
+namespace {
+
+using ::tensorflow::testing::StatusIs;
+using ::testing::HasSubstr;
+
+std::vector<Tensor> TestComponents() {
+  CompressedElement compressed;
+  TF_CHECK_OK(CompressElement({test::AsTensor<int32_t>({1, 2})}, &compressed));
+  Tensor compressed_tensor(DT_VARIANT, TensorShape{});
+  compressed_tensor.scalar<Variant>()() = compressed;
+  return {test::AsTensor<int64_t>({1, 2, 3}),
+          test::AsTensor<float>(std::vector<float>(4096, 0.5f), {64, 64}),
+          test::AsTensor<tstring>({"a", "b"}, {2}),
+          Tensor(DT_FLOAT, TensorShape({0, 3})), compressed_tensor};
+}
+
+void ExpectComponentsEqual(const std::vector<Tensor>& actual,
+                           const std::vector<Tensor>& expected) {
+  ASSERT_EQ(actual.size(), expected.size());
+  for (size_t i = 0; i < actual.size(); ++i) {
+    if (expected[i].dtype() == DT_VARIANT) {
+      const CompressedElement* actual_compressed =
+          actual[i].scalar<Variant>()().get<CompressedElement>();
+      ASSERT_NE(actual_compressed, nullptr);
+      EXPECT_EQ(actual_compressed->SerializeAsString(),
+                expected[i]
+                    .scalar<Variant>()()
+                    .get<CompressedElement>()
+                    ->SerializeAsString());
+      continue;
+    }
+    test::ExpectEqual(actual[i], expected[i]);
+  }
+}
+
+std::shared_ptr<DataTransferServer> StartServer(
+    DataTransferServer::GetElementT get_element,
+    size_t ring_buffer_bytes = kDefaultShmRingBufferBytes,
+    size_t max_connections = kDefaultShmMaxConnections) {
+  std::shared_ptr<DataTransferServer> server;
+  TF_CHECK_OK(CreateShmDataTransferServer(
+      std::move(get_element), ring_buffer_bytes, max_connections, &server));
+  TF_CHECK_OK(server->Start(experimental::WorkerConfig()));
+  return server;
+}
+
+std::unique_ptr<DataTransferClient> CreateClient(
+    const DataTransferServer& server, Allocator* allocator = nullptr) {
+  std::optional<std::string> address = server.Address();
+  CHECK(address.has_value());
+  std::unique_ptr<DataTransferClient> client;
+  TF_CHECK_OK(DataTransferClient::Build(
+      kShmTransferProtocol,
+      {kShmTransferProtocol, *address,
+       /*accelerator_device_info=*/nullptr, allocator},
+      &client));
+  return client;
+}
+
+// Returns copies of `element` with increasing element indices.
+DataTransferServer::GetElementT ServeCopies(const GetElementResult& element) {
+  auto element_index = std::make_shared<std::atomic<int64_t>>(0);
+  return [&element, element_index](const GetElementRequest* request,
+                                   GetElementResult* result) {
+    *result = element.Copy();
+    result->element_index = (*element_index)++;
+    return absl::OkStatus();
+  };
+}
+
+TEST(ShmDataTransferTest, GetElement) {
+  GetElementResult element;
+  element.components = TestComponents();
+  std::shared_ptr<DataTransferServer> server =
+      StartServer(ServeCopies(element));
+  std::unique_ptr<DataTransferClient> client = CreateClient(*server);
+  for (int64_t i = 0; i < 3; ++i) {
+    GetElementResult result;
+    TF_ASSERT_OK(client->GetElement(GetElementRequest(), result));
+    ExpectComponentsEqual(result.components, element.components);
+    EXPECT_EQ(result.element_index, i);
+    EXPECT_FALSE(result.end_of_sequence);
+    EXPECT_FALSE(result.skip);
+  }
+}
+
+TEST(ShmDataTransferTest, GetElementWithAllocator) {
+  GetElementResult element;
+  element.components = TestComponents();
+  std::shared_ptr<DataTransferServer> server =
+      StartServer(ServeCopies(element));
+  std::unique_ptr<DataTransferClient> client =
+      CreateClient(*server, cpu_allocator());
+  GetElementResult result;
+  TF_ASSERT_OK(client->GetElement(GetElementRequest(), result));
+  ExpectComponentsEqual(result.components, element.components);
+}
+
+TEST(ShmDataTransferTest, EndOfSequenceAndSkip) {
+  std::shared_ptr<DataTransferServer> server = StartServer(
+      [](const GetElementRequest* request, GetElementResult* result) {
+        result->end_of_sequence = request->task_id() == 0;
+        result->skip = request->task_id() == 1;
+        return absl::OkStatus();
+      });
+  std::unique_ptr<DataTransferClient> client = CreateClient(*server);
+  GetElementRequest request;
+  GetElementResult result;
+  TF_ASSERT_OK(client->GetElement(request, result));
+  EXPECT_TRUE(result.end_of_sequence);
+  EXPECT_TRUE(result.components.empty());
+
+  request.set_task_id(1);
+  TF_ASSERT_OK(client->GetElement(request, result));
+  EXPECT_TRUE(result.skip);
+  EXPECT_FALSE(result.end_of_sequence);
+}
+
+TEST(ShmDataTransferTest, ServerError) {
+  std::shared_ptr<DataTransferServer> server = StartServer(
+      [](const GetElementRequest* request, GetElementResult* result) {
+        return absl::NotFoundError(
+            absl::StrCat("No task ", request->task_id()));
+      });
+  std::unique_ptr<DataTransferClient> client = CreateClient(*server);
+  GetElementRequest request;
+  request.set_task_id(7);
+  GetElementResult result;
+  EXPECT_THAT(client->GetElement(request, result),
+              StatusIs(error::NOT_FOUND, HasSubstr("No task 7")));
+  // The connection remains usable.
+  EXPECT_THAT(client->GetElement(request, result),
+              StatusIs(error::NOT_FOUND, HasSubstr("No task 7")));
+}
+
+TEST(ShmDataTransferTest, ElementsHeldByClientFillRingBuffer) {
+  GetElementResult element;
+  element.components.push_back(
+      test::AsTensor<float>(std::vector<float>(4096, 0.5f), {4096}));
+  std::shared_ptr<DataTransferServer> server =
+      StartServer(ServeCopies(element), /*ring_buffer_bytes=*/64 << 10);
+  std::unique_ptr<DataTransferClient> client = CreateClient(*server);
+  // Holding more elements than fit in the ring buffer sends the rest over the
+  // socket.
+  std::vector<GetElementResult> results(10);
+  for (GetElementResult& result : results) {
+    TF_ASSERT_OK(client->GetElement(GetElementRequest(), result));
+    ExpectComponentsEqual(result.components, element.components);
+  }
+  results.clear();
+  for (int i = 0; i < 10; ++i) {
+    GetElementResult result;
+    TF_ASSERT_OK(client->GetElement(GetElementRequest(), result));
+    ExpectComponentsEqual(result.components, element.components);
+  }
+}
+
+TEST(ShmDataTransferTest, ElementLargerThanRingBuffer) {
+  GetElementResult element;
+  element.components.push_back(
+      test::AsTensor<float>(std::vector<float>(1 << 16, 0.5f), {1 << 16}));
+  std::shared_ptr<DataTransferServer> server =
+      StartServer(ServeCopies(element), /*ring_buffer_bytes=*/64 << 10);
+  std::unique_ptr<DataTransferClient> client = CreateClient(*server);
+  GetElementResult result;
+  TF_ASSERT_OK(client->GetElement(GetElementRequest(), result));
+  ExpectComponentsEqual(result.components, element.components);
+}
+
+TEST(ShmDataTransferTest, MultipleClients) {
+  GetElementResult element;
+  element.components = TestComponents();
+  std::shared_ptr<DataTransferServer> server =
+      StartServer(ServeCopies(element));
+  std::vector<std::unique_ptr<Thread>> threads;
+  for (int i = 0; i < 4; ++i) {
+    threads.push_back(absl::WrapUnique(Env::Default()->StartThread(
+        ThreadOptions(), absl::StrCat("client_", i), [&server, &element] {
+          std::unique_ptr<DataTransferClient> client = CreateClient(*server);
+          for (int j = 0; j < 10; ++j) {
+            GetElementResult result;
+            TF_ASSERT_OK(client->GetElement(GetElementRequest(), result));
+            ExpectComponentsEqual(result.components, element.components);
+          }
+        })));
+  }
+}
+
+TEST(ShmDataTransferTest, LimitsConcurrentConnections) {
+  GetElementResult element;
+  element.components = TestComponents();
+  std::shared_ptr<DataTransferServer> server =
+      StartServer(ServeCopies(element), /*ring_buffer_bytes=*/64 << 10,
+                  /*max_connections=*/2);
+  std::vector<std::unique_ptr<DataTransferClient>> clients;
+  for (int i = 0; i < 2; ++i) {
+    clients.push_back(CreateClient(*server));
+    GetElementResult result;
+    TF_ASSERT_OK(clients.back()->GetElement(GetElementRequest(), result));
+  }
+  std::unique_ptr<DataTransferClient> rejected = CreateClient(*server);
+  GetElementResult result;
+  EXPECT_THAT(rejected->GetElement(GetElementRequest(), result),
+              StatusIs(error::UNAVAILABLE));
+
+  // Closing a connection makes room for a new one once the server notices.
+  clients.pop_back();
+  absl::Status status;
+  for (int attempt = 0; attempt < 100; ++attempt) {
+    std::unique_ptr<DataTransferClient> client = CreateClient(*server);
+    status = client->GetElement(GetElementRequest(), result);
+    if (status.ok()) {
+      break;
+    }
+    Env::Default()->SleepForMicroseconds(10 * 1000);
+  }
+  TF_EXPECT_OK(status);
+}
+
+TEST(ShmDataTransferTest, TryCancel) {
+  GetElementResult element;
+  element.components = TestComponents();
+  std::shared_ptr<DataTransferServer> server =
+      StartServer(ServeCopies(element));
+  std::unique_ptr<DataTransferClient> client = CreateClient(*server);
+  client->TryCancel();
+  GetElementResult result;
+  EXPECT_THAT(client->GetElement(GetElementRequest(), result),
+              StatusIs(error::CANCELLED));
+}
+
+TEST(ShmDataTransferTest, ServerUnavailable) {
+  std::unique_ptr<DataTransferClient> client;
+  TF_ASSERT_OK(DataTransferClient::Build(
+      kShmTransferProtocol,
+      {kShmTransferProtocol, "tf_data_shm.nonexistent",
+       /*accelerator_device_info=*/nullptr, /*allocator=*/nullptr},
+      &client));
+  GetElementResult result;
+  EXPECT_THAT(client->GetElement(GetElementRequest(), result),
+              StatusIs(error::UNAVAILABLE));
+}
+
+TEST(ShmDataTransferTest, CompatibleOnlyOnSameHost) {
+  std::shared_ptr<DataTransferServer> server = StartServer(
+      [](const GetElementRequest* request, GetElementResult* result) {
+        return absl::OkStatus();
+      });
+  std::unique_ptr<DataTransferClient> client = CreateClient(*server);
+  TF_ASSERT_OK_AND_ASSIGN(std::string compatibility_info,
+                          server->GetCompatibilityInfo());
+  TF_EXPECT_OK(client->CheckCompatibility(compatibility_info));
+  EXPECT_THAT(client->CheckCompatibility("other_host/boot_id"),
+              StatusIs(error::FAILED_PRECONDITION));
+}
+
+// Fetches elements of `state.range(0)` bytes over the data transfer protocol
+// `state.range(1)` (0 for "grpc", 1 for "shm"). The CPU time includes the
+// server, which runs in the same process.
+void BM_GetElement(::testing::benchmark::State& state) {
+  const int64_t element_bytes = state.range(0);
+  const bool shm = state.range(1);
+  GetElementResult element;
+  element.components.push_back(Tensor(DT_UINT8, TensorShape({element_bytes})));
+  element.components[0].flat<uint8>().setConstant(1);
+  DataTransferServer::GetElementT get_element =
+      [&element](const GetElementRequest*, GetElementResult* result) {
+        *result = element.Copy();
+        return absl::OkStatus();
+      };
+
+  std::shared_ptr<DataTransferServer> shm_server;
+  std::unique_ptr<GrpcElementTransferService> grpc_service;
+  std::unique_ptr<::grpc::Server> grpc_server;
+  std::unique_ptr<DataTransferClient> client;
+  if (shm) {
+    shm_server = StartServer(get_element);
+    client = CreateClient(*shm_server);
+  } else {
+    grpc_service = std::make_unique<GrpcElementTransferService>(get_element);
+    std::shared_ptr<::grpc::ServerCredentials> credentials;
+    TF_CHECK_OK(CredentialsFactory::CreateServerCredentials(
+        kGrpcTransferProtocol, &credentials));
+    int port = 0;
+    ::grpc::ServerBuilder builder;
+    builder.AddListeningPort("localhost:0", credentials, &port);
+    builder.RegisterService(grpc_service.get());
+    grpc_server = builder.BuildAndStart();
+    TF_CHECK_OK(DataTransferClient::Build(
+        kGrpcTransferProtocol,
+        {kGrpcTransferProtocol, absl::StrCat("localhost:", port),
+         /*accelerator_device_info=*/nullptr, /*allocator=*/nullptr},
+        &client));
+  }
+
+  for (auto s : state) {
+    GetElementResult result;
+    TF_CHECK_OK(client->GetElement(GetElementRequest(), result));
+  }
+  state.SetBytesProcessed(state.iterations() * element_bytes);
+  state.SetLabel(shm ? kShmTransferProtocol : kGrpcTransferProtocol);
+  client.reset();
+  if (grpc_server) {
+    grpc_server->Shutdown();
+  }
+}
+
+BENCHMARK(BM_GetElement)
+    ->ArgPair(1 << 10, 0)
+    ->ArgPair(1 << 10, 1)
+    ->ArgPair(1 << 20, 0)
+    ->ArgPair(1 << 20, 1)
+    ->ArgPair(64 << 20, 0)
+    ->ArgPair(64 << 20, 1)
+    ->MeasureProcessCPUTime()
+    ->UseRealTime();
+
+}  // namespace
+}  // namespace data
+}  // namespace tensorflow
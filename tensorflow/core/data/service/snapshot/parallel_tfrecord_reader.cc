@@ -0,0 +1,306 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/data/service/snapshot/parallel_tfrecord_reader.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "absl/synchronization/mutex.h"
+#include "tensorflow/core/data/snapshot_utils.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/types.h"
+#include "tsl/platform/env.h"
+#include "tsl/platform/errors.h"
+#include "tsl/platform/threadpool.h"
+#include "tsl/profiler/lib/traceme.h"
+
+namespace tensorflow {
+namespace data {
+namespace {
+
+// Bounds of the block size of `ReadAheadOptions`. Blocks are multiples of
+// `kReadAlignment`.
+constexpr ByteSize kMinReadAheadBlockSize = ByteSize::KB(64);
+constexpr ByteSize kMaxReadAheadBlockSize = ByteSize::MB(4);
+constexpr ByteSize kReadAlignment = ByteSize::KB(4);
+constexpr int kReadAheadAsyncReadQueueDepth = 2;
+// `ReadAheadOptions` bounds the buffer by bytes. This only bounds the number
+// of tiny records.
+constexpr int64_t kMaxReadAheadBufferedRecords = 1024;
+
+int64_t RecordBytes(const std::vector<Tensor>& record) {
+  int64_t bytes = 0;
+  for (const Tensor& tensor : record) {
+    bytes += tensor.TotalBytes();
+  }
+  return bytes;
+}
+
+ParallelTFRecordReader::Options ValidatedOptions(
+    ParallelTFRecordReader::Options options) {
+  options.num_parallel_files = std::max<int64_t>(options.num_parallel_files, 1);
+  options.buffer_size = std::max<int64_t>(options.buffer_size, 1);
+  return options;
+}
+
+}  // namespace
+
+ParallelTFRecordReader::Options ParallelTFRecordReader::ReadAheadOptions(
+    ByteSize read_ahead) {
+  // Half of the read-ahead is for the block being parsed and the blocks in
+  // flight, and half for the parsed records.
+  ByteSize block_size = std::clamp(
+      read_ahead / 2 / (kReadAheadAsyncReadQueueDepth + 1),
+      kMinReadAheadBlockSize, kMaxReadAheadBlockSize);
+  block_size = ByteSize::Bytes(block_size.ToUnsignedBytes() /
+                               kReadAlignment.ToUnsignedBytes() *
+                               kReadAlignment.ToUnsignedBytes());
+  Options options;
+  options.num_parallel_files = 1;
+  options.buffer_size = kMaxReadAheadBufferedRecords;
+  options.buffer_bytes = read_ahead / 2;
+  options.read_block_size = block_size;
+  options.async_read_queue_depth = kReadAheadAsyncReadQueueDepth;
+  return options;
+}
+
+ParallelTFRecordReader::ParallelTFRecordReader(
+    const std::vector<std::string>& filenames, const std::string& compression,
+    const DataTypeVector& dtypes, tsl::Env* env, const Options& options)
+    : filenames_(filenames),
+      compression_(compression),
+      dtypes_(dtypes),
+      env_(env),
+      options_(ValidatedOptions(options)) {
+  const int64_t num_threads =
+      std::min<int64_t>(options_.num_parallel_files, filenames_.size());
+  if (num_threads == 0) {
+    return;
+  }
+  thread_pool_ = std::make_unique<tsl::thread::ThreadPool>(
+      env_, tsl::ThreadOptions{}, "read_tfrecord_thread", num_threads);
+  for (int64_t i = 0; i < num_threads; ++i) {
+    thread_pool_->Schedule([this]() { ReadFiles(); });
+  }
+}
+
+ParallelTFRecordReader::ParallelTFRecordReader(
+    const std::vector<std::string>& filenames, const std::string& compression,
+    const DataTypeVector& dtypes, tsl::Env* env)
+    : ParallelTFRecordReader(filenames, compression, dtypes, env, Options()) {}
+
+ParallelTFRecordReader::~ParallelTFRecordReader() {
+  Cancel();
+  thread_pool_.reset();
+}
+
+absl::Status ParallelTFRecordReader::GetNext(std::vector<Tensor>& record,
+                                             bool& end_of_sequence)
+    ABSL_LOCKS_EXCLUDED(mu_) {
+  absl::MutexLock l(&mu_);
+  while (true) {
+    TF_RETURN_IF_ERROR(status_);
+    if (!options_.deterministic) {
+      if (!buffer_.empty()) {
+        record = std::move(buffer_.front());
+        buffer_.pop_front();
+        buffer_bytes_ -= RecordBytes(record);
+        ready_to_push_.SignalAll();
+        end_of_sequence = false;
+        return absl::OkStatus();
+      }
+      if (num_files_done_ == static_cast<int64_t>(filenames_.size())) {
+        end_of_sequence = true;
+        return absl::OkStatus();
+      }
+      ready_to_pop_.Wait(&mu_);
+      continue;
+    }
+
+    if (next_file_to_return_ == static_cast<int64_t>(filenames_.size())) {
+      end_of_sequence = true;
+      return absl::OkStatus();
+    }
+    if (!file_buffers_.empty() && !file_buffers_.front().records.empty()) {
+      record = std::move(file_buffers_.front().records.front());
+      file_buffers_.front().records.pop_front();
+      file_buffers_.front().bytes -= RecordBytes(record);
+      ready_to_push_.SignalAll();
+      end_of_sequence = false;
+      return absl::OkStatus();
+    }
+    if (!file_buffers_.empty() && file_buffers_.front().done) {
+      // Moves on to the next file, which lets the threads read one more file
+      // ahead.
+      file_buffers_.pop_front();
+      ++next_file_to_return_;
+      ready_to_push_.SignalAll();
+      continue;
+    }
+    ready_to_pop_.Wait(&mu_);
+  }
+}
+
+void ParallelTFRecordReader::Cancel() ABSL_LOCKS_EXCLUDED(mu_) {
+  absl::MutexLock l(&mu_);
+  if (status_.ok()) {
+    status_ = absl::CancelledError("The TFRecord reader has been cancelled.");
+  }
+  ready_to_push_.SignalAll();
+  ready_to_pop_.SignalAll();
+}
+
+uint64_t ParallelTFRecordReader::BytesRead() const ABSL_LOCKS_EXCLUDED(mu_) {
+  absl::MutexLock l(&mu_);
+  return bytes_read_;
+}
+
+void ParallelTFRecordReader::ReadFiles() {
+  int64_t file_index = 0;
+  while (GetNextFileToRead(file_index)) {
+    absl::Status status = ReadFile(file_index);
+    if (!status.ok()) {
+      UpdateStatus(std::move(status));
+      return;
+    }
+    FinishFile(file_index);
+  }
+}
+
+bool ParallelTFRecordReader::GetNextFileToRead(int64_t& file_index)
+    ABSL_LOCKS_EXCLUDED(mu_) {
+  const int64_t num_files = filenames_.size();
+  absl::MutexLock l(&mu_);
+  while (status_.ok() && next_file_to_read_ < num_files &&
+         options_.deterministic &&
+         next_file_to_read_ >=
+             next_file_to_return_ + options_.num_parallel_files) {
+    ready_to_push_.Wait(&mu_);
+  }
+  if (!status_.ok() || next_file_to_read_ >= num_files) {
+    return false;
+  }
+  file_index = next_file_to_read_++;
+  if (options_.deterministic) {
+    file_buffers_.emplace_back();
+  }
+  return true;
+}
+
+absl::Status ParallelTFRecordReader::ReadFile(int64_t file_index) {
+  const std::string& filename = filenames_[file_index];
+  tsl::profiler::TraceMe activity(
+      [&]() {
+        return absl::StrCat("ParallelTFRecordReader::ReadFile#", filename, "#");
+      },
+      tsl::profiler::TraceMeLevel::kInfo);
+  snapshot_util::TFRecordReader reader(
+      filename, compression_, dtypes_, options_.decompression_buffer_size,
+      /*input_buffer_size=*/options_.read_block_size.ToUnsignedBytes(),
+      options_.async_read_queue_depth);
+  TF_RETURN_IF_ERROR(reader.Initialize(env_));
+  uint64_t bytes_read = 0;
+  while (true) {
+    std::vector<Tensor> record;
+    absl::Status status = reader.ReadTensors(&record);
+    if (absl::IsOutOfRange(status)) {
+      break;
+    }
+    TF_RETURN_WITH_CONTEXT_IF_ERROR(
+        status, " Failed to read tf.data snapshot file: ", filename);
+    {
+      absl::MutexLock l(&mu_);
+      bytes_read_ += reader.BytesRead() - bytes_read;
+    }
+    bytes_read = reader.BytesRead();
+    TF_RETURN_IF_ERROR(BufferRecord(file_index, std::move(record)));
+  }
+  return absl::OkStatus();
+}
+
+absl::Status ParallelTFRecordReader::BufferRecord(int64_t file_index,
+                                                  std::vector<Tensor> record)
+    ABSL_LOCKS_EXCLUDED(mu_) {
+  absl::MutexLock l(&mu_);
+  while (status_.ok() && !HasBufferSpace(file_index)) {
+    ready_to_push_.Wait(&mu_);
+  }
+  TF_RETURN_IF_ERROR(status_);
+  const int64_t bytes = RecordBytes(record);
+  if (options_.deterministic) {
+    FileBuffer& buffer = file_buffers_[file_index - next_file_to_return_];
+    buffer.records.push_back(std::move(record));
+    buffer.bytes += bytes;
+  } else {
+    buffer_.push_back(std::move(record));
+    buffer_bytes_ += bytes;
+  }
+  ready_to_pop_.Signal();
+  return absl::OkStatus();
+}
+
+bool ParallelTFRecordReader::HasBufferSpace(int64_t file_index) const {
+  // The non-deterministic buffer is shared by all files being read.
+  int64_t num_records = buffer_.size();
+  int64_t bytes = buffer_bytes_;
+  int64_t num_files = options_.num_parallel_files;
+  if (options_.deterministic) {
+    const FileBuffer& file_buffer =
+        file_buffers_[file_index - next_file_to_return_];
+    num_records = file_buffer.records.size();
+    bytes = file_buffer.bytes;
+    num_files = 1;
+  }
+  if (num_records >= options_.buffer_size * num_files) {
+    return false;
+  }
+  // One record is always buffered, however large.
+  if (!options_.buffer_bytes.has_value() || num_records == 0) {
+    return true;
+  }
+  const int64_t max_bytes = options_.buffer_bytes->ToUnsignedBytes();
+  return bytes < max_bytes * num_files;
+}
+
+void ParallelTFRecordReader::FinishFile(int64_t file_index)
+    ABSL_LOCKS_EXCLUDED(mu_) {
+  absl::MutexLock l(&mu_);
+  ++num_files_done_;
+  if (options_.deterministic) {
+    file_buffers_[file_index - next_file_to_return_].done = true;
+  }
+  ready_to_pop_.SignalAll();
+}
+
+void ParallelTFRecordReader::UpdateStatus(absl::Status status)
+    ABSL_LOCKS_EXCLUDED(mu_) {
+  absl::MutexLock l(&mu_);
+  if (status_.ok()) {
+    status_ = std::move(status);
+  }
+  ready_to_push_.SignalAll();
+  ready_to_pop_.SignalAll();
+}
+
+}  // namespace data
+}  // namespace tensorflow
@@ -0,0 +1,174 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_DATA_SERVICE_SNAPSHOT_PARALLEL_TFRECORD_READER_H_
+#define TENSORFLOW_CORE_DATA_SERVICE_SNAPSHOT_PARALLEL_TFRECORD_READER_H_
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/status/status.h"
+#include "absl/synchronization/mutex.h"
+#include "tensorflow/core/data/service/byte_size.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/types.h"
+#include "tsl/platform/env.h"
+#include "tsl/platform/threadpool.h"
+
+namespace tensorflow {
+namespace data {
+
+// Uses multiple threads to read TFRecord snapshot files in parallel. Each
+// thread reads, decompresses, and parses one file at a time, and buffers its
+// records until `GetNext` returns them. This class is thread-safe.
+//
+// If `deterministic` is true, records are returned file by file, in the order
+// of `filenames`, and the threads read ahead up to `num_parallel_files` files.
+// Otherwise, records are returned as soon as any thread has read them.
+//
+// Usage example:
+//
+// ParallelTFRecordReader reader(
+//     chunk_files, tsl::io::compression::kSnappy, DataTypeVector{DT_INT64},
+//     Env::Default());
+//
+// std::vector<Tensor> record;
+// bool end_of_sequence = false;
+// TF_RETURN_IF_ERROR(reader.GetNext(record, end_of_sequence));
+// while (!end_of_sequence) {
+//   ...
+//   TF_RETURN_IF_ERROR(reader.GetNext(record, end_of_sequence));
+// }
+class ParallelTFRecordReader {
+ public:
+  struct Options {
+    // Number of files read at the same time, one per thread.
+    int64_t num_parallel_files = 4;
+    bool deterministic = true;
+    // Number of records buffered for each file being read.
+    int64_t buffer_size = 16;
+    // If set, the records buffered for each file being read also take at most
+    // this many bytes, except that one record is always buffered.
+    std::optional<ByteSize> buffer_bytes;
+    // Files are read sequentially in blocks of this size, with up to
+    // `async_read_queue_depth` block reads in flight. Block sizes should be a
+    // multiple of the file system block size.
+    ByteSize read_block_size = ByteSize::MB(4);
+    int async_read_queue_depth = 2;
+    // Output buffer size of the Snappy/Zlib decompression. If not set, uses
+    // the default of the compression library.
+    std::optional<int64_t> decompression_buffer_size;
+  };
+
+  // Returns options for reading one file at a time, whose blocks in flight
+  // and buffered records take about `read_ahead` bytes. Blocks are multiples
+  // of 4KB, so all block reads start at aligned file offsets.
+  static Options ReadAheadOptions(ByteSize read_ahead);
+
+  ParallelTFRecordReader(const std::vector<std::string>& filenames,
+                         const std::string& compression,
+                         const DataTypeVector& dtypes, tsl::Env* env,
+                         const Options& options);
+  ParallelTFRecordReader(const std::vector<std::string>& filenames,
+                         const std::string& compression,
+                         const DataTypeVector& dtypes, tsl::Env* env);
+  virtual ~ParallelTFRecordReader();
+  ParallelTFRecordReader(const ParallelTFRecordReader&) = delete;
+  ParallelTFRecordReader& operator=(const ParallelTFRecordReader&) = delete;
+
+  // Reads the next record. Blocks until a record has been read, all files
+  // have been read, or an error occurs.
+  absl::Status GetNext(std::vector<Tensor>& record, bool& end_of_sequence);
+
+  // Cancels the reader. After cancelling, `GetNext` returns a Cancelled error.
+  void Cancel();
+
+  // Returns the number of bytes read from the files so far.
+  uint64_t BytesRead() const;
+
+ private:
+  struct FileBuffer {
+    std::deque<std::vector<Tensor>> records;
+    // Sum of the sizes of `records`.
+    int64_t bytes = 0;
+    bool done = false;
+  };
+
+  // Run by a thread to read files until there are no more files to read.
+  void ReadFiles();
+
+  // Claims the next file to read, waiting until it is within the read-ahead
+  // window if reads are deterministic. Returns false if there are no more
+  // files to read or the reader is cancelled.
+  bool GetNextFileToRead(int64_t& file_index);
+
+  // Reads the file at `file_index` into the buffer.
+  absl::Status ReadFile(int64_t file_index);
+
+  // Buffers `record` read from the file at `file_index`. Blocks while the
+  // buffer is full.
+  absl::Status BufferRecord(int64_t file_index, std::vector<Tensor> record);
+
+  // Whether the buffer for the file at `file_index` has room for a record.
+  bool HasBufferSpace(int64_t file_index) const
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Marks the file at `file_index` as completely read.
+  void FinishFile(int64_t file_index);
+
+  // Updates the status of the reader and notifies waiters.
+  void UpdateStatus(absl::Status status);
+
+  const std::vector<std::string> filenames_;
+  const std::string compression_;
+  const DataTypeVector dtypes_;
+  tsl::Env* const env_;
+  const Options options_;
+
+  mutable absl::Mutex mu_;
+  absl::CondVar ready_to_push_;
+  absl::CondVar ready_to_pop_;
+
+  absl::Status status_ ABSL_GUARDED_BY(mu_);
+
+  // Index of the next file to be claimed by a reader thread.
+  int64_t next_file_to_read_ ABSL_GUARDED_BY(mu_) = 0;
+  // Index of the file `GetNext` returns records from if `deterministic`.
+  int64_t next_file_to_return_ ABSL_GUARDED_BY(mu_) = 0;
+  // Number of files which have been completely read.
+  int64_t num_files_done_ ABSL_GUARDED_BY(mu_) = 0;
+
+  // If `deterministic`, the buffers of the files being read, indexed by the
+  // file index minus `next_file_to_return_`.
+  std::deque<FileBuffer> file_buffers_ ABSL_GUARDED_BY(mu_);
+  // If not `deterministic`, records from all files in the order they were
+  // read.
+  std::deque<std::vector<Tensor>> buffer_ ABSL_GUARDED_BY(mu_);
+  // Sum of the sizes of `buffer_`.
+  int64_t buffer_bytes_ ABSL_GUARDED_BY(mu_) = 0;
+
+  uint64_t bytes_read_ ABSL_GUARDED_BY(mu_) = 0;
+
+  std::unique_ptr<tsl::thread::ThreadPool> thread_pool_;
+};
+
+}  // namespace data
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_DATA_SERVICE_SNAPSHOT_PARALLEL_TFRECORD_READER_H_
@@ -0,0 +1,394 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/data/service/snapshot/parallel_tfrecord_reader.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <numeric>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "xla/tsl/lib/core/status_test_util.h"
+#include "xla/tsl/lib/io/compression.h"
+#include "tensorflow/core/data/service/byte_size.h"
+#include "tensorflow/core/data/snapshot_utils.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/framework/types.pb.h"
+#include "tsl/platform/env.h"
+#include "tsl/platform/errors.h"
+#include "tsl/platform/path.h"
+#include "tsl/platform/status_matchers.h"
+#include "tsl/platform/statusor.h"
+#include "tsl/platform/test.h"
+#include "tsl/platform/test_benchmark.h"
+
+namespace tensorflow {
+namespace data {
+namespace {
+
+using ::testing::ElementsAreArray;
+using ::testing::HasSubstr;
+using ::testing::IsEmpty;
+using ::testing::UnorderedElementsAreArray;
+using ::tsl::testing::StatusIs;
+
+absl::StatusOr<std::string> TestDir() {
+  std::string test_dir;
+  if (!tsl::Env::Default()->LocalTempFilename(&test_dir)) {
+    return absl::FailedPreconditionError("Failed to create local temp file.");
+  }
+  TF_RETURN_IF_ERROR(tsl::Env::Default()->RecursivelyCreateDir(test_dir));
+  return test_dir;
+}
+
+// Writes `num_files` files of `records_per_file` records each, numbering the
+// records from 0. Returns the file names.
+absl::StatusOr<std::vector<std::string>> WriteFiles(
+    const std::string& compression, int64_t num_files,
+    int64_t records_per_file) {
+  TF_ASSIGN_OR_RETURN(std::string test_dir, TestDir());
+  std::vector<std::string> filenames;
+  int64_t next_record = 0;
+  for (int64_t i = 0; i < num_files; ++i) {
+    filenames.push_back(tsl::io::JoinPath(test_dir, absl::StrCat("chunk_", i)));
+    snapshot_util::TFRecordWriter writer(filenames.back(), compression);
+    TF_RETURN_IF_ERROR(writer.Initialize(tsl::Env::Default()));
+    for (int64_t j = 0; j < records_per_file; ++j) {
+      TF_RETURN_IF_ERROR(writer.WriteTensors(
+          {Tensor(next_record), Tensor(absl::StrCat("record ", next_record))}));
+      ++next_record;
+    }
+    TF_RETURN_IF_ERROR(writer.Close());
+  }
+  return filenames;
+}
+
+absl::StatusOr<std::vector<int64_t>> ReadRecords(
+    ParallelTFRecordReader& reader) {
+  std::vector<int64_t> result;
+  while (true) {
+    std::vector<Tensor> record;
+    bool end_of_sequence = false;
+    TF_RETURN_IF_ERROR(reader.GetNext(record, end_of_sequence));
+    if (end_of_sequence) {
+      return result;
+    }
+    if (record.size() != 2) {
+      return absl::InternalError("Expected records with two components.");
+    }
+    const int64_t index = record[0].scalar<int64_t>()();
+    if (record[1].scalar<tstring>()() != absl::StrCat("record ", index)) {
+      return absl::InternalError(absl::StrCat("Unexpected record ", index));
+    }
+    result.push_back(index);
+  }
+}
+
+std::vector<int64_t> Range(int64_t range) {
+  std::vector<int64_t> result(range);
+  std::iota(result.begin(), result.end(), 0);
+  return result;
+}
+
+const DataTypeVector& RecordTypes() {
+  static const DataTypeVector* types =
+      new DataTypeVector{DT_INT64, DT_STRING};
+  return *types;
+}
+
+class ParallelTFRecordReaderParamTest
+    : public ::testing::TestWithParam<
+          std::tuple<int64_t, int64_t, int64_t, int64_t, std::string>> {
+ protected:
+  int64_t NumFiles() const { return std::get<0>(GetParam()); }
+  int64_t RecordsPerFile() const { return std::get<1>(GetParam()); }
+  int64_t NumParallelFiles() const { return std::get<2>(GetParam()); }
+  int64_t BufferSize() const { return std::get<3>(GetParam()); }
+  std::string Compression() const { return std::get<4>(GetParam()); }
+
+  ParallelTFRecordReader::Options Options(bool deterministic) const {
+    ParallelTFRecordReader::Options options;
+    options.num_parallel_files = NumParallelFiles();
+    options.deterministic = deterministic;
+    options.buffer_size = BufferSize();
+    return options;
+  }
+};
+
+TEST_P(ParallelTFRecordReaderParamTest, DeterministicOrder) {
+  TF_ASSERT_OK_AND_ASSIGN(
+      std::vector<std::string> filenames,
+      WriteFiles(Compression(), NumFiles(), RecordsPerFile()));
+  ParallelTFRecordReader reader(filenames, Compression(), RecordTypes(),
+                                tsl::Env::Default(),
+                                Options(/*deterministic=*/true));
+  TF_ASSERT_OK_AND_ASSIGN(std::vector<int64_t> records, ReadRecords(reader));
+  EXPECT_THAT(records, ElementsAreArray(Range(NumFiles() * RecordsPerFile())));
+}
+
+TEST_P(ParallelTFRecordReaderParamTest, NonDeterministicOrder) {
+  TF_ASSERT_OK_AND_ASSIGN(
+      std::vector<std::string> filenames,
+      WriteFiles(Compression(), NumFiles(), RecordsPerFile()));
+  ParallelTFRecordReader reader(filenames, Compression(), RecordTypes(),
+                                tsl::Env::Default(),
+                                Options(/*deterministic=*/false));
+  TF_ASSERT_OK_AND_ASSIGN(std::vector<int64_t> records, ReadRecords(reader));
+  EXPECT_THAT(records,
+              UnorderedElementsAreArray(Range(NumFiles() * RecordsPerFile())));
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    ParallelTFRecordReaderParams, ParallelTFRecordReaderParamTest,
+    ::testing::Combine(
+        /*NumFiles*/ ::testing::Values(0, 1, 10),
+        /*RecordsPerFile*/ ::testing::Values(0, 1, 100),
+        /*NumParallelFiles*/ ::testing::Values(1, 3, 20),
+        /*BufferSize*/ ::testing::Values(1, 16),
+        /*Compression*/
+        ::testing::Values(tsl::io::compression::kNone,
+                          tsl::io::compression::kSnappy,
+                          tsl::io::compression::kZlib)));
+
+TEST(ParallelTFRecordReaderTest, BytesRead) {
+  TF_ASSERT_OK_AND_ASSIGN(
+      std::vector<std::string> filenames,
+      WriteFiles(tsl::io::compression::kNone, /*num_files=*/3,
+                 /*records_per_file=*/10));
+  ParallelTFRecordReader reader(filenames, tsl::io::compression::kNone,
+                                RecordTypes(), tsl::Env::Default());
+  TF_ASSERT_OK(ReadRecords(reader).status());
+  EXPECT_GT(reader.BytesRead(), 0);
+}
+
+TEST(ParallelTFRecordReaderTest, FileDoesNotExist) {
+  TF_ASSERT_OK_AND_ASSIGN(
+      std::vector<std::string> filenames,
+      WriteFiles(tsl::io::compression::kNone, /*num_files=*/3,
+                 /*records_per_file=*/10));
+  filenames.push_back("/file/does/not/exist");
+  ParallelTFRecordReader reader(filenames, tsl::io::compression::kNone,
+                                RecordTypes(), tsl::Env::Default());
+  EXPECT_THAT(ReadRecords(reader),
+              StatusIs(absl::StatusCode::kNotFound,
+                       HasSubstr("/file/does/not/exist")));
+}
+
+TEST(ParallelTFRecordReaderTest, Cancel) {
+  TF_ASSERT_OK_AND_ASSIGN(
+      std::vector<std::string> filenames,
+      WriteFiles(tsl::io::compression::kNone, /*num_files=*/3,
+                 /*records_per_file=*/100));
+  ParallelTFRecordReader::Options options;
+  options.buffer_size = 1;
+  ParallelTFRecordReader reader(filenames, tsl::io::compression::kNone,
+                                RecordTypes(), tsl::Env::Default(), options);
+  std::vector<Tensor> record;
+  bool end_of_sequence = false;
+  TF_ASSERT_OK(reader.GetNext(record, end_of_sequence));
+  EXPECT_FALSE(end_of_sequence);
+
+  reader.Cancel();
+  EXPECT_THAT(reader.GetNext(record, end_of_sequence),
+              StatusIs(absl::StatusCode::kCancelled));
+}
+
+TEST(ParallelTFRecordReaderTest, BufferBytes) {
+  TF_ASSERT_OK_AND_ASSIGN(
+      std::vector<std::string> filenames,
+      WriteFiles(tsl::io::compression::kNone, /*num_files=*/3,
+                 /*records_per_file=*/100));
+  for (bool deterministic : {true, false}) {
+    ParallelTFRecordReader::Options options;
+    options.deterministic = deterministic;
+    // Smaller than a record, so one record is buffered at a time.
+    options.buffer_bytes = ByteSize::Bytes(1);
+    ParallelTFRecordReader reader(filenames, tsl::io::compression::kNone,
+                                  RecordTypes(), tsl::Env::Default(), options);
+    TF_ASSERT_OK_AND_ASSIGN(std::vector<int64_t> records, ReadRecords(reader));
+    EXPECT_THAT(records, UnorderedElementsAreArray(Range(300)));
+  }
+}
+
+TEST(ParallelTFRecordReaderTest, ReadAheadOptions) {
+  // The blocks and the buffered records each take half of the read-ahead.
+  ParallelTFRecordReader::Options options =
+      ParallelTFRecordReader::ReadAheadOptions(ByteSize::MB(6));
+  EXPECT_EQ(options.num_parallel_files, 1);
+  ASSERT_TRUE(options.buffer_bytes.has_value());
+  EXPECT_EQ(*options.buffer_bytes, ByteSize::MB(3));
+  EXPECT_EQ(options.read_block_size * (options.async_read_queue_depth + 1),
+            ByteSize::MB(3));
+
+  // Blocks stay aligned and within bounds.
+  for (ByteSize read_ahead :
+       {ByteSize::KB(1), ByteSize::MB(1) + ByteSize::Bytes(1),
+        ByteSize::GB(1)}) {
+    options = ParallelTFRecordReader::ReadAheadOptions(read_ahead);
+    EXPECT_EQ(options.read_block_size.ToUnsignedBytes() % 4096, 0)
+        << read_ahead;
+    EXPECT_GE(options.read_block_size, ByteSize::KB(64)) << read_ahead;
+    EXPECT_LE(options.read_block_size, ByteSize::MB(4)) << read_ahead;
+  }
+}
+
+TEST(ParallelTFRecordReaderTest, NoFiles) {
+  ParallelTFRecordReader reader(/*filenames=*/{}, tsl::io::compression::kNone,
+                                RecordTypes(), tsl::Env::Default());
+  EXPECT_THAT(ReadRecords(reader), tsl::testing::IsOkAndHolds(IsEmpty()));
+}
+
+// Size of the synthetic snapshot read by the benchmark.
+constexpr int64_t kBenchmarkSnapshotBytes = int64_t{2} << 30;
+constexpr int64_t kBenchmarkChunkBytes = int64_t{128} << 20;
+constexpr int64_t kBenchmarkRecordBytes = int64_t{1} << 20;
+
+// Writes a Snappy-compressed snapshot of `kBenchmarkSnapshotBytes` once, and
+// returns its chunk files. Records are partially compressible, like encoded
+// images.
+const std::vector<std::string>& BenchmarkChunkFiles() {
+  static const std::vector<std::string>* chunk_files = []() {
+    auto* chunk_files = new std::vector<std::string>();
+    std::string test_dir = TestDir().value();
+    Tensor record(DT_UINT8, TensorShape({kBenchmarkRecordBytes}));
+    auto flat = record.flat<uint8_t>();
+    for (int64_t i = 0; i < kBenchmarkRecordBytes; ++i) {
+      flat(i) = static_cast<uint8_t>((i * 2654435761u) >> 28);
+    }
+    for (int64_t i = 0; i < kBenchmarkSnapshotBytes / kBenchmarkChunkBytes;
+         ++i) {
+      chunk_files->push_back(
+          tsl::io::JoinPath(test_dir, absl::StrCat("chunk_", i)));
+      snapshot_util::TFRecordWriter writer(chunk_files->back(),
+                                           tsl::io::compression::kSnappy);
+      TF_CHECK_OK(writer.Initialize(tsl::Env::Default()));
+      for (int64_t j = 0; j < kBenchmarkChunkBytes / kBenchmarkRecordBytes;
+           ++j) {
+        TF_CHECK_OK(writer.WriteTensors({record}));
+      }
+      TF_CHECK_OK(writer.Close());
+    }
+    return chunk_files;
+  }();
+  return *chunk_files;
+}
+
+void BM_ReadSnapshot(::testing::benchmark::State& state) {
+  ParallelTFRecordReader::Options options;
+  options.num_parallel_files = state.range(0);
+  options.deterministic = state.range(1);
+  const std::vector<std::string>& chunk_files = BenchmarkChunkFiles();
+
+  for (auto s : state) {
+    ParallelTFRecordReader reader(chunk_files, tsl::io::compression::kSnappy,
+                                  DataTypeVector{DT_UINT8},
+                                  tsl::Env::Default(), options);
+    std::vector<Tensor> record;
+    bool end_of_sequence = false;
+    TF_CHECK_OK(reader.GetNext(record, end_of_sequence));
+    while (!end_of_sequence) {
+      TF_CHECK_OK(reader.GetNext(record, end_of_sequence));
+    }
+  }
+  state.SetBytesProcessed(state.iterations() * kBenchmarkSnapshotBytes);
+}
+
+BENCHMARK(BM_ReadSnapshot)
+    ->ArgPair(1, true)
+    ->ArgPair(2, true)
+    ->ArgPair(4, true)
+    ->ArgPair(8, true)
+    ->ArgPair(16, true)
+    ->ArgPair(4, false)
+    ->ArgPair(16, false)
+    ->MeasureProcessCPUTime()
+    ->UseRealTime();
+
+// Reads the benchmark snapshot like `load()`, which interleaves its chunks
+// `cycle_length` at a time and returns a record of each chunk of a cycle in
+// turn. Compares the serial reader which SnapshotChunkDataset used before,
+// which reads and decompresses on the consuming thread, with a
+// ParallelTFRecordReader per chunk, whose read-ahead is its share of a
+// budget split across the cycle.
+void BM_ReadSnapshotInterleaved(::testing::benchmark::State& state) {
+  const int64_t cycle_length = state.range(0);
+  const bool read_ahead = state.range(1);
+  constexpr ByteSize kReadAheadBudget = ByteSize::MB(256);
+  const std::vector<std::string>& chunk_files = BenchmarkChunkFiles();
+  const DataTypeVector dtypes{DT_UINT8};
+
+  for (auto s : state) {
+    for (size_t begin = 0; begin < chunk_files.size(); begin += cycle_length) {
+      const size_t end =
+          std::min<size_t>(chunk_files.size(), begin + cycle_length);
+      std::vector<std::unique_ptr<snapshot_util::TFRecordReader>>
+          serial_readers;
+      std::vector<std::unique_ptr<ParallelTFRecordReader>> parallel_readers;
+      for (size_t i = begin; i < end; ++i) {
+        if (read_ahead) {
+          parallel_readers.push_back(std::make_unique<ParallelTFRecordReader>(
+              std::vector<std::string>{chunk_files[i]},
+              tsl::io::compression::kSnappy, dtypes, tsl::Env::Default(),
+              ParallelTFRecordReader::ReadAheadOptions(kReadAheadBudget /
+                                                       (end - begin))));
+        } else {
+          serial_readers.push_back(
+              std::make_unique<snapshot_util::TFRecordReader>(
+                  chunk_files[i], tsl::io::compression::kSnappy, dtypes));
+          TF_CHECK_OK(serial_readers.back()->Initialize(tsl::Env::Default()));
+        }
+      }
+      std::vector<bool> done(end - begin, false);
+      size_t num_done = 0;
+      while (num_done < done.size()) {
+        for (size_t i = 0; i < done.size(); ++i) {
+          if (done[i]) continue;
+          std::vector<Tensor> record;
+          bool end_of_sequence = false;
+          if (read_ahead) {
+            TF_CHECK_OK(parallel_readers[i]->GetNext(record, end_of_sequence));
+          } else {
+            absl::Status status = serial_readers[i]->ReadTensors(&record);
+            end_of_sequence = absl::IsOutOfRange(status);
+            if (!end_of_sequence) TF_CHECK_OK(status);
+          }
+          if (end_of_sequence) {
+            done[i] = true;
+            ++num_done;
+          }
+        }
+      }
+    }
+  }
+  state.SetBytesProcessed(state.iterations() * kBenchmarkSnapshotBytes);
+}
+
+BENCHMARK(BM_ReadSnapshotInterleaved)
+    ->ArgPair(4, false)
+    ->ArgPair(4, true)
+    ->ArgPair(16, false)
+    ->ArgPair(16, true)
+    ->MeasureProcessCPUTime()
+    ->UseRealTime();
+
+}  // namespace
+}  // namespace data
+}  // namespace tensorflow
@@ -12,6 +12,7 @@ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
 See the License for the specific language governing permissions and
 limitations under the License.
 ==============================================================================*/
+#include <atomic>
 #include <cstdint>
 #include <memory>
 #include <string>
@@ -19,9 +20,11 @@ limitations under the License.
 #include <vector>
 
 #include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
 #include "tensorflow/core/data/name_utils.h"
-#include "tensorflow/core/data/snapshot_utils.h"
+#include "tensorflow/core/data/service/byte_size.h"
+#include "tensorflow/core/data/service/snapshot/parallel_tfrecord_reader.h"
 #include "tensorflow/core/data/utils.h"
 #include "tensorflow/core/framework/attr_value.pb.h"
 #include "tensorflow/core/framework/dataset.h"
@@ -47,6 +50,33 @@ constexpr const char* const kSnapshotChunkDataset = "SnapshotChunkDataset";
 
 constexpr int64_t kTFRecordReaderOutputBufferSize = 512 << 20;  // 512MB
 
+// The read-ahead of all chunk iterators in the process shares this much
+// memory. `load()` interleaves the chunk datasets with a cycle length of the
+// number of CPUs, so the iterators of an interleave cycle read at the same
+// time and split the budget.
+constexpr ByteSize kReadAheadBudget = ByteSize::MB(256);
+
+// The share of `kReadAheadBudget` of a chunk iterator. An iterator gets an
+// equal share with the iterators which read at the time it starts reading.
+class ReadAheadShare {
+ public:
+  ReadAheadShare() : num_readers_(NumReaders().fetch_add(1) + 1) {}
+  ~ReadAheadShare() { NumReaders().fetch_sub(1); }
+  ReadAheadShare(const ReadAheadShare&) = delete;
+  ReadAheadShare& operator=(const ReadAheadShare&) = delete;
+
+  ByteSize bytes() const { return kReadAheadBudget / num_readers_; }
+
+ private:
+  // Number of chunk iterators which are reading.
+  static std::atomic<int64_t>& NumReaders() {
+    static auto* num_readers = new std::atomic<int64_t>(0);
+    return *num_readers;
+  }
+
+  const int64_t num_readers_;
+};
+
 absl::string_view GetSnapshotPath(absl::string_view chunk_file) {
   // Snapshot chunks are placed in snapshot_path/chunks/chunk_x.
   absl::string_view chunk_dir = tsl::io::Dirname(chunk_file);
@@ -126,30 +156,36 @@ class SnapshotChunkDatasetOp::Dataset : public DatasetBase {
     explicit Iterator(const Params& params)
         : DatasetIterator<Dataset>(params) {}
 
-    ~Iterator() override { RecordBytesRead(); }
+    ~Iterator() override {
+      if (reader_) {
+        RecordBytesRead();
+      }
+    }
 
     absl::Status Initialize(IteratorContext* ctx) override {
-      reader_ = std::make_unique<snapshot_util::TFRecordReader>(
-          TranslateFileName(dataset()->chunk_file_), dataset()->compression_,
-          dataset()->dtypes_, kTFRecordReaderOutputBufferSize);
-      return reader_->Initialize(ctx->env());
+      // Reads and decompresses the chunk in the background while the records
+      // read so far are consumed.
+      if (!read_ahead_share_) {
+        read_ahead_share_ = std::make_unique<ReadAheadShare>();
+      }
+      ParallelTFRecordReader::Options options =
+          ParallelTFRecordReader::ReadAheadOptions(read_ahead_share_->bytes());
+      options.decompression_buffer_size = kTFRecordReaderOutputBufferSize;
+      reader_ = std::make_unique<ParallelTFRecordReader>(
+          std::vector<std::string>{TranslateFileName(dataset()->chunk_file_)},
+          dataset()->compression_, dataset()->dtypes_, ctx->env(), options);
+      return absl::OkStatus();
     }
 
    protected:
     absl::Status GetNextInternal(IteratorContext* ctx,
                                  std::vector<Tensor>* out_tensors,
                                  bool* end_of_sequence) override {
-      *end_of_sequence = false;
-      absl::Status status = reader_->ReadTensors(out_tensors);
-      if (absl::IsOutOfRange(status)) {
-        *end_of_sequence = true;
-        return absl::OkStatus();
+      TF_RETURN_IF_ERROR(reader_->GetNext(*out_tensors, *end_of_sequence));
+      if (!*end_of_sequence) {
+        ++start_index_;
       }
-      TF_RETURN_WITH_CONTEXT_IF_ERROR(
-          status,
-          " Failed to read tf.data snapshot file: ", dataset()->chunk_file_);
-      ++start_index_;
-      return status;
+      return absl::OkStatus();
     }
 
     absl::Status SaveInternal(SerializationContext* ctx,
@@ -174,7 +210,15 @@ class SnapshotChunkDatasetOp::Dataset : public DatasetBase {
     absl::Status AdvanceToStartIndex(IteratorContext* ctx) {
       for (int64_t i = 0; i < start_index_; ++i) {
         std::vector<Tensor> unused;
-        TF_RETURN_IF_ERROR(reader_->ReadTensors(&unused));
+        bool end_of_sequence = false;
+        TF_RETURN_IF_ERROR(reader_->GetNext(unused, end_of_sequence));
+        if (end_of_sequence) {
+          return absl::OutOfRangeError(absl::StrCat(
+              "tf.data snapshot file ",
+              absl::string_view(dataset()->chunk_file_), " has ", i,
+              " records, but the checkpoint starts at record ", start_index_,
+              "."));
+        }
       }
       return absl::OkStatus();
     }
@@ -185,7 +229,8 @@ class SnapshotChunkDatasetOp::Dataset : public DatasetBase {
           ->IncrementBy(bytes_read);
     }
 
-    std::unique_ptr<snapshot_util::TFRecordReader> reader_;
+    std::unique_ptr<ReadAheadShare> read_ahead_share_;
+    std::unique_ptr<ParallelTFRecordReader> reader_;
     int64_t start_index_ = 0;
   };
 
@@ -20,6 +20,9 @@ limitations under the License.
 #include <utility>
 #include <vector>
 
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "tensorflow/core/data/compression_utils.h"
 #include "tensorflow/core/data/service/byte_size.h"
 #include "tensorflow/core/data/service/common.h"
 #include "tensorflow/core/data/service/cross_trainer_cache.h"
@@ -29,9 +32,14 @@ limitations under the License.
 #include "tensorflow/core/data/standalone.h"
 #include "tensorflow/core/framework/cancellation.h"
 #include "tensorflow/core/framework/dataset.h"
+#include "tensorflow/core/framework/dataset.pb.h"
+#include "tensorflow/core/framework/metrics.h"
 #include "tensorflow/core/framework/model.h"
 #include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_shape.h"
 #include "tensorflow/core/framework/tensor_util.h"
+#include "tensorflow/core/framework/types.pb.h"
+#include "tensorflow/core/framework/variant.h"
 #include "tensorflow/core/lib/gtl/cleanup.h"
 #include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/errors.h"
@@ -48,6 +56,33 @@ namespace {
 constexpr int64_t kWaitBeforeSkipUs = 100 * 1000;  // 100ms.
 constexpr size_t kDefaultCrossTrainerCacheSizeBytes =
     10 * (size_t{1} << 30);  // 10GB
+// Bounds on the number of elements prefetched by first-come-first-served
+// tasks.
+constexpr size_t kMinPrefetchBufferSize = 1;
+constexpr size_t kMaxPrefetchBufferSize = 16;
+
+CacheEvictionPolicy ToCacheEvictionPolicy(
+    experimental::WorkerConfig::CrossTrainerCacheEvictionPolicy policy) {
+  switch (policy) {
+    case experimental::WorkerConfig::RETAIN_FOR_SLOWEST_TRAINER:
+      return CacheEvictionPolicy::kRetainForSlowestTrainer;
+    case experimental::WorkerConfig::EVICT_LEAST_RECENTLY_READ:
+      return CacheEvictionPolicy::kLeastRecentlyRead;
+    default:
+      return CacheEvictionPolicy::kFifo;
+  }
+}
+
+// Returns the `CompressedElement` that makes up `element`, or nullptr if
+// `element` is not a single compressed element.
+const CompressedElement* GetCompressedElement(const GetElementResult& element) {
+  if (element.components.size() != 1 ||
+      element.components[0].dtype() != DT_VARIANT ||
+      element.components[0].dims() != 0) {
+    return nullptr;
+  }
+  return element.components[0].scalar<Variant>()().get<CompressedElement>();
+}
 
 }  // namespace
 
@@ -96,12 +131,17 @@ absl::Status TaskRunner::Create(const experimental::WorkerConfig& worker_config,
                                                  task_def.num_consumers(),
                                                  task_def.worker_address());
   } else if (task_def.use_cross_trainer_cache()) {
-    const size_t max_cache_size_bytes =
+    CrossTrainerCacheConfig cache_config;
+    cache_config.max_cache_size_bytes =
         worker_config.cross_trainer_cache_size_bytes() > 0
             ? worker_config.cross_trainer_cache_size_bytes()
             : kDefaultCrossTrainerCacheSizeBytes;
+    cache_config.eviction_policy = ToCacheEvictionPolicy(
+        worker_config.cross_trainer_cache_eviction_policy());
+    cache_config.max_compressed_cache_size_bytes = std::max<int64_t>(
+        worker_config.cross_trainer_cache_compressed_size_bytes(), 0);
     out = std::make_unique<CachingTaskRunner>(std::move(iterator),
-                                              max_cache_size_bytes);
+                                              cache_config);
   } else {
     out = std::make_unique<FirstComeFirstServedTaskRunner>(std::move(iterator));
   }
@@ -110,7 +150,9 @@ absl::Status TaskRunner::Create(const experimental::WorkerConfig& worker_config,
 
 FirstComeFirstServedTaskRunner::FirstComeFirstServedTaskRunner(
     std::unique_ptr<TaskIterator> iterator)
-    : iterator_(std::move(iterator)), buffer_(/*buffer_size=*/1) {
+    : iterator_(std::move(iterator)),
+      buffer_(kMinPrefetchBufferSize),
+      buffer_sizer_(kMinPrefetchBufferSize, kMaxPrefetchBufferSize) {
   RunPrefetchThread();
 }
 
@@ -118,6 +160,12 @@ FirstComeFirstServedTaskRunner::~FirstComeFirstServedTaskRunner() { Cancel(); }
 
 absl::Status FirstComeFirstServedTaskRunner::GetNext(
     const GetElementRequest& req, GetElementResult& result) {
+  buffer_sizer_.RecordRequest(
+      absl::Now(), req.optional_credits_case() == GetElementRequest::kCredits
+                       ? std::make_optional(req.credits())
+                       : std::nullopt);
+  buffer_.SetBufferSize(buffer_sizer_.BufferSize());
+  metrics::RecordTFDataServiceTaskBufferOccupancy(buffer_.Size());
   if (req.allow_skip() && buffer_.Empty()) {
     result.skip = true;
     return absl::OkStatus();
@@ -126,13 +174,29 @@ absl::Status FirstComeFirstServedTaskRunner::GetNext(
 }
 
 absl::Status FirstComeFirstServedTaskRunner::GetNext(GetElementResult& result) {
+  const absl::Time start = absl::Now();
   TF_ASSIGN_OR_RETURN(result, buffer_.Pop());
+  const absl::Duration stall_time = absl::Now() - start;
+  metrics::RecordTFDataServiceTaskStallTime(
+      "consumer", absl::ToInt64Microseconds(stall_time));
+  mutex_lock l(stats_mu_);
+  consumer_stall_time_ += stall_time;
   return absl::OkStatus();
 }
 
 absl::Status FirstComeFirstServedTaskRunner::PrefetchFn() {
   while (true) {
-    TF_RETURN_IF_ERROR(buffer_.Push(GetNextFromInputIterator()));
+    absl::Time start = absl::Now();
+    absl::StatusOr<GetElementResult> element = GetNextFromInputIterator();
+    buffer_sizer_.RecordElementProduced(absl::Now() - start);
+
+    start = absl::Now();
+    TF_RETURN_IF_ERROR(buffer_.Push(std::move(element)));
+    const absl::Duration stall_time = absl::Now() - start;
+    metrics::RecordTFDataServiceTaskStallTime(
+        "producer", absl::ToInt64Microseconds(stall_time));
+    mutex_lock l(stats_mu_);
+    producer_stall_time_ += stall_time;
   }
   return absl::OkStatus();
 }
@@ -177,13 +241,31 @@ std::shared_ptr<model::Model> FirstComeFirstServedTaskRunner::model() const {
   return model_;
 }
 
+std::optional<TaskBufferStats> FirstComeFirstServedTaskRunner::GetBufferStats()
+    const {
+  TaskBufferStats stats;
+  stats.buffer_size = buffer_.BufferSize();
+  stats.buffered_elements = buffer_.Size();
+  mutex_lock l(stats_mu_);
+  stats.consumer_stall_time = consumer_stall_time_;
+  stats.producer_stall_time = producer_stall_time_;
+  return stats;
+}
+
 CachingTaskRunner::CachingTaskRunner(std::unique_ptr<TaskIterator> iterator,
                                      size_t max_cache_size_bytes)
+    : CachingTaskRunner(std::move(iterator),
+                        CrossTrainerCacheConfig{max_cache_size_bytes}) {}
+
+CachingTaskRunner::CachingTaskRunner(
+    std::unique_ptr<TaskIterator> iterator,
+    const CrossTrainerCacheConfig& cache_config)
     : fcfs_task_runner_(std::move(iterator)),
-      cache_(max_cache_size_bytes,
+      cache_(cache_config,
              std::make_unique<GetElementResultSequence>(fcfs_task_runner_)) {
   LOG(INFO) << "Initialized tf.data service cross-trainer cache with "
-            << ByteSize::Bytes(max_cache_size_bytes) << " of memory.";
+            << ByteSize::Bytes(cache_config.max_cache_size_bytes)
+            << " of memory.";
 }
 
 CachingTaskRunner::~CachingTaskRunner() { Cancel(); }
@@ -217,6 +299,42 @@ size_t CachingTaskRunner::GetElementResultSequence::GetElementSizeBytes(
   return element.EstimatedMemoryUsageBytes();
 }
 
+absl::StatusOr<GetElementResult>
+CachingTaskRunner::GetElementResultSequence::Compress(
+    const GetElementResult& element) const {
+  CompressedElement compressed;
+  TF_RETURN_IF_ERROR(CompressElement(element.components, &compressed));
+  GetElementResult result;
+  result.components.emplace_back(DT_VARIANT, TensorShape({}));
+  result.components[0].scalar<Variant>()() = std::move(compressed);
+  result.element_index = element.element_index;
+  result.end_of_sequence = element.end_of_sequence;
+  result.skip = element.skip;
+  return result;
+}
+
+absl::StatusOr<GetElementResult>
+CachingTaskRunner::GetElementResultSequence::Uncompress(
+    const GetElementResult& element) const {
+  const CompressedElement* compressed = GetCompressedElement(element);
+  if (compressed == nullptr) {
+    return errors::Internal(
+        "Expected a compressed tf.data service element in the cross-trainer "
+        "cache.");
+  }
+  GetElementResult result;
+  TF_RETURN_IF_ERROR(UncompressElement(*compressed, &result.components));
+  result.element_index = element.element_index;
+  result.end_of_sequence = element.end_of_sequence;
+  result.skip = element.skip;
+  return result;
+}
+
+bool CachingTaskRunner::GetElementResultSequence::IsCompressed(
+    const GetElementResult& element) const {
+  return GetCompressedElement(element) != nullptr;
+}
+
 void CachingTaskRunner::Cancel() {
   VLOG(2) << "Cancelling tf.data service cross-trainer cache task.";
   if (!cache_.IsCancelled()) {
@@ -230,6 +348,15 @@ std::shared_ptr<model::Model> CachingTaskRunner::model() const {
   return fcfs_task_runner_.model();
 }
 
+std::optional<TaskBufferStats> CachingTaskRunner::GetBufferStats() const {
+  return fcfs_task_runner_.GetBufferStats();
+}
+
+absl::flat_hash_map<std::string, TrainerCacheStats>
+CachingTaskRunner::GetTrainerCacheStats() const {
+  return cache_.GetTrainerStats();
+}
+
 RoundRobinTaskRunner::RoundRobinTaskRunner(
     std::unique_ptr<TaskIterator> iterator, int64_t num_consumers,
     string worker_address)
@@ -15,13 +15,18 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_DATA_SERVICE_TASK_RUNNER_H_
 #define TENSORFLOW_CORE_DATA_SERVICE_TASK_RUNNER_H_
 
+#include <cstdint>
 #include <memory>
 #include <optional>
+#include <string>
 #include <vector>
 
+#include "absl/container/flat_hash_map.h"
+#include "absl/time/time.h"
 #include "tensorflow/core/data/service/common.pb.h"
 #include "tensorflow/core/data/service/cross_trainer_cache.h"
 #include "tensorflow/core/data/service/data_transfer.h"
+#include "tensorflow/core/data/service/prefetch_buffer_sizer.h"
 #include "tensorflow/core/data/service/thread_safe_buffer.h"
 #include "tensorflow/core/data/service/worker.pb.h"
 #include "tensorflow/core/data/standalone.h"
@@ -87,6 +92,18 @@ class StandaloneTaskIterator : public TaskIterator {
   std::unique_ptr<standalone::Iterator> iterator_;
 };
 
+// Usage of a task runner's prefetch buffer.
+struct TaskBufferStats {
+  // Maximum number of elements the buffer may currently hold.
+  int64_t buffer_size = 0;
+  // Number of elements currently buffered.
+  int64_t buffered_elements = 0;
+  // Total time consumers waited because the buffer was empty.
+  absl::Duration consumer_stall_time;
+  // Total time the prefetch thread waited because the buffer was full.
+  absl::Duration producer_stall_time;
+};
+
 // Interface for providing elements to task consumers.
 class TaskRunner {
  public:
@@ -103,10 +120,24 @@ class TaskRunner {
   virtual void Cancel() = 0;
   // Returns the dataset model for performance analysis.
   virtual std::shared_ptr<model::Model> model() const = 0;
+  // Returns the usage of the prefetch buffer, if the runner has one.
+  virtual std::optional<TaskBufferStats> GetBufferStats() const {
+    return std::nullopt;
+  }
+  // Returns the cross-trainer cache queries made by each trainer, keyed by
+  // trainer ID, if the runner caches elements across trainers.
+  virtual absl::flat_hash_map<std::string, TrainerCacheStats>
+  GetTrainerCacheStats() const {
+    return {};
+  }
 };
 
 // A task runner which provides elements on a first-come first-served basis.
 // It does not consider which consumer is making the request.
+//
+// Elements are prefetched into a buffer whose size is adjusted by a
+// `PrefetchBufferSizer` from the consumers' request rate and the credits they
+// advertise in `GetElementRequest.credits`.
 class FirstComeFirstServedTaskRunner : public TaskRunner {
  public:
   explicit FirstComeFirstServedTaskRunner(
@@ -122,6 +153,8 @@ class FirstComeFirstServedTaskRunner : public TaskRunner {
 
   std::shared_ptr<model::Model> model() const override;
 
+  std::optional<TaskBufferStats> GetBufferStats() const override;
+
  private:
   // Function to continually prefetch the next element. Returns an error if the
   // task has been cancelled.
@@ -140,6 +173,10 @@ class FirstComeFirstServedTaskRunner : public TaskRunner {
   int64_t element_index_ TF_GUARDED_BY(mu_) = 0;
 
   ThreadSafeBuffer<GetElementResult> buffer_;
+  PrefetchBufferSizer buffer_sizer_;
+  mutable mutex stats_mu_;
+  absl::Duration consumer_stall_time_ TF_GUARDED_BY(stats_mu_);
+  absl::Duration producer_stall_time_ TF_GUARDED_BY(stats_mu_);
   std::unique_ptr<Thread> prefetch_thread_;
 
   FirstComeFirstServedTaskRunner(const FirstComeFirstServedTaskRunner&) =
@@ -156,6 +193,8 @@ class CachingTaskRunner : public TaskRunner {
  public:
   explicit CachingTaskRunner(std::unique_ptr<TaskIterator> iterator,
                              size_t max_cache_size_bytes);
+  explicit CachingTaskRunner(std::unique_ptr<TaskIterator> iterator,
+                             const CrossTrainerCacheConfig& cache_config);
   ~CachingTaskRunner() override;
 
   // Gets the next element from the cross-trainer cache, blocking if the data is
@@ -171,6 +210,11 @@ class CachingTaskRunner : public TaskRunner {
   // Returns the dataset model for performance analysis.
   std::shared_ptr<model::Model> model() const override;
 
+  std::optional<TaskBufferStats> GetBufferStats() const override;
+
+  absl::flat_hash_map<std::string, TrainerCacheStats> GetTrainerCacheStats()
+      const override;
+
  private:
   // The `GetElementResultSequence` generates a sequence of elements from the
   // `FirstComeFirstServedTaskRunner`. It is used for the `CrossTrainerCache` to
@@ -181,6 +225,14 @@ class CachingTaskRunner : public TaskRunner {
         FirstComeFirstServedTaskRunner& fcfs_task_runner);
     absl::StatusOr<GetElementResult> GetNext() override;
     size_t GetElementSizeBytes(const GetElementResult& element) const override;
+    // Compresses the components of `element` into one `CompressedElement`.
+    absl::StatusOr<GetElementResult> Compress(
+        const GetElementResult& element) const override;
+    absl::StatusOr<GetElementResult> Uncompress(
+        const GetElementResult& element) const override;
+    // Elements of datasets compressed for the tf.data service are cached as
+    // they are.
+    bool IsCompressed(const GetElementResult& element) const override;
 
    private:
     FirstComeFirstServedTaskRunner& fcfs_task_runner_;
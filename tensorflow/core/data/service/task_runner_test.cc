@@ -22,6 +22,7 @@ limitations under the License.
 #include <utility>
 #include <vector>
 
+#include "absl/container/flat_hash_map.h"
 #include "absl/memory/memory.h"
 #include "tensorflow/core/data/service/data_transfer.h"
 #include "tensorflow/core/data/service/worker.pb.h"
@@ -326,6 +327,31 @@ TEST(CachingTaskRunnerTest, GetNext) {
   }
 }
 
+TEST(CachingTaskRunnerTest, TrainerCacheStats) {
+  const int64_t range = 10;
+  CachingTaskRunner runner(std::make_unique<InfiniteRangeIterator>(),
+                           /*max_cache_size_bytes=*/kLargeCache);
+  EXPECT_TRUE(runner.GetTrainerCacheStats().empty());
+
+  // The first trainer produces the elements and the second reads them from
+  // the cache.
+  for (const std::string trainer_id : {"Trainer 0", "Trainer 1"}) {
+    GetElementRequest request;
+    request.set_trainer_id(trainer_id);
+    TF_ASSERT_OK_AND_ASSIGN(
+        std::vector<int64_t> output,
+        GetElementsFromTaskRunner<int64_t>(runner, request, range));
+  }
+  absl::flat_hash_map<std::string, TrainerCacheStats> stats =
+      runner.GetTrainerCacheStats();
+  ASSERT_THAT(stats, SizeIs(2));
+  EXPECT_EQ(stats["Trainer 0"].misses, range);
+  EXPECT_EQ(stats["Trainer 0"].hits, 0);
+  EXPECT_EQ(stats["Trainer 1"].hits, range);
+  EXPECT_EQ(stats["Trainer 1"].misses, 0);
+  EXPECT_DOUBLE_EQ(stats["Trainer 1"].HitRate(), 1.0);
+}
+
 TEST(CachingTaskRunnerTest, EmptyDataset) {
   CachingTaskRunner runner(
       std::make_unique<RangeIterator>(/*range=*/0, /*repeat=*/false),
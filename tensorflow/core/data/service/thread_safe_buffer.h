@@ -50,10 +50,22 @@ class ThreadSafeBuffer final {
   // Returns whether the buffer is empty.
   bool Empty() const;
 
+  // Returns the number of buffered elements.
+  size_t Size() const;
+
+  // Returns the maximum number of buffered elements.
+  size_t BufferSize() const;
+
+  // Changes the maximum number of buffered elements. If the buffer holds more
+  // than `buffer_size` elements, they remain buffered, but `Push` blocks until
+  // enough are popped.
+  // REQUIRES: buffer_size > 0
+  void SetBufferSize(size_t buffer_size);
+
  private:
-  const size_t buffer_size_;
 
   mutable mutex mu_;
+  size_t buffer_size_ TF_GUARDED_BY(mu_);
   condition_variable ready_to_pop_;
   condition_variable ready_to_push_;
   std::deque<StatusOr<T>> results_ TF_GUARDED_BY(mu_);
@@ -77,6 +89,30 @@ bool ThreadSafeBuffer<T>::Empty() const {
   return results_.empty();
 }
 
+template <class T>
+size_t ThreadSafeBuffer<T>::Size() const {
+  tf_shared_lock l(mu_);
+  return results_.size();
+}
+
+template <class T>
+size_t ThreadSafeBuffer<T>::BufferSize() const {
+  tf_shared_lock l(mu_);
+  return buffer_size_;
+}
+
+template <class T>
+void ThreadSafeBuffer<T>::SetBufferSize(size_t buffer_size) {
+  DCHECK_GT(buffer_size, 0)
+      << "ThreadSafeBuffer must have a positive buffer size. Got "
+      << buffer_size << ".";
+  mutex_lock l(mu_);
+  if (buffer_size > buffer_size_) {
+    ready_to_push_.notify_all();
+  }
+  buffer_size_ = buffer_size;
+}
+
 template <class T>
 StatusOr<T> ThreadSafeBuffer<T>::Pop() {
   mutex_lock l(mu_);
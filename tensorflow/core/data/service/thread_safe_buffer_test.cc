@@ -180,6 +180,36 @@ TEST_P(ThreadSafeBufferTest, BlockWriterWhenBufferIsFull) {
   EXPECT_LE(pop_time, push_time);
 }
 
+TEST_P(ThreadSafeBufferTest, GrowingBufferUnblocksWriter) {
+  ThreadSafeBuffer<int> buffer(GetBufferSize());
+  for (int i = 0; i < GetBufferSize(); ++i) {
+    ASSERT_THAT(buffer.Push(i), IsOk());
+  }
+  EXPECT_EQ(buffer.Size(), GetBufferSize());
+
+  auto thread = absl::WrapUnique(Env::Default()->StartThread(
+      /*thread_options=*/{}, /*name=*/"writer_thread",
+      [&buffer]() { ASSERT_THAT(buffer.Push(-1), IsOk()); }));
+  buffer.SetBufferSize(GetBufferSize() + 1);
+  thread.reset();
+  EXPECT_EQ(buffer.Size(), GetBufferSize() + 1);
+  EXPECT_EQ(buffer.BufferSize(), GetBufferSize() + 1);
+}
+
+TEST_P(ThreadSafeBufferTest, ShrinkingBufferKeepsElements) {
+  ThreadSafeBuffer<int> buffer(GetBufferSize());
+  for (int i = 0; i < GetBufferSize(); ++i) {
+    ASSERT_THAT(buffer.Push(i), IsOk());
+  }
+  buffer.SetBufferSize(1);
+  for (int i = 0; i < GetBufferSize(); ++i) {
+    TF_ASSERT_OK_AND_ASSIGN(int next, buffer.Pop());
+    EXPECT_EQ(next, i);
+  }
+  EXPECT_EQ(buffer.Size(), 0);
+  EXPECT_EQ(buffer.BufferSize(), 1);
+}
+
 TEST_P(ThreadSafeBufferTest, CancelReaders) {
   ThreadSafeBuffer<int> buffer(GetBufferSize());
   std::vector<std::unique_ptr<Thread>> threads;
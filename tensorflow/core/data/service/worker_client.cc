@@ -23,7 +23,11 @@ limitations under the License.
 
 #include "grpcpp/client_context.h"
 #include "grpcpp/create_channel.h"
+#include "grpcpp/impl/codegen/client_unary_call.h"
+#include "grpcpp/impl/codegen/proto_utils.h"
+#include "grpcpp/impl/codegen/rpc_method.h"
 #include "grpcpp/security/credentials.h"
+#include "grpcpp/support/byte_buffer.h"
 #include "grpcpp/support/channel_arguments.h"
 #include "grpcpp/support/status.h"
 #include "absl/container/flat_hash_set.h"
@@ -32,6 +36,7 @@ limitations under the License.
 #include "absl/strings/substitute.h"
 #include "tensorflow/core/data/service/credentials_factory.h"
 #include "tensorflow/core/data/service/data_transfer.h"
+#include "tensorflow/core/data/service/grpc_element_coding.h"
 #include "tensorflow/core/data/service/grpc_util.h"
 #include "tensorflow/core/data/service/worker.grpc.pb.h"
 #include "tensorflow/core/data/service/worker.pb.h"
@@ -109,64 +114,56 @@ class GrpcDataTransferClient : public DataTransferClient {
     VLOG(2) << "Create GrpcDataTransferClient for worker " << address << ".";
     grpc::ChannelArguments args;
     args.SetMaxReceiveMessageSize(-1);
-    auto channel = grpc::CreateCustomChannel(address, credentials, args);
-    stub_ = WorkerService::NewStub(channel);
+    channel_ = grpc::CreateCustomChannel(address, credentials, args);
+    stub_ = WorkerService::NewStub(channel_);
   }
 
   absl::Status GetElement(const GetElementRequest& req,
                           GetElementResult& result) override {
     VLOG(3) << "GetElement for task " << req.task_id() << " from gRPC worker "
             << "server.";
+    bool use_byte_buffer;
     {
       mutex_lock l(mu_);
       if (cancelled_) {
         return errors::Cancelled("Client was cancelled.");
       }
+      use_byte_buffer = !byte_buffer_unimplemented_;
     }
-    grpc::ClientContext ctx;
-    gtl::Cleanup<std::function<void()>> cleanup;
-    {
-      mutex_lock l(mu_);
-      active_contexts_.insert(&ctx);
-      cleanup = gtl::MakeCleanup([this, &ctx] {
-        mutex_lock l(mu_);
-        active_contexts_.erase(&ctx);
+    if (use_byte_buffer) {
+      ::grpc::ByteBuffer buffer;
+      int64_t start_time_us = env_->NowMicros();
+      grpc::Status s = Call([&](grpc::ClientContext* ctx) {
+        return ::grpc::internal::BlockingUnaryCall<GetElementRequest,
+                                                   ::grpc::ByteBuffer>(
+            channel_.get(), get_element_method_, ctx, req, &buffer);
       });
+      int64_t end_time_us = env_->NowMicros();
+      if (s.error_code() != grpc::StatusCode::UNIMPLEMENTED) {
+        if (!s.ok()) {
+          return grpc_util::WrapError("Failed to get element", s);
+        }
+        metrics::RecordTFDataServiceGetElementDuration(
+            kGrpcTransferProtocol, end_time_us - start_time_us);
+        return DecodeElementFromByteBuffer(&buffer, allocator_, &result);
+      }
+      // The worker predates `kGrpcGetElementMethod`.
+      VLOG(2) << "Falling back to WorkerService.GetElement.";
+      mutex_lock l(mu_);
+      byte_buffer_unimplemented_ = true;
     }
     GetElementResponse resp;
     int64_t start_time_us = env_->NowMicros();
-    grpc::Status s = stub_->GetElement(&ctx, req, &resp);
+    grpc::Status s = Call([&](grpc::ClientContext* ctx) {
+      return stub_->GetElement(ctx, req, &resp);
+    });
     int64_t end_time_us = env_->NowMicros();
     if (!s.ok()) {
       return grpc_util::WrapError("Failed to get element", s);
     }
     metrics::RecordTFDataServiceGetElementDuration(kGrpcTransferProtocol,
                                                    end_time_us - start_time_us);
-    result.end_of_sequence = resp.end_of_sequence();
-    result.skip = resp.skip_task();
-    switch (resp.element_case()) {
-      case GetElementResponse::kCompressed: {
-        Tensor tensor(DT_VARIANT, TensorShape{});
-        tensor.scalar<Variant>()() = std::move(resp.compressed());
-        result.components.push_back(tensor);
-        break;
-      }
-      case GetElementResponse::kUncompressed:
-        for (const auto& component : resp.uncompressed().components()) {
-          result.components.emplace_back();
-          bool success =
-              allocator_ != nullptr
-                  ? result.components.back().FromProto(allocator_, component)
-                  : result.components.back().FromProto(component);
-          if (!success) {
-            return errors::Internal("Failed to parse tensor.");
-          }
-        }
-        break;
-      case GetElementResponse::ELEMENT_NOT_SET:
-        break;
-    }
-    return absl::OkStatus();
+    return ElementFromResponse(std::move(resp), allocator_, &result);
   }
 
   void TryCancel() override {
@@ -179,9 +176,26 @@ class GrpcDataTransferClient : public DataTransferClient {
   }
 
  private:
+  // Calls `rpc` with a client context that is cancelled by `TryCancel`.
+  grpc::Status Call(std::function<grpc::Status(grpc::ClientContext*)> rpc) {
+    grpc::ClientContext ctx;
+    {
+      mutex_lock l(mu_);
+      active_contexts_.insert(&ctx);
+    }
+    auto cleanup = gtl::MakeCleanup([this, &ctx] {
+      mutex_lock l(mu_);
+      active_contexts_.erase(&ctx);
+    });
+    return rpc(&ctx);
+  }
+
   Allocator* const allocator_;
   mutex mu_;
+  std::shared_ptr<grpc::Channel> channel_;
   std::unique_ptr<WorkerService::Stub> stub_;
+  const ::grpc::internal::RpcMethod get_element_method_{
+      kGrpcGetElementMethod, ::grpc::internal::RpcMethod::NORMAL_RPC};
   // Set of all currently active clients contexts. Used to support
   // cancellation.
   absl::flat_hash_set<::grpc::ClientContext*> active_contexts_
@@ -189,6 +203,10 @@ class GrpcDataTransferClient : public DataTransferClient {
   // Indicates that the client has been cancelled, so no further requests should
   // be accepted.
   bool cancelled_ TF_GUARDED_BY(mu_) = false;
+  // Set once the worker responds that it does not serve
+  // `kGrpcGetElementMethod`, after which elements are requested as
+  // `GetElementResponse`s.
+  bool byte_buffer_unimplemented_ TF_GUARDED_BY(mu_) = false;
 };
 
 class GrpcTransferClientRegistrar {
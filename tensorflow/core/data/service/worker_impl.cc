@@ -100,7 +100,13 @@ absl::Status MoveElementToResponse(std::vector<Tensor>&& element,
         "it produced ",
         variant.TypeName());
   }
-  *resp.mutable_compressed() = *compressed;
+  if (element[0].RefCountIsOne()) {
+    // Nothing else references the element (e.g. a cross-trainer cache), so
+    // its data can be moved instead of copied.
+    resp.mutable_compressed()->Swap(compressed);
+  } else {
+    *resp.mutable_compressed() = *compressed;
+  }
   return absl::OkStatus();
 }
 
@@ -815,18 +821,61 @@ void DataServiceWorkerImpl::DeleteLocalTask(const TaskInfo& task_info)
 WorkerStateExport DataServiceWorkerImpl::ExportState() const {
   WorkerStateExport worker_state_export;
   *worker_state_export.mutable_worker_config() = config_;
-  mutex_lock l(mu_);
-  if (!registered_) {
-    return worker_state_export;
-  }
-  for (const auto& task : tasks_) {
-    *worker_state_export.add_tasks() = Export(task.second->task_def);
-  }
-  for (int64_t finished_task : finished_tasks_) {
-    worker_state_export.add_finished_task_ids(finished_task);
+  absl::flat_hash_map<int64_t, std::shared_ptr<Task>> current_tasks;
+  {
+    mutex_lock l(mu_);
+    if (!registered_) {
+      return worker_state_export;
+    }
+    for (const auto& task : tasks_) {
+      *worker_state_export.add_tasks() = Export(task.second->task_def);
+    }
+    for (int64_t finished_task : finished_tasks_) {
+      worker_state_export.add_finished_task_ids(finished_task);
+    }
+    for (int64_t deleted_task : deleted_tasks_) {
+      worker_state_export.add_deleted_task_ids(deleted_task);
+    }
+    current_tasks = tasks_;
   }
-  for (int64_t deleted_task : deleted_tasks_) {
-    worker_state_export.add_deleted_task_ids(deleted_task);
+  for (const auto& [task_id, task] : current_tasks) {
+    if (task == nullptr) {
+      continue;
+    }
+    {
+      mutex_lock task_lock(task->mu);
+      if (!task->initialized) {
+        continue;
+      }
+    }
+    if (task->task_runner == nullptr) {
+      continue;
+    }
+    for (const auto& [trainer_id, trainer_stats] :
+         task->task_runner->GetTrainerCacheStats()) {
+      WorkerStateExport::TrainerCacheStats* trainer_cache_stats =
+          worker_state_export.add_trainer_cache_stats();
+      trainer_cache_stats->set_task_id(task_id);
+      trainer_cache_stats->set_trainer_id(trainer_id);
+      trainer_cache_stats->set_hits(trainer_stats.hits);
+      trainer_cache_stats->set_compressed_hits(trainer_stats.compressed_hits);
+      trainer_cache_stats->set_misses(trainer_stats.misses);
+      trainer_cache_stats->set_hit_rate(trainer_stats.HitRate());
+    }
+    std::optional<TaskBufferStats> stats =
+        task->task_runner->GetBufferStats();
+    if (!stats.has_value()) {
+      continue;
+    }
+    WorkerStateExport::TaskBufferStats* task_buffer_stats =
+        worker_state_export.add_task_buffer_stats();
+    task_buffer_stats->set_task_id(task_id);
+    task_buffer_stats->set_buffer_size(stats->buffer_size);
+    task_buffer_stats->set_buffered_elements(stats->buffered_elements);
+    task_buffer_stats->set_consumer_stall_time_us(
+        absl::ToInt64Microseconds(stats->consumer_stall_time));
+    task_buffer_stats->set_producer_stall_time_us(
+        absl::ToInt64Microseconds(stats->producer_stall_time));
   }
   return worker_state_export;
 }
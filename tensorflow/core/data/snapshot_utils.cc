@@ -739,12 +739,15 @@ void Reader::MakeNestedDataset(const std::vector<DatasetBase*>& datasets,
 
 TFRecordReaderImpl::TFRecordReaderImpl(
     const std::string& filename, const string& compression,
-    std::optional<int64_t> output_buffer_size)
+    std::optional<int64_t> output_buffer_size, int64_t input_buffer_size,
+    int async_read_queue_depth)
     : filename_(filename),
       offset_(0),
       bytes_read_(0),
       compression_(compression),
-      output_buffer_size_(output_buffer_size) {}
+      output_buffer_size_(output_buffer_size),
+      input_buffer_size_(input_buffer_size),
+      async_read_queue_depth_(async_read_queue_depth) {}
 
 absl::Status TFRecordReaderImpl::Initialize(Env* env) {
   TF_RETURN_IF_ERROR(env->NewRandomAccessFile(filename_, &file_));
@@ -756,6 +759,8 @@ absl::Status TFRecordReaderImpl::Initialize(Env* env) {
     options.zlib_options.output_buffer_size = *output_buffer_size_;
   }
 #endif  // IS_SLIM_BUILD
+  options.buffer_size = std::max<int64_t>(input_buffer_size_, 0);
+  options.async_read_queue_depth = std::max(async_read_queue_depth_, 0);
   record_reader_ = std::make_unique<io::RecordReader>(file_.get(), options);
   bytes_read_ = 0;
   return absl::OkStatus();
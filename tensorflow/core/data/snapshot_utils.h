@@ -253,8 +253,13 @@ class TFRecordReaderImpl {
   // tensorflow/compiler/xla/tsl/lib/io/compression.h.
   // `output_buffer_size` specifies the buffer size required by Snappy/Zlib
   // compression algorithms. Ignored if compression is not enabled.
+  // If `input_buffer_size` is positive, the file is read in blocks of this
+  // size. If `async_read_queue_depth` is positive, up to this many block reads
+  // are kept in flight (see `io::RecordReaderOptions`).
   TFRecordReaderImpl(const std::string& filename, const string& compression,
-                     std::optional<int64_t> output_buffer_size = std::nullopt);
+                     std::optional<int64_t> output_buffer_size = std::nullopt,
+                     int64_t input_buffer_size = 0,
+                     int async_read_queue_depth = 0);
 
   // Initializes the reader. Callers must initialize the reader before calling
   // `GetNext` or `GetTensors`.
@@ -281,6 +286,8 @@ class TFRecordReaderImpl {
 
   const string compression_;
   const std::optional<int64_t> output_buffer_size_;
+  const int64_t input_buffer_size_;
+  const int async_read_queue_depth_;
 };
 
 // Reads snapshots previously written with `TFRecordWriter`.
@@ -288,8 +295,10 @@ class TFRecordReader : public Reader {
  public:
   TFRecordReader(const std::string& filename, const string& compression,
                  const DataTypeVector& dtypes,
-                 std::optional<int64_t> output_buffer_size = std::nullopt)
-      : reader_impl_(filename, compression, output_buffer_size),
+                 std::optional<int64_t> output_buffer_size = std::nullopt,
+                 int64_t input_buffer_size = 0, int async_read_queue_depth = 0)
+      : reader_impl_(filename, compression, output_buffer_size,
+                     input_buffer_size, async_read_queue_depth),
         dtypes_(dtypes) {}
 
   // Initializes the reader. Callers must initialize the reader before calling
@@ -23,6 +23,7 @@ limitations under the License.
 
 #include "absl/container/flat_hash_set.h"
 #include "absl/time/time.h"
+#include "tensorflow/core/data/unbounded_thread_pool.h"
 #include "tensorflow/core/framework/dataset.h"
 #include "tensorflow/core/framework/model.h"
 #include "tensorflow/core/platform/env.h"
@@ -97,8 +98,12 @@ absl::Duration ApproximateLatencyEstimator::GetAverageLatency(Duration duration)
 
 TfDatazMetricsCollector::TfDatazMetricsCollector(
     const Env& env, DatasetBaseIterator* iterator,
-    std::shared_ptr<model::Model> model)
-    : iterator_(iterator), model_(std::move(model)), latency_estimator_(env) {}
+    std::shared_ptr<model::Model> model,
+    const UnboundedThreadPool* thread_pool)
+    : iterator_(iterator),
+      thread_pool_(thread_pool),
+      model_(std::move(model)),
+      latency_estimator_(env) {}
 
 void TfDatazMetricsCollector::RecordGetNextLatency(
     int64_t get_next_latency_usec) {
@@ -138,6 +143,13 @@ std::shared_ptr<model::Model> TfDatazMetricsCollector::GetModel() {
   return model_;
 }
 
+int64_t TfDatazMetricsCollector::GetNumaCrossNodeMigrations() {
+  if (thread_pool_ == nullptr) {
+    return 0;
+  }
+  return thread_pool_->num_cross_node_migrations();
+}
+
 namespace {
 static mutex* get_tfdataz_metrics_registry_lock() {
   static mutex tfdataz_metrics_registry_lock(LINKER_INITIALIZED);
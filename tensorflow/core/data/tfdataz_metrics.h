@@ -22,6 +22,7 @@ limitations under the License.
 
 #include "absl/container/flat_hash_set.h"
 #include "absl/time/time.h"
+#include "tensorflow/core/data/unbounded_thread_pool.h"
 #include "tensorflow/core/framework/dataset.h"
 #include "tensorflow/core/framework/model.h"
 #include "tensorflow/core/platform/env.h"
@@ -95,8 +96,11 @@ class TfDatazMetricsCollector {
   // We only collect metrics for CPU devices. This is a heuristic to avoid
   // collecting metrics for device-side iterators created by the multi-device
   // iterator mechanism.
+  // `thread_pool`, if non-null, is the pool that runs the background threads
+  // of `iterator`.
   TfDatazMetricsCollector(const Env& env, DatasetBaseIterator* iterator,
-                          std::shared_ptr<model::Model> model);
+                          std::shared_ptr<model::Model> model,
+                          const UnboundedThreadPool* thread_pool = nullptr);
 
   // Records `GetNext` call latency.
   void RecordGetNextLatency(int64_t get_next_latency_usec);
@@ -120,8 +124,13 @@ class TfDatazMetricsCollector {
 
   std::shared_ptr<model::Model> GetModel();
 
+  // Returns the number of work items of the iterator that ran on a different
+  // NUMA node than the thread that scheduled them.
+  int64_t GetNumaCrossNodeMigrations();
+
  private:
   DatasetBaseIterator* iterator_;  // not owned
+  const UnboundedThreadPool* thread_pool_;  // not owned
   std::shared_ptr<model::Model> model_;
   ApproximateLatencyEstimator latency_estimator_;
 };
@@ -18,7 +18,10 @@ limitations under the License.
 #include <utility>
 
 #include "absl/time/time.h"
+#include "tensorflow/core/data/unbounded_thread_pool.h"
 #include "tensorflow/core/framework/dataset.h"
+#include "tensorflow/core/lib/monitoring/cell_reader.h"
+#include "tensorflow/core/platform/blocking_counter.h"
 #include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/test.h"
 #include "tensorflow/core/util/fake_clock_env.h"
@@ -65,6 +68,32 @@ TEST_F(TfDatazMetricsTest, RecordGetNextLatency) {
                   2.0);
 }
 
+TEST_F(TfDatazMetricsTest, GetNumaCrossNodeMigrations) {
+  monitoring::testing::CellReader<int64_t> exported_migrations(
+      "/tensorflow/data/numa_cross_node_migrations");
+  EXPECT_EQ(tfdataz_metrics_->GetNumaCrossNodeMigrations(), 0);
+
+  // Work scheduled from node 0 runs on the home node 1 unless it requests a
+  // node, so only that work migrates.
+  std::unique_ptr<UnboundedThreadPool> thread_pool =
+      UnboundedThreadPool::CreateNumaAwareForTesting(
+          Env::Default(), "test", /*num_numa_nodes=*/2, /*home_numa_node=*/1,
+          /*get_caller_numa_node=*/[]() { return 0; });
+  TfDatazMetricsCollector collector(*env_, iterator_.get(), /*model=*/nullptr,
+                                    thread_pool.get());
+  BlockingCounter counter(5);
+  for (int i = 0; i < 3; ++i) {
+    thread_pool->Schedule([&counter]() { counter.DecrementCount(); });
+  }
+  thread_pool->ScheduleOnNumaNode(/*numa_node=*/0,
+                                  [&counter]() { counter.DecrementCount(); });
+  thread_pool->ScheduleOnNumaNode(/*numa_node=*/1,
+                                  [&counter]() { counter.DecrementCount(); });
+  counter.Wait();
+  EXPECT_EQ(collector.GetNumaCrossNodeMigrations(), 4);
+  EXPECT_EQ(exported_migrations.Delta(), 4);
+}
+
 TEST_F(TfDatazMetricsTest, GetAverageLatencyForLastOneMinute) {
   tfdataz_metrics_->RecordGetNextLatency(1);
   env_->AdvanceByMicroseconds(k2MinutesInMicros);
@@ -0,0 +1,356 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/data/tiered_shuffle_buffer.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "tensorflow/core/data/serialization_utils.h"
+#include "tensorflow/core/data/snapshot_utils.h"
+#include "tensorflow/core/framework/dataset.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/lib/io/compression.h"
+#include "tensorflow/core/lib/io/path.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/random.h"
+
+namespace tensorflow {
+namespace data {
+namespace {
+
+constexpr char kMemory[] = "memory";
+constexpr char kNumSaves[] = "num_saves";
+constexpr char kNumSegments[] = "num_segments";
+constexpr char kSegment[] = "segment";
+constexpr char kSegmentFilename[] = "segment_filename";
+constexpr char kSegmentNumElements[] = "segment_num_elements";
+constexpr char kSegmentNumConsumed[] = "segment_num_consumed";
+constexpr char kNumRetiredSegments[] = "num_retired_segments";
+constexpr char kRetiredSegmentFilename[] = "retired_segment_filename";
+constexpr char kRetiredSegmentLastSave[] = "retired_segment_last_save";
+
+std::string SegmentKey(absl::string_view key, int64_t index) {
+  return absl::StrCat(key, "_", index);
+}
+
+}  // namespace
+
+TieredShuffleBuffer::TieredShuffleBuffer(Env* env,
+                                         const std::string& spill_directory,
+                                         int64_t memory_budget_bytes,
+                                         const DataTypeVector& dtypes,
+                                         int64_t checkpoints_to_keep)
+    : env_(env),
+      memory_budget_bytes_(memory_budget_bytes > 0 ? memory_budget_bytes
+                                                   : kDefaultMemoryBudgetBytes),
+      dtypes_(dtypes),
+      checkpoints_to_keep_(checkpoints_to_keep > 0 ? checkpoints_to_keep
+                                                   : kDefaultCheckpointsToKeep),
+      segment_directory_(io::JoinPath(
+          spill_directory,
+          absl::StrCat("shuffle_", absl::Hex(random::New64())))) {}
+
+TieredShuffleBuffer::~TieredShuffleBuffer() {
+  for (auto& segment : segments_) {
+    segment->reader.reset();
+    if (segment->last_save < 0) {
+      DeleteFile(segment->filename);
+    }
+  }
+  // Segments that a retained checkpoint references outlive the buffer, in
+  // which case its directory is not empty and is kept as well.
+  env_->DeleteDir(segment_directory_).IgnoreError();
+}
+
+absl::Status TieredShuffleBuffer::Add(std::vector<Tensor> element,
+                                      const RandomFn& random,
+                                      const SpillFn& on_spill) {
+  AddToMemory(std::move(element));
+  if (!NeedsSpill()) {
+    return absl::OkStatus();
+  }
+  PendingSpill spill = TakeSpill(random, on_spill);
+  absl::Status s = WriteSpill(spill);
+  return FinishSpill(std::move(spill), std::move(s));
+}
+
+void TieredShuffleBuffer::AddToMemory(std::vector<Tensor> element) {
+  memory_bytes_ += GetAllocatedBytes(element);
+  memory_.push_back(std::move(element));
+}
+
+absl::Status TieredShuffleBuffer::Remove(const RandomFn& random,
+                                         std::vector<Tensor>* element,
+                                         bool* from_disk) {
+  if (num_available() == 0) {
+    return errors::FailedPrecondition(
+        "Attempted to remove an element from an empty shuffle buffer.");
+  }
+  uint64_t index = random() % static_cast<uint64_t>(num_available());
+  if (index < memory_.size()) {
+    std::swap(memory_[index], memory_.back());
+    *element = std::move(memory_.back());
+    memory_.pop_back();
+    memory_bytes_ -= GetAllocatedBytes(*element);
+    if (from_disk != nullptr) {
+      *from_disk = false;
+    }
+    return absl::OkStatus();
+  }
+  index -= memory_.size();
+  for (auto it = segments_.begin(); it != segments_.end(); ++it) {
+    Segment& segment = **it;
+    if (index >= segment.remaining()) {
+      index -= segment.remaining();
+      continue;
+    }
+    TF_RETURN_IF_ERROR(ReadNext(segment, element));
+    --num_spilled_;
+    if (from_disk != nullptr) {
+      *from_disk = true;
+    }
+    if (segment.remaining() == 0) {
+      std::unique_ptr<Segment> exhausted = std::move(*it);
+      segments_.erase(it);
+      ReleaseSegment(std::move(exhausted));
+    }
+    return absl::OkStatus();
+  }
+  return errors::Internal(
+      "Shuffle buffer segment bookkeeping is inconsistent.");
+}
+
+void TieredShuffleBuffer::Clear() {
+  memory_.clear();
+  memory_bytes_ = 0;
+  for (auto& segment : segments_) {
+    ReleaseSegment(std::move(segment));
+  }
+  segments_.clear();
+  num_spilled_ = 0;
+}
+
+absl::Status TieredShuffleBuffer::Save(IteratorStateWriter* writer,
+                                       absl::string_view key_prefix) {
+  ++num_saves_;
+  TF_RETURN_IF_ERROR(WriteElementsToCheckpoint(
+      writer, absl::StrCat(key_prefix, "::", kMemory), memory_));
+  TF_RETURN_IF_ERROR(writer->WriteScalar(key_prefix, kNumSaves, num_saves_));
+  TF_RETURN_IF_ERROR(
+      writer->WriteScalar(key_prefix, kNumSegments, segments_.size()));
+  for (int64_t i = 0; i < segments_.size(); ++i) {
+    Segment& segment = *segments_[i];
+    TF_RETURN_IF_ERROR(writer->WriteScalar(
+        key_prefix, SegmentKey(kSegmentFilename, i), segment.filename));
+    TF_RETURN_IF_ERROR(writer->WriteScalar(
+        key_prefix, SegmentKey(kSegmentNumElements, i), segment.num_elements));
+    TF_RETURN_IF_ERROR(writer->WriteScalar(
+        key_prefix, SegmentKey(kSegmentNumConsumed, i), segment.num_consumed));
+    segment.last_save = num_saves_;
+  }
+  DeleteRetiredSegments();
+  TF_RETURN_IF_ERROR(writer->WriteScalar(key_prefix, kNumRetiredSegments,
+                                         retired_segments_.size()));
+  int64_t i = 0;
+  for (const auto& [filename, last_save] : retired_segments_) {
+    TF_RETURN_IF_ERROR(writer->WriteScalar(
+        key_prefix, SegmentKey(kRetiredSegmentFilename, i), filename));
+    TF_RETURN_IF_ERROR(writer->WriteScalar(
+        key_prefix, SegmentKey(kRetiredSegmentLastSave, i), last_save));
+    ++i;
+  }
+  return absl::OkStatus();
+}
+
+absl::Status TieredShuffleBuffer::Restore(IteratorContext* ctx,
+                                          IteratorStateReader* reader,
+                                          absl::string_view key_prefix) {
+  Clear();
+  TF_RETURN_IF_ERROR(ReadElementsFromCheckpoint(
+      ctx, reader, absl::StrCat(key_prefix, "::", kMemory), &memory_));
+  for (const auto& element : memory_) {
+    memory_bytes_ += GetAllocatedBytes(element);
+  }
+  int64_t saved_num_saves;
+  TF_RETURN_IF_ERROR(
+      reader->ReadScalar(key_prefix, kNumSaves, &saved_num_saves));
+  int64_t num_segments;
+  TF_RETURN_IF_ERROR(
+      reader->ReadScalar(key_prefix, kNumSegments, &num_segments));
+  for (int64_t i = 0; i < num_segments; ++i) {
+    auto segment = std::make_unique<Segment>();
+    tstring filename;
+    TF_RETURN_IF_ERROR(reader->ReadScalar(
+        key_prefix, SegmentKey(kSegmentFilename, i), &filename));
+    segment->filename = filename;
+    TF_RETURN_IF_ERROR(reader->ReadScalar(
+        key_prefix, SegmentKey(kSegmentNumElements, i),
+        &segment->num_elements));
+    TF_RETURN_IF_ERROR(reader->ReadScalar(
+        key_prefix, SegmentKey(kSegmentNumConsumed, i),
+        &segment->num_consumed));
+    TF_RETURN_IF_ERROR(env_->FileExists(segment->filename));
+    // The restored checkpoint counts as the latest one.
+    segment->last_save = num_saves_;
+    retired_segments_.erase(segment->filename);
+    num_spilled_ += segment->remaining();
+    segments_.push_back(std::move(segment));
+  }
+  // Save numbers in the checkpoint are relative to the buffer that wrote it.
+  int64_t num_retired_segments;
+  TF_RETURN_IF_ERROR(reader->ReadScalar(key_prefix, kNumRetiredSegments,
+                                        &num_retired_segments));
+  for (int64_t i = 0; i < num_retired_segments; ++i) {
+    tstring filename;
+    TF_RETURN_IF_ERROR(reader->ReadScalar(
+        key_prefix, SegmentKey(kRetiredSegmentFilename, i), &filename));
+    int64_t last_save;
+    TF_RETURN_IF_ERROR(reader->ReadScalar(
+        key_prefix, SegmentKey(kRetiredSegmentLastSave, i), &last_save));
+    RetireSegment(filename, num_saves_ - (saved_num_saves - last_save));
+  }
+  return absl::OkStatus();
+}
+
+TieredShuffleBuffer::PendingSpill TieredShuffleBuffer::TakeSpill(
+    const RandomFn& random, const SpillFn& on_spill) {
+  PendingSpill spill;
+  spill.filename = absl::StrCat(io::JoinPath(segment_directory_, kSegment),
+                                "_", next_segment_id_++);
+  const int64_t target_bytes = memory_budget_bytes_ / 2;
+  while (memory_bytes_ > target_bytes && !memory_.empty()) {
+    uint64_t index = random() % memory_.size();
+    std::swap(memory_[index], memory_.back());
+    if (on_spill) {
+      on_spill(memory_.back());
+    }
+    memory_bytes_ -= GetAllocatedBytes(memory_.back());
+    spill.elements.push_back(std::move(memory_.back()));
+    memory_.pop_back();
+  }
+  num_pending_spill_ += spill.elements.size();
+  return spill;
+}
+
+absl::Status TieredShuffleBuffer::WriteSpill(const PendingSpill& spill) const {
+  TF_RETURN_IF_ERROR(env_->RecursivelyCreateDir(segment_directory_));
+  snapshot_util::TFRecordWriter writer(spill.filename, io::compression::kNone);
+  TF_RETURN_IF_ERROR(writer.Initialize(env_));
+  for (const auto& element : spill.elements) {
+    TF_RETURN_IF_ERROR(writer.WriteTensors(element));
+  }
+  return writer.Close();
+}
+
+absl::Status TieredShuffleBuffer::FinishSpill(PendingSpill spill,
+                                              absl::Status write_status) {
+  num_pending_spill_ -= spill.elements.size();
+  if (!write_status.ok()) {
+    if (env_->FileExists(spill.filename).ok()) {
+      DeleteFile(spill.filename);
+    }
+    for (auto& element : spill.elements) {
+      AddToMemory(std::move(element));
+    }
+    return write_status;
+  }
+  auto segment = std::make_unique<Segment>();
+  segment->filename = std::move(spill.filename);
+  segment->num_elements = spill.elements.size();
+  for (const auto& element : spill.elements) {
+    total_bytes_spilled_ += GetAllocatedBytes(element);
+  }
+  VLOG(2) << "Spilled " << segment->num_elements
+          << " shuffle buffer elements to " << segment->filename;
+  num_spilled_ += segment->num_elements;
+  segments_.push_back(std::move(segment));
+  return absl::OkStatus();
+}
+
+absl::Status TieredShuffleBuffer::ReadNext(Segment& segment,
+                                           std::vector<Tensor>* element) {
+  if (!segment.reader) {
+    segment.reader = std::make_unique<snapshot_util::TFRecordReader>(
+        segment.filename, io::compression::kNone, dtypes_);
+    TF_RETURN_IF_ERROR(segment.reader->Initialize(env_));
+    // Skip the elements consumed before the segment was checkpointed.
+    std::vector<Tensor> skipped;
+    for (int64_t i = 0; i < segment.num_consumed; ++i) {
+      TF_RETURN_IF_ERROR(segment.reader->ReadTensors(&skipped));
+    }
+  }
+  TF_RETURN_IF_ERROR(segment.reader->ReadTensors(element));
+  ++segment.num_consumed;
+  return absl::OkStatus();
+}
+
+void TieredShuffleBuffer::ReleaseSegment(std::unique_ptr<Segment> segment) {
+  segment->reader.reset();
+  if (segment->last_save < 0) {
+    DeleteFile(segment->filename);
+    return;
+  }
+  RetireSegment(segment->filename, segment->last_save);
+}
+
+void TieredShuffleBuffer::RetireSegment(const std::string& filename,
+                                        int64_t last_save) {
+  for (const auto& segment : segments_) {
+    if (segment && segment->filename == filename) {
+      // Still readable by this buffer, so it is released later.
+      return;
+    }
+  }
+  auto [it, inserted] = retired_segments_.try_emplace(filename, last_save);
+  if (!inserted) {
+    it->second = std::max(it->second, last_save);
+  }
+}
+
+void TieredShuffleBuffer::DeleteRetiredSegments() {
+  for (auto it = retired_segments_.begin(); it != retired_segments_.end();) {
+    if (it->second > num_saves_ - checkpoints_to_keep_) {
+      ++it;
+      continue;
+    }
+    DeleteFile(it->first);
+    // Removes the directory of a restored segment once it is empty.
+    const absl::string_view directory = io::Dirname(it->first);
+    if (directory != segment_directory_) {
+      env_->DeleteDir(std::string(directory)).IgnoreError();
+    }
+    retired_segments_.erase(it++);
+  }
+}
+
+void TieredShuffleBuffer::DeleteFile(const std::string& filename) {
+  absl::Status s = env_->DeleteFile(filename);
+  if (!s.ok()) {
+    LOG(WARNING) << "Failed to delete shuffle buffer segment " << filename
+                 << ": " << s;
+  }
+}
+
+}  // namespace data
+}  // namespace tensorflow
@@ -0,0 +1,219 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_DATA_TIERED_SHUFFLE_BUFFER_H_
+#define TENSORFLOW_CORE_DATA_TIERED_SHUFFLE_BUFFER_H_
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/status.h"
+#include "absl/strings/string_view.h"
+#include "tensorflow/core/data/snapshot_utils.h"
+#include "tensorflow/core/framework/dataset.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/platform/env.h"
+
+namespace tensorflow {
+namespace data {
+
+// A shuffle buffer that keeps a memory-budgeted window of elements in RAM and
+// spills the rest to local-disk segment files.
+//
+// Elements are spilled in a uniformly random order, so reading a segment
+// sequentially is equivalent to sampling uniformly from it. `Remove` picks
+// a position uniformly across all buffered elements (in memory and on disk)
+// and returns either the in-memory element at that position or the next
+// element of the segment the position falls into.
+//
+// Segment files use the `snapshot_util::TFRecordWriter` encoding and are
+// written to a subdirectory of `spill_directory` that belongs to one buffer.
+// They are never modified once written. Checkpoints store the in-memory window
+// plus the name, size and read offset of each segment, so saving does not
+// re-serialize spilled elements, and restoring reads the segments in place.
+//
+// A segment that no checkpoint references is deleted as soon as it is
+// exhausted, dropped, or the buffer is destroyed. A segment that a checkpoint
+// references is kept until none of the last `checkpoints_to_keep` saves
+// references it, and outlives the buffer until then. Checkpoints also record
+// these retired segments, so a restored buffer deletes them in turn.
+//
+// This class is thread-compatible, except that `WriteSpill` may run
+// concurrently with any other method.
+class TieredShuffleBuffer {
+ public:
+  // Returns a uniformly distributed random number.
+  using RandomFn = std::function<uint64_t()>;
+  // Invoked with each element moved from memory to disk.
+  using SpillFn = std::function<void(const std::vector<Tensor>&)>;
+
+  // The in-memory budget used when the caller does not specify one.
+  static constexpr int64_t kDefaultMemoryBudgetBytes = 1LL << 30;  // 1 GiB
+
+  // The number of retained checkpoints used when the caller does not specify
+  // one. Matches the default `max_to_keep` of `tf.train.CheckpointManager`.
+  static constexpr int64_t kDefaultCheckpointsToKeep = 5;
+
+  // Elements moved out of the in-memory window that still have to be written
+  // to a new segment file.
+  struct PendingSpill {
+    std::string filename;
+    std::vector<std::vector<Tensor>> elements;
+  };
+
+  // `checkpoints_to_keep` is the number of most recent saves whose segments
+  // must stay restorable. If not positive, `kDefaultCheckpointsToKeep` is used.
+  TieredShuffleBuffer(Env* env, const std::string& spill_directory,
+                      int64_t memory_budget_bytes, const DataTypeVector& dtypes,
+                      int64_t checkpoints_to_keep = kDefaultCheckpointsToKeep);
+  ~TieredShuffleBuffer();
+
+  TieredShuffleBuffer(const TieredShuffleBuffer&) = delete;
+  TieredShuffleBuffer& operator=(const TieredShuffleBuffer&) = delete;
+
+  // Adds `element` to the buffer, spilling to disk if the in-memory window
+  // exceeds its budget. If set, `on_spill` is invoked for every element that
+  // is moved out of memory.
+  absl::Status Add(std::vector<Tensor> element, const RandomFn& random,
+                   const SpillFn& on_spill = nullptr);
+
+  // Adds `element` to the in-memory window without spilling. Callers that
+  // must not block on disk writes use this together with `TakeSpill`,
+  // `WriteSpill` and `FinishSpill` instead of `Add`.
+  void AddToMemory(std::vector<Tensor> element);
+
+  // Returns whether the in-memory window exceeds its budget.
+  bool NeedsSpill() const { return memory_bytes_ > memory_budget_bytes_; }
+
+  // Moves randomly chosen in-memory elements out of the buffer until the
+  // in-memory window is at most half of its budget. The elements are not
+  // available to `Remove` until the spill is finished. If set, `on_spill` is
+  // invoked for every element that is moved out of memory.
+  PendingSpill TakeSpill(const RandomFn& random,
+                         const SpillFn& on_spill = nullptr);
+
+  // Writes the segment file of `spill`. Does not access the buffer state, so
+  // it may run concurrently with any other method.
+  absl::Status WriteSpill(const PendingSpill& spill) const;
+
+  // Completes a spill taken by `TakeSpill`. If `write_status` is OK, the
+  // segment becomes available to `Remove`; otherwise, the elements are
+  // returned to the in-memory window and `write_status` is returned.
+  absl::Status FinishSpill(PendingSpill spill, absl::Status write_status);
+
+  // Removes a uniformly random element from the buffer. Requires
+  // `num_available() > 0`.
+  // If `from_disk` is non-null, it is set to whether the element was read
+  // from a segment file.
+  absl::Status Remove(const RandomFn& random, std::vector<Tensor>* element,
+                      bool* from_disk = nullptr);
+
+  // Drops all buffered elements and releases their segments. Requires that no
+  // spill is pending.
+  void Clear();
+
+  // Saves the in-memory window and references to the segment files under
+  // `key_prefix`. Requires that no spill is pending.
+  absl::Status Save(IteratorStateWriter* writer, absl::string_view key_prefix);
+
+  // Restores the buffer state previously saved under `key_prefix`, replacing
+  // the current contents. Requires that no spill is pending.
+  absl::Status Restore(IteratorContext* ctx, IteratorStateReader* reader,
+                       absl::string_view key_prefix);
+
+  // Returns the total number of buffered elements, including the elements of
+  // pending spills.
+  int64_t size() const { return num_available() + num_pending_spill_; }
+
+  // Returns the number of buffered elements `Remove` can choose from.
+  int64_t num_available() const {
+    return static_cast<int64_t>(memory_.size()) + num_spilled_;
+  }
+
+  // Returns the number of buffered elements held in memory.
+  int64_t num_in_memory() const { return memory_.size(); }
+
+  // Returns the number of buffered elements held on disk.
+  int64_t num_spilled() const { return num_spilled_; }
+
+  // Returns the bytes of the elements held in memory.
+  int64_t memory_bytes() const { return memory_bytes_; }
+
+  // Returns the total number of bytes written to segment files so far.
+  int64_t total_bytes_spilled() const { return total_bytes_spilled_; }
+
+ private:
+  struct Segment {
+    std::string filename;
+    int64_t num_elements = 0;
+    int64_t num_consumed = 0;
+    // The last save that referenced the segment, or -1 if none did.
+    int64_t last_save = -1;
+    // Opened lazily on first read.
+    std::unique_ptr<snapshot_util::TFRecordReader> reader;
+
+    int64_t remaining() const { return num_elements - num_consumed; }
+  };
+
+  // Reads the next element of `segment`, opening it and skipping the elements
+  // consumed before it was checkpointed first if necessary.
+  absl::Status ReadNext(Segment& segment, std::vector<Tensor>* element);
+
+  // Releases an exhausted or dropped segment: deletes it if no checkpoint
+  // references it, and retires it otherwise.
+  void ReleaseSegment(std::unique_ptr<Segment> segment);
+
+  // Retires `filename`, last referenced by save `last_save`.
+  void RetireSegment(const std::string& filename, int64_t last_save);
+
+  // Deletes the retired segments that no retained checkpoint references.
+  void DeleteRetiredSegments();
+
+  void DeleteFile(const std::string& filename);
+
+  Env* const env_;
+  const int64_t memory_budget_bytes_;
+  const DataTypeVector dtypes_;
+  const int64_t checkpoints_to_keep_;
+  // The subdirectory of the spill directory holding the segment files written
+  // by this buffer. Restored segments may live in the directory of another
+  // buffer.
+  const std::string segment_directory_;
+
+  std::vector<std::vector<Tensor>> memory_;
+  int64_t memory_bytes_ = 0;
+  // Segments with at least one unread element.
+  std::vector<std::unique_ptr<Segment>> segments_;
+  int64_t num_spilled_ = 0;
+  // Number of elements taken by `TakeSpill` but not yet finished.
+  int64_t num_pending_spill_ = 0;
+  int64_t next_segment_id_ = 0;
+  int64_t total_bytes_spilled_ = 0;
+  // Number of calls to `Save`.
+  int64_t num_saves_ = 0;
+  // Released segments that a retained checkpoint references, keyed by file
+  // name, with the last save that referenced them.
+  absl::flat_hash_map<std::string, int64_t> retired_segments_;
+};
+
+}  // namespace data
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_DATA_TIERED_SHUFFLE_BUFFER_H_
@@ -0,0 +1,339 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/data/tiered_shuffle_buffer.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_set.h"
+#include "absl/status/status.h"
+#include "tensorflow/core/data/dataset_test_base.h"
+#include "tensorflow/core/data/serialization_utils.h"
+#include "tensorflow/core/data/test_utils.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/random/philox_random.h"
+#include "tensorflow/core/lib/random/random_distributions.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/path.h"
+#include "tensorflow/core/platform/test.h"
+#include "tsl/platform/statusor.h"
+
+namespace tensorflow {
+namespace data {
+namespace {
+
+constexpr char kPrefix[] = "Iterator::TieredShuffle";
+
+class TieredShuffleBufferTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    directory_ = io::JoinPath(::tensorflow::testing::TmpDir(),
+                              "tiered_shuffle_buffer");
+    parent_generator_ = random::PhiloxRandom(42, 42);
+    generator_ = std::make_unique<
+        random::SingleSampleAdapter<random::PhiloxRandom>>(&parent_generator_);
+    random_ = [this]() { return (*generator_)(); };
+  }
+
+  void TearDown() override {
+    int64_t undeleted_files, undeleted_dirs;
+    Env::Default()
+        ->DeleteRecursively(directory_, &undeleted_files, &undeleted_dirs)
+        .IgnoreError();
+  }
+
+  int64_t NumSegmentFiles() {
+    std::vector<std::string> filenames;
+    if (!Env::Default()
+             ->GetMatchingPaths(io::JoinPath(directory_, "*", "*"), &filenames)
+             .ok()) {
+      return 0;
+    }
+    return filenames.size();
+  }
+
+  int64_t NumSegmentDirectories() {
+    std::vector<std::string> children;
+    if (!Env::Default()->GetChildren(directory_, &children).ok()) {
+      return 0;
+    }
+    return children.size();
+  }
+
+  std::string directory_;
+  random::PhiloxRandom parent_generator_;
+  std::unique_ptr<random::SingleSampleAdapter<random::PhiloxRandom>>
+      generator_;
+  TieredShuffleBuffer::RandomFn random_;
+};
+
+std::vector<Tensor> MakeElement(int64_t value) {
+  return CreateTensors<int64_t>(TensorShape({16}),
+                                {std::vector<int64_t>(16, value)});
+}
+
+TEST_F(TieredShuffleBufferTest, ReturnsEveryElementOnce) {
+  // Each element is 128 bytes, so a 1KiB budget forces frequent spilling.
+  TieredShuffleBuffer buffer(Env::Default(), directory_,
+                             /*memory_budget_bytes=*/1024, {DT_INT64});
+  constexpr int64_t kNumElements = 1000;
+  for (int64_t i = 0; i < kNumElements; ++i) {
+    TF_ASSERT_OK(buffer.Add(MakeElement(i), random_));
+    EXPECT_LE(buffer.memory_bytes(), 1024);
+  }
+  EXPECT_EQ(buffer.size(), kNumElements);
+  EXPECT_GT(buffer.num_spilled(), 0);
+  EXPECT_GT(NumSegmentFiles(), 0);
+
+  absl::flat_hash_set<int64_t> seen;
+  std::vector<int64_t> order;
+  while (buffer.size() > 0) {
+    std::vector<Tensor> element;
+    TF_ASSERT_OK(buffer.Remove(random_, &element));
+    ASSERT_EQ(element.size(), 1);
+    int64_t value = element[0].flat<int64_t>()(0);
+    EXPECT_TRUE(seen.insert(value).second) << "Duplicate element " << value;
+    order.push_back(value);
+  }
+  EXPECT_EQ(seen.size(), kNumElements);
+  EXPECT_FALSE(std::is_sorted(order.begin(), order.end()));
+  // Exhausted segments are deleted eagerly.
+  EXPECT_EQ(NumSegmentFiles(), 0);
+}
+
+TEST_F(TieredShuffleBufferTest, SaveAndRestore) {
+  auto buffer = std::make_unique<TieredShuffleBuffer>(
+      Env::Default(), directory_, /*memory_budget_bytes=*/1024,
+      DataTypeVector{DT_INT64});
+  constexpr int64_t kNumElements = 200;
+  for (int64_t i = 0; i < kNumElements; ++i) {
+    TF_ASSERT_OK(buffer->Add(MakeElement(i), random_));
+  }
+  absl::flat_hash_set<int64_t> seen;
+  for (int64_t i = 0; i < kNumElements / 2; ++i) {
+    std::vector<Tensor> element;
+    TF_ASSERT_OK(buffer->Remove(random_, &element));
+    seen.insert(element[0].flat<int64_t>()(0));
+  }
+
+  VariantTensorDataWriter writer;
+  TF_ASSERT_OK(buffer->Save(&writer, kPrefix));
+  const int64_t num_remaining = buffer->size();
+  const int64_t num_in_memory = buffer->num_in_memory();
+  // Segments referenced by the checkpoint outlive the buffer.
+  const int64_t num_segment_files = NumSegmentFiles();
+  EXPECT_GT(num_segment_files, 0);
+  buffer.reset();
+  EXPECT_EQ(NumSegmentFiles(), num_segment_files);
+
+  std::vector<const VariantTensorData*> data;
+  writer.GetData(&data);
+  // Only the elements of the in-memory window are serialized into the
+  // checkpoint.
+  int64_t num_checkpointed_elements = 0;
+  for (const VariantTensorData* d : data) {
+    for (const Tensor& t : d->tensors()) {
+      if (t.NumElements() == 16) {
+        ++num_checkpointed_elements;
+      }
+    }
+  }
+  EXPECT_EQ(num_checkpointed_elements, num_in_memory);
+  EXPECT_LT(num_in_memory, num_remaining);
+
+  VariantTensorDataReader reader(data);
+  TF_ASSERT_OK_AND_ASSIGN(std::unique_ptr<TestContext> ctx,
+                          TestContext::Create());
+  TieredShuffleBuffer restored(Env::Default(), directory_,
+                               /*memory_budget_bytes=*/1024, {DT_INT64});
+  TF_ASSERT_OK(restored.Restore(ctx->iter_ctx(), &reader, kPrefix));
+  EXPECT_EQ(restored.size(), num_remaining);
+  EXPECT_GT(restored.num_spilled(), 0);
+  // The segments are read in place rather than rewritten.
+  EXPECT_EQ(NumSegmentFiles(), num_segment_files);
+  while (restored.size() > 0) {
+    std::vector<Tensor> element;
+    TF_ASSERT_OK(restored.Remove(random_, &element));
+    int64_t value = element[0].flat<int64_t>()(0);
+    EXPECT_TRUE(seen.insert(value).second) << "Duplicate element " << value;
+  }
+  EXPECT_EQ(seen.size(), kNumElements);
+}
+
+TEST_F(TieredShuffleBufferTest, OlderCheckpointOutlivesNewerOnes) {
+  TieredShuffleBuffer buffer(Env::Default(), directory_,
+                             /*memory_budget_bytes=*/1024, {DT_INT64});
+  constexpr int64_t kNumElements = 200;
+  for (int64_t i = 0; i < kNumElements; ++i) {
+    TF_ASSERT_OK(buffer.Add(MakeElement(i), random_));
+  }
+  VariantTensorDataWriter first_writer;
+  TF_ASSERT_OK(buffer.Save(&first_writer, kPrefix));
+  std::vector<const VariantTensorData*> first_data;
+  first_writer.GetData(&first_data);
+  TF_ASSERT_OK_AND_ASSIGN(std::unique_ptr<TestContext> ctx,
+                          TestContext::Create());
+
+  // Restoring, draining and saving again must not delete the segments the
+  // first checkpoint references.
+  VariantTensorDataReader first_reader(first_data);
+  TF_ASSERT_OK(buffer.Restore(ctx->iter_ctx(), &first_reader, kPrefix));
+  while (buffer.size() > 0) {
+    std::vector<Tensor> element;
+    TF_ASSERT_OK(buffer.Remove(random_, &element));
+  }
+  VariantTensorDataWriter second_writer;
+  TF_ASSERT_OK(buffer.Save(&second_writer, kPrefix));
+
+  VariantTensorDataReader reader(first_data);
+  TF_ASSERT_OK(buffer.Restore(ctx->iter_ctx(), &reader, kPrefix));
+  absl::flat_hash_set<int64_t> seen;
+  while (buffer.size() > 0) {
+    std::vector<Tensor> element;
+    TF_ASSERT_OK(buffer.Remove(random_, &element));
+    seen.insert(element[0].flat<int64_t>()(0));
+  }
+  EXPECT_EQ(seen.size(), kNumElements);
+}
+
+TEST_F(TieredShuffleBufferTest, DeletesSegmentsOfOldCheckpoints) {
+  TieredShuffleBuffer buffer(Env::Default(), directory_,
+                             /*memory_budget_bytes=*/1024, {DT_INT64},
+                             /*checkpoints_to_keep=*/3);
+  for (int64_t i = 0; i < 200; ++i) {
+    TF_ASSERT_OK(buffer.Add(MakeElement(i), random_));
+  }
+  VariantTensorDataWriter writer;
+  TF_ASSERT_OK(buffer.Save(&writer, kPrefix));
+  while (buffer.size() > 0) {
+    std::vector<Tensor> element;
+    TF_ASSERT_OK(buffer.Remove(random_, &element));
+  }
+  const int64_t num_segment_files = NumSegmentFiles();
+  EXPECT_GT(num_segment_files, 0);
+
+  // The drained segments are kept while a retained checkpoint references
+  // them.
+  for (int64_t i = 1; i < 3; ++i) {
+    VariantTensorDataWriter newer_writer;
+    TF_ASSERT_OK(buffer.Save(&newer_writer, kPrefix));
+    EXPECT_EQ(NumSegmentFiles(), num_segment_files);
+  }
+  VariantTensorDataWriter newest_writer;
+  TF_ASSERT_OK(buffer.Save(&newest_writer, kPrefix));
+  EXPECT_EQ(NumSegmentFiles(), 0);
+}
+
+TEST_F(TieredShuffleBufferTest, RestoredBufferDeletesRetiredSegments) {
+  TF_ASSERT_OK_AND_ASSIGN(std::unique_ptr<TestContext> ctx,
+                          TestContext::Create());
+  std::vector<const VariantTensorData*> data;
+  VariantTensorDataWriter writer;
+  {
+    TieredShuffleBuffer buffer(Env::Default(), directory_,
+                               /*memory_budget_bytes=*/1024, {DT_INT64},
+                               /*checkpoints_to_keep=*/2);
+    for (int64_t i = 0; i < 200; ++i) {
+      TF_ASSERT_OK(buffer.Add(MakeElement(i), random_));
+    }
+    // Drains some segments, which the first checkpoint still references.
+    VariantTensorDataWriter first_writer;
+    TF_ASSERT_OK(buffer.Save(&first_writer, kPrefix));
+    for (int64_t i = 0; i < 150; ++i) {
+      std::vector<Tensor> element;
+      TF_ASSERT_OK(buffer.Remove(random_, &element));
+    }
+    TF_ASSERT_OK(buffer.Save(&writer, kPrefix));
+    writer.GetData(&data);
+  }
+  EXPECT_EQ(NumSegmentDirectories(), 1);
+
+  // The restored buffer inherits both the live and the retired segments, and
+  // deletes all of them, and their directory, once no retained checkpoint
+  // references them.
+  TieredShuffleBuffer restored(Env::Default(), directory_,
+                               /*memory_budget_bytes=*/1024, {DT_INT64},
+                               /*checkpoints_to_keep=*/2);
+  VariantTensorDataReader reader(data);
+  TF_ASSERT_OK(restored.Restore(ctx->iter_ctx(), &reader, kPrefix));
+  while (restored.size() > 0) {
+    std::vector<Tensor> element;
+    TF_ASSERT_OK(restored.Remove(random_, &element));
+  }
+  for (int64_t i = 0; i < 2; ++i) {
+    EXPECT_GT(NumSegmentFiles(), 0);
+    VariantTensorDataWriter newer_writer;
+    TF_ASSERT_OK(restored.Save(&newer_writer, kPrefix));
+  }
+  EXPECT_EQ(NumSegmentFiles(), 0);
+  EXPECT_EQ(NumSegmentDirectories(), 0);
+}
+
+TEST_F(TieredShuffleBufferTest, PendingSpill) {
+  TieredShuffleBuffer buffer(Env::Default(), directory_,
+                             /*memory_budget_bytes=*/1024, {DT_INT64});
+  int64_t next_value = 0;
+  while (!buffer.NeedsSpill()) {
+    buffer.AddToMemory(MakeElement(next_value++));
+  }
+  TieredShuffleBuffer::PendingSpill spill = buffer.TakeSpill(random_);
+  EXPECT_LE(buffer.memory_bytes(), 512);
+  EXPECT_EQ(buffer.size(), next_value);
+  const int64_t num_pending = spill.elements.size();
+  EXPECT_EQ(buffer.num_available() + num_pending, next_value);
+  EXPECT_EQ(buffer.num_spilled(), 0);
+
+  // A failed write returns the elements to memory.
+  EXPECT_FALSE(
+      buffer.FinishSpill(spill, absl::InternalError("write failed")).ok());
+  EXPECT_EQ(buffer.num_in_memory(), next_value);
+
+  spill = buffer.TakeSpill(random_);
+  TF_ASSERT_OK(buffer.WriteSpill(spill));
+  const int64_t num_spilled = spill.elements.size();
+  TF_ASSERT_OK(buffer.FinishSpill(std::move(spill), absl::OkStatus()));
+  EXPECT_EQ(buffer.num_spilled(), num_spilled);
+  EXPECT_EQ(buffer.num_available(), next_value);
+  EXPECT_EQ(NumSegmentFiles(), 1);
+}
+
+TEST_F(TieredShuffleBufferTest, DeletesUncheckpointedSegmentsOnDestruction) {
+  {
+    TieredShuffleBuffer buffer(Env::Default(), directory_,
+                               /*memory_budget_bytes=*/1024, {DT_INT64});
+    for (int64_t i = 0; i < 100; ++i) {
+      TF_ASSERT_OK(buffer.Add(MakeElement(i), random_));
+    }
+    EXPECT_EQ(NumSegmentDirectories(), 1);
+    EXPECT_GT(NumSegmentFiles(), 0);
+  }
+  EXPECT_EQ(NumSegmentDirectories(), 0);
+}
+
+TEST_F(TieredShuffleBufferTest, RemoveFromEmptyBuffer) {
+  TieredShuffleBuffer buffer(Env::Default(), directory_,
+                             /*memory_budget_bytes=*/1024, {DT_INT64});
+  std::vector<Tensor> element;
+  EXPECT_FALSE(buffer.Remove(random_, &element).ok());
+}
+
+}  // namespace
+}  // namespace data
+}  // namespace tensorflow
@@ -21,9 +21,13 @@ limitations under the License.
 
 #include "absl/memory/memory.h"
 #include "tensorflow/core/framework/dataset.h"
+#include "tensorflow/core/framework/metrics.h"
 #include "tensorflow/core/lib/core/notification.h"
 #include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/numa.h"
 #include "tensorflow/core/platform/resource.h"
+#include "tensorflow/core/platform/strcat.h"
 #include "tensorflow/core/platform/unbounded_work_queue.h"
 
 namespace tensorflow {
@@ -69,6 +73,59 @@ class UnboundedThreadPool::LogicalThreadFactory : public ThreadFactory {
   UnboundedThreadPool* const pool_;  // Not owned.
 };
 
+UnboundedThreadPool::UnboundedThreadPool(Env* env, const string& thread_name)
+    : UnboundedThreadPool(env, thread_name, ThreadOptions()) {}
+
+UnboundedThreadPool::UnboundedThreadPool(Env* env, const string& thread_name,
+                                         const ThreadOptions& thread_options)
+    : numa_aware_(false),
+      home_numa_node_(port::kNUMANoAffinity),
+      get_caller_numa_node_(port::NUMAGetThreadNodeAffinity) {
+  work_queues_.push_back(
+      std::make_unique<UnboundedWorkQueue>(env, thread_name, thread_options));
+}
+
+UnboundedThreadPool::UnboundedThreadPool(Env* env, const string& thread_name,
+                                         int num_numa_nodes,
+                                         int home_numa_node,
+                                         std::function<int()>
+                                             get_caller_numa_node)
+    : numa_aware_(true),
+      home_numa_node_(home_numa_node),
+      get_caller_numa_node_(std::move(get_caller_numa_node)) {
+  for (int node = 0; node < num_numa_nodes; ++node) {
+    ThreadOptions thread_options;
+    thread_options.numa_node = node;
+    work_queues_.push_back(std::make_unique<UnboundedWorkQueue>(
+        env, strings::StrCat(thread_name, "_numa", node), thread_options));
+  }
+}
+
+std::unique_ptr<UnboundedThreadPool> UnboundedThreadPool::CreateNumaAware(
+    Env* env, const string& thread_name, int home_numa_node) {
+  const int num_numa_nodes = port::NUMAEnabled() ? port::NUMANumNodes() : 1;
+  if (num_numa_nodes <= 1) {
+    return std::make_unique<UnboundedThreadPool>(env, thread_name);
+  }
+  if (home_numa_node >= num_numa_nodes) {
+    LOG(WARNING) << "NUMA node " << home_numa_node << " does not exist; "
+                 << "scheduling tf.data work on the NUMA node of the caller.";
+    home_numa_node = port::kNUMANoAffinity;
+  }
+  return absl::WrapUnique(
+      new UnboundedThreadPool(env, thread_name, num_numa_nodes,
+                              home_numa_node, port::NUMAGetThreadNodeAffinity));
+}
+
+std::unique_ptr<UnboundedThreadPool>
+UnboundedThreadPool::CreateNumaAwareForTesting(
+    Env* env, const string& thread_name, int num_numa_nodes,
+    int home_numa_node, std::function<int()> get_caller_numa_node) {
+  return absl::WrapUnique(
+      new UnboundedThreadPool(env, thread_name, num_numa_nodes, home_numa_node,
+                              std::move(get_caller_numa_node)));
+}
+
 std::shared_ptr<ThreadFactory> UnboundedThreadPool::get_thread_factory() {
   return std::make_shared<LogicalThreadFactory>(this);
 }
@@ -81,6 +138,15 @@ void UnboundedThreadPool::Schedule(std::function<void()> fn) {
   ScheduleOnWorkQueue(std::move(tagged_fn), /*done=*/nullptr);
 }
 
+void UnboundedThreadPool::ScheduleOnNumaNode(int numa_node,
+                                             std::function<void()> fn) {
+  auto tagged_fn = [fn = std::move(fn)]() {
+    tensorflow::ResourceTagger tag(kTFDataResourceTag, "ThreadPool");
+    fn();
+  };
+  ScheduleOnWorkQueue(std::move(tagged_fn), /*done=*/nullptr, numa_node);
+}
+
 int UnboundedThreadPool::NumThreads() const { return -1; }
 
 int UnboundedThreadPool::CurrentThreadId() const { return -1; }
@@ -95,9 +161,39 @@ void WorkQueueFunc(const std::function<void()>& fn,
 }
 }  // namespace
 
+int UnboundedThreadPool::SelectNumaNode(int requested_numa_node) {
+  if (!numa_aware_) {
+    return port::kNUMANoAffinity;
+  }
+  const int num_numa_nodes = work_queues_.size();
+  const int caller_numa_node = get_caller_numa_node_();
+  int numa_node = requested_numa_node;
+  if (numa_node < 0 || numa_node >= num_numa_nodes) {
+    numa_node = home_numa_node_;
+  }
+  if (numa_node < 0 || numa_node >= num_numa_nodes) {
+    numa_node = caller_numa_node;
+  }
+  if (numa_node < 0 || numa_node >= num_numa_nodes) {
+    return next_numa_node_.fetch_add(1, std::memory_order_relaxed) %
+           num_numa_nodes;
+  }
+  if (caller_numa_node != port::kNUMANoAffinity &&
+      caller_numa_node != numa_node) {
+    num_cross_node_migrations_.fetch_add(1, std::memory_order_relaxed);
+    metrics::RecordTFDataNumaCrossNodeMigration();
+  }
+  return numa_node;
+}
+
 void UnboundedThreadPool::ScheduleOnWorkQueue(
-    std::function<void()> fn, std::shared_ptr<Notification> done) {
-  unbounded_work_queue_.Schedule(
+    std::function<void()> fn, std::shared_ptr<Notification> done,
+    int numa_node) {
+  numa_node = SelectNumaNode(numa_node);
+  UnboundedWorkQueue& work_queue =
+      numa_node == port::kNUMANoAffinity ? *work_queues_[0]
+                                         : *work_queues_[numa_node];
+  work_queue.Schedule(
       std::bind(&WorkQueueFunc, std::move(fn), std::move(done)));
 }
 
@@ -15,6 +15,8 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_DATA_UNBOUNDED_THREAD_POOL_H_
 #define TENSORFLOW_CORE_DATA_UNBOUNDED_THREAD_POOL_H_
 
+#include <atomic>
+#include <cstdint>
 #include <deque>
 #include <functional>
 #include <memory>
@@ -24,6 +26,7 @@ limitations under the License.
 #include "tensorflow/core/lib/core/notification.h"
 #include "tensorflow/core/lib/core/threadpool_interface.h"
 #include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/numa.h"
 #include "tensorflow/core/platform/unbounded_work_queue.h"
 
 namespace tensorflow {
@@ -33,15 +36,33 @@ namespace data {
 // potentially large number of "logical" threads onto a smaller number of
 // "physical" threads. The multiplexing is achieved by using an
 // `UnboundedWorkQueue`.
+//
+// A NUMA-aware pool (see `CreateNumaAware()`) uses one `UnboundedWorkQueue`
+// per NUMA node, whose physical threads are pinned to that node.
 class UnboundedThreadPool : public thread::ThreadPoolInterface {
  public:
-  UnboundedThreadPool(Env* env, const string& thread_name)
-      : unbounded_work_queue_(env, thread_name) {}
+  UnboundedThreadPool(Env* env, const string& thread_name);
   UnboundedThreadPool(Env* env, const string& thread_name,
-                      const ThreadOptions& thread_options)
-      : unbounded_work_queue_(env, thread_name, thread_options) {}
+                      const ThreadOptions& thread_options);
   ~UnboundedThreadPool() override = default;
 
+  // Returns a pool partitioned into one work queue per NUMA node. Work runs on
+  // `home_numa_node` if it is a valid node, and otherwise on the node of the
+  // thread that schedules it, so that it stays near the memory that thread
+  // allocated. Work scheduled by threads without NUMA affinity is spread over
+  // all nodes in round-robin order. If NUMA is not supported, the returned
+  // pool has no affinity.
+  static std::unique_ptr<UnboundedThreadPool> CreateNumaAware(
+      Env* env, const string& thread_name,
+      int home_numa_node = port::kNUMANoAffinity);
+
+  // Like `CreateNumaAware()`, but always partitions the pool into
+  // `num_numa_nodes` work queues, and uses `get_caller_numa_node` to determine
+  // the NUMA node of the thread that schedules work. For testing.
+  static std::unique_ptr<UnboundedThreadPool> CreateNumaAwareForTesting(
+      Env* env, const string& thread_name, int num_numa_nodes,
+      int home_numa_node, std::function<int()> get_caller_numa_node);
+
   // Returns an implementation of `ThreadFactory` that can be used to create
   // logical threads in this pool.
   std::shared_ptr<ThreadFactory> get_thread_factory();
@@ -50,14 +71,46 @@ class UnboundedThreadPool : public thread::ThreadPoolInterface {
   int NumThreads() const override;
   int CurrentThreadId() const override;
 
+  // Schedules `fn` on the physical threads pinned to `numa_node`. Behaves like
+  // `Schedule()` if the pool is not NUMA-aware or `numa_node` is not a valid
+  // node.
+  void ScheduleOnNumaNode(int numa_node, std::function<void()> fn);
+
+  // Returns the number of NUMA nodes the pool is partitioned into, or 1 if the
+  // pool is not NUMA-aware.
+  int NumNumaNodes() const { return work_queues_.size(); }
+
+  // Returns the number of work items that were scheduled by a thread pinned to
+  // one NUMA node and ran on another.
+  int64_t num_cross_node_migrations() const {
+    return num_cross_node_migrations_.load(std::memory_order_relaxed);
+  }
+
  private:
   class LogicalThreadFactory;
   class LogicalThreadWrapper;
 
+  UnboundedThreadPool(Env* env, const string& thread_name, int num_numa_nodes,
+                      int home_numa_node,
+                      std::function<int()> get_caller_numa_node);
+
+  // Returns the NUMA node to run work scheduled by the current thread on, or
+  // `port::kNUMANoAffinity` if the pool is not NUMA-aware.
+  int SelectNumaNode(int requested_numa_node);
+
   void ScheduleOnWorkQueue(std::function<void()> fn,
-                           std::shared_ptr<Notification> done);
+                           std::shared_ptr<Notification> done,
+                           int numa_node = port::kNUMANoAffinity);
 
-  UnboundedWorkQueue unbounded_work_queue_;
+  const bool numa_aware_;
+  const int home_numa_node_;
+  // Returns the NUMA node of the current thread.
+  const std::function<int()> get_caller_numa_node_;
+  std::atomic<uint64_t> next_numa_node_{0};
+  std::atomic<int64_t> num_cross_node_migrations_{0};
+  // Indexed by NUMA node if the pool is NUMA-aware. Declared last so that the
+  // queues are drained before the counters above are destroyed.
+  std::vector<std::unique_ptr<UnboundedWorkQueue>> work_queues_;
 };
 
 }  // namespace data
@@ -21,6 +21,7 @@ limitations under the License.
 
 #include "tensorflow/core/lib/random/random.h"
 #include "tensorflow/core/platform/blocking_counter.h"
+#include "tensorflow/core/platform/notification.h"
 #include "tensorflow/core/platform/test.h"
 
 namespace tensorflow {
@@ -83,6 +84,38 @@ TEST(UnboundedThreadPool, MultipleBlockingThreads) {
   }
 }
 
+TEST(UnboundedThreadPool, NumaAwarePoolRunsAllWork) {
+  std::unique_ptr<UnboundedThreadPool> pool =
+      UnboundedThreadPool::CreateNumaAware(Env::Default(), "test");
+  ASSERT_GE(pool->NumNumaNodes(), 1);
+  auto thread_factory = pool->get_thread_factory();
+
+  const int kNumWorkItems = 100;
+  BlockingCounter bc(3 * kNumWorkItems);
+  std::vector<std::unique_ptr<Thread>> threads;
+  for (int i = 0; i < kNumWorkItems; ++i) {
+    pool->Schedule([&bc]() { bc.DecrementCount(); });
+    pool->ScheduleOnNumaNode(i % pool->NumNumaNodes(),
+                             [&bc]() { bc.DecrementCount(); });
+    threads.push_back(
+        thread_factory->StartThread("", [&bc]() { bc.DecrementCount(); }));
+  }
+  bc.Wait();
+  threads.clear();
+  if (pool->NumNumaNodes() == 1) {
+    EXPECT_EQ(pool->num_cross_node_migrations(), 0);
+  }
+}
+
+TEST(UnboundedThreadPool, NumaAwarePoolWithInvalidHomeNode) {
+  std::unique_ptr<UnboundedThreadPool> pool =
+      UnboundedThreadPool::CreateNumaAware(Env::Default(), "test",
+                                           /*home_numa_node=*/1 << 20);
+  Notification n;
+  pool->Schedule([&n]() { n.Notify(); });
+  n.WaitForNotification();
+}
+
 }  // namespace
 }  // namespace data
 }  // namespace tensorflow
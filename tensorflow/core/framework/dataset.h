@@ -119,6 +119,13 @@ constexpr char kMetadata[] = "metadata";
 
 constexpr char kCardinalityAttrForRewrite[] = "_cardinality";
 
+// Set by the map_vectorization rewrite on the functions that it vectorizes.
+constexpr char kMapVectorizationAttr[] = "_map_vectorization";
+
+// The value of `ThreadingOptions.numa_node` that selects the NUMA node of the
+// thread that creates the iterator.
+constexpr int kNumaNodeOfCaller = -1;
+
 class DatasetBase;
 class IteratorContext;
 class SerializationContext;
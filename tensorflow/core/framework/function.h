@@ -314,6 +314,17 @@ class CallFrameInterface {
   virtual bool CanConsumeArg(int index) const { return false; }
 
   virtual absl::Status SetRetval(int index, const Tensor& val) = 0;
+
+  // Returns true and sets `*val` to a tensor whose memory the caller has
+  // reserved for the return value at `index`, if the caller has reserved
+  // memory of type `dtype` and shape `shape` for it. A kernel whose output
+  // becomes that return value may then allocate the output in the reserved
+  // memory, so that the caller need not copy the return value. Each slot is
+  // handed out at most once.
+  virtual bool GetRetvalSlot(int index, DataType dtype,
+                             const TensorShape& shape, Tensor* val) {
+    return false;
+  }
 };
 
 // Represents a function call frame. I.e., the data structure used to
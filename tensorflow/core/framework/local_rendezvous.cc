@@ -137,11 +137,23 @@ LocalRendezvous::~LocalRendezvous() {
   }
   if (table_not_empty) {
     DoAbort(absl::CancelledError("LocalRendezvous deleted"));
+  } else if (num_slots_ > 0) {
+    AbortSlots(absl::CancelledError("LocalRendezvous deleted"));
   }
 }
 
 namespace {
 uint64 KeyHash(const StringPiece& k) { return Hash64(k.data(), k.size()); }
+
+void CountDeadValue(const Rendezvous::ParsedKey& key) {
+  static auto* rendezvous_dead_values_sent = monitoring::Counter<2>::New(
+      "/tensorflow/core/rendezvous_dead_values_sent",
+      "The number of dead values sent between a pair of devices.",
+      "send_device", "recv_device");
+  rendezvous_dead_values_sent
+      ->GetCell(string(key.src_device), string(key.dst_device))
+      ->IncrementBy(1);
+}
 }  // namespace
 
 absl::Status LocalRendezvous::Send(const Rendezvous::ParsedKey& key,
@@ -151,13 +163,7 @@ absl::Status LocalRendezvous::Send(const Rendezvous::ParsedKey& key,
   DVLOG(2) << "Send " << this << " " << key_hash << " " << key.FullKey();
 
   if (is_dead) {
-    static auto* rendezvous_dead_values_sent = monitoring::Counter<2>::New(
-        "/tensorflow/core/rendezvous_dead_values_sent",
-        "The number of dead values sent between a pair of devices.",
-        "send_device", "recv_device");
-    rendezvous_dead_values_sent
-        ->GetCell(string(key.src_device), string(key.dst_device))
-        ->IncrementBy(1);
+    CountDeadValue(key);
   }
 
   TF_RETURN_IF_ERROR(status());
@@ -381,6 +387,195 @@ void LocalRendezvous::RecvAsync(const Rendezvous::ParsedKey& key,
   delete item;
 }
 
+absl::Status LocalRendezvous::SendToSlot(int64_t slot,
+                                         const Rendezvous::ParsedKey& key,
+                                         const Rendezvous::Args& send_args,
+                                         const Tensor& val,
+                                         const bool is_dead) {
+  if (slot < 0 || slot >= num_slots_) {
+    return Send(key, send_args, val, is_dead);
+  }
+  DVLOG(2) << "Send " << this << " slot " << slot << " " << key.FullKey();
+
+  if (is_dead) {
+    CountDeadValue(key);
+  }
+
+  Slot& s = slots_[slot];
+  s.mu.lock();
+  // Check the status while holding the lock of the slot, so that DoAbort()
+  // either fails this call or finds the message in the slot.
+  absl::Status status = this->status();
+  if (!status.ok()) {
+    s.mu.unlock();
+    return status;
+  }
+  if (s.state == Slot::kEmpty) {
+    // There is no waiter for this message. The waiter will pick it up from
+    // the slot when it arrives.
+    s.state = Slot::kSent;
+    s.args = send_args;
+    if (send_args.device_context) {
+      send_args.device_context->Ref();
+    }
+    s.value = val;
+    s.is_dead = is_dead;
+    s.rc_owner = tsl::core::GetNewRef(rc_owner_);
+    s.mu.unlock();
+    return absl::OkStatus();
+  }
+  if (s.state == Slot::kCancelled) {
+    // The receiver is gone, so the message is dropped.
+    s.mu.unlock();
+    return absl::OkStatus();
+  }
+  if (s.state != Slot::kWaiting) {
+    s.mu.unlock();
+    return errors::Internal("Rendezvous slot ", slot,
+                            " was already used. Key: ", key.FullKey());
+  }
+
+  // Consume the waiter, and invoke it without holding the lock.
+  s.state = Slot::kDone;
+  const Rendezvous::Args recv_args = s.args;
+  const CancellationToken token = s.cancellation_token;
+  Rendezvous::DoneCallback waiter = std::move(s.waiter);
+  // Released last since it may destruct the rendezvous.
+  tsl::core::RefCountPtr<Rendezvous> rc_owner = std::move(s.rc_owner);
+  s.mu.unlock();
+
+  // The cancellation manager may no longer be live after `waiter` is
+  // called.
+  if (recv_args.cancellation_manager != nullptr) {
+    recv_args.cancellation_manager->TryDeregisterCallback(token);
+  }
+  waiter(absl::OkStatus(), send_args, recv_args, val, is_dead);
+  if (recv_args.device_context) {
+    recv_args.device_context->Unref();
+  }
+  return absl::OkStatus();
+}
+
+void LocalRendezvous::RecvFromSlotAsync(int64_t slot,
+                                        const Rendezvous::ParsedKey& key,
+                                        const Rendezvous::Args& recv_args,
+                                        Rendezvous::DoneCallback done) {
+  if (slot < 0 || slot >= num_slots_) {
+    RecvAsync(key, recv_args, std::move(done));
+    return;
+  }
+  DVLOG(2) << "Recv " << this << " slot " << slot << " " << key.FullKey();
+
+  Slot& s = slots_[slot];
+  s.mu.lock();
+  absl::Status status = this->status();
+  if (!status.ok()) {
+    // Rendezvous has been aborted.
+    s.mu.unlock();
+    done(status, Rendezvous::Args(), recv_args, Tensor(), false);
+    return;
+  }
+  if (s.state == Slot::kSent) {
+    // The message has already arrived. Consume it and invoke the done
+    // closure without holding the lock.
+    s.state = Slot::kDone;
+    const Rendezvous::Args send_args = s.args;
+    const Tensor value = std::move(s.value);
+    const bool is_dead = s.is_dead;
+    tsl::core::RefCountPtr<Rendezvous> rc_owner = std::move(s.rc_owner);
+    s.mu.unlock();
+
+    done(absl::OkStatus(), send_args, recv_args, value, is_dead);
+    if (send_args.device_context) {
+      send_args.device_context->Unref();
+    }
+    return;
+  }
+  if (s.state != Slot::kEmpty) {
+    s.mu.unlock();
+    done(errors::Internal("Rendezvous slot ", slot,
+                          " was already used. Key: ", key.FullKey()),
+         Rendezvous::Args(), recv_args, Tensor(), false);
+    return;
+  }
+
+  // There is no message to pick up, so wait for it in the slot.
+  CancellationManager* cm = recv_args.cancellation_manager;
+  CancellationToken token = CancellationManager::kInvalidToken;
+  if (cm != nullptr) {
+    token = cm->get_cancellation_token();
+    if (!cm->RegisterCallback(
+            token, [this, slot, token] { CancelSlotRecv(slot, token); })) {
+      s.mu.unlock();
+      done(StatusGroup::MakeDerived(
+               errors::Cancelled("RecvAsync is cancelled.")),
+           Rendezvous::Args(), recv_args, Tensor(), /*is_dead=*/false);
+      return;
+    }
+  }
+  s.state = Slot::kWaiting;
+  s.args = recv_args;
+  if (recv_args.device_context) {
+    recv_args.device_context->Ref();
+  }
+  s.waiter = std::move(done);
+  s.cancellation_token = token;
+  s.rc_owner = tsl::core::GetNewRef(rc_owner_);
+  s.mu.unlock();
+}
+
+void LocalRendezvous::CancelSlotRecv(int64_t slot, CancellationToken token) {
+  Slot& s = slots_[slot];
+  s.mu.lock();
+  if (s.state != Slot::kWaiting || s.cancellation_token != token) {
+    s.mu.unlock();
+    return;
+  }
+  s.state = Slot::kCancelled;
+  const Rendezvous::Args recv_args = s.args;
+  Rendezvous::DoneCallback waiter = std::move(s.waiter);
+  tsl::core::RefCountPtr<Rendezvous> rc_owner = std::move(s.rc_owner);
+  s.mu.unlock();
+
+  waiter(StatusGroup::MakeDerived(errors::Cancelled("RecvAsync is cancelled.")),
+         Rendezvous::Args(), recv_args, Tensor(), /*is_dead=*/false);
+  if (recv_args.device_context) {
+    recv_args.device_context->Unref();
+  }
+}
+
+void LocalRendezvous::AbortSlots(const absl::Status& status) {
+  // Keeps one reference to make sure the current rendezvous won't be
+  // destructed.
+  tsl::core::RefCountPtr<Rendezvous> rc_owner;
+  for (int64_t i = 0; i < num_slots_; ++i) {
+    Slot& s = slots_[i];
+    s.mu.lock();
+    const Slot::State state = s.state;
+    if (state != Slot::kSent && state != Slot::kWaiting) {
+      s.mu.unlock();
+      continue;
+    }
+    s.state = Slot::kDone;
+    const Rendezvous::Args args = s.args;
+    const CancellationToken token = s.cancellation_token;
+    Rendezvous::DoneCallback waiter = std::move(s.waiter);
+    s.value = Tensor();
+    rc_owner = std::move(s.rc_owner);
+    s.mu.unlock();
+
+    if (state == Slot::kWaiting) {
+      if (args.cancellation_manager != nullptr) {
+        args.cancellation_manager->TryDeregisterCallback(token);
+      }
+      waiter(status, Rendezvous::Args(), args, Tensor(), false);
+    }
+    if (args.device_context) {
+      args.device_context->Unref();
+    }
+  }
+}
+
 mutex& LocalRendezvous::aborted_rendezs_mu_ = *new mutex();
 
 std::vector<tsl::core::RefCountPtr<Rendezvous> >&
@@ -434,6 +629,7 @@ void LocalRendezvous::DoAbort(const absl::Status& status) {
       }
     }
   }
+  AbortSlots(status);
 }
 
 absl::Status LocalRendezvous::status() {
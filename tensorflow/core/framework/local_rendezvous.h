@@ -16,6 +16,7 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_FRAMEWORK_LOCAL_RENDEZVOUS_H_
 #define TENSORFLOW_CORE_FRAMEWORK_LOCAL_RENDEZVOUS_H_
 
+#include <cstdint>
 #include <memory>
 #include <optional>
 #include <vector>
@@ -43,10 +44,17 @@ class LocalRendezvous {
   // Rendezvous), pass in its pointer in constructor so the LocalRendezvous
   // can make sure it outlives the async recv requests.
   // Pass in nullptr if the wrapping class is not refcounted.
-  explicit LocalRendezvous(Rendezvous* owner, int num_shards)
+  //
+  // `num_slots` is the size of the table used by SendToSlot() and
+  // RecvFromSlotAsync().
+  explicit LocalRendezvous(Rendezvous* owner, int num_shards,
+                           int64_t num_slots = 0)
       : num_buckets_(num_shards > 0 ? num_shards : 1),
         rc_owner_(owner),
-        table_buckets_(std::make_unique<TableBucket[]>(num_buckets_)) {}
+        table_buckets_(std::make_unique<TableBucket[]>(num_buckets_)),
+        num_slots_(num_slots > 0 ? num_slots : 0),
+        slots_(num_slots_ > 0 ? std::make_unique<Slot[]>(num_slots_)
+                              : nullptr) {}
   ~LocalRendezvous();
 
   absl::Status Send(const Rendezvous::ParsedKey& key,
@@ -55,6 +63,15 @@ class LocalRendezvous {
   void RecvAsync(const Rendezvous::ParsedKey& key,
                  const Rendezvous::Args& recv_args,
                  Rendezvous::DoneCallback done);
+  // See RendezvousInterface::SendToSlot(). Slots outside of the table fall
+  // back to Send() and RecvAsync().
+  absl::Status SendToSlot(int64_t slot, const Rendezvous::ParsedKey& key,
+                          const Rendezvous::Args& send_args, const Tensor& val,
+                          bool is_dead);
+  void RecvFromSlotAsync(int64_t slot, const Rendezvous::ParsedKey& key,
+                         const Rendezvous::Args& recv_args,
+                         Rendezvous::DoneCallback done);
+  int64_t num_slots() const { return num_slots_; }
   void StartAbort(const absl::Status& status);
   absl::Status status();
 
@@ -66,6 +83,9 @@ class LocalRendezvous {
 
  private:
   void DoAbort(const absl::Status& status);
+  // Fails the pending receivers and drops the messages of all slots.
+  void AbortSlots(const absl::Status& status);
+  void CancelSlotRecv(int64_t slot, CancellationToken token);
 
   tsl::core::RefCountPtr<Rendezvous> GetOwnerRefCountPtr();
 
@@ -103,6 +123,33 @@ class LocalRendezvous {
   mutex mu_;
   absl::Status status_ TF_GUARDED_BY(mu_);
 
+  // A preallocated exchange for the single message of one Send/Recv pair.
+  struct Slot {
+    enum State {
+      kEmpty = 0,
+      kSent = 1,       // Holds a message.
+      kWaiting = 2,    // Holds a waiter.
+      kDone = 3,       // The message was received, or the receiver aborted.
+      kCancelled = 4,  // The receiver was cancelled.
+    };
+
+    mutex mu;
+    State state TF_GUARDED_BY(mu) = kEmpty;
+    // The arguments of the sender if `state == kSent`, or of the receiver if
+    // `state == kWaiting`. Holds a reference to their device context.
+    Rendezvous::Args args TF_GUARDED_BY(mu);
+    Tensor value TF_GUARDED_BY(mu);
+    bool is_dead TF_GUARDED_BY(mu) = false;
+    Rendezvous::DoneCallback waiter TF_GUARDED_BY(mu);
+    CancellationToken cancellation_token TF_GUARDED_BY(mu) =
+        CancellationManager::kInvalidToken;
+    // Keeps the owner alive while the slot holds a message or a waiter.
+    tsl::core::RefCountPtr<Rendezvous> rc_owner TF_GUARDED_BY(mu);
+  };
+
+  const int64_t num_slots_;
+  const std::unique_ptr<Slot[]> slots_;
+
   // We deliberately leak one reference of the aborted rendezvous here, so that
   // they won't be destructed, and lose the status_.
   // This is necessary because subsequent calls to RendezvousMgr::Find() will
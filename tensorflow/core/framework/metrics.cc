@@ -42,6 +42,12 @@ auto* aot_bef_mlir_load_count = tsl::monitoring::Counter<0>::New(
     "The number of times BEF and MLIR are deserialized instead of generated "
     "and used.");
 
+auto* executor_graph_cache_lookups = tsl::monitoring::Counter<1>::New(
+    "/tensorflow/core/executor_graph_cache_lookups",
+    "The number of lookups in the executor graph cache of DirectSession, by "
+    "result: `hit`, `miss`, or `invalid` if an entry could not be read.",
+    "result");
+
 auto* graph_runs = tsl::monitoring::Counter<0>::New(
     "/tensorflow/core/graph_runs",
     "The number of graph executions used to collect "
@@ -75,6 +81,12 @@ auto* graph_run_output_tensor_bytes = tsl::monitoring::Sampler<0>::New(
     // Power of 2 with bucket count 14 (256MB)
     {tsl::monitoring::Buckets::Exponential(1, 4, 14)});
 
+auto* step_arena_allocated_bytes = tsl::monitoring::Counter<1>::New(
+    "/tensorflow/core/step_arena_allocated_bytes",
+    "The bytes of tensors allocated by steps using a step arena, by whether "
+    "they were allocated from the arena or from the device allocator.",
+    "allocator");
+
 auto* graph_unused_outputs = tsl::monitoring::Counter<1>::New(
     "/tensorflow/core/graph_unused_outputs",
     "The number of unused outputs for ops of a given type.", "name");
@@ -88,6 +100,11 @@ auto* tf_data_fetch_op_counter = tsl::monitoring::Counter<1>::New(
 auto* tf_data_autotune_counter = tsl::monitoring::Counter<1>::New(
     "/tensorflow/data/autotune", "tf.data autotuning", "name");
 
+auto* tf_data_map_vectorization_counter = tsl::monitoring::Counter<1>::New(
+    "/tensorflow/data/map_vectorization",
+    "The number of elements processed by vectorized tf.data map functions.",
+    "path");
+
 auto* tf_data_bytes_consumed_counter = tsl::monitoring::Counter<1>::New(
     "/tensorflow/data/bytes_consumed",
     "The number of bytes consumed by a tf.data Dataset.", "name");
@@ -195,6 +212,12 @@ auto* tf_data_iterator_gap_msec_histogram = tsl::monitoring::Sampler<0>::New(
     // Power of 1.5 with bucket count of 20 (from 1 msec to about 2.2 secs).
     {tsl::monitoring::Buckets::Exponential(1, 1.5, 20)});
 
+auto* tf_data_numa_cross_node_migrations_counter =
+    tsl::monitoring::Counter<0>::New(
+        "/tensorflow/data/numa_cross_node_migrations",
+        "The number of tf.data background work items that ran on a different "
+        "NUMA node than the thread that scheduled them.");
+
 auto* tf_data_optimization_counter = tsl::monitoring::Counter<1>::New(
     "/tensorflow/data/optimization", "tf.data optimization", "name");
 
@@ -225,6 +248,32 @@ auto* tf_data_service_cross_trainer_cache_size_bytes =
         "/tensorflow/data/service/cross_trainer_cache_size_bytes",
         "tf.data service cross-trainer cache memory usage in bytes.");
 
+auto* tf_data_service_cross_trainer_cache_query_results_counter =
+    tsl::monitoring::Counter<1>::New(
+        "/tensorflow/data/service/cross_trainer_cache_query_results",
+        "tf.data service cross-trainer cache queries by result. The result "
+        "can be hit, compressed_hit or miss.",
+        "result");
+
+auto* tf_data_service_cross_trainer_cache_compressed_size_bytes =
+    tsl::monitoring::Gauge<int64_t, 0>::New(
+        "/tensorflow/data/service/cross_trainer_cache_compressed_size_bytes",
+        "tf.data service cross-trainer cache compressed tier memory usage in "
+        "bytes.");
+
+auto* tf_data_service_task_buffer_occupancy =
+    tsl::monitoring::Sampler<0>::New(
+        {"/tensorflow/data/service/task_buffer_occupancy",
+         "Number of elements buffered by a tf.data service worker task when a "
+         "consumer requests an element."},
+        {tsl::monitoring::Buckets::Exponential(1, 2, 8)});
+
+auto* tf_data_service_task_stall_time_usecs = tsl::monitoring::Counter<1>::New(
+    "/tensorflow/data/service/task_stall_time_usecs",
+    "Microseconds tf.data service worker tasks spent waiting, either for "
+    "elements to be produced or for consumers to make room for them.",
+    "stalled_side");
+
 auto* tf_data_service_snapshot_bytes_committed =
     tsl::monitoring::Counter<0>::New(
         "/tensorflow/data/service/snapshot_bytes_committed",
@@ -498,6 +547,10 @@ void RecordTFDataAutotune(const string& name) {
   tf_data_autotune_counter->GetCell(name)->IncrementBy(1);
 }
 
+void RecordTFDataMapVectorization(const string& path, int64_t num_elements) {
+  tf_data_map_vectorization_counter->GetCell(path)->IncrementBy(num_elements);
+}
+
 tsl::monitoring::CounterCell* GetTFDataBytesConsumedCounter(
     const string& name) {
   return tf_data_bytes_consumed_counter->GetCell(name);
@@ -604,6 +657,12 @@ void RecordTFDataIteratorGap(uint64 duration_us) {
   tf_data_iterator_gap_msec_histogram_cell->Add(duration_us * 0.001);
 }
 
+void RecordTFDataNumaCrossNodeMigration() {
+  static auto* tf_data_numa_cross_node_migrations_cell =
+      tf_data_numa_cross_node_migrations_counter->GetCell();
+  tf_data_numa_cross_node_migrations_cell->IncrementBy(1);
+}
+
 void RecordTFDataOptimization(const string& name, int64_t num_changes) {
   tf_data_optimization_counter->GetCell(name)->IncrementBy(num_changes);
 }
@@ -675,6 +734,28 @@ void RecordTFDataServiceCrossTrainerCacheSizeBytes(size_t bytes) {
       static_cast<int64_t>(bytes));
 }
 
+void RecordTFDataServiceCrossTrainerCacheQueryResult(const string& result) {
+  tf_data_service_cross_trainer_cache_query_results_counter->GetCell(result)
+      ->IncrementBy(1);
+}
+
+void RecordTFDataServiceCrossTrainerCacheCompressedSizeBytes(size_t bytes) {
+  tf_data_service_cross_trainer_cache_compressed_size_bytes->GetCell()->Set(
+      static_cast<int64_t>(bytes));
+}
+
+void RecordTFDataServiceTaskBufferOccupancy(int64_t num_elements) {
+  static auto* tf_data_service_task_buffer_occupancy_cell =
+      tf_data_service_task_buffer_occupancy->GetCell();
+  tf_data_service_task_buffer_occupancy_cell->Add(num_elements);
+}
+
+void RecordTFDataServiceTaskStallTime(const string& stalled_side,
+                                      int64_t duration_us) {
+  tf_data_service_task_stall_time_usecs->GetCell(stalled_side)
+      ->IncrementBy(duration_us);
+}
+
 void RecordTFDataServiceSnapshotBytesCommitted(int64_t bytes) {
   tf_data_service_snapshot_bytes_committed->GetCell()->IncrementBy(bytes);
 }
@@ -780,6 +861,14 @@ void RecordGraphOutputTensors(const size_t size) {
   graph_run_output_tensor_bytes_cell->Add(size);
 }
 
+void RecordStepArenaAllocatedBytes(int64_t arena_bytes,
+                                   int64_t fallback_bytes) {
+  static auto* arena_cell = step_arena_allocated_bytes->GetCell("arena");
+  static auto* fallback_cell = step_arena_allocated_bytes->GetCell("fallback");
+  arena_cell->IncrementBy(arena_bytes);
+  fallback_cell->IncrementBy(fallback_bytes);
+}
+
 void RecordTPUXlaSpmdCoresPerReplica(int64_t cores_per_replica) {
   xla_tpu_spmd_cores_per_replica->GetCell(absl::StrCat(cores_per_replica))
       ->IncrementBy(1);
@@ -797,6 +886,10 @@ void UpdateAotBefMlirLoadCount() {
   aot_bef_mlir_load_count_cell->IncrementBy(1);
 }
 
+void RecordExecutorGraphCacheLookup(const string& result) {
+  executor_graph_cache_lookups->GetCell(result)->IncrementBy(1);
+}
+
 void UpdateGraphExecTime(const uint64 running_time_usecs) {
   if (running_time_usecs > 0) {
     static auto* graph_runs_cell = graph_runs->GetCell();
@@ -46,6 +46,13 @@ void RecordTFDataFetchOp(const string& name);
 // The `name` argument identifies the Dataset type (e.g. "ParallelMap").
 void RecordTFDataAutotune(const string& name);
 
+// Records that `num_elements` elements were processed by a map function
+// rewritten by the map vectorization optimization.
+//
+// The `path` argument is "vectorized" if every op of the function runs on the
+// whole batch and "fallback" if some ops run once per element.
+void RecordTFDataMapVectorization(const string& path, int64_t num_elements);
+
 // Returns a counter that can be used to record the number of bytes produced by
 // a tf.data.Dataset.
 //
@@ -138,6 +145,10 @@ void RecordTFDataIteratorLifetime(uint64 duration_us);
 // request.
 void RecordTFDataIteratorGap(uint64 duration_us);
 
+// Records that a tf.data background work item ran on a different NUMA node
+// than the thread that scheduled it.
+void RecordTFDataNumaCrossNodeMigration();
+
 // Records the number of independent graph changes resulting from the
 // application of a tf.data optimization.
 //
@@ -182,6 +193,25 @@ void RecordTFDataServiceCrossTrainerCacheQuery(bool cache_hit);
 // Records tf.data service cross-trainer cache memory usage in bytes.
 void RecordTFDataServiceCrossTrainerCacheSizeBytes(size_t bytes);
 
+// Records the result of a tf.data service cross-trainer cache query. `result`
+// is "hit", "compressed_hit" or "miss".
+void RecordTFDataServiceCrossTrainerCacheQueryResult(const string& result);
+
+// Records the memory usage in bytes of the compressed tier of the tf.data
+// service cross-trainer cache.
+void RecordTFDataServiceCrossTrainerCacheCompressedSizeBytes(size_t bytes);
+
+// Records the number of elements buffered by a tf.data service worker task
+// when a consumer requests an element.
+void RecordTFDataServiceTaskBufferOccupancy(int64_t num_elements);
+
+// Records the time (in microseconds) a tf.data service worker task spent
+// stalled. `stalled_side` is "consumer" for requests that waited for the task
+// to produce an element, and "producer" for the task waiting for consumers to
+// make room in its buffer.
+void RecordTFDataServiceTaskStallTime(const string& stalled_side,
+                                      int64_t duration_us);
+
 // Records tf.data distributed snapshot bytes committed.
 void RecordTFDataServiceSnapshotBytesCommitted(int64_t bytes);
 
@@ -263,6 +293,11 @@ void RecordParseRaggedFeature(int64_t num_features);
 void RecordGraphInputTensors(const size_t size);
 void RecordGraphOutputTensors(const size_t size);
 
+// Records the bytes of the tensors of one step allocated from the step arena
+// and from the device allocator.
+void RecordStepArenaAllocatedBytes(int64_t arena_bytes,
+                                   int64_t fallback_bytes);
+
 // Records the number of cores requested by graphs with XLA SPMD enabled.
 void RecordTPUXlaSpmdCoresPerReplica(int64_t cores_per_replica);
 
@@ -282,6 +317,10 @@ void UpdatePersistentCacheLoadCount();
 // Increments the count of BEF and MLIR deserialized.
 void UpdateAotBefMlirLoadCount();
 
+// Records a lookup in the executor graph cache of DirectSession. `result` is
+// "hit", "miss", or "invalid".
+void RecordExecutorGraphCacheLookup(const string& result);
+
 // Updates the metrics stored about time spent building graphs.
 //
 // By "GraphBuild", we refer to building a client graph, which is a sub-graph of
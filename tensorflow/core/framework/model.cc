@@ -23,16 +23,19 @@ limitations under the License.
 #include <optional>
 #include <queue>
 
+#include "absl/strings/match.h"
 #include "absl/time/clock.h"
 #include "tensorflow/core/framework/cancellation.h"
 #include "tensorflow/core/framework/metrics.h"
 #include "tensorflow/core/framework/model.pb.h"
 #include "tensorflow/core/lib/gtl/cleanup.h"
 #include "tensorflow/core/lib/strings/str_util.h"
+#include "tensorflow/core/platform/hash.h"
 #include "tensorflow/core/platform/host_info.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/mem.h"
 #include "tensorflow/core/platform/statusor.h"
+#include "tensorflow/core/platform/strcat.h"
 #include "tsl/platform/protobuf.h"
 
 namespace tensorflow {
@@ -64,6 +67,20 @@ constexpr double kBufferDownsizeMultipliter = 0.9;
 // Threshold of low buffer watermark before a buffer is a candidate for
 // upsizing.
 constexpr int64_t kBufferLowWatermarkThreshold = 2;
+// A `LEARNED` trial is kept only if it improves throughput by at least this
+// fraction, so that measurement noise is not mistaken for an improvement.
+constexpr double kLearnedMinImprovement = 0.02;
+// Factor by which a `LEARNED` trial grows a parameter (by at least one).
+constexpr double kLearnedGrowthFactor = 1.5;
+// Upper bound on the total parallelism of a `LEARNED` configuration, as a
+// multiple of the CPU budget.
+constexpr double kLearnedMaxCpuOversubscription = 4.0;
+// Number of rounds after convergence before the `LEARNED` search restarts.
+constexpr int64_t kLearnedRestartRounds = 20;
+// Weight of the latest measurement in the moving average of the throughput of
+// the best `LEARNED` configuration.
+constexpr double kLearnedThroughputEmaWeight = 0.25;
+constexpr char kLearnedStateFileSuffix[] = ".learned_autotune";
 
 constexpr char kDataService[] = "DataService";
 constexpr char kFlatMap[] = "FlatMap";
@@ -2405,6 +2422,15 @@ void Model::Optimize(AutotuneAlgorithm algorithm,
       OptimizeStageBased(snapshot, optimization_params, cancellation_manager,
                          ram_budget_manager);
       break;
+    case AutotuneAlgorithm::LEARNED:
+      if (learned_autotuner_ == nullptr) {
+        tf_shared_lock l(mu_);
+        learned_autotuner_ = std::make_unique<LearnedAutotuner>(
+            learned_autotune_state_directory_);
+      }
+      learned_autotuner_->Optimize(snapshot, optimization_params,
+                                   cancellation_manager, ram_budget_manager);
+      break;
     default:
       VLOG(2) << "Autotuning algorithm was not recognized. Aborting "
                  "optimization.";
@@ -3259,6 +3285,317 @@ std::string Model::DebugString() {
   return cached_debug_string_;
 }
 
+LearnedAutotuner::LearnedAutotuner(std::string state_directory)
+    : LearnedAutotuner(std::move(state_directory),
+                       [] { return EnvTime::NowNanos(); }) {}
+
+LearnedAutotuner::LearnedAutotuner(std::string state_directory, Clock clock)
+    : state_directory_(std::move(state_directory)), clock_(std::move(clock)) {}
+
+void LearnedAutotuner::Optimize(
+    std::shared_ptr<Node> snapshot,
+    const ModelProto::OptimizationParams& optimization_params,
+    CancellationManager* cancellation_manager,
+    RamBudgetManager& ram_budget_manager) {
+  std::vector<Tunable> tunables = CollectTunables(snapshot);
+  if (tunables.empty()) {
+    VLOG(2) << "There are no tunable parameters.";
+    return;
+  }
+  const uint64_t now_nsec = clock_();
+  const int64_t num_elements = snapshot->num_elements();
+  if (last_time_nsec_ == 0) {
+    // The first round only establishes the starting point. Throughput is
+    // measured from here on.
+    LoadState(tunables);
+  } else if (now_nsec > last_time_nsec_) {
+    const double throughput =
+        static_cast<double>(num_elements - last_num_elements_) *
+        EnvTime::kSecondsToNanos / (now_nsec - last_time_nsec_);
+    if (trial_.has_value()) {
+      if (throughput >= best_throughput_ * (1.0 + kLearnedMinImprovement)) {
+        VLOG(2) << "Keeping " << trial_->key << ": throughput improved from "
+                << best_throughput_ << " to " << throughput << " elements/s.";
+        RecordBest(tunables, throughput);
+        // The bottleneck may have moved, so parameters that did not help
+        // before may help now.
+        exhausted_.clear();
+      } else {
+        VLOG(2) << "Reverting " << trial_->key << ": throughput of "
+                << throughput << " elements/s is not better than "
+                << best_throughput_ << " elements/s.";
+        for (Tunable& tunable : tunables) {
+          if (tunable.key == trial_->key) {
+            tunable.parameter->value = trial_->previous_value;
+          }
+        }
+        exhausted_.insert(trial_->key);
+      }
+      trial_.reset();
+    } else if (best_values_.empty()) {
+      RecordBest(tunables, throughput);
+    } else {
+      // Track changes of the workload while no trial is running.
+      best_throughput_ =
+          (1.0 - kLearnedThroughputEmaWeight) * best_throughput_ +
+          kLearnedThroughputEmaWeight * throughput;
+    }
+    if (!cancellation_manager->IsCancelled()) {
+      if (StartTrial(snapshot, optimization_params, tunables)) {
+        converged_ = false;
+      } else if (!converged_) {
+        VLOG(2) << "Autotuning converged at " << best_throughput_
+                << " elements/s.";
+        converged_ = true;
+        rounds_since_converged_ = 0;
+        SaveState();
+      } else if (++rounds_since_converged_ >= kLearnedRestartRounds) {
+        // Parameters that did not help before may help after the workload
+        // changed, so search again.
+        exhausted_.clear();
+        converged_ = false;
+      }
+    }
+  }
+  last_time_nsec_ = now_nsec;
+  last_num_elements_ = num_elements;
+
+  Node::ModelParameters parameters;
+  parameters.reserve(tunables.size());
+  for (const Tunable& tunable : tunables) {
+    parameters.emplace_back(tunable.key, tunable.parameter);
+  }
+  if (!ram_budget_manager.RequestModelAllocation(
+          snapshot->TotalMaximumBufferedBytes())) {
+    if (!trial_.has_value()) {
+      return;
+    }
+    // Drop the trial and retry with the values it started from.
+    for (Tunable& tunable : tunables) {
+      if (tunable.key == trial_->key) {
+        tunable.parameter->value = trial_->previous_value;
+      }
+    }
+    exhausted_.insert(trial_->key);
+    trial_.reset();
+    if (!ram_budget_manager.RequestModelAllocation(
+            snapshot->TotalMaximumBufferedBytes())) {
+      return;
+    }
+  }
+  UpdateStateValues(&parameters);
+}
+
+std::vector<LearnedAutotuner::Tunable> LearnedAutotuner::CollectTunables(
+    std::shared_ptr<Node> snapshot) {
+  std::vector<Tunable> tunables;
+  uint64_t fingerprint = 0;
+  // Nodes are keyed by their path from the root rather than by their ids, so
+  // that keys are stable across runs of the same pipeline. Inputs that
+  // interleave-like nodes create dynamically are excluded from the
+  // fingerprint.
+  struct Entry {
+    Node* node;
+    std::string key;
+    bool is_static;
+  };
+  std::vector<Entry> stack = {{snapshot.get(), snapshot->name(), true}};
+  while (!stack.empty()) {
+    Entry entry = std::move(stack.back());
+    stack.pop_back();
+    Node* node = entry.node;
+    if (entry.is_static) {
+      fingerprint = Hash64Combine(fingerprint, Hash64(entry.key));
+    }
+    std::unique_ptr<NodeHistory>& history = histories_[entry.key];
+    if (history == nullptr) {
+      history = std::make_unique<NodeHistory>();
+    }
+    const int64_t num_elements = node->num_elements();
+    const int64_t processing_time = node->processing_time();
+    if (num_elements > history->num_elements) {
+      history->processing_time_per_element.Add(
+          static_cast<double>(processing_time - history->processing_time) /
+          (num_elements - history->num_elements));
+    }
+    history->num_elements = num_elements;
+    history->processing_time = processing_time;
+    for (auto& pair : node->CollectNodeTunableParameters()) {
+      tunables.push_back({strings::StrCat(entry.key, "::", pair.second->name),
+                          entry.key, pair.second});
+    }
+    const bool has_dynamic_inputs =
+        absl::StartsWith(node->name(), kInterleave) ||
+        absl::StartsWith(node->name(), kParallelInterleave) ||
+        absl::StartsWith(node->name(), kFlatMap);
+    int64_t index = 0;
+    for (const auto& input : node->inputs()) {
+      stack.push_back(
+          {input.get(), strings::StrCat(entry.key, "/", index, ":",
+                                        input->name()),
+           entry.is_static && !(has_dynamic_inputs && index > 0)});
+      ++index;
+    }
+  }
+  if (fingerprint_ == 0) {
+    fingerprint_ = fingerprint;
+  } else if (fingerprint_ != fingerprint) {
+    VLOG(2) << "The structure of the pipeline changed during autotuning.";
+  }
+  return tunables;
+}
+
+bool LearnedAutotuner::StartTrial(
+    std::shared_ptr<Node> snapshot,
+    const ModelProto::OptimizationParams& optimization_params,
+    std::vector<Tunable>& tunables) {
+  double total_parallelism = 0.0;
+  for (const Tunable& tunable : tunables) {
+    if (tunable.parameter->name == kParallelism) {
+      total_parallelism += tunable.parameter->value;
+    }
+  }
+  // Throughput is measured rather than modeled, so parallelism may exceed the
+  // CPU budget to hide IO latency; trials that only add contention are
+  // reverted.
+  const double max_total_parallelism =
+      kLearnedMaxCpuOversubscription * optimization_params.cpu_budget();
+
+  // Parallelism is tried before buffer sizes. Among parameters of the same
+  // kind, the node with the highest tail processing time per element and
+  // unit of the parameter is tried first.
+  std::vector<std::pair<std::pair<bool, double>, Tunable*>> candidates;
+  for (Tunable& tunable : tunables) {
+    const Parameter& parameter = *tunable.parameter;
+    if (exhausted_.contains(tunable.key) || parameter.value >= parameter.max) {
+      continue;
+    }
+    const bool is_parallelism = parameter.name == kParallelism;
+    if (is_parallelism && total_parallelism + 1 > max_total_parallelism) {
+      continue;
+    }
+    const auto it = histories_.find(tunable.node_key);
+    const double time_per_element =
+        it == histories_.end()
+            ? 0.0
+            : it->second->processing_time_per_element.Percentile(90);
+    candidates.push_back(
+        {{is_parallelism, time_per_element / std::max(1.0, parameter.value)},
+         &tunable});
+  }
+  std::sort(candidates.begin(), candidates.end(),
+            [](const auto& a, const auto& b) { return a.first > b.first; });
+
+  for (auto& candidate : candidates) {
+    Tunable& tunable = *candidate.second;
+    Parameter& parameter = *tunable.parameter;
+    const double previous_value = parameter.value;
+    double value = std::max(previous_value + 1.0,
+                            std::round(previous_value * kLearnedGrowthFactor));
+    value = std::min(value, parameter.max);
+    if (parameter.name == kParallelism) {
+      value = std::min(value, std::floor(max_total_parallelism -
+                                         total_parallelism + previous_value));
+    }
+    if (value <= previous_value) {
+      continue;
+    }
+    parameter.value = value;
+    if (snapshot->TotalMaximumBufferedBytes() >
+        optimization_params.ram_budget()) {
+      parameter.value = previous_value;
+      exhausted_.insert(tunable.key);
+      continue;
+    }
+    VLOG(2) << "Trying " << tunable.key << " = " << value << " (was "
+            << previous_value << ").";
+    trial_ = Trial{tunable.key, previous_value};
+    return true;
+  }
+  return false;
+}
+
+void LearnedAutotuner::RecordBest(const std::vector<Tunable>& tunables,
+                                  double throughput) {
+  best_values_.clear();
+  for (const Tunable& tunable : tunables) {
+    best_values_[tunable.key] = tunable.parameter->value;
+  }
+  best_throughput_ = throughput;
+  SaveState();
+}
+
+std::string LearnedAutotuner::StateFilename() const {
+  return io::JoinPath(
+      state_directory_,
+      strings::StrCat(strings::Hex(fingerprint_, strings::kZeroPad16),
+                      kLearnedStateFileSuffix));
+}
+
+void LearnedAutotuner::LoadState(std::vector<Tunable>& tunables) {
+  if (state_directory_.empty()) {
+    return;
+  }
+  LearnedAutotuneSettings settings;
+  absl::Status s =
+      ReadBinaryProto(Env::Default(), StateFilename(), &settings);
+  if (!s.ok()) {
+    if (!absl::IsNotFound(s)) {
+      LOG(WARNING) << "Failed to read learned autotuning settings from "
+                   << StateFilename() << ": " << s;
+    }
+    return;
+  }
+  if (settings.fingerprint() != fingerprint_) {
+    return;
+  }
+  int64_t num_restored = 0;
+  for (Tunable& tunable : tunables) {
+    auto it = settings.parameter_values().find(tunable.key);
+    if (it == settings.parameter_values().end()) {
+      continue;
+    }
+    Parameter& parameter = *tunable.parameter;
+    parameter.value = std::clamp(it->second, parameter.min, parameter.max);
+    ++num_restored;
+  }
+  VLOG(1) << "Restored " << num_restored << " learned autotuning parameter "
+          << "values from " << StateFilename() << ".";
+}
+
+void LearnedAutotuner::SaveState() const {
+  if (state_directory_.empty() || best_values_.empty()) {
+    return;
+  }
+  LearnedAutotuneSettings settings;
+  settings.set_fingerprint(fingerprint_);
+  settings.set_throughput(best_throughput_);
+  for (const auto& [key, value] : best_values_) {
+    (*settings.mutable_parameter_values())[key] = value;
+  }
+  const std::string filename = StateFilename();
+  // Jobs running the same pipeline may share the state directory, so each
+  // save writes its own temporary file and renames it over the state file.
+  std::string tmp_filename = strings::StrCat(filename, "__");
+  absl::Status s = Env::Default()->RecursivelyCreateDir(state_directory_);
+  if (s.ok() && !Env::Default()->CreateUniqueFileName(&tmp_filename, ".tmp")) {
+    s = errors::Internal("Unable to create a temporary file name.");
+  }
+  if (s.ok()) {
+    s = WriteBinaryProto(Env::Default(), tmp_filename, settings);
+  }
+  if (s.ok()) {
+    s = Env::Default()->RenameFile(tmp_filename, filename);
+  }
+  if (!s.ok()) {
+    if (Env::Default()->FileExists(tmp_filename).ok()) {
+      Env::Default()->DeleteFile(tmp_filename).IgnoreError();
+    }
+    LOG(WARNING) << "Failed to save learned autotuning settings to "
+                 << filename << ": " << s;
+  }
+}
+
 ModelTiming::ModelTiming(std::shared_ptr<Node> root) : root_(root) {
   DCHECK(root_.get() != nullptr);
   auto bfs_nodes = CollectNodes(root_, TraversalOrder::BFS, IsAnyNode);
@@ -915,6 +915,107 @@ std::shared_ptr<Node> MakeAsyncUnknownRatioNode(
 // as pass-through between inputs and output.
 std::shared_ptr<Node> MakeUnknownNode(Node::Args args);
 
+// Implements the `LEARNED` autotuning algorithm.
+//
+// Instead of deriving parameter values from an analytical model of the input
+// pipeline, which misjudges transformations whose time is dominated by IO
+// rather than CPU, the autotuner measures the throughput of the pipeline
+// between consecutive optimization rounds and searches for the parameter
+// values that maximize it. Each round evaluates the trial started by the
+// previous round -- a single parameter increase -- keeping it if throughput
+// improved and reverting it otherwise, and then starts a new trial. The order
+// in which parameters are tried is guided by per-node histograms of the
+// processing time per element recorded over the lifetime of the pipeline.
+//
+// If `state_directory` is non-empty, the best values found are persisted there,
+// keyed by a fingerprint of the pipeline structure, and a pipeline with the
+// same structure starts tuning from them.
+//
+// This class is thread-compatible.
+class LearnedAutotuner {
+ public:
+  // Returns the current time in nanoseconds.
+  using Clock = std::function<uint64_t()>;
+
+  explicit LearnedAutotuner(std::string state_directory);
+  LearnedAutotuner(std::string state_directory, Clock clock);
+
+  LearnedAutotuner(const LearnedAutotuner&) = delete;
+  LearnedAutotuner& operator=(const LearnedAutotuner&) = delete;
+
+  // Runs one optimization round on the pipeline rooted at `snapshot`.
+  void Optimize(std::shared_ptr<Node> snapshot,
+                const ModelProto::OptimizationParams& optimization_params,
+                CancellationManager* cancellation_manager,
+                RamBudgetManager& ram_budget_manager);
+
+  // Returns the fingerprint of the tuned pipeline, or 0 before the first
+  // round that found tunable parameters.
+  uint64_t fingerprint() const { return fingerprint_; }
+
+  // Returns the throughput in elements per second of the best parameter
+  // values found so far.
+  double best_throughput() const { return best_throughput_; }
+
+  // Returns whether every parameter has been tried without improvement since
+  // the best configuration last changed.
+  bool converged() const { return converged_; }
+
+ private:
+  struct Tunable {
+    // Identifies the parameter across runs of the same pipeline.
+    std::string key;
+    // Identifies the node the parameter belongs to.
+    std::string node_key;
+    std::shared_ptr<Parameter> parameter;
+  };
+
+  struct Trial {
+    std::string key;
+    double previous_value;
+  };
+
+  struct NodeHistory {
+    int64_t num_elements = 0;
+    int64_t processing_time = 0;
+    // Processing time per element in nanoseconds, one sample per round.
+    histogram::Histogram processing_time_per_element;
+  };
+
+  // Collects the tunable parameters of the pipeline and records processing
+  // times of its nodes.
+  std::vector<Tunable> CollectTunables(std::shared_ptr<Node> snapshot);
+
+  // Starts a trial on the most promising parameter that has not been tried
+  // since the best configuration last changed. Returns false if there is none.
+  bool StartTrial(std::shared_ptr<Node> snapshot,
+                  const ModelProto::OptimizationParams& optimization_params,
+                  std::vector<Tunable>& tunables);
+
+  // Records the current parameter values as the best configuration.
+  void RecordBest(const std::vector<Tunable>& tunables, double throughput);
+
+  std::string StateFilename() const;
+  void LoadState(std::vector<Tunable>& tunables);
+  void SaveState() const;
+
+  const std::string state_directory_;
+  const Clock clock_;
+  uint64_t fingerprint_ = 0;
+  absl::flat_hash_map<std::string, std::unique_ptr<NodeHistory>> histories_;
+  // Parameter values of the best configuration found so far.
+  absl::flat_hash_map<std::string, double> best_values_;
+  double best_throughput_ = 0.0;
+  std::optional<Trial> trial_;
+  // Parameters that did not improve throughput since the best configuration
+  // last changed or the search was last restarted.
+  absl::flat_hash_set<std::string> exhausted_;
+  bool converged_ = false;
+  int64_t rounds_since_converged_ = 0;
+  uint64_t last_time_nsec_ = 0;
+  int64_t last_num_elements_ = 0;
+};
+
 // Abstract representation of a TensorFlow input pipeline that can be used
 // for collecting runtime information and optimizing performance. It collects
 // runtime information about execution of the input pipeline that is used to
@@ -951,6 +1052,14 @@ class Model {
     experiments_.insert(experiment);
   }
 
+  // Sets the directory in which the `LEARNED` algorithm persists tuned
+  // parameter values. Must be called before the optimization starts.
+  void SetLearnedAutotuneStateDirectory(const std::string& directory)
+      TF_LOCKS_EXCLUDED(mu_) {
+    mutex_lock l(mu_);
+    learned_autotune_state_directory_ = directory;
+  }
+
   // Adds a node with the given name and given parent.
   void AddNode(Node::Factory factory, const string& name,
                std::shared_ptr<Node> parent, std::shared_ptr<Node>* out_node)
@@ -1218,6 +1327,11 @@ class Model {
   OptimizationParams optimization_params_ TF_GUARDED_BY(mu_);
   // Stores the model id in the string format
   std::string model_id_;
+  // Directory in which the `LEARNED` algorithm persists its state.
+  std::string learned_autotune_state_directory_ TF_GUARDED_BY(mu_);
+  // Created by the first optimization that uses the `LEARNED` algorithm. Only
+  // accessed from the optimization thread.
+  std::unique_ptr<LearnedAutotuner> learned_autotuner_;
 };
 
 // Class to compute timing information for a model.
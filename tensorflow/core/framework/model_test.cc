@@ -16,6 +16,7 @@ limitations under the License.
 #include "tensorflow/core/framework/model.h"
 
 #include <algorithm>
+#include <cmath>
 #include <cstdint>
 #include <cstdlib>
 #include <functional>
@@ -24,6 +25,7 @@ limitations under the License.
 #include <string>
 #include <tuple>
 #include <utility>
+#include <vector>
 
 #include <gtest/gtest.h>
 #include "absl/status/status.h"
@@ -34,8 +36,11 @@ limitations under the License.
 #include "tensorflow/core/lib/core/threadpool.h"
 #include "tensorflow/core/lib/gtl/cleanup.h"
 #include "tensorflow/core/lib/monitoring/cell_reader.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/path.h"
 #include "tensorflow/core/platform/stringprintf.h"
 #include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
 
 namespace tensorflow {
 namespace data {
@@ -3695,6 +3700,209 @@ TEST(NodeTest, TotalMaximumBufferedBytesNoValueWhenElementSizeNotProvided) {
   EXPECT_EQ(root->TotalMaximumBufferedBytes(), 0.);
 }
 
+// Simulates an IO-bound `ParallelMapV2 <- ParallelInterleaveV4 <- TensorSlice`
+// pipeline in which each map element takes 2ms of CPU time and each
+// interleave element waits 5ms for IO, on a machine with `kCores` cores.
+class SimulatedPipeline {
+ public:
+  static constexpr int64_t kCores = 16;
+  static constexpr int64_t kMapCpuNsec = 2'000'000;
+  static constexpr int64_t kInterleaveCpuNsec = 50'000;
+  static constexpr int64_t kInterleaveIoNsec = 5'000'000;
+  static constexpr int64_t kRoundNsec = 100'000'000;
+
+  SimulatedPipeline() {
+    model_.AddNode(
+        [](Node::Args args) {
+          return MakeAsyncKnownRatioNode(std::move(args), /*ratio=*/1,
+                                         {MakeParallelism()});
+        },
+        "ParallelMapV2", nullptr, &map_);
+    model_.AddNode(
+        [](Node::Args args) {
+          return MakeAsyncInterleaveManyNode(
+              std::move(args),
+              {MakeParallelism(), MakeParameter(kCycleLength, nullptr,
+                                                /*min=*/64, /*max=*/64)});
+        },
+        "ParallelInterleaveV4", map_, &interleave_);
+    model_.AddNode([](Node::Args args) { return MakeSourceNode(args); },
+                   "TensorSlice", interleave_, &source_);
+  }
+
+  // Returns the throughput for the current parameter values in elements per
+  // second.
+  double Throughput() const {
+    return std::min({map_->parameter_value(kParallelism) * 1e9 / kMapCpuNsec,
+                     interleave_->parameter_value(kParallelism) * 1e9 /
+                         kInterleaveIoNsec,
+                     OptimalThroughput()});
+  }
+
+  static double OptimalThroughput() { return kCores * 1e9 / kMapCpuNsec; }
+
+  // Runs the pipeline for one optimization round and returns its throughput.
+  double Step() {
+    const double throughput = Throughput();
+    const int64_t num_elements = throughput * kRoundNsec / 1e9;
+    for (int64_t i = 0; i < num_elements; ++i) {
+      map_->record_element();
+      interleave_->record_element();
+      source_->record_element();
+    }
+    map_->add_processing_time(num_elements * kMapCpuNsec);
+    interleave_->add_processing_time(num_elements * kInterleaveCpuNsec);
+    now_nsec_ += kRoundNsec;
+    return throughput;
+  }
+
+  LearnedAutotuner::Clock clock() {
+    return [this]() { return now_nsec_; };
+  }
+
+  Model& model() { return model_; }
+  std::shared_ptr<Node> output() const { return map_; }
+  std::shared_ptr<Node> interleave() const { return interleave_; }
+
+ private:
+  static std::shared_ptr<Parameter> MakeParallelism() {
+    auto state =
+        std::make_shared<SharedState>(kAutotune, std::make_shared<mutex>(),
+                                      std::make_shared<condition_variable>());
+    state->value = 1;
+    return MakeParameter(kParallelism, state, /*min=*/1, /*max=*/64);
+  }
+
+  Model model_;
+  std::shared_ptr<Node> map_;
+  std::shared_ptr<Node> interleave_;
+  std::shared_ptr<Node> source_;
+  uint64_t now_nsec_ = 0;
+};
+
+ModelProto::OptimizationParams LearnedOptimizationParams() {
+  ModelProto::OptimizationParams params;
+  params.set_algorithm(AutotuneAlgorithm::LEARNED);
+  params.set_cpu_budget(SimulatedPipeline::kCores);
+  params.set_ram_budget(1LL << 30);
+  return params;
+}
+
+void RunLearnedAutotuner(SimulatedPipeline& pipeline,
+                         LearnedAutotuner& autotuner, int64_t rounds) {
+  CancellationManager cancellation_manager;
+  RamBudgetManager ram_budget_manager(1LL << 30);
+  for (int64_t i = 0; i < rounds; ++i) {
+    pipeline.Step();
+    autotuner.Optimize(pipeline.output(), LearnedOptimizationParams(),
+                       &cancellation_manager, ram_budget_manager);
+  }
+}
+
+TEST(LearnedAutotunerTest, ConvergesOnIoBoundPipeline) {
+  SimulatedPipeline pipeline;
+  LearnedAutotuner autotuner(/*state_directory=*/"", pipeline.clock());
+  RunLearnedAutotuner(pipeline, autotuner, /*rounds=*/100);
+  EXPECT_GE(pipeline.Throughput(),
+            0.9 * SimulatedPipeline::OptimalThroughput());
+  // Hiding the IO latency takes more parallelism than the processing time of
+  // the interleave suggests.
+  EXPECT_GE(pipeline.interleave()->parameter_value(kParallelism),
+            0.9 * SimulatedPipeline::OptimalThroughput() *
+                SimulatedPipeline::kInterleaveIoNsec / 1e9);
+  EXPECT_NE(autotuner.fingerprint(), 0);
+}
+
+TEST(LearnedAutotunerTest, StartsFromPersistedValues) {
+  const std::string directory =
+      io::JoinPath(::tensorflow::testing::TmpDir(), "learned_autotune_state");
+  SimulatedPipeline trained;
+  LearnedAutotuner trained_autotuner(directory, trained.clock());
+  RunLearnedAutotuner(trained, trained_autotuner, /*rounds=*/100);
+
+  SimulatedPipeline pipeline;
+  LearnedAutotuner autotuner(directory, pipeline.clock());
+  RunLearnedAutotuner(pipeline, autotuner, /*rounds=*/1);
+  EXPECT_EQ(autotuner.fingerprint(), trained_autotuner.fingerprint());
+  EXPECT_GE(pipeline.Throughput(),
+            0.9 * SimulatedPipeline::OptimalThroughput());
+  // Saves go through uniquely named temporary files that are renamed over the
+  // state file, so only the state file is left.
+  std::vector<string> children;
+  TF_ASSERT_OK(Env::Default()->GetChildren(directory, &children));
+  EXPECT_EQ(children.size(), 1);
+
+  int64_t undeleted_files, undeleted_dirs;
+  TF_ASSERT_OK(Env::Default()->DeleteRecursively(directory, &undeleted_files,
+                                                 &undeleted_dirs));
+}
+
+// Reports the number of optimization rounds after which the throughput of
+// the simulated pipeline stays within 2% of its final value, and the final
+// throughput as a fraction of the optimum. The second argument selects
+// whether `LEARNED` starts from the values persisted by a previous run.
+void BM_AutotuneTimeToSteadyState(::testing::benchmark::State& state) {
+  const auto algorithm = static_cast<AutotuneAlgorithm>(state.range(0));
+  const bool warm_start = state.range(1);
+  constexpr int64_t kRounds = 200;
+  std::string directory;
+  if (warm_start) {
+    directory = io::JoinPath(::tensorflow::testing::TmpDir(),
+                             "bm_learned_autotune_state");
+    SimulatedPipeline pipeline;
+    LearnedAutotuner autotuner(directory, pipeline.clock());
+    RunLearnedAutotuner(pipeline, autotuner, kRounds);
+  }
+
+  CancellationManager cancellation_manager;
+  int64_t rounds_to_steady_state = 0;
+  double throughput_fraction = 0.0;
+  for (auto s : state) {
+    SimulatedPipeline pipeline;
+    LearnedAutotuner autotuner(directory, pipeline.clock());
+    RamBudgetManager ram_budget_manager(1LL << 30);
+    std::vector<double> throughputs;
+    for (int64_t i = 0; i < kRounds; ++i) {
+      throughputs.push_back(pipeline.Step());
+      if (algorithm == AutotuneAlgorithm::LEARNED) {
+        autotuner.Optimize(pipeline.output(), LearnedOptimizationParams(),
+                           &cancellation_manager, ram_budget_manager);
+      } else {
+        pipeline.model().Optimize(
+            algorithm, CpuBudgetFunc(SimulatedPipeline::kCores),
+            /*ram_budget_share=*/1.0, /*fixed_ram_budget=*/1LL << 30,
+            /*model_input_time=*/0, ram_budget_manager,
+            &cancellation_manager);
+      }
+    }
+    const double final_throughput = pipeline.Throughput();
+    rounds_to_steady_state = kRounds;
+    while (rounds_to_steady_state > 0 &&
+           std::abs(throughputs[rounds_to_steady_state - 1] -
+                    final_throughput) <= 0.02 * final_throughput) {
+      --rounds_to_steady_state;
+    }
+    throughput_fraction =
+        final_throughput / SimulatedPipeline::OptimalThroughput();
+  }
+  state.counters["rounds_to_steady_state"] = rounds_to_steady_state;
+  state.counters["throughput_fraction"] = throughput_fraction;
+
+  if (warm_start) {
+    int64_t undeleted_files, undeleted_dirs;
+    Env::Default()
+        ->DeleteRecursively(directory, &undeleted_files, &undeleted_dirs)
+        .IgnoreError();
+  }
+}
+
+BENCHMARK(BM_AutotuneTimeToSteadyState)
+    ->ArgPair(AutotuneAlgorithm::HILL_CLIMB, 0)
+    ->ArgPair(AutotuneAlgorithm::STAGE_BASED, 0)
+    ->ArgPair(AutotuneAlgorithm::MAX_PARALLELISM, 0)
+    ->ArgPair(AutotuneAlgorithm::LEARNED, 0)
+    ->ArgPair(AutotuneAlgorithm::LEARNED, 1);
+
 }  // namespace
 }  // namespace model
 }  // namespace data
@@ -32,6 +32,7 @@ limitations under the License.
 #include "tensorflow/core/framework/attr_value_util.h"
 #include "tensorflow/core/framework/device_attributes.pb.h"
 #include "tensorflow/core/framework/device_factory.h"
+#include "tensorflow/core/framework/function.h"
 #include "tensorflow/core/framework/graph.pb.h"
 #include "tensorflow/core/framework/kernel_def.pb.h"
 #include "tensorflow/core/framework/kernel_def_util.h"
@@ -41,6 +42,7 @@ limitations under the License.
 #include "tensorflow/core/framework/node_def_util.h"
 #include "tensorflow/core/framework/node_properties.h"
 #include "tensorflow/core/framework/op_def_util.h"
+#include "tensorflow/core/framework/step_arena_allocator.h"
 #include "tensorflow/core/framework/tensor_reference.h"
 #include "tensorflow/core/framework/types.h"
 #include "tensorflow/core/lib/core/errors.h"
@@ -571,7 +573,11 @@ std::unique_ptr<Tensor> OpKernelContext::forward_input(
     return nullptr;
   }
   if (!forward_expected) {
-    if (!input->RefCountIsOne()) {
+    // The buffer of a planned input may only be referenced by other inputs of
+    // this kernel.
+    const bool forward_planned = params_->forwardable_inputs != nullptr &&
+                                 params_->forwardable_inputs[input_index];
+    if (!forward_planned && !input->RefCountIsOne()) {
       return nullptr;
     }
     // Check that output allocator attributes are not more restrictive than
@@ -608,6 +614,29 @@ absl::Status OpKernelContext::forward_input_or_allocate_temp(
 absl::Status OpKernelContext::forward_input_or_allocate_output(
     absl::Span<const int> candidate_input_indices, int output_index,
     const TensorShape& output_shape, Tensor** output, int* forwarded_input) {
+  // Allocating an output in the memory reserved for its return value saves
+  // the caller a copy, which forwarding an input would not.
+  if (TF_PREDICT_FALSE(params_->output_retval_indices != nullptr) &&
+      params_->output_retval_indices[output_index] >= 0 &&
+      mutable_output(output_index) == nullptr &&
+      (params_->forward_from_array == nullptr ||
+       params_->forward_from_array[output_index] < 0)) {
+    const DataType type = params_->op_kernel->output_type(output_index);
+    const auto output_attr = params_->output_attr_array == nullptr
+                                 ? AllocatorAttributes()
+                                 : output_alloc_attr(output_index);
+    auto output_tensor = std::make_unique<Tensor>();
+    if (!IsRefType(type) &&
+        allocate_retval_output(output_index, type, output_shape, output_attr,
+                               output_tensor.get())) {
+      outputs_[output_index] = TensorValue(output_tensor.release());
+      *output = outputs_[output_index].tensor;
+      if (forwarded_input != nullptr) {
+        *forwarded_input = -1;
+      }
+      return absl::OkStatus();
+    }
+  }
   for (int input_index : candidate_input_indices) {
     if (forward_input_to_output_with_shape(input_index, output_index,
                                            output_shape, output)) {
@@ -766,6 +795,9 @@ absl::Status OpKernelContext::allocate_tensor(
     DataType type, const TensorShape& shape, Tensor* out_tensor,
     AllocatorAttributes attr, const AllocationAttributes& allocation_attr) {
   Allocator* a = get_allocator(attr);
+  if (TF_PREDICT_FALSE(params_->step_arena != nullptr)) {
+    a = maybe_get_step_arena(type, shape, attr, a);
+  }
   Tensor new_tensor(
       a, type, shape,
       AllocationAttributes(
@@ -786,6 +818,70 @@ absl::Status OpKernelContext::allocate_tensor(
   return absl::OkStatus();
 }
 
+Allocator* OpKernelContext::maybe_get_step_arena(DataType type,
+                                                 const TensorShape& shape,
+                                                 AllocatorAttributes attr,
+                                                 Allocator* allocator) {
+  StepArenaAllocator* step_arena = params_->step_arena;
+  const int64_t num_bytes = shape.num_elements() * DataTypeSize(type);
+  // Only tensors without destructors are allocated from the arena, and only
+  // if the arena holds the same kind of memory as `allocator`.
+  if (params_->use_step_arena && attr.scope_id <= 0 && !track_allocations() &&
+      DataTypeCanUseMemcpy(type) &&
+      num_bytes <= StepArenaAllocator::kMaxAllocationBytes &&
+      allocator == step_arena->backing_allocator() &&
+      step_arena->has_capacity()) {
+    return step_arena;
+  }
+  step_arena->RecordFallbackAllocation(num_bytes);
+  return allocator;
+}
+
+bool OpKernelContext::allocate_planned_output(int index, DataType type,
+                                              const TensorShape& shape,
+                                              AllocatorAttributes attr,
+                                              Tensor* out_tensor) {
+  if (attr.scope_id > 0 || track_allocations() ||
+      !DataTypeCanUseMemcpy(type) ||
+      get_allocator(attr) != params_->planned_output_backing_allocator) {
+    return false;
+  }
+  Tensor new_tensor(params_->planned_output_allocators[index], type, shape,
+                    AllocationAttributes(/*retry_on_failure=*/false,
+                                         /*allocation_will_be_logged=*/true,
+                                         /*freed_by_func=*/nullptr));
+  if (!new_tensor.IsInitialized()) {
+    return false;
+  }
+  if (params_->log_memory) {
+    LogMemory::RecordTensorAllocation(params_->op_kernel->name(),
+                                      params_->step_id, new_tensor);
+  }
+  *out_tensor = std::move(new_tensor);
+  return true;
+}
+
+bool OpKernelContext::allocate_retval_output(int index, DataType type,
+                                             const TensorShape& shape,
+                                             AllocatorAttributes attr,
+                                             Tensor* out_tensor) {
+  if (params_->call_frame == nullptr || attr.scope_id > 0 ||
+      track_allocations() || !DataTypeCanUseMemcpy(type)) {
+    return false;
+  }
+  Tensor slot;
+  if (!params_->call_frame->GetRetvalSlot(
+          params_->output_retval_indices[index], type, shape, &slot)) {
+    return false;
+  }
+  if (params_->log_memory) {
+    LogMemory::RecordTensorAllocation(params_->op_kernel->name(),
+                                      params_->step_id, slot);
+  }
+  *out_tensor = std::move(slot);
+  return true;
+}
+
 absl::Status OpKernelContext::allocate_output(int index,
                                               const TensorShape& shape,
                                               Tensor** output,
@@ -825,7 +921,20 @@ absl::Status OpKernelContext::allocate_output(int index,
       op_kernel().name_view().data(), step_id(), "output", type,
       [&shape]() { return shape.DebugString(); });
   auto output_tensor = std::make_unique<Tensor>();
-  absl::Status s = allocate_tensor(type, shape, output_tensor.get(), attr);
+  absl::Status s;
+  if (TF_PREDICT_FALSE(params_->output_retval_indices != nullptr) &&
+      params_->output_retval_indices[index] >= 0 &&
+      allocate_retval_output(index, type, shape, attr, output_tensor.get())) {
+    s = absl::OkStatus();
+  } else if (TF_PREDICT_FALSE(params_->planned_output_allocators !=
+                              nullptr) &&
+             params_->planned_output_allocators[index] != nullptr &&
+             allocate_planned_output(index, type, shape, attr,
+                                     output_tensor.get())) {
+    s = absl::OkStatus();
+  } else {
+    s = allocate_tensor(type, shape, output_tensor.get(), attr);
+  }
   if (s.ok()) {
     outputs_[index] = TensorValue(output_tensor.release());
     *output = outputs_[index].tensor;
@@ -94,6 +94,7 @@ class OpRegistryInterface;
 class ResourceMgr;
 class ScopedStepContainer;
 class CollectiveExecutor;
+class StepArenaAllocator;
 class StepStatsCollectorInterface;
 
 // A label that is added to kernels that are JIT compiled. These labels will be
@@ -703,6 +704,36 @@ class OpKernelContext {
 
     // For access to distributed coordination service.
     tsl::CoordinationServiceAgent* coordination_service_agent = nullptr;
+
+    // If not null, the arena of the step, which records the bytes of the
+    // tensors allocated outside of it. If `use_step_arena` is also true, the
+    // outputs and temporaries of this op kernel do not outlive the step, and
+    // small host tensors are allocated from the arena.
+    StepArenaAllocator* step_arena = nullptr;
+    bool use_step_arena = false;
+
+    // If not null, an allocator for each output of this op kernel, which
+    // returns the memory assigned to the output by a static memory plan, or
+    // null for outputs without planned memory. The planned memory is part of
+    // a buffer allocated from `planned_output_backing_allocator`. The
+    // allocators fail if the size of an output differs from the plan, in
+    // which case the output is allocated as usual.
+    Allocator* const* planned_output_allocators = nullptr;
+    Allocator* planned_output_backing_allocator = nullptr;
+
+    // If not null, contains for each output of this op kernel the index of
+    // the function return value which the output becomes, or -1. Such an
+    // output is allocated in the memory that `call_frame` reserves for the
+    // return value, if any.
+    const int* output_retval_indices = nullptr;
+
+    // If not null, marks the inputs whose buffer the executor has determined
+    // ahead of time to be referenced only by the inputs of this kernel, e.g.
+    // because the kernel is the last use of a tensor which its producer and
+    // other consumers do not alias. Marked inputs may be forwarded without
+    // checking their reference count, so that a kernel which consumes a
+    // tensor twice, as in x * x, can compute in place.
+    const bool* forwardable_inputs = nullptr;
   };
 
   // params must outlive the OpKernelContext.
@@ -1289,6 +1320,31 @@ class OpKernelContext {
                                AllocatorAttributes allocator_attr,
                                const AllocationAttributes& allocation_attr);
 
+  // Returns `params_->step_arena` if a tensor of `type` and `shape` can be
+  // allocated from it instead of from `allocator`, and `allocator` otherwise.
+  //
+  // REQUIRES: `params_->step_arena != nullptr`.
+  Allocator* maybe_get_step_arena(DataType type, const TensorShape& shape,
+                                  AllocatorAttributes attr,
+                                  Allocator* allocator);
+
+  // Allocates output `index` from `params_->planned_output_allocators`.
+  // Returns false if the output cannot use its planned memory.
+  //
+  // REQUIRES: `params_->planned_output_allocators[index] != nullptr`.
+  bool allocate_planned_output(int index, DataType type,
+                               const TensorShape& shape,
+                               AllocatorAttributes attr, Tensor* out_tensor);
+
+  // Allocates output `index` in the memory that `params_->call_frame`
+  // reserves for the return value which the output becomes. Returns false if
+  // the call frame has not reserved memory of `type` and `shape` for it.
+  //
+  // REQUIRES: `params_->output_retval_indices[index] >= 0`.
+  bool allocate_retval_output(int index, DataType type,
+                              const TensorShape& shape,
+                              AllocatorAttributes attr, Tensor* out_tensor);
+
   // Helpers for `set_output()`.
 
   // Returns `true` if the tensor was copied into an allocated output.
@@ -152,7 +152,8 @@ absl::Status RendezvousInterface::Recv(const ParsedKey& key, const Args& args,
 namespace {
 class LocalRendezvousWrapper : public Rendezvous {
  public:
-  LocalRendezvousWrapper(int num_shards) : impl_(this, num_shards) {}
+  LocalRendezvousWrapper(int num_shards, int64_t num_slots)
+      : impl_(this, num_shards, num_slots) {}
 
   absl::Status Send(const ParsedKey& key, const Args& send_args,
                     const Tensor& val, const bool is_dead) override {
@@ -164,6 +165,17 @@ class LocalRendezvousWrapper : public Rendezvous {
     impl_.RecvAsync(key, recv_args, std::move(done));
   }
 
+  absl::Status SendToSlot(int64_t slot, const ParsedKey& key,
+                          const Args& send_args, const Tensor& val,
+                          const bool is_dead) override {
+    return impl_.SendToSlot(slot, key, send_args, val, is_dead);
+  }
+
+  void RecvFromSlotAsync(int64_t slot, const ParsedKey& key,
+                         const Args& recv_args, DoneCallback done) override {
+    impl_.RecvFromSlotAsync(slot, key, recv_args, std::move(done));
+  }
+
   void StartAbort(const absl::Status& status) override {
     impl_.StartAbort(status);
   }
@@ -176,8 +188,8 @@ class LocalRendezvousWrapper : public Rendezvous {
 };
 }  // namespace
 
-Rendezvous* NewLocalRendezvous(int num_shards) {
-  return new LocalRendezvousWrapper(num_shards);
+Rendezvous* NewLocalRendezvous(int num_shards, int64_t num_slots) {
+  return new LocalRendezvousWrapper(num_shards, num_slots);
 }
 
 }  // end namespace tensorflow
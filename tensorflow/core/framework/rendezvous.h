@@ -16,6 +16,7 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_FRAMEWORK_RENDEZVOUS_H_
 #define TENSORFLOW_CORE_FRAMEWORK_RENDEZVOUS_H_
 
+#include <cstdint>
 #include <string>
 #include <utility>
 
@@ -111,6 +112,28 @@ class RendezvousInterface {
   absl::Status Recv(const ParsedKey& key, const Args& args, Tensor* val,
                     bool* is_dead);
 
+  // Like Send() and RecvAsync(), but the message is exchanged through the
+  // preallocated slot with index "slot" instead of a table keyed by "key".
+  //
+  // Slots are assigned to Send/Recv pairs outside of any loop when a graph
+  // is partitioned (see PartitionOptions::use_rendezvous_slots), so each
+  // slot carries at most one message. "key" must be the key of the pair in
+  // the root frame; it is still used to copy the tensor between devices,
+  // and must remain valid until "done" is called.
+  //
+  // The default implementations ignore "slot" and fall back to the keyed
+  // Send() and RecvAsync(), as do implementations whose slot table is
+  // smaller than "slot".
+  virtual absl::Status SendToSlot(int64_t slot, const ParsedKey& key,
+                                  const Args& args, const Tensor& val,
+                                  const bool is_dead) {
+    return Send(key, args, val, is_dead);
+  }
+  virtual void RecvFromSlotAsync(int64_t slot, const ParsedKey& key,
+                                 const Args& args, DoneCallback done) {
+    RecvAsync(key, args, std::move(done));
+  }
+
   // Aborts all pending and future Send/Recv with the given "status".
   //
   // StartAbort() does not wait for ongoing calls to finish.
@@ -170,7 +193,7 @@ class Rendezvous : public RendezvousInterface, public core::WeakRefCounted {
 // Returns a Rendezvous instance that is limited to use only by
 // producers and consumers in the local process.  The caller assumes
 // ownership of one Ref() on the returned object.
-Rendezvous* NewLocalRendezvous(int num_shards = 1);
+Rendezvous* NewLocalRendezvous(int num_shards = 1, int64_t num_slots = 0);
 
 }  // end namespace tensorflow
 
@@ -15,6 +15,9 @@ limitations under the License.
 
 #include "tensorflow/core/framework/rendezvous.h"
 
+#include <cstdint>
+#include <vector>
+
 #include "absl/status/status.h"
 #include "unsupported/Eigen/CXX11/Tensor"  // from @eigen_archive
 #include "tensorflow/core/framework/cancellation.h"
@@ -394,6 +397,120 @@ TEST_F(LocalRendezvousTest, AbortThenRecvOrSend) {
   EXPECT_TRUE(absl::IsAborted(rendez_->Recv(KeyFoo(), args, &val, &val_dead)));
 }
 
+// Receives the message in `slot` of `rendez`, waiting for it to arrive.
+absl::Status RecvFromSlot(Rendezvous* rendez, int64_t slot,
+                          const Rendezvous::ParsedKey& key,
+                          const Rendezvous::Args& args, Tensor* val,
+                          bool* is_dead) {
+  absl::Status status;
+  Notification n;
+  rendez->RecvFromSlotAsync(
+      slot, key, args,
+      [&status, &n, val, is_dead](const absl::Status& s,
+                                  const Rendezvous::Args& /*send_args*/,
+                                  const Rendezvous::Args& /*recv_args*/,
+                                  const Tensor& v, bool dead) {
+        status = s;
+        *val = v;
+        *is_dead = dead;
+        n.Notify();
+      });
+  n.WaitForNotification();
+  return status;
+}
+
+TEST_F(LocalRendezvousTest, SlotSendRecv) {
+  Rendezvous* rendez = NewLocalRendezvous(/*num_shards=*/1, /*num_slots=*/2);
+  Rendezvous::Args args;
+  TF_ASSERT_OK(rendez->SendToSlot(1, KeyFoo(), args, V("hello"), false));
+  Tensor val(DT_STRING);
+  bool is_dead = false;
+  TF_ASSERT_OK(RecvFromSlot(rendez, 1, KeyFoo(), args, &val, &is_dead));
+  EXPECT_EQ("hello", V(val));
+  EXPECT_FALSE(is_dead);
+
+  // Each slot carries a single message.
+  EXPECT_TRUE(absl::IsInternal(
+      RecvFromSlot(rendez, 1, KeyFoo(), args, &val, &is_dead)));
+  EXPECT_TRUE(
+      absl::IsInternal(rendez->SendToSlot(1, KeyFoo(), args, val, false)));
+  rendez->Unref();
+}
+
+TEST_F(LocalRendezvousTest, SlotRecvSend) {
+  Rendezvous* rendez = NewLocalRendezvous(/*num_shards=*/1, /*num_slots=*/2);
+  SchedClosure([rendez]() {
+    Env::Default()->SleepForMicroseconds(10000);
+    Rendezvous::Args args;
+    TF_ASSERT_OK(rendez->SendToSlot(0, KeyFoo(), args, V("hello"), true));
+  });
+  Tensor val(DT_STRING);
+  bool is_dead = false;
+  Rendezvous::Args args;
+  TF_ASSERT_OK(RecvFromSlot(rendez, 0, KeyFoo(), args, &val, &is_dead));
+  EXPECT_EQ("hello", V(val));
+  EXPECT_TRUE(is_dead);
+  rendez->Unref();
+}
+
+TEST_F(LocalRendezvousTest, SlotOutsideTableUsesKey) {
+  // `rendez_` has no slots.
+  Rendezvous::Args args;
+  TF_ASSERT_OK(rendez_->SendToSlot(0, KeyFoo(), args, V("hello"), false));
+  Tensor val(DT_STRING);
+  bool is_dead = false;
+  TF_ASSERT_OK(rendez_->Recv(KeyFoo(), args, &val, &is_dead));
+  EXPECT_EQ("hello", V(val));
+}
+
+TEST_F(LocalRendezvousTest, SlotCancelAfterRecv) {
+  Rendezvous* rendez = NewLocalRendezvous(/*num_shards=*/1, /*num_slots=*/1);
+  auto* cm = new CancellationManager();
+  Notification n;
+  SchedClosure([cm, &n]() {
+    Env::Default()->SleepForMicroseconds(10000);
+    cm->StartCancel();
+    n.Notify();
+  });
+  Tensor val(DT_STRING);
+  bool is_dead = false;
+  Rendezvous::Args args;
+  args.cancellation_manager = cm;
+  auto s = RecvFromSlot(rendez, 0, KeyFoo(), args, &val, &is_dead);
+  EXPECT_TRUE(absl::IsCancelled(s));
+  EXPECT_EQ("RecvAsync is cancelled.", s.message());
+  n.WaitForNotification();
+  delete cm;
+
+  // The message for the cancelled receiver is dropped.
+  TF_EXPECT_OK(rendez->SendToSlot(0, KeyFoo(), Rendezvous::Args(),
+                                  V("hello"), false));
+  rendez->Unref();
+}
+
+TEST_F(LocalRendezvousTest, SlotRecvAbort) {
+  Rendezvous* rendez = NewLocalRendezvous(/*num_shards=*/1, /*num_slots=*/2);
+  TF_ASSERT_OK(rendez->SendToSlot(1, KeyBar(), Rendezvous::Args(),
+                                  V("hello"), false));
+  rendez->Ref();
+  SchedClosure([rendez]() {
+    Env::Default()->SleepForMicroseconds(10000);
+    rendez->StartAbort(errors::Aborted(""));
+    rendez->Unref();
+  });
+  Tensor val(DT_STRING);
+  bool is_dead = false;
+  Rendezvous::Args args;
+  EXPECT_TRUE(absl::IsAborted(
+      RecvFromSlot(rendez, 0, KeyFoo(), args, &val, &is_dead)));
+  // The aborted rendezvous drops the messages in its slots.
+  EXPECT_TRUE(absl::IsAborted(
+      RecvFromSlot(rendez, 1, KeyBar(), args, &val, &is_dead)));
+  EXPECT_TRUE(
+      absl::IsAborted(rendez->SendToSlot(0, KeyFoo(), args, val, false)));
+  rendez->Unref();
+}
+
 class DummyDeviceContext : public DeviceContext {
  public:
   explicit DummyDeviceContext(int stream_id) : stream_id_(stream_id) {}
@@ -478,6 +595,52 @@ void BM_RecvSend(::testing::benchmark::State& state) {
 }
 BENCHMARK(BM_RecvSend);
 
+// Exchanges one message for each of `num_pairs` Send/Recv pairs in a new
+// rendezvous per iteration, like the partitions of a step.
+void SendRecvPairs(::testing::benchmark::State& state, bool use_slots) {
+  const int num_pairs = state.range(0);
+  std::vector<Rendezvous::ParsedKey> keys;
+  for (int i = 0; i < num_pairs; ++i) {
+    keys.push_back(MakeKey(strings::StrCat("edge_", i)));
+  }
+  Tensor orig = V("val");
+  Tensor val(DT_STRING, TensorShape({}));
+  bool is_dead = false;
+  Rendezvous::Args args;
+  auto done = [&val](const absl::Status& /*s*/,
+                     const Rendezvous::Args& /*send_args*/,
+                     const Rendezvous::Args& /*recv_args*/,
+                     const Tensor& tensor,
+                     bool /*is_dead*/) { val = tensor; };
+
+  for (auto s : state) {
+    Rendezvous* rendez =
+        NewLocalRendezvous(/*num_shards=*/1, use_slots ? num_pairs : 0);
+    for (int i = 0; i < num_pairs; ++i) {
+      if (use_slots) {
+        TF_CHECK_OK(rendez->SendToSlot(i, keys[i], args, orig, is_dead));
+        rendez->RecvFromSlotAsync(i, keys[i], args, done);
+      } else {
+        TF_CHECK_OK(rendez->Send(keys[i], args, orig, is_dead));
+        rendez->RecvAsync(keys[i], args, done);
+      }
+    }
+    rendez->Unref();
+  }
+  CHECK_EQ(V(val), V(orig));
+  state.SetItemsProcessed(num_pairs * state.iterations());
+}
+
+void BM_SendRecvKeys(::testing::benchmark::State& state) {
+  SendRecvPairs(state, /*use_slots=*/false);
+}
+BENCHMARK(BM_SendRecvKeys)->Arg(16)->Arg(256);
+
+void BM_SendRecvSlots(::testing::benchmark::State& state) {
+  SendRecvPairs(state, /*use_slots=*/true);
+}
+BENCHMARK(BM_SendRecvSlots)->Arg(16)->Arg(256);
+
 void BM_PingPong(::testing::benchmark::State& state) {
   const int messages_count = state.range(0);
   auto* cm = new CancellationManager();
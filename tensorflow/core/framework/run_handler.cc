@@ -736,18 +736,41 @@ class RunHandler::Impl {
   // Stores now time (in microseconds) since unix epoch when the handler is
   // requested via RunHandlerPool::Get().
   uint64 start_time_us() const { return start_time_us_; }
+  // Deadline (in microseconds since unix epoch) of the request, or kuint64max
+  // if the request has no deadline.
+  uint64 deadline_us() const { return deadline_us_; }
   int64_t step_id() const { return step_id_; }
   void ScheduleInterOpClosure(std::function<void()> fn);
   void ScheduleIntraOpClosure(std::function<void()> fn);
 
-  void Reset(int64_t step_id,
+  // Prepares the handler for the request of `step_id`, which called
+  // RunHandlerPool::Get() at `start_time_us`.
+  void Reset(int64_t step_id, uint64 start_time_us,
              const RunOptions::Experimental::RunHandlerPoolOptions& options);
 
+  // Returns the deadline of a request with `options`, which called
+  // RunHandlerPool::Get() at `start_time_us`.
+  static uint64 DeadlineUs(
+      uint64 start_time_us,
+      const RunOptions::Experimental::RunHandlerPoolOptions& options) {
+    return options.deadline_in_ms() > 0
+               ? start_time_us + options.deadline_in_ms() * 1000
+               : kuint64max;
+  }
+
   RunHandlerPool::Impl* pool_impl() { return pool_impl_; }
 
   internal::ThreadWorkSource* tws() { return &tws_; }
 
-  int64_t priority() { return options_.priority(); }
+  int64_t priority() const { return options_.priority(); }
+
+  // Returns true if the ops of this request should be scheduled before the
+  // ops of `other`, i.e. if it has a higher priority, or the same priority
+  // and an earlier deadline.
+  bool RunsBefore(const Impl& other) const {
+    if (priority() != other.priority()) return priority() > other.priority();
+    return deadline_us_ < other.deadline_us_;
+  }
 
  private:
   class ThreadPoolInterfaceWrapper : public thread::ThreadPoolInterface {
@@ -765,6 +788,7 @@ class RunHandler::Impl {
 
   RunHandlerPool::Impl* pool_impl_;  // NOT OWNED.
   uint64 start_time_us_;
+  uint64 deadline_us_;
   int64_t step_id_;
   std::unique_ptr<thread::ThreadPoolInterface> thread_pool_interface_;
   internal::ThreadWorkSource tws_;
@@ -830,6 +854,26 @@ class RunHandlerPool::Impl {
     return !free_handlers_.empty();
   }
 
+  // A request which waits in Get() for a free handler. Waiters get handlers
+  // in the order of their priorities, then their deadlines, then the time of
+  // their Get() call.
+  struct HandlerWaiter {
+    bool RunsBefore(const HandlerWaiter& other) const {
+      if (priority != other.priority) return priority > other.priority;
+      return deadline_us < other.deadline_us;
+    }
+
+    // Returns true if a handler is free and this is the first waiter.
+    bool CanTakeHandler() const TF_NO_THREAD_SAFETY_ANALYSIS {
+      return pool->has_free_handler() && pool->waiters_.front() == this;
+    }
+
+    Impl* pool;
+    int64_t step_id;
+    int64_t priority;
+    uint64 deadline_us;
+  };
+
   std::unique_ptr<RunHandler> Get(
       int64_t step_id, int64_t timeout_in_ms,
       const RunOptions::Experimental::RunHandlerPoolOptions& options)
@@ -842,12 +886,14 @@ class RunHandlerPool::Impl {
                 static_cast<int32>(ParamFromEnvWithDefault(
                     "TF_RUN_HANDLER_MAX_CONCURRENT_HANDLERS",
                     kMaxConcurrentHandlers)));
+    // The deadline of the request includes the time it waits for a handler.
+    const uint64 start_time_us = tensorflow::Env::Default()->NowMicros();
     uint64 version;
     int num_active_requests;
     RunHandler::Impl* handler_impl;
     {
       mutex_lock l(mu_);
-      if (!has_free_handler()) {
+      if (!has_free_handler() || !waiters_.empty()) {
         tsl::profiler::TraceMe activity(
             [&] {
               return strings::StrCat("WaitingForHandler#step_id=", step_id,
@@ -858,28 +904,39 @@ class RunHandlerPool::Impl {
             strings::StrCat("RunHandlerPool::Impl::Get waiting for a handler "
                             "with timeout in millisecond",
                             timeout_in_ms));
+        HandlerWaiter waiter{
+            this, step_id, options.priority(),
+            RunHandler::Impl::DeadlineUs(start_time_us, options)};
+        auto it = waiters_.begin();
+        while (it != waiters_.end() && !waiter.RunsBefore(**it)) ++it;
+        it = waiters_.insert(it, &waiter);
+        const Condition can_take_handler(&waiter,
+                                         &HandlerWaiter::CanTakeHandler);
+        bool has_handler = true;
         if (timeout_in_ms == 0) {
-          mu_.Await(Condition(this, &Impl::has_free_handler));
-        } else if (!mu_.AwaitWithDeadline(
-                       Condition(this, &Impl::has_free_handler),
-                       EnvTime::NowNanos() + timeout_in_ms * 1000 * 1000)) {
-          return nullptr;
+          mu_.Await(can_take_handler);
+        } else {
+          has_handler = mu_.AwaitWithDeadline(
+              can_take_handler,
+              EnvTime::NowNanos() + timeout_in_ms * 1000 * 1000);
         }
+        // Lets the next waiter take a free handler.
+        waiters_.erase(it);
+        if (!has_handler) return nullptr;
       }
       // Remove the last entry from free_handlers_ and add to the end of
       // sorted_active_handlers_.
       handler_impl = free_handlers_.back();
-      handler_impl->Reset(step_id, options);
+      handler_impl->Reset(step_id, start_time_us, options);
       free_handlers_.pop_back();
 
       num_active_requests = sorted_active_handlers_.size() + 1;
       thread_work_sources->resize(num_active_requests);
-      int priority = options.priority();
       auto it = sorted_active_handlers_.cbegin();
       bool new_handler_inserted = false;
       for (int i = 0; i < num_active_requests; ++i) {
         if (!new_handler_inserted && (it == sorted_active_handlers_.cend() ||
-                                      priority > (*it)->priority())) {
+                                      handler_impl->RunsBefore(**it))) {
           sorted_active_handlers_.insert(it, handler_impl);
           new_handler_inserted = true;
           // Point to the newly added handler.
@@ -904,6 +961,9 @@ class RunHandlerPool::Impl {
     uint64 now = tensorflow::EnvTime::NowMicros();
     double elapsed = (now - handler->start_time_us()) / 1000.0;
     time_hist_.Add(elapsed);
+    if (now > handler->deadline_us()) {
+      ++num_deadline_misses_;
+    }
 
     // Erase from and update sorted_active_handlers_. Add it to the end of
     // free_handlers_.
@@ -935,6 +995,25 @@ class RunHandlerPool::Impl {
     return ret;
   }
 
+  std::vector<int64_t> GetActiveHandlerStepIdsForTesting()
+      TF_LOCKS_EXCLUDED(mu_) {
+    mutex_lock l(mu_);
+    std::vector<int64_t> ret;
+    for (const auto& handler_impl : sorted_active_handlers_) {
+      ret.push_back(handler_impl->step_id());
+    }
+    return ret;
+  }
+
+  std::vector<int64_t> GetWaitingStepIdsForTesting() TF_LOCKS_EXCLUDED(mu_) {
+    mutex_lock l(mu_);
+    std::vector<int64_t> ret;
+    for (const HandlerWaiter* waiter : waiters_) {
+      ret.push_back(waiter->step_id);
+    }
+    return ret;
+  }
+
  private:
   void RecomputePoolStats(
       int num_active_requests, uint64 version,
@@ -954,17 +1033,21 @@ class RunHandlerPool::Impl {
 
   std::unique_ptr<internal::RunHandlerThreadPool> run_handler_thread_pool_;
   // Thread compatible part used only by lock under RunHandlerPool.
-  // Handlers are sorted by start time.
-  // TODO(azaks): sort by the remaining latency budget.
+  // Handlers are sorted by priority, then by deadline (earliest deadline
+  // first), then by start time.
   // TODO(chaox): Consider other data structure for maintaining the sorted
   // active handlers if the searching overhead(currently O(n)) becomes the
   // bottleneck.
   std::list<RunHandler::Impl*> sorted_active_handlers_ TF_GUARDED_BY(mu_);
   std::vector<RunHandler::Impl*> free_handlers_ TF_GUARDED_BY(mu_);
+  // Requests waiting for a free handler, in the order in which they get one.
+  std::list<HandlerWaiter*> waiters_ TF_GUARDED_BY(mu_);
   std::vector<std::unique_ptr<RunHandler::Impl>> handlers_ TF_GUARDED_BY(mu_);
 
   // Histogram of elapsed runtime of every handler (in ms).
   histogram::Histogram time_hist_ TF_GUARDED_BY(mu_);
+  // Number of handlers released after their deadline.
+  int64_t num_deadline_misses_ TF_GUARDED_BY(mu_) = 0;
 
   int64_t iterations_ TF_GUARDED_BY(mu_);
   mutex mu_;
@@ -1020,6 +1103,8 @@ void RunHandlerPool::Impl::LogInfo() {
   if (iterations_++ % 50000 == 10 && VLOG_IS_ON(1)) {
     int num_active_requests = sorted_active_handlers_.size();
     VLOG(1) << "Printing time histogram: " << time_hist_.ToString();
+    VLOG(1) << "Session runs which missed their deadline: "
+            << num_deadline_misses_;
     VLOG(1) << "Active session runs: " << num_active_requests;
     uint64 now = tensorflow::Env::Default()->NowMicros();
     string times_str = "";
@@ -1060,7 +1145,8 @@ void RunHandler::Impl::ThreadPoolInterfaceWrapper::Schedule(
 RunHandler::Impl::Impl(RunHandlerPool::Impl* pool_impl)
     : pool_impl_(pool_impl) {
   thread_pool_interface_ = std::make_unique<ThreadPoolInterfaceWrapper>(this);
-  Reset(0, RunOptions::Experimental::RunHandlerPoolOptions());
+  Reset(0, tensorflow::Env::Default()->NowMicros(),
+        RunOptions::Experimental::RunHandlerPoolOptions());
 }
 
 void RunHandler::Impl::ScheduleInterOpClosure(std::function<void()> fn) {
@@ -1076,9 +1162,10 @@ void RunHandler::Impl::ScheduleIntraOpClosure(std::function<void()> fn) {
 }
 
 void RunHandler::Impl::Reset(
-    int64_t step_id,
+    int64_t step_id, uint64 start_time_us,
     const RunOptions::Experimental::RunHandlerPoolOptions& options) {
-  start_time_us_ = tensorflow::Env::Default()->NowMicros();
+  start_time_us_ = start_time_us;
+  deadline_us_ = DeadlineUs(start_time_us, options);
   step_id_ = step_id;
   options_ = options;
   tws_.SetTracemeId(step_id);
@@ -1104,6 +1191,15 @@ std::vector<int64_t> RunHandlerPool::GetActiveHandlerPrioritiesForTesting()
   return impl_->GetActiveHandlerPrioritiesForTesting();
 }
 
+std::vector<int64_t> RunHandlerPool::GetActiveHandlerStepIdsForTesting()
+    const {
+  return impl_->GetActiveHandlerStepIdsForTesting();
+}
+
+std::vector<int64_t> RunHandlerPool::GetWaitingStepIdsForTesting() const {
+  return impl_->GetWaitingStepIdsForTesting();
+}
+
 RunHandler::RunHandler(Impl* impl) : impl_(impl) {}
 
 void RunHandler::ScheduleInterOpClosure(std::function<void()> fn) {
@@ -62,7 +62,8 @@ class RunHandlerPool {
   // and is being used by a client.  It becomes 'inactive' once more when the
   // unique_ptr is destroyed.
   //
-  // Will block unless there is an inactive handler.
+  // Will block unless there is an inactive handler. Blocked requests get
+  // handlers in the order of their priorities, then their deadlines.
   std::unique_ptr<RunHandler> Get(
       int64_t step_id = 0, int64_t timeout_in_ms = 0,
       const RunOptions::Experimental::RunHandlerPoolOptions& options =
@@ -72,6 +73,14 @@ class RunHandlerPool {
   // order of the active handler list.
   std::vector<int64_t> GetActiveHandlerPrioritiesForTesting() const;
 
+  // Get the step ids of the active handlers, in the same order as
+  // GetActiveHandlerPrioritiesForTesting().
+  std::vector<int64_t> GetActiveHandlerStepIdsForTesting() const;
+
+  // Get the step ids of the requests which wait in Get() for a handler, in
+  // the order in which they get one.
+  std::vector<int64_t> GetWaitingStepIdsForTesting() const;
+
  private:
   class Impl;
   friend class RunHandler;
@@ -82,7 +91,8 @@ class RunHandlerPool {
 // RunHandler can be used to schedule inter/intra-op closures to run on a global
 // pool shared across all Session::Run(s). The closures are enqueued to a
 // handler specific queue, from which the work is stolen in a priority order
-// (time of the Get() call).
+// (the priority of the request, then its deadline, then the time of the Get()
+// call).
 //
 // It can only be created via RunHandlerPool::Get().
 //
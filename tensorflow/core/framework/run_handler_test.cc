@@ -17,6 +17,8 @@ limitations under the License.
 
 #include "tensorflow/core/framework/run_handler.h"
 
+#include <algorithm>
+#include <atomic>
 #include <memory>
 #include <vector>
 
@@ -33,6 +35,7 @@ limitations under the License.
 #include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
 #include "tensorflow/core/public/session.h"
 #include "tensorflow/core/public/session_options.h"
 
@@ -113,6 +116,77 @@ TEST(RunHandlerUtilTest, PrioritySchedulingTest) {
   EXPECT_EQ(sorted_active_list[3], 1);
 }
 
+TEST(RunHandlerUtilTest, DeadlineSchedulingTest) {
+  int num_threads = 2;
+  std::unique_ptr<RunHandlerPool> pool(
+      new RunHandlerPool(num_threads, num_threads));
+
+  RunOptions::Experimental::RunHandlerPoolOptions options;
+  auto handler1 = pool->Get(/*step_id=*/1, /*timeout_in_ms=*/0, options);
+  options.set_deadline_in_ms(100000);
+  auto handler2 = pool->Get(/*step_id=*/2, /*timeout_in_ms=*/0, options);
+  options.set_deadline_in_ms(10000);
+  auto handler3 = pool->Get(/*step_id=*/3, /*timeout_in_ms=*/0, options);
+  options.set_deadline_in_ms(200000);
+  auto handler4 = pool->Get(/*step_id=*/4, /*timeout_in_ms=*/0, options);
+  // The priority takes precedence over the deadline.
+  options.set_priority(1);
+  auto handler5 = pool->Get(/*step_id=*/5, /*timeout_in_ms=*/0, options);
+
+  // Requests with the same priority are ordered by their deadlines, and
+  // requests without a deadline come last.
+  EXPECT_THAT(pool->GetActiveHandlerStepIdsForTesting(),
+              ::testing::ElementsAre(5, 3, 2, 4, 1));
+
+  handler3.reset();
+  options.set_priority(0);
+  options.set_deadline_in_ms(0);
+  auto handler6 = pool->Get(/*step_id=*/6, /*timeout_in_ms=*/0, options);
+  EXPECT_THAT(pool->GetActiveHandlerStepIdsForTesting(),
+              ::testing::ElementsAre(5, 2, 4, 1, 6));
+}
+
+TEST(RunHandlerUtilTest, WaitersGetHandlersByDeadline) {
+  std::unique_ptr<RunHandlerPool> pool(new RunHandlerPool(1, 1));
+  const int32_t kMaxConcurrentHandlers = 128;  // Copied from run_handler.cc.
+  std::vector<std::unique_ptr<RunHandler>> blocking_handles;
+  blocking_handles.reserve(kMaxConcurrentHandlers);
+  for (int i = 0; i < kMaxConcurrentHandlers; ++i) {
+    blocking_handles.push_back(pool->Get(i));
+  }
+
+  // Waits until the waiting requests are `step_ids`.
+  auto wait_for_waiters = [&pool](std::vector<int64_t> step_ids) {
+    while (pool->GetWaitingStepIdsForTesting() != step_ids) {
+      Env::Default()->SleepForMicroseconds(100);
+    }
+  };
+  mutex mu;
+  std::vector<int64_t> order;
+  auto get = [&pool, &mu, &order](int64_t step_id, int64_t deadline_in_ms) {
+    RunOptions::Experimental::RunHandlerPoolOptions options;
+    options.set_deadline_in_ms(deadline_in_ms);
+    auto handler = pool->Get(step_id, /*timeout_in_ms=*/0, options);
+    mutex_lock l(mu);
+    order.push_back(step_id);
+  };
+  {
+    thread::ThreadPool tp(Env::Default(), "test", 3);
+    // Requests without a deadline come last, and the others arrive in the
+    // reverse order of their deadlines.
+    tp.Schedule([&get]() { get(/*step_id=*/200, /*deadline_in_ms=*/0); });
+    wait_for_waiters({200});
+    tp.Schedule([&get]() { get(/*step_id=*/201, /*deadline_in_ms=*/100000); });
+    wait_for_waiters({201, 200});
+    tp.Schedule([&get]() { get(/*step_id=*/202, /*deadline_in_ms=*/10000); });
+    wait_for_waiters({202, 201, 200});
+    // Each request releases its handler right away, for the next one.
+    blocking_handles[0].reset();
+  }
+  EXPECT_THAT(order, ::testing::ElementsAre(202, 201, 200));
+  EXPECT_TRUE(pool->GetWaitingStepIdsForTesting().empty());
+}
+
 TEST(RunHandlerThreadPool, EnqueueTask) {
   Eigen::MaxSizeVector<mutex> waiters_mu(2);
   waiters_mu.resize(2);
@@ -811,5 +885,90 @@ TEST_F(RunHandlerTest, TestWaitTimeout) {
   EXPECT_NE(next_handle.get(), nullptr);
 }
 
+// Runs a request of `num_closures` inter-op closures, which each busy-wait
+// for `closure_us` microseconds. Returns true if the request finishes within
+// `deadline_ms`.
+bool RunRequest(RunHandlerPool* pool, int64_t step_id, int64_t deadline_ms,
+                bool use_deadline, int num_closures, int64_t closure_us) {
+  const uint64 start_us = Env::Default()->NowMicros();
+  RunOptions::Experimental::RunHandlerPoolOptions options;
+  if (use_deadline) {
+    options.set_deadline_in_ms(deadline_ms);
+  }
+  auto handler = pool->Get(step_id, /*timeout_in_ms=*/0, options);
+  BlockingCounter counter(num_closures);
+  for (int i = 0; i < num_closures; ++i) {
+    handler->ScheduleInterOpClosure([&counter, closure_us]() {
+      const uint64 end_us = Env::Default()->NowMicros() + closure_us;
+      while (Env::Default()->NowMicros() < end_us) {
+      }
+      counter.DecrementCount();
+    });
+  }
+  counter.Wait();
+  handler.reset();
+  return Env::Default()->NowMicros() - start_us <= deadline_ms * 1000;
+}
+
+// Overloads a pool of 4 inter-op threads with concurrent clients, which issue
+// requests with alternately tight and loose deadlines, and reports the
+// fraction of requests which miss their deadline. Compares scheduling by
+// arrival time with scheduling by earliest deadline.
+void BM_DeadlineMissRate(::testing::benchmark::State& state) {
+  const bool use_deadlines = state.range(0);
+  const int num_clients = state.range(1);
+  constexpr int kNumThreads = 4;
+  constexpr int kRequestsPerClient = 8;
+  constexpr int kClosuresPerRequest = 8;
+  constexpr int64_t kClosureMicros = 200;
+  constexpr int64_t kTightDeadlineMs = 5;
+  constexpr int64_t kLooseDeadlineMs = 100;
+
+  RunHandlerPool pool(kNumThreads, 0);
+  thread::ThreadPool clients(Env::Default(), "clients", num_clients);
+  std::atomic<int64_t> num_requests{0};
+  std::atomic<int64_t> num_misses{0};
+  std::atomic<int64_t> num_tight_requests{0};
+  std::atomic<int64_t> num_tight_misses{0};
+  std::atomic<int64_t> next_step_id{0};
+  for (auto s : state) {
+    BlockingCounter done(num_clients);
+    for (int c = 0; c < num_clients; ++c) {
+      clients.Schedule([&, c]() {
+        for (int i = 0; i < kRequestsPerClient; ++i) {
+          const bool tight = (c + i) % 2 == 0;
+          const bool met = RunRequest(
+              &pool, next_step_id.fetch_add(1),
+              tight ? kTightDeadlineMs : kLooseDeadlineMs, use_deadlines,
+              kClosuresPerRequest, kClosureMicros);
+          num_requests.fetch_add(1);
+          if (!met) num_misses.fetch_add(1);
+          if (tight) {
+            num_tight_requests.fetch_add(1);
+            if (!met) num_tight_misses.fetch_add(1);
+          }
+        }
+        done.DecrementCount();
+      });
+    }
+    done.Wait();
+  }
+  state.SetItemsProcessed(num_requests);
+  state.counters["miss_rate"] =
+      static_cast<double>(num_misses) / std::max<int64_t>(num_requests, 1);
+  state.counters["tight_miss_rate"] =
+      static_cast<double>(num_tight_misses) /
+      std::max<int64_t>(num_tight_requests, 1);
+}
+
+BENCHMARK(BM_DeadlineMissRate)
+    ->ArgPair(false, 4)
+    ->ArgPair(true, 4)
+    ->ArgPair(false, 16)
+    ->ArgPair(true, 16)
+    ->ArgPair(false, 64)
+    ->ArgPair(true, 64)
+    ->UseRealTime();
+
 }  // namespace
 }  // namespace tensorflow
@@ -0,0 +1,88 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/framework/step_arena_allocator.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+#include "tensorflow/core/framework/allocator.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/mutex.h"
+
+namespace tensorflow {
+namespace {
+
+size_t RoundUp(size_t num_bytes, size_t alignment) {
+  return (num_bytes + alignment - 1) / alignment * alignment;
+}
+
+}  // namespace
+
+StepArenaAllocator::StepArenaAllocator(Allocator* backing_allocator,
+                                       int64_t max_arena_bytes)
+    : backing_allocator_(backing_allocator),
+      max_arena_bytes_(max_arena_bytes) {}
+
+StepArenaAllocator::~StepArenaAllocator() {
+  mutex_lock l(mu_);
+  for (const std::unique_ptr<Block>& block : blocks_) {
+    backing_allocator_->DeallocateRaw(block->base);
+  }
+}
+
+void* StepArenaAllocator::AllocateRaw(size_t alignment, size_t num_bytes) {
+  DCHECK_LE(alignment, Allocator::kAllocatorAlignment);
+  DCHECK_LE(num_bytes, kMaxAllocationBytes);
+  // Every allocation is rounded up so that all offsets stay aligned.
+  const size_t rounded_bytes =
+      RoundUp(num_bytes, Allocator::kAllocatorAlignment);
+  while (true) {
+    Block* block = current_block_.load(std::memory_order_acquire);
+    if (block != nullptr) {
+      const size_t offset =
+          block->offset.fetch_add(rounded_bytes, std::memory_order_relaxed);
+      if (offset + rounded_bytes <= kBlockBytes) {
+        arena_bytes_.fetch_add(rounded_bytes, std::memory_order_relaxed);
+        return block->base + offset;
+      }
+    }
+    if (!AddBlock(block)) {
+      return nullptr;
+    }
+  }
+}
+
+bool StepArenaAllocator::AddBlock(Block* full_block) {
+  mutex_lock l(mu_);
+  if (current_block_.load(std::memory_order_relaxed) != full_block) {
+    return true;
+  }
+  void* base =
+      backing_allocator_->AllocateRaw(Allocator::kAllocatorAlignment,
+                                      kBlockBytes);
+  if (base == nullptr) {
+    return false;
+  }
+  auto block = std::make_unique<Block>();
+  block->base = static_cast<char*>(base);
+  current_block_.store(block.get(), std::memory_order_release);
+  blocks_.push_back(std::move(block));
+  return true;
+}
+
+}  // namespace tensorflow
@@ -0,0 +1,117 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_FRAMEWORK_STEP_ARENA_ALLOCATOR_H_
+#define TENSORFLOW_CORE_FRAMEWORK_STEP_ARENA_ALLOCATOR_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "tensorflow/core/framework/allocator.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+
+namespace tensorflow {
+
+// An allocator for the intermediate tensors of one step. Allocations are
+// carved out of large blocks obtained from `backing_allocator` by bumping a
+// pointer, and `DeallocateRaw` is a no-op: all blocks are returned to
+// `backing_allocator` at once when the arena is destroyed at the end of the
+// step. This avoids taking the lock of the backing allocator for every small
+// tensor.
+//
+// The caller must guarantee that no tensor allocated from the arena outlives
+// it. Allocations larger than `kMaxAllocationBytes` should use
+// `backing_allocator` directly, and so should all allocations once
+// `has_capacity()` returns false, since memory freed during the step is not
+// reused.
+//
+// This class is thread-safe.
+class StepArenaAllocator : public Allocator {
+ public:
+  // Size of the blocks obtained from the backing allocator.
+  static constexpr size_t kBlockBytes = 1 << 20;
+  // Largest allocation served from the arena.
+  static constexpr size_t kMaxAllocationBytes = kBlockBytes / 4;
+  // Default number of bytes after which `has_capacity()` returns false.
+  static constexpr int64_t kDefaultMaxArenaBytes = 64 << 20;
+
+  // `backing_allocator` must outlive the arena.
+  explicit StepArenaAllocator(Allocator* backing_allocator,
+                              int64_t max_arena_bytes = kDefaultMaxArenaBytes);
+  ~StepArenaAllocator() override;
+  StepArenaAllocator(const StepArenaAllocator&) = delete;
+  StepArenaAllocator& operator=(const StepArenaAllocator&) = delete;
+
+  std::string Name() override { return "step_arena"; }
+  void* AllocateRaw(size_t alignment, size_t num_bytes) override;
+  // Memory is only released when the arena is destroyed.
+  void DeallocateRaw(void* ptr) override {}
+  AllocatorMemoryType GetMemoryType() const override {
+    return backing_allocator_->GetMemoryType();
+  }
+
+  Allocator* backing_allocator() const { return backing_allocator_; }
+
+  // Returns false once `max_arena_bytes` have been allocated from the arena.
+  // The limit is soft: allocations that started before it was reached still
+  // succeed.
+  bool has_capacity() const { return arena_bytes() < max_arena_bytes_; }
+
+  // Records that `num_bytes` of the step's tensors were allocated from the
+  // backing allocator instead of the arena.
+  void RecordFallbackAllocation(int64_t num_bytes) {
+    fallback_bytes_.fetch_add(num_bytes, std::memory_order_relaxed);
+  }
+
+  // Returns the number of bytes allocated from the arena.
+  int64_t arena_bytes() const {
+    return arena_bytes_.load(std::memory_order_relaxed);
+  }
+  // Returns the number of bytes recorded by `RecordFallbackAllocation`.
+  int64_t fallback_bytes() const {
+    return fallback_bytes_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  struct Block {
+    char* base;
+    // Offset of the free space in the block. May grow past `kBlockBytes`
+    // when concurrent allocations race for the end of the block.
+    std::atomic<size_t> offset{0};
+  };
+
+  // Makes a new block the current block, unless another thread has already
+  // replaced `full_block`. Returns false if the backing allocator is out of
+  // memory.
+  bool AddBlock(Block* full_block);
+
+  Allocator* const backing_allocator_;
+  const int64_t max_arena_bytes_;
+  std::atomic<Block*> current_block_{nullptr};
+  std::atomic<int64_t> arena_bytes_{0};
+  std::atomic<int64_t> fallback_bytes_{0};
+
+  mutex mu_;
+  std::vector<std::unique_ptr<Block>> blocks_ TF_GUARDED_BY(mu_);
+};
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_FRAMEWORK_STEP_ARENA_ALLOCATOR_H_
@@ -0,0 +1,165 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/framework/step_arena_allocator.h"
+
+#include <cstdint>
+#include <cstring>
+#include <set>
+#include <vector>
+
+#include "tensorflow/core/framework/allocator.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/framework/types.pb.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+#include "tensorflow/core/platform/threadpool.h"
+
+namespace tensorflow {
+namespace {
+
+TEST(StepArenaAllocatorTest, AllocationsAreAlignedAndDisjoint) {
+  StepArenaAllocator arena(cpu_allocator());
+  std::vector<char*> ptrs;
+  for (size_t num_bytes : {1, 7, 64, 100, 4096, 1, 0, 333}) {
+    char* ptr = static_cast<char*>(
+        arena.AllocateRaw(Allocator::kAllocatorAlignment, num_bytes));
+    ASSERT_NE(ptr, nullptr);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(ptr) %
+                  Allocator::kAllocatorAlignment,
+              0);
+    memset(ptr, 0xff, num_bytes);
+    ptrs.push_back(ptr);
+  }
+  for (size_t i = 1; i < ptrs.size(); ++i) {
+    EXPECT_GE(ptrs[i], ptrs[i - 1]);
+  }
+  // 1, 7, 64, 100, 4096, 1, 0, and 333 bytes rounded up to 64 bytes.
+  EXPECT_EQ(arena.arena_bytes(), 64 + 64 + 64 + 128 + 4096 + 64 + 0 + 384);
+}
+
+TEST(StepArenaAllocatorTest, AllocatesNewBlocks) {
+  StepArenaAllocator arena(cpu_allocator());
+  const size_t num_bytes = StepArenaAllocator::kMaxAllocationBytes;
+  std::set<char*> ptrs;
+  for (int i = 0; i < 10; ++i) {
+    char* ptr = static_cast<char*>(
+        arena.AllocateRaw(Allocator::kAllocatorAlignment, num_bytes));
+    ASSERT_NE(ptr, nullptr);
+    memset(ptr, i, num_bytes);
+    ptrs.insert(ptr);
+  }
+  EXPECT_EQ(ptrs.size(), 10);
+  EXPECT_EQ(arena.arena_bytes(), 10 * num_bytes);
+}
+
+TEST(StepArenaAllocatorTest, ConcurrentAllocations) {
+  StepArenaAllocator arena(cpu_allocator());
+  constexpr int kNumThreads = 8;
+  constexpr int kAllocationsPerThread = 2000;
+  constexpr size_t kAllocationBytes = 640;
+  mutex mu;
+  std::set<char*> ptrs;
+  {
+    thread::ThreadPool pool(Env::Default(), "step_arena_test", kNumThreads);
+    for (int i = 0; i < kNumThreads; ++i) {
+      pool.Schedule([&arena, &mu, &ptrs, i]() {
+        std::vector<char*> thread_ptrs;
+        for (int j = 0; j < kAllocationsPerThread; ++j) {
+          char* ptr = static_cast<char*>(arena.AllocateRaw(
+              Allocator::kAllocatorAlignment, kAllocationBytes));
+          CHECK_NE(ptr, nullptr);
+          memset(ptr, i, kAllocationBytes);
+          thread_ptrs.push_back(ptr);
+        }
+        mutex_lock l(mu);
+        ptrs.insert(thread_ptrs.begin(), thread_ptrs.end());
+      });
+    }
+  }
+  EXPECT_EQ(ptrs.size(), kNumThreads * kAllocationsPerThread);
+  EXPECT_EQ(arena.arena_bytes(),
+            kNumThreads * kAllocationsPerThread * kAllocationBytes);
+}
+
+TEST(StepArenaAllocatorTest, DeallocateIsNoOp) {
+  StepArenaAllocator arena(cpu_allocator());
+  {
+    Tensor t(&arena, DT_FLOAT, TensorShape({16, 16}));
+    t.flat<float>().setConstant(1.0f);
+  }
+  Tensor t(&arena, DT_FLOAT, TensorShape({16, 16}));
+  t.flat<float>().setZero();
+  EXPECT_EQ(arena.arena_bytes(), 2 * 16 * 16 * sizeof(float));
+}
+
+TEST(StepArenaAllocatorTest, RecordFallbackAllocation) {
+  StepArenaAllocator arena(cpu_allocator());
+  EXPECT_EQ(arena.fallback_bytes(), 0);
+  arena.RecordFallbackAllocation(100);
+  arena.RecordFallbackAllocation(28);
+  EXPECT_EQ(arena.fallback_bytes(), 128);
+  EXPECT_EQ(arena.arena_bytes(), 0);
+}
+
+TEST(StepArenaAllocatorTest, HasCapacity) {
+  StepArenaAllocator arena(cpu_allocator(), /*max_arena_bytes=*/1024);
+  EXPECT_TRUE(arena.has_capacity());
+  ASSERT_NE(arena.AllocateRaw(Allocator::kAllocatorAlignment, 512), nullptr);
+  EXPECT_TRUE(arena.has_capacity());
+  ASSERT_NE(arena.AllocateRaw(Allocator::kAllocatorAlignment, 512), nullptr);
+  EXPECT_FALSE(arena.has_capacity());
+}
+
+void BM_Allocate(::testing::benchmark::State& state) {
+  const bool use_arena = state.range(0);
+  const size_t num_bytes = state.range(1);
+  Allocator* allocator = cpu_allocator();
+  constexpr int kAllocationsPerStep = 1000;
+  std::vector<void*> ptrs(kAllocationsPerStep);
+  for (auto s : state) {
+    if (use_arena) {
+      StepArenaAllocator arena(allocator);
+      for (int i = 0; i < kAllocationsPerStep; ++i) {
+        ptrs[i] = arena.AllocateRaw(Allocator::kAllocatorAlignment, num_bytes);
+      }
+      for (int i = 0; i < kAllocationsPerStep; ++i) {
+        arena.DeallocateRaw(ptrs[i]);
+      }
+    } else {
+      for (int i = 0; i < kAllocationsPerStep; ++i) {
+        ptrs[i] =
+            allocator->AllocateRaw(Allocator::kAllocatorAlignment, num_bytes);
+      }
+      for (int i = 0; i < kAllocationsPerStep; ++i) {
+        allocator->DeallocateRaw(ptrs[i]);
+      }
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * kAllocationsPerStep);
+}
+
+BENCHMARK(BM_Allocate)
+    ->ArgPair(false, 64)
+    ->ArgPair(true, 64)
+    ->ArgPair(false, 4096)
+    ->ArgPair(true, 4096)
+    ->ThreadRange(1, 16);
+
+}  // namespace
+}  // namespace tensorflow
@@ -1004,6 +1004,7 @@ absl::Status Partition(const PartitionOptions& opts, Graph* g,
 
   int32_t num_data = 0;
   int32_t num_control = 0;
+  int64_t num_rendezvous_slots = 0;
   for (Node* dst : g->op_nodes()) {
     dstp = opts.node_to_loc(dst);
     GraphDef* dst_graph = &(*partitions)[dstp];
@@ -1183,6 +1184,12 @@ absl::Status Partition(const PartitionOptions& opts, Graph* g,
                               tensor_name_attr, &status);
       if (!status.ok()) return status;
 
+      if (opts.use_rendezvous_slots) {
+        AddNodeAttr("_rendezvous_slot", num_rendezvous_slots, send);
+        AddNodeAttr("_rendezvous_slot", num_rendezvous_slots, real_recv);
+        ++num_rendezvous_slots;
+      }
+
       // Fix up the control flow edge.
       // NOTE(yuanbyu): 'real_recv' must be the real recv node.
       if (src_graph == dst_graph) {
@@ -87,6 +87,12 @@ struct PartitionOptions {
   // TODO(b/327983931): Add wrapper functions for partitioning that clearly
   // signal this intent by taking a `Graph` or `Graph&&`.
   bool can_make_destructive_changes = false;
+
+  // If true, each Send/Recv pair is assigned a distinct "_rendezvous_slot"
+  // attr, numbered from 0 across all partitions, through which the pair
+  // exchanges its tensor when it runs outside of any loop. See
+  // RendezvousInterface::SendToSlot().
+  bool use_rendezvous_slots = false;
 };
 
 // Partition "input" graph into a set of graphs, one per location.
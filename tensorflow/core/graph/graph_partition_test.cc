@@ -15,10 +15,14 @@ limitations under the License.
 
 #include "tensorflow/core/graph/graph_partition.h"
 
+#include <cstdint>
+#include <map>
 #include <memory>
+#include <set>
 #include <string>
 #include <unordered_map>
 #include <utility>
+#include <vector>
 
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
@@ -34,6 +38,7 @@ limitations under the License.
 #include "tensorflow/core/common_runtime/graph_constructor.h"
 #include "tensorflow/core/framework/common_shape_fns.h"
 #include "tensorflow/core/framework/function_testlib.h"
+#include "tensorflow/core/framework/node_def_util.h"
 #include "tensorflow/core/framework/op.h"
 #include "tensorflow/core/framework/versions.pb.h"
 #include "tensorflow/core/graph/graph.h"
@@ -83,7 +88,8 @@ string DeviceName(const Node* node) {
 }
 
 void Partition(const GraphDef& graph_def,
-               std::unordered_map<string, GraphDef>* partitions) {
+               std::unordered_map<string, GraphDef>* partitions,
+               bool use_rendezvous_slots = false) {
   Graph g(OpRegistry::Global());
   GraphConstructorOptions opts;
   TF_CHECK_OK(ConvertGraphDefToGraph(opts, graph_def, &g));
@@ -103,6 +109,7 @@ void Partition(const GraphDef& graph_def,
   popts.get_incarnation = [](const string& name) {
     return (name[0] - 'A') + 100;
   };
+  popts.use_rendezvous_slots = use_rendezvous_slots;
   absl::Status s = Partition(popts, &g, partitions);
   CHECK(s.ok()) << s;
 
@@ -291,6 +298,38 @@ TEST_F(GraphPartitionTest, CrossDeviceData) {
   ExpectMatchB();
 }
 
+TEST_F(GraphPartitionTest, RendezvousSlots) {
+  auto a1 = FloatInput(in_.WithOpName("A1"));
+  auto a2 = FloatInput(in_.WithOpName("A2"));
+  auto b1 = Combine(in_.WithOpName("B1"), a1, a2);
+  Combine(in_.WithOpName("B2"), b1, a1);
+
+  Partition(ToGraphDef(), &partitions_, /*use_rendezvous_slots=*/true);
+  EXPECT_EQ(2, partitions_.size());
+
+  // The Send and the Recv of each pair share a slot, and the two pairs (A1
+  // is only sent once) have distinct slots.
+  std::map<string, std::vector<int64_t>> slots;
+  for (const auto& kv : partitions_) {
+    for (const NodeDef& ndef : kv.second.node()) {
+      if (ndef.op() != "_Send" && ndef.op() != "_Recv") continue;
+      string tensor_name;
+      int64_t slot;
+      TF_ASSERT_OK(GetNodeAttr(ndef, "tensor_name", &tensor_name));
+      TF_ASSERT_OK(GetNodeAttr(ndef, "_rendezvous_slot", &slot));
+      slots[tensor_name].push_back(slot);
+    }
+  }
+  ASSERT_EQ(slots.size(), 2);
+  std::set<int64_t> distinct_slots;
+  for (const auto& kv : slots) {
+    ASSERT_EQ(kv.second.size(), 2);
+    EXPECT_EQ(kv.second[0], kv.second[1]);
+    distinct_slots.insert(kv.second[0]);
+  }
+  EXPECT_EQ(distinct_slots, std::set<int64_t>({0, 1}));
+}
+
 TEST_F(GraphPartitionTest, CrossDeviceControl) {
   auto a1 = FloatInput(in_.WithOpName("A1"));
   auto b1 = FloatInput(in_.WithOpName("B1"));
@@ -0,0 +1,655 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/optimizers/data/map_vectorization.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/algorithm/container.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/strings/match.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "tensorflow/core/framework/attr_value.pb.h"
+#include "tensorflow/core/framework/attr_value_util.h"
+#include "tensorflow/core/framework/dataset.h"
+#include "tensorflow/core/framework/function.h"
+#include "tensorflow/core/framework/function.pb.h"
+#include "tensorflow/core/framework/node_def.pb.h"
+#include "tensorflow/core/framework/node_def_util.h"
+#include "tensorflow/core/framework/op_def.pb.h"
+#include "tensorflow/core/framework/partial_tensor_shape.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/framework/tensor_shape.pb.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/grappler/clusters/cluster.h"
+#include "tensorflow/core/grappler/grappler_item.h"
+#include "tensorflow/core/grappler/mutable_graph_view.h"
+#include "tensorflow/core/grappler/optimizers/custom_graph_optimizer_registry.h"
+#include "tensorflow/core/grappler/optimizers/data/function_utils.h"
+#include "tensorflow/core/grappler/optimizers/data/graph_utils.h"
+#include "tensorflow/core/grappler/utils.h"
+
+namespace tensorflow {
+namespace grappler {
+namespace {
+
+constexpr char kBatchDataset[] = "BatchDataset";
+constexpr char kBatchDatasetV2[] = "BatchDatasetV2";
+constexpr char kFilterDataset[] = "FilterDataset";
+constexpr char kParallelMapDataset[] = "ParallelMapDatasetV2";
+constexpr char kUnbatchDataset[] = "UnbatchDataset";
+constexpr char kMapDefun[] = "MapDefun";
+
+constexpr char kOutputShapes[] = "output_shapes";
+constexpr char kOutputTypes[] = "output_types";
+
+constexpr char kVectorized[] = "vectorized";
+constexpr char kFallback[] = "fallback";
+
+// Returns whether `op` is element-wise, i.e. applying it to inputs with a
+// leading batch dimension computes the op on every element of the batch.
+bool IsElementwiseOp(absl::string_view op) {
+  static const auto* const kOps = new absl::flat_hash_set<absl::string_view>({
+      "Abs",        "Add",        "AddV2",     "Cast",      "Ceil",
+      "Equal",      "Exp",        "Floor",     "Greater",   "GreaterEqual",
+      "Identity",   "Less",       "LessEqual", "Log",       "LogicalAnd",
+      "LogicalNot", "LogicalOr",  "Maximum",   "Minimum",   "Mul",
+      "Neg",        "NotEqual",   "RealDiv",   "Rsqrt",     "Sigmoid",
+      "Sign",       "Sqrt",       "Square",    "Sub",       "Tanh",
+  });
+  return kOps->contains(op);
+}
+
+// Describes a tensor in the body of a function that is being vectorized.
+struct TensorInfo {
+  // Whether the tensor has a leading batch dimension.
+  bool batched = false;
+  // The rank of the tensor without the batch dimension, or -1 if unknown.
+  int rank = -1;
+};
+
+int Rank(const TensorShapeProto& shape) {
+  return shape.unknown_rank() ? -1 : shape.dim_size();
+}
+
+// Returns whether every shape in `shapes` is fully defined.
+bool AllShapesFullyDefined(const AttrValue& shapes) {
+  for (const TensorShapeProto& shape : shapes.list().shape()) {
+    if (!PartialTensorShape(shape).IsFullyDefined()) return false;
+  }
+  return true;
+}
+
+// Returns `shapes` with a leading dimension of size `batch_dim` added to each
+// shape.
+AttrValue BatchShapes(const AttrValue& shapes, int64_t batch_dim) {
+  AttrValue result;
+  auto* result_shapes = result.mutable_list();
+  for (const TensorShapeProto& shape : shapes.list().shape()) {
+    TensorShapeProto* batched = result_shapes->add_shape();
+    if (shape.unknown_rank()) {
+      batched->set_unknown_rank(true);
+      continue;
+    }
+    batched->add_dim()->set_size(batch_dim);
+    for (const auto& dim : shape.dim()) {
+      *batched->add_dim() = dim;
+    }
+  }
+  return result;
+}
+
+// Returns the size of the leading dimension of the first output of
+// `batch_node`, or -1 if unknown.
+int64_t BatchDim(const NodeDef& batch_node) {
+  auto it = batch_node.attr().find(kOutputShapes);
+  if (it == batch_node.attr().end() || it->second.list().shape_size() == 0) {
+    return -1;
+  }
+  const TensorShapeProto& shape = it->second.list().shape(0);
+  return Rank(shape) > 0 ? shape.dim(0).size() : -1;
+}
+
+// Returns whether an element-wise op computes the batched result when applied
+// directly to `inputs`. This is the case when all batched inputs have the same
+// element rank and no unbatched input has a higher rank, so that broadcasting
+// never aligns the batch dimension with an element dimension. If so, sets
+// `*rank` to the element rank of the result.
+bool HasBatchedForm(const std::vector<TensorInfo>& inputs, int* rank) {
+  if (inputs.size() == 1) {
+    *rank = inputs[0].rank;
+    return true;
+  }
+  int batched_rank = -1;
+  for (const TensorInfo& input : inputs) {
+    if (!input.batched) continue;
+    if (input.rank < 0) return false;
+    if (batched_rank >= 0 && input.rank != batched_rank) return false;
+    batched_rank = input.rank;
+  }
+  for (const TensorInfo& input : inputs) {
+    if (input.batched) continue;
+    if (input.rank < 0 || input.rank > batched_rank) return false;
+  }
+  *rank = batched_rank;
+  return true;
+}
+
+// Returns the rank of the outputs of `node`, none of whose inputs are batched,
+// or -1 if unknown.
+int UnbatchedRank(const NodeDef& node, const std::vector<TensorInfo>& inputs) {
+  if (node.op() == "Const") {
+    auto it = node.attr().find("value");
+    if (it == node.attr().end()) return -1;
+    return Rank(it->second.tensor().tensor_shape());
+  }
+  if (!IsElementwiseOp(node.op())) return -1;
+  int rank = 0;
+  for (const TensorInfo& input : inputs) {
+    if (input.rank < 0) return -1;
+    rank = std::max(rank, input.rank);
+  }
+  return rank;
+}
+
+// Orders the nodes of `function` so that every node follows the nodes it
+// reads from. Returns false if the function body contains a cycle.
+bool SortFunctionNodes(const FunctionDef& function,
+                       std::vector<const NodeDef*>* sorted) {
+  absl::flat_hash_map<absl::string_view, int> index;
+  for (int i = 0; i < function.node_def_size(); ++i) {
+    index[function.node_def(i).name()] = i;
+  }
+  std::vector<int> num_pending(function.node_def_size(), 0);
+  std::vector<std::vector<int>> fanouts(function.node_def_size());
+  for (int i = 0; i < function.node_def_size(); ++i) {
+    for (const string& input : function.node_def(i).input()) {
+      absl::string_view name = input;
+      if (absl::StartsWith(name, "^")) name.remove_prefix(1);
+      name = name.substr(0, name.find(':'));
+      auto it = index.find(name);
+      if (it == index.end()) continue;
+      fanouts[it->second].push_back(i);
+      ++num_pending[i];
+    }
+  }
+  std::deque<int> ready;
+  for (int i = 0; i < function.node_def_size(); ++i) {
+    if (num_pending[i] == 0) ready.push_back(i);
+  }
+  sorted->clear();
+  while (!ready.empty()) {
+    const int i = ready.front();
+    ready.pop_front();
+    sorted->push_back(&function.node_def(i));
+    for (int fanout : fanouts[i]) {
+      if (--num_pending[fanout] == 0) ready.push_back(fanout);
+    }
+  }
+  return sorted->size() == function.node_def_size();
+}
+
+// Adds to `vectorized` a `MapDefun` node that applies `node` to each element
+// of its batched inputs. Batched inputs become `MapDefun` arguments and
+// unbatched inputs become captured inputs. The per-element function is added
+// to `library`. Returns nullptr if the node's types can not be determined.
+NodeDef* AddMapDefunNode(const NodeDef& node, const OpDef& op_def,
+                         const std::vector<TensorInfo>& inputs,
+                         const std::vector<string>& outputs,
+                         FunctionDefLibrary* library, FunctionDef* vectorized) {
+  DataTypeVector input_types;
+  DataTypeVector output_types;
+  if (!InputTypesForNode(node, op_def, &input_types).ok() ||
+      !OutputTypesForNode(node, op_def, &output_types).ok() ||
+      input_types.size() != inputs.size()) {
+    return nullptr;
+  }
+
+  FunctionDef* per_element = library->add_function();
+  graph_utils::SetUniqueGraphFunctionName(
+      absl::StrCat(vectorized->signature().name(), "_", node.name()), library,
+      per_element);
+  OpDef* signature = per_element->mutable_signature();
+  NodeDef* body = per_element->add_node_def();
+  *body = node;
+  body->clear_input();
+  for (int i = 0; i < inputs.size(); ++i) {
+    body->add_input(absl::StrCat("input_", i));
+  }
+  for (int i = 0; i < output_types.size(); ++i) {
+    OpDef::ArgDef* arg = signature->add_output_arg();
+    arg->set_name(absl::StrCat("output_", i));
+    arg->set_type(output_types[i]);
+    (*per_element->mutable_ret())[arg->name()] = outputs[i];
+  }
+
+  NodeDef* map_defun = vectorized->add_node_def();
+  function_utils::SetUniqueFunctionNodeName(
+      absl::StrCat(node.name(), "_map_defun"), vectorized, map_defun);
+  map_defun->set_op(kMapDefun);
+  DataTypeVector arguments_types;
+  DataTypeVector captured_types;
+  // `MapDefun` passes its arguments before its captured inputs, so the
+  // signature of the per-element function lists batched inputs first.
+  for (bool batched : {true, false}) {
+    for (int i = 0; i < inputs.size(); ++i) {
+      if (inputs[i].batched != batched) continue;
+      OpDef::ArgDef* arg = signature->add_input_arg();
+      arg->set_name(absl::StrCat("input_", i));
+      arg->set_type(input_types[i]);
+      map_defun->add_input(node.input(i));
+      (batched ? arguments_types : captured_types).push_back(input_types[i]);
+    }
+  }
+  AddNodeAttr("Targuments", arguments_types, map_defun);
+  AddNodeAttr("Tcaptured", captured_types, map_defun);
+  AddNodeAttr(kOutputTypes, output_types, map_defun);
+  AddNodeAttr(kOutputShapes,
+              std::vector<PartialTensorShape>(output_types.size()), map_defun);
+  NameAttrList f;
+  f.set_name(signature->name());
+  AddNodeAttr("f", f, map_defun);
+  return map_defun;
+}
+
+// Adds to `library` a function that computes `function` over a batch of
+// elements and returns its name, or an empty string if `function` can not be
+// vectorized. The first `arg_ranks.size()` arguments of `function` are
+// element components with the given ranks (-1 if unknown); the remaining
+// arguments are captured inputs shared by all elements.
+string VectorizeFunction(const FunctionDef& function,
+                         const std::vector<int>& arg_ranks,
+                         FunctionLibraryDefinition* function_library,
+                         FunctionDefLibrary* library) {
+  const OpDef& signature = function.signature();
+  if (signature.attr_size() > 0 || function.control_ret_size() > 0 ||
+      arg_ranks.size() > signature.input_arg_size() ||
+      function_utils::IsFunctionStateful(*function_library, function)) {
+    return "";
+  }
+  std::vector<const NodeDef*> sorted_nodes;
+  if (!SortFunctionNodes(function, &sorted_nodes)) return "";
+
+  // Functions are added to a copy of the library, which replaces `library`
+  // only if vectorization succeeds.
+  FunctionDefLibrary new_library = *library;
+  FunctionDef* vectorized = new_library.add_function();
+  *vectorized = function;
+  vectorized->clear_node_def();
+  vectorized->clear_ret();
+  graph_utils::SetUniqueGraphFunctionName(
+      absl::StrCat(signature.name(), "_vectorized"), &new_library, vectorized);
+
+  absl::flat_hash_map<string, TensorInfo> tensors;
+  for (int i = 0; i < signature.input_arg_size(); ++i) {
+    TensorInfo& info = tensors[signature.input_arg(i).name()];
+    if (i < arg_ranks.size()) {
+      info.batched = true;
+      info.rank = arg_ranks[i];
+    }
+  }
+  // Maps references to outputs of nodes that were replaced by `MapDefun` to
+  // the corresponding `MapDefun` outputs.
+  absl::flat_hash_map<string, string> renamed;
+  bool used_fallback = false;
+
+  for (const NodeDef* node : sorted_nodes) {
+    const OpDef* op_def;
+    if (!function_library->LookUpOpDef(node->op(), &op_def).ok()) return "";
+    NodeDef new_node = *node;
+    AddDefaultsToNodeDef(*op_def, &new_node);
+
+    std::vector<TensorInfo> inputs;
+    for (string& input : *new_node.mutable_input()) {
+      if (IsControlInput(input)) return "";
+      auto it = tensors.find(input);
+      if (it == tensors.end()) return "";
+      inputs.push_back(it->second);
+      auto renamed_it = renamed.find(input);
+      if (renamed_it != renamed.end()) input = renamed_it->second;
+    }
+
+    NameRangeMap output_ranges;
+    if (!NameRangesForNode(new_node, *op_def, nullptr, &output_ranges).ok()) {
+      return "";
+    }
+    std::vector<string> outputs;
+    for (const auto& [name, range] : output_ranges) {
+      if (outputs.size() < range.second) outputs.resize(range.second);
+      for (int i = range.first; i < range.second; ++i) {
+        outputs[i] =
+            absl::StrCat(node->name(), ":", name, ":", i - range.first);
+      }
+    }
+
+    const bool any_batched = absl::c_any_of(
+        inputs, [](const TensorInfo& input) { return input.batched; });
+    int rank = -1;
+    if (!any_batched) {
+      rank = UnbatchedRank(new_node, inputs);
+    } else if (!IsElementwiseOp(node->op()) ||
+               !HasBatchedForm(inputs, &rank)) {
+      NodeDef* map_defun = AddMapDefunNode(new_node, *op_def, inputs, outputs,
+                                           &new_library, vectorized);
+      if (map_defun == nullptr) return "";
+      for (int i = 0; i < outputs.size(); ++i) {
+        renamed[outputs[i]] = absl::StrCat(map_defun->name(), ":output:", i);
+        tensors[outputs[i]] = {/*batched=*/true, /*rank=*/-1};
+      }
+      used_fallback = true;
+      continue;
+    }
+    for (const string& output : outputs) {
+      tensors[output] = {any_batched, rank};
+    }
+    *vectorized->add_node_def() = std::move(new_node);
+  }
+
+  for (const auto& [name, output] : function.ret()) {
+    // Outputs that do not depend on the batched inputs would have to be tiled
+    // to the batch size, which is not supported.
+    auto it = tensors.find(output);
+    if (it == tensors.end() || !it->second.batched) return "";
+    auto renamed_it = renamed.find(output);
+    (*vectorized->mutable_ret())[name] =
+        renamed_it == renamed.end() ? output : renamed_it->second;
+  }
+  (*vectorized->mutable_attr())[data::kMapVectorizationAttr].set_s(
+      used_fallback ? kFallback : kVectorized);
+
+  const string vectorized_name = vectorized->signature().name();
+  for (int i = library->function_size(); i < new_library.function_size();
+       ++i) {
+    if (!function_library->AddFunctionDef(new_library.function(i)).ok()) {
+      return "";
+    }
+  }
+  *library = std::move(new_library);
+  return vectorized_name;
+}
+
+// Adds to `library` a function that applies the vectorized map function
+// `map_func` to a batch, evaluates the vectorized predicate `predicate_func`
+// on the result and keeps the rows for which the predicate holds.
+FunctionDef* AddMapAndFilterFunction(const FunctionDef& map_func,
+                                     const FunctionDef& predicate_func,
+                                     FunctionDefLibrary* library) {
+  FunctionDef* func = library->add_function();
+  OpDef* signature = func->mutable_signature();
+  *signature->mutable_input_arg() = map_func.signature().input_arg();
+  *signature->mutable_output_arg() = map_func.signature().output_arg();
+  graph_utils::SetUniqueGraphFunctionName("vectorized_map_and_filter", library,
+                                          func);
+
+  std::vector<string> map_inputs;
+  for (const auto& arg : map_func.signature().input_arg()) {
+    map_inputs.push_back(arg.name());
+  }
+  function_utils::AddNode("map", map_func.signature().name(), map_inputs, {},
+                          func);
+  std::vector<string> map_outputs;
+  for (const auto& arg : map_func.signature().output_arg()) {
+    map_outputs.push_back(absl::StrCat("map:", arg.name(), ":0"));
+  }
+  function_utils::AddNode("predicate", predicate_func.signature().name(),
+                          map_outputs, {}, func);
+
+  AttrValue bool_type;
+  SetAttrValue(DT_BOOL, &bool_type);
+  AttrValue int32_type;
+  SetAttrValue(DT_INT32, &int32_type);
+  AttrValue int64_type;
+  SetAttrValue(DT_INT64, &int64_type);
+  Tensor flat_shape_tensor(DT_INT32, TensorShape({1}));
+  flat_shape_tensor.vec<int32>()(0) = -1;
+  AttrValue flat_shape;
+  SetAttrValue(flat_shape_tensor, &flat_shape);
+  AttrValue zero;
+  SetAttrValue(Tensor(int32_t{0}), &zero);
+
+  const string predicate_output = absl::StrCat(
+      "predicate:", predicate_func.signature().output_arg(0).name(), ":0");
+  function_utils::AddNode("indices", "Where", {predicate_output},
+                          {{"T", bool_type}}, func);
+  function_utils::AddNode("shape", "Const", {},
+                          {{"dtype", int32_type}, {"value", flat_shape}},
+                          func);
+  function_utils::AddNode("flat_indices", "Reshape",
+                          {"indices:index:0", "shape:output:0"},
+                          {{"T", int64_type}, {"Tshape", int32_type}}, func);
+  function_utils::AddNode("axis", "Const", {},
+                          {{"dtype", int32_type}, {"value", zero}}, func);
+  AttrValue batch_dims;
+  SetAttrValue(0, &batch_dims);
+  for (int i = 0; i < signature->output_arg_size(); ++i) {
+    const OpDef::ArgDef& arg = signature->output_arg(i);
+    AttrValue params_type;
+    SetAttrValue(arg.type(), &params_type);
+    const string name = absl::StrCat("gather_", i);
+    function_utils::AddNode(
+        name, "GatherV2",
+        {map_outputs[i], "flat_indices:output:0", "axis:output:0"},
+        {{"Tparams", params_type},
+         {"Tindices", int64_type},
+         {"Taxis", int32_type},
+         {"batch_dims", batch_dims}},
+        func);
+    (*func->mutable_ret())[arg.name()] = absl::StrCat(name, ":output:0");
+  }
+
+  const bool vectorized =
+      map_func.attr().at(data::kMapVectorizationAttr).s() == kVectorized &&
+      predicate_func.attr().at(data::kMapVectorizationAttr).s() == kVectorized;
+  (*func->mutable_attr())[data::kMapVectorizationAttr].set_s(
+      vectorized ? kVectorized : kFallback);
+  return func;
+}
+
+// Returns a batch node that batches the input of `map_node` the same way
+// `batch_node` batches its input. `drop_remainder` names the node that
+// provides the `drop_remainder` input of `BatchDatasetV2`.
+NodeDef MakeInnerBatchNode(const NodeDef& batch_node, const NodeDef& map_node,
+                           const NodeDef& map_input, int64_t batch_dim,
+                           const string& drop_remainder,
+                           MutableGraphView* graph) {
+  NodeDef inner_batch;
+  graph_utils::SetUniqueGraphNodeName("vectorized_batch", graph->graph(),
+                                      &inner_batch);
+  inner_batch.set_op(batch_node.op());
+  inner_batch.add_input(map_node.input(0));
+  inner_batch.add_input(batch_node.input(1));
+  if (batch_node.op() == kBatchDatasetV2) {
+    inner_batch.add_input(drop_remainder);
+  }
+  if (batch_node.attr().contains("parallel_copy")) {
+    graph_utils::CopyAttribute("parallel_copy", batch_node, &inner_batch);
+  }
+  graph_utils::CopyAttribute(kOutputTypes, map_input, &inner_batch);
+  (*inner_batch.mutable_attr())[kOutputShapes] =
+      BatchShapes(map_input.attr().at(kOutputShapes), batch_dim);
+  return inner_batch;
+}
+
+// Returns a copy of `map_node` that reads from `input` and applies the
+// function named `func_name`.
+NodeDef MakeVectorizedMapNode(const NodeDef& map_node, const NodeDef& input,
+                              const string& func_name,
+                              MutableGraphView* graph) {
+  NodeDef vectorized_map = map_node;
+  graph_utils::SetUniqueGraphNodeName("vectorized_map", graph->graph(),
+                                      &vectorized_map);
+  vectorized_map.set_input(0, input.name());
+  NameAttrList* f = (*vectorized_map.mutable_attr())["f"].mutable_func();
+  f->set_name(func_name);
+  f->clear_attr();
+  return vectorized_map;
+}
+
+}  // namespace
+
+absl::Status MapVectorization::OptimizeAndCollectStats(
+    Cluster* cluster, const GrapplerItem& item, GraphDef* output,
+    OptimizationStats* stats) {
+  *output = item.graph;
+  MutableGraphView graph(output);
+  absl::flat_hash_set<string> nodes_to_delete;
+  FunctionLibraryDefinition function_library(OpRegistry::Global(),
+                                             item.graph.library());
+
+  auto has_single_fanout = [&graph](const NodeDef& node) {
+    return graph.GetFanouts(node, /*include_controlled_nodes=*/true).size() ==
+           1;
+  };
+
+  for (const NodeDef& batch_node : item.graph.node()) {
+    if (batch_node.op() != kBatchDataset &&
+        batch_node.op() != kBatchDatasetV2) {
+      continue;
+    }
+    NodeDef* filter_node = nullptr;
+    NodeDef* map_node = graph_utils::GetInputNode(batch_node, graph);
+    if (map_node->op() == kFilterDataset) {
+      filter_node = map_node;
+      map_node = graph_utils::GetInputNode(*filter_node, graph);
+      // TODO(b/148614315): Support captured inputs.
+      if (filter_node->input_size() != 1 ||
+          !filter_node->attr().contains(kOutputShapes) ||
+          !filter_node->attr().contains(kOutputTypes) ||
+          !has_single_fanout(*filter_node)) {
+        continue;
+      }
+    }
+    if (map_node->op() != kParallelMapDataset ||
+        !has_single_fanout(*map_node) ||
+        nodes_to_delete.contains(map_node->name())) {
+      continue;
+    }
+
+    // The batch moves in front of the map, so it must be able to batch the
+    // elements of the map input, which is only guaranteed if their shapes are
+    // fully defined. E.g. a map that resizes images of varying sizes produces
+    // elements that `batch` accepts, but its input does not. The element
+    // shapes also determine which ops of the map function can be applied to
+    // a batch directly.
+    const NodeDef* map_input = graph_utils::GetInputNode(*map_node, graph);
+    if (!map_input->attr().contains(kOutputShapes) ||
+        !map_input->attr().contains(kOutputTypes) ||
+        !AllShapesFullyDefined(map_input->attr().at(kOutputShapes))) {
+      continue;
+    }
+    std::vector<int> arg_ranks;
+    for (const auto& shape :
+         map_input->attr().at(kOutputShapes).list().shape()) {
+      arg_ranks.push_back(Rank(shape));
+    }
+
+    const FunctionDef* map_func =
+        function_library.Find(map_node->attr().at("f").func().name());
+    if (map_func == nullptr) continue;
+    const string vectorized_map_func = VectorizeFunction(
+        *map_func, arg_ranks, &function_library, output->mutable_library());
+    if (vectorized_map_func.empty()) {
+      VLOG(1) << "Can't vectorize the function of " << map_node->name();
+      continue;
+    }
+
+    if (filter_node == nullptr) {
+      NodeDef* inner_batch = graph.AddNode(MakeInnerBatchNode(
+          batch_node, *map_node, *map_input, BatchDim(batch_node),
+          batch_node.op() == kBatchDatasetV2 ? batch_node.input(2) : "",
+          &graph));
+      NodeDef vectorized_map = MakeVectorizedMapNode(
+          *map_node, *inner_batch, vectorized_map_func, &graph);
+      graph_utils::CopyShapesAndTypesAttrs(batch_node, &vectorized_map);
+      NodeDef* new_map = graph.AddNode(std::move(vectorized_map));
+      TF_RETURN_IF_ERROR(
+          graph.UpdateFanouts(batch_node.name(), new_map->name()));
+      nodes_to_delete.insert(batch_node.name());
+      nodes_to_delete.insert(map_node->name());
+      stats->num_changes++;
+      continue;
+    }
+
+    // The predicate receives the outputs of the map function, all of which
+    // are batched.
+    const FunctionDef* predicate_func = function_library.Find(
+        filter_node->attr().at("predicate").func().name());
+    if (predicate_func == nullptr) continue;
+    std::vector<int> predicate_arg_ranks;
+    for (const auto& shape :
+         filter_node->attr().at(kOutputShapes).list().shape()) {
+      predicate_arg_ranks.push_back(Rank(shape));
+    }
+    const string vectorized_predicate =
+        VectorizeFunction(*predicate_func, predicate_arg_ranks,
+                          &function_library, output->mutable_library());
+    if (vectorized_predicate.empty()) {
+      VLOG(1) << "Can't vectorize the predicate of " << filter_node->name();
+      continue;
+    }
+    FunctionDef* map_and_filter_func = AddMapAndFilterFunction(
+        *function_library.Find(vectorized_map_func),
+        *function_library.Find(vectorized_predicate),
+        output->mutable_library());
+    TF_RETURN_IF_ERROR(function_library.AddFunctionDef(*map_and_filter_func));
+
+    // Filtering makes the number of elements per batch vary, so the map runs
+    // on batches that keep the remainder and the result is rebatched.
+    const string drop_remainder =
+        batch_node.op() == kBatchDatasetV2
+            ? graph_utils::AddScalarConstNode(false, &graph)->name()
+            : "";
+    NodeDef* inner_batch = graph.AddNode(
+        MakeInnerBatchNode(batch_node, *map_node, *map_input, /*batch_dim=*/-1,
+                           drop_remainder, &graph));
+    NodeDef vectorized_map =
+        MakeVectorizedMapNode(*map_node, *inner_batch,
+                              map_and_filter_func->signature().name(), &graph);
+    graph_utils::CopyAttribute(kOutputTypes, *filter_node, &vectorized_map);
+    (*vectorized_map.mutable_attr())[kOutputShapes] = BatchShapes(
+        filter_node->attr().at(kOutputShapes), /*batch_dim=*/-1);
+    NodeDef* new_map = graph.AddNode(std::move(vectorized_map));
+
+    NodeDef unbatch;
+    graph_utils::SetUniqueGraphNodeName("vectorized_unbatch", graph.graph(),
+                                        &unbatch);
+    unbatch.set_op(kUnbatchDataset);
+    unbatch.add_input(new_map->name());
+    graph_utils::CopyShapesAndTypesAttrs(*filter_node, &unbatch);
+    NodeDef* new_unbatch = graph.AddNode(std::move(unbatch));
+
+    TF_RETURN_IF_ERROR(
+        graph.UpdateFanouts(filter_node->name(), new_unbatch->name()));
+    nodes_to_delete.insert(filter_node->name());
+    nodes_to_delete.insert(map_node->name());
+    stats->num_changes++;
+  }
+
+  TF_RETURN_IF_ERROR(graph.DeleteNodes(nodes_to_delete));
+  return absl::OkStatus();
+}
+
+REGISTER_GRAPH_OPTIMIZER_AS(MapVectorization, "map_vectorization");
+
+}  // namespace grappler
+}  // namespace tensorflow
@@ -0,0 +1,68 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_GRAPPLER_OPTIMIZERS_DATA_MAP_VECTORIZATION_H_
+#define TENSORFLOW_CORE_GRAPPLER_OPTIMIZERS_DATA_MAP_VECTORIZATION_H_
+
+#include "tensorflow/core/grappler/optimizers/data/optimizer_base.h"
+
+namespace tensorflow {
+namespace grappler {
+
+// This transformation moves a batch in front of a parallel map (and an
+// optional filter) so that the map function runs once per batch instead of
+// once per element.
+//
+// In symbols, we transform map(f).batch(n) into batch(n).map(f'), and
+// map(f).filter(p).batch(n) into batch(n).map(g).unbatch().batch(n), where f'
+// applies f to a leading batch dimension and g computes f' followed by the
+// vectorized predicate p', keeping only the rows for which p' holds.
+//
+// f' keeps element-wise ops whose batched form is the op itself. Every other
+// op that depends on the batched inputs is wrapped in a `MapDefun` node, which
+// runs the op once per element, so the rewrite applies to any stateless
+// function. The vectorized function is tagged with the `_map_vectorization`
+// attribute, set to "vectorized" if no op needed the per-element fallback and
+// to "fallback" otherwise.
+//
+// The rewrite only applies if the element shapes of the map input are fully
+// defined, so that the hoisted batch can batch them. Since the map function
+// then runs on a whole batch, an error that it raises for one element fails
+// the whole batch, e.g. `ignore_errors()` after the batch drops every element
+// of the batch instead of only the failing one.
+class MapVectorization : public TFDataOptimizerBase {
+ public:
+  MapVectorization() = default;
+  ~MapVectorization() override = default;
+
+  string name() const override { return "map_vectorization"; };
+
+  bool UsesFunctionLibrary() const override { return false; }
+
+  absl::Status Init(
+      const tensorflow::RewriterConfig_CustomGraphOptimizer* config) override {
+    return absl::OkStatus();
+  }
+
+  absl::Status OptimizeAndCollectStats(Cluster* cluster,
+                                       const GrapplerItem& item,
+                                       GraphDef* output,
+                                       OptimizationStats* stats) override;
+};
+
+}  // namespace grappler
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_GRAPPLER_OPTIMIZERS_DATA_MAP_VECTORIZATION_H_
@@ -0,0 +1,308 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/optimizers/data/map_vectorization.h"
+
+#include <vector>
+
+#include "tensorflow/core/framework/attr_value_util.h"
+#include "tensorflow/core/framework/function_testlib.h"
+#include "tensorflow/core/framework/partial_tensor_shape.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/grappler/grappler_item.h"
+#include "tensorflow/core/grappler/optimizers/data/function_utils.h"
+#include "tensorflow/core/grappler/optimizers/data/graph_test_utils.h"
+#include "tensorflow/core/grappler/optimizers/data/graph_utils.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace grappler {
+namespace {
+
+using graph_tests_utils::MakeBatchV2Node;
+using graph_tests_utils::MakeParallelMapV2Node;
+using test::function::NDef;
+
+using FDH = FunctionDefHelper;
+
+const std::vector<TensorShape>& ScalarShapes() {
+  static const auto* const kShapes =
+      new std::vector<TensorShape>({TensorShape({})});
+  return *kShapes;
+}
+
+const std::vector<DataType>& Int64Types() {
+  static const auto* const kTypes = new std::vector<DataType>({DT_INT64});
+  return *kTypes;
+}
+
+FunctionDef AddOne() {
+  return FDH::Define(
+      // Name
+      "AddOne",
+      // Args
+      {"x: int64"},
+      // Return values
+      {"y: int64"},
+      // Attr def
+      {},
+      // Nodes
+      {
+          {{"one"},
+           "Const",
+           {},
+           {{"value", test::AsScalar<int64_t>(1)}, {"dtype", DT_INT64}}},
+          {{"y"}, "AddV2", {"x", "one"}, {{"T", DT_INT64}}},
+      });
+}
+
+FunctionDef ReshapeToVector() {
+  return FDH::Define(
+      // Name
+      "ReshapeToVector",
+      // Args
+      {"x: int64"},
+      // Return values
+      {"y: int64"},
+      // Attr def
+      {},
+      // Nodes
+      {
+          {{"shape"},
+           "Const",
+           {},
+           {{"value", test::AsTensor<int32>({1})}, {"dtype", DT_INT32}}},
+          {{"y"},
+           "Reshape",
+           {"x", "shape"},
+           {{"T", DT_INT64}, {"Tshape", DT_INT32}}},
+      });
+}
+
+FunctionDef IsPositive() {
+  return FDH::Define(
+      // Name
+      "IsPositive",
+      // Args
+      {"x: int64"},
+      // Return values
+      {"positive: bool"},
+      // Attr def
+      {},
+      // Nodes
+      {
+          {{"zero"},
+           "Const",
+           {},
+           {{"value", test::AsScalar<int64_t>(0)}, {"dtype", DT_INT64}}},
+          {{"positive"}, "Greater", {"x", "zero"}, {{"T", DT_INT64}}},
+      });
+}
+
+FunctionDef RandomScalar() {
+  return FDH::Define(
+      // Name
+      "RandomScalar",
+      // Args
+      {"x: int64"},
+      // Return values
+      {"y: float"},
+      // Attr def
+      {},
+      // Nodes
+      {
+          {{"shape"},
+           "Const",
+           {},
+           {{"value", test::AsTensor<int32>({})}, {"dtype", DT_INT32}}},
+          {{"y"},
+           "RandomUniform",
+           {"shape"},
+           {{"T", DT_INT32}, {"dtype", DT_FLOAT}}},
+      });
+}
+
+// Returns a graph of range(10).map(`map_function`).batch(4).
+GraphDef MakeMapAndBatchGraph(const FunctionDef& map_function) {
+  return test::function::GDef(
+      {NDef("start", "Const", {}, {{"value", 0}, {"dtype", DT_INT32}}),
+       NDef("stop", "Const", {}, {{"value", 10}, {"dtype", DT_INT32}}),
+       NDef("step", "Const", {}, {{"value", 1}, {"dtype", DT_INT32}}),
+       NDef("range", "RangeDataset", {"start", "stop", "step"},
+            {{"output_shapes", ScalarShapes()},
+             {"output_types", Int64Types()}}),
+       NDef("num_parallel_calls", "Const", {},
+            {{"value", -1}, {"dtype", DT_INT32}}),
+       MakeParallelMapV2Node("map", "range", "num_parallel_calls",
+                             map_function.signature().name(), "default",
+                             /*use_unbounded_threadpool=*/false),
+       NDef("batch_size", "Const", {}, {{"value", 4}, {"dtype", DT_INT32}}),
+       NDef("drop_remainder", "Const", {},
+            {{"value", false}, {"dtype", DT_BOOL}}),
+       MakeBatchV2Node("batch", "map", "batch_size", "drop_remainder",
+                       /*parallel_copy=*/false)},
+      {map_function});
+}
+
+// Returns the function applied by the single `ParallelMapDatasetV2` node of
+// `graph`.
+const FunctionDef& GetMapFunction(const GraphDef& graph) {
+  const NodeDef& map_node = graph.node(
+      graph_utils::FindGraphNodeWithOp("ParallelMapDatasetV2", graph));
+  const string& function_name = map_node.attr().at("f").func().name();
+  return graph.library().function(
+      graph_utils::FindGraphFunctionWithName(function_name, graph.library()));
+}
+
+TEST(MapVectorizationTest, VectorizesElementwiseFunction) {
+  GrapplerItem item;
+  item.graph = MakeMapAndBatchGraph(AddOne());
+
+  MapVectorization optimizer;
+  GraphDef output;
+  TF_ASSERT_OK(optimizer.Optimize(nullptr, item, &output));
+
+  EXPECT_FALSE(graph_utils::ContainsGraphNodeWithName("map", output));
+  EXPECT_FALSE(graph_utils::ContainsGraphNodeWithName("batch", output));
+  const NodeDef& map_node = output.node(
+      graph_utils::FindGraphNodeWithOp("ParallelMapDatasetV2", output));
+  const NodeDef& batch_node = output.node(
+      graph_utils::FindGraphNodeWithName(map_node.input(0), output));
+  EXPECT_EQ(batch_node.op(), "BatchDatasetV2");
+  EXPECT_EQ(batch_node.input(0), "range");
+  EXPECT_EQ(batch_node.input(1), "batch_size");
+  EXPECT_EQ(batch_node.input(2), "drop_remainder");
+
+  const FunctionDef& function = GetMapFunction(output);
+  EXPECT_EQ(function.attr().at("_map_vectorization").s(), "vectorized");
+  EXPECT_TRUE(function_utils::ContainsFunctionNodeWithOp("AddV2", function));
+  EXPECT_FALSE(
+      function_utils::ContainsFunctionNodeWithOp("MapDefun", function));
+}
+
+TEST(MapVectorizationTest, FallsBackPerOp) {
+  GrapplerItem item;
+  item.graph = MakeMapAndBatchGraph(ReshapeToVector());
+
+  MapVectorization optimizer;
+  GraphDef output;
+  TF_ASSERT_OK(optimizer.Optimize(nullptr, item, &output));
+
+  EXPECT_FALSE(graph_utils::ContainsGraphNodeWithName("map", output));
+  const FunctionDef& function = GetMapFunction(output);
+  EXPECT_EQ(function.attr().at("_map_vectorization").s(), "fallback");
+  EXPECT_FALSE(function_utils::ContainsFunctionNodeWithOp("Reshape", function));
+  const NodeDef& map_defun = function.node_def(
+      function_utils::FindFunctionNodeWithOp("MapDefun", function));
+  EXPECT_EQ(map_defun.input(0), "x");
+  EXPECT_EQ(map_defun.input(1), "shape:output:0");
+  EXPECT_EQ(map_defun.attr().at("Targuments").list().type_size(), 1);
+  EXPECT_EQ(map_defun.attr().at("Tcaptured").list().type_size(), 1);
+  EXPECT_TRUE(graph_utils::ContainsGraphFunctionWithName(
+      map_defun.attr().at("f").func().name(), output.library()));
+}
+
+TEST(MapVectorizationTest, DoesNotVectorizeStatefulFunction) {
+  GrapplerItem item;
+  item.graph = MakeMapAndBatchGraph(RandomScalar());
+
+  MapVectorization optimizer;
+  GraphDef output;
+  TF_ASSERT_OK(optimizer.Optimize(nullptr, item, &output));
+
+  EXPECT_TRUE(graph_utils::ContainsGraphNodeWithName("map", output));
+  EXPECT_TRUE(graph_utils::ContainsGraphNodeWithName("batch", output));
+}
+
+TEST(MapVectorizationTest, DoesNotVectorizeInputWithUndefinedShapes) {
+  GrapplerItem item;
+  item.graph = MakeMapAndBatchGraph(AddOne());
+  // The map could turn elements of varying sizes into batchable ones, so the
+  // batch can't be moved in front of it.
+  NodeDef* range = item.graph.mutable_node(
+      graph_utils::FindGraphNodeWithName("range", item.graph));
+  PartialTensorShape({-1}).AsProto((*range->mutable_attr())["output_shapes"]
+                                       .mutable_list()
+                                       ->mutable_shape(0));
+
+  MapVectorization optimizer;
+  GraphDef output;
+  TF_ASSERT_OK(optimizer.Optimize(nullptr, item, &output));
+
+  EXPECT_TRUE(graph_utils::ContainsGraphNodeWithName("map", output));
+  EXPECT_TRUE(graph_utils::ContainsGraphNodeWithName("batch", output));
+}
+
+TEST(MapVectorizationTest, VectorizesMapFilterAndBatch) {
+  GrapplerItem item;
+  item.graph = test::function::GDef(
+      {NDef("start", "Const", {}, {{"value", 0}, {"dtype", DT_INT32}}),
+       NDef("stop", "Const", {}, {{"value", 10}, {"dtype", DT_INT32}}),
+       NDef("step", "Const", {}, {{"value", 1}, {"dtype", DT_INT32}}),
+       NDef("range", "RangeDataset", {"start", "stop", "step"},
+            {{"output_shapes", ScalarShapes()},
+             {"output_types", Int64Types()}}),
+       NDef("num_parallel_calls", "Const", {},
+            {{"value", -1}, {"dtype", DT_INT32}}),
+       MakeParallelMapV2Node("map", "range", "num_parallel_calls", "AddOne",
+                             "default", /*use_unbounded_threadpool=*/false),
+       NDef("filter", "FilterDataset", {"map"},
+            {{"predicate", FDH::FunctionRef("IsPositive")},
+             {"Targuments", {}},
+             {"output_shapes", ScalarShapes()},
+             {"output_types", Int64Types()}}),
+       NDef("batch_size", "Const", {}, {{"value", 4}, {"dtype", DT_INT32}}),
+       NDef("drop_remainder", "Const", {},
+            {{"value", true}, {"dtype", DT_BOOL}}),
+       MakeBatchV2Node("batch", "filter", "batch_size", "drop_remainder",
+                       /*parallel_copy=*/false)},
+      {AddOne(), IsPositive()});
+
+  MapVectorization optimizer;
+  GraphDef output;
+  TF_ASSERT_OK(optimizer.Optimize(nullptr, item, &output));
+
+  EXPECT_FALSE(graph_utils::ContainsGraphNodeWithName("map", output));
+  EXPECT_FALSE(graph_utils::ContainsGraphNodeWithName("filter", output));
+  ASSERT_TRUE(graph_utils::ContainsGraphNodeWithName("batch", output));
+
+  // batch -> unbatch -> map -> batch that keeps the remainder -> range.
+  const NodeDef& batch_node =
+      output.node(graph_utils::FindGraphNodeWithName("batch", output));
+  const NodeDef& unbatch_node = output.node(
+      graph_utils::FindGraphNodeWithName(batch_node.input(0), output));
+  EXPECT_EQ(unbatch_node.op(), "UnbatchDataset");
+  const NodeDef& map_node = output.node(
+      graph_utils::FindGraphNodeWithName(unbatch_node.input(0), output));
+  EXPECT_EQ(map_node.op(), "ParallelMapDatasetV2");
+  const NodeDef& inner_batch_node = output.node(
+      graph_utils::FindGraphNodeWithName(map_node.input(0), output));
+  EXPECT_EQ(inner_batch_node.op(), "BatchDatasetV2");
+  EXPECT_EQ(inner_batch_node.input(0), "range");
+  const NodeDef& drop_remainder_node = output.node(
+      graph_utils::FindGraphNodeWithName(inner_batch_node.input(2), output));
+  EXPECT_FALSE(drop_remainder_node.attr().at("value").tensor().bool_val(0));
+
+  const FunctionDef& function = GetMapFunction(output);
+  EXPECT_EQ(function.attr().at("_map_vectorization").s(), "vectorized");
+  EXPECT_TRUE(function_utils::ContainsFunctionNodeWithOp("Where", function));
+  EXPECT_TRUE(function_utils::ContainsFunctionNodeWithOp("GatherV2", function));
+}
+
+}  // namespace
+}  // namespace grappler
+}  // namespace tensorflow
@@ -39,7 +39,7 @@ using ConfigMap =
 
 // tf.data optimizations, in the order we want to perform them.
 // clang-format off
-constexpr std::array<const char*, 22> kTFDataOptimizations = {
+constexpr std::array<const char*, 23> kTFDataOptimizations = {
     "noop_elimination",
     "disable_intra_op_parallelism",
     "use_private_thread_pool",
@@ -47,6 +47,7 @@ constexpr std::array<const char*, 22> kTFDataOptimizations = {
     "map_parallelization",
     "map_fusion",
     "filter_fusion",
+    "map_vectorization",
     "map_and_filter_fusion",
     "map_and_batch_fusion",
     "batch_parallelization",
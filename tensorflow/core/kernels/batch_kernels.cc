@@ -317,6 +317,24 @@ BatchFunctionKernel::BatchFunctionKernel(OpKernelConstruction* c)
     has_attribute_enable_large_batch_splitting_ = true;
   }
 
+  if (c->HasAttr("ragged_output_indices")) {
+    OP_REQUIRES_OK(
+        c, c->GetAttr("ragged_output_indices", &ragged_output_indices_));
+  }
+  OP_REQUIRES(c,
+              ragged_output_indices_.empty() ||
+                  batch_padding_policy_ == serving::kRaggedPolicy,
+              errors::InvalidArgument(
+                  "ragged_output_indices requires the RAGGED batch padding "
+                  "policy; got ",
+                  batch_padding_policy_));
+  for (int32 index : ragged_output_indices_) {
+    OP_REQUIRES(c, index >= 0 && index < c->num_outputs(),
+                errors::InvalidArgument(
+                    "ragged_output_indices entry ", index,
+                    " is out of range for ", c->num_outputs(), " outputs"));
+  }
+
   // Helper function `SetAdaptiveBatchSchedulerOptions` calls
   // `OP_REQUIRES_OK`, which exits the current function upon error.
   // So validate status of `op-kernel-construction`.
@@ -324,6 +342,14 @@ BatchFunctionKernel::BatchFunctionKernel(OpKernelConstruction* c)
   if (!c->status().ok()) {
     return;
   }
+  // The adaptive shared batch scheduler does not take a batch padding policy,
+  // so ragged batches would be padded and concatenated like dense ones.
+  OP_REQUIRES(c,
+              !enable_adaptive_batch_threads_ ||
+                  batch_padding_policy_ != serving::kRaggedPolicy,
+              errors::InvalidArgument(
+                  "The RAGGED batch padding policy is not supported with "
+                  "the adaptive batch scheduler."));
 
   if (enable_adaptive_batch_threads_) {
     // One scheduler instance contains a couple of queue instances,
@@ -445,6 +471,7 @@ void BatchFunctionKernel::ComputeAsync(OpKernelContext* c, DoneCallback done) {
       if (session_metadata) {
         new_resource->set_session_metadata(*session_metadata);
       }
+      new_resource->set_ragged_output_indices(ragged_output_indices_);
       *r = new_resource.release();
       return absl::OkStatus();
     };
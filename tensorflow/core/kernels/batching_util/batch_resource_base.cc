@@ -37,6 +37,7 @@ limitations under the License.
 #include "absl/synchronization/mutex.h"
 #include "absl/time/time.h"
 #include "absl/types/optional.h"
+#include "absl/types/span.h"
 #include "tensorflow/core/common_runtime/cost_constants.h"
 #include "tensorflow/core/common_runtime/cost_measurement.h"
 #include "tensorflow/core/common_runtime/cost_measurement_registry.h"
@@ -298,6 +299,13 @@ int GetTotalTaskSize(
   return tasks_size;
 }
 
+// Returns the number of values of an input of the given shape when it is
+// packed into a ragged tensor. See BatchResourceBase::PackRaggedInput.
+int64_t NumRaggedValues(const TensorShape& shape) {
+  return shape.dims() > 1 ? shape.dim_size(0) * shape.dim_size(1)
+                          : shape.dim_size(0);
+}
+
 }  // namespace
 
 std::unique_ptr<BatchResourceBase::BatchTask>
@@ -592,7 +600,9 @@ BatchResourceBase::GetBatcherQueueOptions(
       batcher_queue_options.allowed_batch_sizes = allowed_batch_sizes;
     }
   }
-  batcher_queue_options.disable_padding = disable_padding;
+  // Ragged batches are never padded.
+  batcher_queue_options.disable_padding =
+      disable_padding || batch_padding_policy == kRaggedPolicy;
 
   return batcher_queue_options;
 }
@@ -710,7 +720,9 @@ absl::Status BatchResourceBase::ConcatInputTensors(
 
   // All tasks should have the same number of input edges.
   const int num_inputs = batch.task(0).inputs.size();
-  concatenated_tensors->reserve(num_inputs);
+  const bool ragged =
+      batcher_queue_options_.batch_padding_policy == kRaggedPolicy;
+  concatenated_tensors->reserve(ragged ? 2 * num_inputs : num_inputs);
 
   // Process each input one at a time (the typical case has just one). When
   // `just_for_warmup` is true, the real data is not added. Otherwise, the real
@@ -752,6 +764,16 @@ absl::Status BatchResourceBase::ConcatInputTensors(
       }
     }
 
+    if (ragged) {
+      Tensor values;
+      Tensor row_splits;
+      TF_RETURN_IF_ERROR(
+          PackRaggedInput(context, to_concatenate, &values, &row_splits));
+      concatenated_tensors->push_back(std::move(values));
+      concatenated_tensors->push_back(std::move(row_splits));
+      continue;
+    }
+
     Tensor concatenated_tensor;
     absl::Status concat_status =
         Concat(context, to_concatenate, &concatenated_tensor);
@@ -893,6 +915,24 @@ absl::Status BatchResourceBase::SplitOutputTensors(
     return errors::Internal("Wrong number of batched output tensors");
   }
 
+  // With the RAGGED policy, the outputs in `ragged_output_indices_` are
+  // indexed by the values of the first input instead of its rows.
+  std::vector<TensorShape> ragged_input_shapes;
+  int64_t num_ragged_values = 0;
+  if (batcher_queue_options_.batch_padding_policy == kRaggedPolicy &&
+      !ragged_output_indices_.empty()) {
+    ragged_input_shapes.reserve(task_sizes_plus_optional_padding.size());
+    for (int i = 0; i < batch->num_tasks(); ++i) {
+      ragged_input_shapes.push_back(batch->task(i).inputs[0].shape());
+    }
+    for (int i = 0; i < unbatched_tasks.size(); ++i) {
+      ragged_input_shapes.push_back(unbatched_tasks[i]->inputs[0].shape());
+    }
+    for (const TensorShape& shape : ragged_input_shapes) {
+      num_ragged_values += NumRaggedValues(shape);
+    }
+  }
+
   // Split each element of `combined_outputs` according to task sizes
   // within the batch, and use this to populate context outputs.
   for (int i = 0, iter_limit = combined_outputs.size(); i < iter_limit; ++i) {
@@ -902,7 +942,18 @@ absl::Status BatchResourceBase::SplitOutputTensors(
           "Batched output tensor has 0 dimensions");
     }
     int64_t zeroth_dim_output_tensor_size = output_tensor.shape().dim_size(0);
-    if (zeroth_dim_output_tensor_size !=
+    std::vector<Tensor> split_tensor;
+    if (!ragged_input_shapes.empty() && ragged_output_indices_.contains(i)) {
+      if (zeroth_dim_output_tensor_size != num_ragged_values) {
+        return errors::FailedPrecondition(
+            "Batched ragged output tensor's 0th dimension does not equal the "
+            "number of values of the first input. 0th dimension size: ",
+            zeroth_dim_output_tensor_size,
+            "; number of values: ", num_ragged_values);
+      }
+      TF_RETURN_IF_ERROR(SplitRaggedOutput(output_tensor, ragged_input_shapes,
+                                           &split_tensor));
+    } else if (zeroth_dim_output_tensor_size !=
         static_cast<int64_t>(batch->size() + unbatched_tasks_size +
                              padding_size)) {
       return errors::FailedPrecondition(
@@ -912,22 +963,21 @@ absl::Status BatchResourceBase::SplitOutputTensors(
           zeroth_dim_output_tensor_size, "; batch size: ", batch->size(),
           "; unbatched tasks size: ", unbatched_tasks_size,
           "; padding size: ", padding_size);
-    }
-
-    std::vector<Tensor> split_tensor;
-    const absl::Status split_status = tensor::Split(
-        output_tensor, task_sizes_plus_optional_padding, &split_tensor);
-    DCHECK(split_status.ok()) << split_status;
-    if (!split_status.ok()) {
-      return errors::Internal("Tensor split operation failed: ",
-                              split_status.message());
-    }
-    DCHECK_EQ(split_tensor.size(), task_sizes_plus_optional_padding.size());
-    if (split_tensor.size() != task_sizes_plus_optional_padding.size()) {
-      return errors::Internal(
-          "Tensor split operation did not work as expected; got ",
-          split_tensor.size(), " splits; expected ",
-          task_sizes_plus_optional_padding.size());
+    } else {
+      const absl::Status split_status = tensor::Split(
+          output_tensor, task_sizes_plus_optional_padding, &split_tensor);
+      DCHECK(split_status.ok()) << split_status;
+      if (!split_status.ok()) {
+        return errors::Internal("Tensor split operation failed: ",
+                                split_status.message());
+      }
+      DCHECK_EQ(split_tensor.size(), task_sizes_plus_optional_padding.size());
+      if (split_tensor.size() != task_sizes_plus_optional_padding.size()) {
+        return errors::Internal(
+            "Tensor split operation did not work as expected; got ",
+            split_tensor.size(), " splits; expected ",
+            task_sizes_plus_optional_padding.size());
+      }
     }
 
     // Ignore a possible final split_tensors entry containing the padding.
@@ -951,6 +1001,99 @@ absl::Status BatchResourceBase::SplitOutputTensors(
   return absl::OkStatus();
 }
 
+/*static*/ absl::Status BatchResourceBase::PackRaggedInput(
+    OpKernelContext* context, absl::Span<const Tensor> inputs, Tensor* values,
+    Tensor* row_splits) {
+  if (inputs.empty()) {
+    return errors::InvalidArgument("No tensors to pack into a ragged tensor.");
+  }
+  int64_t num_rows = 0;
+  for (const Tensor& input : inputs) {
+    if (input.dims() == 0) {
+      return errors::InvalidArgument(
+          "Cannot pack a scalar into a ragged tensor when batching.");
+    }
+    num_rows += input.dim_size(0);
+  }
+  TF_RETURN_IF_ERROR(context->allocate_temp(
+      DT_INT64, TensorShape({num_rows + 1}), row_splits));
+  auto splits = row_splits->vec<int64_t>();
+  splits(0) = 0;
+
+  // Merges the first two dimensions of each input, which only changes the
+  // shape, and concatenates the results.
+  std::vector<Tensor> flat_inputs;
+  flat_inputs.reserve(inputs.size());
+  int64_t row = 0;
+  for (const Tensor& input : inputs) {
+    const int64_t row_length = input.dims() > 1 ? input.dim_size(1) : 1;
+    for (int64_t i = 0; i < input.dim_size(0); ++i, ++row) {
+      splits(row + 1) = splits(row) + row_length;
+    }
+    if (input.dims() == 1) {
+      flat_inputs.push_back(input);
+      continue;
+    }
+    TensorShape flat_shape = input.shape();
+    flat_shape.RemoveDim(1);
+    flat_shape.set_dim(0, NumRaggedValues(input.shape()));
+    Tensor flat_input;
+    if (!flat_input.CopyFrom(input, flat_shape)) {
+      return errors::Internal("Cannot reshape ",
+                              input.shape().DebugString(), " to ",
+                              flat_shape.DebugString());
+    }
+    flat_inputs.push_back(std::move(flat_input));
+  }
+  return Concat(context, flat_inputs, values);
+}
+
+/*static*/ absl::Status BatchResourceBase::SplitRaggedOutput(
+    const Tensor& output, absl::Span<const TensorShape> input_shapes,
+    std::vector<Tensor>* outputs) {
+  std::vector<int64_t> sizes;
+  sizes.reserve(input_shapes.size());
+  int64_t num_values = 0;
+  for (const TensorShape& shape : input_shapes) {
+    sizes.push_back(NumRaggedValues(shape));
+    num_values += sizes.back();
+  }
+  if (output.dims() == 0 || output.dim_size(0) != num_values) {
+    return errors::FailedPrecondition(
+        "Batched output tensor's 0th dimension does not equal the number of "
+        "values of the first ragged input. Output shape: ",
+        output.shape().DebugString(), "; number of values: ", num_values);
+  }
+
+  std::vector<Tensor> split_tensors;
+  const absl::Status split_status =
+      tensor::Split(output, sizes, &split_tensors);
+  if (!split_status.ok()) {
+    return errors::Internal("Tensor split operation failed: ",
+                            split_status.message());
+  }
+  outputs->clear();
+  outputs->reserve(split_tensors.size());
+  for (int i = 0; i < split_tensors.size(); ++i) {
+    const TensorShape& input_shape = input_shapes[i];
+    if (input_shape.dims() == 1) {
+      outputs->push_back(std::move(split_tensors[i]));
+      continue;
+    }
+    TensorShape shape = split_tensors[i].shape();
+    shape.set_dim(0, input_shape.dim_size(0));
+    shape.InsertDim(1, input_shape.dim_size(1));
+    Tensor task_output;
+    if (!task_output.CopyFrom(split_tensors[i], shape)) {
+      return errors::Internal("Cannot reshape ",
+                              split_tensors[i].shape().DebugString(), " to ",
+                              shape.DebugString());
+    }
+    outputs->push_back(std::move(task_output));
+  }
+  return absl::OkStatus();
+}
+
 void BatchResourceBase::CleanUpFunctionHelper(
     BatchTask& task, const absl::Status& status) const {
   WithContext wc(task.propagated_context);
@@ -24,9 +24,11 @@ limitations under the License.
 #include <utility>
 #include <vector>
 
+#include "absl/container/flat_hash_set.h"
 #include "absl/strings/str_join.h"
 #include "absl/strings/string_view.h"
 #include "absl/synchronization/blocking_counter.h"
+#include "absl/types/span.h"
 #include "tensorflow/core/common_runtime/cost_measurement_registry.h"
 #include "tensorflow/core/common_runtime/request_cost.h"
 #include "tensorflow/core/framework/op_kernel.h"
@@ -186,6 +188,14 @@ class BatchResourceBase : public ResourceBase {
 
   const SessionMetadata& session_metadata() const { return session_metadata_; }
 
+  // Sets the outputs of the batched function that, with the RAGGED batch
+  // padding policy, are indexed by the values rather than the rows of the
+  // first input.
+  void set_ragged_output_indices(absl::Span<const int32> indices) {
+    ragged_output_indices_ =
+        absl::flat_hash_set<int32>(indices.begin(), indices.end());
+  }
+
   using CreateBatchTaskFn =
       std::function<StatusOr<std::unique_ptr<BatchTask>>()>;
 
@@ -274,6 +284,28 @@ class BatchResourceBase : public ResourceBase {
           batch_cost_measurements,
       int64_t processed_size, BatchT& batch);
 
+  // Packs `inputs`, the tensors of one input of the tasks of a batch, into a
+  // ragged tensor for the RAGGED batch padding policy. An input of shape
+  // [rows, length, ...] contributes `rows` rows of `length` values each, and
+  // an input of rank 1 contributes rows of one value each.
+  //
+  // On return, `values` holds the values of all rows, of shape
+  // [total_values, ...], and `row_splits` is an int64 vector with
+  // total_rows + 1 entries, where row r is values[row_splits[r] :
+  // row_splits[r + 1]].
+  static Status PackRaggedInput(OpKernelContext* context,
+                                absl::Span<const Tensor> inputs,
+                                Tensor* values, Tensor* row_splits);
+
+  // Splits `output`, an output of a batched function whose 0th dimension
+  // indexes the values rather than the rows of the first ragged input, into
+  // one tensor per task. `input_shapes` are the shapes of the first input of
+  // the tasks, and the tensor of a task with input shape [rows, length, ...]
+  // has shape [rows, length] + output.shape[1:].
+  static Status SplitRaggedOutput(const Tensor& output,
+                                  absl::Span<const TensorShape> input_shapes,
+                                  std::vector<Tensor>* outputs);
+
  private:
   // Implementation of calling the process batch function.
   virtual void ProcessFuncBatchImpl(
@@ -302,12 +334,19 @@ class BatchResourceBase : public ResourceBase {
   // Concatenates the input tensors of the tasks from the batch and the
   // unbatched task vector. When padding is enabled in the batcher queue, they
   // are padded with garbage value up to the nearest allowed batch size.
+  //
+  // With the RAGGED batch padding policy, each input is instead packed with
+  // PackRaggedInput and contributes its values and row splits, in that order.
   Status ConcatInputTensors(
       const BatchT& batch,
       const std::vector<std::unique_ptr<BatchTask>>& unbatched_tasks,
       OpKernelContext* context,
       std::vector<Tensor>* concatenated_tensors) const;
 
+  // Splits the outputs of the batched function into the outputs of the tasks.
+  // With the RAGGED batch padding policy, the outputs in
+  // `ragged_output_indices_` are split with SplitRaggedOutput, and the others
+  // by rows.
   Status SplitOutputTensors(
       const std::vector<Tensor>& combined_outputs, BatchT* batch,
       std::vector<std::unique_ptr<BatchTask>>& unbatched_tasks) const;
@@ -348,6 +387,9 @@ class BatchResourceBase : public ResourceBase {
 
   SessionMetadata session_metadata_;
 
+  // Outputs split with SplitRaggedOutput; see set_ragged_output_indices.
+  absl::flat_hash_set<int32> ragged_output_indices_;
+
   absl::Mutex outstanding_batch_mu_;
   int num_outstanding_batched_items_ TF_GUARDED_BY(outstanding_batch_mu_) = 0;
 
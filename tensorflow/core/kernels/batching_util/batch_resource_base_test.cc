@@ -18,6 +18,7 @@ limitations under the License.
 #include <cstdint>
 #include <functional>
 #include <memory>
+#include <random>
 #include <string>
 #include <vector>
 
@@ -37,15 +38,20 @@ limitations under the License.
 #include "tensorflow/core/framework/op_kernel.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/framework/tensor_util.h"
 #include "tensorflow/core/framework/types.h"
 #include "tensorflow/core/framework/types.pb.h"
 #include "tensorflow/core/kernels/batching_util/batch_scheduler.h"
 #include "tensorflow/core/kernels/batching_util/batch_scheduler_utils.h"
 #include "tensorflow/core/kernels/batching_util/batch_stats.h"
+#include "tensorflow/core/kernels/batching_util/concat_split_util.h"
 #include "tensorflow/core/kernels/batching_util/shared_batch_scheduler.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
 #include "tensorflow/core/lib/monitoring/cell_reader.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/notification.h"
+#include "tensorflow/core/platform/test_benchmark.h"
 #include "tensorflow/core/public/session_options.h"
 #include "tensorflow/core/public/version.h"
 #include "tsl/platform/criticality.h"
@@ -444,6 +450,50 @@ class BatchResourceBaseTest : public ::testing::Test {
     mutable Notification process_func_batch_called_;
   };
 
+  // Records the inputs of the batched function and returns the values of its
+  // first ragged input as its only output.
+  class EchoBatchResource : public BatchResourceBase {
+   public:
+    using BatchResourceBase::BatchResourceBase;
+
+    std::string DebugString() const override { return ""; }
+
+    void ProcessFuncBatchImpl(
+        const BatchResourceBase::BatchTask& /* last_task */,
+        absl::Span<const Tensor> inputs, std::vector<Tensor>* combined_outputs,
+        std::function<void(const absl::Status&)> done) const override {
+      batch_inputs_.assign(inputs.begin(), inputs.end());
+      combined_outputs->push_back(inputs[0]);
+      done(absl::OkStatus());
+    }
+
+    const std::vector<Tensor>& batch_inputs() const { return batch_inputs_; }
+
+   private:
+    mutable std::vector<Tensor> batch_inputs_;
+  };
+
+  // Creates an EchoBatchResource with the RAGGED batch padding policy whose
+  // batch is full, and thus processed, once it holds three rows.
+  static EchoBatchResource* CreateRaggedEchoBatchResource(
+      std::shared_ptr<SharedBatchScheduler<BatchResourceBase::BatchTask>>
+          batcher) {
+    return new EchoBatchResource(
+        /* has_process_batch_function */ true, std::move(batcher),
+        BatchResourceBase::GetBatcherQueueOptions(
+            /*num_batch_threads=*/1, /*max_batch_size=*/3,
+            /*batch_timeout_micros=*/10'000'000, /*max_enqueued_batches=*/10,
+            /*allowed_batch_sizes=*/{},
+            /*enable_large_batch_splitting=*/false, /*disable_padding=*/false,
+            /*batch_padding_policy=*/kRaggedPolicy,
+            /*low_priority_max_batch_size=*/0,
+            /*low_priority_batch_timeout_micros=*/0,
+            /*low_priority_max_enqueued_batches=*/0,
+            /*low_priority_allowed_batch_sizes=*/{},
+            MixedPriorityBatchingPolicy::kLowPriorityPaddingWithMaxBatchSize),
+        /* allowed_batch_sizes */ {});
+  }
+
   BatchResourceBaseTest() {
     // The whole point of this test fixture is to create a usable batch function
     // context, context_.
@@ -622,6 +672,317 @@ TEST_F(BatchResourceBaseTest, ConfiguredBatchPaddingPolicyMetric) {
   my_batch_resource->Unref();
 }
 
+TEST(BatchResourceBaseRaggedTest, RaggedPolicyDisablesPadding) {
+  BatchResourceBase::BatcherT::QueueOptions options =
+      BatchResourceBase::GetBatcherQueueOptions(
+          /*num_batch_threads=*/1, /*max_batch_size=*/8,
+          /*batch_timeout_micros=*/100, /*max_enqueued_batches=*/10,
+          /*allowed_batch_sizes=*/{4, 8},
+          /*enable_large_batch_splitting=*/true, /*disable_padding=*/false,
+          /*batch_padding_policy=*/kRaggedPolicy,
+          /*low_priority_max_batch_size=*/0,
+          /*low_priority_batch_timeout_micros=*/0,
+          /*low_priority_max_enqueued_batches=*/0,
+          /*low_priority_allowed_batch_sizes=*/{},
+          MixedPriorityBatchingPolicy::kLowPriorityPaddingWithMaxBatchSize);
+
+  EXPECT_EQ(options.batch_padding_policy, kRaggedPolicy);
+  EXPECT_TRUE(options.disable_padding);
+}
+
+TEST_F(BatchResourceBaseTest, PackRaggedInput) {
+  std::vector<Tensor> inputs = {
+      test::AsTensor<int64_t>({0, 1, 2, 3, 4, 5}, TensorShape({2, 3})),
+      test::AsTensor<int64_t>({6}, TensorShape({1, 1})),
+      test::AsTensor<int64_t>({7, 8, 9, 10}, TensorShape({1, 4})),
+  };
+
+  Tensor values;
+  Tensor row_splits;
+  TF_ASSERT_OK(BatchResourceBase::PackRaggedInput(context_.get(), inputs,
+                                                  &values, &row_splits));
+
+  test::ExpectTensorEqual<int64_t>(
+      values, test::AsTensor<int64_t>({0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10}));
+  test::ExpectTensorEqual<int64_t>(row_splits,
+                                   test::AsTensor<int64_t>({0, 3, 6, 7, 11}));
+}
+
+TEST_F(BatchResourceBaseTest, PackRaggedInputKeepsInnerDimensions) {
+  std::vector<Tensor> inputs = {
+      test::AsTensor<int64_t>({0, 1, 2, 3}, TensorShape({1, 2, 2})),
+      test::AsTensor<int64_t>({4, 5}, TensorShape({1, 1, 2})),
+  };
+
+  Tensor values;
+  Tensor row_splits;
+  TF_ASSERT_OK(BatchResourceBase::PackRaggedInput(context_.get(), inputs,
+                                                  &values, &row_splits));
+
+  test::ExpectTensorEqual<int64_t>(
+      values, test::AsTensor<int64_t>({0, 1, 2, 3, 4, 5}, TensorShape({3, 2})));
+  test::ExpectTensorEqual<int64_t>(row_splits,
+                                   test::AsTensor<int64_t>({0, 2, 3}));
+}
+
+TEST_F(BatchResourceBaseTest, PackRaggedInputOfRankOne) {
+  std::vector<Tensor> inputs = {
+      test::AsTensor<int64_t>({0, 1}),
+      test::AsTensor<int64_t>({2}),
+  };
+
+  Tensor values;
+  Tensor row_splits;
+  TF_ASSERT_OK(BatchResourceBase::PackRaggedInput(context_.get(), inputs,
+                                                  &values, &row_splits));
+
+  test::ExpectTensorEqual<int64_t>(values, test::AsTensor<int64_t>({0, 1, 2}));
+  test::ExpectTensorEqual<int64_t>(row_splits,
+                                   test::AsTensor<int64_t>({0, 1, 2, 3}));
+}
+
+TEST_F(BatchResourceBaseTest, PackRaggedInputRejectsScalars) {
+  std::vector<Tensor> inputs = {test::AsScalar<int64_t>(0)};
+
+  Tensor values;
+  Tensor row_splits;
+  EXPECT_EQ(BatchResourceBase::PackRaggedInput(context_.get(), inputs,
+                                               &values, &row_splits)
+                .code(),
+            absl::StatusCode::kInvalidArgument);
+}
+
+TEST(BatchResourceBaseRaggedTest, SplitRaggedOutput) {
+  Tensor output = test::AsTensor<int64_t>({0, 1, 2, 3, 4, 5, 6, 7, 8, 9},
+                                          TensorShape({5, 2}));
+  std::vector<TensorShape> input_shapes = {TensorShape({2, 2}),
+                                           TensorShape({1, 1})};
+
+  std::vector<Tensor> outputs;
+  TF_ASSERT_OK(
+      BatchResourceBase::SplitRaggedOutput(output, input_shapes, &outputs));
+
+  ASSERT_EQ(outputs.size(), 2);
+  test::ExpectTensorEqual<int64_t>(
+      outputs[0], test::AsTensor<int64_t>({0, 1, 2, 3, 4, 5, 6, 7},
+                                          TensorShape({2, 2, 2})));
+  test::ExpectTensorEqual<int64_t>(
+      outputs[1], test::AsTensor<int64_t>({8, 9}, TensorShape({1, 1, 2})));
+}
+
+TEST(BatchResourceBaseRaggedTest, SplitRaggedOutputOfRankOneInputs) {
+  Tensor output = test::AsTensor<int64_t>({0, 1, 2});
+  std::vector<TensorShape> input_shapes = {TensorShape({2}),
+                                           TensorShape({1})};
+
+  std::vector<Tensor> outputs;
+  TF_ASSERT_OK(
+      BatchResourceBase::SplitRaggedOutput(output, input_shapes, &outputs));
+
+  ASSERT_EQ(outputs.size(), 2);
+  test::ExpectTensorEqual<int64_t>(outputs[0], test::AsTensor<int64_t>({0, 1}));
+  test::ExpectTensorEqual<int64_t>(outputs[1], test::AsTensor<int64_t>({2}));
+}
+
+TEST(BatchResourceBaseRaggedTest, SplitRaggedOutputRejectsWrongSize) {
+  Tensor output = test::AsTensor<int64_t>({0, 1, 2});
+  std::vector<TensorShape> input_shapes = {TensorShape({2, 2})};
+
+  std::vector<Tensor> outputs;
+  EXPECT_EQ(
+      BatchResourceBase::SplitRaggedOutput(output, input_shapes, &outputs)
+          .code(),
+      absl::StatusCode::kFailedPrecondition);
+}
+
+TEST_F(BatchResourceBaseTest, RaggedBatchPacksInputsAndSplitsOutputs) {
+  std::shared_ptr<SharedBatchScheduler<BatchResourceBase::BatchTask>> batcher;
+  TF_ASSERT_OK(
+      SharedBatchScheduler<BatchResourceBase::BatchTask>::Create({}, &batcher));
+  EchoBatchResource* resource = CreateRaggedEchoBatchResource(batcher);
+  resource->set_ragged_output_indices({0});
+
+  Tensor captured = test::AsScalar<int64_t>(0);
+  Tensor a0 = test::AsTensor<int64_t>({0, 1, 2, 3, 4, 5}, TensorShape({2, 3}));
+  Tensor a1 = test::AsTensor<int64_t>({10, 11}, TensorShape({2, 1}));
+  Tensor b0 = test::AsTensor<int64_t>({6}, TensorShape({1, 1}));
+  Tensor b1 = test::AsTensor<int64_t>({12}, TensorShape({1, 1}));
+  std::vector<TensorValue> a_inputs = {TensorValue(&a0), TensorValue(&a1),
+                                       TensorValue(&captured)};
+  std::vector<TensorValue> b_inputs = {TensorValue(&b0), TensorValue(&b1),
+                                       TensorValue(&captured)};
+  OpKernelContext::Params a_params = params_;
+  a_params.inputs = a_inputs;
+  OpKernelContext::Params b_params = params_;
+  b_params.inputs = b_inputs;
+  OpKernelContext a_context(&a_params);
+  OpKernelContext b_context(&b_params);
+
+  Notification a_done;
+  Notification b_done;
+  auto create_batch_task_fn =
+      []() -> absl::StatusOr<std::unique_ptr<BatchResourceBase::BatchTask>> {
+    return std::make_unique<BatchResourceBase::BatchTask>();
+  };
+  TF_ASSERT_OK(resource->RegisterInput(
+      /* guid= */ 0, &a_context, "batcher_queue_name", create_batch_task_fn,
+      [&a_done] { a_done.Notify(); }, /* forced_warmup_batch_size= */ 0));
+  TF_ASSERT_OK(resource->RegisterInput(
+      /* guid= */ 1, &b_context, "batcher_queue_name", create_batch_task_fn,
+      [&b_done] { b_done.Notify(); }, /* forced_warmup_batch_size= */ 0));
+  a_done.WaitForNotification();
+  b_done.WaitForNotification();
+
+  // Each input contributes its values and row splits, and the captured input
+  // comes last.
+  const std::vector<Tensor>& batch_inputs = resource->batch_inputs();
+  ASSERT_EQ(batch_inputs.size(), 5);
+  test::ExpectTensorEqual<int64_t>(
+      batch_inputs[0], test::AsTensor<int64_t>({0, 1, 2, 3, 4, 5, 6}));
+  test::ExpectTensorEqual<int64_t>(batch_inputs[1],
+                                   test::AsTensor<int64_t>({0, 3, 6, 7}));
+  test::ExpectTensorEqual<int64_t>(batch_inputs[2],
+                                   test::AsTensor<int64_t>({10, 11, 12}));
+  test::ExpectTensorEqual<int64_t>(batch_inputs[3],
+                                   test::AsTensor<int64_t>({0, 1, 2, 3}));
+  test::ExpectTensorEqual<int64_t>(batch_inputs[4], captured);
+
+  // The output is indexed by the values of the first input, so each task
+  // gets the values of its own rows back.
+  TF_ASSERT_OK(a_context.status());
+  TF_ASSERT_OK(b_context.status());
+  test::ExpectTensorEqual<int64_t>(*a_context.mutable_output(0), a0);
+  test::ExpectTensorEqual<int64_t>(*b_context.mutable_output(0), b0);
+
+  resource->Unref();
+}
+
+TEST_F(BatchResourceBaseTest, RaggedOutputKeepsRankWhenRowsHaveOneValue) {
+  std::shared_ptr<SharedBatchScheduler<BatchResourceBase::BatchTask>> batcher;
+  TF_ASSERT_OK(
+      SharedBatchScheduler<BatchResourceBase::BatchTask>::Create({}, &batcher));
+  EchoBatchResource* resource = CreateRaggedEchoBatchResource(batcher);
+  resource->set_ragged_output_indices({0});
+
+  // Every row has one value, so the number of values equals the number of
+  // rows, and only the declared indices tell the outputs apart.
+  Tensor captured = test::AsScalar<int64_t>(0);
+  Tensor a0 = test::AsTensor<int64_t>({0, 1}, TensorShape({2, 1}));
+  Tensor b0 = test::AsTensor<int64_t>({2}, TensorShape({1, 1}));
+  std::vector<TensorValue> a_inputs = {TensorValue(&a0), TensorValue(&a0),
+                                       TensorValue(&captured)};
+  std::vector<TensorValue> b_inputs = {TensorValue(&b0), TensorValue(&b0),
+                                       TensorValue(&captured)};
+  OpKernelContext::Params a_params = params_;
+  a_params.inputs = a_inputs;
+  OpKernelContext::Params b_params = params_;
+  b_params.inputs = b_inputs;
+  OpKernelContext a_context(&a_params);
+  OpKernelContext b_context(&b_params);
+
+  Notification a_done;
+  Notification b_done;
+  auto create_batch_task_fn =
+      []() -> absl::StatusOr<std::unique_ptr<BatchResourceBase::BatchTask>> {
+    return std::make_unique<BatchResourceBase::BatchTask>();
+  };
+  TF_ASSERT_OK(resource->RegisterInput(
+      /* guid= */ 0, &a_context, "batcher_queue_name", create_batch_task_fn,
+      [&a_done] { a_done.Notify(); }, /* forced_warmup_batch_size= */ 0));
+  TF_ASSERT_OK(resource->RegisterInput(
+      /* guid= */ 1, &b_context, "batcher_queue_name", create_batch_task_fn,
+      [&b_done] { b_done.Notify(); }, /* forced_warmup_batch_size= */ 0));
+  a_done.WaitForNotification();
+  b_done.WaitForNotification();
+
+  TF_ASSERT_OK(a_context.status());
+  TF_ASSERT_OK(b_context.status());
+  test::ExpectTensorEqual<int64_t>(*a_context.mutable_output(0), a0);
+  test::ExpectTensorEqual<int64_t>(*b_context.mutable_output(0), b0);
+
+  resource->Unref();
+}
+
+// Compares the cost of batching variable-length sequences with the PAD_UP
+// policy, where requests are padded to the maximum sequence length and the
+// batch to the next allowed batch size, with the RAGGED policy. Each iteration
+// batches the inputs and splits an output of the same shape back into the
+// requests. `padded_fraction` is the fraction of the processed elements, and
+// thus of the FLOPs of a batched function whose cost is linear in its input,
+// which are padding.
+void BM_RaggedBatching(::testing::benchmark::State& state) {
+  const bool ragged = state.range(0);
+  constexpr int kNumRequests = 13;
+  constexpr int kAllowedBatchSize = 16;
+  constexpr int kMaxLength = 128;
+  constexpr int kDepth = 64;
+
+  std::unique_ptr<Device> device = DeviceFactory::NewDevice(
+      "CPU", SessionOptions{}, "/job:a/replica:0/task:0");
+  NodeDef node_def;
+  TF_CHECK_OK(NodeDefBuilder("no_op", "NoOp").Finalize(&node_def));
+  absl::Status status;
+  std::unique_ptr<OpKernel> kernel =
+      CreateOpKernel(DEVICE_CPU, device.get(), device->GetAllocator({}),
+                     node_def, TF_GRAPH_DEF_VERSION, &status);
+  TF_CHECK_OK(status);
+  OpKernelContext::Params params;
+  params.device = device.get();
+  params.op_kernel = kernel.get();
+  OpKernelContext context(&params);
+
+  std::mt19937 rng(0);
+  std::uniform_int_distribution<int> length_distribution(1, kMaxLength);
+  std::vector<Tensor> inputs;
+  std::vector<TensorShape> input_shapes;
+  std::vector<int64_t> row_sizes;
+  int64_t num_elements = 0;
+  for (int i = 0; i < kNumRequests; ++i) {
+    const int length = length_distribution(rng);
+    num_elements += length * kDepth;
+    TensorShape shape({1, ragged ? length : kMaxLength, kDepth});
+    Tensor input(DT_FLOAT, shape);
+    input.flat<float>().setZero();
+    inputs.push_back(input);
+    input_shapes.push_back(shape);
+    row_sizes.push_back(1);
+  }
+  if (!ragged) {
+    for (int i = kNumRequests; i < kAllowedBatchSize; ++i) {
+      inputs.push_back(inputs[0]);
+    }
+    row_sizes.push_back(kAllowedBatchSize - kNumRequests);
+  }
+  const int64_t num_processed_elements =
+      ragged ? num_elements
+             : int64_t{kAllowedBatchSize} * kMaxLength * kDepth;
+
+  for (auto s : state) {
+    std::vector<Tensor> outputs;
+    if (ragged) {
+      Tensor values;
+      Tensor row_splits;
+      TF_CHECK_OK(BatchResourceBase::PackRaggedInput(&context, inputs, &values,
+                                                     &row_splits));
+      TF_CHECK_OK(
+          BatchResourceBase::SplitRaggedOutput(values, input_shapes, &outputs));
+    } else {
+      Tensor batched;
+      TF_CHECK_OK(concat_split_util::Concat(&context, inputs, &batched));
+      TF_CHECK_OK(tensor::Split(batched, row_sizes, &outputs));
+    }
+    ::benchmark::DoNotOptimize(outputs);
+  }
+
+  state.SetLabel(std::string(ragged ? kRaggedPolicy : kPadUpPolicy));
+  state.counters["processed_elements"] = num_processed_elements;
+  state.counters["padded_fraction"] =
+      1.0 - static_cast<double>(num_elements) / num_processed_elements;
+  state.SetItemsProcessed(state.iterations() * kNumRequests);
+}
+
+BENCHMARK(BM_RaggedBatching)->Arg(0)->Arg(1);
+
 }  // namespace
 }  // namespace serving
 }  // namespace tensorflow
@@ -16,9 +16,13 @@ limitations under the License.
 #include "tensorflow/core/kernels/batching_util/batch_scheduler_utils.h"
 
 #include <algorithm>
+#include <limits>
+#include <optional>
 #include <vector>
 
 #include "absl/algorithm/container.h"
+#include "absl/time/time.h"
+#include "tensorflow/core/kernels/batching_util/batch_stats.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/types.h"
 
@@ -67,5 +71,50 @@ int32 GetPrevAllowedBatchSize(int batch_size,
   return *result;
 }
 
+std::optional<int> GetLatencyOptimalBatchSize(
+    const std::vector<int32>& allowed_batch_sizes, int max_batch_size,
+    double arrival_rate_per_micro, ModelBatchStats& model_batch_stats) {
+  const std::vector<int32> candidates = allowed_batch_sizes.empty()
+                                            ? model_batch_stats.BatchSizes()
+                                            : allowed_batch_sizes;
+  const int64_t num_batch_threads =
+      std::max<int64_t>(model_batch_stats.num_batch_threads(), 1);
+
+  std::optional<int> best_size;
+  double best_latency_micros = std::numeric_limits<double>::infinity();
+  std::optional<int> fastest_size;
+  double fastest_throughput = 0;
+  for (int32 size : candidates) {
+    if (size <= 0 || size > max_batch_size) continue;
+    std::optional<absl::Duration> cost =
+        model_batch_stats.batch_size(size).tpu_cost().mean();
+    if (!cost.has_value()) continue;
+
+    const double cost_micros = absl::ToDoubleMicroseconds(*cost);
+    const double throughput = size * num_batch_threads / cost_micros;
+    if (throughput > fastest_throughput) {
+      fastest_throughput = throughput;
+      fastest_size = size;
+    }
+    if (throughput <= arrival_rate_per_micro) {
+      // Batches of this size would fall further and further behind.
+      continue;
+    }
+
+    double fill_micros = 0;
+    if (size > 1) {
+      fill_micros = arrival_rate_per_micro > 0
+                        ? (size - 1) / (2 * arrival_rate_per_micro)
+                        : std::numeric_limits<double>::infinity();
+    }
+    const double latency_micros = fill_micros + cost_micros;
+    if (!best_size.has_value() || latency_micros < best_latency_micros) {
+      best_latency_micros = latency_micros;
+      best_size = size;
+    }
+  }
+  return best_size.has_value() ? best_size : fastest_size;
+}
+
 }  // namespace serving
 }  // namespace tensorflow
@@ -56,11 +56,16 @@ int GetPrevAllowedBatchSize(int batch_size,
 //     to either PAD_UP or BATCH_DOWN so as to minimize the TPU costs per
 //     real request. In this case, it would compare (batch_16_cost / 16) and
 //     (batch_32_cost / 18).
+//   - RAGGED: schedule a batch of size 18 without padding. Batch resources
+//     pack each input into a ragged tensor, passed to the batched function as
+//     its flat values and row splits, instead of concatenating it. See
+//     BatchResourceBase::PackRaggedInput.
 //
 inline constexpr absl::string_view kBatchDownPolicy = "BATCH_DOWN";
 inline constexpr absl::string_view kPadUpPolicy = "PAD_UP";
 inline constexpr absl::string_view kMinimizeTpuCostPerRequestPolicy =
     "MINIMIZE_TPU_COST_PER_REQUEST";
+inline constexpr absl::string_view kRaggedPolicy = "RAGGED";
 
 // Trims the batch to the next allowed batch size when possible and when
 // configured by batch_padding_policy.
@@ -74,7 +79,8 @@ void MaybeBatchDown(Batch<TaskType>& batch,
                     absl::string_view batch_padding_policy,
                     ModelBatchStats* model_batch_stats,
                     std::vector<std::unique_ptr<TaskType>>& out_trimmed_tasks) {
-  if (batch_padding_policy == kPadUpPolicy) {
+  if (batch_padding_policy == kPadUpPolicy ||
+      batch_padding_policy == kRaggedPolicy) {
     // This is the default behavior of batch resource when it is given a batch
     // size that doesn't match any of the allowed batch sizes.
     return;
@@ -151,6 +157,40 @@ void MaybeBatchDown(Batch<TaskType>& batch,
   batch.TryTrimToNewSize(batch_down_size, out_trimmed_tasks);
 }
 
+// Constants containing possible values for the batch_formation_policy option
+// of SharedBatchScheduler queues. This option specifies when the scheduler
+// closes the open batch of a queue.
+//
+//   - TIMEOUT: close the batch when it is full, or when its oldest task has
+//     waited for batch_timeout_micros.
+//   - MINIMIZE_EXPECTED_LATENCY: also close the batch as soon as it reaches
+//     the size returned by GetLatencyOptimalBatchSize() for the current
+//     arrival rate of the queue. batch_timeout_micros still bounds the time
+//     a task waits for a batch to fill.
+//
+inline constexpr absl::string_view kTimeoutBatchFormationPolicy = "TIMEOUT";
+inline constexpr absl::string_view
+    kMinimizeExpectedLatencyBatchFormationPolicy = "MINIMIZE_EXPECTED_LATENCY";
+
+// Returns the batch size at which a batch should be closed to minimize the
+// expected latency of a request, given that requests arrive at
+// `arrival_rate_per_micro` (in batch size units per microsecond) and batches
+// cost what `model_batch_stats` has observed.
+//
+// The candidates are the allowed batch sizes, or, if there are none, the
+// batch sizes with observed costs, up to `max_batch_size`. The expected
+// latency of a batch size b with cost c(b) is (b - 1) / (2 * arrival_rate) +
+// c(b): the mean time a request waits for the batch to fill, plus the time to
+// process it. Only candidates whose throughput on
+// model_batch_stats.num_batch_threads() threads keeps up with the arrival
+// rate are considered; if there are none, returns the candidate with the
+// highest throughput.
+//
+// Returns std::nullopt if no candidate has an observed cost.
+std::optional<int> GetLatencyOptimalBatchSize(
+    const std::vector<int32>& allowed_batch_sizes, int max_batch_size,
+    double arrival_rate_per_micro, ModelBatchStats& model_batch_stats);
+
 }  // namespace serving
 }  // namespace tensorflow
 
@@ -17,6 +17,7 @@ limitations under the License.
 
 #include <cstddef>
 #include <memory>
+#include <optional>
 #include <vector>
 
 #include <gtest/gtest.h>
@@ -275,6 +276,93 @@ TEST(MaybeBatchDownTest, MinimizeTpuCostPerRequestDoesPadUpWhenNoModelStats) {
   EXPECT_EQ(batch.size(), 3);
 }
 
+// Registers batch costs of 1000us, 1100us, 1200us and 1400us for batch sizes
+// 1, 2, 4 and 8.
+void RegisterBatchCosts(ModelBatchStats& model_batch_stats) {
+  model_batch_stats.batch_size(1).tpu_cost().Register(absl::Microseconds(1000));
+  model_batch_stats.batch_size(2).tpu_cost().Register(absl::Microseconds(1100));
+  model_batch_stats.batch_size(4).tpu_cost().Register(absl::Microseconds(1200));
+  model_batch_stats.batch_size(8).tpu_cost().Register(absl::Microseconds(1400));
+}
+
+TEST(GetLatencyOptimalBatchSizeTest, LowArrivalRateDispatchesImmediately) {
+  ModelBatchStats model_batch_stats;
+  RegisterBatchCosts(model_batch_stats);
+
+  // Waiting for a second request would take 10ms on average.
+  EXPECT_EQ(GetLatencyOptimalBatchSize(
+                /* allowed_batch_sizes= */ {1, 2, 4, 8},
+                /* max_batch_size= */ 8,
+                /* arrival_rate_per_micro= */ 0.0001, model_batch_stats),
+            1);
+}
+
+TEST(GetLatencyOptimalBatchSizeTest, PicksSmallestSufficientThroughput) {
+  ModelBatchStats model_batch_stats;
+  RegisterBatchCosts(model_batch_stats);
+
+  // Batches of 1 can't keep up; batches of 2 can and fill faster than 4.
+  EXPECT_EQ(GetLatencyOptimalBatchSize(
+                /* allowed_batch_sizes= */ {1, 2, 4, 8},
+                /* max_batch_size= */ 8,
+                /* arrival_rate_per_micro= */ 0.0015, model_batch_stats),
+            2);
+  // Only batches of 8 can keep up.
+  EXPECT_EQ(GetLatencyOptimalBatchSize(
+                /* allowed_batch_sizes= */ {1, 2, 4, 8},
+                /* max_batch_size= */ 8,
+                /* arrival_rate_per_micro= */ 0.004, model_batch_stats),
+            8);
+}
+
+TEST(GetLatencyOptimalBatchSizeTest, AccountsForBatchThreads) {
+  ModelBatchStats model_batch_stats;
+  RegisterBatchCosts(model_batch_stats);
+  model_batch_stats.SetNumBatchThreads(4);
+
+  EXPECT_EQ(GetLatencyOptimalBatchSize(
+                /* allowed_batch_sizes= */ {1, 2, 4, 8},
+                /* max_batch_size= */ 8,
+                /* arrival_rate_per_micro= */ 0.004, model_batch_stats),
+            2);
+}
+
+TEST(GetLatencyOptimalBatchSizeTest, OverloadPicksHighestThroughput) {
+  ModelBatchStats model_batch_stats;
+  RegisterBatchCosts(model_batch_stats);
+
+  EXPECT_EQ(GetLatencyOptimalBatchSize(
+                /* allowed_batch_sizes= */ {1, 2, 4, 8},
+                /* max_batch_size= */ 8,
+                /* arrival_rate_per_micro= */ 0.01, model_batch_stats),
+            8);
+  EXPECT_EQ(GetLatencyOptimalBatchSize(
+                /* allowed_batch_sizes= */ {1, 2, 4, 8},
+                /* max_batch_size= */ 4,
+                /* arrival_rate_per_micro= */ 0.01, model_batch_stats),
+            4);
+}
+
+TEST(GetLatencyOptimalBatchSizeTest, UsesObservedSizesWithoutAllowedSizes) {
+  ModelBatchStats model_batch_stats;
+  RegisterBatchCosts(model_batch_stats);
+
+  EXPECT_EQ(GetLatencyOptimalBatchSize(
+                /* allowed_batch_sizes= */ {}, /* max_batch_size= */ 8,
+                /* arrival_rate_per_micro= */ 0.0015, model_batch_stats),
+            2);
+}
+
+TEST(GetLatencyOptimalBatchSizeTest, NoCosts) {
+  ModelBatchStats model_batch_stats;
+
+  EXPECT_EQ(GetLatencyOptimalBatchSize(
+                /* allowed_batch_sizes= */ {1, 2, 4, 8},
+                /* max_batch_size= */ 8,
+                /* arrival_rate_per_micro= */ 0.001, model_batch_stats),
+            std::nullopt);
+}
+
 }  // namespace
 
 }  // namespace serving
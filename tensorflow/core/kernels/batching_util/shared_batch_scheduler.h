@@ -249,6 +249,12 @@ class SharedBatchScheduler
     // requested.
     ModelBatchStats* model_batch_stats = nullptr;
 
+    // The policy that decides when to close the open batch.
+    //
+    // See the documentation for kTimeoutBatchFormationPolicy for details.
+    // Cost-based policies require `model_batch_stats`.
+    string batch_formation_policy = string(kTimeoutBatchFormationPolicy);
+
     // If true, queue implementation would split high priority and low priority
     // inputs into two sub queues.
     bool enable_priority_queue = false;
@@ -473,6 +479,12 @@ class Queue {
   // fresh open batch behind it.
   void StartNewBatch() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
 
+  // Records the arrival of a high priority task of size `task_size`, and
+  // periodically recomputes `latency_optimal_batch_size_` from the arrival
+  // rate. Only called with the MINIMIZE_EXPECTED_LATENCY batch formation
+  // policy.
+  void RecordArrival(size_t task_size) TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
   // Split `input task` into `output_tasks` according to 'task_sizes'.
   absl::Status SplitInputBatchIntoSubtasks(
       std::unique_ptr<TaskType>* input_task,
@@ -586,6 +598,22 @@ class Queue {
   // Used to keep track of when to call 'schedulable_batch_callback_'.
   bool schedulable_batch_ TF_GUARDED_BY(mu_) = false;
 
+  // Whether the MINIMIZE_EXPECTED_LATENCY batch formation policy is used.
+  const bool minimize_expected_latency_;
+
+  // Exponentially decaying averages of the time between the arrivals of high
+  // priority tasks and of their sizes, and the number and time of arrivals.
+  // Only maintained with the MINIMIZE_EXPECTED_LATENCY batch formation policy.
+  double mean_interarrival_micros_ TF_GUARDED_BY(mu_) = 0;
+  double mean_arrival_size_ TF_GUARDED_BY(mu_) = 0;
+  int64_t num_arrivals_ TF_GUARDED_BY(mu_) = 0;
+  uint64 last_arrival_micros_ TF_GUARDED_BY(mu_) = 0;
+
+  // The size at which the open batch becomes schedulable before its timeout,
+  // as computed by GetLatencyOptimalBatchSize(). Unset until enough tasks have
+  // arrived to estimate the arrival rate, or if the model has no batch costs.
+  std::optional<int> latency_optimal_batch_size_ TF_GUARDED_BY(mu_);
+
   // The number of batches currently being processed by batch threads.
   // Incremented in ScheduleBatch() and decremented in ProcessBatch().
   int num_batches_being_processed_ TF_GUARDED_BY(mu_) = 0;
@@ -711,6 +739,18 @@ absl::Status SharedBatchScheduler<TaskType>::AddQueueAfterRewritingOptions(
         options.max_enqueued_batches);
   }
 
+  if (options.batch_formation_policy ==
+      kMinimizeExpectedLatencyBatchFormationPolicy) {
+    if (options.model_batch_stats == nullptr) {
+      return errors::InvalidArgument(
+          "batch_formation_policy ", options.batch_formation_policy,
+          " requires model_batch_stats");
+    }
+  } else if (options.batch_formation_policy != kTimeoutBatchFormationPolicy) {
+    return errors::InvalidArgument("Unsupported batch_formation_policy: ",
+                                   options.batch_formation_policy);
+  }
+
   if (options.enable_large_batch_splitting &&
       options.split_input_task_func == nullptr) {
     return errors::InvalidArgument(
@@ -872,7 +912,11 @@ Queue<TaskType>::Queue(
       env_(env),
       max_execution_batch_size_(GetMaxExecutionBatchSize(options_)),
       process_batch_callback_(process_batch_callback),
-      schedulable_batch_callback_(schedulable_batch_callback) {
+      schedulable_batch_callback_(schedulable_batch_callback),
+      minimize_expected_latency_(
+          options.batch_formation_policy ==
+              kMinimizeExpectedLatencyBatchFormationPolicy &&
+          options.model_batch_stats != nullptr) {
   // Set the higher 32 bits of traceme_context_id_counter_ to be the creation
   // time of the queue. This prevents the batches in different queues to have
   // the same traceme_context_id_counter_.
@@ -1050,7 +1094,11 @@ absl::Status Queue<TaskType>::Schedule(std::unique_ptr<TaskType>* task) {
       TF_RETURN_IF_ERROR(ValidateLowPriorityTaskQueueCapacity(**task));
       low_priority_tasks_.AddTask(std::move(*task), env_->NowMicros());
     } else {
+      const size_t task_size = (*task)->size();
       TF_RETURN_IF_ERROR(ScheduleWithoutOrEagerSplitImpl(task));
+      if (minimize_expected_latency_) {
+        RecordArrival(task_size);
+      }
     }
 
     // Check if the batch queue has a schedulable batch and mark it schedulable
@@ -1369,6 +1417,38 @@ void Queue<TaskType>::StartNewBatch() {
   batches.emplace_back(new Batch<TaskType>(++traceme_context_id_counter_));
 }
 
+template <typename TaskType>
+void Queue<TaskType>::RecordArrival(size_t task_size) {
+  // The weight of the latest arrival in the averages.
+  constexpr double kArrivalWeight = 0.05;
+  // The number of arrivals between recomputations of the batch size, which
+  // look up the costs of all candidate batch sizes.
+  constexpr int64_t kArrivalsPerBatchSizeUpdate = 16;
+
+  const uint64 now_micros = env_->NowMicros();
+  if (num_arrivals_ == 0) {
+    mean_arrival_size_ = task_size;
+  } else {
+    const double interarrival_micros = now_micros - last_arrival_micros_;
+    mean_interarrival_micros_ =
+        num_arrivals_ == 1 ? interarrival_micros
+                           : (1 - kArrivalWeight) * mean_interarrival_micros_ +
+                                 kArrivalWeight * interarrival_micros;
+    mean_arrival_size_ = (1 - kArrivalWeight) * mean_arrival_size_ +
+                         kArrivalWeight * task_size;
+  }
+  last_arrival_micros_ = now_micros;
+  ++num_arrivals_;
+
+  if (num_arrivals_ % kArrivalsPerBatchSizeUpdate != 0) return;
+  // Arrivals within the same microsecond are indistinguishable.
+  const double arrival_rate_per_micro =
+      mean_arrival_size_ / std::max(mean_interarrival_micros_, 1.0);
+  latency_optimal_batch_size_ = GetLatencyOptimalBatchSize(
+      options_.allowed_batch_sizes, max_execution_batch_size(),
+      arrival_rate_per_micro, *options_.model_batch_stats);
+}
+
 template <typename TaskType>
 absl::Status Queue<TaskType>::SplitInputBatchIntoSubtasks(
     std::unique_ptr<TaskType>* input_task,
@@ -1444,6 +1524,10 @@ Queue<TaskType>::PeekBatchPriorityImpl() const {
                      effective_batch_size >= max_execution_batch_size() ||
                      env_->NowMicros() >= effective_start_time_micros +
                                               effective_batch_timeout_micros;
+  if (!schedulable && latency_optimal_batch_size_.has_value()) {
+    // Waiting for more tasks would increase the expected latency.
+    schedulable = effective_batch_size >= *latency_optimal_batch_size_;
+  }
 
   if (!schedulable) {
     return std::nullopt;
@@ -15,8 +15,11 @@ limitations under the License.
 
 #include "tensorflow/core/kernels/batching_util/shared_batch_scheduler.h"
 
+#include <algorithm>
 #include <cstddef>
+#include <cstdint>
 #include <memory>
+#include <random>
 #include <string>
 #include <thread>  // NOLINT(build/c++11)
 #include <tuple>
@@ -31,6 +34,7 @@ limitations under the License.
 #include "xla/tsl/lib/core/status_test_util.h"
 #include "tensorflow/core/kernels/batching_util/batch_scheduler.h"
 #include "tensorflow/core/kernels/batching_util/batch_scheduler_utils.h"
+#include "tensorflow/core/kernels/batching_util/batch_stats.h"
 #include "tensorflow/core/kernels/batching_util/fake_clock_env.h"
 #include "tensorflow/core/kernels/batching_util/input_split_metadata.h"
 #include "tensorflow/core/lib/core/notification.h"
@@ -1094,6 +1098,103 @@ TEST_P(SharedBatchSchedulerTest, BatchPaddingPolicyBatchDown) {
   stop_teardown.Notify();
 }
 
+TEST_P(SharedBatchSchedulerTest, BatchFormationPolicyMinimizeExpectedLatency) {
+  // Set up a fake clock, which only advances when we explicitly tell it to.
+  test_util::FakeClockEnv env(Env::Default());
+  Notification start_teardown, stop_teardown;
+  std::unique_ptr<Thread> teardown_thread =
+      CreateFakeClockAdvancerThread(&env, &start_teardown, &stop_teardown);
+
+  {
+    mutex mu;
+    std::vector<size_t> batch_sizes;
+    Notification third_batch_processed;
+    auto callback = [&](std::unique_ptr<Batch<FakeTask>> batch) {
+      mutex_lock l(mu);
+      batch_sizes.push_back(batch->size());
+      if (batch_sizes.size() == 3) {
+        third_batch_processed.Notify();
+      }
+    };
+
+    auto scheduler = CreateSharedBatchScheduler(1, &env);
+
+    ModelBatchStats model_batch_stats;
+    model_batch_stats.batch_size(1).tpu_cost().Register(
+        absl::Microseconds(1000));
+    model_batch_stats.batch_size(2).tpu_cost().Register(
+        absl::Microseconds(1100));
+    model_batch_stats.batch_size(4).tpu_cost().Register(
+        absl::Microseconds(1200));
+    model_batch_stats.batch_size(8).tpu_cost().Register(
+        absl::Microseconds(1400));
+
+    QueueOptions options =
+        CreateQueueOptions(/* max_execution_batch_size= */ 8,
+                           /* input_batch_size_limit= */ 8,
+                           /* batch_timeout_micros= */ 1000 * 1000,
+                           /* max_enqueued_batches= */ 10);
+    options.allowed_batch_sizes = {1, 2, 4, 8};
+    options.model_batch_stats = &model_batch_stats;
+    // The most interesting option for this test.
+    options.batch_formation_policy =
+        string(kMinimizeExpectedLatencyBatchFormationPolicy);
+
+    auto queue = CreateQueue(scheduler, options, callback);
+
+    // Tasks arrive every 500us. The first 16 fill two batches and establish
+    // the arrival rate, at which batches of 1 and 2 can't keep up and batches
+    // of 4 have the lowest expected latency.
+    for (int i = 0; i < 16; ++i) {
+      env.AdvanceByMicroseconds(500);
+      TF_ASSERT_OK(ScheduleTask(1, queue.get()));
+    }
+    for (int i = 0; i < 3; ++i) {
+      env.AdvanceByMicroseconds(500);
+      TF_ASSERT_OK(ScheduleTask(1, queue.get()));
+    }
+    EXPECT_FALSE(third_batch_processed.WaitForNotificationWithTimeout(
+        absl::Milliseconds(10)));
+
+    // The fourth task makes the batch schedulable long before its timeout.
+    TF_ASSERT_OK(ScheduleTask(1, queue.get()));
+    third_batch_processed.WaitForNotification();
+    {
+      mutex_lock l(mu);
+      EXPECT_EQ(batch_sizes, std::vector<size_t>({8, 8, 4}));
+    }
+
+    start_teardown.Notify();
+  }
+  stop_teardown.Notify();
+}
+
+TEST_P(SharedBatchSchedulerTest, InvalidBatchFormationPolicy) {
+  auto callback = [](std::unique_ptr<Batch<FakeTask>> batch) {
+    // do nothing.
+  };
+  auto scheduler = CreateSharedBatchScheduler(1);
+  std::unique_ptr<Queue> queue;
+
+  QueueOptions options =
+      CreateQueueOptions(/* max_execution_batch_size= */ 8,
+                         /* input_batch_size_limit= */ 8,
+                         /* batch_timeout_micros= */ 100,
+                         /* max_enqueued_batches= */ 10);
+  options.batch_formation_policy = "UNKNOWN";
+  EXPECT_THAT(
+      scheduler->AddQueue(options, callback, &queue),
+      testing::StatusIs(error::INVALID_ARGUMENT,
+                        HasSubstr("Unsupported batch_formation_policy")));
+
+  // The cost model needs batch costs.
+  options.batch_formation_policy =
+      string(kMinimizeExpectedLatencyBatchFormationPolicy);
+  EXPECT_THAT(scheduler->AddQueue(options, callback, &queue),
+              testing::StatusIs(error::INVALID_ARGUMENT,
+                                HasSubstr("requires model_batch_stats")));
+}
+
 // TODO(b/161857471):
 // Add test coverage when input-split and no-split returns differently.
 INSTANTIATE_TEST_SUITE_P(Parameter, SharedBatchSchedulerTest,
@@ -2463,6 +2564,132 @@ BENCHMARK(BM_QueueSchedule)->Apply([](benchmark::internal::Benchmark* b) {
 
 #endif  // PLATFORM_GOOGLE
 
+// A task of size 1 which remembers when it arrived.
+class TimedTask : public BatchTask {
+ public:
+  explicit TimedTask(uint64 arrival_micros) : arrival_micros_(arrival_micros) {}
+
+  size_t size() const override { return 1; }
+
+  uint64 arrival_micros() const { return arrival_micros_; }
+
+ private:
+  const uint64 arrival_micros_;
+};
+
+// The simulated cost of a batch: 2ms plus 50us per (padded) task.
+int64_t SimulatedBatchCostMicros(int batch_size) {
+  return 2000 + 50 * batch_size;
+}
+
+// Simulates a queue served by two batch threads, to which requests arrive as
+// a Poisson process at `state.range(1)` requests per second, and reports the
+// latency percentiles and throughput of the batch formation policy selected
+// by `state.range(0)`: the timeout policy (0) or the cost model (1).
+//
+// The simulation runs on a fake clock which advances in 10us ticks. Instead
+// of running batch threads, each tick hands schedulable batches to the
+// simulated threads that are idle, which are then busy for the cost of the
+// batch. The benchmark's own time is the time taken by the simulation.
+void BM_BatchFormationPolicy(::testing::benchmark::State& state) {
+  const bool minimize_expected_latency = state.range(0);
+  const double requests_per_second = state.range(1);
+  constexpr int kNumBatchThreads = 2;
+  constexpr int kNumRequests = 10000;
+  constexpr int kTickMicros = 10;
+  const std::vector<int32> allowed_batch_sizes = {1, 2, 4, 8, 16, 32, 64};
+
+  ModelBatchStats model_batch_stats;
+  model_batch_stats.SetNumBatchThreads(kNumBatchThreads);
+  for (int32 batch_size : allowed_batch_sizes) {
+    model_batch_stats.batch_size(batch_size).tpu_cost().Register(
+        absl::Microseconds(SimulatedBatchCostMicros(batch_size)));
+  }
+
+  SharedBatchScheduler<TimedTask>::QueueOptions options;
+  options.input_batch_size_limit = 64;
+  options.batch_timeout_micros = 5000;
+  options.max_enqueued_batches = kNumRequests;
+  options.allowed_batch_sizes = allowed_batch_sizes;
+  options.model_batch_stats = &model_batch_stats;
+  options.batch_formation_policy =
+      string(minimize_expected_latency
+                 ? kMinimizeExpectedLatencyBatchFormationPolicy
+                 : kTimeoutBatchFormationPolicy);
+
+  std::vector<uint64> latencies;
+  int64_t num_batches = 0;
+  uint64 simulated_micros = 0;
+  for (auto s : state) {
+    test_util::FakeClockEnv env(Env::Default());
+    latencies.clear();
+    num_batches = 0;
+
+    // The time at which the last processed batch completes.
+    uint64 batch_done_micros = 0;
+    internal::Queue<TimedTask> queue(
+        options, &env,
+        [&](std::unique_ptr<Batch<TimedTask>> batch) {
+          const int padded_size = GetNextAllowedBatchSize(
+              batch->size(), allowed_batch_sizes, /*disable_padding=*/false);
+          batch_done_micros =
+              env.NowMicros() + SimulatedBatchCostMicros(padded_size);
+          for (int i = 0; i < batch->num_tasks(); ++i) {
+            latencies.push_back(batch_done_micros -
+                                batch->task(i).arrival_micros());
+          }
+          ++num_batches;
+        },
+        [] {});
+
+    std::mt19937_64 rng(/*seed=*/42);
+    std::exponential_distribution<double> interarrival_micros(
+        requests_per_second / 1e6);
+    double next_arrival_micros = interarrival_micros(rng);
+    std::vector<uint64> thread_busy_until(kNumBatchThreads, 0);
+    int num_arrivals = 0;
+    while (num_arrivals < kNumRequests || !queue.IsEmpty()) {
+      const uint64 now_micros = env.NowMicros();
+      while (num_arrivals < kNumRequests &&
+             next_arrival_micros <= now_micros) {
+        auto task = std::make_unique<TimedTask>(now_micros);
+        TF_CHECK_OK(queue.Schedule(&task));
+        ++num_arrivals;
+        next_arrival_micros += interarrival_micros(rng);
+      }
+      for (uint64& busy_until : thread_busy_until) {
+        if (busy_until > now_micros) continue;
+        auto batch = queue.ScheduleBatch();
+        if (batch == nullptr) break;
+        queue.ProcessBatch(std::move(batch), {});
+        busy_until = batch_done_micros;
+      }
+      env.AdvanceByMicroseconds(kTickMicros);
+    }
+    simulated_micros = *std::max_element(thread_busy_until.begin(),
+                                         thread_busy_until.end());
+  }
+
+  std::sort(latencies.begin(), latencies.end());
+  state.SetLabel(std::string(minimize_expected_latency
+                                 ? kMinimizeExpectedLatencyBatchFormationPolicy
+                                 : kTimeoutBatchFormationPolicy));
+  state.counters["p50_latency_us"] = latencies[latencies.size() / 2];
+  state.counters["p99_latency_us"] = latencies[latencies.size() * 99 / 100];
+  state.counters["throughput_rps"] = kNumRequests * 1e6 / simulated_micros;
+  state.counters["mean_batch_size"] =
+      static_cast<double>(kNumRequests) / num_batches;
+}
+BENCHMARK(BM_BatchFormationPolicy)
+    ->ArgPair(0, 200)
+    ->ArgPair(1, 200)
+    ->ArgPair(0, 1000)
+    ->ArgPair(1, 1000)
+    ->ArgPair(0, 5000)
+    ->ArgPair(1, 5000)
+    ->ArgPair(0, 20000)
+    ->ArgPair(1, 20000);
+
 }  // namespace
 }  // namespace serving
 }  // namespace tensorflow
@@ -248,7 +248,8 @@ class BatchDatasetOp::Dataset : public DatasetBase {
       // could potentially read the input values in-place into their
       // respective slice locations. This would require a different GetNext()
       // overload that supports zero-copy, and might make sense in an
-      // optimization pass.
+      // optimization pass. Today `CopyBatch` only avoids the copy when the
+      // elements are already adjacent slices of one buffer.
       TF_RETURN_IF_ERROR(CopyBatch(AnyContext(ctx), std::move(batch_elements),
                                    dataset()->parallel_copy_, out_tensors));
 
@@ -11,11 +11,19 @@ limitations under the License.
 ==============================================================================*/
 #include "tensorflow/core/kernels/data/batch_dataset_op.h"
 
+#include <memory>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "tensorflow/core/common_runtime/type_inference.h"
 #include "tensorflow/core/data/dataset_test_base.h"
+#include "tensorflow/core/data/dataset_utils.h"
+#include "tensorflow/core/data/test_utils.h"
+#include "tensorflow/core/framework/function_testlib.h"
+#include "tensorflow/core/framework/tensor_util.h"
 #include "tensorflow/core/graph/node_builder.h"
+#include "tensorflow/core/platform/test_benchmark.h"
 #include "tensorflow/core/public/session_options.h"
 
 namespace tensorflow {
@@ -383,6 +391,145 @@ TEST(BatchDatsetOpTest, TypeInference) {
       << input_dataset_t.DebugString();
 }
 
+// Compares assembling a batch from independently allocated elements, which
+// requires a gather-copy, with assembling it from adjacent slices of one
+// buffer, which is a pointer handoff. The first argument is the element size
+// in bytes, the second is whether the elements are contiguous slices.
+void BM_CopyBatch(::testing::benchmark::State& state) {
+  constexpr int64_t kBatchSize = 32;
+  const int64_t element_bytes = state.range(0);
+  const bool contiguous = state.range(1);
+  const int64_t num_values = element_bytes / sizeof(float);
+
+  std::unique_ptr<TestContext> ctx = TestContext::Create().value();
+  Tensor parent(DT_FLOAT, TensorShape({kBatchSize, num_values}));
+  parent.flat<float>().setConstant(1.0f);
+  std::vector<Tensor> elements;
+  for (int64_t i = 0; i < kBatchSize; ++i) {
+    elements.push_back(contiguous ? MaybeCopySubSlice(parent, i)
+                                  : tensor::DeepCopy(parent.SubSlice(i)));
+  }
+
+  int64_t bytes_copied = 0;
+  for (auto s : state) {
+    std::vector<std::vector<Tensor>> batch_elements;
+    batch_elements.reserve(kBatchSize);
+    for (const Tensor& element : elements) {
+      batch_elements.push_back({element});
+    }
+    std::vector<Tensor> batch;
+    TF_CHECK_OK(CopyBatch(AnyContext(ctx->iter_ctx()),
+                          std::move(batch_elements),
+                          /*parallel_copy=*/false, &batch));
+    if (!batch[0].SharesBufferWith(elements[0])) {
+      bytes_copied += batch[0].TotalBytes();
+    }
+  }
+  state.SetBytesProcessed(state.iterations() * kBatchSize * element_bytes);
+  state.counters["bytes_copied_per_batch"] =
+      static_cast<double>(bytes_copied) / state.iterations();
+}
+
+BENCHMARK(BM_CopyBatch)
+    ->ArgPair(1 << 10, false)
+    ->ArgPair(1 << 10, true)
+    ->ArgPair(64 << 10, false)
+    ->ArgPair(64 << 10, true)
+    ->ArgPair(1 << 20, false)
+    ->ArgPair(1 << 20, true)
+    ->ArgPair(4 << 20, false)
+    ->ArgPair(4 << 20, true);
+
+// Runs `from_tensor_slices(x)[.map(lambda y: y * 2)].batch(32)`, so that the
+// batch transformation sees elements as a real pipeline produces them.
+class BatchPipelineBenchmark : public DatasetOpsTestBase {
+ public:
+  void TestBody() override {}
+
+  absl::Status Init(const DatasetParams& dataset_params) {
+    return Initialize(dataset_params);
+  }
+
+  absl::Status Reset(const DatasetParams& dataset_params) {
+    return dataset_->MakeIterator(iterator_ctx_.get(), /*parent=*/nullptr,
+                                  dataset_params.iterator_prefix(),
+                                  &iterator_);
+  }
+
+  absl::Status GetNextBatch(std::vector<Tensor>* batch) {
+    bool end_of_sequence = false;
+    return iterator_->GetNext(iterator_ctx_.get(), batch, &end_of_sequence);
+  }
+};
+
+// Compares batching the slices of a tensor, which `CopyBatch` hands off, with
+// batching the outputs of a map function over those slices. The batch
+// transformation receives map outputs only after the function runtime has
+// allocated them, so they take the gather-copy path; only the fused
+// MapAndBatch transformation can have the function write them into the batch.
+// The first argument is the element size in bytes, the second is whether the
+// elements go through a map.
+void BM_BatchPipeline(::testing::benchmark::State& state) {
+  constexpr int64_t kBatchSize = 32;
+  const int64_t element_bytes = state.range(0);
+  const bool with_map = state.range(1);
+  const int64_t num_values = element_bytes / sizeof(float);
+
+  Tensor components(DT_FLOAT, TensorShape({kBatchSize, num_values}));
+  components.flat<float>().setConstant(1.0f);
+  auto slices = TensorSliceDatasetParams({components}, "tensor_slice");
+  auto map = MapDatasetParams(
+      slices, /*other_arguments=*/{},
+      /*func=*/FunctionDefHelper::FunctionRef("XTimesTwo", {{"T", DT_FLOAT}}),
+      /*func_lib=*/{test::function::XTimesTwo()},
+      /*type_arguments=*/{}, /*output_dtypes=*/{DT_FLOAT},
+      /*output_shapes=*/{PartialTensorShape({num_values})},
+      /*use_inter_op_parallelism=*/true, /*preserve_cardinality=*/true,
+      /*node_name=*/"map");
+  const DataTypeVector output_dtypes = {DT_FLOAT};
+  const std::vector<PartialTensorShape> output_shapes = {
+      PartialTensorShape({kBatchSize, num_values})};
+  std::unique_ptr<DatasetParams> batch;
+  if (with_map) {
+    batch = std::make_unique<BatchDatasetParams>(
+        map, kBatchSize, /*drop_remainder=*/true, /*parallel_copy=*/false,
+        output_dtypes, output_shapes, "batch");
+  } else {
+    batch = std::make_unique<BatchDatasetParams>(
+        slices, kBatchSize, /*drop_remainder=*/true, /*parallel_copy=*/false,
+        output_dtypes, output_shapes, "batch");
+  }
+
+  BatchPipelineBenchmark pipeline;
+  TF_CHECK_OK(pipeline.Init(*batch));
+  int64_t bytes_copied = 0;
+  bool first_iteration = true;
+  for (auto s : state) {
+    if (!first_iteration) {
+      state.PauseTiming();
+      TF_CHECK_OK(pipeline.Reset(*batch));
+      state.ResumeTiming();
+    }
+    first_iteration = false;
+    std::vector<Tensor> outputs;
+    TF_CHECK_OK(pipeline.GetNextBatch(&outputs));
+    if (!outputs[0].SharesBufferWith(components)) {
+      bytes_copied += outputs[0].TotalBytes();
+    }
+  }
+  state.SetBytesProcessed(state.iterations() * kBatchSize * element_bytes);
+  state.counters["bytes_copied_per_batch"] =
+      static_cast<double>(bytes_copied) / state.iterations();
+}
+
+BENCHMARK(BM_BatchPipeline)
+    ->ArgPair(1 << 10, false)
+    ->ArgPair(1 << 10, true)
+    ->ArgPair(64 << 10, false)
+    ->ArgPair(64 << 10, true)
+    ->ArgPair(1 << 20, false)
+    ->ArgPair(1 << 20, true);
+
 }  // namespace
 }  // namespace data
 }  // namespace tensorflow
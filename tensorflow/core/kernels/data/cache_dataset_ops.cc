@@ -18,12 +18,19 @@ limitations under the License.
 #include <cstddef>
 #include <cstdint>
 #include <memory>
+#include <optional>
 #include <string>
 #include <utility>
 #include <vector>
 
 #include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/match.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_split.h"
 #include "tensorflow/core/data/global_shuffle_utils.h"
+#include "tensorflow/core/data/hash_utils.h"
 #include "tensorflow/core/data/name_utils.h"
 #include "tensorflow/core/data/serialization_utils.h"
 #include "tensorflow/core/framework/dataset.h"
@@ -31,12 +38,17 @@ limitations under the License.
 #include "tensorflow/core/framework/partial_tensor_shape.h"
 #include "tensorflow/core/framework/resource_mgr.h"
 #include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor.pb.h"
+#include "tensorflow/core/framework/variant_tensor_data.h"
 #include "tensorflow/core/kernels/data/cache_ops.h"
 #include "tensorflow/core/kernels/data/iterator_ops.h"
 #include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/io/path.h"
 #include "tensorflow/core/lib/strings/stringprintf.h"
 #include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/host_info.h"
+#include "tensorflow/core/platform/random.h"
 #include "tensorflow/core/platform/refcount.h"
 #include "tensorflow/core/util/tensor_bundle/naming.h"
 #include "tensorflow/core/util/tensor_bundle/tensor_bundle.h"
@@ -60,16 +72,30 @@ constexpr char kPaddingSizeStrFormat[] = "%zu";
 constexpr char kFileDatasetPrefix[] = "File";
 constexpr char kMode[] = "Mode";
 constexpr char kLockFileSuffix[] = ".lockfile";
+constexpr char kLeaseSuffix[] = ".lease";
+constexpr char kLeaseOwner[] = "owner";
+constexpr char kCommittedSuffix[] = ".committed";
+constexpr char kInputStateSuffix[] = ".input_state";
+constexpr char kContentAddressedCacheName[] = "cache";
 constexpr char kIterationCompleted[] = "iteration_completed";
 constexpr char kCurIndex[] = "cur_index";
+constexpr char kInputIndex[] = "input_index";
 constexpr char kShardId[] = "shard_id";
 constexpr char kCreatedAt[] = "Created at";
+constexpr char kLeaseRenewals[] = "Renewals";
 constexpr char kMemoryDatasetPrefix[] = "Memory";
 constexpr char kMemoryCache[] = "MemoryCache";
 constexpr char kCacheCompleted[] = "cache_completed";
 constexpr char kIndex[] = "index";
 constexpr char kImpl[] = "Impl";
 constexpr char kCacheDataset[] = "CacheDataset";
+// A shared cache is written in ranges of this many elements. Jobs claim and
+// commit whole ranges, so this bounds the work redone after preemption.
+constexpr int64_t kSharedCacheShardElements = 1024;
+// A shared cache writer renews its lease at least this often ...
+constexpr int64_t kSharedCacheLeaseRenewalSeconds = 30;
+// ... and other jobs take over a lease that has not been renewed for this long.
+constexpr int64_t kSharedCacheLeaseTimeoutSeconds = 300;
 constexpr char kIncompleteCacheErrorMessage[] =
     "The calling iterator did not fully read the dataset being cached. In "
     "order to avoid unexpected truncation of the dataset, the partially cached "
@@ -235,21 +261,49 @@ class CacheDatasetOp::FileDatasetBase : public DatasetBase {
                            tensor_index);
   }
 
+  // Returns the cache prefix used when the cache is content addressed:
+  // <filename>/<fingerprint of the input graph>/cache.
+  absl::StatusOr<std::string> ContentAddressedPrefix() const {
+    SerializationContext::Params params;
+    params.external_state_policy = ExternalStatePolicy::POLICY_IGNORE;
+    GraphDef graph_def;
+    TF_RETURN_IF_ERROR(
+        AsGraphDef(input_, SerializationContext(params), &graph_def));
+    uint64 hash;
+    TF_RETURN_IF_ERROR(HashGraph(graph_def, &hash));
+    return io::JoinPath(
+        filename_, strings::StrCat(strings::Hex(hash, strings::kZeroPad16)),
+        kContentAddressedCacheName);
+  }
+
   class FileIterator : public DatasetIterator<FileDatasetBase> {
    public:
     explicit FileIterator(const Params& params)
-        : DatasetIterator<FileDatasetBase>(params) {
-      if (params.dataset->env_
-              ->FileExists(MetaFilename(params.dataset->filename_))
-              .ok()) {
-        mode_ = Mode::read;
-      } else {
-        mode_ = Mode::write;
-      }
-    }
+        : DatasetIterator<FileDatasetBase>(params),
+          cache_prefix_(params.dataset->filename_) {}
 
     absl::Status Initialize(IteratorContext* ctx) override {
       mutex_lock l(mu_);
+      bool content_addressed =
+          ctx->options() != nullptr &&
+          ctx->options()->cache_options().content_addressed();
+      if (content_addressed && !InputIsDeterministic(*ctx->options())) {
+        // Jobs share the ranges of a content-addressed cache, which is only
+        // consistent if every job produces the same elements in the same
+        // order.
+        LOG(WARNING) << "The input of the cache is not deterministic, so it "
+                     << "is cached at " << cache_prefix_ << " and not shared "
+                     << "with other jobs.";
+        content_addressed = false;
+      }
+      if (content_addressed) {
+        TF_ASSIGN_OR_RETURN(cache_prefix_, dataset()->ContentAddressedPrefix());
+      }
+      if (dataset()->env_->FileExists(MetaFilename(cache_prefix_)).ok()) {
+        mode_ = Mode::read;
+      } else {
+        mode_ = content_addressed ? Mode::shared_write : Mode::write;
+      }
       return InitializeIterator(ctx);
     }
 
@@ -281,15 +335,13 @@ class CacheDatasetOp::FileDatasetBase : public DatasetBase {
         TF_RETURN_IF_ERROR(reader->ReadScalar(prefix(), kMode, &temp));
         mode_ = static_cast<Mode>(temp);
       }
-      if (mode_ == Mode::write &&
-          dataset()
-              ->env_->FileExists(MetaFilename(dataset()->filename_))
-              .ok()) {
+      if (mode_ != Mode::read &&
+          dataset()->env_->FileExists(MetaFilename(cache_prefix_)).ok()) {
         // This could happen if the cache was completely written after the
         // checkpoint was saved.
         LOG(WARNING)
             << "It looks like the cache was already completely written("
-            << MetaFilename(dataset()->filename_)
+            << MetaFilename(cache_prefix_)
             << ") after the last checkpoint was saved. Attempting to read "
             << "the cache instead of continuing to write. If this is a "
             << "mistake, please remove the above file and try running again.";
@@ -300,6 +352,16 @@ class CacheDatasetOp::FileDatasetBase : public DatasetBase {
     }
 
    private:
+    // Returns whether the input produces the same elements in the same order
+    // in every job, as far as can be told from `options` and its ops.
+    bool InputIsDeterministic(const Options& options) const {
+      if (options.optional_deterministic_case() == Options::kDeterministic &&
+          !options.deterministic()) {
+        return false;
+      }
+      return dataset()->input_->CheckExternalState().ok();
+    }
+
     // FileWriterIterator passes through and caches items from the input
     // FileDatasetBase.
     //
@@ -318,12 +380,12 @@ class CacheDatasetOp::FileDatasetBase : public DatasetBase {
     // When all elements have been produced, these shards get coalesced.
     class FileWriterIterator : public DatasetIterator<FileDatasetBase> {
      public:
-      explicit FileWriterIterator(const Params& params)
+      FileWriterIterator(const Params& params, std::string cache_prefix)
           : DatasetIterator<FileDatasetBase>(params),
             cur_index_(0),
             shard_id_(0),
-            filename_(
-                strings::StrCat(params.dataset->filename_, "_", shard_id_)),
+            cache_prefix_(std::move(cache_prefix)),
+            filename_(strings::StrCat(cache_prefix_, "_", shard_id_)),
             lockfile_(strings::StrCat(filename_, kLockFileSuffix)),
             lockfile_created_(false),
             iteration_completed_(false) {}
@@ -434,7 +496,7 @@ class CacheDatasetOp::FileDatasetBase : public DatasetBase {
 
           // Start caching to a new shard.
           shard_id_++;
-          filename_ = strings::StrCat(dataset()->filename_, "_", shard_id_);
+          filename_ = strings::StrCat(cache_prefix_, "_", shard_id_);
           lockfile_ = strings::StrCat(filename_, kLockFileSuffix);
           lockfile_created_ = false;
         }
@@ -473,7 +535,7 @@ class CacheDatasetOp::FileDatasetBase : public DatasetBase {
             return errors::Internal("Invalid value for shard_id ", temp);
           }
         }
-        filename_ = strings::StrCat(dataset()->filename_, "_", shard_id_);
+        filename_ = strings::StrCat(cache_prefix_, "_", shard_id_);
         lockfile_ = strings::StrCat(filename_, kLockFileSuffix);
         writer_ = std::make_unique<BundleWriter>(dataset()->env_, filename_);
         return absl::OkStatus();
@@ -557,16 +619,15 @@ class CacheDatasetOp::FileDatasetBase : public DatasetBase {
           std::vector<tstring> prefixes;
           prefixes.reserve(shard_id_ + 1);
           for (size_t i = 0; i <= shard_id_; ++i) {
-            prefixes.emplace_back(
-                strings::StrCat(dataset()->filename_, "_", i));
+            prefixes.emplace_back(strings::StrCat(cache_prefix_, "_", i));
           }
           TF_RETURN_IF_ERROR(
-              MergeBundles(dataset()->env_, prefixes, dataset()->filename_));
+              MergeBundles(dataset()->env_, prefixes, cache_prefix_));
         }
         // Delete all lockfiles.
         for (size_t i = 0; i <= shard_id_; ++i) {
           TF_RETURN_IF_ERROR(dataset()->env_->DeleteFile(
-              strings::StrCat(dataset()->filename_, "_", i, kLockFileSuffix)));
+              strings::StrCat(cache_prefix_, "_", i, kLockFileSuffix)));
         }
         return absl::OkStatus();
       }
@@ -577,8 +638,10 @@ class CacheDatasetOp::FileDatasetBase : public DatasetBase {
       // cache shard is saved.
       size_t shard_id_ TF_GUARDED_BY(mu_);
       std::unique_ptr<IteratorBase> input_impl_ TF_GUARDED_BY(mu_);
+      // The prefix of the merged cache.
+      const std::string cache_prefix_;
       // The current prefix for the cache file. This is equal to
-      // `StrCat(dataset()->filename_, "_", shard_id_)`.
+      // `StrCat(cache_prefix_, "_", shard_id_)`.
       string filename_;
       std::unique_ptr<BundleWriter> writer_ TF_GUARDED_BY(mu_);
       string lockfile_ TF_GUARDED_BY(mu_);
@@ -586,12 +649,734 @@ class CacheDatasetOp::FileDatasetBase : public DatasetBase {
       bool iteration_completed_ TF_GUARDED_BY(mu_);
     };  // FileWriterIterator
 
+    // SharedFileWriterIterator passes through and caches items from the input
+    // of a content-addressed FileDatasetBase.
+    //
+    // The cache lives in a directory named after the fingerprint of the input
+    // graph, so every job on the host that builds the same input pipeline
+    // finds it. Jobs rely on producing the same elements in the same order,
+    // so this iterator is only used for deterministic inputs. The elements
+    // are split into ranges of `kSharedCacheShardElements` elements, and each
+    // range is written to its own shard by whichever job claims it first:
+    //
+    // - A job claims range <r> by creating the lease directory
+    //   <prefix>_<r>.lease, which is atomic, and renews the lease while it
+    //   writes. Other jobs produce the elements of a claimed range from their
+    //   input without caching them, and take over a lease that has not been
+    //   renewed for `kSharedCacheLeaseTimeoutSeconds`. Several jobs can thus
+    //   write different ranges of the cache at the same time.
+    // - Once a range is complete, its shard is committed by atomically
+    //   renaming <prefix>_<r>.committed into place. The commit also stores the
+    //   state of the input iterator at the end of the range, so that a job
+    //   that replays committed ranges resumes its input from there instead of
+    //   recomputing every element before it.
+    // - The range that holds fewer than `kSharedCacheShardElements` elements
+    //   is the last one. Once all ranges up to it are committed, one job
+    //   merges the shards into <prefix>.
+    //
+    // Saving the iterator does not commit the range in progress. An iterator
+    // restored in the middle of a range rewrites that range from its start,
+    // so at most one range of input is recomputed after preemption.
+    class SharedFileWriterIterator : public DatasetIterator<FileDatasetBase> {
+     public:
+      SharedFileWriterIterator(const Params& params, std::string cache_prefix)
+          : DatasetIterator<FileDatasetBase>(params),
+            cache_prefix_(std::move(cache_prefix)),
+            owner_(strings::StrCat(strings::Hex(random::New64(),
+                                                strings::kZeroPad16))),
+            lease_contents_(strings::StrCat(kCreatedAt, ": ",
+                                            EnvTime::NowSeconds(), "\nHost: ",
+                                            port::Hostname(), "\nOwner: ",
+                                            owner_)) {}
+
+      ~SharedFileWriterIterator() override {
+        mutex_lock l(mu_);
+        // Committed shards are kept so that other jobs can use them. Only the
+        // range in progress is lost.
+        DiscardShard();
+      }
+
+      absl::Status Initialize(IteratorContext* ctx) override {
+        return dataset()->input_->MakeIterator(ctx, this, prefix(),
+                                               &input_impl_);
+      }
+
+      absl::Status GetNextInternal(IteratorContext* ctx,
+                                   std::vector<Tensor>* out_tensors,
+                                   bool* end_of_sequence) override {
+        mutex_lock l(mu_);
+        *end_of_sequence = false;
+        if (phase_ == Phase::kDone) {
+          *end_of_sequence = true;
+          return absl::OkStatus();
+        }
+        if (cur_index_ >= kMaxItems) {
+          return errors::InvalidArgument(
+              "Upstream iterator is producing more than ", kMaxItems,
+              " items, which is more than the cache limit.");
+        }
+        // The completed cache is read through without looking up ranges.
+        const bool reads_completed_cache =
+            phase_ == Phase::kReplay && replay_limit_ < 0;
+        if (phase_ == Phase::kUninitialized ||
+            (cur_index_ >= RangeStart(range_ + 1) &&
+             !reads_completed_cache)) {
+          TF_RETURN_IF_ERROR(
+              StartRange(ctx, cur_index_ / kSharedCacheShardElements));
+        }
+        switch (phase_) {
+          case Phase::kReplay:
+            return ReadCommittedElement(out_tensors, end_of_sequence);
+          case Phase::kWrite:
+            return WriteNextElement(ctx, out_tensors, end_of_sequence);
+          case Phase::kPassThrough:
+            return GetNextFromInput(ctx, out_tensors, end_of_sequence);
+          default:
+            *end_of_sequence = true;
+            return absl::OkStatus();
+        }
+      }
+
+     protected:
+      std::shared_ptr<model::Node> CreateNode(
+          IteratorContext* ctx, model::Node::Args args) const override {
+        return model::MakeKnownRatioNode(std::move(args),
+                                         /*ratio=*/1);
+      }
+
+      absl::Status SaveInternal(SerializationContext* ctx,
+                                IteratorStateWriter* writer) override {
+        mutex_lock l(mu_);
+        TF_RETURN_IF_ERROR(
+            writer->WriteScalar(prefix(), kCurIndex, cur_index_));
+        if (phase_ == Phase::kDone) {
+          TF_RETURN_IF_ERROR(
+              writer->WriteScalar(prefix(), kIterationCompleted, ""));
+          return absl::OkStatus();
+        }
+        TF_RETURN_IF_ERROR(
+            writer->WriteScalar(prefix(), kInputIndex, input_index_));
+        return SaveInput(ctx, writer, input_impl_);
+      }
+
+      absl::Status RestoreInternal(IteratorContext* ctx,
+                                   IteratorStateReader* reader) override {
+        mutex_lock l(mu_);
+        DiscardShard();
+        replay_reader_.reset();
+        TF_RETURN_IF_ERROR(
+            reader->ReadScalar(prefix(), kCurIndex, &cur_index_));
+        if (reader->Contains(prefix(), kIterationCompleted)) {
+          phase_ = Phase::kDone;
+          return absl::OkStatus();
+        }
+        TF_RETURN_IF_ERROR(
+            reader->ReadScalar(prefix(), kInputIndex, &input_index_));
+        TF_RETURN_IF_ERROR(RestoreInput(ctx, reader, input_impl_));
+        // The range is looked up again on the next call to `GetNextInternal`,
+        // since other jobs may have advanced the cache since the checkpoint
+        // was written.
+        phase_ = Phase::kUninitialized;
+        return absl::OkStatus();
+      }
+
+     private:
+      enum class Phase {
+        // No range has been looked up yet.
+        kUninitialized,
+        // Producing elements of a committed range from its shard.
+        kReplay,
+        // Producing elements from the input and writing them to the shard of
+        // the current range.
+        kWrite,
+        // Another job writes the current range; producing elements from the
+        // input only.
+        kPassThrough,
+        // All elements have been produced.
+        kDone,
+      };
+
+      // A committed shard, as recorded in <prefix>_<range>.committed.
+      struct Shard {
+        int64_t num_elements;
+        // The shard prefix, relative to the cache directory.
+        std::string name;
+      };
+
+      static int64_t RangeStart(int64_t range) {
+        return range * kSharedCacheShardElements;
+      }
+
+      std::string ShardPrefix(const std::string& name) const {
+        return io::JoinPath(io::Dirname(cache_prefix_), name);
+      }
+
+      std::string RangeFilename(int64_t range, const char* suffix) const {
+        return strings::StrCat(cache_prefix_, "_", range, suffix);
+      }
+
+      // Looks up `range` and decides how its elements are produced.
+      absl::Status StartRange(IteratorContext* ctx, int64_t range)
+          TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+        if (phase_ == Phase::kUninitialized) {
+          TF_RETURN_IF_ERROR(dataset()->env_->RecursivelyCreateDir(
+              std::string(io::Dirname(cache_prefix_))));
+        }
+        range_ = range;
+        replay_reader_.reset();
+        if (dataset()->env_->FileExists(MetaFilename(cache_prefix_)).ok()) {
+          // Another job completed the cache in the meantime.
+          replay_prefix_ = cache_prefix_;
+          replay_limit_ = -1;
+          phase_ = Phase::kReplay;
+          return absl::OkStatus();
+        }
+        std::optional<Shard> shard = ReadCommittedShard(range);
+        if (shard.has_value()) {
+          replay_prefix_ = ShardPrefix(shard->name);
+          replay_limit_ = RangeStart(range) + shard->num_elements;
+          phase_ = Phase::kReplay;
+          return absl::OkStatus();
+        }
+        TF_ASSIGN_OR_RETURN(bool acquired,
+                            AcquireLease(RangeFilename(range, kLeaseSuffix)));
+        if (!acquired) {
+          VLOG(2) << "Range " << range << " of the cache " << cache_prefix_
+                  << " is being written by another job.";
+          phase_ = Phase::kPassThrough;
+          return absl::OkStatus();
+        }
+        absl::Status s = PositionInput(ctx, RangeStart(range));
+        if (!s.ok()) {
+          ReleaseLease(RangeFilename(range, kLeaseSuffix));
+          return s;
+        }
+        shard_name_ = strings::StrCat(kContentAddressedCacheName, "_", range,
+                                      "_", owner_);
+        writer_ = std::make_unique<BundleWriter>(dataset()->env_,
+                                                 ShardPrefix(shard_name_));
+        phase_ = Phase::kWrite;
+        return absl::OkStatus();
+      }
+
+      // Reads element `cur_index_` from the shard (or completed cache) that
+      // holds it.
+      absl::Status ReadCommittedElement(std::vector<Tensor>* out_tensors,
+                                        bool* end_of_sequence)
+          TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+        if (replay_limit_ >= 0 && cur_index_ >= replay_limit_) {
+          // Only the last range is short.
+          *end_of_sequence = true;
+          return FinishCache();
+        }
+        if (replay_reader_ == nullptr) {
+          replay_reader_ =
+              std::make_unique<BundleReader>(dataset()->env_, replay_prefix_);
+          if (!replay_reader_->status().ok() && replay_limit_ >= 0 &&
+              dataset()->env_->FileExists(MetaFilename(cache_prefix_)).ok()) {
+            // The shard was merged into the completed cache in the meantime.
+            replay_prefix_ = cache_prefix_;
+            replay_limit_ = -1;
+            replay_reader_ = std::make_unique<BundleReader>(dataset()->env_,
+                                                            replay_prefix_);
+          }
+          TF_RETURN_IF_ERROR(replay_reader_->status());
+          replay_reader_->Seek(dataset()->FormatName(cur_index_, 0));
+        }
+        out_tensors->clear();
+        out_tensors->resize(dataset()->num_tensors_);
+        for (size_t i = 0; i < dataset()->num_tensors_; ++i) {
+          if (!replay_reader_->Valid() ||
+              replay_reader_->key() != dataset()->FormatName(cur_index_, i)) {
+            if (replay_limit_ < 0 && i == 0) {
+              // The completed cache has no more elements.
+              out_tensors->clear();
+              phase_ = Phase::kDone;
+              *end_of_sequence = true;
+              return absl::OkStatus();
+            }
+            return errors::DataLoss("Cache ", replay_prefix_,
+                                    " is missing element ", cur_index_, ".");
+          }
+          TF_RETURN_IF_ERROR(replay_reader_->ReadCurrent(&(*out_tensors)[i]));
+          replay_reader_->Next();
+        }
+        ++cur_index_;
+        return absl::OkStatus();
+      }
+
+      // Produces element `cur_index_` from the input. Elements of the range
+      // that precede `cur_index_` (after a restore in the middle of the range)
+      // are written without being produced.
+      absl::Status WriteNextElement(IteratorContext* ctx,
+                                    std::vector<Tensor>* out_tensors,
+                                    bool* end_of_sequence)
+          TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+        TF_RETURN_IF_ERROR(MaybeRenewLease());
+        while (true) {
+          out_tensors->clear();
+          TF_RETURN_IF_ERROR(
+              input_impl_->GetNext(ctx, out_tensors, end_of_sequence));
+          if (*end_of_sequence) {
+            if (input_index_ < cur_index_) {
+              return NonDeterministicInputError(cur_index_);
+            }
+            // A short range marks the end of the cache.
+            TF_RETURN_IF_ERROR(CommitShard());
+            return FinishCache();
+          }
+          if (out_tensors->size() != dataset()->num_tensors_) {
+            return errors::Internal(
+                "Upstream iterator returned invalid number of tensors. "
+                "Expected ",
+                dataset()->num_tensors_, " got: ", out_tensors->size());
+          }
+          TF_RETURN_IF_ERROR(writer_->status());
+          for (size_t i = 0; i < out_tensors->size(); ++i) {
+            TF_RETURN_IF_ERROR(writer_->Add(
+                dataset()->FormatName(input_index_, i), (*out_tensors)[i]));
+          }
+          ++input_index_;
+          if (input_index_ > cur_index_) {
+            break;
+          }
+        }
+        ++cur_index_;
+        if (input_index_ == RangeStart(range_ + 1)) {
+          TF_RETURN_IF_ERROR(CommitShard());
+        }
+        return absl::OkStatus();
+      }
+
+      absl::Status GetNextFromInput(IteratorContext* ctx,
+                                    std::vector<Tensor>* out_tensors,
+                                    bool* end_of_sequence)
+          TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+        TF_RETURN_IF_ERROR(PositionInput(ctx, cur_index_));
+        TF_RETURN_IF_ERROR(
+            input_impl_->GetNext(ctx, out_tensors, end_of_sequence));
+        if (*end_of_sequence) {
+          // The job writing the last range merges the cache, unless it
+          // finished before this one.
+          return FinishCache();
+        }
+        ++cur_index_;
+        ++input_index_;
+        return absl::OkStatus();
+      }
+
+      // Moves the input to element `index`. The input is resumed from the
+      // state stored with the committed range that ends at or before `index`
+      // if that avoids recomputing elements, and is skipped forward
+      // otherwise.
+      absl::Status PositionInput(IteratorContext* ctx, int64_t index)
+          TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+        if (input_index_ == index) {
+          return absl::OkStatus();
+        }
+        const int64_t range = index / kSharedCacheShardElements;
+        const int64_t range_start = RangeStart(range);
+        if ((input_index_ < range_start || input_index_ > index) &&
+            range > 0) {
+          std::optional<Shard> previous = ReadCommittedShard(range - 1);
+          if (previous.has_value()) {
+            absl::Status s = RestoreInputState(
+                ctx, InputStateFilename(previous->name), range_start);
+            if (!s.ok()) {
+              LOG(WARNING) << "Failed to resume the input of the cache "
+                           << cache_prefix_ << " at element " << range_start
+                           << ": " << s;
+            }
+          }
+        }
+        if (input_index_ > index) {
+          TF_RETURN_IF_ERROR(dataset()->input_->MakeIterator(
+              ctx, this, prefix(), &input_impl_));
+          input_index_ = 0;
+        }
+        while (input_index_ < index) {
+          bool end_of_sequence = false;
+          int num_skipped = 0;
+          TF_RETURN_IF_ERROR(input_impl_->Skip(
+              ctx, static_cast<int>(index - input_index_), &end_of_sequence,
+              &num_skipped));
+          input_index_ += num_skipped;
+          if (end_of_sequence && input_index_ < index) {
+            return NonDeterministicInputError(index);
+          }
+        }
+        return absl::OkStatus();
+      }
+
+      absl::Status NonDeterministicInputError(int64_t index) const
+          TF_SHARED_LOCKS_REQUIRED(mu_) {
+        return errors::FailedPrecondition(
+            "The input of the cache ", cache_prefix_, " produced ",
+            input_index_, " elements, but ", index, " elements were "
+            "expected. The input pipeline is not deterministic; delete the "
+            "cache directory and try again.");
+      }
+
+      std::string InputStateFilename(const std::string& shard_name) const {
+        return strings::StrCat(ShardPrefix(shard_name), kInputStateSuffix);
+      }
+
+      // Writes the state of `input_impl_` to `filename`.
+      absl::Status SaveInputState(const std::string& filename)
+          TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+        SerializationContext::Params params;
+        params.external_state_policy = ExternalStatePolicy::POLICY_FAIL;
+        SerializationContext serialization_ctx(params);
+        VariantTensorDataWriter writer;
+        TF_RETURN_IF_ERROR(SaveInput(&serialization_ctx, &writer, input_impl_));
+        std::vector<std::unique_ptr<VariantTensorData>> data;
+        writer.ReleaseData(&data);
+        Tensor state(DT_VARIANT,
+                     TensorShape({static_cast<int64_t>(data.size())}));
+        for (size_t i = 0; i < data.size(); ++i) {
+          IteratorStateVariant variant;
+          TF_RETURN_IF_ERROR(
+              variant.InitializeFromVariantData(std::move(data[i])));
+          state.vec<Variant>()(i) = std::move(variant);
+        }
+        TensorProto proto;
+        state.AsProtoField(&proto);
+        return WriteBinaryProto(dataset()->env_, filename, proto);
+      }
+
+      // Replaces `input_impl_` with an iterator restored from the state in
+      // `filename`, which was saved after `index` elements.
+      absl::Status RestoreInputState(IteratorContext* ctx,
+                                     const std::string& filename,
+                                     int64_t index)
+          TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+        TensorProto proto;
+        TF_RETURN_IF_ERROR(ReadBinaryProto(dataset()->env_, filename, &proto));
+        Tensor state;
+        if (!state.FromProto(proto) || state.dtype() != DT_VARIANT ||
+            state.dims() != 1) {
+          return errors::DataLoss("Invalid input state in ", filename);
+        }
+        std::vector<const VariantTensorData*> data;
+        for (int64_t i = 0; i < state.NumElements(); ++i) {
+          auto* variant = state.vec<Variant>()(i).get<IteratorStateVariant>();
+          if (variant == nullptr) {
+            return errors::DataLoss("Invalid input state in ", filename);
+          }
+          data.push_back(variant->GetData());
+        }
+        VariantTensorDataReader reader(data);
+        std::unique_ptr<IteratorBase> input_impl;
+        TF_RETURN_IF_ERROR(
+            dataset()->input_->MakeIterator(ctx, this, prefix(), &input_impl));
+        TF_RETURN_IF_ERROR(RestoreInput(ctx, &reader, input_impl));
+        input_impl_ = std::move(input_impl);
+        input_index_ = index;
+        return absl::OkStatus();
+      }
+
+      // Returns the committed shard of `range`, or nullopt if the range has
+      // not been committed or its shard is gone.
+      std::optional<Shard> ReadCommittedShard(int64_t range) const {
+        const std::string filename = RangeFilename(range, kCommittedSuffix);
+        std::string contents;
+        absl::Status s =
+            ReadFileToString(dataset()->env_, filename, &contents);
+        if (!s.ok()) {
+          if (!absl::IsNotFound(s)) {
+            LOG(WARNING) << "Failed to read " << filename << ": " << s;
+          }
+          return std::nullopt;
+        }
+        std::vector<std::string> fields =
+            absl::StrSplit(contents, ' ', absl::SkipEmpty());
+        Shard shard;
+        if (fields.size() != 2 ||
+            !absl::SimpleAtoi(fields[0], &shard.num_elements)) {
+          LOG(WARNING) << "Ignoring malformed cache commit " << filename
+                       << ": " << contents;
+          return std::nullopt;
+        }
+        shard.name = std::move(fields[1]);
+        const std::string shard_prefix = ShardPrefix(shard.name);
+        if (!dataset()->env_->FileExists(MetaFilename(shard_prefix)).ok() ||
+            !dataset()
+                 ->env_->FileExists(DataFilename(shard_prefix, 0, 1))
+                 .ok()) {
+          LOG(WARNING) << "Cache shard " << shard.name << " committed in "
+                       << filename << " no longer exists.";
+          return std::nullopt;
+        }
+        return shard;
+      }
+
+      // Finalizes the shard of the current range, records it together with
+      // the input state, and releases the range.
+      absl::Status CommitShard() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+        TF_RETURN_IF_ERROR(writer_->Finish());
+        writer_.reset();
+        const int64_t num_elements = input_index_ - RangeStart(range_);
+        if (num_elements == kSharedCacheShardElements) {
+          absl::Status s = SaveInputState(InputStateFilename(shard_name_));
+          if (!s.ok()) {
+            LOG_FIRST_N(WARNING, 1)
+                << "Failed to save the input state of the cache "
+                << cache_prefix_ << "; jobs that resume the cache will "
+                << "recompute its prefix: " << s;
+          }
+        }
+        // Renaming makes the commit atomic. Jobs that wrote the same range
+        // concurrently produce identical shards, so the last commit wins.
+        const std::string filename = RangeFilename(range_, kCommittedSuffix);
+        const std::string tmp_filename =
+            strings::StrCat(filename, ".", owner_, ".tmp");
+        TF_RETURN_IF_ERROR(WriteStringToFile(
+            dataset()->env_, tmp_filename,
+            strings::StrCat(num_elements, " ", shard_name_)));
+        TF_RETURN_IF_ERROR(dataset()->env_->RenameFile(tmp_filename, filename));
+        ReleaseLease(RangeFilename(range_, kLeaseSuffix));
+        return absl::OkStatus();
+      }
+
+      // Drops the shard in progress, if any, and releases its range.
+      void DiscardShard() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+        if (writer_ == nullptr) {
+          return;
+        }
+        writer_.reset();
+        DeleteMatchingFiles(strings::StrCat(ShardPrefix(shard_name_), ".*"));
+        ReleaseLease(RangeFilename(range_, kLeaseSuffix));
+      }
+
+      void DeleteMatchingFiles(const std::string& pattern) {
+        std::vector<string> files;
+        absl::Status s = dataset()->env_->GetMatchingPaths(pattern, &files);
+        if (!s.ok()) {
+          LOG(WARNING) << "Failed to get matching files on " << pattern
+                       << " : " << s;
+        }
+        for (const string& path : files) {
+          int64_t undeleted_files, undeleted_dirs;
+          s = dataset()->env_->DeleteRecursively(path, &undeleted_files,
+                                                 &undeleted_dirs);
+          if (!s.ok()) {
+            LOG(WARNING) << "Failed to delete " << path << " : " << s;
+          }
+        }
+      }
+
+      // Merges the committed shards into <prefix> if every range has been
+      // committed. Otherwise the job writing the remaining ranges merges them.
+      absl::Status FinishCache() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+        phase_ = Phase::kDone;
+        Env* const env = dataset()->env_;
+        if (env->FileExists(MetaFilename(cache_prefix_)).ok()) {
+          return absl::OkStatus();
+        }
+        // Empty shards (the last range of an input whose size is a multiple
+        // of `kSharedCacheShardElements`) have no data to merge.
+        std::vector<tstring> prefixes;
+        for (int64_t range = 0;; ++range) {
+          std::optional<Shard> shard = ReadCommittedShard(range);
+          if (!shard.has_value()) {
+            VLOG(2) << "Range " << range << " of the cache " << cache_prefix_
+                    << " is not committed yet.";
+            return absl::OkStatus();
+          }
+          if (shard->num_elements > 0) {
+            prefixes.emplace_back(ShardPrefix(shard->name));
+          }
+          if (shard->num_elements < kSharedCacheShardElements) {
+            break;
+          }
+        }
+        const std::string merge_lease =
+            strings::StrCat(cache_prefix_, kLeaseSuffix);
+        TF_ASSIGN_OR_RETURN(bool acquired, AcquireLease(merge_lease));
+        if (!acquired) {
+          return absl::OkStatus();
+        }
+        // Merge under a private prefix and rename the result into place, so
+        // that readers never observe a partially written cache.
+        const std::string merged_prefix =
+            strings::StrCat(cache_prefix_, "_", owner_);
+        absl::Status s;
+        int num_shards = prefixes.size();
+        if (prefixes.empty()) {
+          BundleWriter writer(env, merged_prefix);
+          s = writer.Finish();
+          num_shards = 1;
+        } else {
+          s = MergeBundles(env, prefixes, merged_prefix);
+        }
+        for (int i = 0; s.ok() && i < num_shards; ++i) {
+          s = env->RenameFile(DataFilename(merged_prefix, i, num_shards),
+                              DataFilename(cache_prefix_, i, num_shards));
+        }
+        if (s.ok()) {
+          s = env->RenameFile(MetaFilename(merged_prefix),
+                              MetaFilename(cache_prefix_));
+        }
+        if (!s.ok()) {
+          LOG(WARNING) << "Failed to merge the cache " << cache_prefix_
+                       << "; the affected ranges will be rewritten: " << s;
+          ReleaseLease(merge_lease);
+          return absl::OkStatus();
+        }
+        // Removes shards, commits, input states, and leases.
+        DeleteMatchingFiles(strings::StrCat(cache_prefix_, "_*"));
+        ReleaseLease(merge_lease);
+        return absl::OkStatus();
+      }
+
+      // Tries to create the lease directory `lease`. Returns false if another
+      // job holds a lease that is still live.
+      absl::StatusOr<bool> AcquireLease(const std::string& lease)
+          TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+        Env* const env = dataset()->env_;
+        TF_ASSIGN_OR_RETURN(bool created, CreateLease(lease));
+        if (created) {
+          return true;
+        }
+        const std::string owner_file = io::JoinPath(lease, kLeaseOwner);
+        FileStatistics stat;
+        if (!env->Stat(owner_file, &stat).ok() &&
+            !env->Stat(lease, &stat).ok()) {
+          // Released in the meantime; the range is left to whoever claimed
+          // it first.
+          return false;
+        }
+        const int64_t age_seconds =
+            (static_cast<int64_t>(EnvTime::NowNanos()) - stat.mtime_nsec) /
+            static_cast<int64_t>(EnvTime::kSecondsToNanos);
+        if (age_seconds < kSharedCacheLeaseTimeoutSeconds) {
+          return false;
+        }
+        // Move the stale lease out of the way. Only one job can rename it;
+        // the others see it gone and race on `CreateLease` below.
+        std::string stale_contents;
+        ReadFileToString(env, owner_file, &stale_contents).IgnoreError();
+        const std::string stale_lease =
+            strings::StrCat(lease, ".", owner_, ".stale");
+        if (!env->RenameFile(lease, stale_lease).ok()) {
+          return false;
+        }
+        std::string moved_contents;
+        ReadFileToString(env, io::JoinPath(stale_lease, kLeaseOwner),
+                         &moved_contents)
+            .IgnoreError();
+        if (moved_contents != stale_contents) {
+          // The lease was renewed or taken over after it was found stale.
+          env->RenameFile(stale_lease, lease).IgnoreError();
+          return false;
+        }
+        int64_t undeleted_files, undeleted_dirs;
+        env->DeleteRecursively(stale_lease, &undeleted_files, &undeleted_dirs)
+            .IgnoreError();
+        LOG(WARNING) << "Took over the lease " << lease << ", which had not "
+                     << "been renewed for " << age_seconds << " seconds.";
+        return CreateLease(lease);
+      }
+
+      // Atomically creates the lease directory `lease` and records this
+      // iterator as its owner. Returns false if the lease already exists.
+      absl::StatusOr<bool> CreateLease(const std::string& lease)
+          TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+        absl::Status s = dataset()->env_->CreateDir(lease);
+        if (absl::IsAlreadyExists(s)) {
+          return false;
+        }
+        TF_RETURN_IF_ERROR(s);
+        TF_RETURN_IF_ERROR(WriteLeaseOwner(lease));
+        last_lease_renewal_seconds_ = EnvTime::NowSeconds();
+        return true;
+      }
+
+      // Writes the owner file of `lease`. Every write records a new renewal
+      // count, so that a job that found the lease stale can tell that it was
+      // renewed since, even within the resolution of file timestamps.
+      absl::Status WriteLeaseOwner(const std::string& lease)
+          TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+        return WriteStringToFile(
+            dataset()->env_, io::JoinPath(lease, kLeaseOwner),
+            strings::StrCat(lease_contents_, "\n", kLeaseRenewals, ": ",
+                            ++num_lease_renewals_));
+      }
+
+      bool OwnsLease(const std::string& lease) const {
+        std::string contents;
+        return ReadFileToString(dataset()->env_,
+                                io::JoinPath(lease, kLeaseOwner), &contents)
+                   .ok() &&
+               absl::StartsWith(contents,
+                                strings::StrCat(lease_contents_, "\n"));
+      }
+
+      // Refreshes the timestamp of the lease on the current range, so that
+      // other jobs do not take it over while this iterator makes progress.
+      absl::Status MaybeRenewLease() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+        if (static_cast<int64_t>(EnvTime::NowSeconds()) -
+                last_lease_renewal_seconds_ <
+            kSharedCacheLeaseRenewalSeconds) {
+          return absl::OkStatus();
+        }
+        last_lease_renewal_seconds_ = EnvTime::NowSeconds();
+        const std::string lease = RangeFilename(range_, kLeaseSuffix);
+        if (!OwnsLease(lease)) {
+          // Another job took the range over. The input is deterministic, so
+          // both write identical shards; keep going rather than discard the
+          // work done so far.
+          VLOG(2) << "Lost the lease " << lease << ".";
+          return absl::OkStatus();
+        }
+        return WriteLeaseOwner(lease);
+      }
+
+      void ReleaseLease(const std::string& lease) {
+        if (!OwnsLease(lease)) {
+          return;
+        }
+        int64_t undeleted_files, undeleted_dirs;
+        absl::Status s = dataset()->env_->DeleteRecursively(
+            lease, &undeleted_files, &undeleted_dirs);
+        if (!s.ok()) {
+          LOG(WARNING) << "Failed to delete " << lease << " : " << s;
+        }
+      }
+
+      mutex mu_;
+      const std::string cache_prefix_;
+      // Identifies this iterator in shard names and in leases.
+      const std::string owner_;
+      const std::string lease_contents_;
+      Phase phase_ TF_GUARDED_BY(mu_) = Phase::kUninitialized;
+      // The range that holds `cur_index_`.
+      int64_t range_ TF_GUARDED_BY(mu_) = 0;
+      // Number of elements produced by this iterator.
+      int64_t cur_index_ TF_GUARDED_BY(mu_) = 0;
+      // Number of elements consumed from `input_impl_`. Differs from
+      // `cur_index_` while committed ranges are replayed, and after a restore
+      // in the middle of a range that is being rewritten.
+      int64_t input_index_ TF_GUARDED_BY(mu_) = 0;
+      std::unique_ptr<IteratorBase> input_impl_ TF_GUARDED_BY(mu_);
+      int64_t last_lease_renewal_seconds_ TF_GUARDED_BY(mu_) = 0;
+      int64_t num_lease_renewals_ TF_GUARDED_BY(mu_) = 0;
+      // The bundle replayed in `Phase::kReplay`, and the index of the first
+      // element after it (-1 for the completed cache).
+      std::string replay_prefix_ TF_GUARDED_BY(mu_);
+      int64_t replay_limit_ TF_GUARDED_BY(mu_) = -1;
+      std::unique_ptr<BundleReader> replay_reader_ TF_GUARDED_BY(mu_);
+      // The shard of the current range in `Phase::kWrite`.
+      std::unique_ptr<BundleWriter> writer_ TF_GUARDED_BY(mu_);
+      std::string shard_name_ TF_GUARDED_BY(mu_);
+    };  // SharedFileWriterIterator
+
     class FileReaderIterator : public DatasetIterator<FileDatasetBase> {
      public:
-      explicit FileReaderIterator(const Params& params)
+      FileReaderIterator(const Params& params, const std::string& cache_prefix)
           : DatasetIterator<FileDatasetBase>(params),
             cur_index_(0),
-            reader_(dataset()->env_, dataset()->filename_),
+            reader_(dataset()->env_, cache_prefix),
             iterator_restored_(false) {}
 
       absl::Status GetNextInternal(IteratorContext* ctx,
@@ -687,22 +1472,33 @@ class CacheDatasetOp::FileDatasetBase : public DatasetBase {
       // `cur_index`.
       switch (mode_) {
         case Mode::read:
-          iterator_ =
-              std::make_unique<FileReaderIterator>(FileReaderIterator::Params{
-                  dataset(), strings::StrCat(prefix(), kImpl)});
+          iterator_ = std::make_unique<FileReaderIterator>(
+              FileReaderIterator::Params{dataset(),
+                                         strings::StrCat(prefix(), kImpl)},
+              cache_prefix_);
           break;
         case Mode::write:
-          iterator_ =
-              std::make_unique<FileWriterIterator>(FileWriterIterator::Params{
-                  dataset(), strings::StrCat(prefix(), kImpl)});
+          iterator_ = std::make_unique<FileWriterIterator>(
+              FileWriterIterator::Params{dataset(),
+                                         strings::StrCat(prefix(), kImpl)},
+              cache_prefix_);
+          break;
+        case Mode::shared_write:
+          iterator_ = std::make_unique<SharedFileWriterIterator>(
+              SharedFileWriterIterator::Params{
+                  dataset(), strings::StrCat(prefix(), kImpl)},
+              cache_prefix_);
       }
       TF_RETURN_IF_ERROR(iterator_->InitializeBase(ctx, this));
       return iterator_->Initialize(ctx);
     }
 
     mutex mu_;
-    enum Mode { read, write };
+    enum Mode { read, write, shared_write };
     Mode mode_ TF_GUARDED_BY(mu_);
+    // The prefix of the cache files. This is the dataset filename, or a
+    // fingerprint-keyed path below it if the cache is content addressed.
+    std::string cache_prefix_ TF_GUARDED_BY(mu_);
     std::unique_ptr<IteratorBase> iterator_ TF_GUARDED_BY(mu_);
   };  // FileIterator
 
@@ -11,12 +11,17 @@ limitations under the License.
 ==============================================================================*/
 #include "tensorflow/core/kernels/data/cache_dataset_ops.h"
 
+#include <cstdint>
+#include <memory>
+#include <numeric>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "tensorflow/core/data/dataset_test_base.h"
 #include "tensorflow/core/data/dataset_utils.h"
 #include "tensorflow/core/data/serialization_utils.h"
+#include "tensorflow/core/framework/dataset_options.pb.h"
 #include "tensorflow/core/platform/path.h"
 
 namespace tensorflow {
@@ -370,6 +375,149 @@ INSTANTIATE_TEST_CASE_P(CacheDatasetOpTest,
                         ParameterizedIteratorSaveAndRestoreTest,
                         ::testing::ValuesIn(IteratorSaveAndRestoreTestCases()));
 
+// Test case 5: cache data in a content-addressed directory. The input spans
+// two full ranges of the shared cache and a partial third one.
+constexpr int64_t kContentAddressedCacheSize = 2500;
+
+CacheDatasetParams ContentAddressedCacheDatasetParams() {
+  return CacheDatasetParams(
+      RangeDatasetParams(0, kContentAddressedCacheSize, 1),
+      /*filename=*/io::JoinPath(testing::TmpDir(), "content_addressed_cache"),
+      /*output_dtypes=*/{DT_INT64},
+      /*output_shapes=*/{PartialTensorShape({})}, kNodeName);
+}
+
+class ContentAddressedCacheTest : public CacheDatasetOpTest {
+ protected:
+  void SetUp() override {
+    dataset_params_ = std::make_unique<CacheDatasetParams>(
+        ContentAddressedCacheDatasetParams());
+    int64_t undeleted_files, undeleted_dirs;
+    device_->env()
+        ->DeleteRecursively(dataset_params_->filename(), &undeleted_files,
+                            &undeleted_dirs)
+        .IgnoreError();
+    TF_ASSERT_OK(Initialize(*dataset_params_));
+    options_.mutable_cache_options()->set_content_addressed(true);
+    IteratorContext::Params params(iterator_ctx_.get());
+    params.options = &options_;
+    ctx_ = std::make_unique<IteratorContext>(std::move(params));
+  }
+
+  void TearDown() override {
+    int64_t undeleted_files, undeleted_dirs;
+    TF_EXPECT_OK(device_->env()->DeleteRecursively(
+        dataset_params_->filename(), &undeleted_files, &undeleted_dirs));
+  }
+
+  absl::Status MakeCacheIterator(std::unique_ptr<IteratorBase>* iterator) {
+    return dataset_->MakeIterator(ctx_.get(), /*parent=*/nullptr,
+                                  dataset_params_->iterator_prefix(),
+                                  iterator);
+  }
+
+  // Appends up to `num_elements` elements of `iterator` to `outputs`.
+  void GetNext(IteratorBase* iterator, int64_t num_elements,
+               std::vector<int64_t>* outputs) {
+    bool end_of_sequence = false;
+    for (int64_t i = 0; i < num_elements && !end_of_sequence; ++i) {
+      std::vector<Tensor> next;
+      TF_ASSERT_OK(iterator->GetNext(ctx_.get(), &next, &end_of_sequence));
+      if (!end_of_sequence) {
+        outputs->push_back(next[0].scalar<int64_t>()());
+      }
+    }
+  }
+
+  // Returns the number of cache files matching `pattern`.
+  int64_t NumCacheFiles(const std::string& pattern) {
+    std::vector<string> files;
+    TF_CHECK_OK(device_->env()->GetMatchingPaths(
+        io::JoinPath(dataset_params_->filename(), "*", pattern), &files));
+    return files.size();
+  }
+
+  std::vector<int64_t> ExpectedOutputs() {
+    std::vector<int64_t> expected(kContentAddressedCacheSize);
+    std::iota(expected.begin(), expected.end(), 0);
+    return expected;
+  }
+
+  std::unique_ptr<CacheDatasetParams> dataset_params_;
+  Options options_;
+  std::unique_ptr<IteratorContext> ctx_;
+};
+
+TEST_F(ContentAddressedCacheTest, ResumesCommittedRanges) {
+  // Dropping an iterator in the middle of the second range leaves the first
+  // range committed, as a preempted job would.
+  std::unique_ptr<IteratorBase> iterator;
+  TF_ASSERT_OK(MakeCacheIterator(&iterator));
+  std::vector<int64_t> outputs;
+  GetNext(iterator.get(), 1500, &outputs);
+  iterator.reset();
+  EXPECT_EQ(NumCacheFiles("cache_0.committed"), 1);
+  EXPECT_EQ(NumCacheFiles("cache_0_*.input_state"), 1);
+  EXPECT_EQ(NumCacheFiles("cache_1.committed"), 0);
+  EXPECT_EQ(NumCacheFiles("cache_1.lease"), 0);
+
+  // A new iterator replays the first range, resumes its input from the saved
+  // state, and completes the cache. A third iterator reads the completed
+  // cache.
+  for (int i = 0; i < 2; ++i) {
+    TF_ASSERT_OK(MakeCacheIterator(&iterator));
+    outputs.clear();
+    GetNext(iterator.get(), kContentAddressedCacheSize + 1, &outputs);
+    EXPECT_EQ(outputs, ExpectedOutputs());
+    EXPECT_EQ(NumCacheFiles("cache.index"), 1);
+    EXPECT_EQ(NumCacheFiles("cache_*"), 0);
+  }
+}
+
+TEST_F(ContentAddressedCacheTest, ConcurrentWriters) {
+  std::unique_ptr<IteratorBase> first, second;
+  TF_ASSERT_OK(MakeCacheIterator(&first));
+  TF_ASSERT_OK(MakeCacheIterator(&second));
+  std::vector<int64_t> first_outputs, second_outputs;
+
+  // `first` claims the first range. `second` passes through it and claims
+  // the second range.
+  GetNext(first.get(), 1, &first_outputs);
+  GetNext(second.get(), 1100, &second_outputs);
+  EXPECT_EQ(NumCacheFiles("cache_0.lease"), 1);
+  EXPECT_EQ(NumCacheFiles("cache_1.lease"), 1);
+
+  // `first` passes through the second range and writes the third. `second`
+  // then commits the second range, replays the third, and merges the cache.
+  GetNext(first.get(), kContentAddressedCacheSize, &first_outputs);
+  EXPECT_EQ(NumCacheFiles("cache.index"), 0);
+  EXPECT_EQ(NumCacheFiles("cache_2.committed"), 1);
+  GetNext(second.get(), kContentAddressedCacheSize, &second_outputs);
+  EXPECT_EQ(first_outputs, ExpectedOutputs());
+  EXPECT_EQ(second_outputs, ExpectedOutputs());
+  EXPECT_EQ(NumCacheFiles("cache.index"), 1);
+  EXPECT_EQ(NumCacheFiles("cache_*"), 0);
+}
+
+TEST_F(ContentAddressedCacheTest, NonDeterministicInputIsNotShared) {
+  options_.set_deterministic(false);
+  std::unique_ptr<IteratorBase> iterator;
+  TF_ASSERT_OK(MakeCacheIterator(&iterator));
+  std::vector<int64_t> outputs;
+  GetNext(iterator.get(), kContentAddressedCacheSize + 1, &outputs);
+  EXPECT_EQ(outputs, ExpectedOutputs());
+  EXPECT_EQ(NumCacheFiles("cache*"), 0);
+
+  // The cache is written to the filename of the dataset instead.
+  std::vector<string> files;
+  TF_ASSERT_OK(device_->env()->GetMatchingPaths(
+      strings::StrCat(dataset_params_->filename(), ".*"), &files));
+  EXPECT_FALSE(files.empty());
+  for (const string& file : files) {
+    TF_EXPECT_OK(device_->env()->DeleteFile(file));
+  }
+}
+
 }  // namespace
 }  // namespace data
 }  // namespace tensorflow
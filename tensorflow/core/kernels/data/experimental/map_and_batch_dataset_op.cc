@@ -208,6 +208,27 @@ class MapAndBatchDatasetOp::Dataset : public DatasetBase {
                       ? GetCpuBudget()  // maximum parallelism
                       : params.dataset->num_parallel_calls_,
                   params.dataset->batch_size_));
+      // If the shapes of the function outputs are known, each batch is
+      // allocated before its function calls, so that the calls can write
+      // their outputs into the batch instead of having them copied.
+      for (int i = 0; i < params.dataset->output_shapes_.size(); ++i) {
+        const PartialTensorShape& shape = params.dataset->output_shapes_[i];
+        if (shape.unknown_rank() || shape.dims() < 1 ||
+            !DataTypeCanUseMemcpy(params.dataset->output_types_[i])) {
+          element_shapes_.clear();
+          break;
+        }
+        TensorShape element_shape;
+        for (int d = 1; d < shape.dims(); ++d) {
+          if (shape.dim_size(d) < 0) break;
+          element_shape.AddDim(shape.dim_size(d));
+        }
+        if (element_shape.dims() != shape.dims() - 1) {
+          element_shapes_.clear();
+          break;
+        }
+        element_shapes_.push_back(std::move(element_shape));
+      }
     }
 
     ~Iterator() override {
@@ -482,6 +503,8 @@ class MapAndBatchDatasetOp::Dataset : public DatasetBase {
                     offset);
                 break;
               }
+              // The function wrote the output into its slot of the batch.
+              if (tensor.SharesBufferWith(*batch)) continue;
               // TODO(mrry): Add a version of DoParallelConcat that allows us
               // to move `tensor` where possible, to speed up string tensor
               // batching.
@@ -503,9 +526,11 @@ class MapAndBatchDatasetOp::Dataset : public DatasetBase {
 
       // Apply the map function on `input_element`, storing the result in
       // `return_values`, and invoking `done` when finished.
-      instantiated_captured_func_->RunAsync(ctx.get(), std::move(input_element),
-                                            return_values.get(),
-                                            std::move(done), model_node());
+      std::vector<Tensor> output_slots =
+          ReserveOutputSlots(ctx, result, offset);
+      instantiated_captured_func_->RunAsync(
+          ctx.get(), std::move(input_element), std::move(output_slots),
+          return_values.get(), std::move(done), model_node());
     }
 
     void CancelThreads(bool wait) TF_LOCKS_EXCLUDED(mu_) {
@@ -537,26 +562,71 @@ class MapAndBatchDatasetOp::Dataset : public DatasetBase {
       if (result->output_allocated) {
         return absl::OkStatus();
       }
-      const size_t num_components = return_values->size();
-      result->output.reserve(num_components);
+      DataTypeVector dtypes;
+      std::vector<TensorShape> element_shapes;
+      for (const Tensor& tensor : *return_values) {
+        dtypes.push_back(tensor.dtype());
+        element_shapes.push_back(tensor.shape());
+      }
+      return AllocateOutput(ctx.get(), dtypes, element_shapes, result.get());
+    }
+
+    // Allocates `result->output` for elements of the given types and shapes.
+    //
+    // REQUIRES: `result->mu` is held and `!result->output_allocated`.
+    absl::Status AllocateOutput(IteratorContext* ctx,
+                                const DataTypeVector& dtypes,
+                                const std::vector<TensorShape>& element_shapes,
+                                BatchResult* result) {
+      const size_t num_components = dtypes.size();
+      std::vector<Tensor> output;
+      output.reserve(num_components);
       for (size_t i = 0; i < num_components; ++i) {
         TensorShape component_shape({dataset()->batch_size_});
-        component_shape.AppendShape(return_values->at(i).shape());
+        component_shape.AppendShape(element_shapes[i]);
         AllocatorAttributes attr;
         attr.set_gpu_compatible(true);
-        result->output.emplace_back(ctx->allocator(attr),
-                                    return_values->at(i).dtype(),
-                                    component_shape);
-        if (!result->output.back().IsInitialized()) {
+        output.emplace_back(ctx->allocator(attr), dtypes[i], component_shape);
+        if (!output.back().IsInitialized()) {
           return errors::ResourceExhausted(
               "Failed to allocate memory for the batch of component ", i);
         }
       }
-      RecordBufferEnqueue(ctx.get(), result->output);
+      result->output = std::move(output);
+      RecordBufferEnqueue(ctx, result->output);
       result->output_allocated = true;
       return absl::OkStatus();
     }
 
+    // Returns the slices of the batch in which the function call at `offset`
+    // may allocate its outputs, allocating the batch if needed. Returns no
+    // slots if the shapes of the outputs are not known before the call.
+    std::vector<Tensor> ReserveOutputSlots(
+        const std::shared_ptr<IteratorContext>& ctx,
+        const std::shared_ptr<BatchResult>& result, int64_t offset) {
+      std::vector<Tensor> slots;
+      if (element_shapes_.empty()) {
+        return slots;
+      }
+      mutex_lock l(result->mu);
+      // If the allocation fails, it is retried after the call, which reports
+      // the error.
+      if (!result->output_allocated &&
+          !AllocateOutput(ctx.get(), dataset()->output_dtypes(),
+                          element_shapes_, result.get())
+               .ok()) {
+        return slots;
+      }
+      slots.reserve(result->output.size());
+      for (const Tensor& batch : result->output) {
+        // Kernels expect their outputs to be aligned, so unaligned slices are
+        // not reserved.
+        Tensor slot = batch.SubSlice(offset);
+        slots.push_back(slot.IsAligned() ? std::move(slot) : Tensor());
+      }
+      return slots;
+    }
+
     void RunnerThread(const std::shared_ptr<IteratorContext>& ctx)
         TF_LOCKS_EXCLUDED(*mu_) {
       std::vector<std::pair<std::shared_ptr<BatchResult>, int64_t>> new_calls;
@@ -723,6 +793,9 @@ class MapAndBatchDatasetOp::Dataset : public DatasetBase {
     // tree. We record the interleave depth so that it can be included in the
     // trace metadata.
     int64 interleave_depth_ = -1;
+    // The shapes of the function outputs, if they are known before the calls,
+    // and empty otherwise.
+    std::vector<TensorShape> element_shapes_;
     // Background thread used for coordinating input processing. The thread
     // should be destroyed before the variables it accesses are destroyed.
     std::unique_ptr<Thread> runner_thread_ TF_GUARDED_BY(*mu_);
@@ -51,6 +51,7 @@ limitations under the License.
 #include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/errors.h"
 #include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/numa.h"
 #include "tensorflow/core/platform/refcount.h"
 #include "tensorflow/core/platform/resource.h"
 #include "tensorflow/core/platform/tstring.h"
@@ -129,8 +130,8 @@ absl::Status IteratorResource::GetNext(OpKernelContext* ctx,
   params.function_handle_cache = captured_state->function_handle_cache();
   params.resource_mgr = captured_state->resource_mgr();
   params.symbolic_checkpoint = SymbolicCheckpointEnabled(dataset->options());
-  params.thread_factory = unbounded_thread_pool_.get_thread_factory();
-  params.thread_pool = &unbounded_thread_pool_;
+  params.thread_factory = GetThreadPool(*captured_state)->get_thread_factory();
+  params.thread_pool = GetThreadPool(*captured_state);
   params.id_registry = captured_state->id_registry();
   params.warm_start = dataset->options().warm_start();
   params.model = captured_state->model();
@@ -249,6 +250,7 @@ absl::Status IteratorResource::Restore(OpKernelContext* ctx,
     iterator_state_->cancellation_manager()->StartCancel();
   }
   core::ScopedUnref scoped_unref(dataset);
+  new_state->MaybeCreateNumaThreadPool(ctx->env(), input_dataset->options());
   IteratorContext::Params params(ctx);
   params.cancellation_manager = new_state->cancellation_manager();
   params.flr = new_state->flr();
@@ -256,8 +258,8 @@ absl::Status IteratorResource::Restore(OpKernelContext* ctx,
   params.resource_mgr = new_state->resource_mgr();
   params.symbolic_checkpoint =
       SymbolicCheckpointEnabled(input_dataset->options());
-  params.thread_factory = unbounded_thread_pool_.get_thread_factory();
-  params.thread_pool = &unbounded_thread_pool_;
+  params.thread_factory = GetThreadPool(*new_state)->get_thread_factory();
+  params.thread_pool = GetThreadPool(*new_state);
   params.id_registry = new_state->id_registry();
   params.warm_start = dataset->options().warm_start();
   std::function<void()> deregister_fn;
@@ -275,6 +277,7 @@ absl::Status IteratorResource::Restore(OpKernelContext* ctx,
   new_state->MergeCheckpoint(iter_ctx.checkpoint());
   mutex_lock l(mu_);
   std::swap(iterator_state_, new_state);
+  ResetTfDatazMetricsCollector();
   return absl::OkStatus();
 }
 
@@ -290,14 +293,15 @@ absl::Status IteratorResource::SetIteratorFromDataset(
   }
 
   // Create new iterator.
+  new_state->MaybeCreateNumaThreadPool(ctx->env(), dataset->options());
   IteratorContext::Params params(ctx);
   params.cancellation_manager = new_state->cancellation_manager();
   params.flr = new_state->flr();
   params.function_handle_cache = new_state->function_handle_cache();
   params.resource_mgr = new_state->resource_mgr();
   params.symbolic_checkpoint = SymbolicCheckpointEnabled(dataset->options());
-  params.thread_factory = unbounded_thread_pool_.get_thread_factory();
-  params.thread_pool = &unbounded_thread_pool_;
+  params.thread_factory = GetThreadPool(*new_state)->get_thread_factory();
+  params.thread_pool = GetThreadPool(*new_state);
   params.id_registry = new_state->id_registry();
   params.warm_start = dataset->options().warm_start();
   std::function<void()> deregister_fn;
@@ -328,13 +332,23 @@ absl::Status IteratorResource::SetIteratorFromDataset(
   new_state->MergeCheckpoint(iter_ctx.checkpoint());
   mutex_lock l(mu_);
   std::swap(iterator_state_, new_state);
-  tf_dataz_metrics_collector_ = std::make_shared<TfDatazMetricsCollector>(
-      env_, iterator_state_->iterator(), iterator_state_->model());
+  ResetTfDatazMetricsCollector();
   EnsureIteratorMemoryLoggerStarted();
-  TfDatazMetricsRegistry::Register(tf_dataz_metrics_collector_);
   return absl::OkStatus();
 }
 
+void IteratorResource::ResetTfDatazMetricsCollector() {
+  // The previous collector refers to the iterator and thread pool of the
+  // replaced state, which are destroyed with it.
+  if (tf_dataz_metrics_collector_ != nullptr) {
+    TfDatazMetricsRegistry::Deregister(tf_dataz_metrics_collector_);
+  }
+  tf_dataz_metrics_collector_ = std::make_shared<TfDatazMetricsCollector>(
+      env_, iterator_state_->iterator(), iterator_state_->model(),
+      GetThreadPool(*iterator_state_));
+  TfDatazMetricsRegistry::Register(tf_dataz_metrics_collector_);
+}
+
 void IteratorResource::State::DowncastAndSetIteratorAndDataset(
     std::unique_ptr<IteratorBase> it, const DatasetBase* dataset) {
   iterator_.reset(static_cast<DatasetBaseIterator*>(it.release()));
@@ -344,6 +358,20 @@ void IteratorResource::State::DowncastAndSetIteratorAndDataset(
   }
 }
 
+void IteratorResource::State::MaybeCreateNumaThreadPool(
+    Env* env, const Options& options) {
+  if (options.threading_options().optional_numa_node_case() !=
+      ThreadingOptions::kNumaNode) {
+    return;
+  }
+  int numa_node = options.threading_options().numa_node();
+  if (numa_node == kNumaNodeOfCaller) {
+    numa_node = port::NUMAGetThreadNodeAffinity();
+  }
+  numa_thread_pool_ = UnboundedThreadPool::CreateNumaAware(
+      env, "tf_data_iterator_resource", numa_node);
+}
+
 void IteratorResource::State::MergeCheckpoint(MemoryCheckpoint* other) {
   if (SymbolicCheckpointEnabled(dataset_->options())) {
     checkpoint_.Merge(other);
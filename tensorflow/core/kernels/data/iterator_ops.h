@@ -118,6 +118,14 @@ class IteratorResource : public ResourceBase {
 
     DatasetBaseIterator* iterator() { return iterator_.get(); }
 
+    // Returns the NUMA-aware pool that runs the background threads of the
+    // iterator, or nullptr if the iterator uses the pool of the resource.
+    UnboundedThreadPool* numa_thread_pool() { return numa_thread_pool_.get(); }
+
+    // Creates a NUMA-aware pool for the iterator if `options` request NUMA
+    // affinity. Must be called before the iterator is created.
+    void MaybeCreateNumaThreadPool(Env* env, const Options& options);
+
     std::shared_ptr<model::Model> model() { return model_; }
 
     const MemoryCheckpoint& checkpoint() const { return checkpoint_; }
@@ -145,6 +153,8 @@ class IteratorResource : public ResourceBase {
     std::unique_ptr<FunctionHandleCache> function_handle_cache_;
     ResourceMgr resource_mgr_;
     CancellationManager cancellation_manager_;
+    // Must outlive `iterator_`, whose background threads it runs.
+    std::unique_ptr<UnboundedThreadPool> numa_thread_pool_;
     std::unique_ptr<DatasetBaseIterator> iterator_;
     core::RefCountPtr<DatasetBase> dataset_;
     std::shared_ptr<MemoryCheckpoint::IdRegistry> id_registry_;
@@ -152,6 +162,17 @@ class IteratorResource : public ResourceBase {
     std::shared_ptr<model::Model> model_;
   };
 
+  // Returns the pool that runs the background threads of the iterator whose
+  // state is `state`.
+  UnboundedThreadPool* GetThreadPool(State& state) {
+    return state.numa_thread_pool() != nullptr ? state.numa_thread_pool()
+                                               : &unbounded_thread_pool_;
+  }
+
+  // Replaces `tf_dataz_metrics_collector_` with a collector for the current
+  // iterator, and registers it in place of the previous one.
+  void ResetTfDatazMetricsCollector() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
   IteratorMetricsCollector metrics_collector_;
   std::shared_ptr<TfDatazMetricsCollector> tf_dataz_metrics_collector_;
   UnboundedThreadPool unbounded_thread_pool_;
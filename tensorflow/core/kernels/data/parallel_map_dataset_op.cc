@@ -129,6 +129,14 @@ class ParallelMapDatasetOp::Dataset : public DatasetBase {
     if (input_ != nullptr) {
       random_indexing_compatible_ = input_->RandomIndexingCompatible();
     }
+    const FunctionDef* fdef =
+        captured_func_->lib_def()->Find(captured_func_->func().name());
+    if (fdef != nullptr) {
+      auto attr = fdef->attr().find(kMapVectorizationAttr);
+      if (attr != fdef->attr().end()) {
+        map_vectorization_path_ = attr->second.s();
+      }
+    }
   }
 
   ~Dataset() override { input_->Unref(); }
@@ -558,6 +566,11 @@ class ParallelMapDatasetOp::Dataset : public DatasetBase {
         CallCompleted(ctx, result);
         return;
       }
+      if (!dataset()->map_vectorization_path_.empty() &&
+          !input_element.empty() && input_element[0].dims() > 0) {
+        metrics::RecordTFDataMapVectorization(
+            dataset()->map_vectorization_path_, input_element[0].dim_size(0));
+      }
 
       auto done = [this, ctx, result](absl::Status status) {
         if (!status.ok()) {
@@ -825,6 +838,10 @@ class ParallelMapDatasetOp::Dataset : public DatasetBase {
   const bool use_unbounded_threadpool_;
   const std::unique_ptr<CapturedFunction> captured_func_;
   const int op_version_;
+  // If the function was rewritten to process batches of elements, records
+  // whether all of its ops run on the whole batch ("vectorized") or some run
+  // once per element ("fallback").
+  std::string map_vectorization_path_;
   // This is used for random access provided by Get().
   mutable absl::once_flag instantiated_captured_func_once_;
   mutable absl::Status instantiated_captured_func_status_;
@@ -28,7 +28,9 @@ limitations under the License.
 #include "tensorflow/core/data/dataset_utils.h"
 #include "tensorflow/core/data/name_utils.h"
 #include "tensorflow/core/data/serialization_utils.h"
+#include "tensorflow/core/data/tiered_shuffle_buffer.h"
 #include "tensorflow/core/framework/dataset.h"
+#include "tensorflow/core/framework/dataset_options.pb.h"
 #include "tensorflow/core/framework/partial_tensor_shape.h"
 #include "tensorflow/core/framework/resource_mgr.h"
 #include "tensorflow/core/framework/tensor.h"
@@ -38,7 +40,9 @@ limitations under the License.
 #include "tensorflow/core/lib/random/random.h"
 #include "tensorflow/core/lib/random/random_distributions.h"
 #include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/mutex.h"
 #include "tensorflow/core/platform/stringprintf.h"
+#include "tensorflow/core/platform/thread_annotations.h"
 
 namespace tensorflow {
 namespace data {
@@ -75,12 +79,29 @@ constexpr char kSlicesEnd[] = "slices_end";
 constexpr char kSlicesReachedEndOfSequence[] = "slices_reached_end_of_sequence";
 constexpr char kSeedGenerator[] = "SeedGenerator";
 constexpr char kEpochNumRandomSamples[] = "epoch_num_random_samples";
+constexpr char kTieredBuffer[] = "tiered_buffer";
 constexpr char kShuffleDatasetV1[] = "ShuffleDataset";
 constexpr char kShuffleDatasetV2[] = "ShuffleDatasetV2";
 constexpr char kShuffleDatasetV3[] = "ShuffleDatasetV3";
 constexpr char kShuffleAndRepeatDatasetV1[] = "ShuffleAndRepeatDataset";
 constexpr char kShuffleAndRepeatDatasetV2[] = "ShuffleAndRepeatDatasetV2";
 
+// Releases a held mutex for the lifetime of the object and reacquires it on
+// destruction.
+class TF_SCOPED_LOCKABLE ScopedMutexRelease {
+ public:
+  explicit ScopedMutexRelease(mutex* mu) TF_UNLOCK_FUNCTION(mu) : mu_(mu) {
+    mu_->unlock();
+  }
+  ~ScopedMutexRelease() TF_EXCLUSIVE_LOCK_FUNCTION() { mu_->lock(); }
+
+  ScopedMutexRelease(const ScopedMutexRelease&) = delete;
+  ScopedMutexRelease& operator=(const ScopedMutexRelease&) = delete;
+
+ private:
+  mutex* const mu_;
+};
+
 ShuffleDatasetOpBase::ShuffleDatasetOpBase(OpKernelConstruction* ctx)
     : UnaryDatasetOpKernel(ctx) {}
 
@@ -191,14 +212,7 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
         : DatasetIterator<ShuffleDatasetBase>(params),
           seed_generator_(seed_generator),
           parent_generator_(seed_generator->seed(), seed_generator->seed2()),
-          generator_(&parent_generator_) {
-      if (params.dataset->buffer_size_ == kUnknownCardinality) {
-        buffer_ = std::make_unique<std::vector<std::vector<Tensor>>>();
-      } else {
-        buffer_ = std::make_unique<std::vector<std::vector<Tensor>>>(
-            params.dataset->buffer_size_);
-      }
-    }
+          generator_(&parent_generator_) {}
 
     bool SymbolicCheckpointCompatible() const override { return true; }
 
@@ -206,6 +220,23 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
       mutex_lock l(mu_);
       seed_generator_->GenerateSeeds(&seed_, &seed2_);
       ResetRngs();
+      if (ctx->options() != nullptr &&
+          !ctx->options()->shuffle_options().spill_directory().empty()) {
+        const ShuffleOptions& options = ctx->options()->shuffle_options();
+        tiered_buffer_ = std::make_unique<TieredShuffleBuffer>(
+            ctx->env(), options.spill_directory(),
+            options.memory_budget_bytes(), dataset()->output_dtypes(),
+            options.checkpoints_to_keep());
+        return absl::OkStatus();
+      }
+      // The in-memory buffer is allocated here rather than in the constructor
+      // so that large buffers are not allocated when they spill to disk.
+      if (IsShuffleAll()) {
+        buffer_ = std::make_unique<std::vector<std::vector<Tensor>>>();
+      } else {
+        buffer_ = std::make_unique<std::vector<std::vector<Tensor>>>(
+            dataset()->buffer_size_);
+      }
       // Initialize checkpoint_indices_ to the entire buffer.
       if (ctx->symbolic_checkpoint()) {
         for (int64_t i = 0; i < buffer_->size(); ++i) {
@@ -219,6 +250,9 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
                                  std::vector<Tensor>* out_tensors,
                                  bool* end_of_sequence) override {
       mutex_lock l(mu_);
+      if (tiered_buffer_) {
+        return GetNextFromTieredBuffer(ctx, out_tensors, end_of_sequence, l);
+      }
       TF_RETURN_IF_ERROR(FillBuffer(ctx));
       if (num_elements_ == 0) {
         DCHECK(input_impl_ == nullptr);
@@ -263,6 +297,7 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
     absl::Status SaveInternal(SerializationContext* ctx,
                               IteratorStateWriter* writer) override {
       mutex_lock l(mu_);
+      WaitForTieredBufferSpill(l);
       // Save state needed to restore the random number generators.
       TF_RETURN_IF_ERROR(
           writer->WriteScalar(prefix(), kEpochNumRandomSamples,
@@ -282,6 +317,17 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
 
       // Save the epoch counter, buffer, and buffer slices.
       TF_RETURN_IF_ERROR(writer->WriteScalar(prefix(), kEpoch, epoch_));
+      if (tiered_buffer_) {
+        // Only the in-memory window and references to the segment files are
+        // written; spilled elements stay in their segment files.
+        TF_RETURN_IF_ERROR(tiered_buffer_->Save(
+            writer, absl::StrCat(prefix(), kColon, kTieredBuffer)));
+        if (data_produced_) {
+          TF_RETURN_IF_ERROR(
+              writer->WriteScalar(this->prefix(), kDataProduced, ""));
+        }
+        return absl::OkStatus();
+      }
       TF_RETURN_IF_ERROR(
           writer->WriteScalar(prefix(), kNumElements, num_elements_));
       const std::string key_prefix = absl::StrCat(prefix(), kColon, "buffer");
@@ -323,6 +369,7 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
     absl::Status RestoreInternal(IteratorContext* ctx,
                                  IteratorStateReader* reader) override {
       mutex_lock l(mu_);
+      WaitForTieredBufferSpill(l);
       // Restore the random number generators.
       int64_t num_random_samples;
       TF_RETURN_IF_ERROR(reader->ReadScalar(prefix(), kEpochNumRandomSamples,
@@ -349,6 +396,12 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
 
       // Restore the epoch counter, buffer, and buffer slices.
       TF_RETURN_IF_ERROR(reader->ReadScalar(this->prefix(), kEpoch, &epoch_));
+      if (tiered_buffer_) {
+        TF_RETURN_IF_ERROR(tiered_buffer_->Restore(
+            ctx, reader, absl::StrCat(prefix(), kColon, kTieredBuffer)));
+        data_produced_ = reader->Contains(this->prefix(), kDataProduced);
+        return absl::OkStatus();
+      }
       TF_RETURN_IF_ERROR(
           reader->ReadScalar(this->prefix(), kNumElements, &num_elements_));
       size_t slices_size;
@@ -554,6 +607,109 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
       }
     }
 
+    // Produces the next element when the buffer spills to disk. The buffer
+    // holds elements of a single epoch at a time: the next epoch is started
+    // only once the current one has been drained.
+    absl::Status GetNextFromTieredBuffer(IteratorContext* ctx,
+                                         std::vector<Tensor>* out_tensors,
+                                         bool* end_of_sequence, mutex_lock& l)
+        TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      auto random = [this]() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+        return Random();
+      };
+      auto on_spill = [this, ctx](const std::vector<Tensor>& element) {
+        RecordBufferDequeue(ctx, element);
+      };
+      while (IsShuffleAll() ||
+             tiered_buffer_->size() < dataset()->buffer_size_) {
+        if (!input_impl_) {
+          if (tiered_buffer_->size() > 0 ||
+              (dataset()->count_ != -1 && epoch_ >= dataset()->count_)) {
+            break;
+          }
+          if (epoch_ > 0) {
+            if (ctx->split_providers().empty() && !data_produced_) {
+              // The previous epoch was empty, so repeating would loop forever.
+              break;
+            }
+            for (const auto& provider : ctx->split_providers()) {
+              TF_RETURN_IF_ERROR(provider->Reset());
+            }
+            num_random_samples_ = 0;
+            seed_generator_->GenerateSeeds(&seed_, &seed2_);
+            ResetRngs();
+          }
+          TF_RETURN_IF_ERROR(this->dataset()->input_->MakeIterator(
+              ctx, this, this->prefix(), &input_impl_));
+          epoch_++;
+        }
+        std::vector<Tensor> input_element;
+        bool end_of_input_sequence = false;
+        TF_RETURN_IF_ERROR(
+            input_impl_->GetNext(ctx, &input_element, &end_of_input_sequence));
+        if (end_of_input_sequence) {
+          input_impl_.reset();
+          continue;
+        }
+        data_produced_ = true;
+        RecordBufferEnqueue(ctx, input_element);
+        tiered_buffer_->AddToMemory(std::move(input_element));
+        TF_RETURN_IF_ERROR(MaybeSpillTieredBuffer(random, on_spill, l));
+      }
+      if (tiered_buffer_->size() == 0) {
+        *end_of_sequence = true;
+        return absl::OkStatus();
+      }
+      *end_of_sequence = false;
+      // All remaining elements may be in a segment another call is writing.
+      while (tiered_buffer_->num_available() == 0) {
+        spill_cond_var_.wait(l);
+      }
+      bool from_disk = false;
+      TF_RETURN_IF_ERROR(
+          tiered_buffer_->Remove(random, out_tensors, &from_disk));
+      if (!from_disk) {
+        RecordBufferDequeue(ctx, *out_tensors);
+      }
+      return absl::OkStatus();
+    }
+
+    // Spills the tiered buffer if its in-memory window exceeds the budget. The
+    // segment file is written without holding `mu_`, so that a large spill
+    // does not block concurrent calls that can be served from the buffer.
+    absl::Status MaybeSpillTieredBuffer(
+        const TieredShuffleBuffer::RandomFn& random,
+        const TieredShuffleBuffer::SpillFn& on_spill, mutex_lock& l)
+        TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      while (spill_in_progress_ && tiered_buffer_->NeedsSpill()) {
+        spill_cond_var_.wait(l);
+      }
+      if (!tiered_buffer_->NeedsSpill()) {
+        return absl::OkStatus();
+      }
+      TieredShuffleBuffer::PendingSpill spill =
+          tiered_buffer_->TakeSpill(random, on_spill);
+      spill_in_progress_ = true;
+      TieredShuffleBuffer* const buffer = tiered_buffer_.get();
+      absl::Status s;
+      {
+        ScopedMutexRelease release(&mu_);
+        s = buffer->WriteSpill(spill);
+      }
+      spill_in_progress_ = false;
+      spill_cond_var_.notify_all();
+      return tiered_buffer_->FinishSpill(std::move(spill), std::move(s));
+    }
+
+    // Waits until no segment of `tiered_buffer_` is being written, so that all
+    // buffered elements are accounted for in its state.
+    void WaitForTieredBufferSpill(mutex_lock& l)
+        TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      while (spill_in_progress_) {
+        spill_cond_var_.wait(l);
+      }
+    }
+
     std::string BufferSizeString() {
       return absl::StrCat(dataset()->buffer_size_);
     }
@@ -562,6 +718,11 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
     SeedGenerator* const seed_generator_ TF_GUARDED_BY(mu_);  // Not owned.
     std::unique_ptr<std::vector<std::vector<Tensor>>> buffer_
         TF_GUARDED_BY(mu_);
+    // Replaces `buffer_` when `ShuffleOptions.spill_directory` is set.
+    std::unique_ptr<TieredShuffleBuffer> tiered_buffer_ TF_GUARDED_BY(mu_);
+    // Whether a segment of `tiered_buffer_` is being written without `mu_`.
+    bool spill_in_progress_ TF_GUARDED_BY(mu_) = false;
+    condition_variable spill_cond_var_;
     // Holds the indices of `buffer_` that have changed since the previous
     // `SaveInternal()` and need to be updated in the MemoryCheckpoint
     // (if symbolic checkpointing is used) in the next `SaveInternal()`.
@@ -41,6 +41,8 @@ namespace data {
 /* static */ constexpr const char* const TFRecordDatasetOp::kCompressionType;
 /* static */ constexpr const char* const TFRecordDatasetOp::kBufferSize;
 /* static */ constexpr const char* const TFRecordDatasetOp::kByteOffsets;
+/* static */ constexpr const char* const
+    TFRecordDatasetOp::kAsyncReadQueueDepth;
 
 constexpr char kTFRecordDataset[] = "TFRecordDataset";
 constexpr char kCurrentFileIndex[] = "current_file_index";
@@ -64,7 +66,8 @@ class TFRecordDatasetOp::Dataset : public DatasetBase {
  public:
   explicit Dataset(OpKernelContext* ctx, std::vector<string> filenames,
                    const string& compression_type, int64_t buffer_size,
-                   std::vector<int64_t> byte_offsets, int op_version)
+                   std::vector<int64_t> byte_offsets,
+                   int async_read_queue_depth, int op_version)
       : DatasetBase(DatasetContext(ctx)),
         filenames_(std::move(filenames)),
         compression_type_(compression_type),
@@ -75,6 +78,7 @@ class TFRecordDatasetOp::Dataset : public DatasetBase {
     if (buffer_size > 0) {
       options_.buffer_size = buffer_size;
     }
+    options_.async_read_queue_depth = async_read_queue_depth;
   }
 
   std::unique_ptr<IteratorBase> MakeIteratorInternal(
@@ -119,10 +123,19 @@ class TFRecordDatasetOp::Dataset : public DatasetBase {
     TF_RETURN_IF_ERROR(b->AddScalar(compression_type_, &compression_type));
     Node* buffer_size = nullptr;
     TF_RETURN_IF_ERROR(b->AddScalar(options_.buffer_size, &buffer_size));
-    TF_RETURN_IF_ERROR(b->AddDataset(
-        this, {filenames, compression_type, buffer_size}, output));
+    if (op_version_ == 1) {
+      return b->AddDataset(this, {filenames, compression_type, buffer_size},
+                           output);
+    }
     Node* byte_offsets = nullptr;
     TF_RETURN_IF_ERROR(b->AddVector(byte_offsets_, &byte_offsets));
+    AttrValue async_read_queue_depth;
+    b->BuildAttrValue(options_.async_read_queue_depth,
+                      &async_read_queue_depth);
+    TF_RETURN_IF_ERROR(b->AddDataset(
+        this, {filenames, compression_type, buffer_size, byte_offsets},
+        {std::make_pair(kAsyncReadQueueDepth, async_read_queue_depth)},
+        output));
     return absl::OkStatus();
   }
 
@@ -312,7 +325,16 @@ class TFRecordDatasetOp::Dataset : public DatasetBase {
 
 TFRecordDatasetOp::TFRecordDatasetOp(OpKernelConstruction* ctx)
     : DatasetOpKernel(ctx),
-      op_version_(ctx->def().op() == kTFRecordDataset ? 1 : 2) {}
+      op_version_(ctx->def().op() == kTFRecordDataset ? 1 : 2) {
+  if (ctx->HasAttr(kAsyncReadQueueDepth)) {
+    OP_REQUIRES_OK(
+        ctx, ctx->GetAttr(kAsyncReadQueueDepth, &async_read_queue_depth_));
+    OP_REQUIRES(ctx, async_read_queue_depth_ >= 0,
+                errors::InvalidArgument(
+                    "`async_read_queue_depth` must be >= 0 (0 == synchronous "
+                    "reads)"));
+  }
+}
 
 void TFRecordDatasetOp::MakeDataset(OpKernelContext* ctx,
                                     DatasetBase** output) {
@@ -391,7 +413,8 @@ void TFRecordDatasetOp::MakeDataset(OpKernelContext* ctx,
   }
 
   *output = new Dataset(ctx, std::move(filenames), compression_type,
-                        buffer_size, std::move(byte_offsets), op_version_);
+                        buffer_size, std::move(byte_offsets),
+                        async_read_queue_depth_, op_version_);
 }
 
 namespace {
@@ -27,6 +27,8 @@ class TFRecordDatasetOp : public DatasetOpKernel {
   static constexpr const char* const kCompressionType = "compression_type";
   static constexpr const char* const kBufferSize = "buffer_size";
   static constexpr const char* const kByteOffsets = "byte_offsets";
+  static constexpr const char* const kAsyncReadQueueDepth =
+      "async_read_queue_depth";
 
   explicit TFRecordDatasetOp(OpKernelConstruction* ctx);
 
@@ -36,6 +38,7 @@ class TFRecordDatasetOp : public DatasetOpKernel {
  private:
   class Dataset;
   int op_version_;
+  int async_read_queue_depth_ = 0;
 };
 
 }  // namespace data
@@ -65,13 +65,15 @@ class TFRecordDatasetParams : public DatasetParams {
  public:
   TFRecordDatasetParams(std::vector<tstring> filenames,
                         CompressionType compression_type, int64_t buffer_size,
-                        std::vector<int64_t> byte_offsets, string node_name)
+                        std::vector<int64_t> byte_offsets, string node_name,
+                        int async_read_queue_depth = 0)
       : DatasetParams({DT_STRING}, {PartialTensorShape({})},
                       std::move(node_name)),
         filenames_(std::move(filenames)),
         compression_type_(compression_type),
         buffer_size_(buffer_size),
-        byte_offsets_(std::move(byte_offsets)) {
+        byte_offsets_(std::move(byte_offsets)),
+        async_read_queue_depth_(async_read_queue_depth) {
     op_version_ = 2;
   }
 
@@ -99,6 +101,8 @@ class TFRecordDatasetParams : public DatasetParams {
   absl::Status GetAttributes(AttributeVector* attr_vector) const override {
     attr_vector->clear();
     attr_vector->emplace_back("metadata", "");
+    attr_vector->emplace_back(TFRecordDatasetOp::kAsyncReadQueueDepth,
+                              async_read_queue_depth_);
     return absl::OkStatus();
   }
 
@@ -111,6 +115,7 @@ class TFRecordDatasetParams : public DatasetParams {
   CompressionType compression_type_;
   int64_t buffer_size_;
   std::vector<int64_t> byte_offsets_;
+  int async_read_queue_depth_;
 };
 
 class TFRecordDatasetOpTest : public DatasetOpsTestBase {};
@@ -227,6 +232,24 @@ TFRecordDatasetParams InvalidByteOffsets() {
                                /*node_name=*/kNodeName);
 }
 
+// Test case 6: multiple files read with asynchronous reads.
+TFRecordDatasetParams AsyncReadParams(CompressionType compression_type) {
+  std::vector<tstring> filenames = {
+      absl::StrCat(testing::TmpDir(), "/tf_record_ASYNC_1"),
+      absl::StrCat(testing::TmpDir(), "/tf_record_ASYNC_2")};
+  std::vector<std::vector<string>> contents = {{"1", "22", "333"},
+                                               {"a", "bb", "ccc"}};
+  absl::Status status = CreateTestFiles(filenames, contents, compression_type);
+  TF_CHECK_OK(status) << "Failed to create the test files: "
+                      << absl::StrJoin(filenames, ", ") << ": " << status;
+  return TFRecordDatasetParams(filenames,
+                               /*compression_type=*/compression_type,
+                               /*buffer_size=*/10,
+                               /*byte_offsets=*/{},
+                               /*node_name=*/kNodeName,
+                               /*async_read_queue_depth=*/4);
+}
+
 std::vector<GetNextTestCase<TFRecordDatasetParams>> GetNextTestCases() {
   return {
       {/*dataset_params=*/TFRecordDatasetParams1(),
@@ -242,7 +265,13 @@ std::vector<GetNextTestCase<TFRecordDatasetParams>> GetNextTestCases() {
       {/*dataset_params=*/TFRecordDatasetParams4(),
        CreateTensors<tstring>(
            TensorShape({}),
-           {{"1"}, {"22"}, {"333"}, {"bb"}, {"ccc"}, {"zzz"}})}};
+           {{"1"}, {"22"}, {"333"}, {"bb"}, {"ccc"}, {"zzz"}})},
+      {/*dataset_params=*/AsyncReadParams(CompressionType::UNCOMPRESSED),
+       CreateTensors<tstring>(
+           TensorShape({}), {{"1"}, {"22"}, {"333"}, {"a"}, {"bb"}, {"ccc"}})},
+      {/*dataset_params=*/AsyncReadParams(CompressionType::GZIP),
+       CreateTensors<tstring>(
+           TensorShape({}), {{"1"}, {"22"}, {"333"}, {"a"}, {"bb"}, {"ccc"}})}};
 }
 
 ITERATOR_GET_NEXT_TEST_P(TFRecordDatasetOpTest, TFRecordDatasetParams,
@@ -280,7 +309,12 @@ std::vector<SkipTestCase<TFRecordDatasetParams>> SkipTestCases() {
            /*expected_outputs=*/
            CreateTensors<tstring>(TensorShape({}), {{"bb"}})},
           {/*dataset_params=*/TFRecordDatasetParams3(),
-           /*num_to_skip*/ 7, /*expected_num_skipped*/ 6}};
+           /*num_to_skip*/ 7, /*expected_num_skipped*/ 6},
+
+          {/*dataset_params=*/AsyncReadParams(CompressionType::UNCOMPRESSED),
+           /*num_to_skip*/ 4, /*expected_num_skipped*/ 4, /*get_next*/ true,
+           /*expected_outputs=*/
+           CreateTensors<tstring>(TensorShape({}), {{"bb"}})}};
 }
 
 ITERATOR_SKIP_TEST_P(TFRecordDatasetOpTest, TFRecordDatasetParams,
@@ -365,6 +399,10 @@ IteratorSaveAndRestoreTestCases() {
        CreateTensors<tstring>(
            TensorShape({}), {{"1"}, {"22"}, {"333"}, {"a"}, {"bb"}, {"ccc"}})},
       {/*dataset_params=*/TFRecordDatasetParams3(),
+       /*breakpoints=*/{0, 2, 7},
+       CreateTensors<tstring>(
+           TensorShape({}), {{"1"}, {"22"}, {"333"}, {"a"}, {"bb"}, {"ccc"}})},
+      {/*dataset_params=*/AsyncReadParams(CompressionType::UNCOMPRESSED),
        /*breakpoints=*/{0, 2, 7},
        CreateTensors<tstring>(
            TensorShape({}), {{"1"}, {"22"}, {"333"}, {"a"}, {"bb"}, {"ccc"}})}};
@@ -15,16 +15,25 @@ limitations under the License.
 
 // Tests kernels of lookup ops.
 
+#include <cstdint>
+#include <memory>
+
 #include "tensorflow/core/framework/fake_input.h"
 #include "tensorflow/core/framework/lookup_interface.h"
 #include "tensorflow/core/framework/node_def_builder.h"
 #include "tensorflow/core/framework/op.h"
+#include "tensorflow/core/framework/resource_mgr.h"
 #include "tensorflow/core/framework/shape_inference_testutil.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
 #include "tensorflow/core/framework/types.h"
 #include "tensorflow/core/kernels/lookup_table_op.h"
 #include "tensorflow/core/kernels/ops_testutil.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/core/threadpool.h"
+#include "tensorflow/core/platform/blocking_counter.h"
+#include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
 
 namespace tensorflow {
 namespace {
@@ -64,6 +73,8 @@ REGISTER_KERNEL_BUILDER(
 
 class LookupOpsTest : public OpsTestBase {};
 
+using ShardedTable = lookup::ShardedMutableHashTableOfScalars<int64_t, float>;
+
 TEST_F(LookupOpsTest, AnonymousHashTable_RefCounting) {
   TF_ASSERT_OK(
       NodeDefBuilder("mock_anonymous_hash_table", "MockAnonymousHashTable")
@@ -100,5 +111,234 @@ TEST_F(LookupOpsTest, AnonymousHashTable_RefCounting) {
   EXPECT_FALSE(alive);
 }
 
+TEST_F(LookupOpsTest, MutableHashTableV2_NumShards) {
+  TF_ASSERT_OK(NodeDefBuilder("sharded_table", "MutableHashTableV2")
+                   .Attr("key_dtype", DT_INT64)
+                   .Attr("value_dtype", DT_FLOAT)
+                   .Attr("num_shards", 8)
+                   .Finalize(node_def()));
+  TF_ASSERT_OK(InitOp());
+  TF_ASSERT_OK(RunOpKernel());
+
+  lookup::LookupInterface* table = nullptr;
+  TF_ASSERT_OK(LookupResource(
+      context_.get(), GetOutput(0)->scalar<ResourceHandle>()(), &table));
+  core::ScopedUnref unref(table);
+  auto* sharded = dynamic_cast<ShardedTable*>(table);
+  ASSERT_NE(sharded, nullptr);
+  EXPECT_EQ(sharded->num_shards(), 8);
+}
+
+TEST_F(LookupOpsTest, MutableHashTableV2_NoShards) {
+  TF_ASSERT_OK(NodeDefBuilder("table", "MutableHashTableV2")
+                   .Attr("key_dtype", DT_INT64)
+                   .Attr("value_dtype", DT_FLOAT)
+                   .Finalize(node_def()));
+  TF_ASSERT_OK(InitOp());
+  TF_ASSERT_OK(RunOpKernel());
+
+  lookup::LookupInterface* table = nullptr;
+  TF_ASSERT_OK(LookupResource(
+      context_.get(), GetOutput(0)->scalar<ResourceHandle>()(), &table));
+  core::ScopedUnref unref(table);
+  EXPECT_EQ(dynamic_cast<ShardedTable*>(table), nullptr);
+}
+
+TEST_F(LookupOpsTest, MutableHashTableOfTensorsV2_NumShards) {
+  TF_ASSERT_OK(NodeDefBuilder("sharded_table", "MutableHashTableOfTensorsV2")
+                   .Attr("key_dtype", DT_INT64)
+                   .Attr("value_dtype", DT_FLOAT)
+                   .Attr("value_shape", TensorShape({2}))
+                   .Attr("num_shards", 4)
+                   .Finalize(node_def()));
+  TF_ASSERT_OK(InitOp());
+  TF_ASSERT_OK(RunOpKernel());
+
+  lookup::LookupInterface* table = nullptr;
+  TF_ASSERT_OK(LookupResource(
+      context_.get(), GetOutput(0)->scalar<ResourceHandle>()(), &table));
+  core::ScopedUnref unref(table);
+  auto* sharded = dynamic_cast<
+      lookup::ShardedMutableHashTableOfTensors<int64_t, float>*>(table);
+  ASSERT_NE(sharded, nullptr);
+  EXPECT_EQ(sharded->num_shards(), 4);
+  EXPECT_EQ(table->value_shape(), TensorShape({2}));
+
+  TF_ASSERT_OK(table->Insert(
+      nullptr, test::AsTensor<int64_t>({1, 2, 1000}),
+      test::AsTensor<float>({1, 10, 2, 20, 3, 30}, TensorShape({3, 2}))));
+  EXPECT_EQ(table->size(), 3);
+  TF_ASSERT_OK(table->Remove(nullptr, test::AsTensor<int64_t>({2})));
+  EXPECT_EQ(table->size(), 2);
+
+  Tensor found(DT_FLOAT, TensorShape({3, 2}));
+  TF_ASSERT_OK(table->Find(nullptr, test::AsTensor<int64_t>({1000, 2, 1}),
+                           &found, test::AsTensor<float>({-1, -2})));
+  test::ExpectTensorEqual<float>(
+      found,
+      test::AsTensor<float>({3, 30, -1, -2, 1, 10}, TensorShape({3, 2})));
+}
+
+TEST(ShardedMutableHashTableTest, InsertFindRemove) {
+  core::RefCountPtr<ShardedTable> table(
+      new ShardedTable(nullptr, nullptr, /*num_shards=*/4));
+  Tensor keys = test::AsTensor<int64_t>({1, 2, 3, 1000});
+  Tensor values = test::AsTensor<float>({1.0f, 2.0f, 3.0f, 4.0f});
+  TF_ASSERT_OK(table->Insert(nullptr, keys, values));
+  EXPECT_EQ(table->size(), 4);
+
+  Tensor lookup_keys = test::AsTensor<int64_t>({1, 5, 1000, 3});
+  Tensor found(DT_FLOAT, TensorShape({4}));
+  Tensor default_value = test::AsScalar<float>(-1.0f);
+  TF_ASSERT_OK(table->Find(nullptr, lookup_keys, &found, default_value));
+  test::ExpectTensorEqual<float>(
+      found, test::AsTensor<float>({1.0f, -1.0f, 4.0f, 3.0f}));
+
+  // Inserting an existing key updates its value.
+  TF_ASSERT_OK(table->Insert(nullptr, test::AsTensor<int64_t>({3}),
+                             test::AsTensor<float>({30.0f})));
+  EXPECT_EQ(table->size(), 4);
+
+  TF_ASSERT_OK(table->Remove(nullptr, test::AsTensor<int64_t>({1, 5})));
+  EXPECT_EQ(table->size(), 3);
+  TF_ASSERT_OK(table->Find(nullptr, lookup_keys, &found, default_value));
+  test::ExpectTensorEqual<float>(
+      found, test::AsTensor<float>({-1.0f, -1.0f, 4.0f, 30.0f}));
+}
+
+TEST(ShardedMutableHashTableTest, ImportReplacesContents) {
+  core::RefCountPtr<ShardedTable> table(
+      new ShardedTable(nullptr, nullptr, /*num_shards=*/3));
+  TF_ASSERT_OK(table->Insert(nullptr, test::AsTensor<int64_t>({7, 8}),
+                             test::AsTensor<float>({7.0f, 8.0f})));
+  TF_ASSERT_OK(
+      table->ImportValues(nullptr, test::AsTensor<int64_t>({8, 9, 10}),
+                          test::AsTensor<float>({80.0f, 90.0f, 100.0f})));
+  EXPECT_EQ(table->size(), 3);
+
+  Tensor found(DT_FLOAT, TensorShape({4}));
+  TF_ASSERT_OK(table->Find(nullptr, test::AsTensor<int64_t>({7, 8, 9, 10}),
+                           &found, test::AsTensor<float>({0, 0, 0, 0})));
+  test::ExpectTensorEqual<float>(
+      found, test::AsTensor<float>({0.0f, 80.0f, 90.0f, 100.0f}));
+}
+
+TEST(ShardedMutableHashTableTest, ConcurrentInsertAndFind) {
+  constexpr int kThreads = 8;
+  constexpr int kKeysPerThread = 1000;
+  core::RefCountPtr<ShardedTable> table(
+      new ShardedTable(nullptr, nullptr, /*num_shards=*/16));
+  {
+    thread::ThreadPool pool(Env::Default(), "sharded_table", kThreads);
+    for (int t = 0; t < kThreads; ++t) {
+      pool.Schedule([&table, t]() {
+        Tensor keys(DT_INT64, TensorShape({kKeysPerThread}));
+        Tensor values(DT_FLOAT, TensorShape({kKeysPerThread}));
+        for (int i = 0; i < kKeysPerThread; ++i) {
+          keys.flat<int64_t>()(i) = t * kKeysPerThread + i;
+          values.flat<float>()(i) = t;
+        }
+        TF_CHECK_OK(table->Insert(nullptr, keys, values));
+        Tensor found(DT_FLOAT, TensorShape({kKeysPerThread}));
+        TF_CHECK_OK(table->Find(nullptr, keys, &found,
+                                test::AsScalar<float>(-1.0f)));
+        test::ExpectTensorEqual<float>(found, values);
+      });
+    }
+  }
+  EXPECT_EQ(table->size(), kThreads * kKeysPerThread);
+}
+
+// Creates the table of int64 ids and float embeddings of a MutableHashTableV2
+// op with `num_shards`. With 0 shards, the op creates the unsharded
+// MutableHashTableOfScalars, which is only reachable through the op.
+class MutableHashTableFactory : public OpsTestBase {
+ public:
+  lookup::LookupInterface* Create(int num_shards) {
+    TF_CHECK_OK(NodeDefBuilder("table", "MutableHashTableV2")
+                    .Attr("key_dtype", DT_INT64)
+                    .Attr("value_dtype", DT_FLOAT)
+                    .Attr("num_shards", num_shards)
+                    .Finalize(node_def()));
+    TF_CHECK_OK(InitOp());
+    TF_CHECK_OK(RunOpKernel());
+    lookup::LookupInterface* table = nullptr;
+    TF_CHECK_OK(LookupResource(
+        context_.get(), GetOutput(0)->scalar<ResourceHandle>()(), &table));
+    return table;
+  }
+
+ private:
+  void TestBody() override {}
+};
+
+// Looks up batches of embedding ids from `num_threads` threads, each thread
+// inserting one id for every 16 it looks up. Compares the unsharded
+// MutableHashTableOfScalars (0 shards), a table with a single shard, i.e. a
+// single lock, and one with 64 shards.
+void BM_MutableHashTableLookups(::testing::benchmark::State& state) {
+  const int num_threads = state.range(0);
+  const int num_shards = state.range(1);
+  constexpr int kNumIds = 1 << 16;
+  constexpr int kBatchSize = 256;
+  constexpr int kBatchesPerThread = 64;
+
+  MutableHashTableFactory factory;
+  core::RefCountPtr<lookup::LookupInterface> table(factory.Create(num_shards));
+  Tensor ids(DT_INT64, TensorShape({kNumIds}));
+  Tensor embeddings(DT_FLOAT, TensorShape({kNumIds}));
+  for (int i = 0; i < kNumIds; ++i) {
+    ids.flat<int64_t>()(i) = (static_cast<int64_t>(i) << 20) + i;
+    embeddings.flat<float>()(i) = i;
+  }
+  TF_CHECK_OK(table->Insert(nullptr, ids, embeddings));
+  const Tensor default_value = test::AsScalar<float>(0.0f);
+
+  thread::ThreadPool pool(Env::Default(), "lookups", num_threads);
+  for (auto s : state) {
+    BlockingCounter done(num_threads);
+    for (int t = 0; t < num_threads; ++t) {
+      pool.Schedule([&, t]() {
+        Tensor found(DT_FLOAT, TensorShape({kBatchSize}));
+        for (int b = 0; b < kBatchesPerThread; ++b) {
+          const int64_t start =
+              ((t * kBatchesPerThread + b) * kBatchSize) % kNumIds;
+          const Tensor batch = ids.Slice(start, start + kBatchSize);
+          TF_CHECK_OK(table->Find(nullptr, batch, &found, default_value));
+          const int64_t update = start + b % 16;
+          TF_CHECK_OK(table->Insert(nullptr, ids.Slice(update, update + 1),
+                                    embeddings.Slice(update, update + 1)));
+        }
+        done.DecrementCount();
+      });
+    }
+    done.Wait();
+  }
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) *
+                          num_threads * kBatchesPerThread * kBatchSize);
+}
+BENCHMARK(BM_MutableHashTableLookups)
+    ->ArgPair(1, 0)
+    ->ArgPair(1, 1)
+    ->ArgPair(1, 64)
+    ->ArgPair(2, 0)
+    ->ArgPair(2, 1)
+    ->ArgPair(2, 64)
+    ->ArgPair(4, 0)
+    ->ArgPair(4, 1)
+    ->ArgPair(4, 64)
+    ->ArgPair(8, 0)
+    ->ArgPair(8, 1)
+    ->ArgPair(8, 64)
+    ->ArgPair(16, 0)
+    ->ArgPair(16, 1)
+    ->ArgPair(16, 64)
+    ->ArgPair(32, 0)
+    ->ArgPair(32, 1)
+    ->ArgPair(32, 64)
+    ->ArgPair(64, 0)
+    ->ArgPair(64, 1)
+    ->ArgPair(64, 64);
+
 }  // namespace
 }  // namespace tensorflow
@@ -212,6 +212,21 @@ class MutableHashTableOfScalars final : public LookupInterface {
   std::unordered_map<K, V> table_ TF_GUARDED_BY(mu_);
 };
 
+// MutableHashTableV2 ops with a positive `num_shards` attr get a
+// ShardedMutableHashTableOfScalars instead.
+template <class K, class V>
+struct TableFactory<MutableHashTableOfScalars<K, V>> {
+  static LookupInterface* New(OpKernelContext* ctx, OpKernel* kernel) {
+    int64_t num_shards = 0;
+    if (TryGetNodeAttr(kernel->def(), "num_shards", &num_shards) &&
+        num_shards > 0) {
+      return new ShardedMutableHashTableOfScalars<K, V>(ctx, kernel,
+                                                        num_shards);
+    }
+    return new MutableHashTableOfScalars<K, V>(ctx, kernel);
+  }
+};
+
 // Lookup table that wraps an unordered_map. Behaves identical to
 // MutableHashTableOfScalars except that each value must be a vector.
 template <class K, class V>
@@ -408,6 +423,21 @@ class MutableHashTableOfTensors final : public LookupInterface {
   std::unordered_map<K, ValueArray> table_ TF_GUARDED_BY(mu_);
 };
 
+// MutableHashTableOfTensorsV2 ops with a positive `num_shards` attr get a
+// ShardedMutableHashTableOfTensors instead.
+template <class K, class V>
+struct TableFactory<MutableHashTableOfTensors<K, V>> {
+  static LookupInterface* New(OpKernelContext* ctx, OpKernel* kernel) {
+    int64_t num_shards = 0;
+    if (TryGetNodeAttr(kernel->def(), "num_shards", &num_shards) &&
+        num_shards > 0) {
+      return new ShardedMutableHashTableOfTensors<K, V>(ctx, kernel,
+                                                        num_shards);
+    }
+    return new MutableHashTableOfTensors<K, V>(ctx, kernel);
+  }
+};
+
 namespace {
 
 template <typename T>
@@ -16,7 +16,13 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_KERNELS_LOOKUP_TABLE_OP_H_
 #define TENSORFLOW_CORE_KERNELS_LOOKUP_TABLE_OP_H_
 
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
 #include "absl/container/flat_hash_map.h"
+#include "absl/hash/hash.h"
 #include "tensorflow/core/framework/bounds_check.h"
 #include "tensorflow/core/framework/lookup_interface.h"
 #include "tensorflow/core/framework/op_kernel.h"
@@ -27,13 +33,29 @@ limitations under the License.
 #include "tensorflow/core/kernels/lookup_util.h"
 #include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/lib/gtl/inlined_vector.h"
 #include "tensorflow/core/lib/gtl/map_util.h"
 #include "tensorflow/core/platform/errors.h"
 #include "tensorflow/core/platform/macros.h"
+#include "tensorflow/core/platform/mutex.h"
 #include "tensorflow/core/platform/thread_annotations.h"
 
 namespace tensorflow {
 
+namespace lookup {
+
+// Creates the table resource of a LookupTableOp or AnonymousLookupTableOp.
+// Containers whose implementation depends on the attrs of the op specialize
+// this.
+template <class Container>
+struct TableFactory {
+  static LookupInterface* New(OpKernelContext* ctx, OpKernel* kernel) {
+    return new Container(ctx, kernel);
+  }
+};
+
+}  // namespace lookup
+
 // Lookup table op that supports different table implementations specified by
 // the 'Container' template. Container must be derived from LookupInterface. The
 // key and value are of the templated type "key_dtype" and "value_dtype"
@@ -69,7 +91,8 @@ class LookupTableOp : public OpKernel {
     auto creator =
         [ctx, this](lookup::LookupInterface** ret)
             TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
-              lookup::LookupInterface* container = new Container(ctx, this);
+              lookup::LookupInterface* container =
+                  lookup::TableFactory<Container>::New(ctx, this);
               if (!ctx->status().ok()) {
                 container->Unref();
                 return ctx->status();
@@ -145,7 +168,8 @@ class AnonymousLookupTableOp : public OpKernel {
   explicit AnonymousLookupTableOp(OpKernelConstruction* ctx) : OpKernel(ctx) {}
 
   void Compute(OpKernelContext* ctx) override {
-    lookup::LookupInterface* table = new Container(ctx, this);
+    lookup::LookupInterface* table =
+        lookup::TableFactory<Container>::New(ctx, this);
     if (!ctx->status().ok()) {
       table->Unref();
       return;
@@ -345,6 +369,508 @@ class HashTable : public InitializableLookupTable {
   absl::flat_hash_map<K, V> table_;
 };
 
+// The shards of a mutable lookup table whose keys are striped by hash across
+// `num_shards` flat_hash_maps, each behind its own lock. Concurrent calls only
+// contend for the shards of the keys they touch, and probing a flat_hash_map
+// matches the tags of a group of buckets at once instead of chasing list
+// nodes. The tables group the keys of a call by shard, so that each call locks
+// each of its shards once, and lock all shards in index order for operations
+// on the whole table.
+template <class K, class Value>
+class HashTableShards {
+ public:
+  // Aligned to a cache line, so that threads locking different shards do not
+  // contend for the same line.
+  struct alignas(64) Shard {
+    mutable mutex mu;
+    absl::flat_hash_map<K, Value> table TF_GUARDED_BY(mu);
+  };
+
+  // The indices of the keys of a call, grouped by shard: the keys of shard
+  // `s` are at `indices[offsets[s]]` to `indices[offsets[s + 1] - 1]`, in the
+  // order of the call.
+  struct KeysByShard {
+    std::vector<int64_t> indices;
+    std::vector<int64_t> offsets;
+
+    bool empty(int64_t s) const { return offsets[s] == offsets[s + 1]; }
+  };
+
+  explicit HashTableShards(int64_t num_shards)
+      : num_shards_(num_shards > 0 ? num_shards : 1),
+        shards_(std::make_unique<Shard[]>(num_shards_)) {}
+
+  int64_t num_shards() const { return num_shards_; }
+
+  Shard& shard(int64_t s) const { return shards_[s]; }
+
+  Shard& ShardOf(const K& key) const { return shards_[ShardIndex(key)]; }
+
+  // Returns the number of keys, locking one shard at a time.
+  size_t size() const {
+    size_t size = 0;
+    for (int64_t i = 0; i < num_shards_; ++i) {
+      tf_shared_lock l(shards_[i].mu);
+      size += shards_[i].table.size();
+    }
+    return size;
+  }
+
+  // Groups the keys of a call by shard with a counting sort.
+  KeysByShard GroupByShard(typename TTypes<K>::ConstFlat key_values) const {
+    const int64_t num_keys = key_values.size();
+    KeysByShard groups;
+    groups.indices.resize(num_keys);
+    groups.offsets.assign(num_shards_ + 1, 0);
+    std::vector<int64_t> shard_of_key(num_keys);
+    for (int64_t i = 0; i < num_keys; ++i) {
+      shard_of_key[i] = ShardIndex(SubtleMustCopyIfIntegral(key_values(i)));
+      ++groups.offsets[shard_of_key[i] + 1];
+    }
+    for (int64_t s = 0; s < num_shards_; ++s) {
+      groups.offsets[s + 1] += groups.offsets[s];
+    }
+    std::vector<int64_t> next(groups.offsets.begin(),
+                              groups.offsets.end() - 1);
+    for (int64_t i = 0; i < num_keys; ++i) {
+      groups.indices[next[shard_of_key[i]]++] = i;
+    }
+    return groups;
+  }
+
+  // Removes the keys of a call, if present.
+  void Remove(typename TTypes<K>::ConstFlat key_values) {
+    const KeysByShard groups = GroupByShard(key_values);
+    for (int64_t s = 0; s < num_shards_; ++s) {
+      if (groups.empty(s)) continue;
+      Shard& shard = shards_[s];
+      mutex_lock l(shard.mu);
+      for (int64_t j = groups.offsets[s]; j < groups.offsets[s + 1]; ++j) {
+        const int64_t i = groups.indices[j];
+        shard.table.erase(SubtleMustCopyIfIntegral(key_values(i)));
+      }
+    }
+  }
+
+  void LockAll() const TF_NO_THREAD_SAFETY_ANALYSIS {
+    for (int64_t i = 0; i < num_shards_; ++i) shards_[i].mu.lock();
+  }
+  void UnlockAll() const TF_NO_THREAD_SAFETY_ANALYSIS {
+    for (int64_t i = 0; i < num_shards_; ++i) shards_[i].mu.unlock();
+  }
+  void LockAllShared() const TF_NO_THREAD_SAFETY_ANALYSIS {
+    for (int64_t i = 0; i < num_shards_; ++i) shards_[i].mu.lock_shared();
+  }
+  void UnlockAllShared() const TF_NO_THREAD_SAFETY_ANALYSIS {
+    for (int64_t i = 0; i < num_shards_; ++i) shards_[i].mu.unlock_shared();
+  }
+
+  // REQUIRES: The locks of all shards are held.
+  int64_t SizeLocked() const TF_NO_THREAD_SAFETY_ANALYSIS {
+    int64_t size = 0;
+    for (int64_t i = 0; i < num_shards_; ++i) {
+      size += shards_[i].table.size();
+    }
+    return size;
+  }
+
+  // Returns the memory used by the shards, given the bytes of a bucket beyond
+  // its key and one-byte tag.
+  int64_t MemoryUsed(size_t value_bytes) const {
+    int64_t ret = num_shards_ * sizeof(Shard);
+    for (int64_t i = 0; i < num_shards_; ++i) {
+      tf_shared_lock l(shards_[i].mu);
+      ret += shards_[i].table.capacity() * (sizeof(K) + value_bytes + 1);
+    }
+    return ret;
+  }
+
+ private:
+  // Returns the index of the shard of `key`. The shard is picked from the
+  // high bits of the hash, since the flat_hash_map of the shard uses the low
+  // ones.
+  int64_t ShardIndex(const K& key) const {
+    const uint64_t hash = absl::Hash<K>()(key);
+    return (hash >> 32) % num_shards_;
+  }
+
+  const int64_t num_shards_;
+  const std::unique_ptr<Shard[]> shards_;
+};
+
+// Mutable lookup table whose keys are striped across HashTableShards. Behaves
+// like the MutableHashTableOfScalars of MutableHashTableV2 ops without a
+// `num_shards` attr.
+//
+// This table is mutable and thread safe.
+template <class K, class V>
+class ShardedMutableHashTableOfScalars final : public LookupInterface {
+ public:
+  ShardedMutableHashTableOfScalars(OpKernelContext* ctx, OpKernel* kernel,
+                                   int64_t num_shards)
+      : shards_(num_shards) {}
+
+  size_t size() const override { return shards_.size(); }
+
+  absl::Status Find(OpKernelContext* ctx, const Tensor& key, Tensor* value,
+                    const Tensor& default_value) override {
+    const auto key_values = key.flat<K>();
+    auto value_values = value->flat<V>();
+    const auto default_flat = default_value.flat<V>();
+    const bool is_full_size_default =
+        (value_values.size() == default_flat.size());
+
+    const auto groups = shards_.GroupByShard(key_values);
+    for (int64_t s = 0; s < shards_.num_shards(); ++s) {
+      if (groups.empty(s)) continue;
+      const auto& shard = shards_.shard(s);
+      tf_shared_lock l(shard.mu);
+      for (int64_t j = groups.offsets[s]; j < groups.offsets[s + 1]; ++j) {
+        const int64_t i = groups.indices[j];
+        value_values(i) = gtl::FindWithDefault(
+            shard.table, SubtleMustCopyIfIntegral(key_values(i)),
+            is_full_size_default ? default_flat(i) : default_flat(0));
+      }
+    }
+    return absl::OkStatus();
+  }
+
+  absl::Status Insert(OpKernelContext* ctx, const Tensor& keys,
+                      const Tensor& values) override {
+    const auto key_values = keys.flat<K>();
+    const auto value_values = values.flat<V>();
+    // The grouping keeps the order of the keys of each shard, so the last
+    // value of a repeated key wins.
+    const auto groups = shards_.GroupByShard(key_values);
+    for (int64_t s = 0; s < shards_.num_shards(); ++s) {
+      if (groups.empty(s)) continue;
+      auto& shard = shards_.shard(s);
+      mutex_lock l(shard.mu);
+      for (int64_t j = groups.offsets[s]; j < groups.offsets[s + 1]; ++j) {
+        const int64_t i = groups.indices[j];
+        gtl::InsertOrUpdate(&shard.table,
+                            SubtleMustCopyIfIntegral(key_values(i)),
+                            SubtleMustCopyIfIntegral(value_values(i)));
+      }
+    }
+    return absl::OkStatus();
+  }
+
+  absl::Status Remove(OpKernelContext* ctx, const Tensor& keys) override {
+    shards_.Remove(keys.flat<K>());
+    return absl::OkStatus();
+  }
+
+  // Replaces the contents of the table while holding the locks of all
+  // shards, so that concurrent calls see either the old or the new contents.
+  absl::Status ImportValues(OpKernelContext* ctx, const Tensor& keys,
+                            const Tensor& values)
+      TF_NO_THREAD_SAFETY_ANALYSIS override {
+    const auto key_values = keys.flat<K>();
+    const auto value_values = values.flat<V>();
+    shards_.LockAll();
+    for (int64_t i = 0; i < shards_.num_shards(); ++i) {
+      shards_.shard(i).table.clear();
+    }
+    for (int64_t i = 0; i < key_values.size(); ++i) {
+      auto&& k = SubtleMustCopyIfIntegral(key_values(i));
+      gtl::InsertOrUpdate(&shards_.ShardOf(k).table, k,
+                          SubtleMustCopyIfIntegral(value_values(i)));
+    }
+    shards_.UnlockAll();
+    return absl::OkStatus();
+  }
+
+  absl::Status ExportValues(OpKernelContext* ctx) override {
+    shards_.LockAllShared();
+    const int64_t size = shards_.SizeLocked();
+    Tensor* keys;
+    Tensor* values;
+    absl::Status s = ctx->allocate_output("keys", TensorShape({size}), &keys);
+    if (s.ok()) {
+      s = ctx->allocate_output("values", TensorShape({size}), &values);
+    }
+    if (s.ok()) {
+      ExportKeysAndValuesLocked(keys, values);
+    }
+    shards_.UnlockAllShared();
+    return s;
+  }
+
+  DataType key_dtype() const override { return DataTypeToEnum<K>::v(); }
+
+  DataType value_dtype() const override { return DataTypeToEnum<V>::v(); }
+
+  TensorShape key_shape() const final { return TensorShape(); }
+
+  TensorShape value_shape() const override { return TensorShape(); }
+
+  int64_t MemoryUsed() const override {
+    return sizeof(ShardedMutableHashTableOfScalars) +
+           shards_.MemoryUsed(sizeof(V));
+  }
+
+  absl::Status AsGraphDef(GraphDefBuilder* builder, Node** out) const override {
+    shards_.LockAllShared();
+    Tensor keys(key_dtype(), TensorShape({shards_.SizeLocked()}));
+    Tensor values(value_dtype(), TensorShape({shards_.SizeLocked()}));
+    ExportKeysAndValuesLocked(&keys, &values);
+    shards_.UnlockAllShared();
+
+    // See MutableHashTableOfScalars::AsGraphDef().
+    Node* table = ops::SourceOp(
+        "MutableHashTableV2",
+        builder->opts()
+            .WithName(UniqueNodeName("MutableHashTableFromGraphDef"))
+            .WithAttr("use_node_name_sharing", true)
+            .WithAttr("key_dtype", key_dtype())
+            .WithAttr("value_dtype", value_dtype())
+            .WithAttr("num_shards", shards_.num_shards()));
+    Node* keys_node = ops::SourceOp(
+        "Const",
+        builder->opts().WithAttr("dtype", key_dtype()).WithAttr("value", keys));
+    Node* values_node =
+        ops::SourceOp("Const", builder->opts()
+                                   .WithAttr("dtype", value_dtype())
+                                   .WithAttr("value", values));
+    Node* import_table =
+        ops::TernaryOp("LookupTableImportV2", table, keys_node, values_node,
+                       builder->opts()
+                           .WithAttr("Tin", key_dtype())
+                           .WithAttr("Tout", value_dtype()));
+    *out = ops::UnaryOp("Identity", table,
+                        builder->opts().WithControlInput(import_table));
+    return absl::OkStatus();
+  }
+
+  int64_t num_shards() const { return shards_.num_shards(); }
+
+ private:
+  // Writes all keys and values into `keys` and `values`, which must have
+  // `shards_.SizeLocked()` elements.
+  // REQUIRES: The locks of all shards are held.
+  void ExportKeysAndValuesLocked(Tensor* keys, Tensor* values) const
+      TF_NO_THREAD_SAFETY_ANALYSIS {
+    auto keys_data = keys->flat<K>();
+    auto values_data = values->flat<V>();
+    int64_t i = 0;
+    for (int64_t s = 0; s < shards_.num_shards(); ++s) {
+      for (const auto& entry : shards_.shard(s).table) {
+        keys_data(i) = entry.first;
+        values_data(i) = entry.second;
+        ++i;
+      }
+    }
+  }
+
+  HashTableShards<K, V> shards_;
+};
+
+// Mutable lookup table whose keys are striped across HashTableShards, and
+// whose values are vectors of the `value_shape` attr. Behaves like the
+// MutableHashTableOfTensors of MutableHashTableOfTensorsV2 ops without a
+// `num_shards` attr.
+//
+// This table is mutable and thread safe.
+template <class K, class V>
+class ShardedMutableHashTableOfTensors final : public LookupInterface {
+ public:
+  ShardedMutableHashTableOfTensors(OpKernelContext* ctx, OpKernel* kernel,
+                                   int64_t num_shards)
+      : shards_(num_shards) {
+    OP_REQUIRES_OK(ctx,
+                   GetNodeAttr(kernel->def(), "value_shape", &value_shape_));
+    OP_REQUIRES(
+        ctx, TensorShapeUtils::IsVector(value_shape_),
+        errors::InvalidArgument("Default value must be a vector, got shape ",
+                                value_shape_.DebugString()));
+  }
+
+  size_t size() const override { return shards_.size(); }
+
+  absl::Status Find(OpKernelContext* ctx, const Tensor& key, Tensor* value,
+                    const Tensor& default_value) override {
+    const auto default_flat = default_value.flat_inner_dims<V, 2>();
+    const auto key_values = key.flat<K>();
+    auto value_values = value->flat_inner_dims<V, 2>();
+    const int64_t value_dim = value_shape_.dim_size(0);
+    const bool is_full_size_default =
+        (value_values.size() == default_flat.size());
+
+    const auto groups = shards_.GroupByShard(key_values);
+    for (int64_t s = 0; s < shards_.num_shards(); ++s) {
+      if (groups.empty(s)) continue;
+      const auto& shard = shards_.shard(s);
+      tf_shared_lock l(shard.mu);
+      for (int64_t j = groups.offsets[s]; j < groups.offsets[s + 1]; ++j) {
+        const int64_t i = groups.indices[j];
+        const ValueArray* value_vec = gtl::FindOrNull(
+            shard.table, SubtleMustCopyIfIntegral(key_values(i)));
+        for (int64_t d = 0; d < value_dim; ++d) {
+          if (value_vec != nullptr) {
+            value_values(i, d) = (*value_vec)[d];
+          } else {
+            value_values(i, d) = is_full_size_default ? default_flat(i, d)
+                                                      : default_flat(0, d);
+          }
+        }
+      }
+    }
+    return absl::OkStatus();
+  }
+
+  absl::Status Insert(OpKernelContext* ctx, const Tensor& keys,
+                      const Tensor& values) override {
+    const auto key_values = keys.flat<K>();
+    const auto value_values = values.flat_inner_dims<V, 2>();
+    // The grouping keeps the order of the keys of each shard, so the last
+    // value of a repeated key wins.
+    const auto groups = shards_.GroupByShard(key_values);
+    for (int64_t s = 0; s < shards_.num_shards(); ++s) {
+      if (groups.empty(s)) continue;
+      auto& shard = shards_.shard(s);
+      mutex_lock l(shard.mu);
+      for (int64_t j = groups.offsets[s]; j < groups.offsets[s + 1]; ++j) {
+        const int64_t i = groups.indices[j];
+        gtl::InsertOrUpdate(&shard.table,
+                            SubtleMustCopyIfIntegral(key_values(i)),
+                            MakeValueArray(value_values, i));
+      }
+    }
+    return absl::OkStatus();
+  }
+
+  absl::Status Remove(OpKernelContext* ctx, const Tensor& keys) override {
+    shards_.Remove(keys.flat<K>());
+    return absl::OkStatus();
+  }
+
+  // Replaces the contents of the table while holding the locks of all
+  // shards, so that concurrent calls see either the old or the new contents.
+  absl::Status ImportValues(OpKernelContext* ctx, const Tensor& keys,
+                            const Tensor& values)
+      TF_NO_THREAD_SAFETY_ANALYSIS override {
+    const auto key_values = keys.flat<K>();
+    const auto value_values = values.flat_inner_dims<V, 2>();
+    shards_.LockAll();
+    for (int64_t i = 0; i < shards_.num_shards(); ++i) {
+      shards_.shard(i).table.clear();
+    }
+    for (int64_t i = 0; i < key_values.size(); ++i) {
+      auto&& k = SubtleMustCopyIfIntegral(key_values(i));
+      gtl::InsertOrUpdate(&shards_.ShardOf(k).table, k,
+                          MakeValueArray(value_values, i));
+    }
+    shards_.UnlockAll();
+    return absl::OkStatus();
+  }
+
+  absl::Status ExportValues(OpKernelContext* ctx) override {
+    shards_.LockAllShared();
+    const int64_t size = shards_.SizeLocked();
+    Tensor* keys;
+    Tensor* values;
+    absl::Status s = ctx->allocate_output("keys", TensorShape({size}), &keys);
+    if (s.ok()) {
+      s = ctx->allocate_output(
+          "values", TensorShape({size, value_shape_.dim_size(0)}), &values);
+    }
+    if (s.ok()) {
+      ExportKeysAndValuesLocked(keys, values);
+    }
+    shards_.UnlockAllShared();
+    return s;
+  }
+
+  DataType key_dtype() const override { return DataTypeToEnum<K>::v(); }
+
+  DataType value_dtype() const override { return DataTypeToEnum<V>::v(); }
+
+  TensorShape key_shape() const final { return TensorShape(); }
+
+  TensorShape value_shape() const override { return value_shape_; }
+
+  int64_t MemoryUsed() const override {
+    // The values are counted with their inline capacity only.
+    return sizeof(ShardedMutableHashTableOfTensors) +
+           shards_.MemoryUsed(sizeof(ValueArray));
+  }
+
+  absl::Status AsGraphDef(GraphDefBuilder* builder, Node** out) const override {
+    shards_.LockAllShared();
+    const int64_t size = shards_.SizeLocked();
+    Tensor keys(key_dtype(), TensorShape({size}));
+    Tensor values(value_dtype(), TensorShape({size, value_shape_.dim_size(0)}));
+    ExportKeysAndValuesLocked(&keys, &values);
+    shards_.UnlockAllShared();
+
+    // See MutableHashTableOfTensors::AsGraphDef().
+    Node* table = ops::SourceOp(
+        "MutableHashTableOfTensorsV2",
+        builder->opts()
+            .WithName(UniqueNodeName("MutableHashTableOfTensors"))
+            .WithAttr("use_node_name_sharing", true)
+            .WithAttr("key_dtype", key_dtype())
+            .WithAttr("value_dtype", value_dtype())
+            .WithAttr("value_shape", value_shape_)
+            .WithAttr("num_shards", shards_.num_shards()));
+    Node* keys_node = ops::SourceOp(
+        "Const",
+        builder->opts().WithAttr("dtype", key_dtype()).WithAttr("value", keys));
+    Node* values_node =
+        ops::SourceOp("Const", builder->opts()
+                                   .WithAttr("dtype", value_dtype())
+                                   .WithAttr("value", values));
+    Node* import_table =
+        ops::TernaryOp("LookupTableImportV2", table, keys_node, values_node,
+                       builder->opts()
+                           .WithAttr("Tin", key_dtype())
+                           .WithAttr("Tout", value_dtype()));
+    *out = ops::UnaryOp("Identity", table,
+                        builder->opts().WithControlInput(import_table));
+    return absl::OkStatus();
+  }
+
+  int64_t num_shards() const { return shards_.num_shards(); }
+
+ private:
+  typedef gtl::InlinedVector<V, 4> ValueArray;
+
+  ValueArray MakeValueArray(typename TTypes<V, 2>::ConstTensor value_values,
+                            int64_t i) const {
+    const int64_t value_dim = value_shape_.dim_size(0);
+    ValueArray value_vec;
+    value_vec.reserve(value_dim);
+    for (int64_t d = 0; d < value_dim; ++d) {
+      value_vec.push_back(SubtleMustCopyIfIntegral(value_values(i, d)));
+    }
+    return value_vec;
+  }
+
+  // Writes all keys and values into `keys` and `values`, which must have
+  // `shards_.SizeLocked()` rows.
+  // REQUIRES: The locks of all shards are held.
+  void ExportKeysAndValuesLocked(Tensor* keys, Tensor* values) const
+      TF_NO_THREAD_SAFETY_ANALYSIS {
+    const int64_t value_dim = value_shape_.dim_size(0);
+    auto keys_data = keys->flat<K>();
+    auto values_data = values->matrix<V>();
+    int64_t i = 0;
+    for (int64_t s = 0; s < shards_.num_shards(); ++s) {
+      for (const auto& entry : shards_.shard(s).table) {
+        keys_data(i) = entry.first;
+        for (int64_t d = 0; d < value_dim; ++d) {
+          values_data(i, d) = entry.second[d];
+        }
+        ++i;
+      }
+    }
+  }
+
+  TensorShape value_shape_;
+  HashTableShards<K, ValueArray> shards_;
+};
+
 }  // namespace lookup
 
 }  // namespace tensorflow
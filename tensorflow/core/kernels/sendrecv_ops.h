@@ -16,6 +16,8 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_KERNELS_SENDRECV_OPS_H_
 #define TENSORFLOW_CORE_KERNELS_SENDRECV_OPS_H_
 
+#include <cstdint>
+
 #include "tensorflow/core/framework/op_kernel.h"
 #include "tensorflow/core/platform/macros.h"
 
@@ -32,6 +34,8 @@ class SendOp : public OpKernel {
   string key_prefix_;
   Rendezvous::ParsedKey parsed_key_;
   bool hostmem_sendrecv_;
+  // The rendezvous slot of the pair outside of loops, or -1 if none.
+  int64_t rendezvous_slot_;
 
   SendOp(const SendOp&) = delete;
   void operator=(const SendOp&) = delete;
@@ -48,6 +52,8 @@ class RecvOp : public AsyncOpKernel {
   string key_prefix_;
   Rendezvous::ParsedKey parsed_key_;
   bool hostmem_sendrecv_;
+  // The rendezvous slot of the pair outside of loops, or -1 if none.
+  int64_t rendezvous_slot_;
 
   RecvOp(const RecvOp&) = delete;
   void operator=(const RecvOp&) = delete;
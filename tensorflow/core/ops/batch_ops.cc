@@ -88,11 +88,24 @@ REGISTER_OP("BatchFunction")
     //     to either PAD_UP or BATCH_DOWN so as to minimize the TPU costs per
     //     real request. In this case, it would compare (batch_16_cost / 16) and
     //     (batch_32_cost / 18).
+    //   - RAGGED: schedule a batch of size 18 without padding. Each input of
+    //     shape [rows, length, ...] is passed to `f` as a ragged tensor, i.e.
+    //     as its flat values of shape [total_length, ...] followed by its
+    //     int64 row splits, so that `f` receives two arguments per input.
+    //     Outputs of `f` listed in `ragged_output_indices` are indexed by the
+    //     flat values of the first input and split back into
+    //     [rows, length, ...] per request, and other outputs are split by rows.
+    //     RAGGED is not supported with the adaptive batch scheduler.
     //
     // WARNING: Not all batch schedulers might support this attribute.
     .Attr(
         "batch_padding_policy: "
-        "{'PAD_UP', 'BATCH_DOWN', 'MINIMIZE_TPU_COST_PER_REQUEST'} = 'PAD_UP'")
+        "{'PAD_UP', 'BATCH_DOWN', 'MINIMIZE_TPU_COST_PER_REQUEST', 'RAGGED'} "
+        "= 'PAD_UP'")
+    // Indices of the outputs of `f` that, with the RAGGED batch padding
+    // policy, have one entry per value of the first input instead of one per
+    // row. Must be empty with any other policy.
+    .Attr("ragged_output_indices: list(int) = []")
     .Attr("Tin: list(type)")
     .Attr("Tcaptured: list(type) >= 0")
     .Attr("Tout: list(type)")
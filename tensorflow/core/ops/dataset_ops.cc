@@ -862,6 +862,7 @@ REGISTER_OP("TFRecordDatasetV2")
     .Input("buffer_size: int64")
     .Input("byte_offsets: int64")
     .Attr("metadata: string = ''")
+    .Attr("async_read_queue_depth: int = 0")
     .Output("handle: variant")
     .SetDoNotOptimize()  // TODO(b/123753214): See comment in dataset_ops.cc.
     .SetTypeConstructor(full_type::UnaryTensorContainer(TFT_DATASET,
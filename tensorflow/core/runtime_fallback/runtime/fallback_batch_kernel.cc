@@ -23,6 +23,7 @@ limitations under the License.
 #include "absl/status/status.h"
 #include "absl/strings/string_view.h"
 #include "tensorflow/core/framework/op_kernel.h"
+#include "tensorflow/core/kernels/batching_util/batch_scheduler_utils.h"
 #include "tensorflow/core/kernels/batching_util/bounded_executor.h"
 #include "tensorflow/core/lib/monitoring/gauge.h"
 #include "tensorflow/core/platform/types.h"
@@ -131,6 +132,24 @@ BatchFunctionFallbackKernelBase::BatchFunctionFallbackKernelBase(
     disable_padding_ = false;
   }
 
+  if (c->HasAttr("ragged_output_indices")) {
+    OP_REQUIRES_OK(
+        c, c->GetAttr("ragged_output_indices", &ragged_output_indices_));
+  }
+  OP_REQUIRES(c,
+              ragged_output_indices_.empty() ||
+                  batch_padding_policy_ == serving::kRaggedPolicy,
+              errors::InvalidArgument(
+                  "ragged_output_indices requires the RAGGED batch padding "
+                  "policy; got ",
+                  batch_padding_policy_));
+  for (int32 index : ragged_output_indices_) {
+    OP_REQUIRES(c, index >= 0 && index < c->num_outputs(),
+                errors::InvalidArgument(
+                    "ragged_output_indices entry ", index,
+                    " is out of range for ", c->num_outputs(), " outputs"));
+  }
+
   // Helper function `SetAdaptiveBatchSchedulerOptions` calls
   // `OP_REQUIRES_OK`, which exits the current function upon error.
   // So validate status of `op-kernel-construction`.
@@ -138,6 +157,13 @@ BatchFunctionFallbackKernelBase::BatchFunctionFallbackKernelBase(
   if (!c->status().ok()) {
     return;
   }
+  // The adaptive shared batch scheduler does not take a batch padding policy.
+  OP_REQUIRES(c,
+              !enable_adaptive_batch_threads_ ||
+                  batch_padding_policy_ != serving::kRaggedPolicy,
+              errors::InvalidArgument(
+                  "The RAGGED batch padding policy is not supported with "
+                  "the adaptive batch scheduler."));
 
   if (enable_adaptive_batch_threads_) {
     // One scheduler instance contains a couple of queue instances,
@@ -87,6 +87,7 @@ class BatchFunctionFallbackKernelBase : public AsyncOpKernel {
   bool has_attribute_enable_large_batch_splitting_;
   bool disable_padding_;
   std::string batch_padding_policy_;
+  std::vector<int32> ragged_output_indices_;
 
   // Parameters for adaptive batch scheduler only.
   // Note 'num_batch_threads_' above is shared by two implementations of batch
@@ -243,6 +244,7 @@ void BatchFunctionFallbackKernel<BatchResourceType>::ComputeAsync(
       if (c->session_metadata() != nullptr) {
         new_resource->set_session_metadata(*c->session_metadata());
       }
+      new_resource->set_ragged_output_indices(ragged_output_indices_);
       return tensorflow::core::RefCountPtr<BatchResourceType>(
           new_resource.release());
     };
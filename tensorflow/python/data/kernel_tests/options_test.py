@@ -17,6 +17,7 @@
 from absl.testing import parameterized
 
 from tensorflow.core.framework import dataset_options_pb2
+from tensorflow.core.framework import model_pb2
 from tensorflow.python.data.experimental.ops import testing
 from tensorflow.python.data.kernel_tests import test_base
 from tensorflow.python.data.ops import dataset_ops
@@ -145,7 +146,11 @@ class OptionsTest(test_base.DatasetTestBase, parameterized.TestCase):
     options.autotune.enabled = True
     options.autotune.cpu_budget = 10
     options.autotune.ram_budget = 20
+    options.autotune.autotune_algorithm = (
+        options_lib.AutotuneAlgorithm.LEARNED)
+    options.autotune.learned_state_directory = "/tmp/autotune"
     options.deterministic = True
+    options.experimental_cache.content_addressed = True
     options.experimental_external_state_policy = (
         options_lib.ExternalStatePolicy.FAIL)
     options.experimental_distribute.auto_shard_policy = (
@@ -165,16 +170,34 @@ class OptionsTest(test_base.DatasetTestBase, parameterized.TestCase):
     options.experimental_optimization.seq_interleave_prefetch = True
     options.experimental_warm_start = True
     options.experimental_slack = True
+    options.experimental_shuffle.spill_directory = "/tmp/shuffle"
+    options.experimental_shuffle.memory_budget_bytes = 1 << 20
+    options.experimental_shuffle.checkpoints_to_keep = 3
     options.dataset_name = "test_name"
     options.framework_type = ["TFDS", "TfGrain"]
     options.threading.max_intra_op_parallelism = 30
     options.threading.private_threadpool_size = 40
+    options.threading.numa_node = -1
     pb = options._to_proto()
     result = options_lib.Options()
     result._from_proto(pb)
     self.assertEqual(options.framework_type, result.framework_type)
     self.assertEqual(options, result)
 
+  @combinations.generate(test_base.default_test_combinations())
+  def testLearnedAutotuneOptionsFromProto(self):
+    pb = dataset_options_pb2.Options()
+    pb.autotune_options.autotune_algorithm = (
+        model_pb2.AutotuneAlgorithm.LEARNED)
+    pb.autotune_options.learned_state_directory = "/tmp/autotune"
+    options = options_lib.Options()
+    options._from_proto(pb)
+    self.assertEqual(options.autotune.autotune_algorithm,
+                     options_lib.AutotuneAlgorithm.LEARNED)
+    self.assertEqual(options.autotune.learned_state_directory, "/tmp/autotune")
+    self.assertProtoEquals(pb.autotune_options,
+                           options._to_proto().autotune_options)
+
   @combinations.generate(test_base.default_test_combinations())
   def testOptionsProtoDefaultValuesRoundTrip(self):
     options = options_lib.Options()
@@ -191,6 +214,7 @@ class OptionsTest(test_base.DatasetTestBase, parameterized.TestCase):
     result = options._to_proto()
     expected_pb = dataset_options_pb2.Options()
     expected_pb.autotune_options.CopyFrom(dataset_options_pb2.AutotuneOptions())
+    expected_pb.cache_options.CopyFrom(dataset_options_pb2.CacheOptions())
     expected_pb.distribute_options.CopyFrom(
         dataset_options_pb2.DistributeOptions())
     expected_pb.optimization_options.CopyFrom(
@@ -198,6 +222,8 @@ class OptionsTest(test_base.DatasetTestBase, parameterized.TestCase):
     expected_pb.warm_start = True
     expected_pb.service_options.CopyFrom(
         dataset_options_pb2.ServiceOptions())
+    expected_pb.shuffle_options.CopyFrom(
+        dataset_options_pb2.ShuffleOptions())
     expected_pb.threading_options.CopyFrom(
         dataset_options_pb2.ThreadingOptions())
     self.assertProtoEquals(expected_pb, result)
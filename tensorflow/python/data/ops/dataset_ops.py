@@ -1552,6 +1552,12 @@ class DatasetV2(
     through the dataset. If you wish to randomize the iteration order, make sure
     to call `shuffle` *after* calling `cache`.
 
+    Jobs on the same host that build the same deterministic pipeline can share
+    one file cache by setting
+    `tf.data.Options.experimental_cache.content_addressed`. The cache is then
+    stored under a subdirectory of `filename` named after the pipeline
+    fingerprint, and a partially written cache is resumed instead of discarded.
+
     Args:
       filename: A `tf.string` scalar `tf.Tensor`, representing the name of a
         directory on the filesystem to use for caching elements in this Dataset.
@@ -45,12 +45,19 @@ class AutotuneAlgorithm(enum.Enum):
 
   STAGE_BASED: In each optimization step, this algorithm chooses the worst
   bottleneck parameter and increases its value by 1.
+
+  LEARNED: In each optimization step, this algorithm tries a change to one
+  parameter and keeps it if the measured throughput improved. If
+  `tf.data.experimental.AutotuneOptions.learned_state_directory` is set, the
+  best values found are persisted there and reused by pipelines with the same
+  structure.
   """
   DEFAULT = 0
   HILL_CLIMB = 1
   GRADIENT_DESCENT = 2
   MAX_PARALLELISM = 3
   STAGE_BASED = 4
+  LEARNED = 5
 
   @classmethod
   def _to_proto(cls, obj):
@@ -64,9 +71,11 @@ class AutotuneAlgorithm(enum.Enum):
       return model_pb2.AutotuneAlgorithm.MAX_PARALLELISM
     if obj == cls.STAGE_BASED:
       return model_pb2.AutotuneAlgorithm.STAGE_BASED
+    if obj == cls.LEARNED:
+      return model_pb2.AutotuneAlgorithm.LEARNED
     raise ValueError(
         f"Invalid `obj.` Supported values include `DEFAULT`, `HILL_CLIMB` "
-        f"`GRADIENT_DESCENT`, and `STAGE_BASED`. Got {obj.name}.")
+        f"`GRADIENT_DESCENT`, `STAGE_BASED` and `LEARNED`. Got {obj.name}.")
 
   @classmethod
   def _from_proto(cls, pb):
@@ -80,9 +89,11 @@ class AutotuneAlgorithm(enum.Enum):
       return cls.MAX_PARALLELISM
     if pb == model_pb2.AutotuneAlgorithm.STAGE_BASED:
       return cls.STAGE_BASED
+    if pb == model_pb2.AutotuneAlgorithm.LEARNED:
+      return cls.LEARNED
     raise ValueError(
         f"Invalid `pb.` Supported values include `DEFAULT`, `HILL_CLIMB`, "
-        f"`GRADIENT_DESCENT` and `STAGE_BASED`. Got {pb}.")
+        f"`GRADIENT_DESCENT`, `STAGE_BASED` and `LEARNED`. Got {pb}.")
 
 
 @tf_export("data.experimental.AutoShardPolicy")
@@ -241,6 +252,17 @@ class AutotuneOptions(options_lib.OptionsBase):
       ),
   )
 
+  learned_state_directory = options_lib.create_option(
+      name="learned_state_directory",
+      ty=str,
+      docstring=(
+          "When autotuning with the `LEARNED` algorithm, the directory in"
+          " which tuned parameter values are persisted. A pipeline with the"
+          " same structure starts from the persisted values instead of the"
+          " minimum ones. If None, values are not persisted."
+      ),
+  )
+
   def _to_proto(self):
     pb = dataset_options_pb2.AutotuneOptions()
     if self.enabled is not None:
@@ -254,6 +276,8 @@ class AutotuneOptions(options_lib.OptionsBase):
           self.autotune_algorithm)
     if self.initial_parallelism is not None:
       pb.initial_parallelism = self.initial_parallelism
+    if self.learned_state_directory is not None:
+      pb.learned_state_directory = self.learned_state_directory
     return pb
 
   def _from_proto(self, pb):
@@ -268,6 +292,8 @@ class AutotuneOptions(options_lib.OptionsBase):
           pb.autotune_algorithm)
     if pb.WhichOneof("optional_initial_parallelism") is not None:
       self.initial_parallelism = pb.initial_parallelism
+    if pb.WhichOneof("optional_learned_state_directory") is not None:
+      self.learned_state_directory = pb.learned_state_directory
 
   def _set_mutable(self, mutable):
     """Change the mutability value to `mutable` on this options and children."""
@@ -275,6 +301,46 @@ class AutotuneOptions(options_lib.OptionsBase):
     object.__setattr__(self, "_mutable", mutable)
 
 
+@tf_export("data.experimental.CacheOptions")
+class CacheOptions(options_lib.OptionsBase):
+  """Represents options for file-backed caches.
+
+  You can set the cache options of a dataset through the `experimental_cache`
+  property of `tf.data.Options`; the property is an instance of
+  `tf.data.experimental.CacheOptions`.
+
+  ```python
+  options = tf.data.Options()
+  options.experimental_cache.content_addressed = True
+  dataset = dataset.cache("/tmp/cache").with_options(options)
+  ```
+  """
+
+  content_addressed = options_lib.create_option(
+      name="content_addressed",
+      ty=bool,
+      docstring=(
+          "If True, file-backed caches are stored under a subdirectory of the"
+          " cache filename that is named after the fingerprint of the cached"
+          " input pipeline. Jobs on the same host that build the same pipeline"
+          " share the cache and can write different parts of it concurrently,"
+          " and a partially written cache is resumed when a writing job is"
+          " restarted. Ignored unless the input pipeline is deterministic. If"
+          " None, defaults to False."
+      ),
+  )
+
+  def _to_proto(self):
+    pb = dataset_options_pb2.CacheOptions()
+    if self.content_addressed is not None:
+      pb.content_addressed = self.content_addressed
+    return pb
+
+  def _from_proto(self, pb):
+    if pb.WhichOneof("optional_content_addressed") is not None:
+      self.content_addressed = pb.content_addressed
+
+
 @tf_export("data.experimental.DistributeOptions")
 class DistributeOptions(options_lib.OptionsBase):
   """Represents options for distributed data processing.
@@ -401,6 +467,16 @@ class OptimizationOptions(options_lib.OptionsBase):
       "Whether to parallelize stateless map transformations. If None, defaults "
       "to True.")
 
+  map_vectorization = options_lib.create_option(
+      name="map_vectorization",
+      ty=bool,
+      docstring=
+      "Whether to vectorize map functions that are followed by a batch, so "
+      "that the map function runs once per batch instead of once per "
+      "element. Only maps whose input elements have fully defined shapes are "
+      "rewritten. An error raised by the map function for one element fails "
+      "the whole batch. If None, defaults to False.")
+
   noop_elimination = options_lib.create_option(
       name="noop_elimination",
       ty=bool,
@@ -439,6 +515,8 @@ class OptimizationOptions(options_lib.OptionsBase):
       pb.map_fusion = self.map_fusion
     if self.map_parallelization is not None:
       pb.map_parallelization = self.map_parallelization
+    if self.map_vectorization is not None:
+      pb.map_vectorization = self.map_vectorization
     if self.noop_elimination is not None:
       pb.noop_elimination = self.noop_elimination
     if self.parallel_batch is not None:
@@ -466,6 +544,8 @@ class OptimizationOptions(options_lib.OptionsBase):
       self.map_fusion = pb.map_fusion
     if pb.WhichOneof("optional_map_parallelization") is not None:
       self.map_parallelization = pb.map_parallelization
+    if pb.WhichOneof("optional_map_vectorization") is not None:
+      self.map_vectorization = pb.map_vectorization
     if pb.WhichOneof("optional_noop_elimination") is not None:
       self.noop_elimination = pb.noop_elimination
     if pb.WhichOneof("optional_parallel_batch") is not None:
@@ -517,6 +597,77 @@ class ServiceOptions(options_lib.OptionsBase):
       self.pinned = pb.pinned
 
 
+@tf_export("data.experimental.ShuffleOptions")
+class ShuffleOptions(options_lib.OptionsBase):
+  """Represents options for shuffle buffers.
+
+  You can set the shuffle options of a dataset through the
+  `experimental_shuffle` property of `tf.data.Options`; the property is an
+  instance of `tf.data.experimental.ShuffleOptions`.
+
+  ```python
+  options = tf.data.Options()
+  options.experimental_shuffle.spill_directory = "/tmp/shuffle"
+  options.experimental_shuffle.memory_budget_bytes = 2 << 30
+  dataset = dataset.with_options(options)
+  ```
+  """
+
+  spill_directory = options_lib.create_option(
+      name="spill_directory",
+      ty=str,
+      docstring=(
+          "If set, shuffle buffers keep at most `memory_budget_bytes` of"
+          " elements in memory and spill the remainder to segment files in"
+          " this local directory. Spilled elements are sampled uniformly"
+          " together with the in-memory ones. Each iterator writes to its own"
+          " subdirectory. Checkpoints reference the segment files, so the"
+          " directory must outlive the checkpoints restored from it. All"
+          " elements of an epoch are produced before those of the next one,"
+          " and iteration pauses at each epoch boundary while the buffer"
+          " refills."
+      ),
+  )
+
+  memory_budget_bytes = options_lib.create_option(
+      name="memory_budget_bytes",
+      ty=int,
+      docstring=(
+          "The in-memory budget of a spilling shuffle buffer. Only takes"
+          " effect if `spill_directory` is set. If None, defaults to 1 GiB."
+      ),
+  )
+
+  checkpoints_to_keep = options_lib.create_option(
+      name="checkpoints_to_keep",
+      ty=int,
+      docstring=(
+          "The number of most recent iterator checkpoints that must stay"
+          " restorable. A segment file is deleted once none of them references"
+          " it. Only takes effect if `spill_directory` is set. If None,"
+          " defaults to 5."
+      ),
+  )
+
+  def _to_proto(self):
+    pb = dataset_options_pb2.ShuffleOptions()
+    if self.spill_directory is not None:
+      pb.spill_directory = self.spill_directory
+    if self.memory_budget_bytes is not None:
+      pb.memory_budget_bytes = self.memory_budget_bytes
+    if self.checkpoints_to_keep is not None:
+      pb.checkpoints_to_keep = self.checkpoints_to_keep
+    return pb
+
+  def _from_proto(self, pb):
+    if pb.WhichOneof("optional_spill_directory") is not None:
+      self.spill_directory = pb.spill_directory
+    if pb.WhichOneof("optional_memory_budget_bytes") is not None:
+      self.memory_budget_bytes = pb.memory_budget_bytes
+    if pb.WhichOneof("optional_checkpoints_to_keep") is not None:
+      self.checkpoints_to_keep = pb.checkpoints_to_keep
+
+
 @deprecation.deprecated_endpoints("data.experimental.ThreadingOptions")
 @tf_export("data.experimental.ThreadingOptions", "data.ThreadingOptions")
 class ThreadingOptions(options_lib.OptionsBase):
@@ -547,12 +698,27 @@ class ThreadingOptions(options_lib.OptionsBase):
       "The value 0 can be used to indicate that the threadpool size should be "
       "determined at runtime based on the number of available CPU cores.")
 
+  numa_node = options_lib.create_option(
+      name="numa_node",
+      ty=int,
+      docstring=(
+          "If set, the background threads of the dataset are pinned to NUMA"
+          " nodes. A non-negative value pins them to that node. The value -1"
+          " pins them to the node of the thread that creates the iterator if"
+          " that thread has NUMA affinity, and otherwise runs each work item on"
+          " the node of the thread that scheduled it. If None, threads are not"
+          " pinned."
+      ),
+  )
+
   def _to_proto(self):
     pb = dataset_options_pb2.ThreadingOptions()
     if self.max_intra_op_parallelism is not None:
       pb.max_intra_op_parallelism = self.max_intra_op_parallelism
     if self.private_threadpool_size is not None:
       pb.private_threadpool_size = self.private_threadpool_size
+    if self.numa_node is not None:
+      pb.numa_node = self.numa_node
     return pb
 
   def _from_proto(self, pb):
@@ -560,6 +726,8 @@ class ThreadingOptions(options_lib.OptionsBase):
       self.max_intra_op_parallelism = pb.max_intra_op_parallelism
     if pb.WhichOneof("optional_private_threadpool_size") is not None:
       self.private_threadpool_size = pb.private_threadpool_size
+    if pb.WhichOneof("optional_numa_node") is not None:
+      self.numa_node = pb.numa_node
 
 
 @tf_export("data.Options")
@@ -610,6 +778,16 @@ class Options(options_lib.OptionsBase):
       ty=bool,
       docstring="DEPRECATED. Use `deterministic` instead.")
 
+  experimental_cache = options_lib.create_option(
+      name="experimental_cache",
+      ty=CacheOptions,
+      docstring=(
+          "The cache options associated with the dataset. See "
+          "`tf.data.experimental.CacheOptions` for more details."
+      ),
+      default_factory=CacheOptions,
+  )
+
   experimental_distribute = options_lib.create_option(
       name="experimental_distribute",
       ty=DistributeOptions,
@@ -666,6 +844,16 @@ class Options(options_lib.OptionsBase):
       default_factory=ServiceOptions,
   )
 
+  experimental_shuffle = options_lib.create_option(
+      name="experimental_shuffle",
+      ty=ShuffleOptions,
+      docstring=(
+          "The shuffle buffer options associated with the dataset. See "
+          "`tf.data.experimental.ShuffleOptions` for more details."
+      ),
+      default_factory=ShuffleOptions,
+  )
+
   experimental_threading = options_lib.create_option(
       name="experimental_threading",
       ty=ThreadingOptions,
@@ -739,6 +927,7 @@ class Options(options_lib.OptionsBase):
     if self.deterministic is not None:
       pb.deterministic = self.deterministic
     pb.autotune_options.CopyFrom(self.autotune._to_proto())  # pylint: disable=protected-access
+    pb.cache_options.CopyFrom(self.experimental_cache._to_proto())  # pylint: disable=protected-access
     pb.distribute_options.CopyFrom(self.experimental_distribute._to_proto())  # pylint: disable=protected-access
     if self.experimental_external_state_policy is not None:
       pb.external_state_policy = (
@@ -757,6 +946,7 @@ class Options(options_lib.OptionsBase):
       for framework_type in self.framework_type:
         pb.framework_type.append(framework_type)
     pb.service_options.CopyFrom(self.experimental_service._to_proto())  # pylint: disable=protected-access
+    pb.shuffle_options.CopyFrom(self.experimental_shuffle._to_proto())  # pylint: disable=protected-access
     pb.threading_options.CopyFrom(self.threading._to_proto())  # pylint: disable=protected-access
     return pb
 
@@ -764,6 +954,7 @@ class Options(options_lib.OptionsBase):
     if pb.WhichOneof("optional_deterministic") is not None:
       self.deterministic = pb.deterministic
     self.autotune._from_proto(pb.autotune_options)  # pylint: disable=protected-access
+    self.experimental_cache._from_proto(pb.cache_options)  # pylint: disable=protected-access
     self.experimental_distribute._from_proto(pb.distribute_options)  # pylint: disable=protected-access
     if pb.WhichOneof("optional_external_state_policy") is not None:
       self.experimental_external_state_policy = (
@@ -783,6 +974,7 @@ class Options(options_lib.OptionsBase):
       for framework_type in pb.framework_type:
         self.framework_type.append(framework_type)
     self.experimental_service._from_proto(pb.service_options)  # pylint: disable=protected-access
+    self.experimental_shuffle._from_proto(pb.shuffle_options)  # pylint: disable=protected-access
     self.threading._from_proto(pb.threading_options)  # pylint: disable=protected-access
 
   def _set_mutable(self, mutable):
@@ -790,8 +982,10 @@ class Options(options_lib.OptionsBase):
     # pylint: disable=protected-access
     object.__setattr__(self, "_mutable", mutable)
     self.autotune._set_mutable(mutable)
+    self.experimental_cache._set_mutable(mutable)
     self.experimental_distribute._set_mutable(mutable)
     self.experimental_optimization._set_mutable(mutable)
+    self.experimental_shuffle._set_mutable(mutable)
     self.threading._set_mutable(mutable)
 
   def merge(self, options):
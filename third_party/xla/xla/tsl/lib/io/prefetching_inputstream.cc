@@ -0,0 +1,181 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "xla/tsl/lib/io/prefetching_inputstream.h"
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <utility>
+
+#include "absl/status/status.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "tsl/platform/errors.h"
+#include "tsl/platform/logging.h"
+
+namespace tsl {
+namespace io {
+
+PrefetchingInputStream::PrefetchingInputStream(RandomAccessFile* file,
+                                               size_t block_size,
+                                               int queue_depth)
+    : file_(file), block_size_(block_size), queue_depth_(queue_depth) {
+  DCHECK_GT(block_size_, 0);
+  DCHECK_GT(queue_depth_, 0);
+}
+
+PrefetchingInputStream::~PrefetchingInputStream() {
+  absl::MutexLock l(&mu_);
+  mu_.Await(absl::Condition(
+      +[](int64_t* num_reads) { return *num_reads == 0; },
+      &num_outstanding_reads_));
+}
+
+void PrefetchingInputStream::FillQueue() {
+  while (blocks_.size() < static_cast<size_t>(queue_depth_) &&
+         (end_offset_ == -1 || next_offset_ < end_offset_)) {
+    auto block = std::make_shared<Block>(next_offset_, block_size_);
+    next_offset_ += block_size_;
+    blocks_.push_back(block);
+    {
+      absl::MutexLock l(&mu_);
+      ++num_outstanding_reads_;
+    }
+    // The callback keeps the block alive, so that a Seek() can drop blocks
+    // that are still being read.
+    file_->ReadAsync(block->offset, block_size_, block->scratch.get(),
+                     [this, block](absl::Status status,
+                                   absl::string_view data) {
+                       absl::MutexLock l(&mu_);
+                       block->status = std::move(status);
+                       block->data = data;
+                       block->done = true;
+                       --num_outstanding_reads_;
+                     });
+  }
+}
+
+absl::Status PrefetchingInputStream::Consume(int64_t n, char* result,
+                                             int64_t* bytes_consumed) {
+  *bytes_consumed = 0;
+  while (*bytes_consumed < n) {
+    if (end_offset_ != -1 && pos_ >= end_offset_) {
+      return errors::OutOfRange("reached end of file");
+    }
+    FillQueue();
+    const std::shared_ptr<Block> block = blocks_.front();
+    {
+      absl::MutexLock l(&mu_);
+      mu_.Await(absl::Condition(&block->done));
+    }
+    if (!block->status.ok() && !errors::IsOutOfRange(block->status)) {
+      return block->status;
+    }
+    if (block->data.size() < block_size_) {
+      // Only the last block of the file is short, so the blocks after it are
+      // not needed.
+      const int64_t end_offset =
+          block->offset + static_cast<int64_t>(block->data.size());
+      if (end_offset_ == -1 || end_offset < end_offset_) {
+        end_offset_ = end_offset;
+      }
+      blocks_.resize(1);
+      next_offset_ = block->offset + block_size_;
+    }
+    const int64_t block_pos = pos_ - block->offset;
+    const int64_t available =
+        static_cast<int64_t>(block->data.size()) - block_pos;
+    const int64_t bytes =
+        std::max<int64_t>(0, std::min(available, n - *bytes_consumed));
+    if (result != nullptr && bytes > 0) {
+      memcpy(result + *bytes_consumed, block->data.data() + block_pos, bytes);
+    }
+    pos_ += bytes;
+    *bytes_consumed += bytes;
+    if (block->data.size() == block_size_ && bytes == available) {
+      blocks_.pop_front();
+    }
+  }
+  return absl::OkStatus();
+}
+
+absl::Status PrefetchingInputStream::ReadNBytes(int64_t bytes_to_read,
+                                                tstring* result) {
+  if (bytes_to_read < 0) {
+    return errors::InvalidArgument("Can't read a negative number of bytes: ",
+                                   bytes_to_read);
+  }
+  result->clear();
+  result->resize_uninitialized(bytes_to_read);
+  int64_t bytes_read;
+  absl::Status s = Consume(bytes_to_read, &(*result)[0], &bytes_read);
+  result->resize(bytes_read);
+  return s;
+}
+
+absl::Status PrefetchingInputStream::SkipNBytes(int64_t bytes_to_skip) {
+  if (bytes_to_skip < 0) {
+    return errors::InvalidArgument("Can only skip forward, not ",
+                                   bytes_to_skip);
+  }
+  const int64_t start = pos_;
+  const int64_t target = pos_ + bytes_to_skip;
+  if (target > next_offset_ && end_offset_ == -1) {
+    // Reading the last skipped byte also starts prefetching at `target`.
+    TF_RETURN_IF_ERROR(Seek(target - 1));
+    int64_t bytes_skipped;
+    absl::Status s = Consume(1, /*result=*/nullptr, &bytes_skipped);
+    if (!errors::IsOutOfRange(s)) {
+      return s;
+    }
+    // The file ends before `target`: skip to its end from `start`.
+    TF_RETURN_IF_ERROR(Seek(start));
+  }
+  int64_t bytes_skipped;
+  return Consume(bytes_to_skip, /*result=*/nullptr, &bytes_skipped);
+}
+
+int64_t PrefetchingInputStream::Tell() const { return pos_; }
+
+absl::Status PrefetchingInputStream::Seek(int64_t position) {
+  if (position < 0) {
+    return errors::InvalidArgument("Seeking to a negative position: ",
+                                   position);
+  }
+  if (blocks_.empty() || position < blocks_.front()->offset ||
+      position >= next_offset_) {
+    blocks_.clear();
+    next_offset_ = position;
+  } else {
+    while (blocks_.front()->offset + static_cast<int64_t>(block_size_) <=
+           position) {
+      blocks_.pop_front();
+    }
+  }
+  pos_ = position;
+  return absl::OkStatus();
+}
+
+absl::Status PrefetchingInputStream::Reset() {
+  blocks_.clear();
+  next_offset_ = 0;
+  end_offset_ = -1;
+  pos_ = 0;
+  return absl::OkStatus();
+}
+
+}  // namespace io
+}  // namespace tsl
@@ -0,0 +1,110 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef XLA_TSL_LIB_IO_PREFETCHING_INPUTSTREAM_H_
+#define XLA_TSL_LIB_IO_PREFETCHING_INPUTSTREAM_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/status/status.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "xla/tsl/lib/io/inputstream_interface.h"
+#include "tsl/platform/file_system.h"
+
+namespace tsl {
+namespace io {
+
+// Reads a RandomAccessFile sequentially while keeping up to `queue_depth`
+// reads of `block_size` bytes ahead of the current position in flight with
+// RandomAccessFile::ReadAsync. On file systems with a truly asynchronous read
+// path this hides the latency of individual reads without a thread per read.
+//
+// A given instance of PrefetchingInputStream is NOT safe for concurrent use
+// by multiple threads.
+class PrefetchingInputStream : public InputStreamInterface {
+ public:
+  // Does not take ownership of `file`, which must outlive *this.
+  PrefetchingInputStream(RandomAccessFile* file, size_t block_size,
+                         int queue_depth);
+
+  // Waits for the reads in flight to complete.
+  ~PrefetchingInputStream() override;
+
+  absl::Status ReadNBytes(int64_t bytes_to_read, tstring* result) override;
+
+  // Skips within the prefetched blocks are served from them. Longer skips
+  // discard the blocks and seek, after checking that the last skipped byte
+  // exists.
+  absl::Status SkipNBytes(int64_t bytes_to_skip) override;
+
+  int64_t Tell() const override;
+
+  // Seeks to `position` in the file. Blocks that are already prefetched are
+  // reused if `position` falls within them; otherwise they are discarded.
+  absl::Status Seek(int64_t position);
+
+  // Seeks to the beginning of the file and discards all prefetched blocks, so
+  // that data appended to the file since they were read becomes visible.
+  absl::Status Reset() override;
+
+ private:
+  struct Block {
+    Block(int64_t offset, size_t size)
+        : offset(offset), scratch(new char[size]) {}
+
+    const int64_t offset;
+    const std::unique_ptr<char[]> scratch;
+    // Set once by the read callback under `mu_`, after which they are
+    // immutable.
+    bool done = false;
+    absl::Status status;
+    absl::string_view data;
+  };
+
+  // Issues reads until `queue_depth_` blocks are queued, or until the blocks
+  // reach `end_offset_`.
+  void FillQueue();
+
+  // Consumes up to `n` bytes starting at `pos_`, copying them to `result`
+  // unless it is null, and sets `*bytes_consumed`. Returns OUT_OF_RANGE if the
+  // end of the file is reached before `n` bytes are consumed.
+  absl::Status Consume(int64_t n, char* result, int64_t* bytes_consumed);
+
+  RandomAccessFile* const file_;  // Not owned.
+  const size_t block_size_;
+  const int queue_depth_;
+
+  int64_t pos_ = 0;          // Tracks where we are in the file.
+  int64_t next_offset_ = 0;  // Offset of the next block to read.
+  // Blocks covering [blocks_.front()->offset, next_offset_), in file order.
+  std::deque<std::shared_ptr<Block>> blocks_;
+  // If not -1, the file has no data at or after this offset. Set when a
+  // short block is read, so that no reads past the end of the file are
+  // issued, and cleared by Reset().
+  int64_t end_offset_ = -1;
+
+  absl::Mutex mu_;
+  int64_t num_outstanding_reads_ ABSL_GUARDED_BY(mu_) = 0;
+};
+
+}  // namespace io
+}  // namespace tsl
+
+#endif  // XLA_TSL_LIB_IO_PREFETCHING_INPUTSTREAM_H_
@@ -0,0 +1,235 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "xla/tsl/lib/io/prefetching_inputstream.h"
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/strings/string_view.h"
+#include "xla/tsl/lib/core/status_test_util.h"
+#include "tsl/platform/file_system.h"
+#include "tsl/platform/env.h"
+#include "tsl/platform/test.h"
+#include "tsl/platform/test_benchmark.h"
+
+namespace tsl {
+namespace io {
+namespace {
+
+static std::vector<int> BlockSizes() { return {1, 2, 3, 4, 5, 7, 64}; }
+
+// Serves reads from a string and records their offsets.
+class CountingFile : public RandomAccessFile {
+ public:
+  explicit CountingFile(std::string contents)
+      : contents_(std::move(contents)) {}
+
+  absl::Status Read(uint64 offset, size_t n, absl::string_view* result,
+                    char* scratch) const override {
+    read_offsets_.push_back(offset);
+    if (offset >= contents_.size()) {
+      *result = absl::string_view();
+      return errors::OutOfRange("end of file");
+    }
+    n = std::min<size_t>(n, contents_.size() - offset);
+    memcpy(scratch, contents_.data() + offset, n);
+    *result = absl::string_view(scratch, n);
+    return absl::OkStatus();
+  }
+
+  const std::vector<uint64>& read_offsets() const { return read_offsets_; }
+
+ private:
+  const std::string contents_;
+  mutable std::vector<uint64> read_offsets_;
+};
+
+TEST(PrefetchingInputStream, ReadNBytes) {
+  Env* env = Env::Default();
+  string fname = testing::TmpDir() + "/prefetching_inputstream_test";
+  TF_ASSERT_OK(WriteStringToFile(env, fname, "0123456789"));
+  std::unique_ptr<RandomAccessFile> file;
+  TF_ASSERT_OK(env->NewRandomAccessFile(fname, &file));
+
+  for (auto block_size : BlockSizes()) {
+    for (int queue_depth : {1, 2, 8}) {
+      tstring read;
+      PrefetchingInputStream in(file.get(), block_size, queue_depth);
+      TF_ASSERT_OK(in.ReadNBytes(3, &read));
+      EXPECT_EQ(read, "012");
+      EXPECT_EQ(3, in.Tell());
+      TF_ASSERT_OK(in.ReadNBytes(0, &read));
+      EXPECT_EQ(read, "");
+      EXPECT_EQ(3, in.Tell());
+      TF_ASSERT_OK(in.ReadNBytes(5, &read));
+      EXPECT_EQ(read, "34567");
+      EXPECT_EQ(8, in.Tell());
+      EXPECT_TRUE(errors::IsOutOfRange(in.ReadNBytes(20, &read)));
+      EXPECT_EQ(read, "89");
+      EXPECT_EQ(10, in.Tell());
+      EXPECT_TRUE(errors::IsOutOfRange(in.ReadNBytes(1, &read)));
+      EXPECT_EQ(read, "");
+      EXPECT_EQ(10, in.Tell());
+    }
+  }
+}
+
+TEST(PrefetchingInputStream, SkipNBytes) {
+  Env* env = Env::Default();
+  string fname = testing::TmpDir() + "/prefetching_inputstream_test";
+  TF_ASSERT_OK(WriteStringToFile(env, fname, "0123456789"));
+  std::unique_ptr<RandomAccessFile> file;
+  TF_ASSERT_OK(env->NewRandomAccessFile(fname, &file));
+
+  for (auto block_size : BlockSizes()) {
+    tstring read;
+    PrefetchingInputStream in(file.get(), block_size, /*queue_depth=*/4);
+    TF_ASSERT_OK(in.SkipNBytes(3));
+    EXPECT_EQ(3, in.Tell());
+    TF_ASSERT_OK(in.ReadNBytes(4, &read));
+    EXPECT_EQ(read, "3456");
+    EXPECT_EQ(7, in.Tell());
+    EXPECT_TRUE(errors::IsOutOfRange(in.SkipNBytes(5)));
+    EXPECT_EQ(10, in.Tell());
+    EXPECT_TRUE(errors::IsOutOfRange(in.ReadNBytes(5, &read)));
+    EXPECT_EQ(read, "");
+  }
+}
+
+TEST(PrefetchingInputStream, SkipBeyondPrefetchedBlocks) {
+  std::string contents;
+  for (int i = 0; i < 1000; ++i) {
+    contents.push_back(static_cast<char>(i % 251));
+  }
+  CountingFile file(contents);
+  PrefetchingInputStream in(&file, /*block_size=*/10, /*queue_depth=*/2);
+  tstring read;
+  TF_ASSERT_OK(in.ReadNBytes(1, &read));
+  TF_ASSERT_OK(in.SkipNBytes(500));
+  EXPECT_EQ(501, in.Tell());
+  TF_ASSERT_OK(in.ReadNBytes(3, &read));
+  EXPECT_EQ(read, contents.substr(501, 3));
+  // The skipped blocks are not read.
+  for (uint64 offset : file.read_offsets()) {
+    EXPECT_TRUE(offset < 20 || offset >= 500) << offset;
+  }
+
+  // Skipping past the end of the file stops at its end.
+  EXPECT_TRUE(errors::IsOutOfRange(in.SkipNBytes(1000)));
+  EXPECT_EQ(1000, in.Tell());
+}
+
+TEST(PrefetchingInputStream, NoReadsPastEndOfFile) {
+  CountingFile file("0123456789");
+  PrefetchingInputStream in(&file, /*block_size=*/4, /*queue_depth=*/8);
+  tstring read;
+  EXPECT_TRUE(errors::IsOutOfRange(in.ReadNBytes(20, &read)));
+  EXPECT_EQ(read, "0123456789");
+  const size_t num_reads = file.read_offsets().size();
+  EXPECT_TRUE(errors::IsOutOfRange(in.ReadNBytes(1, &read)));
+  EXPECT_TRUE(errors::IsOutOfRange(in.SkipNBytes(1)));
+  EXPECT_EQ(file.read_offsets().size(), num_reads);
+
+  // Seeking back only reads the blocks before the end of the file.
+  TF_ASSERT_OK(in.Seek(0));
+  TF_ASSERT_OK(in.ReadNBytes(10, &read));
+  EXPECT_EQ(read, "0123456789");
+  EXPECT_EQ(file.read_offsets().size(), num_reads + 3);
+}
+
+TEST(PrefetchingInputStream, Seek) {
+  Env* env = Env::Default();
+  string fname = testing::TmpDir() + "/prefetching_inputstream_test";
+  TF_ASSERT_OK(WriteStringToFile(env, fname, "0123456789"));
+  std::unique_ptr<RandomAccessFile> file;
+  TF_ASSERT_OK(env->NewRandomAccessFile(fname, &file));
+
+  for (auto block_size : BlockSizes()) {
+    tstring read;
+    PrefetchingInputStream in(file.get(), block_size, /*queue_depth=*/2);
+    TF_ASSERT_OK(in.ReadNBytes(2, &read));
+    EXPECT_EQ(read, "01");
+    // Forward, possibly within the prefetched blocks.
+    TF_ASSERT_OK(in.Seek(4));
+    TF_ASSERT_OK(in.ReadNBytes(3, &read));
+    EXPECT_EQ(read, "456");
+    // Backward.
+    TF_ASSERT_OK(in.Seek(1));
+    TF_ASSERT_OK(in.ReadNBytes(2, &read));
+    EXPECT_EQ(read, "12");
+    EXPECT_EQ(3, in.Tell());
+    TF_ASSERT_OK(in.Reset());
+    TF_ASSERT_OK(in.ReadNBytes(10, &read));
+    EXPECT_EQ(read, "0123456789");
+    // Past the end of the file.
+    TF_ASSERT_OK(in.Seek(12));
+    EXPECT_TRUE(errors::IsOutOfRange(in.ReadNBytes(1, &read)));
+    EXPECT_EQ(read, "");
+    EXPECT_TRUE(errors::IsInvalidArgument(in.Seek(-1)));
+  }
+}
+
+TEST(PrefetchingInputStream, LargeFile) {
+  Env* env = Env::Default();
+  string fname = testing::TmpDir() + "/prefetching_inputstream_large_test";
+  std::string contents;
+  for (int i = 0; i < 1 << 20; ++i) {
+    contents.push_back(static_cast<char>(i % 251));
+  }
+  TF_ASSERT_OK(WriteStringToFile(env, fname, contents));
+  std::unique_ptr<RandomAccessFile> file;
+  TF_ASSERT_OK(env->NewRandomAccessFile(fname, &file));
+
+  PrefetchingInputStream in(file.get(), /*block_size=*/4096,
+                            /*queue_depth=*/32);
+  std::string read_contents;
+  tstring read;
+  absl::Status s;
+  while ((s = in.ReadNBytes(10000, &read)).ok()) {
+    read_contents.append(read);
+  }
+  EXPECT_TRUE(errors::IsOutOfRange(s));
+  read_contents.append(read);
+  EXPECT_EQ(read_contents, contents);
+}
+
+void BM_PrefetchingInputStreamRead(::testing::benchmark::State& state) {
+  const int queue_depth = state.range(0);
+  Env* env = Env::Default();
+  string fname = testing::TmpDir() + "/prefetching_inputstream_benchmark";
+  TF_CHECK_OK(WriteStringToFile(env, fname, std::string(64 << 20, 'a')));
+  std::unique_ptr<RandomAccessFile> file;
+  TF_CHECK_OK(env->NewRandomAccessFile(fname, &file));
+
+  tstring read;
+  for (auto s : state) {
+    PrefetchingInputStream in(file.get(), /*block_size=*/256 << 10,
+                              queue_depth);
+    while (in.ReadNBytes(1 << 20, &read).ok()) {
+    }
+  }
+  state.SetBytesProcessed(state.iterations() * (64 << 20));
+}
+BENCHMARK(BM_PrefetchingInputStreamRead)->Arg(1)->Arg(4)->Arg(16)->Arg(64);
+
+}  // namespace
+}  // namespace io
+}  // namespace tsl
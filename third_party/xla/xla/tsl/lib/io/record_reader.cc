@@ -20,6 +20,7 @@ limitations under the License.
 #include "xla/tsl/lib/hash/crc32c.h"
 #include "xla/tsl/lib/io/buffered_inputstream.h"
 #include "xla/tsl/lib/io/compression.h"
+#include "xla/tsl/lib/io/prefetching_inputstream.h"
 #include "xla/tsl/lib/io/random_inputstream.h"
 #include "tsl/platform/env.h"
 #include "tsl/platform/errors.h"
@@ -56,12 +57,20 @@ RecordReaderOptions RecordReaderOptions::CreateRecordReaderOptions(
 
 RecordReader::RecordReader(RandomAccessFile* file,
                            const RecordReaderOptions& options)
-    : options_(options),
-      input_stream_(new RandomAccessInputStream(file)),
-      last_read_failed_(false) {
-  if (options.buffer_size > 0) {
-    input_stream_.reset(new BufferedInputStream(input_stream_.release(),
-                                                options.buffer_size, true));
+    : options_(options), last_read_failed_(false) {
+  if (options.async_read_queue_depth > 0) {
+    const int64_t block_size =
+        options.buffer_size > 0
+            ? options.buffer_size
+            : RecordReaderOptions::kDefaultAsyncReadBlockSize;
+    input_stream_.reset(new PrefetchingInputStream(
+        file, block_size, options.async_read_queue_depth));
+  } else {
+    input_stream_.reset(new RandomAccessInputStream(file));
+    if (options.buffer_size > 0) {
+      input_stream_.reset(new BufferedInputStream(input_stream_.release(),
+                                                  options.buffer_size, true));
+    }
   }
 #if defined(IS_SLIM_BUILD)
   if (options.compression_type != RecordReaderOptions::NONE) {
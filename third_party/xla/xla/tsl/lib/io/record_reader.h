@@ -46,6 +46,12 @@ struct RecordReaderOptions {
   // compressed files.) Consider using SequentialRecordReader.
   int64_t buffer_size = 0;
 
+  // If positive, the file is read sequentially in blocks of `buffer_size`
+  // bytes (or kDefaultAsyncReadBlockSize if `buffer_size` is zero), keeping up
+  // to this many block reads in flight with RandomAccessFile::ReadAsync.
+  int async_read_queue_depth = 0;
+  static constexpr int64_t kDefaultAsyncReadBlockSize = 256 << 10;
+
   static RecordReaderOptions CreateRecordReaderOptions(
       const string& compression_type);
 
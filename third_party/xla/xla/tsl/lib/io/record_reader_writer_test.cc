@@ -162,6 +162,35 @@ TEST(RecordReaderWriterTest, TestBasics) {
   }
 }
 
+TEST(RecordReaderWriterTest, TestAsyncReads) {
+  Env* env = Env::Default();
+  string fname = testing::TmpDir() + "/record_reader_writer_async_test";
+  {
+    std::unique_ptr<WritableFile> file;
+    TF_CHECK_OK(env->NewWritableFile(fname, &file));
+    io::RecordWriter writer(file.get());
+    for (int i = 0; i < 100; ++i) {
+      TF_EXPECT_OK(writer.WriteRecord(strings::StrCat("record_", i)));
+    }
+    TF_CHECK_OK(writer.Flush());
+  }
+
+  for (auto buf_size : BufferSizes()) {
+    std::unique_ptr<RandomAccessFile> read_file;
+    TF_CHECK_OK(env->NewRandomAccessFile(fname, &read_file));
+    io::RecordReaderOptions options;
+    options.buffer_size = buf_size;
+    options.async_read_queue_depth = 4;
+    io::SequentialRecordReader reader(read_file.get(), options);
+    tstring record;
+    for (int i = 0; i < 100; ++i) {
+      TF_ASSERT_OK(reader.ReadRecord(&record));
+      EXPECT_EQ(strings::StrCat("record_", i), record);
+    }
+    EXPECT_TRUE(errors::IsOutOfRange(reader.ReadRecord(&record)));
+  }
+}
+
 TEST(RecordReaderWriterTest, TestSkipBasic) {
   Env* env = Env::Default();
   string fname = testing::TmpDir() + "/record_reader_writer_skip_basic_test";
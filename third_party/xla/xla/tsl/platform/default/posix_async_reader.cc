@@ -0,0 +1,451 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "xla/tsl/platform/default/posix_async_reader.h"
+
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/memory/memory.h"
+#include "absl/status/status.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "tsl/platform/env.h"
+#include "tsl/platform/errors.h"
+#include "tsl/platform/logging.h"
+#include "tsl/platform/threadpool.h"
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+// `IORING_OP_READ` was added in Linux 5.6, the first release that reports
+// `IORING_FEAT_RW_CUR_POS`.
+#if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter) && \
+    defined(IORING_FEAT_RW_CUR_POS)
+#define TSL_POSIX_HAS_IO_URING 1
+#endif
+#endif
+#endif
+
+namespace tsl {
+namespace {
+
+// Number of entries of the submission queue of the default io_uring.
+constexpr int kDefaultQueueDepth = 256;
+// Number of threads used when io_uring is not available.
+constexpr int kDefaultNumThreads = 32;
+
+class ThreadPoolReader : public PosixAsyncReader {
+ public:
+  explicit ThreadPoolReader(int num_threads)
+      : thread_pool_(Env::Default(), "posix_async_read", num_threads) {}
+
+  void Read(int fd, const std::string& filename, uint64 offset, size_t n,
+            char* scratch, DoneCallback done) override {
+    thread_pool_.Schedule([fd, filename, offset, n, scratch,
+                           done = std::move(done)]() {
+      absl::string_view result;
+      absl::Status s = PosixPread(fd, filename, offset, n, &result, scratch);
+      done(std::move(s), result);
+    });
+  }
+
+ private:
+  thread::ThreadPool thread_pool_;
+};
+
+#if defined(TSL_POSIX_HAS_IO_URING)
+
+// Submits reads to an io_uring and completes them on a dedicated thread.
+//
+// The ring is driven with the raw system calls so that no dependency on
+// liburing is needed. Submissions are serialized by `mu_`; the completion
+// thread is the only consumer of the completion queue.
+class IoUringReader : public PosixAsyncReader {
+ public:
+  static std::unique_ptr<PosixAsyncReader> Create(int queue_depth) {
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    const int ring_fd = syscall(__NR_io_uring_setup, queue_depth, &params);
+    if (ring_fd < 0) {
+      VLOG(1) << "io_uring_setup failed: " << strerror(errno);
+      return nullptr;
+    }
+    auto reader = absl::WrapUnique(new IoUringReader(ring_fd, params));
+    if (!(params.features & IORING_FEAT_RW_CUR_POS)) {
+      VLOG(1) << "The kernel does not support io_uring reads.";
+      return nullptr;
+    }
+    if (!reader->MapRings()) {
+      return nullptr;
+    }
+    reader->completion_thread_.reset(Env::Default()->StartThread(
+        ThreadOptions(), "io_uring_completion",
+        [reader = reader.get()]() { reader->CompletionLoop(); }));
+    return reader;
+  }
+
+  ~IoUringReader() override {
+    if (completion_thread_ != nullptr) {
+      // A request without a callback tells the completion thread to exit.
+      // The thread can only be woken up through the ring, so the reader
+      // cannot be destroyed safely if this fails.
+      absl::Status s =
+          Submit(IORING_OP_NOP, /*request=*/nullptr,
+                 /*wait_for_capacity=*/false, /*retry_if_busy=*/true);
+      CHECK(s.ok()) << "Failed to stop the io_uring completion thread: " << s;
+      completion_thread_.reset();
+    }
+    if (sqes_ != nullptr) munmap(sqes_, sqes_size_);
+    if (cq_ring_ != nullptr && cq_ring_ != sq_ring_) {
+      munmap(cq_ring_, cq_ring_size_);
+    }
+    if (sq_ring_ != nullptr) munmap(sq_ring_, sq_ring_size_);
+    close(ring_fd_);
+  }
+
+  void Read(int fd, const std::string& filename, uint64 offset, size_t n,
+            char* scratch, DoneCallback done) override {
+    if (n == 0) {
+      done(absl::OkStatus(), absl::string_view(scratch, 0));
+      return;
+    }
+    auto* request = new Request{fd, filename, offset, n, scratch,
+                                /*bytes_read=*/0, std::move(done)};
+    absl::Status s = Submit(IORING_OP_READ, request,
+                            /*wait_for_capacity=*/true,
+                            /*retry_if_busy=*/true);
+    if (!s.ok()) {
+      Finish(request, std::move(s));
+    }
+  }
+
+ private:
+  struct Request {
+    int fd;
+    std::string filename;
+    uint64 offset;
+    size_t n;
+    char* scratch;
+    size_t bytes_read;
+    DoneCallback done;
+  };
+
+  IoUringReader(int ring_fd, const io_uring_params& params)
+      : ring_fd_(ring_fd), params_(params) {}
+
+  bool MapRings() {
+    sq_ring_size_ =
+        params_.sq_off.array + params_.sq_entries * sizeof(unsigned);
+    cq_ring_size_ =
+        params_.cq_off.cqes + params_.cq_entries * sizeof(io_uring_cqe);
+    const bool single_mmap = params_.features & IORING_FEAT_SINGLE_MMAP;
+    if (single_mmap) {
+      sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+    }
+    sq_ring_ = Map(sq_ring_size_, IORING_OFF_SQ_RING);
+    if (sq_ring_ == nullptr) return false;
+    cq_ring_ = single_mmap ? sq_ring_ : Map(cq_ring_size_, IORING_OFF_CQ_RING);
+    if (cq_ring_ == nullptr) return false;
+    sqes_size_ = params_.sq_entries * sizeof(io_uring_sqe);
+    sqes_ = static_cast<io_uring_sqe*>(Map(sqes_size_, IORING_OFF_SQES));
+    if (sqes_ == nullptr) return false;
+
+    char* sq = static_cast<char*>(sq_ring_);
+    sq_tail_ = reinterpret_cast<unsigned*>(sq + params_.sq_off.tail);
+    sq_mask_ = *reinterpret_cast<unsigned*>(sq + params_.sq_off.ring_mask);
+    sq_array_ = reinterpret_cast<unsigned*>(sq + params_.sq_off.array);
+    char* cq = static_cast<char*>(cq_ring_);
+    cq_head_ = reinterpret_cast<unsigned*>(cq + params_.cq_off.head);
+    cq_tail_ = reinterpret_cast<unsigned*>(cq + params_.cq_off.tail);
+    cq_mask_ = *reinterpret_cast<unsigned*>(cq + params_.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<io_uring_cqe*>(cq + params_.cq_off.cqes);
+    return true;
+  }
+
+  void* Map(size_t size, off_t offset) {
+    void* ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_POPULATE, ring_fd_, offset);
+    if (ptr == MAP_FAILED) {
+      VLOG(1) << "Failed to map io_uring: " << strerror(errno);
+      return nullptr;
+    }
+    return ptr;
+  }
+
+  bool HasCapacity() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+    return num_in_flight_ < params_.sq_entries;
+  }
+
+  // Submits the next chunk of `request`. New reads wait until fewer than
+  // `sq_entries` reads are in flight, which keeps the completion queue (at
+  // least twice as large) from overflowing. Resubmissions from the completion
+  // thread skip the wait: each of them replaces a read that just completed.
+  // If the kernel rejects the submission, it is withdrawn from the ring and an
+  // error is returned.
+  //
+  // While the completion queue is full the kernel refuses submissions with
+  // EBUSY. Other threads sleep and retry, since the completion thread drains
+  // the queue without acquiring `mu_`. The completion thread itself passes
+  // `retry_if_busy = false` and gets `Unavailable` back instead, because
+  // nobody else would drain the queue while it waits.
+  absl::Status Submit(uint8_t opcode, Request* request, bool wait_for_capacity,
+                      bool retry_if_busy) {
+    absl::MutexLock l(&mu_);
+    if (wait_for_capacity) {
+      mu_.Await(absl::Condition(this, &IoUringReader::HasCapacity));
+    }
+    const unsigned tail = *sq_tail_;
+    const unsigned index = tail & sq_mask_;
+    io_uring_sqe* sqe = &sqes_[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = opcode;
+    sqe->user_data = reinterpret_cast<uint64_t>(request);
+    if (request != nullptr) {
+      sqe->fd = request->fd;
+      sqe->off = request->offset + request->bytes_read;
+      sqe->addr =
+          reinterpret_cast<uint64_t>(request->scratch + request->bytes_read);
+      // Reads longer than this are completed in several chunks.
+      sqe->len = std::min<size_t>(request->n - request->bytes_read, INT32_MAX);
+    }
+    sq_array_[index] = index;
+    __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+    ++num_in_flight_;
+
+    // Entries are consumed by the kernel within `io_uring_enter`, so the
+    // submission queue is empty whenever `mu_` is free.
+    while (true) {
+      const int ret = syscall(__NR_io_uring_enter, ring_fd_, /*to_submit=*/1,
+                              /*min_complete=*/0, /*flags=*/0, nullptr, 0);
+      if (ret > 0) return absl::OkStatus();
+      if (ret < 0 && errno == EINTR) continue;
+      const bool busy = ret == 0 || errno == EAGAIN || errno == EBUSY;
+      if (busy && retry_if_busy) {
+        Env::Default()->SleepForMicroseconds(10);
+        continue;
+      }
+      // The entry was not consumed, and the kernel only consumes entries
+      // within `io_uring_enter`, so it can be withdrawn.
+      const int error = errno;
+      __atomic_store_n(sq_tail_, tail, __ATOMIC_RELEASE);
+      --num_in_flight_;
+      if (busy) {
+        return absl::UnavailableError("The io_uring completion queue is full");
+      }
+      return errors::IOError(
+          request != nullptr ? request->filename : "io_uring_enter", error);
+    }
+  }
+
+  void CompletionLoop() {
+    std::vector<std::pair<Request*, int>> completed;
+    bool shutting_down = false;
+    while (!shutting_down) {
+      ResubmitDeferred();
+      unsigned head = *cq_head_;
+      const unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+      if (head == tail) {
+        if (!deferred_.empty()) {
+          // The kernel refused the resubmissions although the completion
+          // queue is empty. Retry without waiting for a completion, which
+          // may never come if no other read is in flight.
+          Env::Default()->SleepForMicroseconds(10);
+          continue;
+        }
+        const int ret =
+            syscall(__NR_io_uring_enter, ring_fd_, /*to_submit=*/0,
+                    /*min_complete=*/1, IORING_ENTER_GETEVENTS, nullptr, 0);
+        if (ret < 0 && errno != EINTR) {
+          LOG(ERROR) << "io_uring_enter failed: " << strerror(errno);
+        }
+        continue;
+      }
+      completed.clear();
+      for (; head != tail; ++head) {
+        const io_uring_cqe& cqe = cqes_[head & cq_mask_];
+        completed.emplace_back(reinterpret_cast<Request*>(cqe.user_data),
+                               cqe.res);
+      }
+      __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+      {
+        absl::MutexLock l(&mu_);
+        num_in_flight_ -= completed.size();
+      }
+      for (const auto& [request, result] : completed) {
+        if (request == nullptr) {
+          shutting_down = true;
+          continue;
+        }
+        Complete(request, result);
+      }
+    }
+  }
+
+  // Resubmits the next chunk of `request` from the completion thread. If the
+  // completion queue is full, the request is deferred until it is drained.
+  absl::Status Resubmit(Request* request) {
+    absl::Status status = Submit(IORING_OP_READ, request,
+                                 /*wait_for_capacity=*/false,
+                                 /*retry_if_busy=*/false);
+    if (absl::IsUnavailable(status)) {
+      deferred_.push_back(request);
+      return absl::OkStatus();
+    }
+    return status;
+  }
+
+  // Retries the requests deferred by `Resubmit`. Runs on the completion
+  // thread after the completion queue has been drained.
+  void ResubmitDeferred() {
+    std::vector<Request*> deferred;
+    deferred.swap(deferred_);
+    for (Request* request : deferred) {
+      absl::Status status = Resubmit(request);
+      if (!status.ok()) Finish(request, std::move(status));
+    }
+  }
+
+  // Handles the completion of a chunk of `request` that returned `result`,
+  // either a byte count or a negated errno.
+  void Complete(Request* request, int result) {
+    absl::Status status;
+    if (result == -EINTR || result == -EAGAIN) {
+      status = Resubmit(request);
+      if (status.ok()) return;
+    } else if (result < 0) {
+      status = errors::IOError(request->filename, -result);
+    } else if (result == 0) {
+      status = absl::Status(absl::StatusCode::kOutOfRange,
+                            "Read less bytes than requested");
+    } else {
+      request->bytes_read += result;
+      if (request->bytes_read < request->n) {
+        status = Resubmit(request);
+        if (status.ok()) return;
+      }
+    }
+    Finish(request, std::move(status));
+  }
+
+  // Runs the callback of `request` with the bytes read so far and deletes it.
+  static void Finish(Request* request, absl::Status status) {
+    request->done(std::move(status),
+                  absl::string_view(request->scratch, request->bytes_read));
+    delete request;
+  }
+
+  const int ring_fd_;
+  const io_uring_params params_;
+
+  void* sq_ring_ = nullptr;
+  size_t sq_ring_size_ = 0;
+  void* cq_ring_ = nullptr;
+  size_t cq_ring_size_ = 0;
+  io_uring_sqe* sqes_ = nullptr;
+  size_t sqes_size_ = 0;
+
+  unsigned* sq_tail_ = nullptr;
+  unsigned sq_mask_ = 0;
+  unsigned* sq_array_ = nullptr;
+  unsigned* cq_head_ = nullptr;
+  unsigned* cq_tail_ = nullptr;
+  unsigned cq_mask_ = 0;
+  io_uring_cqe* cqes_ = nullptr;
+
+  absl::Mutex mu_;
+  unsigned num_in_flight_ ABSL_GUARDED_BY(mu_) = 0;
+  // Requests whose resubmission the kernel refused because the completion
+  // queue was full. Only accessed by the completion thread.
+  std::vector<Request*> deferred_;
+  std::unique_ptr<Thread> completion_thread_;
+};
+
+#endif  // TSL_POSIX_HAS_IO_URING
+
+}  // namespace
+
+absl::Status PosixPread(int fd, const std::string& filename, uint64 offset,
+                        size_t n, absl::string_view* result, char* scratch) {
+  absl::Status s;
+  char* dst = scratch;
+  while (n > 0 && s.ok()) {
+    // Some platforms, notably macs, throw EINVAL if pread is asked to read
+    // more than fits in a 32-bit integer.
+    size_t requested_read_length;
+    if (n > INT32_MAX) {
+      requested_read_length = INT32_MAX;
+    } else {
+      requested_read_length = n;
+    }
+    ssize_t r =
+        pread(fd, dst, requested_read_length, static_cast<off_t>(offset));
+    if (r > 0) {
+      dst += r;
+      n -= r;
+      offset += r;
+    } else if (r == 0) {
+      s = absl::Status(absl::StatusCode::kOutOfRange,
+                       "Read less bytes than requested");
+    } else if (errno == EINTR || errno == EAGAIN) {
+      // Retry
+    } else {
+      s = errors::IOError(filename, errno);
+    }
+  }
+  *result = absl::string_view(scratch, dst - scratch);
+  return s;
+}
+
+std::unique_ptr<PosixAsyncReader> PosixAsyncReader::CreateIoUring(
+    int queue_depth) {
+#if defined(TSL_POSIX_HAS_IO_URING)
+  return IoUringReader::Create(queue_depth);
+#else
+  return nullptr;
+#endif
+}
+
+std::unique_ptr<PosixAsyncReader> PosixAsyncReader::CreateThreadPool(
+    int num_threads) {
+  return std::make_unique<ThreadPoolReader>(num_threads);
+}
+
+PosixAsyncReader* PosixAsyncReader::Default() {
+  static PosixAsyncReader* reader = [] {
+    std::unique_ptr<PosixAsyncReader> reader =
+        CreateIoUring(kDefaultQueueDepth);
+    if (reader == nullptr) {
+      VLOG(1) << "io_uring is not available; asynchronous reads will use a "
+              << "thread pool.";
+      reader = CreateThreadPool(kDefaultNumThreads);
+    }
+    return reader.release();
+  }();
+  return reader;
+}
+
+}  // namespace tsl
@@ -0,0 +1,71 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef XLA_TSL_PLATFORM_DEFAULT_POSIX_ASYNC_READER_H_
+#define XLA_TSL_PLATFORM_DEFAULT_POSIX_ASYNC_READER_H_
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+#include "absl/status/status.h"
+#include "absl/strings/string_view.h"
+#include "tsl/platform/file_system.h"
+#include "tsl/platform/types.h"
+
+namespace tsl {
+
+// Reads `n` bytes of `fd` starting at `offset` with `pread`, following the
+// contract of `RandomAccessFile::Read`. `filename` is used in error messages.
+absl::Status PosixPread(int fd, const std::string& filename, uint64 offset,
+                        size_t n, absl::string_view* result, char* scratch);
+
+// Issues reads of POSIX file descriptors that complete asynchronously.
+//
+// On Linux 5.6 and later, reads are submitted to an io_uring and completed by
+// a single thread that waits on the ring, so any number of reads can be in
+// flight without a thread each. Elsewhere, reads are executed with `pread` on
+// a fixed-size thread pool.
+//
+// This class is thread-safe.
+class PosixAsyncReader {
+ public:
+  using DoneCallback = RandomAccessFile::ReadDoneCallback;
+
+  virtual ~PosixAsyncReader() = default;
+
+  // Reads `n` bytes of `fd` starting at `offset` into `scratch` and invokes
+  // `done` with the status and data that `PosixPread` would have returned.
+  // `fd` and `scratch` must remain valid until `done` is invoked. `done` must
+  // not block.
+  virtual void Read(int fd, const std::string& filename, uint64 offset,
+                    size_t n, char* scratch, DoneCallback done) = 0;
+
+  // Returns a reader that submits up to `queue_depth` concurrent reads to an
+  // io_uring, or nullptr if the kernel does not support io_uring reads. All
+  // reads must complete before the reader is destroyed.
+  static std::unique_ptr<PosixAsyncReader> CreateIoUring(int queue_depth);
+
+  // Returns a reader that executes reads on `num_threads` threads.
+  static std::unique_ptr<PosixAsyncReader> CreateThreadPool(int num_threads);
+
+  // Returns the process-wide reader used by the POSIX file system, which uses
+  // io_uring when available.
+  static PosixAsyncReader* Default();
+};
+
+}  // namespace tsl
+
+#endif  // XLA_TSL_PLATFORM_DEFAULT_POSIX_ASYNC_READER_H_
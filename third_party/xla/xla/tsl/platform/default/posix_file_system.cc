@@ -29,6 +29,9 @@ limitations under the License.
 #include <time.h>
 #include <unistd.h>
 
+#include <utility>
+
+#include "xla/tsl/platform/default/posix_async_reader.h"
 #include "xla/tsl/platform/default/posix_file_system.h"
 #include "xla/tsl/protobuf/error_codes.pb.h"
 #include "tsl/platform/env.h"
@@ -67,34 +70,13 @@ class PosixRandomAccessFile : public RandomAccessFile {
 
   absl::Status Read(uint64 offset, size_t n, absl::string_view* result,
                     char* scratch) const override {
-    absl::Status s;
-    char* dst = scratch;
-    while (n > 0 && s.ok()) {
-      // Some platforms, notably macs, throw EINVAL if pread is asked to read
-      // more than fits in a 32-bit integer.
-      size_t requested_read_length;
-      if (n > INT32_MAX) {
-        requested_read_length = INT32_MAX;
-      } else {
-        requested_read_length = n;
-      }
-      ssize_t r =
-          pread(fd_, dst, requested_read_length, static_cast<off_t>(offset));
-      if (r > 0) {
-        dst += r;
-        n -= r;
-        offset += r;
-      } else if (r == 0) {
-        s = absl::Status(absl::StatusCode::kOutOfRange,
-                         "Read less bytes than requested");
-      } else if (errno == EINTR || errno == EAGAIN) {
-        // Retry
-      } else {
-        s = IOError(filename_, errno);
-      }
-    }
-    *result = absl::string_view(scratch, dst - scratch);
-    return s;
+    return PosixPread(fd_, filename_, offset, n, result, scratch);
+  }
+
+  void ReadAsync(uint64 offset, size_t n, char* scratch,
+                 ReadDoneCallback done) const override {
+    PosixAsyncReader::Default()->Read(fd_, filename_, offset, n, scratch,
+                                      std::move(done));
   }
 
 #if defined(TF_CORD_SUPPORT)
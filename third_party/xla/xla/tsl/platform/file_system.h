@@ -784,6 +784,29 @@ class RandomAccessFile {
   virtual absl::Status Read(uint64 offset, size_t n, absl::string_view* result,
                             char* scratch) const = 0;
 
+  /// \brief Invoked with the status and data that `Read` would have returned.
+  using ReadDoneCallback =
+      std::function<void(absl::Status, absl::string_view)>;
+
+  /// \brief Starts reading up to `n` bytes from the file starting at `offset`
+  /// and invokes `done` exactly once with the result.
+  ///
+  /// `scratch[0..n-1]` and the file must remain live until `done` is invoked.
+  /// `done` may run on another thread, before or after this call returns, and
+  /// must not block: implementations may invoke it on a thread that completes
+  /// other reads.
+  ///
+  /// The default implementation calls `Read` and invokes `done` before
+  /// returning.
+  ///
+  /// Safe for concurrent use by multiple threads.
+  virtual void ReadAsync(uint64 offset, size_t n, char* scratch,
+                         ReadDoneCallback done) const {
+    absl::string_view result;
+    absl::Status s = Read(offset, n, &result, scratch);
+    done(std::move(s), result);
+  }
+
 #if defined(TF_CORD_SUPPORT)
   /// \brief Read up to `n` bytes from the file starting at `offset`.
   virtual absl::Status Read(uint64 offset, size_t n, absl::Cord* cord) const {